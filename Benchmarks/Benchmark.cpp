@@ -0,0 +1,104 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Benchmark.h"
+
+#include <cstdio>
+
+#include <QtCore/QElapsedTimer>
+
+#include "Engine/MemoryInfo.h"
+
+// Each benchmark is repeated until it ran at least this long...
+#define NATRON_BENCHMARK_MIN_DURATION_MS 1000
+
+// ...and at least this many times, not counting the warm-up iteration
+#define NATRON_BENCHMARK_MIN_ITERATIONS 3
+
+NATRON_NAMESPACE_ENTER
+
+Benchmark::Benchmark(const std::string& name,
+                     const std::string& unit)
+    : _name(name)
+    , _unit(unit)
+{
+    getRegisteredBenchmarks().push_back(this);
+}
+
+Benchmark::~Benchmark()
+{
+}
+
+std::list<Benchmark*>&
+Benchmark::getRegisteredBenchmarks()
+{
+    static std::list<Benchmark*> benchmarks;
+
+    return benchmarks;
+}
+
+int
+runBenchmarks(const std::string& filter)
+{
+    int nFailed = 0;
+    const std::list<Benchmark*>& benchmarks = Benchmark::getRegisteredBenchmarks();
+
+    printf("%-32s %10s %14s %18s %12s\n", "benchmark", "iterations", "ms/iteration", "units/s", "peak RSS MB");
+    for (std::list<Benchmark*>::const_iterator it = benchmarks.begin(); it != benchmarks.end(); ++it) {
+        Benchmark* b = *it;
+        if ( !filter.empty() && (b->getName().find(filter) == std::string::npos) ) {
+            continue;
+        }
+        if ( !b->setUp() ) {
+            printf("%-32s failed to set up\n", b->getName().c_str());
+            ++nFailed;
+            continue;
+        }
+
+        // Warm-up: fill the caches and let the lazy initializations happen out of the measure
+        (void)b->run();
+
+        QElapsedTimer timer;
+        timer.start();
+        int nIterations = 0;
+        U64 nUnits = 0;
+        while ( (nIterations < NATRON_BENCHMARK_MIN_ITERATIONS) || (timer.elapsed() < NATRON_BENCHMARK_MIN_DURATION_MS) ) {
+            nUnits += b->run();
+            ++nIterations;
+        }
+        double elapsedMs = timer.nsecsElapsed() / 1e6;
+
+        b->tearDown();
+
+        printf( "%-32s %10d %14.3f %18.1f %12.1f  (%s)\n", b->getName().c_str(), nIterations, elapsedMs / nIterations,
+                elapsedMs > 0 ? nUnits * 1000. / elapsedMs : 0., getPeakRSS() / (1024. * 1024.), b->getUnit().c_str() );
+        fflush(stdout);
+    }
+
+    return nFailed;
+}
+
+NATRON_NAMESPACE_EXIT
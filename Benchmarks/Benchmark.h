@@ -0,0 +1,109 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_BENCHMARKS_BENCHMARK_H
+#define NATRON_BENCHMARKS_BENCHMARK_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <string>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A benchmark measures the throughput of one operation of the engine. Each benchmark is registered
+ * by declaring a static instance of its class with NATRON_REGISTER_BENCHMARK.
+ * The runner calls setUp() once, then run() once to warm-up and repeatedly until enough time has elapsed,
+ * then tearDown(). Inputs must be generated deterministically so that runs can be compared across builds.
+ **/
+class Benchmark
+{
+public:
+
+    /**
+     * @param unit What run() processes, e.g: "pixels", "lookups" or "frames"
+     **/
+    Benchmark(const std::string& name,
+              const std::string& unit);
+
+    virtual ~Benchmark();
+
+    const std::string& getName() const
+    {
+        return _name;
+    }
+
+    const std::string& getUnit() const
+    {
+        return _unit;
+    }
+
+    /**
+     * @brief Returns false if the benchmark cannot run, e.g: a plug-in it needs is not installed.
+     **/
+    virtual bool setUp()
+    {
+        return true;
+    }
+
+    virtual void tearDown()
+    {
+    }
+
+    /**
+     * @brief Runs one iteration and returns the amount of units it processed.
+     **/
+    virtual U64 run() = 0;
+
+    static std::list<Benchmark*>& getRegisteredBenchmarks();
+
+private:
+
+    std::string _name;
+    std::string _unit;
+};
+
+#define NATRON_REGISTER_BENCHMARK(className) static className className ## Instance;
+
+/**
+ * @brief Runs all the registered benchmarks whose name contains filter (all of them if it is empty)
+ * and prints their results to stdout. Returns the number of benchmarks that failed to set up.
+ **/
+int runBenchmarks(const std::string& filter);
+
+/**
+ * @brief Replays a log written by RenderRequestRecorder in the headless application and prints the latency of each
+ * render request to stdout. Returns non-zero if the log or its project could not be loaded.
+ **/
+int replayRenderRequests(const std::string& logFilePath);
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_BENCHMARKS_BENCHMARK_H
@@ -0,0 +1,306 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cassert>
+#include <stdexcept>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+
+#include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/CreateNodeArgs.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Format.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/OutputEffectInstance.h"
+#include "Engine/Plugin.h"
+#include "Engine/Project.h"
+#include "Engine/RotoContext.h"
+#include "Engine/ViewIdx.h"
+
+#include "Benchmark.h"
+
+// The synthetic graphs render this many frames of this format in each iteration
+#define NATRON_BENCHMARK_GRAPH_FRAMES 10
+#define NATRON_BENCHMARK_GRAPH_WIDTH 960
+#define NATRON_BENCHMARK_GRAPH_HEIGHT 540
+
+// Size of the synthetic graphs
+#define NATRON_BENCHMARK_CHAIN_DEPTH 32
+#define NATRON_BENCHMARK_MERGE_WIDTH 16
+#define NATRON_BENCHMARK_ROTO_SHAPES 64
+
+#define NATRON_BENCHMARK_OUTPUT_BASENAME "NatronBenchmark_"
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief Base class of the benchmarks rendering a synthetic node graph to a writer in the headless application:
+ * they measure the whole render pipeline (requests, caching, threading, plug-ins). The node cache is cleared
+ * before each iteration so that all the frames are rendered again.
+ **/
+class GraphBenchmark
+    : public Benchmark
+{
+public:
+
+    GraphBenchmark(const std::string& name)
+        : Benchmark(name, "frames")
+        , _writer()
+    {
+    }
+
+    virtual bool setUp() OVERRIDE FINAL
+    {
+        AppInstancePtr app = appPTR->getTopLevelInstance();
+
+        if ( !app || !hasPlugin(PLUGINID_OFX_WRITEOIIO) ) {
+            return false;
+        }
+
+        Format f(0, 0, NATRON_BENCHMARK_GRAPH_WIDTH, NATRON_BENCHMARK_GRAPH_HEIGHT, "NatronBenchmark", 1.);
+        app->getProject()->setOrAddProjectFormat(f);
+
+        KnobIntPtr frameRange = boost::dynamic_pointer_cast<KnobInt>( app->getProject()->getKnobByName("frameRange") );
+        if (frameRange) {
+            frameRange->setValue(1, ViewSpec::all(), 0);
+            frameRange->setValue(NATRON_BENCHMARK_GRAPH_FRAMES, ViewSpec::all(), 1);
+        }
+
+        NodePtr output = buildGraph();
+        if (!output) {
+            app->getProject()->clearNodesBlocking();
+
+            return false;
+        }
+
+        _writer = createNode(PLUGINID_OFX_WRITEOIIO);
+        if (!_writer) {
+            app->getProject()->clearNodesBlocking();
+
+            return false;
+        }
+        QString filePath = QDir::tempPath() + QString::fromUtf8("/" NATRON_BENCHMARK_OUTPUT_BASENAME "####.exr");
+        _writer->setOutputFilesForWriter( filePath.toStdString() );
+        _writer->connectInput(output, 0);
+
+        return true;
+    }
+
+    virtual void tearDown() OVERRIDE FINAL
+    {
+        _writer.reset();
+        appPTR->getTopLevelInstance()->getProject()->clearNodesBlocking();
+        appPTR->clearNodeCache();
+
+        QDir tmpDir( QDir::tempPath() );
+        QStringList outputs = tmpDir.entryList(QStringList() << QString::fromUtf8(NATRON_BENCHMARK_OUTPUT_BASENAME "*"), QDir::Files);
+        for (QStringList::iterator it = outputs.begin(); it != outputs.end(); ++it) {
+            QFile::remove( tmpDir.absoluteFilePath(*it) );
+        }
+    }
+
+    virtual U64 run() OVERRIDE FINAL
+    {
+        appPTR->clearNodeCache();
+
+        std::list<AppInstance::RenderWork> works;
+        AppInstance::RenderWork w;
+        w.writer = dynamic_cast<OutputEffectInstance*>( _writer->getEffectInstance().get() );
+        assert(w.writer);
+        w.firstFrame = 1;
+        w.lastFrame = NATRON_BENCHMARK_GRAPH_FRAMES;
+        w.frameStep = 1;
+        w.useRenderStats = false;
+        works.push_back(w);
+        appPTR->getTopLevelInstance()->startWritersRendering(true, works);
+
+        return NATRON_BENCHMARK_GRAPH_FRAMES;
+    }
+
+protected:
+
+    /**
+     * @brief Creates the nodes of the graph and returns the one to connect to the writer, or NULL if a plug-in is missing.
+     **/
+    virtual NodePtr buildGraph() = 0;
+
+    static bool hasPlugin(const char* pluginID)
+    {
+        try {
+            return appPTR->getPluginBinary(QString::fromUtf8(pluginID), -1, -1, false) != 0;
+        } catch (const std::exception& /*e*/) {
+            return false;
+        }
+    }
+
+    static NodePtr createNode(const char* pluginID)
+    {
+        if ( !hasPlugin(pluginID) ) {
+            return NodePtr();
+        }
+        AppInstancePtr app = appPTR->getTopLevelInstance();
+        CreateNodeArgs args( pluginID, app->getProject() );
+
+        return app->createNode(args);
+    }
+
+    /**
+     * @brief Creates a generator whose output differs for each index, so that the nodes do not share their cache entries.
+     **/
+    static NodePtr createGenerator(int index)
+    {
+        NodePtr generator = createNode(PLUGINID_OFX_SENOISE);
+
+        if (generator) {
+            KnobDoublePtr slope = boost::dynamic_pointer_cast<KnobDouble>( generator->getKnobByName("noiseZSlope") );
+            if (slope) {
+                slope->setValue(0.01 * (index + 1), ViewSpec::all(), 0);
+            }
+        }
+
+        return generator;
+    }
+
+private:
+
+    NodePtr _writer;
+};
+
+// A long chain of simple color operators: measures the per-node overhead of a render
+class DeepChainBenchmark
+    : public GraphBenchmark
+{
+public:
+
+    DeepChainBenchmark()
+        : GraphBenchmark("Graph.deepChain")
+    {
+    }
+
+private:
+
+    virtual NodePtr buildGraph() OVERRIDE FINAL
+    {
+        NodePtr last = createGenerator(0);
+
+        for (int i = 0; last && i < NATRON_BENCHMARK_CHAIN_DEPTH; ++i) {
+            NodePtr grade = createNode(PLUGINID_OFX_GRADE);
+            if (!grade) {
+                return NodePtr();
+            }
+            grade->connectInput(last, 0);
+            last = grade;
+        }
+
+        return last;
+    }
+};
+
+NATRON_REGISTER_BENCHMARK(DeepChainBenchmark)
+
+// Many generators merged together: measures the rendering of a wide graph, whose branches can render in parallel
+class WideMergeBenchmark
+    : public GraphBenchmark
+{
+public:
+
+    WideMergeBenchmark()
+        : GraphBenchmark("Graph.wideMerge")
+    {
+    }
+
+private:
+
+    virtual NodePtr buildGraph() OVERRIDE FINAL
+    {
+        NodePtr last = createGenerator(0);
+
+        for (int i = 1; last && i < NATRON_BENCHMARK_MERGE_WIDTH; ++i) {
+            NodePtr generator = createGenerator(i);
+            NodePtr merge = createNode(PLUGINID_OFX_MERGE);
+            if (!generator || !merge) {
+                return NodePtr();
+            }
+            // Input 0 is B, input 1 is A
+            merge->connectInput(last, 0);
+            merge->connectInput(generator, 1);
+            last = merge;
+        }
+
+        return last;
+    }
+};
+
+NATRON_REGISTER_BENCHMARK(WideMergeBenchmark)
+
+// A roto node with many overlapping shapes: measures the roto rasterization
+class RotoHeavyBenchmark
+    : public GraphBenchmark
+{
+public:
+
+    RotoHeavyBenchmark()
+        : GraphBenchmark("Graph.rotoHeavy")
+    {
+    }
+
+private:
+
+    virtual NodePtr buildGraph() OVERRIDE FINAL
+    {
+        NodePtr roto = createNode(PLUGINID_NATRON_ROTO);
+
+        if (!roto) {
+            return NodePtr();
+        }
+        RotoContextPtr context = roto->getRotoContext();
+        if (!context) {
+            return NodePtr();
+        }
+        for (int i = 0; i < NATRON_BENCHMARK_ROTO_SHAPES; ++i) {
+            // Shapes laid out on a 8x8 grid, each overlapping its neighbours
+            double x = ( (i % 8) + 0.5 ) * NATRON_BENCHMARK_GRAPH_WIDTH / 8.;
+            double y = ( (i / 8) + 0.5 ) * NATRON_BENCHMARK_GRAPH_HEIGHT / 8.;
+            (void)context->makeEllipse(x, y, NATRON_BENCHMARK_GRAPH_HEIGHT / 4., true, 1.);
+        }
+
+        return roto;
+    }
+};
+
+NATRON_REGISTER_BENCHMARK(RotoHeavyBenchmark)
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,378 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
+
+#include <QtCore/QThread>
+
+#include "Engine/AppManager.h"
+#include "Engine/Curve.h"
+#include "Engine/Hash64.h"
+#include "Engine/Image.h"
+#include "Engine/ImageKey.h"
+#include "Engine/ImageParams.h"
+#include "Engine/ViewIdx.h"
+
+#include "Benchmark.h"
+
+// Size of the images converted and downscaled: a HD frame
+#define NATRON_BENCHMARK_IMAGE_WIDTH 1920
+#define NATRON_BENCHMARK_IMAGE_HEIGHT 1080
+
+// Number of images in the cache and threads looking them up concurrently
+#define NATRON_BENCHMARK_CACHE_ENTRIES 4096
+#define NATRON_BENCHMARK_CACHE_THREADS 8
+#define NATRON_BENCHMARK_CACHE_LOOKUPS_PER_THREAD 20000
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+ImagePtr
+makeLocalImage(const ImagePlaneDesc& components,
+               ImageBitDepthEnum depth,
+               const RectI& bounds,
+               unsigned int mipMapLevel)
+{
+    RectD rod(0, 0, NATRON_BENCHMARK_IMAGE_WIDTH, NATRON_BENCHMARK_IMAGE_HEIGHT);
+
+    return boost::make_shared<Image>(components, rod, bounds, mipMapLevel, 1., depth, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone);
+}
+
+class ConvertToFormatBenchmark
+    : public Benchmark
+{
+public:
+
+    ConvertToFormatBenchmark()
+        : Benchmark("Image.convertToFormat", "pixels")
+    {
+    }
+
+    virtual bool setUp() OVERRIDE FINAL
+    {
+        RectI bounds(0, 0, NATRON_BENCHMARK_IMAGE_WIDTH, NATRON_BENCHMARK_IMAGE_HEIGHT);
+
+        _src = makeLocalImage(ImagePlaneDesc::getRGBAComponents(), eImageBitDepthFloat, bounds, 0);
+        _src->fill(bounds, 0.25f, 0.5f, 0.75f, 1.f);
+        _dst = makeLocalImage(ImagePlaneDesc::getRGBComponents(), eImageBitDepthByte, bounds, 0);
+
+        return true;
+    }
+
+    virtual void tearDown() OVERRIDE FINAL
+    {
+        _src.reset();
+        _dst.reset();
+    }
+
+    // Float linear RGBA to 8-bit sRGB RGB, as done for a viewer or a writer
+    virtual U64 run() OVERRIDE FINAL
+    {
+        const RectI& bounds = _src->getBounds();
+
+        _src->convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceSRGB, 3, false, false, _dst.get());
+
+        return bounds.area();
+    }
+
+private:
+
+    ImagePtr _src, _dst;
+};
+
+NATRON_REGISTER_BENCHMARK(ConvertToFormatBenchmark)
+
+class DownscaleMipMapBenchmark
+    : public Benchmark
+{
+public:
+
+    DownscaleMipMapBenchmark()
+        : Benchmark("Image.downscaleMipMap", "pixels")
+    {
+    }
+
+    virtual bool setUp() OVERRIDE FINAL
+    {
+        RectI bounds(0, 0, NATRON_BENCHMARK_IMAGE_WIDTH, NATRON_BENCHMARK_IMAGE_HEIGHT);
+
+        _src = makeLocalImage(ImagePlaneDesc::getRGBAComponents(), eImageBitDepthFloat, bounds, 0);
+        _src->fill(bounds, 0.25f, 0.5f, 0.75f, 1.f);
+        _dst = makeLocalImage(ImagePlaneDesc::getRGBAComponents(), eImageBitDepthFloat, bounds.downscalePowerOfTwoSmallestEnclosing(1), 1);
+
+        return true;
+    }
+
+    virtual void tearDown() OVERRIDE FINAL
+    {
+        _src.reset();
+        _dst.reset();
+    }
+
+    // A single level: this is the halveRoI() code-path
+    virtual U64 run() OVERRIDE FINAL
+    {
+        const RectI& bounds = _src->getBounds();
+
+        _src->downscaleMipMap(_src->getRoD(), bounds, 0, 1, false, _dst.get());
+
+        return bounds.area();
+    }
+
+private:
+
+    ImagePtr _src, _dst;
+};
+
+NATRON_REGISTER_BENCHMARK(DownscaleMipMapBenchmark)
+
+class MinimalNonMarkedRectsBenchmark
+    : public Benchmark
+{
+public:
+
+    MinimalNonMarkedRectsBenchmark()
+        : Benchmark("Bitmap.minimalNonMarkedRects", "pixels")
+        , _bitmap( RectI(0, 0, NATRON_BENCHMARK_IMAGE_WIDTH, NATRON_BENCHMARK_IMAGE_HEIGHT) )
+    {
+    }
+
+    // Mark one tile out of two, as left by an aborted tiled render
+    virtual bool setUp() OVERRIDE FINAL
+    {
+        const int tileSize = 128;
+
+        _bitmap.clear( _bitmap.getBounds() );
+        for (int y = 0; y < NATRON_BENCHMARK_IMAGE_HEIGHT; y += tileSize) {
+            for (int x = ( (y / tileSize) % 2 ) * tileSize; x < NATRON_BENCHMARK_IMAGE_WIDTH; x += 2 * tileSize) {
+                RectI tile(x, y, x + tileSize, y + tileSize);
+                RectI marked;
+                if ( tile.intersect(_bitmap.getBounds(), &marked) ) {
+                    _bitmap.markForRendered(marked);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    virtual U64 run() OVERRIDE FINAL
+    {
+        std::list<RectI> rects;
+
+        _bitmap.minimalNonMarkedRects(_bitmap.getBounds(), rects);
+
+        return _bitmap.getBounds().area();
+    }
+
+private:
+
+    Bitmap _bitmap;
+};
+
+NATRON_REGISTER_BENCHMARK(MinimalNonMarkedRectsBenchmark)
+
+class CacheLookupThread
+    : public QThread
+{
+public:
+
+    CacheLookupThread(const std::vector<ImageKey>* keys,
+                      int seed)
+        : QThread()
+        , _keys(keys)
+        , _seed(seed)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        std::list<ImagePtr> images;
+        const std::size_t nKeys = _keys->size();
+        std::size_t index = _seed;
+
+        for (int i = 0; i < NATRON_BENCHMARK_CACHE_LOOKUPS_PER_THREAD; ++i) {
+            // A prime stride visits all the keys in an order that differs from the other threads
+            index = (index + 7919) % nKeys;
+            images.clear();
+            appPTR->getImage( (*_keys)[index], &images );
+        }
+    }
+
+    const std::vector<ImageKey>* _keys;
+    int _seed;
+};
+
+class CacheGetContentionBenchmark
+    : public Benchmark
+{
+public:
+
+    CacheGetContentionBenchmark()
+        : Benchmark("Cache.get.contention", "lookups")
+    {
+    }
+
+    virtual bool setUp() OVERRIDE FINAL
+    {
+        RectD rod(0, 0, 16, 16);
+        ImageParamsPtr params = Image::makeParams(rod, 1., 0, false, ImagePlaneDesc::getRGBAComponents(), eImageBitDepthFloat, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone);
+
+        for (int i = 0; i < NATRON_BENCHMARK_CACHE_ENTRIES; ++i) {
+            ImageKey key(NULL, i + 1, false, 0., ViewIdx(0), 1., false, false);
+            ImagePtr image;
+            appPTR->getImageOrCreate(key, params, &image);
+            if (!image) {
+                return false;
+            }
+            _keys.push_back(key);
+            _images.push_back(image);
+        }
+
+        return true;
+    }
+
+    virtual void tearDown() OVERRIDE FINAL
+    {
+        _images.clear();
+        _keys.clear();
+        appPTR->clearNodeCache();
+    }
+
+    virtual U64 run() OVERRIDE FINAL
+    {
+        std::vector<CacheLookupThread*> threads;
+
+        for (int i = 0; i < NATRON_BENCHMARK_CACHE_THREADS; ++i) {
+            threads.push_back( new CacheLookupThread(&_keys, i * 131) );
+            threads.back()->start();
+        }
+        for (std::size_t i = 0; i < threads.size(); ++i) {
+            threads[i]->wait();
+            delete threads[i];
+        }
+
+        return NATRON_BENCHMARK_CACHE_THREADS * NATRON_BENCHMARK_CACHE_LOOKUPS_PER_THREAD;
+    }
+
+private:
+
+    std::vector<ImageKey> _keys;
+    std::list<ImagePtr> _images;
+};
+
+NATRON_REGISTER_BENCHMARK(CacheGetContentionBenchmark)
+
+class CurveGetValueAtBenchmark
+    : public Benchmark
+{
+public:
+
+    CurveGetValueAtBenchmark()
+        : Benchmark("Curve.getValueAt", "evaluations")
+        , _curve()
+        , _sum(0.)
+    {
+    }
+
+    virtual bool setUp() OVERRIDE FINAL
+    {
+        _curve.clearKeyFrames();
+        for (int i = 0; i < 100; ++i) {
+            // A deterministic, non-monotonic animation
+            (void)_curve.addKeyFrame( KeyFrame( i * 10., (i * 37) % 11 ) );
+        }
+
+        return true;
+    }
+
+    virtual U64 run() OVERRIDE FINAL
+    {
+        const int nEvaluations = 100000;
+        double sum = 0.;
+
+        for (int i = 0; i < nEvaluations; ++i) {
+            sum += _curve.getValueAt(i * 0.01);
+        }
+        // Prevent the loop from being optimized away
+        _sum = sum;
+
+        return nEvaluations;
+    }
+
+private:
+
+    Curve _curve;
+    double _sum;
+};
+
+NATRON_REGISTER_BENCHMARK(CurveGetValueAtBenchmark)
+
+class Hash64Benchmark
+    : public Benchmark
+{
+public:
+
+    Hash64Benchmark()
+        : Benchmark("Hash64.append", "values")
+        , _hash(0)
+    {
+    }
+
+    virtual U64 run() OVERRIDE FINAL
+    {
+        const int nValues = 1000000;
+        Hash64 hash;
+
+        for (int i = 0; i < nValues; ++i) {
+            hash.append<U64>( (U64)i * 2654435761ULL );
+        }
+        hash.computeHash();
+        _hash = hash.value();
+
+        return nValues;
+    }
+
+private:
+
+    U64 _hash;
+};
+
+NATRON_REGISTER_BENCHMARK(Hash64Benchmark)
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+NATRON_NAMESPACE_EXIT
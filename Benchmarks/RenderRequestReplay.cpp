@@ -0,0 +1,86 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <QtCore/QFileInfo>
+#include <QtCore/QString>
+
+#include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/Project.h"
+#include "Engine/RenderRequestRecorder.h"
+
+#include "Benchmark.h"
+
+NATRON_NAMESPACE_ENTER
+
+int
+replayRenderRequests(const std::string& logFilePath)
+{
+    std::string projectFilePath;
+    std::vector<RenderRequestEvent> events;
+
+    if ( !RenderRequestRecorder::read(logFilePath, &projectFilePath, &events) ) {
+        printf("Failed to read the render request log %s\n", logFilePath.c_str());
+
+        return 1;
+    }
+
+    AppInstancePtr app = appPTR->getTopLevelInstance();
+    QFileInfo projectFile( QString::fromUtf8( projectFilePath.c_str() ) );
+    if ( !app || !app->getProject()->loadProject( projectFile.absolutePath(), projectFile.fileName() ) ) {
+        printf("Failed to load the project %s\n", projectFilePath.c_str());
+
+        return 1;
+    }
+
+    std::vector<RenderRequestReplayResult> results;
+    RenderRequestRecorder::replay(app, events, &results);
+
+    int nRenders = 0;
+    double totalLatency = 0.;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        if (results[i].latency < 0) {
+            continue;
+        }
+        printf( "%12lldus %-32s %10.3fms\n", (long long)results[i].event.timestamp, results[i].event.node.c_str(), results[i].latency * 1000. );
+        ++nRenders;
+        totalLatency += results[i].latency;
+    }
+    if (nRenders > 0) {
+        printf("%d renders, average latency %.3fms\n", nRenders, totalLatency * 1000. / nRenders);
+    }
+
+    app->getProject()->clearNodesBlocking();
+
+    return 0;
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,77 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdio>
+#include <string>
+
+#include "Engine/AppManager.h"
+#include "Engine/CLArgs.h"
+
+#include "Benchmark.h"
+
+NATRON_NAMESPACE_USING
+
+// Usage: NatronBenchmarks [filter]
+//        NatronBenchmarks --replay-render-requests <log>
+// Only the benchmarks whose name contains filter are run, e.g: "NatronBenchmarks Image."
+// With --replay-render-requests, no benchmark is run: the log written with NATRON_RENDER_REQUEST_LOG_FILE is replayed instead.
+int
+main(int argc,
+     char **argv)
+{
+    AppManager manager;
+
+    {
+        int nArgs = 0;
+        QStringList args;
+        args << QString::fromUtf8("--clear-cache");
+        args << QString::fromUtf8("--no-settings");
+        CLArgs cl(args, true);
+        if (!manager.load(nArgs, 0, cl)) {
+            printf("Failed to load AppManager\n");
+
+            return 1;
+        }
+    }
+
+    std::string filter;
+    if (argc > 1) {
+        filter = argv[1];
+    }
+    if (filter == "--replay-render-requests") {
+        if (argc < 3) {
+            printf("Usage: NatronBenchmarks --replay-render-requests <log>\n");
+
+            return 1;
+        }
+
+        return replayRenderRequests(argv[2]);
+    }
+
+    return runBenchmarks(filter);
+}
@@ -47,6 +47,10 @@
 // waste resources.
 #define NATRON_ABORT_TIMEOUT_MS 5000
 
+// Size of a cache line: the abort flag is kept alone on its own so that the render threads polling it
+// do not share it with the members written by registerThreadForRender
+#define NATRON_ABORT_FLAG_CACHE_LINE_SIZE 64
+
 NATRON_NAMESPACE_ENTER
 
 typedef std::set<AbortableThread*> ThreadSet;
@@ -55,7 +59,9 @@ struct AbortableRenderInfoPrivate
 {
     AbortableRenderInfo* _p;
     bool canAbort;
+    char abortedPaddingBefore[NATRON_ABORT_FLAG_CACHE_LINE_SIZE];
     QAtomicInt aborted;
+    char abortedPaddingAfter[NATRON_ABORT_FLAG_CACHE_LINE_SIZE];
     U64 age;
     mutable QMutex threadsMutex;
     ThreadSet threadsForThisRender;
@@ -69,7 +75,9 @@ struct AbortableRenderInfoPrivate
                                U64 age)
         : _p(p)
         , canAbort(canAbort)
+        , abortedPaddingBefore()
         , aborted()
+        , abortedPaddingAfter()
         , age(age)
         , threadsMutex()
         , threadsForThisRender()
@@ -25,8 +25,10 @@
 
 #include "AppInstance.h"
 
+#include <algorithm> // min
 #include <fstream>
 #include <list>
+#include <set>
 #include <cassert>
 #include <stdexcept>
 #include <sstream> // stringstream
@@ -140,6 +142,9 @@ struct RenderQueueItem
     QString sequenceName;
     QString savePath;
     ProcessHandlerPtr process;
+
+    // Other writers rendered along with work.writer, see OutputEffectInstance::setSharedPassOutputs()
+    std::list<OutputEffectInstancePtr> sharedOutputs;
 };
 
 struct AppInstancePrivate
@@ -163,6 +168,9 @@ public:
 
     //When a node tree is created
     int _creatingTree;
+
+    //Number of batch edits opened by beginBatchEdit() and not closed yet (main thread only)
+    int batchEditCount;
     mutable QMutex renderQueueMutex;
     std::list<RenderQueueItem> renderQueue, activeRenders;
     mutable QMutex invalidExprKnobsMutex;
@@ -170,6 +178,12 @@ public:
 
     ProjectBeingLoadedInfo projectBeingLoaded;
 
+    // The number of processes the frame range of each writer is split across in background mode (see --chunks)
+    int renderChunks;
+    int chunkRendersRunning;
+    int chunkRendersFailed;
+    QEventLoop* chunkRendersLoop;
+
     AppInstancePrivate(int appID,
                        AppInstance* app)
 
@@ -182,12 +196,17 @@ public:
         , _creatingInternalNode(false)
         , _creatingNodeQueue()
         , _creatingTree(0)
+        , batchEditCount(0)
         , renderQueueMutex()
         , renderQueue()
         , activeRenders()
         , invalidExprKnobsMutex()
         , invalidExprKnobs()
         , projectBeingLoaded()
+        , renderChunks(1)
+        , chunkRendersRunning(0)
+        , chunkRendersFailed(0)
+        , chunkRendersLoop(0)
     {
     }
 
@@ -203,7 +222,11 @@ public:
 
     void getSequenceNameFromWriter(const OutputEffectInstance* writer, QString* sequenceName);
 
+    void groupWritersSharingUpstream(std::list<RenderQueueItem>* items);
+
     void startRenderingFullSequence(bool blocking, const RenderQueueItem& writerWork);
+
+    void renderInChunks(const std::list<RenderQueueItem>& items);
 };
 
 AppInstance::AppInstance(int appID)
@@ -247,6 +270,42 @@ AppInstance::isCreatingNodeTree() const
     return _imp->_creatingTree;
 }
 
+void
+AppInstance::beginBatchEdit()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    ++_imp->batchEditCount;
+    setIsCreatingNodeTree(true);
+}
+
+void
+AppInstance::endBatchEdit()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    if (_imp->batchEditCount <= 0) {
+        return;
+    }
+    --_imp->batchEditCount;
+    setIsCreatingNodeTree(false);
+    if (_imp->batchEditCount > 0) {
+        return;
+    }
+
+    // nothing refreshed the nodes created or connected during the batch, do it once for all of them
+    getProject()->forceComputeInputDependentDataOnAllTrees();
+    renderAllViewers(true);
+}
+
+bool
+AppInstance::isInBatchEdit() const
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    return _imp->batchEditCount > 0;
+}
+
 void
 AppInstance::setIsCreatingNodeTree(bool b)
 {
@@ -659,6 +718,8 @@ AppInstance::loadInternal(const CLArgs& cl,
             }
         }
 
+        _imp->renderChunks = cl.getRenderChunksCount();
+
         ///launch renders
         if ( !writersWork.empty() ) {
             startWritersRendering(false, writersWork);
@@ -907,6 +968,8 @@ AppInstance::createNodeFromPythonModule(Plugin* plugin,
 
         int appID = getAppID() + 1;
         std::stringstream ss;
+        // The module may not have been imported yet if the PyPlug was registered from the PyPlugs cache
+        ss << "import " << moduleName.toStdString() << '\n';
         ss << moduleName.toStdString();
         ss << ".createInstance(app" << appID;
         if (istoolsetScript) {
@@ -1788,7 +1851,24 @@ AppInstance::startWritersRendering(bool doBlockingRender,
         }
         _imp->getSequenceNameFromWriter(it->writer, &item.sequenceName);
         item.savePath = savePath;
+        itemsToQueue.push_back(item);
+    }
+    if ( itemsToQueue.empty() ) {
+        return;
+    }
+
+    if ( (_imp->renderChunks > 1) && appPTR->isBackground() ) {
+        _imp->renderInChunks(itemsToQueue);
+
+        return;
+    }
 
+    if ( !renderInSeparateProcess && appPTR->getCurrentSettings()->isRenderPassSharingEnabled() ) {
+        _imp->groupWritersSharingUpstream(&itemsToQueue);
+    }
+
+    for (std::list<RenderQueueItem>::iterator it = itemsToQueue.begin(); it != itemsToQueue.end(); ++it) {
+        RenderQueueItem& item = *it;
         if (renderInSeparateProcess) {
             item.process = boost::make_shared<ProcessHandler>(savePath, item.work.writer);
             QObject::connect( item.process.get(), SIGNAL(processFinished(int)), this, SLOT(onBackgroundRenderProcessFinished()) );
@@ -1798,15 +1878,17 @@ AppInstance::startWritersRendering(bool doBlockingRender,
 
         bool canPause = !item.work.writer->isVideoWriter();
 
-        if (!it->isRestart) {
+        if (!item.work.isRestart) {
             notifyRenderStarted(item.sequenceName, item.work.firstFrame, item.work.lastFrame, item.work.frameStep, canPause, item.work.writer, item.process);
+            // Writers sharing the render pass of this one keep their own progress entry
+            for (std::list<OutputEffectInstancePtr>::const_iterator itShared = item.sharedOutputs.begin(); itShared != item.sharedOutputs.end(); ++itShared) {
+                QString sharedSequenceName;
+                _imp->getSequenceNameFromWriter(itShared->get(), &sharedSequenceName);
+                notifyRenderStarted(sharedSequenceName, item.work.firstFrame, item.work.lastFrame, item.work.frameStep, canPause, itShared->get(), item.process);
+            }
         } else {
             notifyRenderRestarted(item.work.writer, item.process);
         }
-        itemsToQueue.push_back(item);
-    }
-    if ( itemsToQueue.empty() ) {
-        return;
     }
 
     if (appPTR->isBackground() || doBlockingRender) {
@@ -1864,6 +1946,83 @@ AppInstancePrivate::getSequenceNameFromWriter(const OutputEffectInstance* writer
     }
 }
 
+static void
+getUpstreamNodes(const NodePtr& node,
+                 std::set<NodePtr>* nodes)
+{
+    const std::vector<NodeWPtr>& inputs = node->getInputs();
+
+    for (std::vector<NodeWPtr>::const_iterator it = inputs.begin(); it != inputs.end(); ++it) {
+        NodePtr input = it->lock();
+        if ( input && nodes->insert(input).second ) {
+            getUpstreamNodes(input, nodes);
+        }
+    }
+}
+
+static bool
+haveCommonNode(const std::set<NodePtr>& a,
+               const std::set<NodePtr>& b)
+{
+    const std::set<NodePtr>& smallest = a.size() < b.size() ? a : b;
+    const std::set<NodePtr>& other = a.size() < b.size() ? b : a;
+
+    for (std::set<NodePtr>::const_iterator it = smallest.begin(); it != smallest.end(); ++it) {
+        if ( other.find(*it) != other.end() ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Merges the renders of writers with the same frame range that share nodes upstream into a single render of the
+ * first of them, see OutputEffectInstance::setSharedPassOutputs().
+ * Movie writers need their frames in order and restarted renders resume from their own frame: they are left alone.
+ * The views to render are chosen per writer when its render starts, so renders are only merged in single view projects.
+ **/
+void
+AppInstancePrivate::groupWritersSharingUpstream(std::list<RenderQueueItem>* items)
+{
+    if ( (items->size() < 2) || (_currentProject->getProjectViewsCount() > 1) ) {
+        return;
+    }
+
+    std::list<RenderQueueItem> grouped;
+    std::list<std::set<NodePtr> > groupedUpstream;
+    for (std::list<RenderQueueItem>::const_iterator it = items->begin(); it != items->end(); ++it) {
+        std::set<NodePtr> upstream;
+        if ( !it->work.isRestart && !it->work.writer->isVideoWriter() ) {
+            getUpstreamNodes(it->work.writer->getNode(), &upstream);
+        }
+
+        bool merged = false;
+        if ( !upstream.empty() ) {
+            std::list<std::set<NodePtr> >::iterator itUpstream = groupedUpstream.begin();
+            for (std::list<RenderQueueItem>::iterator itGroup = grouped.begin(); itGroup != grouped.end(); ++itGroup, ++itUpstream) {
+                const AppInstance::RenderWork& groupWork = itGroup->work;
+                if ( (groupWork.firstFrame != it->work.firstFrame) || (groupWork.lastFrame != it->work.lastFrame) ||
+                     (groupWork.frameStep != it->work.frameStep) || (groupWork.useRenderStats != it->work.useRenderStats) ||
+                     !haveCommonNode(*itUpstream, upstream) ) {
+                    continue;
+                }
+                OutputEffectInstancePtr writer = boost::dynamic_pointer_cast<OutputEffectInstance>( it->work.writer->shared_from_this() );
+                assert(writer);
+                itGroup->sharedOutputs.push_back(writer);
+                itUpstream->insert( upstream.begin(), upstream.end() );
+                merged = true;
+                break;
+            }
+        }
+        if (!merged) {
+            grouped.push_back(*it);
+            groupedUpstream.push_back(upstream);
+        }
+    }
+    items->swap(grouped);
+} // AppInstancePrivate::groupWritersSharingUpstream
+
 bool
 AppInstancePrivate::validateRenderOptions(const AppInstance::RenderWork& w,
                                           int* firstFrame,
@@ -1905,6 +2064,10 @@ void
 AppInstancePrivate::startRenderingFullSequence(bool blocking,
                                                const RenderQueueItem& w)
 {
+    if (!w.process) {
+        w.work.writer->setSharedPassOutputs(w.sharedOutputs);
+    }
+
     if (blocking) {
         BlockingBackgroundRender backgroundRender(w.work.writer);
         backgroundRender.blockingRender(w.work.useRenderStats, w.work.firstFrame, w.work.lastFrame, w.work.frameStep); //< doesn't return before rendering is finished
@@ -1925,6 +2088,70 @@ AppInstancePrivate::startRenderingFullSequence(bool blocking,
     }
 }
 
+/**
+ * @brief Splits the frame range of each writer in renderChunks parts and renders each of them in a separate background
+ * process, returning once they are all finished. The processes only share the disk cache.
+ **/
+void
+AppInstancePrivate::renderInChunks(const std::list<RenderQueueItem>& items)
+{
+    // The processes load the project as it is now, i.e: with the readers and writers set from the command-line
+    QString savePath;
+    _currentProject->saveProject_imp(QString(), QString::fromUtf8("RENDER_SAVE.ntp"), true, false, &savePath);
+
+    std::list<ProcessHandlerPtr> processes;
+    for (std::list<RenderQueueItem>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        const AppInstance::RenderWork& work = it->work;
+        const int nFrames = (work.lastFrame - work.firstFrame) / work.frameStep + 1;
+        // A movie file cannot be written by several processes
+        const int nChunks = work.writer->isVideoWriter() ? 1 : std::min(renderChunks, nFrames);
+        const int chunkFrames = (nFrames + nChunks - 1) / nChunks;
+        for (int first = 0; first < nFrames; first += chunkFrames) {
+            const int last = std::min(nFrames, first + chunkFrames) - 1;
+            ProcessHandlerPtr process = boost::make_shared<ProcessHandler>(savePath, work.writer,
+                                                                           work.firstFrame + first * work.frameStep,
+                                                                           work.firstFrame + last * work.frameStep,
+                                                                           work.frameStep);
+            QObject::connect( process.get(), SIGNAL(processFinished(int)), _publicInterface, SLOT(onChunkRenderProcessFinished(int)) );
+            processes.push_back(process);
+        }
+    }
+    if ( processes.empty() ) {
+        return;
+    }
+
+    QEventLoop loop;
+    chunkRendersLoop = &loop;
+    chunkRendersRunning = (int)processes.size();
+    chunkRendersFailed = 0;
+    for (std::list<ProcessHandlerPtr>::const_iterator it = processes.begin(); it != processes.end(); ++it) {
+        (*it)->startProcess();
+    }
+    loop.exec();
+    chunkRendersLoop = 0;
+
+    if (chunkRendersFailed > 0) {
+        throw std::runtime_error( tr("%1 of the %2 render processes failed.").arg(chunkRendersFailed).arg( processes.size() ).toStdString() );
+    }
+} // AppInstancePrivate::renderInChunks
+
+void
+AppInstance::onChunkRenderProcessFinished(int retCode)
+{
+    ProcessHandler* proc = qobject_cast<ProcessHandler*>( sender() );
+
+    if (retCode != 0) {
+        ++_imp->chunkRendersFailed;
+        if (proc) {
+            std::cerr << proc->getProcessLog().toStdString() << std::endl;
+        }
+    }
+    --_imp->chunkRendersRunning;
+    if ( (_imp->chunkRendersRunning <= 0) && _imp->chunkRendersLoop ) {
+        _imp->chunkRendersLoop->quit();
+    }
+}
+
 void
 AppInstance::onQueuedRenderFinished(int /*retCode*/)
 {
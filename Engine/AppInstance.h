@@ -331,6 +331,17 @@ public:
 
     void setIsCreatingNodeTree(bool b);
 
+    /**
+     * @brief Brackets a series of graph edits, typically a script creating and connecting many nodes.
+     * Until the matching endBatchEdit(), the nodes behave as while loading a project: they do not
+     * refresh their hash and input-dependent data nor trigger renders at each creation or connection.
+     * The last endBatchEdit() refreshes the whole project once and re-renders the viewers.
+     * Batches may be nested. Must be called on the main thread.
+     **/
+    void beginBatchEdit();
+    void endBatchEdit();
+    bool isInBatchEdit() const;
+
     virtual void appendToScriptEditor(const std::string& str);
     virtual void printAutoDeclaredVariable(const std::string& str);
 
@@ -444,6 +455,8 @@ public Q_SLOTS:
 
     void onQueuedRenderFinished(int retCode);
 
+    void onChunkRenderProcessFinished(int retCode);
+
 Q_SIGNALS:
 
     void pluginsPopulated();
@@ -50,10 +50,12 @@
 #include <csignal>
 #include <cstddef>
 #include <cassert>
+#include <set>
 #include <stdexcept>
 #include <cstring> // for std::memcpy
 #include <sstream> // stringstream
 #include <locale>
+#include <map>
 
 #include <QtCore/QtGlobal> // for Q_OS_*
 #if defined(Q_OS_LINUX)
@@ -84,6 +86,7 @@
 #include <ceres/version.h>
 #include <openMVG/version.hpp>
 
+#include <QtCore/QDataStream>
 #include <QtCore/QDateTime>
 #include <QtCore/QDebug>
 #include <QtCore/QDir>
@@ -114,10 +117,12 @@
 #include "Engine/GroupInput.h"
 #include "Engine/GroupOutput.h"
 #include "Engine/JoinViewsNode.h"
+#include "Engine/ImageBufferPool.h"
 #include "Engine/LibraryBinary.h"
 #include "Engine/Log.h"
 #include "Engine/MemoryInfo.h" // getSystemTotalRAM, printAsRAM
 #include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
 #include "Engine/OfxImageEffectInstance.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/OfxHost.h"
@@ -127,6 +132,9 @@
 #include "Engine/Project.h"
 #include "Engine/PrecompNode.h"
 #include "Engine/ReadNode.h"
+#include "Engine/ReaderProbeCache.h"
+#include "Engine/RenderRequestRecorder.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoSmear.h"
 #include "Engine/StandardPaths.h"
@@ -385,6 +393,44 @@ AppManager::saveCaches() const
     _imp->saveCaches();
 }
 
+int
+AppManager::exportCacheBundle(const std::string& bundlePath,
+                              const NodesList& nodes,
+                              double firstFrame,
+                              double lastFrame) const
+{
+    // Gather the cache IDs of the nodes, of their inputs and of the nodes inside groups, recursively
+    std::set<std::string> holderIDs;
+    std::set<NodePtr> visited;
+    NodesList toVisit = nodes;
+
+    while ( !toVisit.empty() ) {
+        NodePtr node = toVisit.front();
+        toVisit.pop_front();
+        if ( !node || !visited.insert(node).second ) {
+            continue;
+        }
+        holderIDs.insert( node->getCacheID() );
+        int nInputs = node->getNInputs();
+        for (int i = 0; i < nInputs; ++i) {
+            toVisit.push_back( node->getInput(i) );
+        }
+        NodeGroup* isGroup = node->isEffectGroup();
+        if (isGroup) {
+            NodesList children = isGroup->getNodes();
+            toVisit.insert( toVisit.end(), children.begin(), children.end() );
+        }
+    }
+
+    return _imp->exportCacheBundle(bundlePath, holderIDs, firstFrame, lastFrame);
+}
+
+int
+AppManager::importCacheBundle(const std::string& bundlePath)
+{
+    return _imp->importCacheBundle(bundlePath);
+}
+
 int
 AppManager::getHardwareIdealThreadCount()
 {
@@ -557,6 +603,30 @@ AppManager::~AppManager()
     }
 #endif
 
+    if (_imp->cacheMemoryWatcher) {
+        _imp->cacheMemoryWatcher->quitThread();
+    }
+
+    if ( RenderTrace::isEnabled() ) {
+        std::string traceFilePath = QString::fromUtf8( qgetenv(NATRON_RENDER_TRACE_FILE_ENV_VAR) ).toStdString();
+        RenderTrace::setEnabled(false);
+        if ( !RenderTrace::writeChromeTrace(traceFilePath) ) {
+            std::cerr << "Failed to write the render trace to " << traceFilePath << std::endl;
+        }
+    }
+
+    if ( RenderRequestRecorder::isEnabled() ) {
+        std::string logFilePath = QString::fromUtf8( qgetenv(NATRON_RENDER_REQUEST_LOG_FILE_ENV_VAR) ).toStdString();
+        RenderRequestRecorder::setEnabled(false);
+        if ( !RenderRequestRecorder::write(logFilePath) ) {
+            std::cerr << "Failed to write the render request log to " << logFilePath << std::endl;
+        }
+    }
+
+    if (_imp->ofxHost) {
+        _imp->ofxHost->saveThreadScalingHistories();
+    }
+
     bool appsEmpty;
     {
         QMutexLocker k(&_imp->_appInstancesMutex);
@@ -590,6 +660,7 @@ AppManager::~AppManager()
     } catch (std::runtime_error&) {
         // ignore errors
     }
+    ReaderProbeCache::save();
 
     ///Caches may have launched some threads to delete images, wait for them to be done
     QThreadPool::globalInstance()->waitForDone();
@@ -814,6 +885,13 @@ AppManager::loadInternal(const CLArgs& cl)
 
     //Set it once setApplicationName is set since it relies on it
     refreshDiskCacheLocation();
+    refreshSharedDiskCacheLocation();
+
+    // Record the render trace from startup, it is written on exit
+    RenderTrace::setEnabled( !qgetenv(NATRON_RENDER_TRACE_FILE_ENV_VAR).isEmpty() );
+
+    // Record the render requests of the loaded projects, the log is written on exit
+    RenderRequestRecorder::setEnabled( !qgetenv(NATRON_RENDER_REQUEST_LOG_FILE_ENV_VAR).isEmpty() );
 
     // Set the locale AGAIN, because Qt resets it in the QCoreApplication constructor and in Py_InitializeEx
     // see http://doc.qt.io/qt-4.8/qcoreapplication.html#locale-settings
@@ -1072,10 +1150,20 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
         U64 viewerCacheSize = _imp->_settings->getMaximumViewerDiskCacheSize();
         U64 maxDiskCacheNode = _imp->_settings->getMaximumDiskCacheNodeSize();
 
-        _imp->_nodeCache = boost::make_shared<Cache<Image> >("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1.);
-        _imp->_diskCache = boost::make_shared<Cache<Image> >("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0.);
-        _imp->_viewerCache = boost::make_shared<Cache<FrameEntry> >("ViewerCache", NATRON_CACHE_VERSION, viewerCacheSize, 0.);
+        // The caches are looked-up concurrently by all render threads: partition them so they do not contend on a single lock
+        unsigned int nShards = Cache<Image>::getDefaultShardsCount();
+
+        _imp->_nodeCache = boost::make_shared<Cache<Image> >("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1., nShards);
+        _imp->_nodeCache->setCompressionEnabled( _imp->_settings->isCacheCompressionEnabled() );
+        ImageBufferPool::setMaximumFreeSize(maxCacheRAM * NATRON_IMAGE_BUFFER_POOL_MAX_PERCENT);
+        _imp->_diskCache = boost::make_shared<Cache<Image> >("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0., nShards);
+        _imp->_viewerCache = boost::make_shared<Cache<FrameEntry> >("ViewerCache", NATRON_CACHE_VERSION, viewerCacheSize, 0., nShards);
         _imp->setViewerCacheTileSize();
+        _imp->setNodeCacheUserMaximumMemory(maxCacheRAM);
+
+        // Give memory back to the system when other applications need it
+        _imp->cacheMemoryWatcher.reset( new CacheMemoryWatcherThread( _imp.get() ) );
+        _imp->cacheMemoryWatcher->start(QThread::LowPriority);
     } catch (std::logic_error&) {
         // ignore
     }
@@ -1097,6 +1185,16 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
         setLoadingStatus( tr("Restoring the image cache...") );
         _imp->restoreCaches();
     }
+    if ( !cl.getImportCacheBundlePath().isEmpty() ) {
+        setLoadingStatus( tr("Importing the cache bundle...") );
+        int nImported = importCacheBundle( cl.getImportCacheBundlePath().toStdString() );
+        std::cout << tr("%1 cache entries imported from %2").arg(nImported).arg( cl.getImportCacheBundlePath() ).toStdString() << std::endl;
+    }
+
+    // Create the OpenGL contexts used for GPU rendering while plug-ins are loading
+    if (_imp->renderingContextPool) {
+        _imp->renderingContextPool->prewarmGLContextsInBackground();
+    }
 
     setLoadingStatus( tr("Loading plugin cache...") );
 
@@ -1208,15 +1306,7 @@ AppManagerPrivate::setViewerCacheTileSize()
     tileSize = tileSize * tileSize * 4;
 
 
-    ImageBitDepthEnum viewerDepth = _settings->getViewersBitDepth();
-    switch (viewerDepth) {
-        case eImageBitDepthFloat:
-        case eImageBitDepthHalf:
-            tileSize *= sizeof(float);
-            break;
-        default:
-            break;
-    }
+    tileSize *= getSizeOfForBitDepth( _settings->getViewersBitDepth() );
     _viewerCache->setTiled(true, tileSize);
 }
 
@@ -1490,13 +1580,32 @@ AppManager::writeToOutputPipe(const QString & longMessage,
     return true;
 }
 
+bool
+AppManager::writeFrameRenderedToOutputPipe(int frame,
+                                           double progress,
+                                           const QString & shortMessage)
+{
+    if (!_imp->_backgroundIPC) {
+        return false;
+    }
+    _imp->_backgroundIPC->writeFrameRenderedToOutputChannel(frame, progress, shortMessage);
+
+    return true;
+}
+
 void
 AppManager::setApplicationsCachesMaximumMemoryPercent(double p)
 {
     size_t maxCacheRAM = p * getSystemTotalRAM_conditionnally();
 
-    _imp->_nodeCache->setMaximumCacheSize(maxCacheRAM);
-    _imp->_nodeCache->setMaximumInMemorySize(1);
+    _imp->setNodeCacheUserMaximumMemory(maxCacheRAM);
+}
+
+void
+AppManager::setApplicationsCachesCompressionEnabled(bool enabled)
+{
+    // Only the RAM cache is compressed, the other caches are backed by files
+    _imp->_nodeCache->setCompressionEnabled(enabled);
 }
 
 void
@@ -1932,6 +2041,103 @@ AppManager::findAllScriptsRecursive(const QDir& directory,
     }
 }
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief What loadPythonGroups() learnt about a Python script the last time it was scanned, so that next launches
+ * do not have to read and import it again as long as it was not modified.
+ **/
+struct PyPlugCacheEntry
+{
+    qint64 lastModified;
+    qint64 size;
+    bool gotNatronGuiImport;
+    bool isPyPlug;
+    bool gotInfos;
+    QString pluginID, pluginLabel, iconFilePath, pluginGrouping, pluginDescription;
+    bool isToolset;
+    quint32 version;
+
+    PyPlugCacheEntry()
+        : lastModified(0)
+        , size(0)
+        , gotNatronGuiImport(false)
+        , isPyPlug(false)
+        , gotInfos(false)
+        , pluginID()
+        , pluginLabel()
+        , iconFilePath()
+        , pluginGrouping()
+        , pluginDescription()
+        , isToolset(false)
+        , version(0)
+    {
+    }
+};
+
+typedef std::map<QString, PyPlugCacheEntry> PyPlugCacheMap;
+
+// Bump whenever the layout of PyPlugCacheEntry changes
+#define NATRON_PYPLUG_CACHE_FORMAT_VERSION 1
+
+QString
+getPyPlugCacheFilePath()
+{
+    return appPTR->getDiskCacheLocation() + QString::fromUtf8("/PyPlugsCache_") +
+           QString::fromUtf8(NATRON_VERSION_STRING) + QString::fromUtf8("_") +
+           QString::fromUtf8(NATRON_DEVELOPMENT_STATUS) + QString::fromUtf8("_") +
+           QString::number(NATRON_BUILD_NUMBER) + QString::fromUtf8(".bin");
+}
+
+void
+readPyPlugCache(PyPlugCacheMap* cache)
+{
+    QFile file( getPyPlugCacheFilePath() );
+
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return;
+    }
+    QDataStream ds(&file);
+    qint32 formatVersion = 0;
+    quint32 nEntries = 0;
+    ds >> formatVersion >> nEntries;
+    if ( (ds.status() != QDataStream::Ok) || (formatVersion != NATRON_PYPLUG_CACHE_FORMAT_VERSION) ) {
+        return;
+    }
+    for (quint32 i = 0; i < nEntries; ++i) {
+        QString filePath;
+        PyPlugCacheEntry e;
+        ds >> filePath >> e.lastModified >> e.size >> e.gotNatronGuiImport >> e.isPyPlug >> e.gotInfos
+           >> e.pluginID >> e.pluginLabel >> e.iconFilePath >> e.pluginGrouping >> e.pluginDescription >> e.isToolset >> e.version;
+        if (ds.status() != QDataStream::Ok) {
+            // Truncated or corrupted file: do not trust anything in it
+            cache->clear();
+
+            return;
+        }
+        (*cache)[filePath] = e;
+    }
+}
+
+void
+writePyPlugCache(const PyPlugCacheMap& cache)
+{
+    QDir().mkpath( appPTR->getDiskCacheLocation() );
+    QFile file( getPyPlugCacheFilePath() );
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        return;
+    }
+    QDataStream ds(&file);
+    ds << (qint32)NATRON_PYPLUG_CACHE_FORMAT_VERSION << (quint32)cache.size();
+    for (PyPlugCacheMap::const_iterator it = cache.begin(); it != cache.end(); ++it) {
+        const PyPlugCacheEntry& e = it->second;
+        ds << it->first << e.lastModified << e.size << e.gotNatronGuiImport << e.isPyPlug << e.gotInfos
+           << e.pluginID << e.pluginLabel << e.iconFilePath << e.pluginGrouping << e.pluginDescription << e.isToolset << e.version;
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 void
 AppManager::loadPythonGroups()
 {
@@ -2054,6 +2260,13 @@ AppManager::loadPythonGroups()
 
     appPTR->setLoadingStatus( tr("Loading PyPlugs...") );
 
+    // Reading every script and importing it through getGroupInfos() is what makes startup slow when there are many
+    // PyPlugs: the results are cached on disk, keyed by the script path, modification time and size.
+    // The module itself is imported when the PyPlug is instantiated.
+    PyPlugCacheMap oldCache, newCache;
+    readPyPlugCache(&oldCache);
+    bool cacheChanged = false;
+
     Q_FOREACH(const QString &plugin, allPlugins) {
         QString moduleName = plugin;
         QString modulePath;
@@ -2068,64 +2281,91 @@ AppManager::loadPythonGroups()
             moduleName = moduleName.remove(0, lastSlash + 1);
         }
 
+        QFileInfo fileInfo(plugin);
+        // Scripts from the Qt resources do not have a meaningful modification time, never cache them
+        bool canCache = !plugin.startsWith( QString::fromUtf8(":/") );
+        PyPlugCacheEntry entry;
+        entry.lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+        entry.size = fileInfo.size();
+
+        PyPlugCacheMap::const_iterator found = canCache ? oldCache.find(plugin) : oldCache.end();
+        // A PyPlug scanned in background mode may not have been queried because it imports NatronGui
+        if ( (found != oldCache.end()) && (found->second.lastModified == entry.lastModified) && (found->second.size == entry.size) &&
+             ( !found->second.isPyPlug || found->second.gotInfos || appPTR->isBackground() ) ) {
+            entry = found->second;
+        } else {
+            cacheChanged = true;
 
-        {
             // Open the file and check for a line that imports NatronGui, if so do not attempt to load the script.
             QFile file(plugin);
             if (!file.open(QIODevice::ReadOnly)) {
                 continue;
             }
             QTextStream ts(&file);
-            bool gotNatronGuiImport = false;
-            bool isPyPlug = false;
             while (!ts.atEnd()) {
                 QString line = ts.readLine();
                 if (line.startsWith(QString::fromUtf8("import %1").arg(QLatin1String(NATRON_GUI_PYTHON_MODULE_NAME))) ||
                     line.startsWith(QString::fromUtf8("from %1 import").arg(QLatin1String(NATRON_GUI_PYTHON_MODULE_NAME)))) {
-                    gotNatronGuiImport = true;
+                    entry.gotNatronGuiImport = true;
                 }
                 // We have to find a way to tell PyPlugs from other python files.
                 // We could check if the file was created by Natron...
                 if (line.startsWith(QString::fromUtf8(NATRON_PYPLUG_GENERATED))) {
-                    isPyPlug = true;
+                    entry.isPyPlug = true;
                 }
                 // Or we could check if createInstance(app,group) is defined
                 if ( line.startsWith( QString::fromUtf8("def createInstance(") ) ) {
-                    isPyPlug = true;
+                    entry.isPyPlug = true;
                 }
                 // Or we could check if it implements getIsToolSet()
                 if ( line.startsWith( QString::fromUtf8("def getIsToolSet(") ) ) {
-                    isPyPlug = true;
+                    entry.isPyPlug = true;
                 }
                 // Or we could check for the magic line that is in the doc.
                 // See https://natron.readthedocs.io/en/master/devel/groups.html#creating-a-group-by-hand
                 // and https://natron.readthedocs.io/en/master/devel/groups.html#toolsets
                 if ( line.startsWith( QString::fromUtf8(NATRON_PYPLUG_MAGIC) ) ) {
-                    isPyPlug = true;
+                    entry.isPyPlug = true;
                 }
             }
-            if (appPTR->isBackground() && gotNatronGuiImport) {
-                continue;
-            }
-            if (!isPyPlug) {
-                continue;
+
+            if ( entry.isPyPlug && !(appPTR->isBackground() && entry.gotNatronGuiImport) ) {
+                std::string pluginLabel, pluginID, pluginGrouping, iconFilePath, pluginDescription;
+                unsigned int version = 0;
+                bool isToolset = false;
+                entry.gotInfos = NATRON_PYTHON_NAMESPACE::getGroupInfos(modulePath.toStdString(), moduleName.toStdString(), &pluginID, &pluginLabel, &iconFilePath, &pluginGrouping, &pluginDescription, &isToolset, &version);
+                if (entry.gotInfos) {
+                    entry.pluginID = QString::fromUtf8( pluginID.c_str() );
+                    entry.pluginLabel = QString::fromUtf8( pluginLabel.c_str() );
+                    entry.iconFilePath = QString::fromUtf8( iconFilePath.c_str() );
+                    entry.pluginGrouping = QString::fromUtf8( pluginGrouping.c_str() );
+                    entry.pluginDescription = QString::fromUtf8( pluginDescription.c_str() );
+                    entry.isToolset = isToolset;
+                    entry.version = version;
+                }
             }
+            // Scripts that failed to load are not cached so that they are retried on next launch
+            canCache &= ( !entry.isPyPlug || entry.gotInfos || (appPTR->isBackground() && entry.gotNatronGuiImport) );
         }
 
-        std::string pluginLabel, pluginID, pluginGrouping, iconFilePath, pluginDescription;
-        unsigned int version;
-        bool isToolset;
-        bool gotInfos = NATRON_PYTHON_NAMESPACE::getGroupInfos(modulePath.toStdString(), moduleName.toStdString(), &pluginID, &pluginLabel, &iconFilePath, &pluginGrouping, &pluginDescription, &isToolset, &version);
+        if (canCache) {
+            newCache[plugin] = entry;
+        }
 
+        if ( (appPTR->isBackground() && entry.gotNatronGuiImport) || !entry.isPyPlug || !entry.gotInfos ) {
+            continue;
+        }
 
-        if (gotInfos) {
-            qDebug() << "Loading " << moduleName;
-            QStringList grouping = QString::fromUtf8( pluginGrouping.c_str() ).split( QChar::fromLatin1('/') );
-            Plugin* p = registerPlugin(modulePath, grouping, QString::fromUtf8( pluginID.c_str() ), QString::fromUtf8( pluginLabel.c_str() ), QString::fromUtf8( iconFilePath.c_str() ), QStringList(), false, false, 0, false, version, 0, false);
+        qDebug() << "Loading " << moduleName;
+        QStringList grouping = entry.pluginGrouping.split( QChar::fromLatin1('/') );
+        Plugin* p = registerPlugin(modulePath, grouping, entry.pluginID, entry.pluginLabel, entry.iconFilePath, QStringList(), false, false, 0, false, entry.version, 0, false);
 
-            p->setPythonModule(modulePath + moduleName);
-            p->setToolsetScript(isToolset);
-        }
+        p->setPythonModule(modulePath + moduleName);
+        p->setToolsetScript(entry.isToolset);
+    }
+
+    if ( cacheChanged || (newCache.size() != oldCache.size()) ) {
+        writePyPlugCache(newCache);
     }
 } // AppManager::loadPythonGroups
 
@@ -2448,12 +2688,16 @@ AppManager::removeFromViewerCache(U64 hash)
 void
 AppManager::getMemoryStatsForCacheEntryHolder(const CacheEntryHolder* holder,
                                               std::size_t* ramOccupied,
-                                              std::size_t* diskOccupied) const
+                                              std::size_t* diskOccupied,
+                                              ImageBufferPool::Stats* poolStats) const
 {
     assert(holder);
 
     *ramOccupied = 0;
     *diskOccupied = 0;
+    if (poolStats) {
+        ImageBufferPool::getStats(poolStats);
+    }
 
     std::size_t viewerCacheMem = 0;
     std::size_t viewerCacheDisk = 0;
@@ -2505,6 +2749,15 @@ AppManager::removeAllCacheEntriesForHolder(const CacheEntryHolder* holder,
     _imp->_viewerCache->removeAllEntriesForHolderPublic(holder, blocking);
 }
 
+void
+AppManager::setCacheEntriesPinnedForHolder(const CacheEntryHolder* holder,
+                                           bool pinned)
+{
+    _imp->_nodeCache->setHolderPinned(holder, pinned);
+    _imp->_diskCache->setHolderPinned(holder, pinned);
+    _imp->_viewerCache->setHolderPinned(holder, pinned);
+}
+
 const QString &
 AppManager::getApplicationBinaryPath() const
 {
@@ -2658,6 +2911,31 @@ AppManager::getDiskCacheLocation() const
     return _imp->diskCachesLocation;
 }
 
+void
+AppManager::refreshSharedDiskCacheLocation()
+{
+    QMutexLocker k(&_imp->diskCachesLocationMutex);
+    QString path = QString::fromUtf8(qgetenv(NATRON_SHARED_DISK_CACHE_PATH_ENV_VAR));
+    if ( !path.isEmpty() ) {
+        QDir d(path);
+        // create the full path if the directory does not exist
+        if ( d.exists() || d.mkpath(path) ) {
+            _imp->sharedDiskCachesLocation = path;
+            return;
+        }
+    }
+    // No default location: the shared tier is disabled
+    _imp->sharedDiskCachesLocation.clear();
+}
+
+QString
+AppManager::getSharedDiskCacheLocation() const
+{
+    QMutexLocker k(&_imp->diskCachesLocationMutex);
+
+    return _imp->sharedDiskCachesLocation;
+}
+
 bool
 AppManager::isNCacheFilesOpenedCapped() const
 {
@@ -2886,6 +3164,25 @@ AppManager::isNodeCacheAlmostFull() const
     }
 }
 
+bool
+AppManager::isViewerCacheAlmostFull() const
+{
+    std::size_t viewerCacheSize = _imp->_viewerCache->getMemoryCacheSize() + _imp->_viewerCache->getDiskCacheSize();
+    std::size_t viewerMaxCacheSize = _imp->_viewerCache->getMaximumSize();
+
+    if (viewerMaxCacheSize == 0) {
+        return true;
+    }
+
+    return (double)viewerCacheSize / viewerMaxCacheSize >= NATRON_CACHE_LIMIT_PERCENT;
+}
+
+bool
+AppManager::hasViewerCacheEntriesOnDisk() const
+{
+    return _imp->_viewerCache->getDiskCacheSize() > 0;
+}
+
 void
 AppManager::checkCacheFreeMemoryIsGoodEnough()
 {
@@ -2893,6 +3190,12 @@ AppManager::checkCacheFreeMemoryIsGoodEnough()
     size_t systemRAMToKeepFree = getSystemTotalRAM() * appPTR->getCurrentSettings()->getUnreachableRamPercent();
     size_t totalFreeRAM = getAmountFreePhysicalRAM();
 
+    if (totalFreeRAM <= systemRAMToKeepFree) {
+        // The buffers kept for reuse come first
+        ImageBufferPool::purge();
+        totalFreeRAM = getAmountFreePhysicalRAM();
+    }
+
     while (totalFreeRAM <= systemRAMToKeepFree) {
 #ifdef NATRON_DEBUG_CACHE
         qDebug() << "Total system free RAM is below the threshold:" << printAsRAM(totalFreeRAM)
@@ -2901,6 +3204,8 @@ AppManager::checkCacheFreeMemoryIsGoodEnough()
         if ( !_imp->_nodeCache->evictLRUInMemoryEntry() ) {
             break;
         }
+        // Do not let the pool keep the memory that was just released
+        ImageBufferPool::purge();
 
 
         totalFreeRAM = getAmountFreePhysicalRAM();
@@ -3368,6 +3673,24 @@ AppManager::initPython()
         throw std::runtime_error( tr("Error while loading python module %1: %2").arg( QString::fromUtf8( modulename.c_str() ) ).arg( QString::fromUtf8( err.c_str() ) ).toStdString() );
     }
 
+    // with app.batchEdit(): wraps App.beginBatchEdit()/App.endBatchEdit(), even if the block raises
+    std::string batchEditScript(
+        "class _AppBatchEdit(object):\n"
+        "   def __init__(self, app):\n"
+        "       self.app = app\n"
+        "   def __enter__(self):\n"
+        "       self.app.beginBatchEdit()\n"
+        "       return self.app\n"
+        "   def __exit__(self, excType, excValue, traceback):\n"
+        "       self.app.endBatchEdit()\n"
+        "       return False\n"
+        + modulename + ".App.batchEdit = lambda self: _AppBatchEdit(self)\n");
+    ok = NATRON_PYTHON_NAMESPACE::interpretPythonScript(batchEditScript, &err, 0);
+    assert(ok);
+    if (!ok) {
+        throw std::runtime_error( tr("Error while loading python module %1: %2").arg( QString::fromUtf8( modulename.c_str() ) ).arg( QString::fromUtf8( err.c_str() ) ).toStdString() );
+    }
+
     if ( !isBackground() ) {
         modulename = NATRON_GUI_PYTHON_MODULE_NAME;
         ok = NATRON_PYTHON_NAMESPACE::interpretPythonScript("import sys\nimport " + modulename, &err, 0);
@@ -4261,6 +4584,38 @@ PythonGILLocker::~PythonGILLocker()
     PyGILState_Release(state);
 }
 
+static bool
+isPythonGILHeldByCurrentThread()
+{
+#if PY_VERSION_HEX >= 0x030400F0
+    return PyGILState_Check();
+#else
+    PyThreadState* tstate = PyGILState_GetThisThreadState();
+
+    return tstate && tstate == _PyThreadState_Current;
+#endif
+}
+
+PythonGILUnlocker::PythonGILUnlocker()
+    : state(0)
+{
+#ifndef USE_NATRON_GIL
+    if ( Py_IsInitialized() && isPythonGILHeldByCurrentThread() ) {
+        state = PyEval_SaveThread();
+    }
+#else
+    // The Natron GIL is recursive and may be held several times by this thread: it cannot be released here, and
+    // releasing the Python GIL alone would let other threads take it and then block on the Natron GIL.
+#endif
+}
+
+PythonGILUnlocker::~PythonGILUnlocker()
+{
+    if (state) {
+        PyEval_RestoreThread(state);
+    }
+}
+
 static bool
 getGroupInfosInternal(const std::string& modulePath,
                       const std::string& pythonModule,
@@ -53,6 +53,7 @@ CLANG_DIAG_ON(deprecated)
 #include "Engine/AfterQuitProcessingI.h"
 #include "Engine/Plugin.h"
 #include "Engine/KnobFactory.h"
+#include "Engine/ImageBufferPool.h"
 #include "Engine/ImageLocker.h"
 #include "Engine/LogEntry.h"
 #include "Engine/EngineFwd.h"
@@ -226,6 +227,8 @@ public:
 
     void setApplicationsCachesMaximumMemoryPercent(double p);
 
+    void setApplicationsCachesCompressionEnabled(bool enabled);
+
     void setApplicationsCachesMaximumViewerDiskSpace(unsigned long long size);
 
     void setApplicationsCachesMaximumDiskSpace(unsigned long long size);
@@ -245,6 +248,11 @@ public:
 
     void removeAllCacheEntriesForHolder(const CacheEntryHolder* holder, bool blocking);
 
+    /**
+     * @brief Pins or unpins the entries of the holder in all caches, see Cache::setHolderPinned
+     **/
+    void setCacheEntriesPinnedForHolder(const CacheEntryHolder* holder, bool pinned);
+
     SettingsPtr getCurrentSettings() const WARN_UNUSED_RETURN;
     const KnobFactory & getKnobFactory() const WARN_UNUSED_RETURN;
 
@@ -274,6 +282,12 @@ public:
      **/
     bool writeToOutputPipe(const QString & longMessage, const QString & shortMessage, bool printIfNoChannel);
 
+    /**
+     * @brief Same as writeToOutputPipe() for the report of a rendered frame, which goes through the progress
+     * ring buffer shared with the main process when possible (see ProcessHandler).
+     **/
+    bool writeFrameRenderedToOutputPipe(int frame, double progress, const QString & shortMessage);
+
     /**
      * @brief Abort any processing on all AppInstance. It is called in some very rare cases
      * such as when changing the number of threads used by the application or when a background render
@@ -455,13 +469,41 @@ public:
 
     bool isNodeCacheAlmostFull() const;
 
+    bool isViewerCacheAlmostFull() const;
+
+    /**
+     * @brief Returns true if some entries of the viewer cache were written to disk and are not mapped in RAM
+     **/
+    bool hasViewerCacheEntriesOnDisk() const;
+
     bool isAggressiveCachingEnabled() const;
 
     void refreshDiskCacheLocation();
     const QString& getDiskCacheLocation() const;
 
+    /**
+     * @brief The shared disk cache is a second, larger tier of the disk caches, typically on a network file system,
+     * where entries evicted from the local disk cache go and where they are looked up when missing locally.
+     * Returns an empty string if it is disabled.
+     **/
+    void refreshSharedDiskCacheLocation();
+    QString getSharedDiskCacheLocation() const;
+
     void saveCaches() const;
 
+    /**
+     * @brief Writes the cached images computed by the given nodes and all their inputs for the frames in [firstFrame, lastFrame]
+     * to a bundle folder, which can be copied to another computer and imported with importCacheBundle(). Only the images
+     * stored on disk (e.g by DiskCache nodes) are exported. Returns the number of exported images.
+     **/
+    int exportCacheBundle(const std::string& bundlePath, const NodesList& nodes, double firstFrame, double lastFrame) const;
+
+    /**
+     * @brief Inserts in the caches the images of a bundle written by exportCacheBundle(), except those already cached.
+     * Returns the number of imported images.
+     **/
+    int importCacheBundle(const std::string& bundlePath);
+
     PyObject* getMainModule();
 
     QStringList getAllNonOFXPluginsPaths() const;
@@ -489,9 +531,14 @@ public:
     static QString qt_tildeExpansion(const QString &path, bool *expanded = 0);
 #endif
 
+    /**
+     * @brief Returns the memory used by the cache entries of the holder. The pool statistics, if requested,
+     * are those of all the image buffers since the pool is shared by all the holders.
+     **/
     void getMemoryStatsForCacheEntryHolder(const CacheEntryHolder* holder,
                                            std::size_t* ramOccupied,
-                                           std::size_t* diskOccupied) const;
+                                           std::size_t* diskOccupied,
+                                           ImageBufferPool::Stats* poolStats = 0) const;
 
     void setOFXHostHandle(void* handle);
 
@@ -823,6 +870,22 @@ public:
     ~PythonGILLocker();
 };
 
+/**
+ * @brief Small helper class to use as RAII in the Python bindings to release the GIL around long-running engine work
+ * (renders, project loading and saving, tracking...), so that render threads evaluating expressions and other
+ * Python threads can run meanwhile. Engine code calling back into Python takes the GIL again with a PythonGILLocker.
+ * This does nothing if the calling thread does not hold the GIL.
+ **/
+class PythonGILUnlocker
+{
+    PyThreadState* state;
+
+public:
+    PythonGILUnlocker();
+
+    ~PythonGILUnlocker();
+};
+
 NATRON_NAMESPACE_EXIT
 
 
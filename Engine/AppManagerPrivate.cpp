@@ -33,6 +33,7 @@
 #include <sys/syslimits.h> // OPEN_MAX
 #endif
 #endif
+#include <algorithm> // min, max
 #include <cstddef>
 #include <cstdlib>
 #include <cassert>
@@ -66,11 +67,14 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/Format.h"
 #include "Engine/FrameEntry.h"
 #include "Engine/Image.h"
+#include "Engine/ImageBufferPool.h"
+#include "Engine/MemoryInfo.h"
 #include "Engine/OfxHost.h"
 #include "Engine/OSGLContext.h"
 #include "Engine/ProcessHandler.h" // ProcessInputChannel
 #include "Engine/RectDSerialization.h"
 #include "Engine/RectISerialization.h"
+#include "Engine/Settings.h"
 #include "Engine/StandardPaths.h"
 
 
@@ -78,6 +82,21 @@ GCC_DIAG_ON(unused-parameter)
 #define NATRON_OPENGL_VERSION_REQUIRED_MAJOR 2
 #define NATRON_OPENGL_VERSION_REQUIRED_MINOR 0
 
+// How often (in ms) the node cache size is adapted to the memory available on the system
+#define NATRON_CACHE_MEMORY_WATCHER_PERIOD_MS 2000
+
+// The node cache is never shrunk below this fraction of the size set by the user
+#define NATRON_CACHE_MEMORY_MIN_PERCENT 0.1
+
+// When memory is available again, the node cache grows by at most this fraction of the size set by the user per period
+#define NATRON_CACHE_MEMORY_GROWTH_PERCENT 0.05
+
+// Above this memory pressure (fraction of time tasks were stalled on memory), the node cache gives back some memory
+#define NATRON_CACHE_MEMORY_PRESSURE_THRESHOLD 0.1
+
+// Fraction of the node cache released per period while the memory pressure is above the threshold
+#define NATRON_CACHE_MEMORY_PRESSURE_RELEASE_PERCENT 0.1
+
 BOOST_CLASS_EXPORT(NATRON_NAMESPACE::FrameParams)
 BOOST_CLASS_EXPORT(NATRON_NAMESPACE::ImageParams)
 
@@ -99,8 +118,13 @@ AppManagerPrivate::AppManagerPrivate()
     , _nodeCache()
     , _diskCache()
     , _viewerCache()
+    , nodeCacheMemoryMutex()
+    , nodeCacheUserMaximumMemory(0)
+    , nodeCacheAdaptedMaximumMemory(0)
+    , cacheMemoryWatcher()
     , diskCachesLocationMutex()
     , diskCachesLocation()
+    , sharedDiskCachesLocation()
     , _backgroundIPC()
     , _loaded(false)
     , _binaryPath()
@@ -312,10 +336,23 @@ AppManagerPrivate::declareSettingsToPython()
     }
 }
 
+// The shared disk cache tier is implemented in CacheSerialization.h, which is only included here:
+// instantiate it for the caches of the application.
+template bool Cache<Image>::promoteFromSharedTier(Cache<Image>::CacheShard& shard, const ImageKey & key) const;
+template void Cache<Image>::demoteToSharedTier(const Cache<Image>::EntryTypePtr& entry, const QString& sharedCachePath) const;
+template bool Cache<FrameEntry>::promoteFromSharedTier(Cache<FrameEntry>::CacheShard& shard, const FrameKey & key) const;
+template void Cache<FrameEntry>::demoteToSharedTier(const Cache<FrameEntry>::EntryTypePtr& entry, const QString& sharedCachePath) const;
+
 template <typename T>
 void
 saveCache(Cache<T>* cache)
 {
+    if ( cache->isTileCache() ) {
+        // Tiled caches are restored from their memory-mapped index
+        cache->saveIndex();
+
+        return;
+    }
     std::string cacheRestoreFilePath = cache->getRestoreFilePath();
     FStreamsSupport::ofstream ofile;
     FStreamsSupport::open(&ofile, cacheRestoreFilePath);
@@ -348,11 +385,43 @@ AppManagerPrivate::saveCaches()
     saveCache<Image>( _diskCache.get() );
 } // saveCaches
 
+int
+AppManagerPrivate::exportCacheBundle(const std::string& bundlePath,
+                                     const std::set<std::string>& holderIDs,
+                                     double firstFrame,
+                                     double lastFrame) const
+{
+    if (!_nodeCache || !_diskCache) {
+        return 0;
+    }
+
+    return _nodeCache->exportBundle(bundlePath, holderIDs, firstFrame, lastFrame) +
+           _diskCache->exportBundle(bundlePath, holderIDs, firstFrame, lastFrame);
+}
+
+int
+AppManagerPrivate::importCacheBundle(const std::string& bundlePath)
+{
+    if (!_nodeCache || !_diskCache) {
+        return 0;
+    }
+
+    return _nodeCache->importBundle(bundlePath) + _diskCache->importBundle(bundlePath);
+}
+
 template <typename T>
 void
 restoreCache(AppManagerPrivate* p,
              Cache<T>* cache)
 {
+    if ( cache->isTileCache() ) {
+        // The entries referenced by the index are only created when they are looked up
+        if ( !cache->restoreIndex() ) {
+            p->cleanUpCacheDiskStructure( cache->getCachePath(), true );
+        }
+
+        return;
+    }
     if ( p->checkForCacheDiskStructure( cache->getCachePath(), cache->isTileCache() ) ) {
         std::string settingsFilePath = cache->getRestoreFilePath();
         FStreamsSupport::ifstream ifile;
@@ -392,7 +461,10 @@ restoreCache(AppManagerPrivate* p,
 void
 AppManagerPrivate::restoreCaches()
 {
-    restoreCache<FrameEntry>( this, _viewerCache.get() );
+    // There is no viewer to read the viewer cache in background mode, and saveCaches() does not write it back either
+    if (!appPTR->isBackground()) {
+        restoreCache<FrameEntry>( this, _viewerCache.get() );
+    }
     restoreCache<Image>( this, _diskCache.get() );
 } // restoreCaches
 
@@ -580,6 +652,124 @@ AppManagerPrivate::setMaxCacheFiles()
     maxCacheFiles = hardMax * 0.9;
 }
 
+CacheMemoryWatcherThread::CacheMemoryWatcherThread(AppManagerPrivate* imp)
+    : QThread()
+    , _mustQuitMutex()
+    , _mustQuit(false)
+    , _mustQuitCond()
+    , _imp(imp)
+{
+    setObjectName( QString::fromUtf8("CacheMemoryWatcher") );
+}
+
+CacheMemoryWatcherThread::~CacheMemoryWatcherThread()
+{
+}
+
+void
+CacheMemoryWatcherThread::quitThread()
+{
+    if ( !isRunning() ) {
+        return;
+    }
+    {
+        QMutexLocker k(&_mustQuitMutex);
+        _mustQuit = true;
+        _mustQuitCond.wakeOne();
+    }
+    wait();
+    {
+        QMutexLocker k(&_mustQuitMutex);
+        _mustQuit = false;
+    }
+}
+
+void
+CacheMemoryWatcherThread::run()
+{
+    for (;; ) {
+        {
+            QMutexLocker k(&_mustQuitMutex);
+            if (!_mustQuit) {
+                _mustQuitCond.wait(&_mustQuitMutex, NATRON_CACHE_MEMORY_WATCHER_PERIOD_MS);
+            }
+            if (_mustQuit) {
+                return;
+            }
+        }
+        _imp->adaptNodeCacheToSystemMemory();
+    }
+}
+
+void
+AppManagerPrivate::setNodeCacheUserMaximumMemory(U64 size)
+{
+    QMutexLocker k(&nodeCacheMemoryMutex);
+
+    nodeCacheUserMaximumMemory = size;
+    nodeCacheAdaptedMaximumMemory = size;
+    _nodeCache->setMaximumCacheSize(size);
+    _nodeCache->setMaximumInMemorySize(1);
+    ImageBufferPool::setMaximumFreeSize(size * NATRON_IMAGE_BUFFER_POOL_MAX_PERCENT);
+}
+
+void
+AppManagerPrivate::adaptNodeCacheToSystemMemory()
+{
+    if (!_nodeCache) {
+        return;
+    }
+
+    // Sample the system before taking the lock, this may read files in /proc
+    U64 ramToKeepFree = getSystemTotalRAM() * _settings->getUnreachableRamPercent();
+    U64 freeRAM = getAmountFreePhysicalRAM();
+    double pressure = getSystemMemoryPressure();
+    U64 cacheSize = _nodeCache->getMemoryCacheSize();
+    bool shrunk = false;
+    {
+        QMutexLocker k(&nodeCacheMemoryMutex);
+        if (nodeCacheUserMaximumMemory == 0) {
+            return;
+        }
+
+        // The cache may use what it already holds plus what is free, minus what must be left to the system
+        U64 available = cacheSize + freeRAM;
+        U64 target = available > ramToKeepFree ? available - ramToKeepFree : 0;
+
+        // Other processes are stalled waiting for memory: give some back even if the free RAM looks fine
+        if (pressure > NATRON_CACHE_MEMORY_PRESSURE_THRESHOLD) {
+            target = std::min( target, (U64)( cacheSize * (1. - NATRON_CACHE_MEMORY_PRESSURE_RELEASE_PERCENT) ) );
+        }
+
+        target = std::min(target, nodeCacheUserMaximumMemory);
+        target = std::max( target, (U64)(nodeCacheUserMaximumMemory * NATRON_CACHE_MEMORY_MIN_PERCENT) );
+
+        // Shrink right away but grow back progressively, so that a short-lived peak of free memory does not
+        // make the cache oscillate
+        if (target > nodeCacheAdaptedMaximumMemory) {
+            target = std::min( target, nodeCacheAdaptedMaximumMemory + (U64)(nodeCacheUserMaximumMemory * NATRON_CACHE_MEMORY_GROWTH_PERCENT) );
+        }
+        if (target == nodeCacheAdaptedMaximumMemory) {
+            return;
+        }
+        shrunk = target < nodeCacheAdaptedMaximumMemory;
+        nodeCacheAdaptedMaximumMemory = target;
+
+#ifdef NATRON_DEBUG_CACHE
+        qDebug() << "Adapting the NodeCache maximum size to" << printAsRAM(target) << "(free RAM:" << printAsRAM(freeRAM) << ", memory pressure:" << pressure << ")";
+#endif
+        _nodeCache->setMaximumCacheSize(target);
+        _nodeCache->setMaximumInMemorySize(1);
+        ImageBufferPool::setMaximumFreeSize(target * NATRON_IMAGE_BUFFER_POOL_MAX_PERCENT);
+    }
+
+    if (shrunk) {
+        // Release the memory now rather than on the next insertion in the cache
+        ImageBufferPool::purge();
+        _nodeCache->clearExceedingEntries();
+    }
+}
+
 #ifdef DEBUG
 // logs every gl call to the console
 static void
@@ -32,6 +32,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/scoped_ptr.hpp>
@@ -40,6 +41,8 @@
 
 #include <QtCore/QtGlobal> // for Q_OS_*
 #include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
 #include <QtCore/QString>
 #include <QtCore/QAtomicInt>
 #include <QtCore/QCoreApplication>
@@ -80,6 +83,34 @@ GCC_DIAG_ON(deprecated)
 
 NATRON_NAMESPACE_ENTER
 
+struct AppManagerPrivate;
+
+/**
+ * @brief Periodically adapts the maximum size of the node cache to the memory that is actually
+ * available on the system, so that the cache does not push the machine into swap when other
+ * applications need memory, and grows back up to the user setting when the memory is released.
+ **/
+class CacheMemoryWatcherThread
+    : public QThread
+{
+    mutable QMutex _mustQuitMutex;
+    bool _mustQuit; // protected by _mustQuitMutex
+    QWaitCondition _mustQuitCond;
+    AppManagerPrivate* _imp;
+
+public:
+
+    CacheMemoryWatcherThread(AppManagerPrivate* imp);
+
+    virtual ~CacheMemoryWatcherThread();
+
+    void quitThread();
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+};
+
 struct AppManagerPrivate
 {
     Q_DECLARE_TR_FUNCTIONS(AppManagerPrivate)
@@ -106,8 +137,13 @@ public:
     ImageCachePtr _nodeCache; //< Images cache
     ImageCachePtr _diskCache; //< Images disk cache (used by DiskCache nodes)
     FrameEntryCachePtr _viewerCache; //< Viewer textures cache
+    mutable QMutex nodeCacheMemoryMutex;
+    U64 nodeCacheUserMaximumMemory; //< the node cache size set by the user, protected by nodeCacheMemoryMutex
+    U64 nodeCacheAdaptedMaximumMemory; //< the node cache size currently applied, protected by nodeCacheMemoryMutex
+    boost::scoped_ptr<CacheMemoryWatcherThread> cacheMemoryWatcher;
     mutable QMutex diskCachesLocationMutex;
     QString diskCachesLocation;
+    QString sharedDiskCachesLocation; // protected by diskCachesLocationMutex
     boost::scoped_ptr<ProcessInputChannel> _backgroundIPC; //< object used to communicate with the main app
     //if this app is background, see the ProcessInputChannel def
     bool _loaded; //< true when the first instance is completely loaded.
@@ -218,6 +254,10 @@ public:
 
     void saveCaches();
 
+    int exportCacheBundle(const std::string& bundlePath, const std::set<std::string>& holderIDs, double firstFrame, double lastFrame) const;
+
+    int importCacheBundle(const std::string& bundlePath);
+
     void restoreCaches();
 
     static void addOpenGLRequirementsString(QString& str, OpenGLRequirementsTypeEnum type);
@@ -249,6 +289,18 @@ public:
 
     void setViewerCacheTileSize();
 
+    /**
+     * @brief Set the maximum memory of the node cache as chosen by the user. The size actually
+     * applied may be lower when the system is short on memory, see adaptNodeCacheToSystemMemory()
+     **/
+    void setNodeCacheUserMaximumMemory(U64 size);
+
+    /**
+     * @brief Shrink the node cache when the system runs short on memory, and grow it back progressively
+     * up to the user setting when memory becomes available again.
+     **/
+    void adaptNodeCacheToSystemMemory();
+
     void handleCommandLineArgs(int argc, char** argv);
     void handleCommandLineArgsW(int argc, wchar_t** argv);
 
@@ -32,6 +32,7 @@
 #include <cmath>
 #include <cassert>
 #include <stdexcept>
+#include <vector>
 
 #include <QtCore/QLineF>
 #include <QtCore/QDebug>
@@ -88,6 +89,12 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 // http://www.davidrevoy.com/article182/calibrating-wacom-stylus-pressure-on-krita
 #define ROTO_PRESSURE_LEVELS 512
 
+// Maximum distance, in pixels at the evaluated mipmap level, between a Bezier segment and its flattened polyline
+// when the number of points per segment is computed automatically.
+#define ROTO_BEZIER_FLATTENING_TOLERANCE 0.1
+// Upper bound of the number of points of an automatically flattened segment (guards against degenerate huge tangents)
+#define ROTO_BEZIER_FLATTENING_MAX_POINTS 1024
+
 #ifndef M_PI
 #define M_PI        3.14159265358979323846264338327950288   /* pi             */
 #endif
@@ -715,15 +722,49 @@ recursiveBezier(const Point& p0, const Point& p1, const Point& p2, const Point&
 }
 #endif // #ifdef ROTO_BEZIER_EVAL_ITERATIVE
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// The control points of a shape evaluated at a given time, with one array per coordinate.
+// Evaluating the shape segment by segment would evaluate the animation curves of every control point twice
+// (once as the end of a segment, once as the start of the next one): they are evaluated once for all the segments instead.
+struct BezierCPsAtTime
+{
+    std::vector<double> x, y, leftX, leftY, rightX, rightY;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+static void
+evaluateControlPointsAtTime(bool useGuiCurves,
+                            const BezierCPs& cps,
+                            double time,
+                            ViewIdx view,
+                            BezierCPsAtTime* values)
+{
+    std::size_t n = cps.size();
+
+    values->x.resize(n);
+    values->y.resize(n);
+    values->leftX.resize(n);
+    values->leftY.resize(n);
+    values->rightX.resize(n);
+    values->rightY.resize(n);
+    std::size_t i = 0;
+    for (BezierCPs::const_iterator it = cps.begin(); it != cps.end(); ++it, ++i) {
+        (*it)->getPointsAtTime(useGuiCurves, time, view,
+                               &values->x[i], &values->y[i],
+                               &values->leftX[i], &values->leftY[i],
+                               &values->rightX[i], &values->rightY[i]);
+    }
+}
+
 // compute nbPointsperSegment points and update the bbox bounding box for the Bezier
-// segment from 'first' to 'last' evaluated at 'time'
+// segment from the control point at index 'first' to the one at index 'last' in 'cps'
 // If nbPointsPerSegment is -1 then it will be automatically computed
 static void
-bezierSegmentEval(bool useGuiCurves,
-                  const BezierCP & first,
-                  const BezierCP & last,
-                  double time,
-                  ViewIdx view,
+bezierSegmentEval(const BezierCPsAtTime& cps,
+                  std::size_t first,
+                  std::size_t last,
                   unsigned int mipMapLevel,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
                   int nbPointsPerSegment,
@@ -737,15 +778,14 @@ bezierSegmentEval(bool useGuiCurves,
     Transform::Point3D p0M, p1M, p2M, p3M;
     Point p0, p1, p2, p3;
 
-    try {
-        first.getPositionAtTime(useGuiCurves, time, view, &p0M.x, &p0M.y);
-        first.getRightBezierPointAtTime(useGuiCurves, time, view, &p1M.x, &p1M.y);
-        last.getPositionAtTime(useGuiCurves, time, view, &p3M.x, &p3M.y);
-        last.getLeftBezierPointAtTime(useGuiCurves, time, view, &p2M.x, &p2M.y);
-    } catch (const std::exception & e) {
-        assert(false);
-    }
-
+    p0M.x = cps.x[first];
+    p0M.y = cps.y[first];
+    p1M.x = cps.rightX[first];
+    p1M.y = cps.rightY[first];
+    p2M.x = cps.leftX[last];
+    p2M.y = cps.leftY[last];
+    p3M.x = cps.x[last];
+    p3M.y = cps.y[last];
     p0M.z = p1M.z = p2M.z = p3M.z = 1;
 
     p0M = matApply(transform, p0M);
@@ -777,30 +817,59 @@ bezierSegmentEval(bool useGuiCurves,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
     if (nbPointsPerSegment == -1) {
         /*
-         * Approximate the necessary number of line segments, using http://antigrain.com/research/adaptive_bezier/
+         * Curvature-adaptive number of line segments: the distance between a cubic and the polyline joining n+1 points
+         * uniformly spaced in t is at most 3/4 * max(|p0 - 2p1 + p2|, |p1 - 2p2 + p3|) / n^2 (Wang's formula), so flat
+         * segments get 2 points whatever their length and tight curves get as many as needed to stay within the tolerance.
          */
-        double dx1, dy1, dx2, dy2, dx3, dy3;
-        dx1 = p1.x - p0.x;
-        dy1 = p1.y - p0.y;
-        dx2 = p2.x - p1.x;
-        dy2 = p2.y - p1.y;
-        dx3 = p3.x - p2.x;
-        dy3 = p3.y - p2.y;
-        double length = std::sqrt(dx1 * dx1 + dy1 * dy1) +
-                        std::sqrt(dx2 * dx2 + dy2 * dy2) +
-                        std::sqrt(dx3 * dx3 + dy3 * dy3);
-        nbPointsPerSegment = (int)std::max(length * 0.25, 2.);
+        double ddx1 = p0.x - 2. * p1.x + p2.x;
+        double ddy1 = p0.y - 2. * p1.y + p2.y;
+        double ddx2 = p1.x - 2. * p2.x + p3.x;
+        double ddy2 = p1.y - 2. * p2.y + p3.y;
+        double secondDiff = std::sqrt( std::max(ddx1 * ddx1 + ddy1 * ddy1, ddx2 * ddx2 + ddy2 * ddy2) );
+        double nbSegments = std::ceil( std::sqrt(0.75 * secondDiff / ROTO_BEZIER_FLATTENING_TOLERANCE) );
+        nbPointsPerSegment = (int)std::min( std::max(nbSegments + 1., 2.), (double)ROTO_BEZIER_FLATTENING_MAX_POINTS );
     }
 
+    /*
+     * Evaluate the cubic at uniform steps of t with forward differences: 6 additions per point instead of
+     * a full de Casteljau evaluation. The last point is set exactly to p3 so that consecutive segments join.
+     */
     double incr = 1. / (double)(nbPointsPerSegment - 1);
-    Point cur;
+    double incr2 = incr * incr;
+    double incr3 = incr2 * incr;
+    // polynomial coefficients: B(t) = a t^3 + b t^2 + c t + p0
+    double ax = -p0.x + 3. * p1.x - 3. * p2.x + p3.x;
+    double ay = -p0.y + 3. * p1.y - 3. * p2.y + p3.y;
+    double bx = 3. * p0.x - 6. * p1.x + 3. * p2.x;
+    double by = 3. * p0.y - 6. * p1.y + 3. * p2.y;
+    double cx = -3. * p0.x + 3. * p1.x;
+    double cy = -3. * p0.y + 3. * p1.y;
+    double x = p0.x;
+    double y = p0.y;
+    double d1x = ax * incr3 + bx * incr2 + cx * incr;
+    double d1y = ay * incr3 + by * incr2 + cy * incr;
+    double d2x = 6. * ax * incr3 + 2. * bx * incr2;
+    double d2y = 6. * ay * incr3 + 2. * by * incr2;
+    double d3x = 6. * ax * incr3;
+    double d3y = 6. * ay * incr3;
     for (int i = 0; i < nbPointsPerSegment; ++i) {
         ParametricPoint p;
-        p.t = incr * i;
-        Bezier::bezierPoint(p0, p1, p2, p3, p.t, &cur);
-        p.x = cur.x;
-        p.y = cur.y;
+        if (i == nbPointsPerSegment - 1) {
+            p.t = 1.;
+            p.x = p3.x;
+            p.y = p3.y;
+        } else {
+            p.t = incr * i;
+            p.x = x;
+            p.y = y;
+        }
         points->push_back(p);
+        x += d1x;
+        y += d1y;
+        d1x += d2x;
+        d1y += d2y;
+        d2x += d3x;
+        d2y += d3y;
     }
 #else
     static const int maxRecursion = 32;
@@ -843,6 +912,16 @@ bezierSegmentMeetsPoint(bool useGuiCurves,
     p2 = Transform::matApply(transform, p2);
     p3 = Transform::matApply(transform, p3);
 
+    ///The segment lies within the convex hull of its control points: when (x,y) is farther than distance from
+    ///their bounding box, reject the segment without sampling it. Picking then costs almost nothing for all
+    ///the segments that are not under the mouse.
+    if ( ( x < std::min( std::min(p0.x, p1.x), std::min(p2.x, p3.x) ) - distance ) ||
+         ( x > std::max( std::max(p0.x, p1.x), std::max(p2.x, p3.x) ) + distance ) ||
+         ( y < std::min( std::min(p0.y, p1.y), std::min(p2.y, p3.y) ) - distance ) ||
+         ( y > std::max( std::max(p0.y, p1.y), std::max(p2.y, p3.y) ) + distance ) ) {
+        return false;
+    }
+
     ///Use the control polygon to approximate segment length
     double length = ( std::sqrt( (p1.x - p0.x) * (p1.x - p0.x) + (p1.y - p0.y) * (p1.y - p0.y) ) +
                       std::sqrt( (p2.x - p1.x) * (p2.x - p1.x) + (p2.y - p1.y) * (p2.y - p1.y) ) +
@@ -912,32 +991,17 @@ isPointCloseTo(bool useGuiCurves,
 }
 
 static bool
-bezierSegmenEqual(bool useGuiCurves,
-                  double time,
-                  ViewIdx view,
-                  const BezierCP & p0,
-                  const BezierCP & p1,
-                  const BezierCP & s0,
-                  const BezierCP & s1)
-{
-    double prevX, prevY, prevXF, prevYF;
-    double nextX, nextY, nextXF, nextYF;
-
-    p0.getPositionAtTime(useGuiCurves, time, view, &prevX, &prevY);
-    p1.getPositionAtTime(useGuiCurves, time, view, &nextX, &nextY);
-    s0.getPositionAtTime(useGuiCurves, time, view, &prevXF, &prevYF);
-    s1.getPositionAtTime(useGuiCurves, time, view, &nextXF, &nextYF);
-    if ( (prevX != prevXF) || (prevY != prevYF) || (nextX != nextXF) || (nextY != nextYF) ) {
+bezierSegmenEqual(const BezierCPsAtTime& cps,
+                  const BezierCPsAtTime& fps,
+                  std::size_t prev,
+                  std::size_t next)
+{
+    if ( (cps.x[prev] != fps.x[prev]) || (cps.y[prev] != fps.y[prev]) || (cps.x[next] != fps.x[next]) || (cps.y[next] != fps.y[next]) ) {
         return true;
     } else {
         ///check derivatives
-        double prevRightX, prevRightY, nextLeftX, nextLeftY;
-        double prevRightXF, prevRightYF, nextLeftXF, nextLeftYF;
-        p0.getRightBezierPointAtTime(useGuiCurves, time, view, &prevRightX, &prevRightY);
-        p1.getLeftBezierPointAtTime(useGuiCurves, time, view, &nextLeftX, &nextLeftY);
-        s0.getRightBezierPointAtTime(useGuiCurves, time, view, &prevRightXF, &prevRightYF);
-        s1.getLeftBezierPointAtTime(useGuiCurves, time, view, &nextLeftXF, &nextLeftYF);
-        if ( (prevRightX != prevRightXF) || (prevRightY != prevRightYF) || (nextLeftX != nextLeftXF) || (nextLeftY != nextLeftYF) ) {
+        if ( (cps.rightX[prev] != fps.rightX[prev]) || (cps.rightY[prev] != fps.rightY[prev]) ||
+             (cps.leftX[next] != fps.leftX[next]) || (cps.leftY[next] != fps.leftY[next]) ) {
             return true;
         } else {
             return false;
@@ -2545,27 +2609,25 @@ Bezier::deCastelJau(bool isOpenBezier,
                     RectD* bbox)
 {
     assert((points && !pointsSingleList) || (!points && pointsSingleList));
-    BezierCPs::const_iterator next = cps.begin();
-
-    if ( next != cps.end() ) {
-        ++next;
-    }
-
+    BezierCPsAtTime values;
+    evaluateControlPointsAtTime(useGuiCurves, cps, time, ViewIdx(0), &values);
 
-    for (BezierCPs::const_iterator it = cps.begin(); it != cps.end(); ++it) {
-        if ( next == cps.end() ) {
+    std::size_t nbPoints = values.x.size();
+    for (std::size_t i = 0; i < nbPoints; ++i) {
+        std::size_t next = i + 1;
+        if (next == nbPoints) {
             if (!finished) {
                 break;
             }
-            next = cps.begin();
+            next = 0;
         }
 
         if (points) {
             std::list<ParametricPoint> segmentPoints;
-            bezierSegmentEval(useGuiCurves, *(*it), *(*next), time, ViewIdx(0), mipMapLevel, nBPointsPerSegment, transform, &segmentPoints, bbox);
+            bezierSegmentEval(values, i, next, mipMapLevel, nBPointsPerSegment, transform, &segmentPoints, bbox);
 
             // If we are a closed bezier or we are not on the last segment, remove the last point so we don't add duplicates
-            if (!isOpenBezier || next != cps.end()) {
+            if (!isOpenBezier || next != nbPoints) {
                 if (!segmentPoints.empty()) {
                     segmentPoints.pop_back();
                 }
@@ -2573,19 +2635,14 @@ Bezier::deCastelJau(bool isOpenBezier,
             points->push_back(segmentPoints);
         } else {
             assert(pointsSingleList);
-            bezierSegmentEval(useGuiCurves, *(*it), *(*next), time, ViewIdx(0), mipMapLevel, nBPointsPerSegment, transform, pointsSingleList, bbox);
+            bezierSegmentEval(values, i, next, mipMapLevel, nBPointsPerSegment, transform, pointsSingleList, bbox);
             // If we are a closed bezier or we are not on the last segment, remove the last point so we don't add duplicates
-            if (!isOpenBezier || next != cps.end()) {
+            if (!isOpenBezier || next != nbPoints) {
                 if (!pointsSingleList->empty()) {
                     pointsSingleList->pop_back();
                 }
             }
         }
-
-        // increment for next iteration
-        if ( next != cps.end() ) {
-            ++next;
-        }
     } // for()
 }
 
@@ -2718,36 +2775,32 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
     if ( _imp->points.empty() ) {
         return;
     }
-    BezierCPs::const_iterator itCp = _imp->points.begin();
-    BezierCPs::const_iterator next = _imp->featherPoints.begin();
-    if ( next != _imp->featherPoints.end() ) {
-        ++next;
-    }
-    BezierCPs::const_iterator nextCp = itCp;
-    if ( nextCp != _imp->points.end() ) {
-        ++nextCp;
+    assert( _imp->points.size() == _imp->featherPoints.size() );
+
+    BezierCPsAtTime cpValues, fpValues;
+    if (!evaluateIfEqual) {
+        evaluateControlPointsAtTime(useGuiPoints, _imp->points, time, ViewIdx(0), &cpValues);
     }
+    evaluateControlPointsAtTime(useGuiPoints, _imp->featherPoints, time, ViewIdx(0), &fpValues);
 
     Transform::Matrix3x3 transform;
     getTransformAtTime(time, &transform);
 
-    for (BezierCPs::const_iterator it = _imp->featherPoints.begin(); it != _imp->featherPoints.end();
-         ++it) {
-        if ( next == _imp->featherPoints.end() ) {
-            next = _imp->featherPoints.begin();
-        }
-        if ( nextCp == _imp->points.end() ) {
+    std::size_t nbPoints = std::min( _imp->points.size(), _imp->featherPoints.size() );
+    for (std::size_t i = 0; i < nbPoints; ++i) {
+        std::size_t next = i + 1;
+        if (next == nbPoints) {
             if (!_imp->finished) {
                 break;
             }
-            nextCp = _imp->points.begin();
+            next = 0;
         }
-        if ( !evaluateIfEqual && bezierSegmenEqual(useGuiPoints, time, ViewIdx(0), **itCp, **nextCp, **it, **next) ) {
+        if ( !evaluateIfEqual && bezierSegmenEqual(cpValues, fpValues, i, next) ) {
             continue;
         }
         if (points) {
             std::list<ParametricPoint> segmentPoints;
-            bezierSegmentEval(useGuiPoints, *(*it), *(*next), time, ViewIdx(0),  mipMapLevel,
+            bezierSegmentEval(fpValues, i, next, mipMapLevel,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
                               nbPointsPerSegment,
 #else
@@ -2756,7 +2809,7 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
                               transform, &segmentPoints, bbox);
 
             // If we are a closed bezier or we are not on the last segment, remove the last point so we don't add duplicates
-            if (!isOpenBezier() || next != _imp->featherPoints.end()) {
+            if (!isOpenBezier() || next != nbPoints) {
                 if (!segmentPoints.empty()) {
                     segmentPoints.pop_back();
                 }
@@ -2764,7 +2817,7 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
             points->push_back(segmentPoints);
         } else {
             assert(pointsSingleList);
-            bezierSegmentEval(useGuiPoints, *(*it), *(*next), time, ViewIdx(0),  mipMapLevel,
+            bezierSegmentEval(fpValues, i, next, mipMapLevel,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
                               nbPointsPerSegment,
 #else
@@ -2772,24 +2825,13 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
 #endif
                               transform, pointsSingleList, bbox);
             // If we are a closed bezier or we are not on the last segment, remove the last point so we don't add duplicates
-            if (!isOpenBezier() || next != _imp->featherPoints.end()) {
+            if (!isOpenBezier() || next != nbPoints) {
                 if (!pointsSingleList->empty()) {
                     pointsSingleList->pop_back();
                 }
             }
         }
-
-        // increment for next iteration
-        if ( itCp != _imp->featherPoints.end() ) {
-            ++itCp;
-        }
-        if ( next != _imp->featherPoints.end() ) {
-            ++next;
-        }
-        if ( nextCp != _imp->featherPoints.end() ) {
-            ++nextCp;
-        }
-    } // for(it)
+    } // for(i)
 
 }
 
@@ -375,7 +375,9 @@ public:
 
     /**
      * @brief Evaluates the spline at the given time and returns the list of all the points on the curve.
-     * @param nbPointsPerSegment controls how many points are used to draw one Bezier segment
+     * @param nbPointsPerSegment controls how many points are used to draw one Bezier segment.
+     * If -1, it is computed for each segment from its curvature so that the polyline stays within
+     * a tenth of a pixel of the curve.
      **/
     void evaluateAtTime_DeCasteljau(bool useGuiCurves,
                                     double time,
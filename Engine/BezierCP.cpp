@@ -259,6 +259,47 @@ BezierCP::getRightBezierPointAtTime(bool useGuiCurves,
     return ret;
 } // BezierCP::getRightBezierPointAtTime
 
+void
+BezierCP::getPointsAtTime(bool useGuiCurves,
+                          double time,
+                          ViewIdx view,
+                          double* x,
+                          double* y,
+                          double* leftX,
+                          double* leftY,
+                          double* rightX,
+                          double* rightY) const
+{
+    Curve* xCurve = useGuiCurves ? _imp->guiCurveX.get() : _imp->curveX.get();
+    Curve* leftXCurve = useGuiCurves ? _imp->guiCurveLeftBezierX.get() : _imp->curveLeftBezierX.get();
+    Curve* rightXCurve = useGuiCurves ? _imp->guiCurveRightBezierX.get() : _imp->curveRightBezierX.get();
+
+    if ( xCurve->isAnimated() || ( leftXCurve && leftXCurve->isAnimated() ) || rightXCurve->isAnimated() ) {
+        getPositionAtTime(useGuiCurves, time, view, x, y);
+        getLeftBezierPointAtTime(useGuiCurves, time, view, leftX, leftY);
+        getRightBezierPointAtTime(useGuiCurves, time, view, rightX, rightY);
+
+        return;
+    }
+
+    QMutexLocker l(&_imp->staticPositionMutex);
+    if (!useGuiCurves) {
+        *x = _imp->x;
+        *y = _imp->y;
+        *leftX = _imp->leftX;
+        *leftY = _imp->leftY;
+        *rightX = _imp->rightX;
+        *rightY = _imp->rightY;
+    } else {
+        *x = _imp->guiX;
+        *y = _imp->guiY;
+        *leftX = _imp->guiLeftX;
+        *leftY = _imp->guiLeftY;
+        *rightX = _imp->guiRightX;
+        *rightY = _imp->guiRightY;
+    }
+}
+
 void
 BezierCP::setLeftBezierPointAtTime(bool useGuiCurves,
                                    double time,
@@ -865,6 +906,72 @@ BezierCP::clone(const BezierCP & other)
     }
 }
 
+void
+BezierCP::saveKeyFrames(const std::set<double>& times,
+                        BezierCPKeyFramesSnapshot* snapshot) const
+{
+    assert(snapshot);
+    const Curve* curves[6] = {
+        _imp->curveX.get(), _imp->curveY.get(),
+        _imp->curveLeftBezierX.get(), _imp->curveLeftBezierY.get(),
+        _imp->curveRightBezierX.get(), _imp->curveRightBezierY.get()
+    };
+
+    snapshot->times = times;
+    for (int i = 0; i < 6; ++i) {
+        snapshot->keys[i].clear();
+        for (std::set<double>::const_iterator it = times.begin(); it != times.end(); ++it) {
+            KeyFrame k;
+            if ( curves[i]->getKeyFrameWithTime(*it, &k) ) {
+                snapshot->keys[i].push_back(k);
+            }
+        }
+    }
+
+    QMutexLocker l(&_imp->staticPositionMutex);
+    snapshot->staticPosition[0] = _imp->x;
+    snapshot->staticPosition[1] = _imp->y;
+    snapshot->staticPosition[2] = _imp->leftX;
+    snapshot->staticPosition[3] = _imp->leftY;
+    snapshot->staticPosition[4] = _imp->rightX;
+    snapshot->staticPosition[5] = _imp->rightY;
+}
+
+void
+BezierCP::restoreKeyFrames(const BezierCPKeyFramesSnapshot& snapshot)
+{
+    Curve* curves[6] = {
+        _imp->curveX.get(), _imp->curveY.get(),
+        _imp->curveLeftBezierX.get(), _imp->curveLeftBezierY.get(),
+        _imp->curveRightBezierX.get(), _imp->curveRightBezierY.get()
+    };
+
+    for (int i = 0; i < 6; ++i) {
+        for (std::set<double>::const_iterator it = snapshot.times.begin(); it != snapshot.times.end(); ++it) {
+            KeyFrame k;
+            if ( curves[i]->getKeyFrameWithTime(*it, &k) ) {
+                curves[i]->removeKeyFrameWithTime(*it);
+            }
+        }
+        if ( !snapshot.keys[i].empty() ) {
+            curves[i]->addKeyFrames(snapshot.keys[i]);
+        }
+    }
+
+    {
+        QMutexLocker l(&_imp->staticPositionMutex);
+        _imp->x = snapshot.staticPosition[0];
+        _imp->y = snapshot.staticPosition[1];
+        _imp->leftX = snapshot.staticPosition[2];
+        _imp->leftY = snapshot.staticPosition[3];
+        _imp->rightX = snapshot.staticPosition[4];
+        _imp->rightY = snapshot.staticPosition[5];
+    }
+
+    // same as clone(): the gui curves follow the internal ones
+    cloneInternalCurvesToGuiCurves();
+}
+
 bool
 BezierCP::equalsAtTime(bool useGuiCurves,
                        double time,
@@ -889,17 +996,36 @@ BezierCP::equalsAtTime(bool useGuiCurves,
     return false;
 }
 
+// Copies the keyframes of src onto dst, unless neither curve changed since they were last copied one onto the other
+static void
+syncCurve(const Curve& src,
+          U64* srcSyncedAge,
+          Curve& dst,
+          U64* dstSyncedAge)
+{
+    if ( ( src.getKeyFramesAge() == *srcSyncedAge ) && ( dst.getKeyFramesAge() == *dstSyncedAge ) ) {
+        return;
+    }
+    dst.clone(src);
+    *srcSyncedAge = src.getKeyFramesAge();
+    *dstSyncedAge = dst.getKeyFramesAge();
+}
+
 void
 BezierCP::cloneInternalCurvesToGuiCurves()
 {
-    _imp->guiCurveX->clone(*_imp->curveX);
-    _imp->guiCurveY->clone(*_imp->curveY);
-
-
-    _imp->guiCurveLeftBezierX->clone(*_imp->curveLeftBezierX);
-    _imp->guiCurveLeftBezierY->clone(*_imp->curveLeftBezierY);
-    _imp->guiCurveRightBezierX->clone(*_imp->curveRightBezierX);
-    _imp->guiCurveRightBezierY->clone(*_imp->curveRightBezierY);
+    {
+        const CurvePtr curves[6] = {
+            _imp->curveX, _imp->curveY, _imp->curveLeftBezierX, _imp->curveLeftBezierY, _imp->curveRightBezierX, _imp->curveRightBezierY
+        };
+        const CurvePtr guiCurves[6] = {
+            _imp->guiCurveX, _imp->guiCurveY, _imp->guiCurveLeftBezierX, _imp->guiCurveLeftBezierY, _imp->guiCurveRightBezierX, _imp->guiCurveRightBezierY
+        };
+        QMutexLocker k(&_imp->curvesSyncMutex);
+        for (int i = 0; i < 6; ++i) {
+            syncCurve(*curves[i], &_imp->curvesSyncedAge[i], *guiCurves[i], &_imp->guiCurvesSyncedAge[i]);
+        }
+    }
 
     QMutexLocker k(&_imp->staticPositionMutex);
     _imp->guiX = _imp->x;
@@ -913,14 +1039,18 @@ BezierCP::cloneInternalCurvesToGuiCurves()
 void
 BezierCP::cloneGuiCurvesToInternalCurves()
 {
-    _imp->curveX->clone(*_imp->guiCurveX);
-    _imp->curveY->clone(*_imp->guiCurveY);
-
-
-    _imp->curveLeftBezierX->clone(*_imp->guiCurveLeftBezierX);
-    _imp->curveLeftBezierY->clone(*_imp->guiCurveLeftBezierY);
-    _imp->curveRightBezierX->clone(*_imp->guiCurveRightBezierX);
-    _imp->curveRightBezierY->clone(*_imp->guiCurveRightBezierY);
+    {
+        const CurvePtr curves[6] = {
+            _imp->curveX, _imp->curveY, _imp->curveLeftBezierX, _imp->curveLeftBezierY, _imp->curveRightBezierX, _imp->curveRightBezierY
+        };
+        const CurvePtr guiCurves[6] = {
+            _imp->guiCurveX, _imp->guiCurveY, _imp->guiCurveLeftBezierX, _imp->guiCurveLeftBezierY, _imp->guiCurveRightBezierX, _imp->guiCurveRightBezierY
+        };
+        QMutexLocker k(&_imp->curvesSyncMutex);
+        for (int i = 0; i < 6; ++i) {
+            syncCurve(*guiCurves[i], &_imp->guiCurvesSyncedAge[i], *curves[i], &_imp->curvesSyncedAge[i]);
+        }
+    }
 
     QMutexLocker k(&_imp->staticPositionMutex);
     _imp->x = _imp->guiX;
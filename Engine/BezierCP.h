@@ -28,9 +28,11 @@
 
 #include "Global/Macros.h"
 
+#include <algorithm>
 #include <list>
 #include <set>
 #include <utility>
+#include <vector>
 
 #include "Global/Macros.h"
 
@@ -41,6 +43,7 @@
 
 #include "Global/GlobalDefines.h"
 
+#include "Engine/Curve.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
 
@@ -64,6 +67,28 @@ NATRON_NAMESPACE_ENTER
  * More-over the setters must be called ONLY by the Bezier class which is the class handling the thread safety.
  * That's why non-const functions are private.
  **/
+/**
+ * @brief The keyframes of a control point at a few times, along with its static position.
+ * This is all that an edit of the point at these times can change, and it is much smaller
+ * than a full copy of the point once its curves hold many keyframes.
+ **/
+struct BezierCPKeyFramesSnapshot
+{
+    std::set<double> times;
+
+    ///The keyframes found at these times, for the x, y, left x, left y, right x and right y curves
+    std::vector<KeyFrame> keys[6];
+
+    ///x, y, left x, left y, right x and right y when there is no keyframe
+    double staticPosition[6];
+
+    BezierCPKeyFramesSnapshot()
+        : times()
+    {
+        std::fill(staticPosition, staticPosition + 6, 0.);
+    }
+};
+
 struct BezierCPPrivate;
 class BezierCP
 {
@@ -90,6 +115,16 @@ public:
 
     void clone(const BezierCP & other);
 
+    /**
+     * @brief Saves the keyframes of the point at the given times and its static position.
+     * restoreKeyFrames() puts them back, removing any keyframe added at these times since.
+     * This is equivalent to clone() from a copy of the point, as long as the edits
+     * made in-between only touched these times.
+     **/
+    void saveKeyFrames(const std::set<double>& times, BezierCPKeyFramesSnapshot* snapshot) const;
+
+    void restoreKeyFrames(const BezierCPKeyFramesSnapshot& snapshot);
+
     void setPositionAtTime(bool useGuiCurves, double time, double x, double y);
 
     void setLeftBezierPointAtTime(bool useGuiCurves, double time, double x, double y);
@@ -126,6 +161,15 @@ public:
 
     bool getRightBezierPointAtTime(bool useGuiCurves, double time, ViewIdx view, double *x, double *y) const;
 
+    /**
+     * @brief Same as getPositionAtTime(), getLeftBezierPointAtTime() and getRightBezierPointAtTime() together,
+     * but locks the control point only once when it is not animated.
+     **/
+    void getPointsAtTime(bool useGuiCurves, double time, ViewIdx view,
+                         double* x, double* y,
+                         double* leftX, double* leftY,
+                         double* rightX, double* rightY) const;
+
     bool hasKeyFrameAtTime(bool useGuiCurves, double time) const;
 
     void getKeyframeTimes(bool useGuiCurves, std::set<double>* times) const;
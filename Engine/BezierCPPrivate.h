@@ -60,6 +60,13 @@ struct BezierCPPrivate
     double leftX, rightX, leftY, rightY; //< used when there is no keyframe
     double guiLeftX, guiRightX, guiLeftY, guiRightY; //< used when there is no keyframe
 
+    ///the keyframes ages (see Curve::getKeyFramesAge()) of the curves and of their gui copies when they were last
+    ///copied one onto the other, in the order x, y, leftX, leftY, rightX, rightY: a curve pair in which neither
+    ///changed since is still identical and is not copied again.
+    mutable QMutex curvesSyncMutex;
+    U64 curvesSyncedAge[6];
+    U64 guiCurvesSyncedAge[6];
+
     BezierCPPrivate(const BezierPtr& curve)
         : holder(curve)
         , curveX()
@@ -87,7 +94,12 @@ struct BezierCPPrivate
         , guiRightX(0)
         , guiLeftY(0)
         , guiRightY(0)
+        , curvesSyncMutex()
     {
+        for (int i = 0; i < 6; ++i) {
+            curvesSyncedAge[i] = 0;
+            guiCurvesSyncedAge[i] = 0;
+        }
         curveX= boost::make_shared<Curve>();
         curveY= boost::make_shared<Curve>();
         guiCurveX= boost::make_shared<Curve>();
@@ -61,12 +61,14 @@ public:
     bool isBackground;
     bool useDefaultSettings;
     bool clearCacheOnLaunch;
+    QString importCacheBundlePath;
     QString ipcPipe;
     int error;
     bool isInterpreterMode;
     std::list<std::pair<int, std::pair<int, int> > > frameRanges;
     bool rangeSet;
     bool enableRenderStats;
+    int renderChunks;
     bool isEmpty;
     mutable QString imageFilename;
     QString breakpadPipeFilePath;
@@ -88,12 +90,14 @@ public:
         , isBackground(false)
         , useDefaultSettings(false)
         , clearCacheOnLaunch(false)
+        , importCacheBundlePath()
         , ipcPipe()
         , error(0)
         , isInterpreterMode(false)
         , frameRanges()
         , rangeSet(false)
         , enableRenderStats(false)
+        , renderChunks(1)
         , isEmpty(true)
         , imageFilename()
         , breakpadPipeFilePath()
@@ -219,6 +223,7 @@ CLArgs::operator=(const CLArgs& other)
     _imp->isPythonScript = other._imp->isPythonScript;
     _imp->defaultOnProjectLoadedScript = other._imp->defaultOnProjectLoadedScript;
     _imp->clearCacheOnLaunch = other._imp->clearCacheOnLaunch;
+    _imp->importCacheBundlePath = other._imp->importCacheBundlePath;
     _imp->writers = other._imp->writers;
     _imp->readers = other._imp->readers;
     _imp->pythonCommands = other._imp->pythonCommands;
@@ -230,6 +235,7 @@ CLArgs::operator=(const CLArgs& other)
     _imp->frameRanges = other._imp->frameRanges;
     _imp->rangeSet = other._imp->rangeSet;
     _imp->enableRenderStats = other._imp->enableRenderStats;
+    _imp->renderChunks = other._imp->renderChunks;
     _imp->isEmpty = other._imp->isEmpty;
     _imp->imageFilename = other._imp->imageFilename;
     _imp->exportDocsPath = other._imp->exportDocsPath;
@@ -284,6 +290,9 @@ CLArgs::printUsage(const std::string& programName)
         "    init.py script is loaded.\n"
         "  --clear-cache\n"
         "    Clears the cache on startup.\n"
+        "  --import-cache-bundle <directory>\n"
+        "    Imports in the cache, on startup, the entries of a cache bundle written by\n"
+        "    App.exportCacheBundle(), so that they do not have to be rendered again.\n"
         "  --no-settings\n"
         "    When passed on the command-line, the %1 settings will not be restored\n"
         "    from the preferences file on disk so that %1 uses the default ones.\n"
@@ -340,7 +349,13 @@ CLArgs::printUsage(const std::string& programName)
         "     breakdown contains information about each nodes, render times etc...\n"
         "     This option is useful for debugging purposes or to control that a render\n"
         "     is working correctly.\n"
-        "     **Please note** that it does not work when writing video files."
+        "     **Please note** that it does not work when writing video files.\n"
+        "  --chunks <N>\n"
+        "     Split the frame range of each Write node in N parts, each rendered by a\n"
+        "     separate %1Renderer process on this computer. The processes do not\n"
+        "     share their memory but share the disk cache. This helps with plug-ins\n"
+        "     that do not scale with the number of threads.\n"
+        "     Write nodes producing video files are rendered by a single process.\n"
         "Sample uses:\n"
         "  %1 /Users/Me/MyNatronProjects/MyProject.ntp\n"
         "  %1 -b -w MyWriter /Users/Me/MyNatronProjects/MyProject.ntp\n"
@@ -455,6 +470,12 @@ CLArgs::isCacheClearRequestedOnLaunch() const
     return _imp->clearCacheOnLaunch;
 }
 
+const QString&
+CLArgs::getImportCacheBundlePath() const
+{
+    return _imp->importCacheBundlePath;
+}
+
 
 bool
 CLArgs::isBackgroundMode() const
@@ -519,6 +540,12 @@ CLArgs::areRenderStatsEnabled() const
     return _imp->enableRenderStats;
 }
 
+int
+CLArgs::getRenderChunksCount() const
+{
+    return _imp->renderChunks;
+}
+
 bool
 CLArgs::isPythonScript() const
 {
@@ -765,6 +792,22 @@ CLArgsPrivate::parse()
         }
     }
 
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("import-cache-bundle"), QString() );
+        if ( it != args.end() ) {
+            it = args.erase(it);
+            if ( it != args.end() ) {
+                importCacheBundlePath = *it;
+                args.erase(it);
+            } else {
+                std::cout << tr("You must specify the cache bundle directory when using the --import-cache-bundle option").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
     {
         QStringList::iterator it = hasToken( QString::fromUtf8("no-settings"), QString() );
         if ( it != args.end() ) {
@@ -800,6 +843,24 @@ CLArgsPrivate::parse()
         }
     }
 
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("chunks"), QString() );
+        if ( it != args.end() ) {
+            it = args.erase(it);
+            bool ok = false;
+            if ( it != args.end() ) {
+                renderChunks = it->toInt(&ok);
+                args.erase(it);
+            }
+            if ( !ok || (renderChunks < 1) ) {
+                std::cout << tr("You must specify a positive number of processes when using the --chunks option").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
     {
         QStringList::iterator it = hasToken( QString::fromUtf8(NATRON_BREAKPAD_PROCESS_PID), QString() );
         if ( it != args.end() ) {
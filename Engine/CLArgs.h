@@ -120,6 +120,8 @@ public:
     bool isInterpreterMode() const;
 
     bool isCacheClearRequestedOnLaunch() const;
+
+    const QString& getImportCacheBundlePath() const;
     
     /*
      * @brief Has a Natron project or Python script been passed to the command line ?
@@ -139,6 +141,11 @@ public:
 
     bool areRenderStatsEnabled() const;
 
+    /**
+     * @brief The number of processes the frame range of each writer is split across, 1 if not set
+     **/
+    int getRenderChunksCount() const;
+
     const QString& getBreakpadProcessExecutableFilePath() const;
 
     qint64 getBreakpadProcessPID() const;
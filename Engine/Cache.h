@@ -33,6 +33,7 @@
 #include <fstream>
 #include <functional>
 #include <list>
+#include <map>
 #include <set>
 #include <cstddef>
 #include <utility>
@@ -55,6 +56,7 @@ GCC_DIAG_ON(deprecated)
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/atomic.hpp>
 #endif
 
 #include "Engine/AppManager.h" //for access to settings
@@ -62,6 +64,8 @@ GCC_DIAG_ON(deprecated)
 #include "Engine/ImageLocker.h"
 #include "Engine/LRUHashTable.h"
 #include "Engine/MemoryInfo.h" // getSystemTotalRAM
+#include "Engine/MPSCQueue.h"
+#include "Engine/PerfCounters.h"
 #include "Engine/Settings.h"
 #include "Engine/StandardPaths.h"
 
@@ -70,8 +74,25 @@ GCC_DIAG_ON(deprecated)
 //Beyond that percentage of occupation, the cache will start evicting LRU entries
 #define NATRON_CACHE_LIMIT_PERCENT 0.9
 
+//When the evictor thread is woken up because the cache went beyond NATRON_CACHE_LIMIT_PERCENT, it evicts
+//entries until the occupation goes below that percentage, so that it is not woken up again for each new entry
+#define NATRON_CACHE_LOW_WATERMARK_PERCENT 0.8
+
 #define NATRON_TILE_CACHE_FILE_SIZE_BYTES 2000000000
 
+// Freed tiles at least this large give their disk blocks back to the file system
+#define NATRON_TILE_CACHE_DISCARD_MIN_BYTES 262144
+
+//Number of entries the deleter thread destroys before waking up the threads waiting for memory
+#define NATRON_CACHE_DELETER_CHUNK_SIZE 16
+
+//Upper bound of the number of shards (partitions of entries with their own lock) of a cache
+#define NATRON_CACHE_MAX_SHARDS_COUNT 64
+
+//Render cost (in seconds) beyond which an entry gets one, then two extra second chances before being evicted
+#define NATRON_CACHE_COSTLY_ENTRY_RENDER_TIME 0.05
+#define NATRON_CACHE_VERY_COSTLY_ENTRY_RENDER_TIME 0.5
+
 ///When defined, number of opened files, memory size and disk size of the cache are printed whenever there's activity.
 //#define NATRON_DEBUG_CACHE
 
@@ -79,15 +100,24 @@ NATRON_NAMESPACE_ENTER
 
 /**
  * @brief The point of this thread is to delete the content of the list in a separate thread so the thread calling
- * get() doesn't wait for all the entries to be deleted (which can be expensive for large images)
+ * get() doesn't wait for all the entries to be deleted (which can be expensive for large images).
+ * Entries are handed over by batches through a lock-free queue, so that threads evicting entries never wait for
+ * the deleter. They are destroyed by chunks, after each of which the threads waiting for memory are woken up.
  **/
 template <typename T>
 class DeleterThread
     : public QThread
 {
-    mutable QMutex _entriesQueueMutex;
-    std::list<boost::shared_ptr<T> >_entriesQueue;
-    QWaitCondition _entriesQueueNotEmptyCond;
+    typedef std::list<boost::shared_ptr<T> > EntriesList;
+
+    MPSCQueue<EntriesList> _batches;
+
+    // Number of entries handed over that are not destroyed yet
+    boost::atomic<std::size_t> _pendingEntriesCount;
+
+    // Only used to sleep while there is nothing to delete
+    QMutex _sleepMutex;
+    QWaitCondition _batchesNotEmptyCond;
     CacheAPI* cache;
     QMutex mustQuitMutex;
     QWaitCondition mustQuitCond;
@@ -97,9 +127,10 @@ public:
 
     DeleterThread(CacheAPI* cache)
         : QThread()
-        , _entriesQueueMutex()
-        , _entriesQueue()
-        , _entriesQueueNotEmptyCond()
+        , _batches()
+        , _pendingEntriesCount(0)
+        , _sleepMutex()
+        , _batchesNotEmptyCond()
         , cache(cache)
         , mustQuitMutex()
         , mustQuitCond()
@@ -112,21 +143,18 @@ public:
     {
     }
 
-    void appendToQueue(const std::list<boost::shared_ptr<T> > & entriesToDelete)
+    /**
+     * @brief Hands over the entries to the deleter thread. entriesToDelete is emptied, without copy.
+     **/
+    void appendToQueue(EntriesList & entriesToDelete)
     {
         if ( entriesToDelete.empty() ) {
             return;
         }
 
-        {
-            QMutexLocker k(&_entriesQueueMutex);
-            _entriesQueue.insert( _entriesQueue.begin(), entriesToDelete.begin(), entriesToDelete.end() );
-        }
+        pushBatch(entriesToDelete);
         if ( !isRunning() ) {
             start();
-        } else {
-            QMutexLocker k(&_entriesQueueMutex);
-            _entriesQueueNotEmptyCond.wakeOne();
         }
     }
 
@@ -140,9 +168,10 @@ public:
         mustQuit = true;
 
         {
-            QMutexLocker k2(&_entriesQueueMutex);
-            _entriesQueue.push_back( boost::shared_ptr<T>() );
-            _entriesQueueNotEmptyCond.wakeOne();
+            // A NULL entry tells the thread to quit once all the entries before it are destroyed
+            EntriesList quitMarker;
+            quitMarker.push_back( boost::shared_ptr<T>() );
+            pushBatch(quitMarker);
         }
         while (mustQuit) {
             mustQuitCond.wait(&mustQuitMutex);
@@ -151,48 +180,63 @@ public:
 
     bool isWorking() const
     {
-        QMutexLocker k(&_entriesQueueMutex);
-
-        return !_entriesQueue.empty();
+        return _pendingEntriesCount.load() > 0;
     }
 
 private:
 
+    void pushBatch(EntriesList & entries)
+    {
+        _pendingEntriesCount.fetch_add( entries.size() );
+        _batches.push(entries);
+
+        QMutexLocker k(&_sleepMutex);
+        _batchesNotEmptyCond.wakeOne();
+    }
+
     virtual void run() OVERRIDE FINAL
     {
         for (;; ) {
-            bool quit;
-            {
-                QMutexLocker k(&mustQuitMutex);
-                quit = mustQuit;
+            EntriesList batch;
+            if ( !_batches.pop(&batch) ) {
+                if (_batches.size() > 0) {
+                    // A batch is being pushed by another thread
+                    yieldCurrentThread();
+                } else {
+                    QMutexLocker k(&_sleepMutex);
+                    while (_batches.size() == 0) {
+                        _batchesNotEmptyCond.wait(&_sleepMutex);
+                    }
+                }
+                continue;
             }
 
-            {
-                boost::shared_ptr<T> front;
-                {
-                    QMutexLocker k(&_entriesQueueMutex);
-                    if ( quit && _entriesQueue.empty() ) {
-                        _entriesQueueMutex.unlock();
-                        QMutexLocker k(&mustQuitMutex);
-                        assert(mustQuit);
-                        mustQuit = false;
-                        mustQuitCond.wakeOne();
-
-                        return;
-                    }
-                    while ( _entriesQueue.empty() ) {
-                        _entriesQueueNotEmptyCond.wait(&_entriesQueueMutex);
+            bool quit = false;
+            while ( !batch.empty() ) {
+                std::size_t chunkSize = 0;
+                while ( !batch.empty() && (chunkSize < NATRON_CACHE_DELETER_CHUNK_SIZE) ) {
+                    boost::shared_ptr<T> front;
+                    front.swap( batch.front() );
+                    batch.pop_front();
+                    ++chunkSize;
+                    if (front) {
+                        front->scheduleForDestruction();
+                    } else {
+                        quit = true;
                     }
+                } // front. After this scope, the image is guaranteed to be freed
+                _pendingEntriesCount.fetch_sub(chunkSize);
+                cache->notifyMemoryDeallocated();
+            }
 
-                    assert( !_entriesQueue.empty() );
-                    front = _entriesQueue.front();
-                    _entriesQueue.pop_front();
-                }
-                if (front) {
-                    front->scheduleForDestruction();
-                }
-            } // front. After this scope, the image is guaranteed to be freed
-            cache->notifyMemoryDeallocated();
+            if (quit) {
+                QMutexLocker k(&mustQuitMutex);
+                assert(mustQuit);
+                mustQuit = false;
+                mustQuitCond.wakeOne();
+
+                return;
+            }
         }
     }
 };
@@ -325,6 +369,208 @@ private:
 };
 
 
+/**
+ * @brief The point of this thread is to evict entries from the cache when it exceeds NATRON_CACHE_LIMIT_PERCENT
+ * so that threads allocating new entries do not pay for it. Once woken up, it evicts entries until the cache
+ * occupation goes below NATRON_CACHE_LOW_WATERMARK_PERCENT. It runs with a low priority.
+ **/
+class CacheEvictorThread
+    : public QThread
+{
+    mutable QMutex _requestMutex;
+    bool _evictionRequested; // protected by _requestMutex
+    bool _evicting; // protected by _requestMutex
+    bool _mustQuit; // protected by _requestMutex
+    QWaitCondition _evictionRequestedCond;
+    CacheAPI* cache;
+
+public:
+
+    CacheEvictorThread(CacheAPI* cache)
+        : QThread()
+        , _requestMutex()
+        , _evictionRequested(false)
+        , _evicting(false)
+        , _mustQuit(false)
+        , _evictionRequestedCond()
+        , cache(cache)
+    {
+        setObjectName( QString::fromUtf8("CacheEvictor") );
+    }
+
+    virtual ~CacheEvictorThread()
+    {
+    }
+
+    /**
+     * @brief Wake-up the thread so it evicts exceeding entries. Multiple requests made while
+     * the thread is already evicting are merged into a single one.
+     **/
+    void requestEviction()
+    {
+        {
+            QMutexLocker k(&_requestMutex);
+            if (_evictionRequested) {
+                return;
+            }
+            _evictionRequested = true;
+        }
+        if ( !isRunning() ) {
+            start(QThread::LowPriority);
+        } else {
+            QMutexLocker k(&_requestMutex);
+            _evictionRequestedCond.wakeOne();
+        }
+    }
+
+    void quitThread()
+    {
+        if ( !isRunning() ) {
+            return;
+        }
+        {
+            QMutexLocker k(&_requestMutex);
+            _mustQuit = true;
+            _evictionRequestedCond.wakeOne();
+        }
+        wait();
+        {
+            QMutexLocker k(&_requestMutex);
+            _mustQuit = false;
+        }
+    }
+
+    bool isWorking() const
+    {
+        QMutexLocker k(&_requestMutex);
+
+        return _evictionRequested || _evicting;
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        for (;; ) {
+            {
+                QMutexLocker k(&_requestMutex);
+                while (!_evictionRequested && !_mustQuit) {
+                    _evictionRequestedCond.wait(&_requestMutex);
+                }
+                if (_mustQuit) {
+                    _evictionRequested = false;
+
+                    return;
+                }
+                _evictionRequested = false;
+                _evicting = true;
+            }
+
+            cache->evictExceedingEntriesToLowWatermark();
+
+            {
+                QMutexLocker k(&_requestMutex);
+                _evicting = false;
+            }
+
+            // Wake-up threads that were waiting for memory to be released
+            cache->notifyMemoryDeallocated();
+        }
+    }
+};
+
+/**
+ * @brief Creates the next file of a tiled cache in the background, so that the thread allocating a tile
+ * does not wait for the file to be created and its disk space reserved.
+ **/
+class CacheFilePreallocatorThread
+    : public QThread
+{
+    mutable QMutex _requestMutex;
+    bool _preallocationRequested; // protected by _requestMutex
+    bool _mustQuit; // protected by _requestMutex
+    QWaitCondition _preallocationRequestedCond;
+    CacheAPI* cache;
+
+public:
+
+    CacheFilePreallocatorThread(CacheAPI* cache)
+        : QThread()
+        , _requestMutex()
+        , _preallocationRequested(false)
+        , _mustQuit(false)
+        , _preallocationRequestedCond()
+        , cache(cache)
+    {
+        setObjectName( QString::fromUtf8("CacheFilePreallocator") );
+    }
+
+    virtual ~CacheFilePreallocatorThread()
+    {
+    }
+
+    /**
+     * @brief Wake-up the thread so it creates the next cache file. Multiple requests made while
+     * the thread is already working are merged into a single one.
+     **/
+    void requestPreallocation()
+    {
+        {
+            QMutexLocker k(&_requestMutex);
+            if (_preallocationRequested) {
+                return;
+            }
+            _preallocationRequested = true;
+        }
+        if ( !isRunning() ) {
+            start(QThread::LowPriority);
+        } else {
+            QMutexLocker k(&_requestMutex);
+            _preallocationRequestedCond.wakeOne();
+        }
+    }
+
+    void quitThread()
+    {
+        if ( !isRunning() ) {
+            return;
+        }
+        {
+            QMutexLocker k(&_requestMutex);
+            _mustQuit = true;
+            _preallocationRequestedCond.wakeOne();
+        }
+        wait();
+        {
+            QMutexLocker k(&_requestMutex);
+            _mustQuit = false;
+        }
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        for (;; ) {
+            {
+                QMutexLocker k(&_requestMutex);
+                while (!_preallocationRequested && !_mustQuit) {
+                    _preallocationRequestedCond.wait(&_requestMutex);
+                }
+                if (_mustQuit) {
+                    _preallocationRequested = false;
+
+                    return;
+                }
+                _preallocationRequested = false;
+            }
+
+            cache->preallocateTileCacheFile();
+        }
+    }
+};
+
+
 class CacheSignalEmitter
     : public QObject
 {
@@ -379,6 +625,69 @@ Q_SIGNALS:
 };
 
 
+/**
+ * @brief Interface of the memory-mapped index of a tile cache, referencing the entries that were on disk
+ * when the cache was last saved (@see CachePersistentIndex in CacheSerialization.h, which implements it so
+ * that the serialization code is only compiled where the cache is saved and restored).
+ * The entries it references are only created the first time they are looked up, so that restoring
+ * the cache takes the same time whatever its size.
+ **/
+template <typename EntryType>
+class CachePersistentIndexBase
+{
+public:
+
+    typedef boost::shared_ptr<EntryType> EntryTypePtr;
+
+    virtual ~CachePersistentIndexBase() {}
+
+    /**
+     * @brief Creates the entries with the given hash that are referenced by the index and were not created yet.
+     **/
+    virtual void takeEntries(U64 hash, std::list<EntryTypePtr>* entries) = 0;
+
+    /**
+     * @brief Forgets an entry of the index that was not created yet so that its tile can be re-used.
+     * Returns false if all entries of the index were created already.
+     **/
+    virtual bool dropEntry() = 0;
+
+    /**
+     * @brief Forgets all the entries of the index that were not created yet.
+     **/
+    virtual void dropAllEntries() = 0;
+};
+
+/**
+ * @brief Eviction policy of the caches: it is scan-resistant (entries accessed several times survive a long
+ * sequence of entries accessed once, e.g: when scrubbing the timeline in the viewer) and entries that were
+ * expensive to render are given extra second chances so that the cheap ones are evicted first.
+ **/
+template <typename EntryTypePtr>
+class CacheEvictionPolicy
+    : public ScanResistantEvictionPolicy<EntryTypePtr>
+{
+public:
+
+    static unsigned int getCostCredit(const EntryTypePtr & entry)
+    {
+        double cost = entry->getRenderCost();
+
+        if (cost >= NATRON_CACHE_VERY_COSTLY_ENTRY_RENDER_TIME) {
+            return 2;
+        } else if (cost >= NATRON_CACHE_COSTLY_ENTRY_RENDER_TIME) {
+            return 1;
+        }
+
+        return 0;
+    }
+
+    static bool isPinned(const EntryTypePtr & entry)
+    {
+        return entry->isPinned();
+    }
+};
+
 /*
  * ValueType must be derived of CacheEntryHelper
  */
@@ -403,7 +712,17 @@ public:
 public:
 
 
-#ifdef USE_VARIADIC_TEMPLATES
+#ifdef NATRON_CACHE_USE_INTRUSIVE
+
+    typedef IntrusiveLRUHashTable<hash_type, EntryTypePtr, CacheEvictionPolicy<EntryTypePtr> > CacheContainer;
+    typedef typename CacheContainer::iterator CacheIterator;
+    typedef typename CacheContainer::const_iterator ConstCacheIterator;
+    static std::list<EntryTypePtr> &  getValueFromIterator(CacheIterator it)
+    {
+        return it->second;
+    }
+
+#elif defined(USE_VARIADIC_TEMPLATES)
 
 #ifdef NATRON_CACHE_USE_BOOST
 #ifdef NATRON_CACHE_USE_HASH
@@ -461,28 +780,53 @@ public:
 
 #endif // NATRON_CACHE_USE_BOOST
 
-#endif // USE_VARIADIC_TEMPLATES
+#endif // NATRON_CACHE_USE_INTRUSIVE
 
 private:
 
+    /**
+     * @brief A partition of the cache. Entries are dispatched to a shard according to their hash
+     * so that threads looking up different entries do not contend on the same lock.
+     * Each shard has its own LRU ordering: eviction visits the shards in a round-robin fashion
+     * which approximates a global LRU. No thread should ever hold the lock of 2 shards at once.
+     **/
+    struct CacheShard
+    {
+        QMutex getLock; //prevents get() and getOrCreate() to be called simultaneously on this shard
+        QMutex lock; //protects memoryCache & diskCache
+
+        /*These 2 are modified even when we call get() which is const, the shards
+           are only held by pointer so the constness does not propagate.*/
+        CacheContainer memoryCache;
+        CacheContainer diskCache;
+
+        CacheShard()
+            : getLock()
+            , lock()
+            , memoryCache()
+            , diskCache()
+        {
+        }
+    };
+
+    typedef boost::shared_ptr<CacheShard> CacheShardPtr;
 
-    std::size_t _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
-    std::size_t _maximumCacheSize;     // maximum size allowed for the cache
+    boost::atomic<std::size_t> _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
+    boost::atomic<std::size_t> _maximumCacheSize;     // maximum size allowed for the cache
 
     /*mutable because we need to change modify it in the sealEntryInternal function which
          is called by an external object that have a const ref to the cache.
+       These are atomics so that allocation notifications coming from many render threads do not serialize.
      */
-    mutable std::size_t _memoryCacheSize;     // current size of the cache in bytes
-    mutable std::size_t _diskCacheSize;
-    mutable QMutex _sizeLock; // protects _memoryCacheSize & _diskCacheSize & _maximumInMemorySize & _maximumCacheSize
-    mutable QMutex _lock; //protects _memoryCache & _diskCache
-    mutable QMutex _getLock;  //prevents get() and getOrCreate() to be called simultaneously
+    mutable boost::atomic<std::size_t> _memoryCacheSize;     // current size of the cache in bytes
+    mutable boost::atomic<std::size_t> _diskCacheSize;
+    mutable QMutex _sizeLock; // used along with _memoryFullCondition only
 
+    // The shards, this vector is never modified after the constructor
+    std::vector<CacheShardPtr> _shards;
 
-    /*These 2 are mutable because we need to modify the LRU list even
-         when we call get() and we want this function to be const.*/
-    mutable CacheContainer _memoryCache;
-    mutable CacheContainer _diskCache;
+    // Index of the next shard to evict from
+    mutable boost::atomic<unsigned int> _evictionShardIndex;
     const std::string _cacheName;
     const unsigned int _version;
 
@@ -496,6 +840,8 @@ private:
     mutable DeleterThread<EntryType> _deleterThread;
     mutable QWaitCondition _memoryFullCondition; //< protected by _sizeLock
     mutable CacheCleanerThread _cleanerThread;
+    mutable CacheEvictorThread _evictorThread;
+    mutable CacheFilePreallocatorThread _preallocatorThread;
 
     // If tiled, the cache will consist only of a few large files that each contain tiles of the same size.
     // This is useful to cache chunks of data that always have the same size.
@@ -509,16 +855,44 @@ private:
     // Used when the cache is tiled
     std::set<TileCacheFilePtr> _cacheFiles;
 
-    // When set these are used for fast search of a free tile
-    TileCacheFileWPtr _nextAvailableCacheFile;
-    int _nextAvailableCacheFileIndex;
+    // The files that may have a free tile, so that allocTile() does not have to scan all files.
+    // A file is in this list at most once, see TileCacheFile::queuedInCache
+    std::list<TileCacheFilePtr> _cacheFilesWithFreeTiles;
+
+    // The next cache file, created by the preallocator thread. It is not in _cacheFiles until a tile is allocated in it
+    TileCacheFilePtr _preallocatedCacheFile;
+
+    // Used to name the cache files, so that a file created by the preallocator thread and one created by allocTile() do not collide
+    int _nextCacheFileIndex;
+
+    // The index of the entries saved on disk the last time, only used when the cache is tiled
+    typedef boost::shared_ptr<CachePersistentIndexBase<EntryType> > CachePersistentIndexPtr;
+    mutable QMutex _persistentIndexMutex;
+    CachePersistentIndexPtr _persistentIndex; // protected by _persistentIndexMutex
+
+    // When set, the cold in-memory entries are compressed once before being evicted from the RAM
+    boost::atomic<bool> _compressionEnabled;
+
+    // The holders whose entries are pinned, with their cache ID, see setHolderPinned()
+    mutable QMutex _pinnedHoldersMutex;
+    std::map<const CacheEntryHolder*, std::string> _pinnedHolders; // protected by _pinnedHoldersMutex
+    mutable boost::atomic<std::size_t> _nPinnedHolders;
+
+    template <typename T>
+    friend class CachePersistentIndex;
+
 public:
 
 
+    /**
+     * @param shardsCount The number of partitions of the cache, each one being protected by its own lock.
+     * 1 means that all entries share the same lock and the same LRU list.
+     **/
     Cache(const std::string & cacheName,
           unsigned int version,
           U64 maximumCacheSize,      // total size
-          double maximumInMemoryPercentage //how much should live in RAM
+          double maximumInMemoryPercentage, //how much should live in RAM
+          unsigned int shardsCount = 1
           )
         : CacheAPI()
         , _maximumInMemorySize(maximumCacheSize * maximumInMemoryPercentage)
@@ -526,10 +900,8 @@ public:
         , _memoryCacheSize(0)
         , _diskCacheSize(0)
         , _sizeLock()
-        , _lock()
-        , _getLock()
-        , _memoryCache()
-        , _diskCache()
+        , _shards()
+        , _evictionShardIndex(0)
         , _cacheName(cacheName)
         , _version(version)
         , _signalEmitter()
@@ -538,24 +910,57 @@ public:
         , _deleterThread(this)
         , _memoryFullCondition()
         , _cleanerThread(this)
+        , _evictorThread(this)
+        , _preallocatorThread(this)
         , _tileCacheMutex()
         , _isTiled(false)
         , _tileByteSize(0)
         , _clearingCache(false)
         , _cacheFiles()
-        , _nextAvailableCacheFile()
-        , _nextAvailableCacheFileIndex(-1)
+        , _cacheFilesWithFreeTiles()
+        , _preallocatedCacheFile()
+        , _nextCacheFileIndex(0)
+        , _persistentIndexMutex()
+        , _persistentIndex()
+        , _compressionEnabled(false)
+        , _pinnedHoldersMutex()
+        , _pinnedHolders()
+        , _nPinnedHolders(0)
     {
         _signalEmitter = boost::make_shared<CacheSignalEmitter>();
+        shardsCount = std::max(1u, std::min(shardsCount, (unsigned int)NATRON_CACHE_MAX_SHARDS_COUNT));
+        for (unsigned int i = 0; i < shardsCount; ++i) {
+            _shards.push_back( boost::make_shared<CacheShard>() );
+        }
     }
 
     virtual ~Cache()
     {
-        QMutexLocker locker(&_lock);
-
         _tearingDown = true;
-        _memoryCache.clear();
-        _diskCache.clear();
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            QMutexLocker locker(&_shards[i]->lock);
+            _shards[i]->memoryCache.clear();
+            _shards[i]->diskCache.clear();
+        }
+    }
+
+    /**
+     * @brief Returns a number of shards suitable for a cache accessed concurrently by all render threads
+     **/
+    static unsigned int getDefaultShardsCount()
+    {
+        int nThreads = std::max(1, QThread::idealThreadCount());
+        unsigned int ret = 1;
+        while ( (int)ret < nThreads && ret < NATRON_CACHE_MAX_SHARDS_COUNT ) {
+            ret *= 2;
+        }
+
+        return ret;
+    }
+
+    unsigned int getShardsCount() const
+    {
+        return (unsigned int)_shards.size();
     }
 
     virtual bool isTileCache() const OVERRIDE FINAL
@@ -583,10 +988,28 @@ public:
     }
 
 
+    /**
+     * @brief When enabled, the least recently used entries living in RAM are first compressed before being
+     * evicted: they get another chance to be used while taking less memory. Entries stored on disk or as OpenGL
+     * textures are never compressed.
+     **/
+    void setCompressionEnabled(bool enabled)
+    {
+        _compressionEnabled.store(enabled);
+    }
+
+    bool isCompressionEnabled() const
+    {
+        return _compressionEnabled.load();
+    }
+
     void waitForDeleterThread()
     {
+        // The evictor feeds the deleter thread, stop it first
+        _evictorThread.quitThread();
         _deleterThread.quitThread();
         _cleanerThread.quitThread();
+        _preallocatorThread.quitThread();
     }
 
     /**
@@ -603,13 +1026,18 @@ public:
     bool get(const typename EntryType::key_type & key,
              std::list<EntryTypePtr>* returnValue) const
     {
+        CacheShard& shard = getShard( key.getHash() );
+
         ///Be atomic, so it cannot be created by another thread in the meantime
-        QMutexLocker getlocker(&_getLock);
+        QMutexLocker getlocker(&shard.getLock);
 
-        ///lock the cache before reading it.
-        QMutexLocker locker(&_lock);
+        ///lock the shard before reading it.
+        QMutexLocker locker(&shard.lock);
 
-        return getInternal(key, returnValue);
+        bool found = getInternal(shard, key, returnValue);
+        PerfCounters::increment(found ? ePerfCounterCacheHits : ePerfCounterCacheMisses);
+
+        return found;
     } // get
 
 private:
@@ -623,36 +1051,155 @@ private:
         if (!_isTiled) {
             throw std::logic_error("allocTile() but cache is not tiled!");
         }
+        TileCacheFilePtr ret = openTileCacheFile(filepath);
+        if (!ret) {
+            return ret;
+        }
+        int index = dataOffset / _tileByteSize;
+
+        // The dataOffset should be a multiple of the tile size
+        assert(_tileByteSize * index == dataOffset);
+        assert(index >= 0 && index < (int)ret->usedTiles.size());
+        assert(!ret->usedTiles[index]);
+        ret->usedTiles[index] = true;
+
+        // The entry referenced by the persistent index is now created
+        ret->indexedTiles[index] = false;
+
+        return ret;
+    }
+
+    /**
+     * @brief Returns the tile file at the given path, opening it if needed. Returns NULL if the file does not exist.
+     * The _tileCacheMutex must be locked.
+     **/
+    TileCacheFilePtr openTileCacheFile(const std::string& filepath)
+    {
+        assert( !_tileCacheMutex.tryLock() );
         for (std::set<TileCacheFilePtr>::iterator it = _cacheFiles.begin(); it != _cacheFiles.end(); ++it) {
             if ((*it)->file->path() == filepath) {
-                int index = dataOffset / _tileByteSize;
-
-                // The dataOffset should be a multiple of the tile size
-                assert(_tileByteSize * index == dataOffset);
-                assert(!(*it)->usedTiles[index]);
-                (*it)->usedTiles[index] = true;
                 return *it;
             }
         }
         if (!fileExists(filepath)) {
             return TileCacheFilePtr();
-        } else {
-            TileCacheFilePtr ret = boost::make_shared<TileCacheFile>();
-            ret->file = boost::make_shared<MemoryFile>(filepath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseFail);
-            std::size_t nTilesPerFile = std::floor( ( (double)NATRON_TILE_CACHE_FILE_SIZE_BYTES ) / _tileByteSize );
-            ret->usedTiles.resize(nTilesPerFile, false);
-            int index = dataOffset / _tileByteSize;
-
-            // The dataOffset should be a multiple of the tile size
-            assert(_tileByteSize * index == dataOffset);
-            assert(index >= 0 && index < (int)ret->usedTiles.size());
-            assert(!ret->usedTiles[index]);
-            ret->usedTiles[index] = true;
-            _cacheFiles.insert(ret);
-            return ret;
+        }
+        TileCacheFilePtr ret = boost::make_shared<TileCacheFile>();
+        ret->file = boost::make_shared<MemoryFile>(filepath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseFail);
+        std::size_t nTilesPerFile = std::floor( ( (double)NATRON_TILE_CACHE_FILE_SIZE_BYTES ) / _tileByteSize );
+        initTileCacheFile(ret, nTilesPerFile);
+        _cacheFiles.insert(ret);
+
+        return ret;
+    }
 
+    /**
+     * @brief Sets up the bitsets and the free list of a new tile file: all tiles are free.
+     * The _tileCacheMutex must be locked.
+     **/
+    void initTileCacheFile(const TileCacheFilePtr& file, std::size_t nTilesPerFile)
+    {
+        file->usedTiles.resize(nTilesPerFile, false);
+        file->indexedTiles.resize(nTilesPerFile, false);
+        file->queuedFreeTiles.resize(nTilesPerFile, true);
+        file->freeTiles.resize(nTilesPerFile);
+        // Push in reverse order so that tiles are handed out from the start of the file
+        for (std::size_t i = 0; i < nTilesPerFile; ++i) {
+            file->freeTiles[i] = (int)(nTilesPerFile - 1 - i);
         }
+        if (nTilesPerFile > 0) {
+            file->queuedInCache = true;
+            _cacheFilesWithFreeTiles.push_back(file);
+        }
+    }
 
+    /**
+     * @brief Makes the tile at the given index a candidate for allocTile() again.
+     * The _tileCacheMutex must be locked.
+     **/
+    void pushFreeTile(const TileCacheFilePtr& file, int index)
+    {
+        if (!file->queuedFreeTiles[index]) {
+            file->queuedFreeTiles[index] = true;
+            file->freeTiles.push_back(index);
+        }
+        if (!file->queuedInCache) {
+            file->queuedInCache = true;
+            _cacheFilesWithFreeTiles.push_back(file);
+        }
+    }
+
+    /**
+     * @brief Pops a tile that is neither used nor referenced by the persistent index from the free lists.
+     * Indices that were taken by getTileCacheFile() or reserveIndexedTile() since they were pushed are dropped.
+     * Returns false if no file has a free tile.
+     * The _tileCacheMutex must be locked.
+     **/
+    bool popFreeTile(TileCacheFilePtr* file, int* index)
+    {
+        while ( !_cacheFilesWithFreeTiles.empty() ) {
+            const TileCacheFilePtr& front = _cacheFilesWithFreeTiles.front();
+            while ( !front->freeTiles.empty() ) {
+                int i = front->freeTiles.back();
+                front->freeTiles.pop_back();
+                front->queuedFreeTiles[i] = false;
+                if ( !front->usedTiles[i] && !front->indexedTiles[i] ) {
+                    *file = front;
+                    *index = i;
+
+                    return true;
+                }
+            }
+            front->queuedInCache = false;
+            _cacheFilesWithFreeTiles.pop_front();
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Marks the tile at the given offset of the given file as referenced by the persistent index,
+     * so that allocTile() does not hand it out. Returns false if the file does not exist or the tile is already taken.
+     **/
+    bool reserveIndexedTile(const std::string& filepath, std::size_t dataOffset)
+    {
+        QMutexLocker k(&_tileCacheMutex);
+        TileCacheFilePtr file;
+
+        try {
+            file = openTileCacheFile(filepath);
+        } catch (const std::exception& e) {
+            qDebug() << "Failed to open cache file:" << e.what();
+
+            return false;
+        }
+        std::size_t index = dataOffset / _tileByteSize;
+        if ( !file || (_tileByteSize * index != dataOffset) || (index >= file->usedTiles.size()) ||
+             file->usedTiles[index] || file->indexedTiles[index] ) {
+            return false;
+        }
+        file->indexedTiles[index] = true;
+
+        return true;
+    }
+
+    /**
+     * @brief Makes available again a tile that was reserved with reserveIndexedTile(), if it is still reserved.
+     **/
+    void releaseIndexedTile(const std::string& filepath, std::size_t dataOffset)
+    {
+        QMutexLocker k(&_tileCacheMutex);
+        for (std::set<TileCacheFilePtr>::iterator it = _cacheFiles.begin(); it != _cacheFiles.end(); ++it) {
+            if ((*it)->file->path() == filepath) {
+                std::size_t index = dataOffset / _tileByteSize;
+                if ( ( index < (*it)->indexedTiles.size() ) && (*it)->indexedTiles[index] ) {
+                    (*it)->indexedTiles[index] = false;
+                    pushFreeTile(*it, (int)index);
+                }
+
+                return;
+            }
+        }
     }
 
     /**
@@ -672,56 +1219,34 @@ private:
         if (!_isTiled) {
             throw std::logic_error("allocTile() but cache is not tiled!");
         }
-        // First, search for a file with available space.
+        // First, pick a free tile from the files with available space.
         // If not found create one
         TileCacheFilePtr foundAvailableFile;
         int foundTileIndex = -1;
-        {
-            foundAvailableFile = _nextAvailableCacheFile.lock();
-            if (_nextAvailableCacheFileIndex != -1 && foundAvailableFile) {
-                foundTileIndex = _nextAvailableCacheFileIndex;
-                *dataOffset = foundTileIndex * _tileByteSize;
-                _nextAvailableCacheFileIndex = -1;
-                _nextAvailableCacheFile.reset();
+        if ( popFreeTile(&foundAvailableFile, &foundTileIndex) ) {
+            *dataOffset = foundTileIndex * _tileByteSize;
+        } else {
+            // All space is taken: use the file created ahead by the preallocator thread, or create one
+            // if it did not have time to do it.
+            if (_preallocatedCacheFile) {
+                foundAvailableFile = _preallocatedCacheFile;
+                _preallocatedCacheFile.reset();
             } else {
-                foundTileIndex = -1;
-                foundAvailableFile.reset();
-            }
-        }
-        if (foundTileIndex == -1) {
-            for (std::set<TileCacheFilePtr>::iterator it = _cacheFiles.begin(); it != _cacheFiles.end(); ++it) {
-                for (std::size_t i = 0; i < (*it)->usedTiles.size(); ++i) {
-                    if (!(*it)->usedTiles[i])  {
-                        foundTileIndex = i;
-                        *dataOffset = i * _tileByteSize;
-                        break;
-                    }
-                }
-                if (foundTileIndex != -1) {
-                    foundAvailableFile = *it;
-                    break;
-                }
+                foundAvailableFile = createTileCacheFile( getNextTileCacheFilePath() );
             }
-        }
-
-        if (!foundAvailableFile) {
-            // Create a file if all space is taken
-            foundAvailableFile = boost::make_shared<TileCacheFile>();
-            int nCacheFiles = (int)_cacheFiles.size();
-            std::stringstream cacheFilePathSs;
-            cacheFilePathSs << getCachePath().toStdString() << "/CachePart" << nCacheFiles;
-            std::string cacheFilePath = cacheFilePathSs.str();
-            foundAvailableFile->file = boost::make_shared<MemoryFile>(cacheFilePath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate);
-
-            std::size_t nTilesPerFile = std::floor(((double)NATRON_TILE_CACHE_FILE_SIZE_BYTES) / _tileByteSize);
-            std::size_t cacheFileSize = nTilesPerFile * _tileByteSize;
-            foundAvailableFile->file->resize(cacheFileSize);
-            foundAvailableFile->usedTiles.resize(nTilesPerFile, false);
-            *dataOffset = 0;
-            foundTileIndex = 0;
+            std::size_t nTilesPerFile = foundAvailableFile->file->size() / _tileByteSize;
+            initTileCacheFile(foundAvailableFile, nTilesPerFile);
             _cacheFiles.insert(foundAvailableFile);
-            _nextAvailableCacheFile = foundAvailableFile;
-            _nextAvailableCacheFileIndex = 1;
+
+            // Prepare the file after this one
+            _preallocatorThread.requestPreallocation();
+
+            TileCacheFilePtr newFile;
+            if ( !popFreeTile(&newFile, &foundTileIndex) ) {
+                throw std::runtime_error("The tile size is larger than a cache file");
+            }
+            assert(newFile == foundAvailableFile && foundTileIndex == 0);
+            *dataOffset = foundTileIndex * _tileByteSize;
         }
 
         // Notify the memory file that this portion of the file is valid
@@ -755,20 +1280,101 @@ private:
 
         // If the file does not have any tile associated, remove it
         // A use_count of 2 means that the tile file is only referenced by the cache itself and the entry calling
-        // the freeTile() function, hence once its freed, no tile should be using it anymore
-        if ((*foundTileFile).use_count() <= 2) {
+        // the freeTile() function, hence once its freed, no tile should be using it anymore.
+        // The list of files with free tiles holds one more reference.
+        long useCount = (*foundTileFile).use_count() - ( (*foundTileFile)->queuedInCache ? 1 : 0 );
+        if (useCount <= 2) {
             // Do not remove the file except if we are clearing the cache
             if (_clearingCache) {
                 (*foundTileFile)->file->remove();
+                if ( (*foundTileFile)->queuedInCache ) {
+                    _cacheFilesWithFreeTiles.remove(*foundTileFile);
+                }
                 _cacheFiles.erase(foundTileFile);
-            } else {
-                // Invalidate this portion of the cache
-                (*foundTileFile)->file->flush(MemoryFile::eFlushTypeInvalidate, (*foundTileFile)->file->data() + dataOffset, _tileByteSize);
+
+                return;
             }
-        } else {
-            _nextAvailableCacheFile = *foundTileFile;
-            _nextAvailableCacheFileIndex = index;
         }
+        // Invalidate this portion of the cache. For large tiles, also give the disk blocks back so that
+        // the disk usage follows the size of the cache.
+        char* tileData = (*foundTileFile)->file->data() + dataOffset;
+        if ( (_tileByteSize < NATRON_TILE_CACHE_DISCARD_MIN_BYTES) || !(*foundTileFile)->file->discard(tileData, _tileByteSize) ) {
+            (*foundTileFile)->file->flush(MemoryFile::eFlushTypeInvalidate, tileData, _tileByteSize);
+        }
+        pushFreeTile(*foundTileFile, index);
+    }
+
+    /**
+     * @brief Returns the path of a cache file that is not opened yet.
+     * The _tileCacheMutex must be locked.
+     **/
+    std::string getNextTileCacheFilePath()
+    {
+        assert( !_tileCacheMutex.tryLock() );
+        for (;;) {
+            std::stringstream cacheFilePathSs;
+            cacheFilePathSs << getCachePath().toStdString() << "/CachePart" << _nextCacheFileIndex;
+            ++_nextCacheFileIndex;
+            std::string cacheFilePath = cacheFilePathSs.str();
+            bool isOpened = false;
+            for (std::set<TileCacheFilePtr>::const_iterator it = _cacheFiles.begin(); it != _cacheFiles.end(); ++it) {
+                if ( (*it)->file->path() == cacheFilePath ) {
+                    isOpened = true;
+                    break;
+                }
+            }
+            if (!isOpened) {
+                return cacheFilePath;
+            }
+        }
+    }
+
+    /**
+     * @brief Creates a cache file holding as many tiles as possible and reserves its disk space.
+     * The file is not added to _cacheFiles.
+     **/
+    TileCacheFilePtr createTileCacheFile(const std::string& cacheFilePath) const
+    {
+        TileCacheFilePtr ret = boost::make_shared<TileCacheFile>();
+        ret->file = boost::make_shared<MemoryFile>(cacheFilePath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate);
+
+        std::size_t nTilesPerFile = std::floor(((double)NATRON_TILE_CACHE_FILE_SIZE_BYTES) / _tileByteSize);
+        std::size_t cacheFileSize = nTilesPerFile * _tileByteSize;
+        ret->file->resize(cacheFileSize);
+        // If the file system cannot reserve the space, blocks are allocated as tiles are written
+        ret->file->allocateDiskSpace();
+
+        return ret;
+    }
+
+    virtual void preallocateTileCacheFile() OVERRIDE FINAL
+    {
+        std::string cacheFilePath;
+        {
+            QMutexLocker k(&_tileCacheMutex);
+            if (!_isTiled || _clearingCache || _preallocatedCacheFile) {
+                return;
+            }
+            cacheFilePath = getNextTileCacheFilePath();
+        }
+
+        // Creating the file and reserving its space is slow, do it without holding the lock
+        TileCacheFilePtr file;
+        try {
+            file = createTileCacheFile(cacheFilePath);
+        } catch (const std::exception& e) {
+            qDebug() << "Failed to create cache file:" << e.what();
+
+            return;
+        }
+
+        QMutexLocker k(&_tileCacheMutex);
+        if (_clearingCache || _preallocatedCacheFile) {
+            file->file->remove();
+
+            return;
+        }
+        _preallocatedCacheFile = file;
     }
 
 
@@ -777,7 +1383,7 @@ private:
                         ImageLockerHelper<EntryType>* entryLocker,
                         EntryTypePtr* returnValue) const
     {
-        //_lock must not be taken here
+        //No shard lock must be taken here
 
         ///Before allocating the memory check that there's enough space to fit in memory
         appPTR->checkCacheFreeMemoryIsGoodEnough();
@@ -796,89 +1402,27 @@ private:
             ++safeCounter;
         }
 
-        U64 memoryCacheSize, maximumInMemorySize;
-        {
-            QMutexLocker k(&_sizeLock);
-            memoryCacheSize = _memoryCacheSize;
-            maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-        }
-        {
-            QMutexLocker locker(&_lock);
-            std::list<EntryTypePtr> entriesToBeDeleted;
-            double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
-            ///While the current cache size can't fit the new entry, erase the last recently used entries.
-            ///Also if the total free RAM is under the limit of the system free RAM to keep free, erase LRU entries.
-            while (occupationPercentage > NATRON_CACHE_LIMIT_PERCENT) {
-                std::list<EntryTypePtr> deleted;
-                if ( !tryEvictInMemoryEntry(deleted) ) {
-                    break;
-                }
-
-                for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
-                    entriesToBeDeleted.push_back(*it);
-                    memoryCacheSize -= (*it)->size();
-                }
-
-                occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
-            }
-
-            if ( !entriesToBeDeleted.empty() ) {
-                ///Launch a separate thread whose function will be to delete all the entries to be deleted
-                _deleterThread.appendToQueue(entriesToBeDeleted);
-
-                ///Clearing the list here will not delete the objects pointing to by the shared_ptr's because we made a copy
-                ///that the separate thread will delete
-                entriesToBeDeleted.clear();
-            }
+        ///While the current cache size can't fit the new entry, the evictor thread erases the last recently used entries.
+        ///For tiled caches, we insert directly into the disk cache, so the evictor also makes sure there is room for it.
+        ///The eviction itself is not done here so that the thread allocating the entry does not pay for it.
+        if ( isAboveOccupationPercentage(NATRON_CACHE_LIMIT_PERCENT) ) {
+            _evictorThread.requestEviction();
         }
         {
             //If _maximumcacheSize == 0 we don't return 1 otherwise we would cause a deadlock
             QMutexLocker k(&_sizeLock);
-            double occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+            double occupationPercentage = getMemoryOccupationOfMaximumCacheSize();
 
-            //_memoryCacheSize member will get updated while images are being destroyed by the parallel thread.
+            //_memoryCacheSize member will get updated while images are being evicted and destroyed by the parallel threads.
             //we wait for cache memory occupation to be < 100% to be sure we don't hit swap here
-            while ( occupationPercentage >= 1. && _deleterThread.isWorking() ) {
+            while ( occupationPercentage >= 1. && ( _evictorThread.isWorking() || _deleterThread.isWorking() ) ) {
                 _memoryFullCondition.wait(&_sizeLock);
-                occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+                occupationPercentage = getMemoryOccupationOfMaximumCacheSize();
             }
         }
-        if (_isTiled) {
-
-            QMutexLocker locker(&_lock);
-            // For tiled caches, we insert directly into the disk cache, so make sure there is room for it
-            std::list<EntryTypePtr> entriesToBeDeleted;
-            U64 diskCacheSize, maximumDiskCacheSize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize - _maximumInMemorySize );
-            }
-            double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
-            while (diskPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
-                std::list<EntryTypePtr> deleted;
-                if ( !tryEvictDiskEntry(deleted) ) {
-                    break;
-                }
-
-                for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
-                    diskCacheSize -= (*it)->size();
-                    entriesToBeDeleted.push_back(*it);
-                }
-                diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
-            }
-            if ( !entriesToBeDeleted.empty() ) {
-                ///Launch a separate thread whose function will be to delete all the entries to be deleted
-                _deleterThread.appendToQueue(entriesToBeDeleted);
-
-                ///Clearing the list here will not delete the objects pointing to by the shared_ptr's because we made a copy
-                ///that the separate thread will delete
-                entriesToBeDeleted.clear();
-            }
-
-        }
         {
-            QMutexLocker locker(&_lock);
+            CacheShard& shard = getShard( key.getHash() );
+            QMutexLocker locker(&shard.lock);
 
             try {
                 returnValue->reset( new EntryType(key, params, this ) );
@@ -893,11 +1437,15 @@ private:
 
             if (*returnValue) {
 
+                if ( (_nPinnedHolders.load() > 0) && isHolderIDPinned( key.getCacheHolderID() ) ) {
+                    (*returnValue)->setPinned(true);
+                }
+
                 // If there is a lock, lock it before exposing the entry to other threads
                 if (entryLocker) {
                     entryLocker->lock(*returnValue);
                 }
-                sealEntry(*returnValue, _isTiled ? false : true);
+                sealEntry(shard, *returnValue, _isTiled ? false : true);
             }
         }
     } // createInternal
@@ -907,13 +1455,16 @@ public:
     void swapOrInsert(const EntryTypePtr& entryToBeEvicted,
                       const EntryTypePtr& newEntry)
     {
-        QMutexLocker locker(&_lock);
-
         const typename EntryType::key_type& key = entryToBeEvicted->getKey();
         typename EntryType::hash_type hash = entryToBeEvicted->getHashKey();
+
+        // Both entries have the same key, hence they belong to the same shard
+        CacheShard& shard = getShard(hash);
+        QMutexLocker locker(&shard.lock);
+
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache(hash);
-        if ( memoryCached != _memoryCache.end() ) {
+        CacheIterator memoryCached = shard.memoryCache(hash);
+        if ( memoryCached != shard.memoryCache.end() ) {
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
             for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                 if ( ( (*it)->getKey() == key ) && ( (*it)->getParams() == entryToBeEvicted->getParams() ) ) {
@@ -925,8 +1476,8 @@ public:
             ret.push_back(newEntry);
         } else {
             ///Look in disk cache
-            CacheIterator diskCached = _diskCache(hash);
-            if ( diskCached != _diskCache.end() ) {
+            CacheIterator diskCached = shard.diskCache(hash);
+            if ( diskCached != shard.diskCache.end() ) {
                 ///Remove the old entry
                 std::list<EntryTypePtr> & ret = getValueFromIterator(diskCached);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
@@ -937,7 +1488,7 @@ public:
                 }
             }
             ///Insert in mem cache
-            _memoryCache.insert(hash, newEntry);
+            shard.memoryCache.insert(hash, newEntry);
         }
     }
 
@@ -977,24 +1528,28 @@ public:
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
 
         {
+            CacheShard& shard = getShard( key.getHash() );
+
             ///Be atomic, so it cannot be created by another thread in the meantime
-            QMutexLocker getlocker(&_getLock);
+            QMutexLocker getlocker(&shard.getLock);
             std::list<EntryTypePtr> entries;
             bool didGetSucceed;
             {
-                QMutexLocker locker(&_lock);
-                didGetSucceed = getInternal(key, &entries);
+                QMutexLocker locker(&shard.lock);
+                didGetSucceed = getInternal(shard, key, &entries);
             }
             if (didGetSucceed) {
                 for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
                     if (*(*it)->getParams() == *params) {
                         *returnValue = *it;
+                        PerfCounters::increment(ePerfCounterCacheHits);
 
                         return true;
                     }
                 }
             }
 
+            PerfCounters::increment(ePerfCounterCacheMisses);
             createInternal(key, params, locker, returnValue);
 
             return false;
@@ -1009,6 +1564,10 @@ public:
         {
             QMutexLocker k(&_tileCacheMutex);
             _clearingCache = true;
+            if (_preallocatedCacheFile) {
+                _preallocatedCacheFile->file->remove();
+                _preallocatedCacheFile.reset();
+            }
         }
         clearDiskPortion();
 
@@ -1017,14 +1576,25 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
-                evictedFromMemory.second->removeAnyBackingFile();
+        // The RAM of the entries is released by the deleter thread, so that clearing a large cache does not stall
+        // the caller. Entries stored on disk are destroyed right away: their tiles must be freed while clearing.
+        std::list<EntryTypePtr> entriesToBeDeleted;
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+            while (evictedFromMemory.second) {
+                if ( evictedFromMemory.second->isStoredOnDisk() ) {
+                    if (!_isTiled) {
+                        evictedFromMemory.second->removeAnyBackingFile();
+                    }
+                } else {
+                    entriesToBeDeleted.push_back(evictedFromMemory.second);
+                }
+                evictedFromMemory = shard.memoryCache.evict();
             }
-            evictedFromMemory = _memoryCache.evict();
         }
+        _deleterThread.appendToQueue(entriesToBeDeleted);
 
         if (_signalEmitter) {
             _signalEmitter->blockSignals(false);
@@ -1047,21 +1617,25 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-
-        /// An entry which has a use_count greater than 1 is not removable:
-        /// The backing file must not be removed because it might be read/written to
-        /// at the same time. The best we can do is just let it here in the cache.
-        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-        //we'll let the user of these entries purge the extra entries left in the cache later on
-        while (evictedFromDisk.second) {
-            if (!_isTiled) {
-                evictedFromDisk.second->removeAnyBackingFile();
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+
+            /// An entry which has a use_count greater than 1 is not removable:
+            /// The backing file must not be removed because it might be read/written to
+            /// at the same time. The best we can do is just let it here in the cache.
+            std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
+            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+            //we'll let the user of these entries purge the extra entries left in the cache later on
+            while (evictedFromDisk.second) {
+                if (!_isTiled) {
+                    evictedFromDisk.second->removeAnyBackingFile();
+                }
+                evictedFromDisk = shard.diskCache.evict();
             }
-            evictedFromDisk = _diskCache.evict();
         }
 
+        dropPersistentIndex();
 
         _signalEmitter->blockSignals(false);
         _signalEmitter->emitClearedDiskPortion();
@@ -1076,27 +1650,22 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            // Move back the entry on disk if it can be store on disk
-            // For tiled caches, the tile is sharing the same file with other entries
-            // so we cannot close it, just remove the entry
-            if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
-                evictedFromMemory.second->deallocate();
-                /*insert it back into the disk portion */
-
-                U64 diskCacheSize, maximumCacheSize;
-                {
-                    QMutexLocker k(&_sizeLock);
-                    diskCacheSize = _diskCacheSize;
-                    maximumCacheSize = _maximumCacheSize;
-                }
-
-                /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
-                while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
-                    {
-                        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
+        std::list<EntryTypePtr> entriesToBeDeleted;
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+            while (evictedFromMemory.second) {
+                // Move back the entry on disk if it can be store on disk
+                // For tiled caches, the tile is sharing the same file with other entries
+                // so we cannot close it, just remove the entry
+                if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
+                    evictedFromMemory.second->deallocate();
+                    /*insert it back into the disk portion */
+
+                    /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
+                    while (_diskCacheSize.load() + evictedFromMemory.second->size() >= _maximumCacheSize.load()) {
+                        std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
                         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
                         //we'll let the user of these entries purge the extra entries left in the cache later on
                         if (!evictedFromDisk.second) {
@@ -1105,23 +1674,22 @@ public:
                         ///Erase the file from the disk if we reach the limit.
                         evictedFromDisk.second->removeAnyBackingFile();
                     }
-                    {
-                        QMutexLocker k(&_sizeLock);
-                        diskCacheSize = _diskCacheSize;
-                        maximumCacheSize = _maximumCacheSize;
+
+                    /*update the disk cache size*/
+                    CacheIterator existingDiskCacheEntry = shard.diskCache( evictedFromMemory.second->getHashKey() );
+                    /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
+                    if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                        shard.diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
                     }
+                } else if ( !evictedFromMemory.second->isStoredOnDisk() ) {
+                    // Do not release the RAM under the lock, let the deleter thread do it
+                    entriesToBeDeleted.push_back(evictedFromMemory.second);
                 }
 
-                /*update the disk cache size*/
-                CacheIterator existingDiskCacheEntry = _diskCache( evictedFromMemory.second->getHashKey() );
-                /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-                if ( existingDiskCacheEntry == _diskCache.end() ) {
-                    _diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
-                }
+                evictedFromMemory = shard.memoryCache.evict();
             }
-
-            evictedFromMemory = _memoryCache.evict();
         }
+        _deleterThread.appendToQueue(entriesToBeDeleted);
 
         _signalEmitter->blockSignals(false);
         if (emitSignals) {
@@ -1129,58 +1697,13 @@ public:
         }
     } // clearInMemoryPortion
 
+    /**
+     * @brief Evicts the last recently used entries until the cache occupation is below NATRON_CACHE_LIMIT_PERCENT.
+     * This is done on the calling thread.
+     **/
     void clearExceedingEntries()
     {
-        ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
-        ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
-        std::list<EntryTypePtr> entriesToBeDeleted;
-
-        {
-            QMutexLocker locker(&_lock);
-            U64 memoryCacheSize, maximumInMemorySize;
-            {
-                QMutexLocker k(&_sizeLock);
-                memoryCacheSize = _memoryCacheSize;
-                maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-            }
-            double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
-            while (occupationPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
-                std::list<EntryTypePtr> deleted;
-                if ( !tryEvictInMemoryEntry(deleted) ) {
-                    break;
-                }
-
-                for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
-                    if ( !(*it)->isStoredOnDisk() ) {
-                        memoryCacheSize -= (*it)->size();
-                    }
-                    entriesToBeDeleted.push_back(*it);
-                }
-                occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
-            }
-
-            U64 diskCacheSize, maximumDiskCacheSize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize - _maximumInMemorySize );
-            }
-            double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
-            while (diskPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
-                std::list<EntryTypePtr> deleted;
-                if ( !tryEvictDiskEntry(deleted) ) {
-                    break;
-                }
-
-                for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
-                    diskCacheSize -= (*it)->size();
-                    entriesToBeDeleted.push_back(*it);
-                }
-                diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
-            }
-            
-
-        }
+        evictExceedingEntries(NATRON_CACHE_LIMIT_PERCENT);
     }
 
     /**
@@ -1190,15 +1713,18 @@ public:
      **/
     void getCopy(std::list<EntryTypePtr>* copy) const
     {
-        QMutexLocker locker(&_lock);
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
 
-        for (CacheIterator it = _memoryCache.begin(); it != _memoryCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
-        }
-        for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
+            for (CacheIterator it = shard.memoryCache.begin(); it != shard.memoryCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
+            for (CacheIterator it = shard.diskCache.begin(); it != shard.diskCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
         }
     }
 
@@ -1212,13 +1738,8 @@ public:
         ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
         std::list<EntryTypePtr> entriesToBeDeleted;
-        bool ret;
-        {
-            QMutexLocker locker(&_lock);
-            ret = tryEvictInMemoryEntry(entriesToBeDeleted);
-        }
 
-        return ret;
+        return tryEvictInMemoryEntryFromAnyShard(entriesToBeDeleted);
     }
 
     /**
@@ -1228,10 +1749,9 @@ public:
      **/
     bool evictLRUDiskEntry() const
     {
-
-        QMutexLocker locker(&_lock);
         std::list<EntryTypePtr> entriesToBeDeleted;
-        return tryEvictDiskEntry(entriesToBeDeleted);
+
+        return tryEvictDiskEntryFromAnyShard(entriesToBeDeleted);
     }
 
     /**
@@ -1242,21 +1762,18 @@ public:
                                         std::size_t newSize) const OVERRIDE FINAL
     {
         ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache
-        QMutexLocker k(&_sizeLock);
 
         ///This function can only be called for RAM buffers or while a memory mapped file is mapped into the RAM, so
         ///we just have to modify the RAM size.
 
         ///Avoid overflows, _memoryCacheSize may not always fallback to 0
-        qint64 diff = (qint64)newSize - (qint64)oldSize;
-
-        if (diff < 0) {
-            _memoryCacheSize = diff > (qint64)_memoryCacheSize ? 0 : _memoryCacheSize + diff;
+        if (newSize < oldSize) {
+            subtractClamped(_memoryCacheSize, oldSize - newSize);
         } else {
-            _memoryCacheSize += diff;
+            _memoryCacheSize.fetch_add(newSize - oldSize);
         }
 #ifdef NATRON_DEBUG_CACHE
-        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize.load());
 #endif
     }
 
@@ -1269,25 +1786,23 @@ public:
     {
         ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache, hence the
         ///lock should already be taken.
-        QMutexLocker k(&_sizeLock);
-
         if (storage == eStorageModeDisk) {
             if (_isTiled) {
                 // For tile caches, we do not control which portion of the cache is in memory, so just keep track of the disk portion
-                _diskCacheSize += size;
+                _diskCacheSize.fetch_add(size);
             } else {
-                _memoryCacheSize += size;
+                _memoryCacheSize.fetch_add(size);
                 appPTR->increaseNCacheFilesOpened();
             }
         } else {
-            _memoryCacheSize += size;
+            _memoryCacheSize.fetch_add(size);
         }
 
         _signalEmitter->emitAddedEntry(time);
 
 
 #ifdef NATRON_DEBUG_CACHE
-        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize.load());
 #endif
     }
 
@@ -1298,17 +1813,15 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        QMutexLocker k(&_sizeLock);
-
         if (storage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
+            subtractClamped(_memoryCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize.load());
 #endif
         } else if (storage == eStorageModeDisk) {
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            subtractClamped(_diskCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize.load());
 #endif
         }
 
@@ -1337,33 +1850,31 @@ public:
         if (_tearingDown) {
             return;
         }
-        QMutexLocker k(&_sizeLock);
-
         assert(oldStorage != newStorage);
         assert(newStorage != eStorageModeNone);
         if (oldStorage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
-            _diskCacheSize += size;
+            subtractClamped(_memoryCacheSize, size);
+            _diskCacheSize.fetch_add(size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize.load());
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize.load());
 #endif
             ///We switched from RAM to DISK that means the MemoryFile object has been destroyed hence the file has been closed.
             appPTR->decreaseNCacheFilesOpened();
         } else if (oldStorage == eStorageModeDisk) {
-            _memoryCacheSize += size;
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            _memoryCacheSize.fetch_add(size);
+            subtractClamped(_diskCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize.load());
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize.load());
 #endif
             ///We switched from DISK to RAM that means the MemoryFile object has been created and the file opened
             appPTR->increaseNCacheFilesOpened();
         } else {
             if (newStorage == eStorageModeRAM) {
-                _memoryCacheSize += size;
+                _memoryCacheSize.fetch_add(size);
             } else if (newStorage == eStorageModeDisk) {
-                _diskCacheSize += size;
+                _diskCacheSize.fetch_add(size);
             }
         }
 
@@ -1412,46 +1923,67 @@ public:
         return newCachePath.toStdString();
     }
 
-    void setMaximumCacheSize(U64 newSize)
+    /**
+     * @brief Path of the persistent index of a tiled cache, next to its tile files.
+     **/
+    std::string getIndexFilePath() const
     {
-        QMutexLocker k(&_sizeLock);
+        QString newCachePath( getCachePath() );
+        StrUtils::ensureLastPathSeparator(newCachePath);
 
-        _maximumCacheSize = newSize;
+        newCachePath.append( QString::fromUtf8("index." NATRON_CACHE_FILE_EXT) );
+
+        return newCachePath.toStdString();
     }
 
-    void setMaximumInMemorySize(double percentage)
+    /**
+     * @brief Returns the location of this cache in the shared disk cache tier, or an empty string if the
+     * shared tier is disabled. Tiled caches do not use the shared tier.
+     **/
+    QString getSharedCachePath() const
     {
-        QMutexLocker k(&_sizeLock);
+        if (_isTiled) {
+            return QString();
+        }
+        QString cacheFolderName( appPTR->getSharedDiskCacheLocation() );
+        if ( cacheFolderName.isEmpty() ) {
+            return cacheFolderName;
+        }
+        StrUtils::ensureLastPathSeparator(cacheFolderName);
 
-        _maximumInMemorySize = _maximumCacheSize * percentage;
+        cacheFolderName.append( QString::fromUtf8( cacheName().c_str() ) );
+
+        return cacheFolderName;
     }
 
-    std::size_t getMaximumSize() const
+    void setMaximumCacheSize(U64 newSize)
     {
-        QMutexLocker k(&_sizeLock);
+        _maximumCacheSize.store(newSize);
+    }
 
-        return _maximumCacheSize;
+    void setMaximumInMemorySize(double percentage)
+    {
+        _maximumInMemorySize.store(_maximumCacheSize.load() * percentage);
     }
 
-    std::size_t getMaximumMemorySize() const
+    std::size_t getMaximumSize() const
     {
-        QMutexLocker k(&_sizeLock);
+        return _maximumCacheSize.load();
+    }
 
-        return _maximumInMemorySize;
+    std::size_t getMaximumMemorySize() const
+    {
+        return _maximumInMemorySize.load();
     }
 
     std::size_t getMemoryCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _memoryCacheSize;
+        return _memoryCacheSize.load();
     }
 
     std::size_t getDiskCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _diskCacheSize;
+        return _diskCacheSize.load();
     }
 
     CacheSignalEmitterPtr activateSignalEmitter() const
@@ -1471,9 +2003,10 @@ public:
         std::list<EntryTypePtr> toRemove;
 
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( entry->getHashKey() );
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheShard& shard = getShard( entry->getHashKey() );
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache( entry->getHashKey() );
+            if ( existingEntry != shard.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     if ( (*it)->getKey() == entry->getKey() ) {
@@ -1483,11 +2016,11 @@ public:
                     }
                 }
                 if ( ret.empty() ) {
-                    _memoryCache.erase(existingEntry);
+                    shard.memoryCache.erase(existingEntry);
                 }
             } else {
-                existingEntry = _diskCache( entry->getHashKey() );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = shard.diskCache( entry->getHashKey() );
+                if ( existingEntry != shard.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         if ( (*it)->getKey() == entry->getKey() ) {
@@ -1497,11 +2030,11 @@ public:
                         }
                     }
                     if ( ret.empty() ) {
-                        _diskCache.erase(existingEntry);
+                        shard.diskCache.erase(existingEntry);
                     }
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
 
@@ -1515,25 +2048,26 @@ public:
     {
         std::list<EntryTypePtr> toRemove;
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( hash);
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheShard& shard = getShard(hash);
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache( hash);
+            if ( existingEntry != shard.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     toRemove.push_back(*it);
                 }
-                _memoryCache.erase(existingEntry);
+                shard.memoryCache.erase(existingEntry);
             } else {
-                existingEntry = _diskCache( hash );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = shard.diskCache( hash );
+                if ( existingEntry != shard.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         toRemove.push_back(*it);
                     }
-                    _diskCache.erase(existingEntry);
+                    shard.diskCache.erase(existingEntry);
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
 
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
@@ -1552,6 +2086,33 @@ public:
     /*Restores the cache from disk.*/
     void restore(const CacheTOC & tableOfContents);
 
+    /**
+     * @brief For tiled caches only: writes the memory-mappable index of the entries on disk, @see getIndexFilePath().
+     * This replaces save() for tiled caches.
+     **/
+    void saveIndex();
+
+    /**
+     * @brief For tiled caches only: maps the index written by saveIndex() and validates it. The entries it references
+     * are created lazily when they are looked up. Returns false if there is no valid index, in which case the cache
+     * files should be wiped.
+     **/
+    bool restoreIndex();
+
+    /**
+     * @brief Writes the entries stored on disk whose holder is one of holderIDs and whose time is in [firstTime, lastTime]
+     * to a bundle folder, with the layout of the shared disk cache tier: files are named after the hash of the entries and
+     * no absolute path is stored, so that the bundle can be moved to another computer and imported with importBundle().
+     * Returns the number of entries in the bundle for this cache. Tiled caches are not exported.
+     **/
+    int exportBundle(const std::string& bundlePath, const std::set<std::string>& holderIDs, double firstTime, double lastTime) const;
+
+    /**
+     * @brief Copies the entries of a bundle written by exportBundle() to the disk portion, except those already cached.
+     * Returns the number of imported entries.
+     **/
+    int importBundle(const std::string& bundlePath);
+
 
     void removeAllEntriesWithDifferentNodeHashForHolderPublic(const CacheEntryHolder* holder,
                                                               U64 nodeHash)
@@ -1577,47 +2138,242 @@ public:
         *diskOccupied = 0;
 
         std::string holderID = holder->getCacheID();
-        QMutexLocker locker(&_lock);
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
 
-        for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+            for (CacheIterator memIt = shard.memoryCache.begin(); memIt != shard.memoryCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
 
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *ramOccupied += (*it)->size();
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *ramOccupied += (*it)->size();
+                        }
                     }
                 }
             }
-        }
 
-        for (CacheIterator memIt = _diskCache.begin(); memIt != _diskCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+            for (CacheIterator memIt = shard.diskCache.begin(); memIt != shard.diskCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
 
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *diskOccupied += (*it)->size();
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *diskOccupied += (*it)->size();
+                        }
                     }
                 }
             }
         }
     }
 
+    /**
+     * @brief Pins or unpins the entries of the holder, including the ones created later on. Pinned entries survive the
+     * eviction of the entries that are not pinned, e.g: when another project or a background render fills the cache:
+     * they are only evicted once the pinned entries alone exceed the size of the portion of the cache they are in.
+     * Clearing the cache removes them as well.
+     * Holders sharing the same cache ID share their entries: these stay pinned until all of these holders are unpinned.
+     **/
+    void setHolderPinned(const CacheEntryHolder* holder,
+                         bool pinned)
+    {
+        std::string holderID = holder->getCacheID();
+        bool holderIDPinned;
+        {
+            QMutexLocker k(&_pinnedHoldersMutex);
+            if (pinned) {
+                _pinnedHolders[holder] = holderID;
+            } else {
+                _pinnedHolders.erase(holder);
+            }
+            _nPinnedHolders = _pinnedHolders.size();
+            holderIDPinned = isHolderIDPinned_locked(holderID);
+        }
+
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            setHolderIDPinned(shard.memoryCache, holderID, holderIDPinned);
+            setHolderIDPinned(shard.diskCache, holderID, holderIDPinned);
+        }
+    }
+
 private:
 
+    bool isHolderIDPinned_locked(const std::string& holderID) const
+    {
+        assert( !_pinnedHoldersMutex.tryLock() );
+        for (std::map<const CacheEntryHolder*, std::string>::const_iterator it = _pinnedHolders.begin(); it != _pinnedHolders.end(); ++it) {
+            if (it->second == holderID) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool isHolderIDPinned(const std::string& holderID) const
+    {
+        QMutexLocker k(&_pinnedHoldersMutex);
+
+        return isHolderIDPinned_locked(holderID);
+    }
+
+    void setHolderIDPinned(CacheContainer& container,
+                           const std::string& holderID,
+                           bool pinned) const
+    {
+        for (CacheIterator it = container.begin(); it != container.end(); ++it) {
+            std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+            if ( entries.empty() || (entries.front()->getKey().getCacheHolderID() != holderID) ) {
+                continue;
+            }
+            for (typename std::list<EntryTypePtr>::iterator it2 = entries.begin(); it2 != entries.end(); ++it2) {
+                (*it2)->setPinned(pinned);
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the shard in which entries with the given hash live.
+     **/
+    CacheShard& getShard(hash_type hash) const
+    {
+        if (_shards.size() == 1) {
+            return *_shards.front();
+        }
+        // The containers already use the low bits of the hash, mix in the high bits
+        U64 h = (U64)hash;
+        h ^= (h >> 33);
+
+        return *_shards[h % _shards.size()];
+    }
+
+    /**
+     * @brief Returns true if either the memory portion or the disk portion of the cache are filled beyond the given percentage
+     **/
+    bool isAboveOccupationPercentage(double limitPercent) const
+    {
+        std::size_t maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize.load() );
+
+        if ( (double)_memoryCacheSize.load() / maximumInMemorySize >= limitPercent ) {
+            return true;
+        }
+        std::size_t maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize.load() - _maximumInMemorySize.load() );
+
+        return (double)_diskCacheSize.load() / maximumDiskCacheSize >= limitPercent;
+    }
+
+    /**
+     * @brief Called by the evictor thread when the cache went beyond NATRON_CACHE_LIMIT_PERCENT
+     **/
+    virtual void evictExceedingEntriesToLowWatermark() OVERRIDE FINAL
+    {
+        evictExceedingEntries(NATRON_CACHE_LOW_WATERMARK_PERCENT);
+    }
+
+    /**
+     * @brief Evicts the last recently used entries of the memory and disk portions until their occupation
+     * goes below the given percentage. The evicted entries are destroyed by the deleter thread.
+     **/
+    void evictExceedingEntries(double limitPercent) const
+    {
+        ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
+        ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
+        std::list<EntryTypePtr> entriesToBeDeleted;
+
+        // The memory of the entries to be deleted is only released by the deleter thread, whereas entries that
+        // were compressed or moved to the disk portion already updated _memoryCacheSize
+        U64 pendingDeletionSize = 0;
+        U64 maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize.load() );
+        double occupationPercentage = (double)_memoryCacheSize.load() / maximumInMemorySize;
+
+        while (occupationPercentage >= limitPercent) {
+            std::list<EntryTypePtr> deleted;
+            if ( !tryEvictInMemoryEntryFromAnyShard(deleted) ) {
+                break;
+            }
+
+            for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
+                if ( !(*it)->isStoredOnDisk() ) {
+                    pendingDeletionSize += (*it)->size();
+                }
+                entriesToBeDeleted.push_back(*it);
+            }
+            U64 memoryCacheSize = _memoryCacheSize.load();
+            memoryCacheSize -= std::min(pendingDeletionSize, memoryCacheSize);
+            occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
+        }
+
+        U64 diskCacheSize = _diskCacheSize.load();
+        U64 maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize.load() - _maximumInMemorySize.load() );
+        double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
+        while (diskPercentage >= limitPercent) {
+            std::list<EntryTypePtr> deleted;
+            if ( !tryEvictDiskEntryFromAnyShard(deleted) ) {
+                // The entries of the persistent index that were not used since the cache was restored come last
+                if ( !dropIndexedEntry() ) {
+                    break;
+                }
+                diskCacheSize -= std::min( (U64)_tileByteSize, diskCacheSize );
+                diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
+                continue;
+            }
+
+            for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
+                diskCacheSize -= std::min( (U64)(*it)->size(), diskCacheSize );
+                entriesToBeDeleted.push_back(*it);
+            }
+            diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
+        }
+
+        if ( !entriesToBeDeleted.empty() ) {
+            ///Launch a separate thread whose function will be to delete all the entries to be deleted
+            _deleterThread.appendToQueue(entriesToBeDeleted);
+
+            ///Clearing the list here will not delete the objects pointing to by the shared_ptr's because we made a copy
+            ///that the separate thread will delete
+            entriesToBeDeleted.clear();
+        }
+    } // evictExceedingEntries
+
+    //If _maximumcacheSize == 0 we don't return 1 otherwise we would cause a deadlock
+    double getMemoryOccupationOfMaximumCacheSize() const
+    {
+        std::size_t maximumCacheSize = _maximumCacheSize.load();
+
+        return maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize.load() / maximumCacheSize;
+    }
+
+    /**
+     * @brief Decrements the given counter by size without going below 0
+     **/
+    static void subtractClamped(boost::atomic<std::size_t>& counter,
+                                std::size_t size)
+    {
+        std::size_t cur = counter.load(boost::memory_order_relaxed);
+        std::size_t newValue;
+
+        do {
+            newValue = size > cur ? 0 : cur - size;
+        } while ( !counter.compare_exchange_weak(cur, newValue) );
+    }
+
     virtual void removeAllEntriesWithDifferentNodeHashForHolderPrivate(const std::string & holderID,
                                                                        U64 nodeHash,
                                                                        bool removeAll) OVERRIDE FINAL
     {
         std::list<EntryTypePtr> toDelete;
-        CacheContainer newMemCache, newDiskCache;
-        {
-            QMutexLocker locker(&_lock);
 
-            for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            CacheContainer newMemCache, newDiskCache;
+            QMutexLocker locker(&shard.lock);
+
+            for (CacheIterator memIt = shard.memoryCache.begin(); memIt != shard.memoryCache.end(); ++memIt) {
                 std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
@@ -1634,7 +2390,7 @@ private:
                 }
             }
 
-            for (CacheIterator dIt = _diskCache.begin(); dIt != _diskCache.end(); ++dIt) {
+            for (CacheIterator dIt = shard.diskCache.begin(); dIt != shard.diskCache.end(); ++dIt) {
                 std::list<EntryTypePtr> & entries = getValueFromIterator(dIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
@@ -1651,9 +2407,9 @@ private:
                 }
             }
 
-            _memoryCache = newMemCache;
-            _diskCache = newDiskCache;
-        } // QMutexLocker locker(&_lock);
+            shard.memoryCache = newMemCache;
+            shard.diskCache = newDiskCache;
+        } // for each shard
 
         if ( !toDelete.empty() ) {
             _deleterThread.appendToQueue(toDelete);
@@ -1664,21 +2420,32 @@ private:
         }
     } // removeAllEntriesWithDifferentNodeHashForHolderPrivate
 
-    bool getInternal(const typename EntryType::key_type & key,
+    bool getInternal(CacheShard& shard,
+                     const typename EntryType::key_type & key,
                      std::list<EntryTypePtr>* returnValue) const
     {
         ///Private should be locked
-        assert( !_lock.tryLock() );
+        assert( !shard.lock.tryLock() );
 
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache( key.getHash() );
+        CacheIterator memoryCached = shard.memoryCache( key.getHash() );
 
-        if ( memoryCached != _memoryCache.end() ) {
+        if ( memoryCached != shard.memoryCache.end() ) {
             ///we found something with a matching hash key. There may be several entries linked to
             ///this key, we need to find one with matching params
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
-            for (typename std::list<EntryTypePtr>::const_iterator it = ret.begin(); it != ret.end(); ++it) {
+            bool decompressed = false;
+            for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end();) {
                 if ( (*it)->getKey() == key ) {
+                    if ( (*it)->isCompressed() ) {
+                        if ( !(*it)->decompress() ) {
+                            qDebug() << "Error while decompressing cache entry";
+                            it = ret.erase(it);
+                            continue;
+                        }
+                        decompressed = true;
+                    }
+                    (*it)->notifyLookedUp();
                     returnValue->push_back(*it);
 
                     ///Q_EMIT the added signal otherwise when first reading something that's already cached
@@ -1687,14 +2454,34 @@ private:
                         _signalEmitter->emitAddedEntry( key.getTime() );
                     }
                 }
+                ++it;
+            }
+            if ( ret.empty() ) {
+                shard.memoryCache.erase(memoryCached);
+            }
+
+            //the decompressed entries take their full size again
+            if ( decompressed && isAboveOccupationPercentage(NATRON_CACHE_LIMIT_PERCENT) ) {
+                _evictorThread.requestEviction();
             }
 
             return returnValue->size() > 0;
         } else {
             ///fallback on the disk cache internal container
-            CacheIterator diskCached = _diskCache( key.getHash() );
+            CacheIterator diskCached = shard.diskCache( key.getHash() );
+
+            if ( ( diskCached == shard.diskCache.end() ) && loadIndexedEntries( shard, key.getHash() ) ) {
+                ///the entry was saved the last time the cache was, it is now in the disk cache
+                diskCached = shard.diskCache( key.getHash() );
+            }
+
+            if ( ( diskCached == shard.diskCache.end() ) && promoteFromSharedTier(shard, key) ) {
+                ///the entry was found in the shared tier and copied to the disk cache, or it was inserted in the memory
+                ///or disk cache while the shard was unlocked: look it up again
+                return getInternal(shard, key, returnValue);
+            }
 
-            if ( diskCached == _diskCache.end() ) {
+            if ( diskCached == shard.diskCache.end() ) {
                 /*the entry was neither in memory or disk, just allocate a new one*/
                 return false;
             } else {
@@ -1726,28 +2513,12 @@ private:
                             }
 
                             //put it back into the RAM
-                            _memoryCache.insert( (*it)->getHashKey(), *it );
+                            shard.memoryCache.insert( (*it)->getHashKey(), *it );
 
 
-                            U64 memoryCacheSize, maximumInMemorySize;
-                            {
-                                QMutexLocker k(&_sizeLock);
-                                memoryCacheSize = _memoryCacheSize;
-                                maximumInMemorySize = _maximumInMemorySize;
-                            }
-                            std::list<EntryTypePtr> entriesToBeDeleted;
-
-                            //now clear extra entries from the disk cache so it doesn't exceed the RAM limit.
-                            while (memoryCacheSize > maximumInMemorySize) {
-                                if ( !tryEvictInMemoryEntry(entriesToBeDeleted) ) {
-                                    break;
-                                }
-
-                                {
-                                    QMutexLocker k(&_sizeLock);
-                                    memoryCacheSize = _memoryCacheSize;
-                                    maximumInMemorySize = _maximumInMemorySize;
-                                }
+                            //now clear extra entries from the memory cache so it doesn't exceed the RAM limit.
+                            if ( isAboveOccupationPercentage(NATRON_CACHE_LIMIT_PERCENT) ) {
+                                _evictorThread.requestEviction();
                             }
                         }
                         
@@ -1763,7 +2534,7 @@ private:
                             ret.erase(it);
 
                             ///Remove it from the disk cache
-                            _diskCache.erase(diskCached);
+                            shard.diskCache.erase(diskCached);
                         }
 
                         return true;
@@ -1780,25 +2551,26 @@ private:
     /** @brief Inserts into the cache an entry that was previously allocated by the createInternal()
      * function. This is called directly by createInternal() if the allocation was successful
      **/
-    void sealEntry(const EntryTypePtr & entry,
+    void sealEntry(CacheShard& shard,
+                   const EntryTypePtr & entry,
                    bool inMemory) const
     {
-        assert( !_lock.tryLock() );   // must be locked
+        assert( !shard.lock.tryLock() );   // must be locked
         typename EntryType::hash_type hash = entry->getHashKey();
 
         if (inMemory) {
             /*if the entry doesn't exist on the memory cache,make a new list and insert it*/
-            CacheIterator existingEntry = _memoryCache(hash);
-            if ( existingEntry == _memoryCache.end() ) {
-                _memoryCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.memoryCache(hash);
+            if ( existingEntry == shard.memoryCache.end() ) {
+                shard.memoryCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
             }
         } else {
-            CacheIterator existingEntry = _diskCache(hash);
-            if ( existingEntry == _diskCache.end() ) {
-                _diskCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.diskCache(hash);
+            if ( existingEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
@@ -1806,10 +2578,236 @@ private:
         }
     }
 
-    bool tryEvictInMemoryEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    /**
+     * @brief Returns true if this very entry is in the memory cache of the shard, which must be locked.
+     **/
+    bool isEntryInMemoryCache(CacheShard& shard,
+                              const EntryTypePtr & entry) const
+    {
+        assert( !shard.lock.tryLock() );   // must be locked
+        CacheIterator found = shard.memoryCache( entry->getHashKey() );
+        if ( found == shard.memoryCache.end() ) {
+            return false;
+        }
+        const std::list<EntryTypePtr> & entries = getValueFromIterator(found);
+
+        return std::find(entries.begin(), entries.end(), entry) != entries.end();
+    }
+
+    /**
+     * @brief Removes this very entry from the memory cache of the shard, which must be locked.
+     **/
+    void takeFromMemoryCache(CacheShard& shard,
+                             const EntryTypePtr & entry) const
+    {
+        assert( !shard.lock.tryLock() );   // must be locked
+        CacheIterator found = shard.memoryCache( entry->getHashKey() );
+        if ( found == shard.memoryCache.end() ) {
+            return;
+        }
+        std::list<EntryTypePtr> & entries = getValueFromIterator(found);
+        entries.remove(entry);
+        if ( entries.empty() ) {
+            shard.memoryCache.erase(found);
+        }
+    }
+
+    /**
+     * @brief Creates the entries of the persistent index with the given hash, if any, and inserts them
+     * in the disk portion. Returns true if any entry was inserted.
+     **/
+    bool loadIndexedEntries(CacheShard& shard,
+                            hash_type hash) const
+    {
+        assert( !shard.lock.tryLock() );   // must be locked
+        std::list<EntryTypePtr> entries;
+        {
+            QMutexLocker k(&_persistentIndexMutex);
+            if (!_persistentIndex) {
+                return false;
+            }
+            _persistentIndex->takeEntries(hash, &entries);
+        }
+        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+            sealEntry(shard, *it, false /*inMemory*/);
+        }
+
+        return !entries.empty();
+    }
+
+    /**
+     * @brief Reads the version, key and parameters of an entry of the shared tier or of a bundle.
+     * Returns false if the file cannot be read or was written by another version of the cache.
+     **/
+    bool readSharedEntryMetadata(const std::string& metaFilePath,
+                                 typename EntryType::key_type* key,
+                                 ParamsTypePtr* params,
+                                 std::size_t* size) const;
+
+    /**
+     * @brief Copies the file of an entry of the shared tier or of a bundle to a temporary file of the disk portion.
+     * No shard lock must be taken. Returns the path of the temporary file, or an empty string on failure.
+     **/
+    std::string copySharedEntryFile(const std::string& sharedFilePath) const;
+
+    /**
+     * @brief Moves the temporary file returned by copySharedEntryFile() to its place in the disk portion and creates the entry,
+     * which is not inserted in the cache yet. Returns NULL on failure, in which case the temporary file is removed.
+     **/
+    EntryTypePtr restoreSharedEntry(const std::string& tmpFilePath,
+                                    const typename EntryType::key_type & key,
+                                    const ParamsTypePtr& params,
+                                    std::size_t size) const;
+
+    /**
+     * @brief Returns true if an entry with the given key is in the memory or disk cache of the shard, which must be locked.
+     **/
+    bool isEntryCached(CacheShard& shard, const typename EntryType::key_type & key) const;
+
+    /**
+     * @brief Writes an entry stored on disk to the shared tier or to a bundle at the given path. Returns true if the entry
+     * is there afterwards.
+     **/
+    bool writeSharedEntry(const EntryTypePtr& entry, const QString& sharedCachePath) const;
+
+    /**
+     * @brief Looks-up the shared tier for an entry matching the key. If found, its file is copied to
+     * the disk portion and the entry is inserted in the disk cache of the shard, which must be locked along with its get lock.
+     * Both locks are released while the shared tier is read. Returns true if an entry with the key is in the shard
+     * afterwards, in the memory or disk cache.
+     **/
+    bool promoteFromSharedTier(CacheShard& shard, const typename EntryType::key_type & key) const;
+
+    /**
+     * @brief Copies the backing file of an entry evicted from the disk portion to the shared tier, along with
+     * its key and parameters, so that this computer or another one can find it again. No shard lock must be taken.
+     **/
+    void demoteToSharedTier(const EntryTypePtr& entry, const QString& sharedCachePath) const;
+
+    bool dropIndexedEntry() const
     {
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _memoryCache.evict();
+        QMutexLocker k(&_persistentIndexMutex);
+
+        return _persistentIndex && _persistentIndex->dropEntry();
+    }
+
+    void dropPersistentIndex()
+    {
+        QMutexLocker k(&_persistentIndexMutex);
+
+        if (_persistentIndex) {
+            _persistentIndex->dropAllEntries();
+            _persistentIndex.reset();
+            QFile::remove( QString::fromUtf8( getIndexFilePath().c_str() ) );
+        }
+    }
+
+    /**
+     * @brief Evicts the least recently used in-memory entry of the next shard that has something to evict.
+     * Shards are visited in a round-robin fashion. No shard lock must be taken by the caller.
+     * Pinned entries are only evicted if nothing else can be and the in-memory portion is full.
+     **/
+    bool tryEvictInMemoryEntryFromAnyShard(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        const std::size_t nShards = _shards.size();
+        const unsigned int startIndex = _evictionShardIndex.fetch_add(1, boost::memory_order_relaxed);
+
+        for (int keepPinned = 1; keepPinned >= 0; --keepPinned) {
+            if ( !keepPinned && ( (_nPinnedHolders.load() == 0) || (_memoryCacheSize.load() < _maximumInMemorySize.load()) ) ) {
+                break;
+            }
+            for (std::size_t i = 0; i < nShards; ++i) {
+                CacheShard& shard = *_shards[(startIndex + i) % nShards];
+                EntryTypePtr toCompress;
+                bool evicted;
+                {
+                    QMutexLocker locker(&shard.lock);
+                    evicted = tryEvictInMemoryEntry(shard, entriesToBeDeleted, keepPinned != 0, &toCompress);
+                }
+                if (evicted) {
+                    PerfCounters::increment(ePerfCounterCacheEvictions);
+                    if (toCompress) {
+                        // Compressing is slow, it is done on a copy once the shard lock is released: the entry stays
+                        // in the cache meanwhile so that look-ups still find it
+                        U64 lookupCount;
+                        {
+                            QMutexLocker locker(&shard.lock);
+                            lookupCount = toCompress->getLookupCount();
+                        }
+                        std::vector<unsigned char> compressed;
+                        std::size_t count = 0;
+                        bool compressedOk = toCompress->getCompressedCopy(&compressed, &count);
+
+                        QMutexLocker locker(&shard.lock);
+                        // The copy is only valid if the entry was neither looked-up nor removed in the meantime:
+                        // it is then only referenced by the cache and by toCompress
+                        if ( (toCompress.use_count() == 2) && (toCompress->getLookupCount() == lookupCount) &&
+                             isEntryInMemoryCache(shard, toCompress) ) {
+                            if ( !compressedOk || !toCompress->setCompressedData(&compressed, count) ) {
+                                // Not worth keeping compressed: evict it for real
+                                takeFromMemoryCache(shard, toCompress);
+                                entriesToBeDeleted.push_back(toCompress);
+                            }
+                        }
+                    }
+
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Same as tryEvictInMemoryEntryFromAnyShard() but for the disk portion.
+     **/
+    bool tryEvictDiskEntryFromAnyShard(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        const std::size_t nShards = _shards.size();
+        const unsigned int startIndex = _evictionShardIndex.fetch_add(1, boost::memory_order_relaxed);
+
+        // Copying to the shared tier is slow, it is done once the shard lock is released
+        const QString sharedCachePath = getSharedCachePath();
+
+        for (int keepPinned = 1; keepPinned >= 0; --keepPinned) {
+            if ( !keepPinned && ( (_nPinnedHolders.load() == 0) || (_diskCacheSize.load() < _maximumCacheSize.load() - _maximumInMemorySize.load()) ) ) {
+                break;
+            }
+            for (std::size_t i = 0; i < nShards; ++i) {
+                CacheShard& shard = *_shards[(startIndex + i) % nShards];
+                bool evicted;
+                {
+                    QMutexLocker locker(&shard.lock);
+                    evicted = tryEvictDiskEntry(shard, entriesToBeDeleted, sharedCachePath.isEmpty() /*removeBackingFile*/, keepPinned != 0);
+                }
+                if (evicted) {
+                    PerfCounters::increment(ePerfCounterCacheEvictions);
+                    if ( !sharedCachePath.isEmpty() ) {
+                        demoteToSharedTier(entriesToBeDeleted.back(), sharedCachePath);
+                        entriesToBeDeleted.back()->removeAnyBackingFile();
+                    }
+
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Evicts the least recently used in-memory entry of the shard, which must be locked.
+     * A RAM entry evicted for the first time is not deleted but inserted back as the most recently used entry and
+     * set to toCompress: the caller compresses it once the shard lock is released.
+     **/
+    bool tryEvictInMemoryEntry(CacheShard& shard,
+                               std::list<EntryTypePtr> & entriesToBeDeleted,
+                               bool keepPinned,
+                               EntryTypePtr* toCompress) const
+    {
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.memoryCache.evict(keepPinned);
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
@@ -1820,7 +2818,14 @@ private:
         // If the cache is tiled, the entry is sharing the same file with other entries so we cannot close the file.
         // Just deallocate it
         if ( !evicted.second->isStoredOnDisk()) {
-            entriesToBeDeleted.push_back(evicted.second);
+            // A RAM entry evicted for the first time is inserted back as the most recently used entry to be compressed,
+            // it is destroyed the next time it gets evicted
+            if ( _compressionEnabled.load() && !evicted.second->isCompressed() ) {
+                sealEntry(shard, evicted.second, true /*inMemory*/);
+                *toCompress = evicted.second;
+            } else {
+                entriesToBeDeleted.push_back(evicted.second);
+            }
         } else {
 
             assert( evicted.second.unique() );
@@ -1830,17 +2835,16 @@ private:
 
             /*insert it back into the disk portion */
 
-            U64 diskCacheSize, maximumCacheSize, maximumInMemorySize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumInMemorySize = _maximumInMemorySize;
-                maximumCacheSize = _maximumCacheSize;
-            }
+            U64 diskCacheSize = _diskCacheSize.load();
 
             /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
-            while ( ( diskCacheSize  + evicted.second->size() ) >= (maximumCacheSize - maximumInMemorySize) ) {
-                std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
+            while ( ( diskCacheSize  + evicted.second->size() ) >= (_maximumCacheSize.load() - _maximumInMemorySize.load()) ) {
+                std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict(true /*keepPinned*/);
+                if ( !evictedFromDisk.second && (_nPinnedHolders.load() > 0) ) {
+                    // Only pinned entries are left: evict them as well rather than growing the disk portion past its budget,
+                    // as tryEvictDiskEntryFromAnyShard() does
+                    evictedFromDisk = shard.diskCache.evict(false /*keepPinned*/);
+                }
                 //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
                 //we'll let the user of these entries purge the extra entries left in the cache later on
                 if (!evictedFromDisk.second) {
@@ -1852,22 +2856,16 @@ private:
 
                 entriesToBeDeleted.push_back(evictedFromDisk.second);
 
-                {
-                    QMutexLocker k(&_sizeLock);
-                    maximumInMemorySize = _maximumInMemorySize;
-                    maximumCacheSize = _maximumCacheSize;
-                }
-
                 //The entry is not yet deleted for real since it's done in a separate thread when this function
                 ///size() will return 0 at this point, we have to recompute it
                 std::size_t fsize = evictedFromDisk.second->getElementsCountFromParams();
                 diskCacheSize -= fsize;
             }
 
-            CacheIterator existingDiskCacheEntry = _diskCache(evicted.first);
+            CacheIterator existingDiskCacheEntry = shard.diskCache(evicted.first);
             /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-            if ( existingDiskCacheEntry == _diskCache.end() ) {
-                _diskCache.insert(evicted.first, evicted.second);
+            if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(evicted.first, evicted.second);
             } else {   /*append to the existing list*/
                 getValueFromIterator(existingDiskCacheEntry).push_back(evicted.second);
             }
@@ -1876,17 +2874,20 @@ private:
         return true;
     } // tryEvictEntry
 
-    bool tryEvictDiskEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    bool tryEvictDiskEntry(CacheShard& shard,
+                           std::list<EntryTypePtr> & entriesToBeDeleted,
+                           bool removeBackingFile,
+                           bool keepPinned) const
     {
 
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _diskCache.evict();
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.diskCache.evict(keepPinned);
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
             return false;
         }
-        if (!_isTiled) {
+        if (!_isTiled && removeBackingFile) {
             // Erase the file from the disk if we reach the limit.
             evicted.second->removeAnyBackingFile();
         }
@@ -0,0 +1,284 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CacheCompression.h"
+
+#include <algorithm> // min
+#include <cstring> // memcpy
+
+#include "Global/GlobalDefines.h"
+
+// A sequence is a token byte (literals count on the 4 high bits, match length - NATRON_LZ_MIN_MATCH on the 4 low bits,
+// 15 meaning that more bytes follow, each adding up to 255), the literals, then the match offset on 2 bytes.
+// The last sequence only has literals.
+#define NATRON_LZ_MIN_MATCH 4
+#define NATRON_LZ_MAX_OFFSET 65535
+#define NATRON_LZ_HASH_BITS 14
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+inline U32
+read32(const unsigned char* p)
+{
+    U32 v;
+
+    std::memcpy(&v, p, sizeof(v));
+
+    return v;
+}
+
+inline U32
+hashSequence(U32 sequence)
+{
+    return (sequence * 2654435761U) >> (32 - NATRON_LZ_HASH_BITS);
+}
+
+inline void
+writeLength(std::size_t length,
+            std::vector<unsigned char>* out)
+{
+    while (length >= 255) {
+        out->push_back(255);
+        length -= 255;
+    }
+    out->push_back( (unsigned char)length );
+}
+
+inline bool
+readLength(const unsigned char** ip,
+           const unsigned char* iend,
+           std::size_t* length)
+{
+    unsigned char b;
+
+    do {
+        if (*ip >= iend) {
+            return false;
+        }
+        b = *(*ip)++;
+        *length += b;
+    } while (b == 255);
+
+    return true;
+}
+
+void
+writeSequence(const unsigned char* literals,
+              std::size_t literalsCount,
+              std::size_t offset,
+              std::size_t matchLength,
+              std::vector<unsigned char>* out)
+{
+    std::size_t matchCode = matchLength ? matchLength - NATRON_LZ_MIN_MATCH : 0;
+    unsigned char token = (unsigned char)( ( std::min(literalsCount, (std::size_t)15) << 4 ) | std::min(matchCode, (std::size_t)15) );
+
+    out->push_back(token);
+    if (literalsCount >= 15) {
+        writeLength(literalsCount - 15, out);
+    }
+    out->insert(out->end(), literals, literals + literalsCount);
+    if (matchLength) {
+        out->push_back( (unsigned char)(offset & 0xFF) );
+        out->push_back( (unsigned char)(offset >> 8) );
+        if (matchCode >= 15) {
+            writeLength(matchCode - 15, out);
+        }
+    }
+}
+
+// Gathers the n-th byte of all elements together
+void
+shuffle(const unsigned char* src,
+        std::size_t size,
+        std::size_t elementSize,
+        unsigned char* dst)
+{
+    std::size_t nElements = size / elementSize;
+
+    for (std::size_t b = 0; b < elementSize; ++b) {
+        unsigned char* d = dst + b * nElements;
+        for (std::size_t i = 0; i < nElements; ++i) {
+            d[i] = src[i * elementSize + b];
+        }
+    }
+    std::memcpy(dst + nElements * elementSize, src + nElements * elementSize, size - nElements * elementSize);
+}
+
+void
+unshuffle(const unsigned char* src,
+          std::size_t size,
+          std::size_t elementSize,
+          unsigned char* dst)
+{
+    std::size_t nElements = size / elementSize;
+
+    for (std::size_t b = 0; b < elementSize; ++b) {
+        const unsigned char* s = src + b * nElements;
+        for (std::size_t i = 0; i < nElements; ++i) {
+            dst[i * elementSize + b] = s[i];
+        }
+    }
+    std::memcpy(dst + nElements * elementSize, src + nElements * elementSize, size - nElements * elementSize);
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+namespace CacheCompression {
+
+bool
+compress(const unsigned char* data,
+         std::size_t size,
+         std::size_t elementSize,
+         double maxRatio,
+         std::vector<unsigned char>* compressed)
+{
+    compressed->clear();
+    if ( (size == 0) || (elementSize == 0) ) {
+        return false;
+    }
+
+    std::vector<unsigned char> shuffled;
+    const unsigned char* src = data;
+    if (elementSize > 1) {
+        shuffled.resize(size);
+        shuffle(data, size, elementSize, &shuffled[0]);
+        src = &shuffled[0];
+    }
+
+    const std::size_t maxCompressedSize = (std::size_t)(size * maxRatio);
+    compressed->reserve(maxCompressedSize + 16);
+
+    std::vector<std::size_t> hashTable(1 << NATRON_LZ_HASH_BITS, (std::size_t)-1);
+    std::size_t anchor = 0; // start of the pending literals
+    std::size_t i = 0;
+
+    while (i + NATRON_LZ_MIN_MATCH <= size) {
+        U32 sequence = read32(src + i);
+        U32 h = hashSequence(sequence);
+        std::size_t candidate = hashTable[h];
+        hashTable[h] = i;
+        if ( (candidate == (std::size_t)-1) || (i - candidate > NATRON_LZ_MAX_OFFSET) || (read32(src + candidate) != sequence) ) {
+            ++i;
+            continue;
+        }
+        std::size_t matchLength = NATRON_LZ_MIN_MATCH;
+        while ( (i + matchLength < size) && (src[candidate + matchLength] == src[i + matchLength]) ) {
+            ++matchLength;
+        }
+        writeSequence(src + anchor, i - anchor, i - candidate, matchLength, compressed);
+        i += matchLength;
+        anchor = i;
+        if (compressed->size() > maxCompressedSize) {
+            compressed->clear();
+
+            return false;
+        }
+    }
+    writeSequence(src + anchor, size - anchor, 0, 0, compressed);
+    if (compressed->size() > maxCompressedSize) {
+        compressed->clear();
+
+        return false;
+    }
+    // Keep the memory of the compressed data only
+    std::vector<unsigned char>(*compressed).swap(*compressed);
+
+    return true;
+} // compress
+
+bool
+decompress(const std::vector<unsigned char>& compressed,
+           std::size_t elementSize,
+           unsigned char* data,
+           std::size_t size)
+{
+    if ( compressed.empty() || (elementSize == 0) ) {
+        return false;
+    }
+
+    std::vector<unsigned char> shuffled;
+    unsigned char* dst = data;
+    if (elementSize > 1) {
+        shuffled.resize(size);
+        dst = &shuffled[0];
+    }
+
+    const unsigned char* ip = &compressed[0];
+    const unsigned char* iend = ip + compressed.size();
+    std::size_t o = 0;
+    for (;;) {
+        if (ip >= iend) {
+            return false;
+        }
+        unsigned char token = *ip++;
+        std::size_t literalsCount = token >> 4;
+        if ( (literalsCount == 15) && !readLength(&ip, iend, &literalsCount) ) {
+            return false;
+        }
+        if ( ( (std::size_t)(iend - ip) < literalsCount ) || (size - o < literalsCount) ) {
+            return false;
+        }
+        std::memcpy(dst + o, ip, literalsCount);
+        ip += literalsCount;
+        o += literalsCount;
+        if (ip == iend) {
+            // Last sequence
+            break;
+        }
+        if (iend - ip < 2) {
+            return false;
+        }
+        std::size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        std::size_t matchLength = token & 0xF;
+        if ( (matchLength == 15) && !readLength(&ip, iend, &matchLength) ) {
+            return false;
+        }
+        matchLength += NATRON_LZ_MIN_MATCH;
+        if ( (offset == 0) || (offset > o) || (size - o < matchLength) ) {
+            return false;
+        }
+        // The match may overlap the output, copy byte by byte
+        const unsigned char* match = dst + o - offset;
+        for (std::size_t j = 0; j < matchLength; ++j) {
+            dst[o + j] = match[j];
+        }
+        o += matchLength;
+    }
+    if (o != size) {
+        return false;
+    }
+    if (elementSize > 1) {
+        unshuffle(dst, size, elementSize, data);
+    }
+
+    return true;
+} // decompress
+
+} // namespace CacheCompression
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,62 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_CacheCompression_h
+#define Engine_CacheCompression_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef> // std::size_t
+#include <vector>
+
+// Entries that do not compress below this ratio of their size are not kept compressed
+#define NATRON_CACHE_COMPRESSION_MAX_RATIO 0.75
+
+NATRON_NAMESPACE_ENTER
+
+// Fast in-memory compression of the cache entries buffers.
+// The bytes of each element (e.g: a 32-bit float) are first shuffled so that bytes of the same significance are
+// contiguous, which makes image data much more compressible, then compressed with a LZ77 codec
+// in the spirit of LZ4 (greedy matching, no entropy coding) so that decompression runs close to memcpy speed.
+
+namespace CacheCompression {
+
+/**
+ * @brief Compresses size bytes of data made of elements of elementSize bytes (1, 2 or 4 for the image bit depths).
+ * Returns false if the data does not compress under maxRatio of its size, in which case compressed is left empty.
+ **/
+bool compress(const unsigned char* data, std::size_t size, std::size_t elementSize, double maxRatio, std::vector<unsigned char>* compressed);
+
+/**
+ * @brief Decompresses data compressed with compress() into data that must be able to hold size bytes, the
+ * size of the original data. Returns false if the compressed data is corrupted.
+ **/
+bool decompress(const std::vector<unsigned char>& compressed, std::size_t elementSize, unsigned char* data, std::size_t size);
+
+} // namespace CacheCompression
+
+NATRON_NAMESPACE_EXIT
+
+#endif // ifndef Engine_CacheCompression_h
@@ -61,10 +61,13 @@
 #include <SequenceParsing.h> // for removePath
 #endif
 
+#include "Engine/CacheCompression.h"
 #include "Engine/Hash64.h"
+#include "Engine/ImageBufferPool.h"
 #include "Engine/CacheEntryHolder.h"
 #include "Engine/MemoryFile.h"
 #include "Engine/NonKeyParams.h"
+#include "Engine/OutOfCoreStorage.h"
 #include "Engine/Texture.h"
 #include "Engine/EngineFwd.h"
 #include "Global/GlobalDefines.h"
@@ -81,11 +84,15 @@ class RamBuffer
     T* data;
     U64 count;
 
+    // The size of the buffer given by the pool, which may be larger than requested
+    std::size_t allocatedSize;
+
 public:
 
     RamBuffer()
         : data(0)
         , count(0)
+        , allocatedSize(0)
     {
     }
 
@@ -103,6 +110,7 @@ public:
     {
         std::swap(data, other.data);
         std::swap(count, other.count);
+        std::swap(allocatedSize, other.allocatedSize);
     }
 
     U64 size() const
@@ -117,23 +125,28 @@ public:
         }
         count = size;
         if (data) {
-            free(data);
+            // Keep the buffer if the new size fits in it without wasting more than a size class of the pool would,
+            // so that plug-ins and renders re-allocating the same amount do not go back to the pool
+            std::size_t bytes = size * sizeof(T);
+            if ( (bytes <= allocatedSize) && (bytes >= allocatedSize - allocatedSize / 4) ) {
+                return;
+            }
+            ImageBufferPool::release(data, allocatedSize);
             data = 0;
         }
         if (count == 0) {
             return;
         }
-        data = (T*)malloc( size * sizeof(T) );
-        if (!data) {
-            throw std::bad_alloc();
-        }
+        // Throws a std::bad_alloc on failure. The buffer is allocated on the NUMA node of the render thread
+        // that is going to fill it.
+        data = (T*)ImageBufferPool::allocate(size * sizeof(T), &allocatedSize);
     }
 
     void clear()
     {
         count = 0;
         if (data) {
-            free(data);
+            ImageBufferPool::release(data, allocatedSize);
             data = 0;
         }
     }
@@ -141,7 +154,7 @@ public:
     ~RamBuffer()
     {
         if (data) {
-            free(data);
+            ImageBufferPool::release(data, allocatedSize);
             data = 0;
         }
     }
@@ -150,11 +163,30 @@ public:
 // This is a cache file with a fixed size that is a multiple of the tileByteSize.
 // A bitset represents the allocated tiles in the file.
 // A value of true means that a tile is used by a cache entry.
+// A second bitset represents the tiles referenced by the persistent index of the cache whose entry was not created yet.
+// freeTiles is a stack of the indices of tiles that may be available, so that allocating a tile does not need to scan the bitsets:
+// an index is pushed at most once (see queuedFreeTiles) and is checked against the bitsets when popped.
 class TileCacheFile
 {
 public:
     MemoryFilePtr file;
     std::vector<bool> usedTiles;
+    std::vector<bool> indexedTiles;
+    std::vector<int> freeTiles;
+    std::vector<bool> queuedFreeTiles;
+
+    // True if the file is in the cache list of files that may have free tiles
+    bool queuedInCache;
+
+    TileCacheFile()
+        : file()
+        , usedTiles()
+        , indexedTiles()
+        , freeTiles()
+        , queuedFreeTiles()
+        , queuedInCache(false)
+    {
+    }
 };
 
 typedef TileCacheFilePtr TileCacheFilePtr;
@@ -221,6 +253,18 @@ public:
      **/
     virtual void removeAllEntriesWithDifferentNodeHashForHolderPrivate(const std::string& holderID, U64 nodeHash, bool removeAll) = 0;
 
+    /**
+     * @brief Called by the evictor thread to evict the last recently used entries until the occupation
+     * of the cache goes below its low watermark.
+     **/
+    virtual void evictExceedingEntriesToLowWatermark() = 0;
+
+    /**
+     * @brief Called by the preallocator thread to create the next tile cache file ahead of demand,
+     * so that allocTile() does not have to create it.
+     **/
+    virtual void preallocateTileCacheFile() = 0;
+
     /**
      * @brief Relevant only for tiled caches. This will allocate the memory required for a tile in the cache and lock it.
      * Note that the calling entry should have exactly the size of a tile in the cache.
@@ -389,11 +433,14 @@ public:
     Buffer()
         : _path()
         , _buffer()
+        , _compressedBuffer()
+        , _compressedCount(0)
         , _backingFile()
         , _entry(0)
         , _cacheFile()
         , _cacheFileDataOffset(0)
         , _storageMode(eStorageModeRAM)
+        , _outOfCore(false)
     {
     }
 
@@ -404,7 +451,7 @@ public:
 
     void allocateRAM(U64 count)
     {
-        if ( _buffer && (_buffer->size() > 0) ) {
+        if ( (_buffer && (_buffer->size() > 0)) || _compressedBuffer || _outOfCore ) {
             return;
         }
         _storageMode = eStorageModeRAM;
@@ -443,6 +490,40 @@ public:
         }
     }
 
+    /**
+     * @brief Maps a temporary file at the given path instead of allocating count elements in RAM, for buffers that do
+     * not fit in RAM (see OutOfCoreStorage). The file is removed on deallocation. If the file cannot be mapped, the
+     * buffer is allocated in RAM.
+     * The storage mode stays eStorageModeRAM: for the cache this is a RAM buffer, which is freed when evicted and is
+     * never part of the disk portion.
+     **/
+    void allocateOutOfCore(U64 count,
+                           const std::string& path)
+    {
+        if ( _backingFile || (_buffer && (_buffer->size() > 0)) || _compressedBuffer ) {
+            return;
+        }
+        try {
+            _backingFile.reset( new MemoryFile(path, MemoryFile::eFileOpenModeEnumIfExistsTruncateElseCreate) );
+            _backingFile->resize( count * sizeof(DataType) );
+        } catch (const std::exception & e) {
+            qDebug() << e.what();
+            _backingFile.reset();
+            std::remove( path.c_str() );
+            allocateRAM(count);
+
+            return;
+        }
+        // Reserve the disk blocks now when possible: running out of disk space while writing to the mapping would crash
+        _backingFile->allocateDiskSpace();
+#ifdef __NATRON_UNIX__
+        // The mapping stays valid once the file is unlinked, and the file cannot outlive the process if it crashes
+        std::remove( path.c_str() );
+#endif
+        _storageMode = eStorageModeRAM;
+        _outOfCore = true;
+    }
+
     void allocateGLTexture(const RectI& rectangle,
                            U32 target)
     {
@@ -506,13 +587,25 @@ public:
     void swap(Buffer& other)
     {
         if (_storageMode == eStorageModeRAM) {
-            if (other._storageMode == eStorageModeRAM) {
+            if (other._outOfCore) {
+                // Take the mapping of other rather than copying a buffer that does not fit in RAM
+                releaseOutOfCore();
+                _backingFile.swap(other._backingFile);
+                std::swap(_outOfCore, other._outOfCore);
+                if (_buffer) {
+                    _buffer->clear();
+                }
+            } else if (other._storageMode == eStorageModeRAM) {
                 if (other._buffer) {
+                    releaseOutOfCore();
                     if (!_buffer) {
                         _buffer.reset( new RamBuffer<DataType>() );
                     }
                     _buffer.swap(other._buffer);
                 }
+            } else if (_outOfCore) {
+                _backingFile->resize( other._backingFile->size() );
+                std::memcpy( _backingFile->data(), other._backingFile->data(), other._backingFile->size() );
             } else {
                 if (!_buffer) {
                     _buffer.reset( new RamBuffer<DataType>() );
@@ -528,15 +621,84 @@ public:
                 _backingFile.swap(other._backingFile);
                 _path = other._path;
             } else {
-                _backingFile->resize( other._buffer->size() * sizeof(DataType) );
+                std::size_t otherSize = other._outOfCore ? other._backingFile->size() : other._buffer->size() * sizeof(DataType);
+                _backingFile->resize(otherSize);
                 assert( _backingFile->data() );
-                const char* src = (const char*)other._buffer->getData();
+                const char* src = other._outOfCore ? other._backingFile->data() : (const char*)other._buffer->getData();
                 char* dst = (char*)_backingFile->data();
-                std::memcpy( dst, src, other._buffer->size() * sizeof(DataType) );
+                std::memcpy(dst, src, otherSize);
             }
         }
     }
 
+    /**
+     * @brief Compresses a copy of the RAM buffer made of elements of elementSize bytes, leaving the buffer untouched.
+     * count is set to the number of elements compressed.
+     * Returns false if it is not in RAM or does not compress well enough, in which case it is not worth keeping it compressed.
+     **/
+    bool compressRAMCopy(std::size_t elementSize,
+                         std::vector<unsigned char>* compressed,
+                         std::size_t* count) const
+    {
+        if ( (_storageMode != eStorageModeRAM) || _outOfCore || !_buffer || (_buffer->size() == 0) || _compressedBuffer ) {
+            return false;
+        }
+        if ( !CacheCompression::compress( (const unsigned char*)_buffer->getData(), _buffer->size() * sizeof(DataType), elementSize,
+                                          NATRON_CACHE_COMPRESSION_MAX_RATIO, compressed ) ) {
+            return false;
+        }
+        *count = _buffer->size();
+
+        return true;
+    }
+
+    /**
+     * @brief Frees the RAM buffer and keeps instead its copy compressed by compressRAMCopy(), which is swapped with compressed.
+     * Returns false and leaves the buffer untouched if it changed since the copy was made.
+     **/
+    bool setCompressedRAM(std::vector<unsigned char>* compressed,
+                          std::size_t count)
+    {
+        if ( (_storageMode != eStorageModeRAM) || _outOfCore || !_buffer || (_buffer->size() != count) || _compressedBuffer ) {
+            return false;
+        }
+        _compressedBuffer.reset( new std::vector<unsigned char>() );
+        _compressedBuffer->swap(*compressed);
+        _compressedCount = count;
+        _buffer->clear();
+
+        return true;
+    }
+
+    /**
+     * @brief Restores the RAM buffer compressed by setCompressedRAM().
+     * WARNING: This function throws a std::bad_alloc if the allocation fails and returns false
+     * if the compressed data is corrupted, in which case the buffer is deallocated.
+     **/
+    bool decompressRAM(std::size_t elementSize)
+    {
+        if (!_compressedBuffer) {
+            return true;
+        }
+        if (!_buffer) {
+            _buffer.reset( new RamBuffer<DataType>() );
+        }
+        _buffer->resize(_compressedCount);
+        bool ok = CacheCompression::decompress( *_compressedBuffer, elementSize, (unsigned char*)_buffer->getData(), _compressedCount * sizeof(DataType) );
+        _compressedBuffer.reset();
+        _compressedCount = 0;
+        if (!ok) {
+            _buffer->clear();
+        }
+
+        return ok;
+    }
+
+    bool isCompressed() const
+    {
+        return _compressedBuffer.get() != 0;
+    }
+
     const std::string& getFilePath() const
     {
         return _path;
@@ -556,6 +718,8 @@ public:
             _backingFile.reset();
             throw std::bad_alloc();
         }
+        // The entry is reopened because it is about to be read entirely (e.g: a DiskCache node output during playback)
+        _backingFile->prefetch();
     }
 
     void restoreBufferFromFile(const std::string & path, std::size_t dataOffset, AbstractCacheEntryBase* entry, bool isTileCache)
@@ -578,6 +742,9 @@ public:
             if (_buffer) {
                 _buffer->clear();
             }
+            _compressedBuffer.reset();
+            _compressedCount = 0;
+            releaseOutOfCore();
         } else if (_storageMode == eStorageModeDisk) {
             if (_backingFile) {
                 bool flushOk = _backingFile->flush(MemoryFile::eFlushTypeAsync, 0, 0);
@@ -599,6 +766,10 @@ public:
 
     void syncBackingFile() const
     {
+        if (_outOfCore) {
+            // Temporary content, never read back from the file
+            return;
+        }
         if (_backingFile) {
             _backingFile->flush(MemoryFile::eFlushTypeAsync, 0, 0);
         } else if (_cacheFile && _entry) {
@@ -626,11 +797,18 @@ public:
     }
 
     /**
-     * @brief Returns the size of the buffer in bytes.
+     * @brief Returns the size of the buffer in bytes. When compressed, this is the size of the compressed data.
      **/
     size_t size() const
     {
         if (_storageMode == eStorageModeRAM) {
+            if (_compressedBuffer) {
+                return _compressedBuffer->size();
+            }
+            if (_outOfCore) {
+                return _backingFile->size();
+            }
+
             return _buffer ? _buffer->size() * sizeof(DataType) : 0;
         } else if (_storageMode == eStorageModeDisk) {
             if (_backingFile) {
@@ -650,7 +828,7 @@ public:
 
     bool isAllocated() const
     {
-        return (_buffer && _buffer->size() > 0) || ( _backingFile && _backingFile->data() ) || _cacheFile || _glTexture;
+        return (_buffer && _buffer->size() > 0) || _compressedBuffer || ( _backingFile && _backingFile->data() ) || _cacheFile || _glTexture;
     }
 
     DataType* writable()
@@ -664,6 +842,10 @@ public:
                 return NULL;
             }
         } else if (_storageMode == eStorageModeRAM) {
+            if (_outOfCore) {
+                return (DataType*)_backingFile->data();
+            }
+
             return _buffer ? _buffer->getData() : NULL;
         } else {
             // Other storage modes don't provide direct access to RAM handle
@@ -682,6 +864,10 @@ public:
                 return 0;
             }
         } else if (_storageMode == eStorageModeRAM) {
+            if (_outOfCore) {
+                return (const DataType*)_backingFile->data();
+            }
+
             return _buffer ? _buffer->getData() : NULL;
         } else {
             // Other storage modes don't provide direct access to RAM handle
@@ -721,9 +907,29 @@ public:
 
 private:
 
+    /**
+     * @brief Unmaps and removes the file of a buffer allocated by allocateOutOfCore(): its content is temporary,
+     * it is dropped rather than written to the file.
+     **/
+    void releaseOutOfCore()
+    {
+        if (!_outOfCore) {
+            return;
+        }
+        if (_backingFile) {
+            _backingFile->remove();
+            _backingFile.reset();
+        }
+        _outOfCore = false;
+    }
+
     std::string _path;
     boost::scoped_ptr<RamBuffer<DataType> > _buffer;
 
+    // Set when the RAM buffer is compressed, _buffer is then empty
+    boost::scoped_ptr<std::vector<unsigned char> > _compressedBuffer;
+    U64 _compressedCount;
+
     /*mutable so the reOpenFileMapping function can reopen the mapped file. It doesn't
        change the underlying data*/
     mutable boost::scoped_ptr<MemoryFile> _backingFile;
@@ -736,6 +942,9 @@ private:
     // Used when we store images as OpenGL textures
     boost::scoped_ptr<Texture> _glTexture;
     StorageModeEnum _storageMode;
+
+    // Set if the RAM buffer is a temporary file mapped by allocateOutOfCore(), in _backingFile
+    bool _outOfCore;
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -771,6 +980,10 @@ public:
         , _cache()
         , _entryLock(QReadWriteLock::Recursive)
         , _removeBackingFileBeforeDestruction(false)
+        , _renderCostLock()
+        , _renderCost(0.)
+        , _pinned(false)
+        , _lookupCount(0)
     {
     }
 
@@ -789,6 +1002,10 @@ public:
         , _cache(cache)
         , _entryLock(QReadWriteLock::Recursive)
         , _removeBackingFileBeforeDestruction(false)
+        , _renderCostLock()
+        , _renderCost(0.)
+        , _pinned(false)
+        , _lookupCount(0)
     {
     }
 
@@ -1037,6 +1254,78 @@ public:
         return _data.isAllocated();
     }
 
+    /**
+     * @brief Compresses a copy of the RAM buffer of the entry, to be set with setCompressedData(). The entry is left untouched
+     * and may be used meanwhile. Returns false if the entry is not in RAM or does not compress well enough.
+     **/
+    bool getCompressedCopy(std::vector<unsigned char>* compressed,
+                           std::size_t* count) const
+    {
+        QReadLocker k(&_entryLock);
+
+        return _data.compressRAMCopy(_params->getStorageInfo().dataTypeSize, compressed, count);
+    }
+
+    /**
+     * @brief Replaces the RAM buffer of the entry by its copy made by getCompressedCopy(), so that it takes less memory while
+     * it is not used. The data must not have been modified since the copy was made.
+     * The entry must be decompressed with decompress() before its data can be accessed again.
+     **/
+    bool setCompressedData(std::vector<unsigned char>* compressed,
+                           std::size_t count)
+    {
+        std::size_t oldSize, newSize;
+        {
+            QWriteLocker k(&_entryLock);
+            oldSize = _data.size();
+            if ( !_data.setCompressedRAM(compressed, count) ) {
+                return false;
+            }
+            newSize = _data.size();
+        }
+        if (_cache) {
+            _cache->notifyEntrySizeChanged(oldSize, newSize);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Restores the data of an entry compressed by setCompressedData(). Does nothing if it is not compressed.
+     * Returns false if the data could not be restored, the entry is then deallocated.
+     **/
+    bool decompress()
+    {
+        std::size_t oldSize, newSize;
+        bool ok;
+        {
+            QWriteLocker k(&_entryLock);
+            if ( !_data.isCompressed() ) {
+                return true;
+            }
+            oldSize = _data.size();
+            try {
+                ok = _data.decompressRAM(_params->getStorageInfo().dataTypeSize);
+            } catch (const std::bad_alloc &) {
+                _data.deallocate();
+                ok = false;
+            }
+            newSize = _data.size();
+        }
+        if (_cache) {
+            _cache->notifyEntrySizeChanged(oldSize, newSize);
+        }
+
+        return ok;
+    }
+
+    bool isCompressed() const
+    {
+        QReadLocker k(&_entryLock);
+
+        return _data.isCompressed();
+    }
+
     virtual void syncBackingFile() const OVERRIDE FINAL
     {
         QWriteLocker k(&_entryLock);
@@ -1086,6 +1375,52 @@ public:
         return _key.getTime();
     }
 
+    /**
+     * @brief Accumulates the time in seconds that was spent to compute the content of this entry.
+     * The cache eviction policy uses it to keep longer the entries that are expensive to compute again.
+     **/
+    void addRenderCost(double timeSpent)
+    {
+        QMutexLocker k(&_renderCostLock);
+
+        _renderCost += timeSpent;
+    }
+
+    double getRenderCost() const
+    {
+        QMutexLocker k(&_renderCostLock);
+
+        return _renderCost;
+    }
+
+    /**
+     * @brief A pinned entry is only evicted once the pinned entries alone exceed the cache size, see Cache::setHolderPinned.
+     * Must be called under the lock of the cache shard holding the entry.
+     **/
+    void setPinned(bool pinned)
+    {
+        _pinned = pinned;
+    }
+
+    bool isPinned() const
+    {
+        return _pinned;
+    }
+
+    /**
+     * @brief Counts the look-ups that returned the entry, so that the cache can tell whether it was used in-between.
+     * Must be called under the lock of the cache shard holding the entry.
+     **/
+    void notifyLookedUp()
+    {
+        ++_lookupCount;
+    }
+
+    U64 getLookupCount() const
+    {
+        return _lookupCount;
+    }
+
     ParamsTypePtr getParams() const WARN_UNUSED_RETURN
     {
         return _params;
@@ -1222,7 +1557,11 @@ private:
             }
         } else if (info.mode == eStorageModeRAM) {
             U64 count = getElementsCountFromParams();
-            _data.allocateRAM(count);
+            if ( OutOfCoreStorage::shouldAllocateOnDisk( count * sizeof(DataType) ) ) {
+                _data.allocateOutOfCore( count, OutOfCoreStorage::getNewFilePath() );
+            } else {
+                _data.allocateRAM(count);
+            }
         } else if (info.mode == eStorageModeGLTex) {
             _data.allocateGLTexture(info.bounds, info.textureTarget);
         }
@@ -1253,6 +1592,14 @@ protected:
     const CacheAPI* _cache;
     mutable QReadWriteLock _entryLock;
     bool _removeBackingFileBeforeDestruction;
+
+    // Not protected by _entryLock because it is updated while rendering, when the entry may already be locked
+    mutable QMutex _renderCostLock;
+    double _renderCost;
+
+    // Protected by the lock of the cache shard holding the entry
+    bool _pinned;
+    U64 _lookupCount;
 };
 
 NATRON_NAMESPACE_EXIT
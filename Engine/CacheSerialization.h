@@ -30,11 +30,19 @@
 
 #include <list>
 #include <set>
+#include <map>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
 #include <cstddef>
+#include <cstring>
+#include <algorithm>
 #include <stdexcept>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 GCC_DIAG_OFF(unused-parameter)
 // /opt/local/include/boost/serialization/smart_cast.hpp:254:25: warning: unused parameter 'u' [-Wunused-parameter]
@@ -50,7 +58,14 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 GCC_DIAG_ON(unused-parameter)
 #endif
 
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFileInfo>
+#include <QtCore/QUuid>
+
 #include "Engine/Cache.h"
+#include "Engine/MemoryFile.h"
 #include "Engine/ImageSerialization.h"
 #include "Engine/ImageParamsSerialization.h"
 #include "Engine/FrameEntrySerialization.h"
@@ -61,6 +76,13 @@ GCC_DIAG_ON(unused-parameter)
 #define SERIALIZED_ENTRY_INTRODUCES_SIZE 2
 #define SERIALIZED_ENTRY_VERSION SERIALIZED_ENTRY_INTRODUCES_SIZE
 
+// Persistent index of the tile caches, it does not have to maintain backward compatibility either
+#define NATRON_CACHE_INDEX_MAGIC 0x5849434E // "NCIX"
+#define NATRON_CACHE_INDEX_VERSION 1
+
+// Extension of the files holding the key and parameters of the entries of the shared disk cache tier
+#define NATRON_SHARED_CACHE_META_EXT "meta"
+
 //Beyond that percentage of occupation, the cache will start evicting LRU entries
 #define NATRON_CACHE_LIMIT_PERCENT 0.9
 
@@ -76,10 +98,11 @@ void
 Cache<EntryType>::save(CacheTOC* tableOfContents)
 {
     clearInMemoryPortion(false);
-    {
-        QMutexLocker l(&_lock);     // must be locked
+    for (std::size_t i = 0; i < _shards.size(); ++i) {
+        CacheShard& shard = *_shards[i];
+        QMutexLocker l(&shard.lock);     // must be locked
 
-        for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
+        for (CacheIterator it = shard.diskCache.begin(); it != shard.diskCache.end(); ++it) {
             std::list<EntryTypePtr> & listOfValues  = getValueFromIterator(it);
             for (typename std::list<EntryTypePtr>::const_iterator it2 = listOfValues.begin(); it2 != listOfValues.end(); ++it2) {
                 if ( (*it2)->isStoredOnDisk() ) {
@@ -154,8 +177,9 @@ Cache<EntryType>::restore(const CacheTOC & tableOfContents)
         const std::string& filePath = value->getFilePath();
         usedFilePaths.insert(QString::fromUtf8(filePath.c_str()));
         {
-            QMutexLocker locker(&_lock);
-            sealEntry(EntryTypePtr(value), false /*inMemory*/);
+            CacheShard& shard = getShard( value->getHashKey() );
+            QMutexLocker locker(&shard.lock);
+            sealEntry(shard, EntryTypePtr(value), false /*inMemory*/);
         }
     }
 
@@ -197,6 +221,812 @@ Cache<EntryType>::restore(const CacheTOC & tableOfContents)
     }
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////// PERSISTENT INDEX ///////////////////////////////////////////
+
+/**
+ * @brief Header of the persistent index of a tiled cache. The index file layout is:
+ * - the header
+ * - the records, sorted by hash
+ * - the table of the tile file names (relative to the cache path), each one terminated by a null character
+ * - the serialized keys and parameters of the entries
+ * The checksum covers the header (with a null checksum), the records and the file names table, so that the
+ * index can be validated without reading the serialized entries, which are only read when an entry is looked up.
+ **/
+struct CacheIndexHeader
+{
+    U32 magic;
+    U32 indexVersion;
+    U32 cacheVersion;
+    U32 filesCount;
+    U64 tileSizeBytes;
+    U64 recordsCount;
+    U64 filesTableSize;
+    U64 blobsSize;
+    U64 checksum;
+};
+
+struct CacheIndexRecord
+{
+    U64 hash;
+    U64 dataOffset; //< offset of the tile in its file
+    U64 blobOffset; //< offset of the serialized key and parameters from the start of the serialized entries
+    U32 blobSize;
+    U32 fileIndex;
+};
+
+inline bool
+operator<(const CacheIndexRecord& record,
+          U64 hash)
+{
+    return record.hash < hash;
+}
+
+// FNV-1a
+inline U64
+computeCacheIndexChecksum(const char* data,
+                          std::size_t size,
+                          U64 checksum = 14695981039346656037ULL)
+{
+    for (std::size_t i = 0; i < size; ++i) {
+        checksum ^= (unsigned char)data[i];
+        checksum *= 1099511628211ULL;
+    }
+
+    return checksum;
+}
+
+// An entry of the index while it is being written
+struct CacheIndexEntry
+{
+    CacheIndexRecord record;
+    std::string fileName;
+    std::string blob;
+    bool taken; //< true if the entry exists in the cache, false if it is still only referenced by the previous index
+
+    bool operator<(const CacheIndexEntry& other) const
+    {
+        return record.hash < other.record.hash;
+    }
+};
+
+template<typename EntryType>
+class CachePersistentIndex
+    : public CachePersistentIndexBase<EntryType>
+{
+public:
+
+    typedef typename Cache<EntryType>::EntryTypePtr EntryTypePtr;
+    typedef typename Cache<EntryType>::ParamsTypePtr ParamsTypePtr;
+
+    /**
+     * @brief Maps the given index file. Throws an exception if the file cannot be mapped or if it is not a valid index.
+     **/
+    CachePersistentIndex(Cache<EntryType>* cache,
+                         const std::string& filePath)
+        : _cache(cache)
+        , _file()
+        , _header(0)
+        , _records(0)
+        , _blobs(0)
+        , _filePaths()
+        , _taken()
+        , _dropIndex(0)
+    {
+        _file = boost::make_shared<MemoryFile>(filePath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseFail);
+        const char* data = _file->data();
+        std::size_t fileSize = _file->size();
+        if ( !data || (fileSize < sizeof(CacheIndexHeader)) ) {
+            throw std::runtime_error("Truncated cache index");
+        }
+        _header = reinterpret_cast<const CacheIndexHeader*>(data);
+        if ( (_header->magic != NATRON_CACHE_INDEX_MAGIC) || (_header->indexVersion != NATRON_CACHE_INDEX_VERSION) ||
+             (_header->cacheVersion != cache->cacheVersion()) || (_header->tileSizeBytes != cache->getTileSizeBytes()) ) {
+            throw std::runtime_error("Cache index version mismatch");
+        }
+        U64 recordsSize = _header->recordsCount * sizeof(CacheIndexRecord);
+        if ( (_header->recordsCount > fileSize / sizeof(CacheIndexRecord)) ||
+             (sizeof(CacheIndexHeader) + recordsSize + _header->filesTableSize + _header->blobsSize != fileSize) ) {
+            throw std::runtime_error("Truncated cache index");
+        }
+
+        CacheIndexHeader header = *_header;
+        header.checksum = 0;
+        U64 checksum = computeCacheIndexChecksum(reinterpret_cast<const char*>(&header), sizeof(header));
+        checksum = computeCacheIndexChecksum(data + sizeof(CacheIndexHeader), recordsSize + _header->filesTableSize, checksum);
+        if (checksum != _header->checksum) {
+            throw std::runtime_error("Corrupted cache index");
+        }
+
+        _records = reinterpret_cast<const CacheIndexRecord*>(data + sizeof(CacheIndexHeader));
+        const char* filesTable = data + sizeof(CacheIndexHeader) + recordsSize;
+        _blobs = filesTable + _header->filesTableSize;
+
+        QString cachePath = cache->getCachePath();
+        StrUtils::ensureLastPathSeparator(cachePath);
+        std::size_t nameStart = 0;
+        for (std::size_t i = 0; i < _header->filesTableSize; ++i) {
+            if (filesTable[i] == 0) {
+                _filePaths.push_back( cachePath.toStdString() + std::string(filesTable + nameStart, i - nameStart) );
+                nameStart = i + 1;
+            }
+        }
+        if (_filePaths.size() != _header->filesCount) {
+            throw std::runtime_error("Corrupted cache index");
+        }
+        _taken.resize(_header->recordsCount, false);
+    }
+
+    virtual ~CachePersistentIndex()
+    {
+    }
+
+    U64 getRecordsCount() const
+    {
+        return _header->recordsCount;
+    }
+
+    const CacheIndexRecord& getRecord(std::size_t i) const
+    {
+        return _records[i];
+    }
+
+    bool isRecordTaken(std::size_t i) const
+    {
+        return _taken[i];
+    }
+
+    const std::string& getRecordFilePath(const CacheIndexRecord& record) const
+    {
+        return _filePaths[record.fileIndex];
+    }
+
+    const char* getRecordBlob(const CacheIndexRecord& record) const
+    {
+        return _blobs + record.blobOffset;
+    }
+
+    /**
+     * @brief Reserves the tiles of all records so that they do not get allocated to other entries
+     * and accounts for their size in the cache. Invalid records, referencing tiles that do not exist or
+     * that are referenced twice, are ignored.
+     **/
+    void reserveTiles()
+    {
+        std::size_t tileSize = _header->tileSizeBytes;
+
+        for (std::size_t i = 0; i < _header->recordsCount; ++i) {
+            const CacheIndexRecord& record = _records[i];
+            if ( (record.fileIndex >= _filePaths.size()) || (record.blobOffset + record.blobSize > _header->blobsSize) ||
+                 !_cache->reserveIndexedTile(_filePaths[record.fileIndex], record.dataOffset) ) {
+                _taken[i] = true;
+                continue;
+            }
+            _cache->_diskCacheSize.fetch_add(tileSize);
+        }
+    }
+
+    /**
+     * @brief Marks the given records as taken without releasing their tile: they were created
+     * before the index was written again.
+     **/
+    void setRecordsTaken(const std::vector<bool>& taken)
+    {
+        assert( taken.size() == _taken.size() );
+        _taken = taken;
+    }
+
+    virtual void takeEntries(U64 hash,
+                             std::list<EntryTypePtr>* entries) OVERRIDE FINAL
+    {
+        const CacheIndexRecord* end = _records + _header->recordsCount;
+        std::size_t tileSize = _header->tileSizeBytes;
+
+        for (const CacheIndexRecord* it = std::lower_bound(_records, end, hash); it != end && it->hash == hash; ++it) {
+            std::size_t i = it - _records;
+            if (_taken[i]) {
+                continue;
+            }
+            _taken[i] = true;
+            // The entry notifies its size again when its metadata are restored
+            Cache<EntryType>::subtractClamped(_cache->_diskCacheSize, tileSize);
+
+            EntryType* value = NULL;
+            try {
+                typename EntryType::key_type key;
+                ParamsTypePtr params;
+                {
+                    std::string blob(_blobs + it->blobOffset, it->blobSize);
+                    std::istringstream ss(blob);
+                    boost::archive::binary_iarchive iArchive(ss, boost::archive::no_header);
+                    iArchive >> key;
+                    iArchive >> params;
+                }
+                if (key.getHash() != hash) {
+                    throw std::runtime_error("Cache index entry hash mismatch");
+                }
+                value = new EntryType(key, params, _cache);
+                ///This will not put the entry back into RAM, instead we just insert back the entry into the disk cache
+                value->restoreMetadataFromFile(tileSize, _filePaths[it->fileIndex], it->dataOffset);
+            } catch (const std::exception & e) {
+                qDebug() << "Failed to restore cache entry:" << e.what();
+                delete value;
+                _cache->releaseIndexedTile(_filePaths[it->fileIndex], it->dataOffset);
+                continue;
+            }
+            entries->push_back( EntryTypePtr(value) );
+        }
+    }
+
+    virtual bool dropEntry() OVERRIDE FINAL
+    {
+        while ( _dropIndex < _taken.size() ) {
+            std::size_t i = _dropIndex++;
+            if (!_taken[i]) {
+                _taken[i] = true;
+                _cache->releaseIndexedTile(_filePaths[_records[i].fileIndex], _records[i].dataOffset);
+                Cache<EntryType>::subtractClamped(_cache->_diskCacheSize, _header->tileSizeBytes);
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    virtual void dropAllEntries() OVERRIDE FINAL
+    {
+        while ( dropEntry() ) {
+        }
+    }
+
+private:
+
+    Cache<EntryType>* _cache;
+    MemoryFilePtr _file;
+    const CacheIndexHeader* _header;
+    const CacheIndexRecord* _records;
+    const char* _blobs;
+    std::vector<std::string> _filePaths;
+
+    // Records whose entry was created, or that were dropped
+    std::vector<bool> _taken;
+
+    // Next record to consider in dropEntry(). Records are sorted by hash, so this drops them in no particular order.
+    std::size_t _dropIndex;
+};
+
+/*Writes the index of the tile cache.*/
+template<typename EntryType>
+void
+Cache<EntryType>::saveIndex()
+{
+    assert(_isTiled);
+
+    std::vector<CacheIndexEntry> indexedEntries;
+
+    clearInMemoryPortion(false);
+    for (std::size_t i = 0; i < _shards.size(); ++i) {
+        CacheShard& shard = *_shards[i];
+        QMutexLocker l(&shard.lock);     // must be locked
+
+        for (CacheIterator it = shard.diskCache.begin(); it != shard.diskCache.end(); ++it) {
+            std::list<EntryTypePtr> & listOfValues  = getValueFromIterator(it);
+            for (typename std::list<EntryTypePtr>::const_iterator it2 = listOfValues.begin(); it2 != listOfValues.end(); ++it2) {
+                if ( !(*it2)->isStoredOnDisk() || ( (*it2)->dataSize() != _tileByteSize ) ) {
+                    continue;
+                }
+                CacheIndexEntry entry;
+                entry.record.hash = (*it2)->getHashKey();
+                entry.record.dataOffset = (*it2)->getOffsetInFile();
+                entry.fileName = QFileInfo( QString::fromUtf8( (*it2)->getFilePath().c_str() ) ).fileName().toStdString();
+                entry.taken = true;
+                try {
+                    std::ostringstream ss;
+                    boost::archive::binary_oarchive oArchive(ss, boost::archive::no_header);
+                    typename EntryType::key_type key = (*it2)->getKey();
+                    ParamsTypePtr params = (*it2)->getParams();
+                    oArchive << key;
+                    oArchive << params;
+                    entry.blob = ss.str();
+                } catch (const std::exception & e) {
+                    qDebug() << "Failed to serialize cache entry:" << e.what();
+                    continue;
+                }
+
+                (*it2)->syncBackingFile();
+                indexedEntries.push_back(entry);
+            }
+        }
+    }
+
+    const std::string indexFilePath = getIndexFilePath();
+    const std::string tmpIndexFilePath = indexFilePath + ".tmp";
+    QMutexLocker k(&_persistentIndexMutex);
+
+    // Entries of the previous index that were not looked up since the cache was restored are kept as they are
+    boost::shared_ptr<CachePersistentIndex<EntryType> > previousIndex = boost::dynamic_pointer_cast<CachePersistentIndex<EntryType> >(_persistentIndex);
+    if (previousIndex) {
+        for (std::size_t i = 0; i < previousIndex->getRecordsCount(); ++i) {
+            if ( previousIndex->isRecordTaken(i) ) {
+                continue;
+            }
+            const CacheIndexRecord& record = previousIndex->getRecord(i);
+            CacheIndexEntry entry;
+            entry.record = record;
+            entry.fileName = QFileInfo( QString::fromUtf8( previousIndex->getRecordFilePath(record).c_str() ) ).fileName().toStdString();
+            entry.blob.assign(previousIndex->getRecordBlob(record), record.blobSize);
+            entry.taken = false;
+            indexedEntries.push_back(entry);
+        }
+    }
+    std::sort( indexedEntries.begin(), indexedEntries.end() );
+
+    CacheIndexHeader header;
+    header.magic = NATRON_CACHE_INDEX_MAGIC;
+    header.indexVersion = NATRON_CACHE_INDEX_VERSION;
+    header.cacheVersion = cacheVersion();
+    header.tileSizeBytes = _tileByteSize;
+    header.recordsCount = indexedEntries.size();
+    header.blobsSize = 0;
+    header.checksum = 0;
+
+    std::map<std::string, U32> fileIndices;
+    std::string filesTable;
+    std::vector<bool> taken( indexedEntries.size() );
+    for (std::size_t i = 0; i < indexedEntries.size(); ++i) {
+        CacheIndexEntry& entry = indexedEntries[i];
+        std::map<std::string, U32>::iterator foundFile = fileIndices.find(entry.fileName);
+        if ( foundFile == fileIndices.end() ) {
+            foundFile = fileIndices.insert( std::make_pair( entry.fileName, (U32)fileIndices.size() ) ).first;
+            filesTable.append(entry.fileName);
+            filesTable.push_back(0);
+        }
+        entry.record.fileIndex = foundFile->second;
+        entry.record.blobOffset = header.blobsSize;
+        entry.record.blobSize = (U32)entry.blob.size();
+        header.blobsSize += entry.blob.size();
+        taken[i] = entry.taken;
+    }
+    header.filesCount = (U32)fileIndices.size();
+    header.filesTableSize = filesTable.size();
+
+    std::size_t recordsSize = indexedEntries.size() * sizeof(CacheIndexRecord);
+    std::size_t fileSize = sizeof(CacheIndexHeader) + recordsSize + filesTable.size() + header.blobsSize;
+    try {
+        MemoryFile file(tmpIndexFilePath, fileSize, MemoryFile::eFileOpenModeEnumIfExistsTruncateElseCreate);
+        char* data = file.data();
+        char* records = data + sizeof(CacheIndexHeader);
+        char* blobs = records + recordsSize + filesTable.size();
+        for (std::size_t i = 0; i < indexedEntries.size(); ++i) {
+            std::memcpy( records + i * sizeof(CacheIndexRecord), &indexedEntries[i].record, sizeof(CacheIndexRecord) );
+            std::memcpy( blobs + indexedEntries[i].record.blobOffset, indexedEntries[i].blob.data(), indexedEntries[i].blob.size() );
+        }
+        std::memcpy( records + recordsSize, filesTable.data(), filesTable.size() );
+
+        U64 checksum = computeCacheIndexChecksum(reinterpret_cast<const char*>(&header), sizeof(header));
+        header.checksum = computeCacheIndexChecksum(records, recordsSize + filesTable.size(), checksum);
+        std::memcpy( data, &header, sizeof(CacheIndexHeader) );
+        if ( !file.flush(MemoryFile::eFlushTypeSync, 0, 0) ) {
+            throw std::runtime_error("Failed to flush the cache index");
+        }
+    } catch (const std::exception & e) {
+        qDebug() << "Failed to write the cache index:" << e.what();
+        QFile::remove( QString::fromUtf8( tmpIndexFilePath.c_str() ) );
+
+        return;
+    }
+
+    // The previous index must be unmapped before its file can be replaced. The tiles it reserves stay reserved
+    // by the new one.
+    _persistentIndex.reset();
+    previousIndex.reset();
+    QFile::remove( QString::fromUtf8( indexFilePath.c_str() ) );
+    if ( !QFile::rename( QString::fromUtf8( tmpIndexFilePath.c_str() ), QString::fromUtf8( indexFilePath.c_str() ) ) ) {
+        qDebug() << "Failed to write the cache index to" << indexFilePath.c_str();
+
+        return;
+    }
+    try {
+        boost::shared_ptr<CachePersistentIndex<EntryType> > index = boost::make_shared<CachePersistentIndex<EntryType> >(this, indexFilePath);
+        index->setRecordsTaken(taken);
+        _persistentIndex = index;
+    } catch (const std::exception & e) {
+        qDebug() << "Failed to map the cache index:" << e.what();
+    }
+} // saveIndex
+
+/*Maps the index of the tile cache.*/
+template<typename EntryType>
+bool
+Cache<EntryType>::restoreIndex()
+{
+    assert(_isTiled);
+
+    const std::string indexFilePath = getIndexFilePath();
+    if ( !CacheAPI::fileExists(indexFilePath) ) {
+        return false;
+    }
+
+    boost::shared_ptr<CachePersistentIndex<EntryType> > index;
+    try {
+        index = boost::make_shared<CachePersistentIndex<EntryType> >(this, indexFilePath);
+    } catch (const std::exception & e) {
+        qDebug() << "Invalid cache index" << indexFilePath.c_str() << ":" << e.what();
+
+        return false;
+    }
+    index->reserveTiles();
+
+    // Remove from the cache all files that are not referenced by the index
+    std::set<QString> usedFileNames;
+    usedFileNames.insert( QFileInfo( QString::fromUtf8( indexFilePath.c_str() ) ).fileName() );
+    for (std::size_t i = 0; i < index->getRecordsCount(); ++i) {
+        const CacheIndexRecord& record = index->getRecord(i);
+        if ( !index->isRecordTaken(i) ) {
+            usedFileNames.insert( QFileInfo( QString::fromUtf8( index->getRecordFilePath(record).c_str() ) ).fileName() );
+        }
+    }
+    QDir cacheFolder( getCachePath() );
+    QStringList etr = cacheFolder.entryList(QDir::Files);
+    for (QStringList::iterator it = etr.begin(); it != etr.end(); ++it) {
+        if ( usedFileNames.find(*it) == usedFileNames.end() ) {
+            cacheFolder.remove(*it);
+        }
+    }
+
+    QMutexLocker k(&_persistentIndexMutex);
+    _persistentIndex = index;
+
+    return true;
+} // restoreIndex
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////// SHARED TIER ///////////////////////////////////////////
+
+/**
+ * @brief Path of the data file of an entry in the shared tier. As in the disk portion, entries are spread in
+ * sub-folders named after the first 2 hexadecimal digits of their hash. The key and parameters of the entry
+ * are stored next to it, in a file with the NATRON_SHARED_CACHE_META_EXT extension appended: an entry is
+ * complete once this file exists.
+ **/
+inline std::string
+getSharedCacheEntryFilePath(const QString& sharedCachePath,
+                            U64 hash)
+{
+    QString hashKeyStr = QString::number(hash, 16); //< hex is base 16
+    QString path(sharedCachePath);
+
+    StrUtils::ensureLastPathSeparator(path);
+    path += hashKeyStr.left(2) + QLatin1Char('/') + hashKeyStr.mid(2) + QString::fromUtf8("." NATRON_CACHE_FILE_EXT);
+
+    return path.toStdString();
+}
+
+template<typename EntryType>
+bool
+Cache<EntryType>::readSharedEntryMetadata(const std::string& metaFilePath,
+                                          typename EntryType::key_type* key,
+                                          ParamsTypePtr* params,
+                                          std::size_t* size) const
+{
+    try {
+        std::ifstream ifile(metaFilePath.c_str(), std::ios::in | std::ios::binary);
+        if (!ifile) {
+            return false;
+        }
+        boost::archive::binary_iarchive iArchive(ifile, boost::archive::no_header);
+        unsigned int version = 0;
+        iArchive >> version;
+        if (version != _version) {
+            // Written by another version
+            return false;
+        }
+        iArchive >> *key;
+        iArchive >> *params;
+        iArchive >> *size;
+    } catch (const std::exception & e) {
+        qDebug() << "Failed to read cache entry" << metaFilePath.c_str() << ":" << e.what();
+
+        return false;
+    }
+
+    return true;
+}
+
+template<typename EntryType>
+std::string
+Cache<EntryType>::copySharedEntryFile(const std::string& sharedFilePath) const
+{
+    // Named uniquely since several threads may fetch the same entry at once
+    const QString sharedFile = QString::fromUtf8( sharedFilePath.c_str() );
+    QString tmpFile = getCachePath();
+    StrUtils::ensureLastPathSeparator(tmpFile);
+    tmpFile += QFileInfo(sharedFile).fileName() + QString::fromUtf8(".tmp") + QUuid::createUuid().toString();
+    if ( !QFile::copy(sharedFile, tmpFile) ) {
+        qDebug() << "Failed to restore cache entry: cannot copy" << sharedFile;
+        QFile::remove(tmpFile);
+
+        return std::string();
+    }
+
+    return tmpFile.toStdString();
+}
+
+template<typename EntryType>
+typename Cache<EntryType>::EntryTypePtr
+Cache<EntryType>::restoreSharedEntry(const std::string& tmpFilePath,
+                                     const typename EntryType::key_type & key,
+                                     const ParamsTypePtr& params,
+                                     std::size_t size) const
+{
+    EntryType* value = NULL;
+    std::string localFilePath;
+
+    try {
+        value = new EntryType(key, params, this);
+
+        // Name the local file as allocate() does
+        std::string fileName = value->generateStringFromHash(getCachePath().toStdString() + '/', key.getHash());
+        if ( CacheAPI::fileExists(fileName) ) {
+            fileName.insert(fileName.size() - 4, "_0");
+        }
+        int index = 0;
+        while ( CacheAPI::fileExists(fileName) ) {
+            ++index;
+            std::stringstream ss;
+            ss << index;
+            fileName.replace( fileName.size() - 1, std::string::npos, ss.str() );
+        }
+        if ( !QFile::rename( QString::fromUtf8( tmpFilePath.c_str() ), QString::fromUtf8( fileName.c_str() ) ) ) {
+            throw std::runtime_error("Cannot rename " + tmpFilePath);
+        }
+        localFilePath = fileName;
+        ///This will not put the entry back into RAM, instead we just insert back the entry into the disk cache
+        value->restoreMetadataFromFile(size, localFilePath, 0);
+    } catch (const std::exception & e) {
+        qDebug() << "Failed to restore cache entry:" << e.what();
+        delete value;
+        QFile::remove( QString::fromUtf8( tmpFilePath.c_str() ) );
+        if ( !localFilePath.empty() ) {
+            QFile::remove( QString::fromUtf8( localFilePath.c_str() ) );
+        }
+
+        return EntryTypePtr();
+    }
+
+    return EntryTypePtr(value);
+}
+
+template<typename EntryType>
+bool
+Cache<EntryType>::isEntryCached(CacheShard& shard,
+                                const typename EntryType::key_type & key) const
+{
+    assert( !shard.lock.tryLock() );   // must be locked
+    for (int i = 0; i < 2; ++i) {
+        CacheContainer& container = (i == 0) ? shard.memoryCache : shard.diskCache;
+        CacheIterator found = container( key.getHash() );
+        if ( found == container.end() ) {
+            continue;
+        }
+        const std::list<EntryTypePtr> & cached = getValueFromIterator(found);
+        for (typename std::list<EntryTypePtr>::const_iterator it = cached.begin(); it != cached.end(); ++it) {
+            if ( (*it)->getKey() == key ) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+template<typename EntryType>
+bool
+Cache<EntryType>::writeSharedEntry(const EntryTypePtr& entry,
+                                   const QString& sharedCachePath) const
+{
+    if ( !entry->isStoredOnDisk() ) {
+        return false;
+    }
+    const std::string sharedFilePath = getSharedCacheEntryFilePath( sharedCachePath, entry->getHashKey() );
+    const QString sharedFile = QString::fromUtf8( sharedFilePath.c_str() );
+    const QString metaFile = sharedFile + QString::fromUtf8("." NATRON_SHARED_CACHE_META_EXT);
+
+    // Another computer may have written it already
+    if ( QFile::exists(metaFile) ) {
+        return true;
+    }
+    QDir().mkpath( QFileInfo(sharedFile).absolutePath() );
+
+    // Write to temporary files that are renamed once complete, so that readers never see a partial entry.
+    // They are named uniquely since several computers may write the same entry at once.
+    const QString tmpSuffix = QString::fromUtf8(".tmp") + QUuid::createUuid().toString();
+    const QString tmpFile = sharedFile + tmpSuffix;
+    const QString tmpMetaFile = metaFile + tmpSuffix;
+    if ( !QFile::copy(QString::fromUtf8( entry->getFilePath().c_str() ), tmpFile) ) {
+        QFile::remove(tmpFile);
+
+        return false;
+    }
+    try {
+        std::ofstream ofile(tmpMetaFile.toStdString().c_str(), std::ios::out | std::ios::binary);
+        if (!ofile) {
+            throw std::runtime_error("Cannot open " + tmpMetaFile.toStdString());
+        }
+        boost::archive::binary_oarchive oArchive(ofile, boost::archive::no_header);
+        unsigned int version = _version;
+        typename EntryType::key_type key = entry->getKey();
+        ParamsTypePtr params = entry->getParams();
+        std::size_t size = entry->dataSize();
+        oArchive << version;
+        oArchive << key;
+        oArchive << params;
+        oArchive << size;
+    } catch (const std::exception & e) {
+        qDebug() << "Failed to write cache entry:" << e.what();
+        QFile::remove(tmpFile);
+        QFile::remove(tmpMetaFile);
+
+        return false;
+    }
+
+    // The data goes first, the entry exists once its meta file is there
+    bool dataOk = QFile::rename(tmpFile, sharedFile);
+    if (!dataOk) {
+        // It may have been written by another computer in the meantime
+        QFile::remove(tmpFile);
+    }
+    if ( ( !dataOk && !QFile::exists(sharedFile) ) || !QFile::rename(tmpMetaFile, metaFile) ) {
+        QFile::remove(tmpMetaFile);
+
+        return QFile::exists(metaFile);
+    }
+
+    return true;
+} // writeSharedEntry
+
+template<typename EntryType>
+bool
+Cache<EntryType>::promoteFromSharedTier(CacheShard& shard,
+                                        const typename EntryType::key_type & key) const
+{
+    assert( !shard.getLock.tryLock() );   // must be locked
+    assert( !shard.lock.tryLock() );   // must be locked
+    const QString sharedCachePath = getSharedCachePath();
+    if ( sharedCachePath.isEmpty() ) {
+        return false;
+    }
+    const std::string sharedFilePath = getSharedCacheEntryFilePath( sharedCachePath, key.getHash() );
+    const std::string metaFilePath = sharedFilePath + "." NATRON_SHARED_CACHE_META_EXT;
+
+    // The shared tier is usually on network storage: do not hold the shard while reading it, so that the other
+    // look-ups and creations in this shard do not wait for the copy. The entry may be created, inserted or
+    // removed in the meantime.
+    shard.lock.unlock();
+    shard.getLock.unlock();
+    typename EntryType::key_type sharedKey;
+    ParamsTypePtr params;
+    std::size_t size = 0;
+    std::string tmpFilePath;
+    if ( CacheAPI::fileExists(metaFilePath) && readSharedEntryMetadata(metaFilePath, &sharedKey, &params, &size) &&
+         (sharedKey == key) ) {
+        tmpFilePath = copySharedEntryFile(sharedFilePath);
+    }
+    shard.getLock.lock();
+    shard.lock.lock();
+
+    if ( tmpFilePath.empty() ) {
+        // Not found, or a different entry with the same hash. It may have been created by another thread meanwhile.
+        return isEntryCached(shard, key);
+    }
+    if ( isEntryCached(shard, key) ) {
+        QFile::remove( QString::fromUtf8( tmpFilePath.c_str() ) );
+
+        return true;
+    }
+    EntryTypePtr entry = restoreSharedEntry(tmpFilePath, key, params, size);
+    if (!entry) {
+        return false;
+    }
+    sealEntry(shard, entry, false /*inMemory*/);
+
+    return true;
+}
+
+template<typename EntryType>
+void
+Cache<EntryType>::demoteToSharedTier(const EntryTypePtr& entry,
+                                     const QString& sharedCachePath) const
+{
+    writeSharedEntry(entry, sharedCachePath);
+}
+
+template<typename EntryType>
+int
+Cache<EntryType>::exportBundle(const std::string& bundlePath,
+                               const std::set<std::string>& holderIDs,
+                               double firstTime,
+                               double lastTime) const
+{
+    if (_isTiled) {
+        return 0;
+    }
+    QString bundleCachePath = QString::fromUtf8( bundlePath.c_str() );
+    StrUtils::ensureLastPathSeparator(bundleCachePath);
+    bundleCachePath.append( QString::fromUtf8( cacheName().c_str() ) );
+
+    std::list<EntryTypePtr> entries;
+    getCopy(&entries);
+
+    int nExported = 0;
+    for (typename std::list<EntryTypePtr>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        const typename EntryType::key_type& key = (*it)->getKey();
+        if ( ( holderIDs.find( key.getCacheHolderID() ) == holderIDs.end() ) ||
+             ( key.getTime() < firstTime ) || ( key.getTime() > lastTime ) || !(*it)->isStoredOnDisk() ) {
+            continue;
+        }
+        (*it)->syncBackingFile();
+        if ( writeSharedEntry(*it, bundleCachePath) ) {
+            ++nExported;
+        }
+    }
+
+    return nExported;
+}
+
+template<typename EntryType>
+int
+Cache<EntryType>::importBundle(const std::string& bundlePath)
+{
+    if (_isTiled) {
+        return 0;
+    }
+    QString bundleCachePath = QString::fromUtf8( bundlePath.c_str() );
+    StrUtils::ensureLastPathSeparator(bundleCachePath);
+    bundleCachePath.append( QString::fromUtf8( cacheName().c_str() ) );
+
+    const QString metaSuffix = QString::fromUtf8("." NATRON_SHARED_CACHE_META_EXT);
+    int nImported = 0;
+    QDirIterator dirIt(bundleCachePath, QStringList() << QString::fromUtf8("*.") + QString::fromUtf8(NATRON_SHARED_CACHE_META_EXT),
+                       QDir::Files, QDirIterator::Subdirectories);
+    while ( dirIt.hasNext() ) {
+        QString metaFile = dirIt.next();
+        const std::string metaFilePath = metaFile.toStdString();
+        const std::string sharedFilePath = metaFile.left(metaFile.size() - metaSuffix.size()).toStdString();
+
+        typename EntryType::key_type key;
+        ParamsTypePtr params;
+        std::size_t size = 0;
+        if ( !readSharedEntryMetadata(metaFilePath, &key, &params, &size) ) {
+            continue;
+        }
+
+        // The copy is done before locking the shard, the bundle may be on network storage
+        const std::string tmpFilePath = copySharedEntryFile(sharedFilePath);
+        if ( tmpFilePath.empty() ) {
+            continue;
+        }
+
+        CacheShard& shard = getShard( key.getHash() );
+        QMutexLocker getlocker(&shard.getLock);
+        QMutexLocker locker(&shard.lock);
+
+        // Do not replace an entry that is already cached
+        if ( isEntryCached(shard, key) ) {
+            QFile::remove( QString::fromUtf8( tmpFilePath.c_str() ) );
+            continue;
+        }
+        EntryTypePtr entry = restoreSharedEntry(tmpFilePath, key, params, size);
+        if (entry) {
+            sealEntry(shard, entry, false /*inMemory*/);
+            ++nImported;
+        }
+    }
+
+    return nImported;
+} // importBundle
+
 template<typename EntryType>
 struct Cache<EntryType>::SerializedEntry
 {
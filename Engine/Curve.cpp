@@ -32,8 +32,11 @@
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/math/special_functions/fpclassify.hpp>
+#include <boost/bind.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #endif
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+
 #include "Engine/AppManager.h"
 
 #include "Engine/CurvePrivate.h"
@@ -305,6 +308,7 @@ Curve::setPeriodic(bool periodic)
     QMutexLocker k(&_imp->_lock);
     _imp->isPeriodic = periodic;
     _imp->keyFrames.clear();
+    _imp->invalidateFlatKeyFrames();
 }
 
 bool
@@ -325,6 +329,7 @@ Curve::clearKeyFrames()
     QMutexLocker l(&_imp->_lock);
 
     _imp->keyFrames.clear();
+    _imp->invalidateFlatKeyFrames();
 }
 
 bool
@@ -343,6 +348,7 @@ Curve::clone(const Curve & other)
 
     _imp->keyFrames.clear();
     std::transform( otherKeys.begin(), otherKeys.end(), std::inserter( _imp->keyFrames, _imp->keyFrames.begin() ), KeyFrameCloner() );
+    _imp->invalidateFlatKeyFrames();
     onCurveChanged();
 }
 
@@ -369,6 +375,7 @@ Curve::cloneAndCheckIfChanged(const Curve& other)
     if (hasChanged) {
         _imp->keyFrames.clear();
         std::transform( otherKeys.begin(), otherKeys.end(), std::inserter( _imp->keyFrames, _imp->keyFrames.begin() ), KeyFrameCloner() );
+        _imp->invalidateFlatKeyFrames();
         onCurveChanged();
     }
 
@@ -398,6 +405,7 @@ Curve::clone(const Curve & other,
         }
         _imp->keyFrames.insert(k);
     }
+    _imp->invalidateFlatKeyFrames();
     onCurveChanged();
 }
 
@@ -442,6 +450,40 @@ Curve::addKeyFrame(KeyFrame key)
     return it.second;
 }
 
+bool
+Curve::addKeyFrames(const std::vector<KeyFrame>& keys)
+{
+    QMutexLocker l(&_imp->_lock);
+
+    // the default interpolation for bool, string, chaice, int is constant
+    bool constantInterp = ( (_imp->type == CurvePrivate::eCurveTypeBool) || (_imp->type == CurvePrivate::eCurveTypeString) ||
+                            ( _imp->type == CurvePrivate::eCurveTypeInt) ||
+                            ( _imp->type == CurvePrivate::eCurveTypeIntConstantInterp) );
+    bool ret = false;
+    std::vector<double> insertedTimes;
+    insertedTimes.reserve( keys.size() );
+    for (std::vector<KeyFrame>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        KeyFrame key = *it;
+        if (constantInterp) {
+            key.setInterpolation(eKeyframeTypeConstant);
+        }
+        std::pair<KeyFrameSet::iterator, bool> inserted = addKeyFrameNoUpdate(key);
+        ret |= inserted.second;
+        insertedTimes.push_back( inserted.first->getTime() );
+    }
+
+    // Refreshing the derivatives of a key also refreshes its neighbours and may invalidate iterators:
+    // look each key up again.
+    for (std::vector<double>::const_iterator it = insertedTimes.begin(); it != insertedTimes.end(); ++it) {
+        KeyFrameSet::iterator found = find(*it);
+        if ( found != _imp->keyFrames.end() ) {
+            found = evaluateCurveChanged(eCurveChangedReasonKeyframeChanged, found);
+        }
+    }
+
+    return ret;
+}
+
 std::pair<KeyFrameSet::iterator, bool> Curve::addKeyFrameNoUpdate(const KeyFrame & cp)
 {
     // PRIVATE - should not lock
@@ -455,6 +497,7 @@ std::pair<KeyFrameSet::iterator, bool> Curve::addKeyFrameNoUpdate(const KeyFrame
             assert(newKey.second);
             addedKey = false;
         }
+        _imp->invalidateFlatKeyFrames();
 
         return std::make_pair(newKey.first, addedKey);
     } else {
@@ -469,6 +512,7 @@ std::pair<KeyFrameSet::iterator, bool> Curve::addKeyFrameNoUpdate(const KeyFrame
         }
         std::pair<KeyFrameSet::iterator, bool> newKey = _imp->keyFrames.insert(cp);
         newKey.second = addedKey;
+        _imp->invalidateFlatKeyFrames();
 
         return newKey;
     }
@@ -534,6 +578,7 @@ Curve::removeKeyFrame(KeyFrameSet::const_iterator it)
     }
 
     _imp->keyFrames.erase(it);
+    _imp->invalidateFlatKeyFrames();
 
     if (mustRefreshPrev) {
         refreshDerivatives( eCurveChangedReasonDerivativesChanged, find( prevKey.getTime() ) );
@@ -583,6 +628,7 @@ Curve::removeKeyFramesBeforeTime(double time,
         newSet.insert(*it);
     }
     _imp->keyFrames = newSet;
+    _imp->invalidateFlatKeyFrames();
     if ( !_imp->keyFrames.empty() ) {
         refreshDerivatives( Curve::eCurveChangedReasonKeyframeChanged, _imp->keyFrames.begin() );
     }
@@ -604,6 +650,7 @@ Curve::removeKeyFramesAfterTime(double time,
         newSet.insert(*it);
     }
     _imp->keyFrames = newSet;
+    _imp->invalidateFlatKeyFrames();
     if ( !_imp->keyFrames.empty() ) {
         KeyFrameSet::iterator last = _imp->keyFrames.end();
         --last;
@@ -889,12 +936,202 @@ interParams(const KeyFrameSet &keyFrames,
     }
 }
 
+/// same as above, using the flat keyframe arrays and the index of the next keyframe
+static void
+interParamsFlat(CurvePrivate &imp,
+                double *t,
+                std::size_t up,
+                double *tcur,
+                double *vcur,
+                double *vcurDerivRight,
+                KeyframeTypeEnum *interp,
+                double *tnext,
+                double *vnext,
+                double *vnextDerivLeft,
+                KeyframeTypeEnum *interpNext)
+{
+    const std::size_t n = imp.flatTimes.size();
+
+    assert(n >= 1);
+    assert( up == n || *t < imp.flatTimes[up] );
+    double period = imp.xMax - imp.xMin;
+    if (imp.isPeriodic) {
+        // if the curve is periodic, bring back t in the curve keyframes range
+        double minKeyFrameX = imp.flatTimes[0] + imp.xMin;
+        assert(imp.xMin < imp.xMax);
+        if (*t < minKeyFrameX || *t > minKeyFrameX + period) {
+            *t = std::fmod(*t - minKeyFrameX, period ) + minKeyFrameX;
+            if (*t < minKeyFrameX) {
+                *t += period;
+            }
+            assert(*t >= minKeyFrameX && *t <= minKeyFrameX + period);
+        }
+        up = imp.flatUpperBound(*t);
+    }
+    if (up == 0) {
+        // We are in the case where all keys have a greater time
+        // If periodic, we are in between xMin and the first keyframe
+        *tnext = imp.flatTimes[0];
+        *vnext = imp.flatValues[0];
+        *vnextDerivLeft = imp.flatLeftDerivatives[0];
+        *interpNext = imp.flatInterpolations[0];
+        if (imp.isPeriodic) {
+            *tcur = imp.flatTimes[n - 1] - period;
+            *vcur = imp.flatValues[n - 1];
+            *vcurDerivRight = imp.flatRightDerivatives[n - 1];
+            *interp = imp.flatInterpolations[n - 1];
+        } else {
+            *tcur = *tnext - 1.;
+            *vcur = *vnext;
+            *vcurDerivRight = 0.;
+            *interp = eKeyframeTypeNone;
+        }
+    } else if (up == n) {
+        // We are in the case where no key has a greater time
+        // If periodic, we are in-between the last keyframe and xMax
+        *tcur = imp.flatTimes[n - 1];
+        *vcur = imp.flatValues[n - 1];
+        *vcurDerivRight = imp.flatRightDerivatives[n - 1];
+        *interp = imp.flatInterpolations[n - 1];
+        if (imp.isPeriodic) {
+            *tnext = imp.flatTimes[0] + period;
+            *vnext = imp.flatValues[0];
+            *vnextDerivLeft = imp.flatLeftDerivatives[0];
+            *interpNext = imp.flatInterpolations[0];
+        } else {
+            *tnext = *tcur + 1.;
+            *vnext = *vcur;
+            *vnextDerivLeft = 0.;
+            *interpNext = eKeyframeTypeNone;
+        }
+    } else {
+        // between two keyframes
+        assert(imp.flatTimes[up - 1] <= *t);
+        *tcur = imp.flatTimes[up - 1];
+        *vcur = imp.flatValues[up - 1];
+        *vcurDerivRight = imp.flatRightDerivatives[up - 1];
+        *interp = imp.flatInterpolations[up - 1];
+        *tnext = imp.flatTimes[up];
+        *vnext = imp.flatValues[up];
+        *vnextDerivLeft = imp.flatLeftDerivatives[up];
+        *interpNext = imp.flatInterpolations[up];
+    }
+} // interParamsFlat
+
+/// Integral of a non-periodic curve from time1 to time2 (negative if time2 < time1), both being in the segment before
+/// the flat keyframe 'up'. The curve is clamped to *clampRange if it is not NULL.
+static double
+integrateSegmentFlat(CurvePrivate &imp,
+                     std::size_t up,
+                     double time1,
+                     double time2,
+                     const Curve::YRange* clampRange)
+{
+    assert(!imp.isPeriodic);
+    if (time1 == time2) {
+        return 0.;
+    } else if (time2 < time1) {
+        return -integrateSegmentFlat(imp, up, time2, time1, clampRange);
+    }
+    double tcur, tnext;
+    double vcurDerivRight, vnextDerivLeft, vcur, vnext;
+    KeyframeTypeEnum interp, interpNext;
+    interParamsFlat(imp,
+                    &time1,
+                    up,
+                    &tcur,
+                    &vcur,
+                    &vcurDerivRight,
+                    &interp,
+                    &tnext,
+                    &vnext,
+                    &vnextDerivLeft,
+                    &interpNext);
+    if (clampRange) {
+        return Interpolation::integrate_clamp(tcur, vcur,
+                                              vcurDerivRight,
+                                              vnextDerivLeft,
+                                              tnext, vnext,
+                                              time1, time2,
+                                              clampRange->min, clampRange->max,
+                                              interp,
+                                              interpNext);
+    }
+
+    return Interpolation::integrate(tcur, vcur,
+                                    vcurDerivRight,
+                                    vnextDerivLeft,
+                                    tnext, vnext,
+                                    time1, time2,
+                                    interp,
+                                    interpNext);
+}
+
+/// Rebuilds imp.flatIntegrals if the keyframes or the clamping range changed. refreshFlatKeyFrames() must have been called.
+static void
+refreshFlatIntegrals(CurvePrivate &imp,
+                     const Curve::YRange* clampRange)
+{
+    assert(imp.flatKeyFramesValid);
+    bool clamped = clampRange != NULL;
+    double vmin = clamped ? clampRange->min : 0.;
+    double vmax = clamped ? clampRange->max : 0.;
+    if ( imp.flatIntegralsValid && (imp.flatIntegralsClamped == clamped) && (imp.flatIntegralsMin == vmin) && (imp.flatIntegralsMax == vmax) ) {
+        return;
+    }
+    std::size_t n = imp.flatTimes.size();
+    imp.flatIntegrals.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        imp.flatIntegrals[i] = (i == 0) ? 0. : imp.flatIntegrals[i - 1] + integrateSegmentFlat(imp, i, imp.flatTimes[i - 1], imp.flatTimes[i], clampRange);
+    }
+    imp.flatIntegralsClamped = clamped;
+    imp.flatIntegralsMin = vmin;
+    imp.flatIntegralsMax = vmax;
+    imp.flatIntegralsValid = true;
+}
+
+/// Integral of a non-periodic curve from its first keyframe to t. refreshFlatIntegrals() must have been called.
+static double
+integrateFromFirstKeyFrameFlat(CurvePrivate &imp,
+                               double t,
+                               const Curve::YRange* clampRange)
+{
+    assert(imp.flatIntegralsValid);
+    std::size_t up = imp.flatUpperBound(t);
+    if (up == 0) {
+        return integrateSegmentFlat(imp, 0, imp.flatTimes[0], t, clampRange);
+    }
+
+    return imp.flatIntegrals[up - 1] + integrateSegmentFlat(imp, up, imp.flatTimes[up - 1], t, clampRange);
+}
+
 double
 Curve::getValueAt(double t,
                   bool doClamp) const
 {
     QMutexLocker l(&_imp->_lock);
 
+    return getValueAtInternal(t, doClamp);
+}
+
+void
+Curve::getValuesAt(const double* times,
+                   double* values,
+                   int n,
+                   bool doClamp) const
+{
+    QMutexLocker l(&_imp->_lock);
+
+    for (int i = 0; i < n; ++i) {
+        values[i] = getValueAtInternal(times[i], doClamp);
+    }
+}
+
+double
+Curve::getValueAtInternal(double t,
+                          bool doClamp) const
+{
+    // PRIVATE - should not lock
     if ( _imp->keyFrames.empty() ) {
         //throw std::runtime_error("Curve has no control points!");
 
@@ -923,24 +1160,20 @@ Curve::getValueAt(double t,
         double tcur, tnext;
         double vcurDerivRight, vnextDerivLeft, vcur, vnext;
         KeyframeTypeEnum interp, interpNext;
-        KeyFrame k(t, 0.);
+        _imp->refreshFlatKeyFrames();
         // find the first keyframe with time greater than t
-        KeyFrameSet::const_iterator itup;
-        itup = _imp->keyFrames.upper_bound(k);
-        interParams(_imp->keyFrames,
-                    _imp->isPeriodic,
-                    _imp->xMin,
-                    _imp->xMax,
-                    &t,
-                    itup,
-                    &tcur,
-                    &vcur,
-                    &vcurDerivRight,
-                    &interp,
-                    &tnext,
-                    &vnext,
-                    &vnextDerivLeft,
-                    &interpNext);
+        std::size_t up = _imp->flatUpperBound(t);
+        interParamsFlat(*_imp,
+                        &t,
+                        up,
+                        &tcur,
+                        &vcur,
+                        &vcurDerivRight,
+                        &interp,
+                        &tnext,
+                        &vnext,
+                        &vnextDerivLeft,
+                        &interpNext);
 
         v = Interpolation::interpolate(tcur, vcur,
                                        vcurDerivRight,
@@ -973,7 +1206,7 @@ Curve::getValueAt(double t,
 
         return v;
     }
-} // getValueAt
+} // getValueAtInternal
 
 double
 Curve::getDerivativeAt(double t) const
@@ -993,24 +1226,20 @@ Curve::getDerivativeAt(double t) const
     double tcur, tnext;
     double vcurDerivRight, vnextDerivLeft, vcur, vnext;
     KeyframeTypeEnum interp, interpNext;
-    KeyFrame k(t, 0.);
+    _imp->refreshFlatKeyFrames();
     // find the first keyframe with time greater than t
-    KeyFrameSet::const_iterator itup;
-    itup = _imp->keyFrames.upper_bound(k);
-    interParams(_imp->keyFrames,
-                _imp->isPeriodic,
-                _imp->xMin,
-                _imp->xMax,
-                &t,
-                itup,
-                &tcur,
-                &vcur,
-                &vcurDerivRight,
-                &interp,
-                &tnext,
-                &vnext,
-                &vnextDerivLeft,
-                &interpNext);
+    std::size_t up = _imp->flatUpperBound(t);
+    interParamsFlat(*_imp,
+                    &t,
+                    up,
+                    &tcur,
+                    &vcur,
+                    &vcurDerivRight,
+                    &interp,
+                    &tnext,
+                    &vnext,
+                    &vnextDerivLeft,
+                    &interpNext);
 
     double d;
 
@@ -1055,6 +1284,27 @@ Curve::getIntegrateFromTo(double t1,
     }
     assert(_imp->type == CurvePrivate::eCurveTypeDouble); // only real-valued curves can be derived
 
+    if (!_imp->isPeriodic) {
+        // Use the integrals cached at each keyframe: only the partial segments around t1 and t2 have to be integrated.
+        Curve::YRange minmax = getCurveYRange();
+        const Curve::YRange* clampRange = mustClamp() ? &minmax : NULL;
+        _imp->refreshFlatKeyFrames();
+        refreshFlatIntegrals(*_imp, clampRange);
+        std::size_t up1 = _imp->flatUpperBound(t1);
+        std::size_t up2 = _imp->flatUpperBound(t2);
+        double sum;
+        if (up1 == up2) {
+            sum = integrateSegmentFlat(*_imp, up1, t1, t2, clampRange);
+        } else {
+            assert(up1 < up2);
+            sum = integrateSegmentFlat(*_imp, up1, t1, _imp->flatTimes[up1], clampRange);
+            sum += _imp->flatIntegrals[up2 - 1] - _imp->flatIntegrals[up1];
+            sum += integrateSegmentFlat(*_imp, up2, _imp->flatTimes[up2 - 1], t2, clampRange);
+        }
+
+        return opposite ? -sum : sum;
+    }
+
     // even when there is only one keyframe, there may be tangents!
     //if (_imp->keyFrames.size() == 1) {
     //    //if there's only 1 keyframe, don't bother interpolating
@@ -1150,6 +1400,85 @@ Curve::getIntegrateFromTo(double t1,
     return opposite ? -sum : sum;
 } // getIntegrateFromTo
 
+double
+Curve::getTimeAtIntegralFrom(double t1,
+                             double integral) const
+{
+    QMutexLocker l(&_imp->_lock);
+
+    if ( _imp->keyFrames.empty() ) {
+        throw std::runtime_error("Curve has no control points!");
+    }
+    if (_imp->isPeriodic) {
+        throw std::runtime_error("Curve::getTimeAtIntegralFrom: periodic curves are not supported");
+    }
+    assert(_imp->type == CurvePrivate::eCurveTypeDouble); // only real-valued curves can be integrated
+
+    Curve::YRange minmax = getCurveYRange();
+    const Curve::YRange* clampRange = mustClamp() ? &minmax : NULL;
+    _imp->refreshFlatKeyFrames();
+    refreshFlatIntegrals(*_imp, clampRange);
+
+    const std::vector<double>& times = _imp->flatTimes;
+    const std::vector<double>& integrals = _imp->flatIntegrals;
+    const std::size_t n = times.size();
+
+    // the integral from the first keyframe is increasing: find the segment containing the result by a binary search
+    // on the integrals cached at each keyframe
+    double target = integrateFromFirstKeyFrameFlat(*_imp, t1, clampRange) + integral;
+    std::size_t up = std::upper_bound(integrals.begin(), integrals.end(), target) - integrals.begin();
+    double tref = (up == 0) ? times[0] : times[up - 1];
+    double remainder = (up == 0) ? target : target - integrals[up - 1];
+
+    // bracket the result within the segment. Before the first and after the last keyframe the segment is unbounded.
+    double lo = tref, hi = tref;
+    if ( (up == 0) || (up == n) ) {
+        double step = (n > 1) ? (times[n - 1] - times[0]) / (n - 1) : 1.;
+        int iter = 0;
+        for (;; ) {
+            double t = (up == 0) ? tref - step : tref + step;
+            double f = integrateSegmentFlat(*_imp, up, tref, t, clampRange) - remainder;
+            if ( (up == 0) ? (f <= 0.) : (f >= 0.) ) {
+                lo = (up == 0) ? t : tref;
+                hi = (up == 0) ? tref : t;
+                break;
+            }
+            if (++iter >= 64) {
+                throw std::runtime_error("Curve::getTimeAtIntegralFrom: the curve integral never reaches the given value");
+            }
+            step *= 2.;
+        }
+    } else {
+        lo = tref;
+        hi = times[up];
+    }
+
+    // Newton iterations (the derivative of the integral is the curve itself), falling back to a bisection whenever
+    // the step leaves the bracket
+    double t = (lo + hi) / 2.;
+    for (int iter = 0; iter < 100; ++iter) {
+        double f = integrateSegmentFlat(*_imp, up, tref, t, clampRange) - remainder;
+        if (f == 0.) {
+            break;
+        } else if (f > 0.) {
+            hi = t;
+        } else {
+            lo = t;
+        }
+        double v = getValueAtInternal(t, clampRange != NULL);
+        double next = (v > 0.) ? t - f / v : lo;
+        if ( (next <= lo) || (next >= hi) ) {
+            next = (lo + hi) / 2.;
+        }
+        if ( (next == t) || (hi - lo <= std::numeric_limits<double>::epsilon() * std::max( 1., std::abs(t) )) ) {
+            break;
+        }
+        t = next;
+    }
+
+    return t;
+} // getTimeAtIntegralFrom
+
 Curve::YRange
 Curve::getCurveDisplayYRange() const
 {
@@ -1270,6 +1599,14 @@ Curve::getKeyFramesCount() const
     return (int)_imp->keyFrames.size();
 }
 
+U64
+Curve::getKeyFramesAge() const
+{
+    QMutexLocker l(&_imp->_lock);
+
+    return _imp->keyFramesAge;
+}
+
 KeyFrameSet
 Curve::getKeyFrames_mt_safe() const
 {
@@ -1290,6 +1627,7 @@ Curve::setKeyFrameValueAndTimeNoUpdate(double value,
     newKey.setTime(time);
     newKey.setValue(value);
     _imp->keyFrames.erase(k);
+    _imp->invalidateFlatKeyFrames();
 
     return addKeyFrameNoUpdate(newKey).first;
 }
@@ -1660,6 +1998,7 @@ Curve::refreshDerivatives(Curve::CurveChangedReasonEnum reason,
         newKeyIt = _imp->keyFrames.insert(newKey);
         assert(newKeyIt.second);
     }
+    _imp->invalidateFlatKeyFrames();
     key = newKeyIt.first;
 
     if (reason != eCurveChangedReasonDerivativesChanged) {
@@ -1844,6 +2183,7 @@ Curve::setKeyframesInternal(const KeyFrameSet& keys, bool refreshDerivatives)
 {
     if (!refreshDerivatives) {
         _imp->keyFrames = keys;
+        _imp->invalidateFlatKeyFrames();
     } else {
         _imp->keyFrames.clear();
 
@@ -1918,4 +2258,28 @@ Curve::smooth(const RangeD* range)
     }
 }
 
+static void
+smoothCurveFunctor(const RangeD* range,
+                   const CurvePtr& curve)
+{
+    curve->smooth(range);
+}
+
+void
+Curve::smoothCurves(const std::vector<CurvePtr>& curves,
+                    const RangeD* range)
+{
+    if ( curves.empty() ) {
+        return;
+    }
+    if (curves.size() == 1) {
+        curves.front()->smooth(range);
+
+        return;
+    }
+    // Each curve is locked independently by smooth(), so they can all be smoothed at once
+    std::vector<CurvePtr> toSmooth(curves);
+    QtConcurrent::blockingMap( toSmooth, boost::bind(&smoothCurveFunctor, range, _1) );
+}
+
 NATRON_NAMESPACE_EXIT
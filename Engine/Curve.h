@@ -215,6 +215,10 @@ public:
     ///existing key at this time.
     bool addKeyFrame(KeyFrame key);
 
+    ///same as addKeyFrame but for several keyframes at once: the curve is locked once and the derivatives
+    ///are refreshed after all keys are inserted. Returns true if at least one keyframe was added.
+    bool addKeyFrames(const std::vector<KeyFrame>& keys);
+
     void removeKeyFrameWithTime(double time);
 
     void removeKeyFrameWithIndex(int index);
@@ -246,6 +250,12 @@ public:
 
     int getKeyFramesCount() const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Returns a number that changes every time the keyframes of the curve change.
+     * Comparing it with a previously returned value tells whether the keyframes changed in between.
+     **/
+    U64 getKeyFramesAge() const WARN_UNUSED_RETURN;
+
     double getMinimumTimeCovered() const WARN_UNUSED_RETURN;
 
     double getMaximumTimeCovered() const WARN_UNUSED_RETURN;
@@ -256,10 +266,23 @@ public:
      */
     double getValueAt(double t, bool clamp = true) const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Same as getValueAt() for n times at once, under a single lock. When the times are increasing
+     * (drawing, sampling a frame range) keyframe segments are walked sequentially instead of searched.
+     **/
+    void getValuesAt(const double* times, double* values, int n, bool clamp = true) const;
+
     double getDerivativeAt(double t) const WARN_UNUSED_RETURN;
 
     double getIntegrateFromTo(double t1, double t2) const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Returns the time t2 such that getIntegrateFromTo(t1, t2) == integral, e.g. the source time reached after
+     * integrating a speed curve. The curve must be positive, so that its integral is increasing. Throws if the curve
+     * is periodic or if its integral never reaches the given value.
+     **/
+    double getTimeAtIntegralFrom(double t1, double integral) const WARN_UNUSED_RETURN;
+
     KeyFrameSet getKeyFrames_mt_safe() const WARN_UNUSED_RETURN;
 
     void clearKeyFrames();
@@ -355,6 +378,12 @@ public:
      **/
     void smooth(const RangeD* range);
 
+    /**
+     * @brief Same as smooth() for each of the given curves. The curves are smoothed concurrently
+     * in the global thread pool and this function returns once they are all done.
+     **/
+    static void smoothCurves(const std::vector<CurvePtr>& curves, const RangeD* range);
+
     void setKeyframes(const KeyFrameSet& keys, bool refreshDerivatives);
 
 private:
@@ -392,6 +421,8 @@ private:
 
     bool mustClamp() const;
 
+    double getValueAtInternal(double t, bool doClamp) const;
+
     KeyFrameSet::iterator setKeyframeInterpolation_internal(KeyFrameSet::iterator it, KeyframeTypeEnum type);
 
     /**
@@ -32,6 +32,10 @@
 #include <boost/shared_ptr.hpp>
 #endif
 
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
 #include <QtCore/QMutex>
 
 #include "Engine/Variant.h"
@@ -58,6 +62,32 @@ struct CurvePrivate
 
     KeyFrameSet keyFrames;
 
+    /*
+     * A sorted copy of keyFrames laid out as contiguous arrays (one per keyframe field), used to evaluate the curve
+     * without walking the set. It is rebuilt lazily after any change to keyFrames and is protected by _lock.
+     */
+    std::vector<double> flatTimes;
+    std::vector<double> flatValues;
+    std::vector<double> flatLeftDerivatives;
+    std::vector<double> flatRightDerivatives;
+    std::vector<KeyframeTypeEnum> flatInterpolations;
+    bool flatKeyFramesValid;
+
+    // flatIntegrals[i] is the integral of the curve from the first keyframe to keyframe i, so that an integral over
+    // any range only needs the partial segments at both ends. It depends on the clamping range, which is not owned by
+    // the curve (the knob minimum/maximum): the range it was computed with is kept to detect changes.
+    std::vector<double> flatIntegrals;
+    bool flatIntegralsValid;
+    bool flatIntegralsClamped;
+    double flatIntegralsMin, flatIntegralsMax;
+
+    // The index of the first keyframe with a time greater than the last evaluated time: during playback consecutive
+    // evaluations fall in the same or in the next segment and do not need a binary search.
+    std::size_t lastUpperBoundHint;
+
+    // Incremented on every change to keyFrames, so that a copy of the curve can tell whether it is still up to date
+    U64 keyFramesAge;
+
 #ifdef NATRON_CURVE_USE_CACHE
     std::map<double, double> resultCache; //< a cache for interpolations
 #endif
@@ -73,6 +103,19 @@ struct CurvePrivate
 
     CurvePrivate()
         : keyFrames()
+        , flatTimes()
+        , flatValues()
+        , flatLeftDerivatives()
+        , flatRightDerivatives()
+        , flatInterpolations()
+        , flatKeyFramesValid(false)
+        , flatIntegrals()
+        , flatIntegralsValid(false)
+        , flatIntegralsClamped(false)
+        , flatIntegralsMin(0.)
+        , flatIntegralsMax(0.)
+        , lastUpperBoundHint(0)
+        , keyFramesAge(0)
 #ifdef NATRON_CURVE_USE_CACHE
         , resultCache()
 #endif
@@ -90,7 +133,8 @@ struct CurvePrivate
     }
 
     CurvePrivate(const CurvePrivate & other)
-        : _lock(QMutex::Recursive)
+        : keyFramesAge(0)
+        , _lock(QMutex::Recursive)
     {
         *this = other;
     }
@@ -107,9 +151,60 @@ struct CurvePrivate
         yMin = other.yMin;
         yMax = other.yMax;
         isPeriodic = other.isPeriodic;
+        invalidateFlatKeyFrames();
+    }
+
+    /// Must be called, under _lock, after every change to keyFrames
+    void invalidateFlatKeyFrames()
+    {
+        flatKeyFramesValid = false;
+        flatIntegralsValid = false;
+        ++keyFramesAge;
     }
 
-    
+    void refreshFlatKeyFrames()
+    {
+        if (flatKeyFramesValid) {
+            return;
+        }
+        std::size_t n = keyFrames.size();
+        flatTimes.resize(n);
+        flatValues.resize(n);
+        flatLeftDerivatives.resize(n);
+        flatRightDerivatives.resize(n);
+        flatInterpolations.resize(n);
+        std::size_t i = 0;
+        for (KeyFrameSet::const_iterator it = keyFrames.begin(); it != keyFrames.end(); ++it, ++i) {
+            flatTimes[i] = it->getTime();
+            flatValues[i] = it->getValue();
+            flatLeftDerivatives[i] = it->getLeftDerivative();
+            flatRightDerivatives[i] = it->getRightDerivative();
+            flatInterpolations[i] = it->getInterpolation();
+        }
+        lastUpperBoundHint = 0;
+        flatKeyFramesValid = true;
+    }
+
+    /// Returns the index of the first keyframe with a time greater than t (flatTimes.size() if none), i.e the
+    /// equivalent of keyFrames.upper_bound(). refreshFlatKeyFrames() must have been called.
+    std::size_t flatUpperBound(double t)
+    {
+        assert(flatKeyFramesValid);
+        std::size_t n = flatTimes.size();
+        std::size_t hint = lastUpperBoundHint;
+        // try the last segment and the one following it
+        for (int i = 0; i < 2 && hint <= n; ++i, ++hint) {
+            if ( ( (hint == 0) || (flatTimes[hint - 1] <= t) ) && ( (hint == n) || (t < flatTimes[hint]) ) ) {
+                lastUpperBoundHint = hint;
+
+                return hint;
+            }
+        }
+        hint = std::upper_bound(flatTimes.begin(), flatTimes.end(), t) - flatTimes.begin();
+        lastUpperBoundHint = hint;
+
+        return hint;
+    }
 };
 
 NATRON_NAMESPACE_EXIT
@@ -68,6 +68,7 @@ Curve::serialize(Archive & ar,
 {
     QMutexLocker l(&_imp->_lock);
     ar & ::boost::serialization::make_nvp("KeyFrameSet", _imp->keyFrames);
+    _imp->invalidateFlatKeyFrames();
 }
 
 NATRON_NAMESPACE_EXIT
@@ -80,5 +80,13 @@ const char* copyUnprocessedChannels_FragmentShader =
     "       gl_FragColor.a = dstColor.a;\n"
     "#endif\n"
     "}";
+// The vertex alpha is 1 inside the shape and on the inner edge of the feather, 0 on its outer edge
+const char* rotoShape_FragmentShader =
+    "uniform float fallOff;\n"
+    "\n"
+    "void main() {\n"
+    "   float alpha = pow(gl_Color.a, fallOff);\n"
+    "   gl_FragColor = vec4(alpha, alpha, alpha, alpha);\n"
+    "}";
 
 NATRON_NAMESPACE_EXIT
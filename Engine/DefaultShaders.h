@@ -34,6 +34,7 @@ NATRON_NAMESPACE_ENTER
 extern const char* fillConstant_FragmentShader;
 extern const char* applyMaskMix_FragmentShader;
 extern const char* copyUnprocessedChannels_FragmentShader;
+extern const char* rotoShape_FragmentShader;
 
 NATRON_NAMESPACE_EXIT
 
@@ -27,6 +27,8 @@
 #include "EffectInstancePrivate.h"
 
 #include <map>
+#include <set>
+#include <vector>
 #include <sstream> // stringstream
 #include <algorithm> // min, max
 #include <fstream>
@@ -59,6 +61,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/DiskCacheNode.h"
 #include "Engine/Image.h"
 #include "Engine/ImageParams.h"
+#include "Engine/ImageResampler.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/Log.h"
@@ -73,6 +76,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/PluginMemory.h"
 #include "Engine/Project.h"
 #include "Engine/RenderStats.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/ReadNode.h"
@@ -85,6 +89,9 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 //#define NATRON_ALWAYS_ALLOCATE_FULL_IMAGE_BOUNDS
 
+///Number of tiles along each axis of the RoD used to map a dirty region of an input to the output, see getOutputDirtyRegion()
+#define NATRON_OUTPUT_DIRTY_REGION_TILES 8
+
 
 NATRON_NAMESPACE_ENTER
 
@@ -275,6 +282,53 @@ EffectInstance::setNodeRequestThreadLocal(const NodeFrameRequestPtr & nodeReques
     argsList.back()->request = nodeRequest;
 }
 
+/**
+ * @brief Takes the values at time/view of the numeric knobs without expression, which the render threads then read without locking
+ **/
+static KnobsValuesSnapshotConstPtr
+takeKnobsValuesSnapshot(const KnobsVec& knobs,
+                        double time,
+                        ViewIdx view)
+{
+    boost::shared_ptr<KnobsValuesSnapshot> ret = boost::make_shared<KnobsValuesSnapshot>();
+
+    ret->time = time;
+    ret->view = view;
+    for (KnobsVec::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+        KnobI* knob = it->get();
+        KnobDoubleBase* isDouble = dynamic_cast<KnobDoubleBase*>(knob);
+        KnobIntBase* isInt = isDouble ? 0 : dynamic_cast<KnobIntBase*>(knob);
+        KnobBoolBase* isBool = (isDouble || isInt) ? 0 : dynamic_cast<KnobBoolBase*>(knob);
+        if (!isDouble && !isInt && !isBool) {
+            continue;
+        }
+        int nDims = knob->getDimension();
+        bool hasExpression = false;
+        for (int i = 0; i < nDims; ++i) {
+            if ( !knob->getExpression(i).empty() ) {
+                hasExpression = true;
+                break;
+            }
+        }
+        if (hasExpression) {
+            continue;
+        }
+        std::vector<double>& values = ret->values[knob];
+        values.resize(nDims);
+        for (int i = 0; i < nDims; ++i) {
+            if (isDouble) {
+                values[i] = isDouble->getValueAtTime(time, i, view);
+            } else if (isInt) {
+                values[i] = isInt->getValueAtTime(time, i, view);
+            } else {
+                values[i] = isBool->getValueAtTime(time, i, view);
+            }
+        }
+    }
+
+    return ret;
+}
+
 void
 EffectInstance::setParallelRenderArgsTLS(double time,
                                          ViewIdx view,
@@ -327,6 +381,11 @@ EffectInstance::setParallelRenderArgsTLS(double time,
     args->tilesSupported = getNode()->getCurrentSupportTiles();
     args->stats = stats;
     args->openGLContext = glContext;
+    // Analysis and paint strokes change the parameters while rendering. The main-thread reads the GUI values instead
+    // of the values used by the render threads.
+    if ( !isAnalysis && !isDuringPaintStrokeCreation && rotoPaintNodes.empty() && ( QThread::currentThread() != qApp->thread() ) ) {
+        args->knobsValues = takeKnobsValuesSnapshot(getKnobs_mt_safe(), time, view);
+    }
     argsList.push_back(args);
 }
 
@@ -392,6 +451,41 @@ EffectInstance::getParallelRenderArgsTLS() const
     return tls->frameArgs.back();
 }
 
+EffectInstance::ViewInvarianceLevel
+EffectInstance::getCurrentRenderViewInvariance() const
+{
+    ParallelRenderArgsPtr frameArgs = getParallelRenderArgsTLS();
+
+    if (frameArgs && frameArgs->viewInvariant) {
+        return eViewInvarianceAllViewsInvariant;
+    }
+
+    return isViewInvariant();
+}
+
+bool
+EffectInstance::restrictProcessChannelsForCurrentRender(std::bitset<4>* processChannels,
+                                                        bool renderActionOnly) const
+{
+    EffectTLSDataPtr tls = _imp->tlsData->getTLSData();
+
+    if ( !tls || tls->frameArgs.empty() || (renderActionOnly && !tls->currentRenderArgs.validArgs) ) {
+        return false;
+    }
+    const ParallelRenderArgsPtr& frameArgs = tls->frameArgs.back();
+    if ( frameArgs->requestedChannels.all() || !getNode()->isPluginUsingHostChannelSelectors() ) {
+        return false;
+    }
+    std::bitset<4> restricted = *processChannels & frameArgs->requestedChannels;
+    // If none of the requested channels is processed, the render is a copy anyway: leave it as is
+    if ( restricted.none() || (restricted == *processChannels) ) {
+        return false;
+    }
+    *processChannels = restricted;
+
+    return true;
+}
+
 U64
 EffectInstance::getHash() const
 {
@@ -489,29 +583,38 @@ EffectInstance::aborted() const
        threads spawned from the thread pool may not.
      **/
     bool isRenderUserInteraction;
+
+    if (isAbortableThread) {
+        // Fast path: the thread holds a copy of the abort info of its render
+        const AbortableRenderInfoPtr* threadAbortInfo;
+        const EffectInstancePtr* threadTreeRoot;
+        if ( isAbortableThread->getAbortInfoForCurrentThread(&isRenderUserInteraction, &threadAbortInfo, &threadTreeRoot) ) {
+            return Implementation::aborted(isRenderUserInteraction,
+                                           *threadAbortInfo,
+                                           *threadTreeRoot);
+        }
+    }
+
     AbortableRenderInfoPtr abortInfo;
     EffectInstancePtr treeRoot;
 
+    // If this thread is not abortable or we did not set the abort info for this render yet, retrieve them from the TLS of this node.
+    EffectTLSDataPtr tls = _imp->tlsData->getTLSData();
+    if (!tls) {
+        return false;
+    }
+    if ( tls->frameArgs.empty() ) {
+        return false;
+    }
+    const ParallelRenderArgsPtr & args = tls->frameArgs.back();
+    isRenderUserInteraction = args->isRenderResponseToUserInteraction;
+    abortInfo = args->abortInfo.lock();
+    if (args->treeRoot) {
+        treeRoot = args->treeRoot->getEffectInstance();
+    }
 
-    if ( !isAbortableThread || !isAbortableThread->getAbortInfo(&isRenderUserInteraction, &abortInfo, &treeRoot) ) {
-        // If this thread is not abortable or we did not set the abort info for this render yet, retrieve them from the TLS of this node.
-        EffectTLSDataPtr tls = _imp->tlsData->getTLSData();
-        if (!tls) {
-            return false;
-        }
-        if ( tls->frameArgs.empty() ) {
-            return false;
-        }
-        const ParallelRenderArgsPtr & args = tls->frameArgs.back();
-        isRenderUserInteraction = args->isRenderResponseToUserInteraction;
-        abortInfo = args->abortInfo.lock();
-        if (args->treeRoot) {
-            treeRoot = args->treeRoot->getEffectInstance();
-        }
-
-        if (isAbortableThread) {
-            isAbortableThread->setAbortInfo(isRenderUserInteraction, abortInfo, treeRoot);
-        }
+    if (isAbortableThread) {
+        isAbortableThread->setAbortInfo(isRenderUserInteraction, abortInfo, treeRoot);
     }
 
     // The internal function that given a AbortableRenderInfoPtr determines if a render was aborted or not
@@ -595,6 +698,48 @@ EffectInstance::getInputHint(int /*inputNb*/) const
     return std::string();
 }
 
+EffectInstancePtr
+EffectInstance::resolvePassThroughInput(const EffectInstancePtr& effect,
+                                        double* time,
+                                        ViewIdx* view)
+{
+    EffectInstancePtr ret = effect;
+
+    // The request pass visited the whole tree for this frame: use its identity results as a compiled graph
+    // in which the pass-through nodes are direct edges, instead of entering renderRoI on each of them.
+    while (ret) {
+        ParallelRenderArgsPtr frameArgs = ret->getParallelRenderArgsTLS();
+        if (!frameArgs || !frameArgs->request) {
+            break;
+        }
+        const FrameViewRequest* request = frameArgs->request->getFrameViewRequest(*time, *view);
+        if ( !request || !request->globalData.isIdentity || (request->globalData.identityInputNb < 0) ) {
+            break;
+        }
+        if ( (*view != 0) && (ret->getCurrentRenderViewInvariance() == eViewInvarianceAllViewsInvariant) ) {
+            // renderRoI redirects to the main view in that case
+            break;
+        }
+        int inputNb = request->globalData.identityInputNb;
+        if ( ret->getNode()->getChannelSelectorKnob(inputNb) ) {
+            // The planes requested upstream depend on the user selection and must be converted by renderRoI
+            break;
+        }
+        EffectInstancePtr input = ret->getInput(inputNb);
+        if ( !input || (input == effect) ) {
+            break;
+        }
+        if ( frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
+            frameArgs->stats->setNodeIdentity( ret->getNode(), input->getNode() );
+        }
+        *time = request->globalData.inputIdentityTime;
+        *view = request->globalData.identityView;
+        ret = input;
+    }
+
+    return ret;
+}
+
 bool
 EffectInstance::retrieveGetImageDataUponFailure(const double time,
                                                 const ViewIdx view,
@@ -856,10 +1001,10 @@ EffectInstance::getImage(int inputNb,
     } else {
         assert( tls->currentRenderArgs.validArgs || !tls->frameArgs.empty() );
 
+        const FrameViewRequest* request = 0;
         if (inputEffect) {
             //When analysing we do not compute a request pass so we do not enter this condition
             ParallelRenderArgsPtr inputFrameArgs = inputEffect->getParallelRenderArgsTLS();
-            const FrameViewRequest* request = 0;
             if (inputFrameArgs && inputFrameArgs->request) {
                 request = inputFrameArgs->request->getFrameViewRequest(time, view);
             }
@@ -892,6 +1037,20 @@ EffectInstance::getImage(int inputNb,
             identityInput = renderArgs.identityInput;
             inputImagesThreadLocal = renderArgs.inputImages;
             thisRod = renderArgs.rod;
+
+            if ( request && (request->finalData.finalRoiRegion.getRectsCount() > 1) ) {
+                // The input was requested on disjoint windows: only render the ones this effect needs
+                // instead of the bounding box of all of them
+                RoIMap::const_iterator foundRoI = renderArgs.regionOfInterestResults.find(inputEffect);
+                if ( foundRoI != renderArgs.regionOfInterestResults.end() ) {
+                    RegionD neededRegion = request->finalData.finalRoiRegion;
+                    neededRegion.intersect(foundRoI->second);
+                    RectD neededRoI = neededRegion.getBoundingBox();
+                    if ( !neededRoI.isNull() ) {
+                        roi = neededRoI;
+                    }
+                }
+            }
         }
     }
 
@@ -1022,8 +1181,10 @@ EffectInstance::getImage(int inputNb,
                     }
                 }
 
+                // When this effect renders with OpenGL its context is current: rasterize the shapes on the GPU as well
                 inputImg = attachedStroke->renderMaskFromStroke(components,
-                                                                time, view, depth, mipMapLevel, rotoSrcRod);
+                                                                time, view, depth, mipMapLevel, rotoSrcRod,
+                                                                returnStorage == eStorageModeGLTex ? glContext : OSGLContextPtr());
 
                 if ( roto->isDoingNeatRender() ) {
                     getApp()->updateStrokeImage(inputImg, 0, false);
@@ -1065,23 +1226,28 @@ EffectInstance::getImage(int inputNb,
     /// The node is connected.
     assert(inputEffect);
 
+    // Skip the pass-through nodes between this effect and the one actually rendering the image
+    double renderTime = time;
+    ViewIdx renderView = view;
+    EffectInstancePtr renderEffect = resolvePassThroughInput(inputEffect, &renderTime, &renderView);
+
     std::list<ImagePlaneDesc> requestedComps;
     requestedComps.push_back(isMask ? maskComps : components);
     std::map<ImagePlaneDesc, ImagePtr> inputImages;
-    RenderRoIRetCode retCode = inputEffect->renderRoI(RenderRoIArgs(time,
-                                                                    scale,
-                                                                    renderMappedMipMapLevel,
-                                                                    view,
-                                                                    byPassCache,
-                                                                    pixelRoI,
-                                                                    RectD(),
-                                                                    requestedComps,
-                                                                    depth,
-                                                                    true,
-                                                                    this,
-                                                                    returnStorage,
-                                                                    thisEffectRenderTime,
-                                                                    inputImagesThreadLocal), &inputImages);
+    RenderRoIRetCode retCode = renderEffect->renderRoI(RenderRoIArgs(renderTime,
+                                                                     scale,
+                                                                     renderMappedMipMapLevel,
+                                                                     renderView,
+                                                                     byPassCache,
+                                                                     pixelRoI,
+                                                                     RectD(),
+                                                                     requestedComps,
+                                                                     depth,
+                                                                     true,
+                                                                     this,
+                                                                     returnStorage,
+                                                                     thisEffectRenderTime,
+                                                                     inputImagesThreadLocal), &inputImages);
 
     if ( inputImages.empty() || (retCode != eRenderRoIRetCodeOk) ) {
         return ImagePtr();
@@ -1516,10 +1682,58 @@ getOrCreateFromCacheInternal(const ImageKey & key,
     }
 }
 
+/**
+ * @brief A downscaled image is cached next to the higher resolution image it was made from, under the same key,
+ * so that zooming out again does not downscale it again. The higher resolution image may have been rendered further
+ * since: downscale the portions of the roi it has and the downscaled image lacks, instead of rendering them again.
+ * Returns true if something was downscaled.
+ **/
+static bool
+completeDownscaledImage(const Image& higherResImage,
+                        const RectI& roi,
+                        Image* image)
+{
+    if ( !image->usesBitMap() || !higherResImage.usesBitMap() || (higherResImage.getStorageMode() != eStorageModeRAM) ||
+         ( image->getStorageMode() != eStorageModeRAM) || ( higherResImage.getBitDepth() != image->getBitDepth() ) ||
+         ( higherResImage.getComponents() != image->getComponents() ) ) {
+        return false;
+    }
+    std::list<RectI> restToRender;
+    bool isBeingRenderedElsewhere = false;
+    image->getRestToRender_trimap(roi, restToRender, &isBeingRenderedElsewhere);
+    if ( restToRender.empty() || isBeingRenderedElsewhere ) {
+        return false;
+    }
+
+    const unsigned int downscaleLevels = image->getMipMapLevel() - higherResImage.getMipMapLevel();
+    const RectI & srcBounds = higherResImage.getBounds();
+    bool hasDownscaled = false;
+    for (std::list<RectI>::const_iterator it = restToRender.begin(); it != restToRender.end(); ++it) {
+        RectI dstRect;
+        if ( !it->intersect(image->getBounds(), &dstRect) ) {
+            continue;
+        }
+        RectI srcRect = dstRect.upscalePowerOfTwo(downscaleLevels);
+        if ( !srcRect.intersect(srcBounds, &srcRect) ) {
+            continue;
+        }
+        std::list<RectI> srcRestToRender;
+        higherResImage.getRestToRender(srcRect, srcRestToRender);
+        if ( !srcRestToRender.empty() ) {
+            continue;
+        }
+        higherResImage.downscaleMipMap(image->getRoD(), srcRect, higherResImage.getMipMapLevel(), image->getMipMapLevel(), true, image);
+        hasDownscaled = true;
+    }
+
+    return hasDownscaled;
+}
+
 ImagePtr
 EffectInstance::convertOpenGLTextureToCachedRAMImage(const ImagePtr& image)
 {
     assert(image->getStorageMode() == eStorageModeGLTex);
+    RenderTraceScope traceScope("gpu", "downloadTexture", this);
 
     ImageParamsPtr params = boost::make_shared<ImageParams>( *image->getParams() );
     CacheEntryStorageInfo& info = params->getStorageInfo();
@@ -1547,6 +1761,7 @@ ImagePtr
 EffectInstance::convertRAMImageToOpenGLTexture(const ImagePtr& image)
 {
     assert(image->getStorageMode() != eStorageModeGLTex);
+    RenderTraceScope traceScope("gpu", "uploadTexture", this);
 
     ImageParamsPtr params = boost::make_shared<ImageParams>( *image->getParams() );
     CacheEntryStorageInfo& info = params->getStorageInfo();
@@ -1621,6 +1836,25 @@ EffectInstance::convertRAMImageToOpenGLTexture(const ImagePtr& image)
     return gpuImage;
 } // convertRAMImageToOpenGLTexture
 
+/**
+ * @brief Keeps the texture uploaded from a cached RAM image on the GPU, unless parts of the RAM image
+ * are not rendered yet: the texture would then hold undefined pixels out of the RoI it was uploaded for.
+ **/
+static void
+insertUploadedTextureInGLCache(const OSGLContextPtr& context,
+                               const ImagePtr& ramImage,
+                               const ImagePtr& texture)
+{
+    if (!texture) {
+        return;
+    }
+    std::list<RectI> restToRender;
+    ramImage->getRestToRender(ramImage->getBounds(), restToRender);
+    if ( restToRender.empty() ) {
+        context->insertCachedTexture(texture);
+    }
+}
+
 void
 EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
                                                     StorageModeEnum storage,
@@ -1637,9 +1871,23 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
                                                     const OSGLContextAttacherPtr& glContextAttacher,
                                                     ImagePtr* image)
 {
+    RenderTraceScope traceScope("cache", "getImageFromCache", this);
     ImageList cachedImages;
     bool isCached = false;
 
+    // Textures still on the GPU of the attached context do not need to go through RAM
+    if ( (storage == eStorageModeGLTex) && (returnStorage == eStorageModeGLTex) && glContextAttacher ) {
+        ImagePtr texture = glContextAttacher->getContext()->getCachedTexture(key, mipMapLevel, roi, bitdepth, components);
+        if (texture) {
+            if ( stats && stats->isInDepthProfilingEnabled() ) {
+                stats->addCacheInfosForNode(getNode(), false, false);
+            }
+            *image = texture;
+
+            return;
+        }
+    }
+
     ///Find first something in the input images list
     if ( !inputImages.empty() ) {
         for (InputImagesMap::const_iterator it = inputImages.begin(); it != inputImages.end(); ++it) {
@@ -1703,10 +1951,10 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
             bool convertible = (imgComps.isColorPlane() && components.isColorPlane()) || (imgComps == components);
             if ( (imgMMlevel == mipMapLevel) && convertible &&
                  ( getSizeOfForBitDepth(imgDepth) >= getSizeOfForBitDepth(bitdepth) ) /* && imgComps == components && imgDepth == bitdepth*/ ) {
-                ///We found  a matching image
-
-                *image = *it;
-                break;
+                ///We found  a matching image, keep looking for a higher resolution one it may be completed from
+                if (!*image) {
+                    *image = *it;
+                }
             } else {
                 if ( (*it)->getStorageMode() != eStorageModeRAM || (imgMMlevel >= mipMapLevel) || !convertible ||
                      ( getSizeOfForBitDepth(imgDepth) < getSizeOfForBitDepth(bitdepth) ) ) {
@@ -1818,6 +2066,7 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
                         assert(glContextAttacher);
                         glContextAttacher->attach();
                         *image = convertRAMImageToOpenGLTexture(imageToConvert);
+                        insertUploadedTextureInGLCache(glContextAttacher->getContext(), imageToConvert, *image);
                     } else {
                         assert(returnStorage == eStorageModeRAM && (imageToConvert->getStorageMode() == eStorageModeRAM || imageToConvert->getStorageMode() == eStorageModeDisk));
                         // If renderRoI must return a RAM image, don't convert it back again!
@@ -1832,10 +2081,15 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
                 stats->addCacheInfosForNode(getNode(), false, true);
             }
         } else if (*image) { //  else if (imageToConvert && !*image)
+            bool hasDownscaled = false;
             ///Ensure the image is allocated
             if ( (*image)->getStorageMode() != eStorageModeGLTex ) {
                 (*image)->allocateMemory();
 
+                if (imageToConvert) {
+                    hasDownscaled = completeDownscaledImage(*imageToConvert, roi, image->get());
+                }
+
                 if (storage == eStorageModeGLTex) {
 
                     // When using the GPU, we don't want to retrieve partially rendered image because rendering the portion
@@ -1848,7 +2102,9 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
                         if (returnStorage == eStorageModeGLTex) {
                             assert(glContextAttacher);
                             glContextAttacher->attach();
-                            *image = convertRAMImageToOpenGLTexture(*image);
+                            ImagePtr ramImage = *image;
+                            *image = convertRAMImageToOpenGLTexture(ramImage);
+                            insertUploadedTextureInGLCache(glContextAttacher->getContext(), ramImage, *image);
                         }
                     } else {
                         image->reset();
@@ -1858,7 +2114,7 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
             }
 
             if ( stats && stats->isInDepthProfilingEnabled() ) {
-                stats->addCacheInfosForNode(getNode(), false, false);
+                stats->addCacheInfosForNode(getNode(), false, hasDownscaled);
             }
         } else {
             if ( stats && stats->isInDepthProfilingEnabled() ) {
@@ -1868,6 +2124,114 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
     } // isCached
 } // EffectInstance::getImageFromCacheAndConvertIfNeeded
 
+void
+EffectInstance::getImageFromPreviousHashInCache(const ImageKey & key,
+                                                U64 nodeHash,
+                                                U64 keyHashSalt,
+                                                unsigned int mipMapLevel,
+                                                const RectD & rod,
+                                                ImageBitDepthEnum bitdepth,
+                                                const ImagePlaneDesc & components,
+                                                ImagePtr* image)
+{
+    U64 previousHash;
+    double dirtyTime;
+    RectD dirtyRegion;
+    NodePtr node = getNode();
+
+    if ( !node->getDirtyRegionForHash(nodeHash, &previousHash, &dirtyTime, &dirtyRegion) || (dirtyTime != key.getTime()) ) {
+        return;
+    }
+
+    U64 previousKeyHash = previousHash;
+    if (keyHashSalt) {
+        Hash64 hash;
+        hash.append(previousHash);
+        hash.append(keyHashSalt);
+        hash.computeHash();
+        previousKeyHash = hash.value();
+    }
+    ImageKey previousKey(node.get(),
+                         previousKeyHash,
+                         key._frameVaryingOrAnimated,
+                         key._time,
+                         key.getView(),
+                         key._pixelAspect,
+                         key._draftMode,
+                         key._fullScaleWithDownscaleInputs);
+    ImageList cachedImages;
+    if ( !appPTR->getImage(previousKey, &cachedImages) ) {
+        return;
+    }
+
+    ImagePtr previousImage;
+    for (ImageList::iterator it = cachedImages.begin(); it != cachedImages.end(); ++it) {
+        const ImagePlaneDesc & imgComps = (*it)->getComponents();
+        bool convertible = (imgComps.isColorPlane() && components.isColorPlane()) || (imgComps == components);
+        if ( ( (*it)->getMipMapLevel() == mipMapLevel ) && convertible && (*it)->usesBitMap() &&
+             ( (*it)->getStorageMode() == eStorageModeRAM ) && !(*it)->getBounds().isNull() &&
+             ( getSizeOfForBitDepth( (*it)->getBitDepth() ) >= getSizeOfForBitDepth(bitdepth) ) ) {
+            previousImage = *it;
+            break;
+        }
+    }
+    if (!previousImage) {
+        return;
+    }
+
+    ///Do not copy the portions that another thread is still rendering, their bitmap would never be marked in the new image
+    {
+        std::list<RectI> restToRender;
+        bool isBeingRenderedElsewhere = false;
+        previousImage->getRestToRender_trimap(previousImage->getBounds(), restToRender, &isBeingRenderedElsewhere);
+        if (isBeingRenderedElsewhere) {
+            return;
+        }
+    }
+
+    ImageParamsPtr params = boost::make_shared<ImageParams>( *previousImage->getParams() );
+    params->setRoD(rod);
+    ImagePtr img;
+    bool isCached = appPTR->getImageOrCreate(key, params, &img);
+    if (!img) {
+        return;
+    }
+    img->allocateMemory();
+    if (!isCached) {
+        ///We created the image: nobody else may render in it yet
+        previousImage->allocateMemory();
+        img->pasteFrom( *previousImage, previousImage->getBounds(), true /*copyBitmap*/ );
+        if ( !dirtyRegion.isNull() ) {
+            RectI dirtyPixels;
+            dirtyRegion.toPixelEnclosing(mipMapLevel, img->getPixelAspectRatio(), &dirtyPixels);
+            img->clearBitmap(dirtyPixels);
+        }
+    }
+    *image = img;
+} // EffectInstance::getImageFromPreviousHashInCache
+
+/**
+ * @brief Returns the input from which the given effect passes its image unchanged at the same time and view,
+ * as Dot and GroupOutput nodes do, or -1. This uses the identity cache of the effect.
+ **/
+static int
+getPassThroughInputForConcatenation(const EffectInstancePtr& effect,
+                                    double time,
+                                    ViewIdx view)
+{
+    double inputTime;
+    ViewIdx inputView;
+    int inputNb = -1;
+    RectI format = effect->getOutputFormat();
+    bool isIdentity = effect->isIdentity_public(true, effect->getRenderHash(), time, RenderScale(1.), format, view, &inputTime, &inputView, &inputNb);
+
+    if ( !isIdentity || (inputNb < 0) || (inputTime != time) || (inputView != view) ) {
+        return -1;
+    }
+
+    return inputNb;
+}
+
 void
 EffectInstance::tryConcatenateTransforms(double time,
                                          bool draftRender,
@@ -1913,26 +2277,27 @@ EffectInstance::tryConcatenateTransforms(double time,
             // recursion upstream
             bool inputCanTransform = false;
             bool inputIsDisabled  =  input->getNode()->isNodeDisabled();
+            int passThroughInputNb = -1;
 
             if (!inputIsDisabled) {
                 inputCanTransform = input->getNode()->getCurrentCanTransform();
+                if (!inputCanTransform) {
+                    passThroughInputNb = getPassThroughInputForConcatenation(input, time, view);
+                }
             }
 
 
-            while ( input && (inputCanTransform || inputIsDisabled) ) {
-                //input is either disabled, or identity or can concatenate a transform too
+            while ( input && (inputCanTransform || inputIsDisabled || passThroughInputNb != -1) ) {
+                //input is either disabled, or identity (Dot, GroupOutput...) or can concatenate a transform too
                 if (inputIsDisabled) {
-                    int prefInput;
-                    input = input->getNearestNonDisabled();
-                    prefInput = input ? input->getNode()->getPreferredInput() : -1;
-                    if (prefInput == -1) {
+                    int prefInput = -1;
+                    EffectInstancePtr lastDisabled = input->getNearestNonDisabledPrevious(&prefInput);
+                    if ( !lastDisabled || (prefInput == -1) ) {
                         break;
                     }
-
-                    if (input) {
-                        im.newInputNbToFetchFrom = prefInput;
-                        im.newInputEffect = input;
-                    }
+                    im.newInputNbToFetchFrom = prefInput;
+                    im.newInputEffect = lastDisabled;
+                    input = lastDisabled->getInput(prefInput);
                 } else if (inputCanTransform) {
                     Transform::Matrix3x3 m;
                     inputToTransform.reset();
@@ -1948,13 +2313,21 @@ EffectInstance::tryConcatenateTransforms(double time,
                         break;
                     }
                 } else {
-                    assert(false);
+                    // The image goes through this node unchanged: fetch upstream of it
+                    im.newInputNbToFetchFrom = passThroughInputNb;
+                    im.newInputEffect = input;
+                    input = input->getInput(passThroughInputNb);
                 }
 
                 if (input) {
                     inputIsDisabled = input->getNode()->isNodeDisabled();
+                    inputCanTransform = false;
+                    passThroughInputNb = -1;
                     if (!inputIsDisabled) {
                         inputCanTransform = input->getNode()->getCurrentCanTransform();
+                        if (!inputCanTransform) {
+                            passThroughInputNb = getPassThroughInputForConcatenation(input, time, view);
+                        }
                     }
                 }
             }
@@ -1978,6 +2351,78 @@ EffectInstance::tryConcatenateTransforms(double time,
     } // if ((canTransform && getTransformSucceeded) || (canApplyTransform && !inputHoldingTransforms.empty()))
 } // EffectInstance::tryConcatenateTransforms
 
+bool
+EffectInstance::renderTransformInHost(const RenderActionArgs& args,
+                                      const ResamplerMipMapCachePtr& mipmaps,
+                                      StatusEnum* status)
+{
+    SettingsPtr settings = appPTR->getCurrentSettings();
+    Settings::HostTransformFilterEnum hostFilter = settings ? settings->getHostTransformFilter() : Settings::eHostTransformFilterPlugin;
+
+    if ( (hostFilter == Settings::eHostTransformFilterPlugin) || args.useOpenGL || !getNode()->getCurrentCanTransform() ) {
+        return false;
+    }
+
+    Transform::Matrix3x3 thisNodeTransform;
+    EffectInstancePtr inputToTransform;
+    StatusEnum stat = getTransform_public(args.time, args.mappedScale, args.draftMode, args.view, &inputToTransform, &thisNodeTransform);
+    if ( (stat != eStatusOK) || !inputToTransform ) {
+        return false;
+    }
+    int inputNb = getInputNumber( inputToTransform.get() );
+    if (inputNb == -1) {
+        return false;
+    }
+
+    ImageResampler::FilterEnum filter;
+    switch (hostFilter) {
+    case Settings::eHostTransformFilterBilinear:
+        filter = ImageResampler::eFilterBilinear;
+        break;
+    case Settings::eHostTransformFilterCubic:
+        filter = ImageResampler::eFilterCubic;
+        break;
+    case Settings::eHostTransformFilterLanczos:
+    default:
+        filter = ImageResampler::eFilterLanczos;
+        break;
+    }
+
+    // Fetch all the sources first so that nothing is written if one of them cannot be resampled by the host,
+    // in which case the plug-in renders as usual
+    std::vector<std::pair<ImagePtr, Transform::Matrix3x3> > sources;
+    for (std::list<std::pair<ImagePlaneDesc, ImagePtr> >::const_iterator it = args.outputPlanes.begin(); it != args.outputPlanes.end(); ++it) {
+        RectI roiPixel;
+        Transform::Matrix3x3Ptr upstreamTransform;
+        ImagePtr src = getImage(inputNb, args.time, args.mappedScale, args.view,
+                                NULL,
+                                &it->first,
+                                it->first.isColorPlane(),
+                                false /*dontUpscale*/,
+                                eStorageModeRAM,
+                                NULL,
+                                &roiPixel,
+                                &upstreamTransform);
+        if ( !src || ( src->getComponentsCount() != it->second->getComponentsCount() ) || ( src->getBitDepth() != it->second->getBitDepth() ) ) {
+            return false;
+        }
+        // The image fetched may come from upstream of other transforms that were concatenated into this one
+        Transform::Matrix3x3 srcToDst = upstreamTransform ? Transform::matMul(thisNodeTransform, *upstreamTransform) : thisNodeTransform;
+        sources.push_back( std::make_pair(src, srcToDst) );
+    }
+
+    std::size_t i = 0;
+    for (std::list<std::pair<ImagePlaneDesc, ImagePtr> >::const_iterator it = args.outputPlanes.begin(); it != args.outputPlanes.end(); ++it, ++i) {
+        if ( !ImageResampler::resample(sources[i].first, sources[i].second, filter, args.roi, mipmaps.get(), it->second.get()) ) {
+            // Planes already resampled are rendered again by the plug-in
+            return false;
+        }
+    }
+    *status = eStatusOK;
+
+    return true;
+} // EffectInstance::renderTransformInHost
+
 bool
 EffectInstance::allocateImagePlane(const ImageKey & key,
                                    const RectD & rod,
@@ -2178,7 +2623,10 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
                                                                         args.planes);
 
     //Exit of the host frame threading thread
-    appPTR->getAppTLS()->cleanupTLSForThread();
+    //The calling thread may also render some of the rectangles, its TLS must be kept
+    if (callingThread != curThread) {
+        appPTR->getAppTLS()->cleanupTLSForThread();
+    }
 
     return ret;
 }
@@ -2398,13 +2846,10 @@ EffectInstance::Implementation::renderHandler(const EffectTLSDataPtr& tls,
                                               const ImagePremultiplicationEnum originalImagePremultiplication,
                                               ImagePlanesToRender & planes)
 {
-    TimeLapsePtr timeRecorder;
+    // The render is always timed: besides the render statistics, the cost is used by the cache
+    TimeLapsePtr timeRecorder = boost::make_shared<TimeLapse>();
     const ParallelRenderArgsPtr& frameArgs = tls->frameArgs.back();
 
-    if (frameArgs->stats) {
-        timeRecorder = boost::make_shared<TimeLapse>();
-    }
-
     const EffectInstance::PlaneToRender & firstPlane = planes.planes.begin()->second;
     const double time = tls->currentRenderArgs.time;
     const ViewIdx view = tls->currentRenderArgs.view;
@@ -2529,30 +2974,39 @@ EffectInstance::Implementation::renderHandler(const EffectTLSDataPtr& tls,
                             it->second.fullscaleImage->fillZero(renderMappedRectToRender, glContext);
                         }
 
+                        ///Only the part of the identity image that covers the rectangle to render is needed: this
+                        ///functor is called once per tile, so do not convert and upscale the whole image every time
+                        unsigned int upscaleLevels = idIt->second->getMipMapLevel() - it->second.fullscaleImage->getMipMapLevel();
+                        RectI sourceRect = renderMappedRectToRender.downscalePowerOfTwoSmallestEnclosing(upscaleLevels);
+                        if ( !sourceRect.intersect(idIt->second->getBounds(), &sourceRect) ) {
+                            continue;
+                        }
+
                         ///Convert format first if needed
-                        ImagePtr sourceImage;
+                        ImagePtr sourceImage = boost::make_shared<Image>(it->second.fullscaleImage->getComponents(),
+                                                                         idIt->second->getRoD(),
+                                                                         sourceRect,
+                                                                         idIt->second->getMipMapLevel(),
+                                                                         idIt->second->getPixelAspectRatio(),
+                                                                         it->second.fullscaleImage->getBitDepth(),
+                                                                         idIt->second->getPremultiplication(),
+                                                                         idIt->second->getFieldingOrder(),
+                                                                         false);
                         if ( ( it->second.fullscaleImage->getComponents() != idIt->second->getComponents() ) || ( it->second.fullscaleImage->getBitDepth() != idIt->second->getBitDepth() ) ) {
-                            sourceImage = boost::make_shared<Image>(it->second.fullscaleImage->getComponents(),
-                                                                    idIt->second->getRoD(),
-                                                                    idIt->second->getBounds(),
-                                                                    idIt->second->getMipMapLevel(),
-                                                                    idIt->second->getPixelAspectRatio(),
-                                                                    it->second.fullscaleImage->getBitDepth(),
-                                                                    idIt->second->getPremultiplication(),
-                                                                    idIt->second->getFieldingOrder(),
-                                                                    false);
-
                             ViewerColorSpaceEnum colorspace = _publicInterface->getApp()->getDefaultColorSpaceForBitDepth( idIt->second->getBitDepth() );
                             ViewerColorSpaceEnum dstColorspace = _publicInterface->getApp()->getDefaultColorSpaceForBitDepth( it->second.fullscaleImage->getBitDepth() );
-                            idIt->second->convertToFormat( idIt->second->getBounds(), colorspace, dstColorspace, 3, false, false, sourceImage.get() );
+                            idIt->second->convertToFormat( sourceRect, colorspace, dstColorspace, 3, false, false, sourceImage.get() );
                         } else {
-                            sourceImage = idIt->second;
+                            sourceImage->pasteFrom(*(idIt->second), sourceRect, false);
                         }
 
                         ///then upscale
                         const RectD & rod = sourceImage->getRoD();
                         RectI bounds;
                         rod.toPixelEnclosing(it->second.renderMappedImage->getMipMapLevel(), it->second.renderMappedImage->getPixelAspectRatio(), &bounds);
+                        if ( !sourceRect.upscalePowerOfTwo(upscaleLevels).intersect(bounds, &bounds) ) {
+                            continue;
+                        }
                         ImagePtr inputPlane = boost::make_shared<Image>(it->first,
                                                        rod,
                                                        bounds,
@@ -2696,7 +3150,10 @@ EffectInstance::Implementation::renderHandler(const EffectTLSDataPtr& tls,
             }
         }
 
-        StatusEnum st = _publicInterface->render_public(actionArgs);
+        StatusEnum st;
+        if ( !_publicInterface->renderTransformInHost(actionArgs, planes.resamplerMipMaps, &st) ) {
+            st = _publicInterface->render_public(actionArgs);
+        }
 
         if (planes.useOpenGL) {
             glDisable(GL_SCISSOR_TEST);
@@ -2913,6 +3370,24 @@ EffectInstance::Implementation::renderHandler(const EffectTLSDataPtr& tls,
         }
     } // for (std::map<ImagePlaneDesc,PlaneToRender>::const_iterator it = outputPlanes.begin(); it != outputPlanes.end(); ++it) {
 
+    {
+        // Record the render cost on the images so that the cache evicts first the ones that are cheap to render again,
+        // and on the node so that shouldCacheOutput() knows whether it is worth caching
+        double timeSpent = timeRecorder->getTimeSinceCreation();
+        std::size_t bytesRendered = 0;
+        for (std::map<ImagePlaneDesc, EffectInstance::PlaneToRender>::const_iterator it = planes.planes.begin(); it != planes.planes.end(); ++it) {
+            if (it->second.renderMappedImage) {
+                it->second.renderMappedImage->addRenderCost(timeSpent);
+                bytesRendered += (std::size_t)renderMappedRectToRender.area() * it->second.renderMappedImage->getComponentsCount() *
+                                 getSizeOfForBitDepth( it->second.renderMappedImage->getBitDepth() );
+            }
+            if ( it->second.downscaleImage && (it->second.downscaleImage != it->second.renderMappedImage) ) {
+                it->second.downscaleImage->addRenderCost(timeSpent);
+            }
+        }
+        _publicInterface->getNode()->addRenderCostSample(timeSpent, bytesRendered);
+    }
+
 
     return eRenderingFunctorRetOK;
 } // tiledRenderingFunctor
@@ -3057,9 +3532,24 @@ EffectInstance::onSignificantEvaluateAboutToBeCalled(KnobI* knob)
     if (isMT) {
         node->refreshIdentityState();
 
-        //Increments the knobs age following a change
-        node->incrementKnobsAge();
+        //Increments the knobs age following a change. Without a knob, the evaluation was requested for another reason
+        node->incrementKnobsAge(/*knobValuesChanged=*/knob != 0);
+    }
+}
+
+void
+EffectInstance::incrHashInRegionAndEvaluate(double time,
+                                            const RectD& region)
+{
+    abortAnyEvaluation();
+
+    NodePtr node = getNode();
+    if ( node->isNodeCreated() && ( QThread::currentThread() == qApp->thread() ) ) {
+        getApp()->triggerAutoSave();
+        node->refreshIdentityState();
+        node->incrementKnobsAgeInRegion(time, region);
     }
+    evaluate(true, false);
 }
 
 void
@@ -3984,6 +4474,68 @@ EffectInstance::getFramesNeeded_public(U64 hash,
     return framesNeeded;
 }
 
+bool
+EffectInstance::getOutputDirtyRegion(double time,
+                                     int inputNb,
+                                     const RectD& inputRegion,
+                                     RectD* outputRegion)
+{
+    EffectInstancePtr input = getInput(inputNb);
+    if ( !input || !supportsTiles() ) {
+        return false;
+    }
+
+    U64 hash = getHash();
+    FramesNeededMap framesNeeded = getFramesNeeded_public(hash, time, ViewIdx(0), 0);
+    FramesNeededMap::const_iterator foundInput = framesNeeded.find(inputNb);
+    if ( foundInput != framesNeeded.end() ) {
+        for (FrameRangesMap::const_iterator it = foundInput->second.begin(); it != foundInput->second.end(); ++it) {
+            for (std::size_t i = 0; i < it->second.size(); ++i) {
+                if ( (it->second[i].min != time) || (it->second[i].max != time) ) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    RenderScale scale(1.);
+    RectD rod;
+    bool isProjectFormat;
+    StatusEnum stat = getRegionOfDefinition_public(hash, time, scale, ViewIdx(0), &rod, &isProjectFormat);
+    if ( (stat == eStatusFailed) || rod.isNull() ) {
+        return false;
+    }
+
+    bool hasRegion = false;
+    const double tileWidth = rod.width() / NATRON_OUTPUT_DIRTY_REGION_TILES;
+    const double tileHeight = rod.height() / NATRON_OUTPUT_DIRTY_REGION_TILES;
+    for (int y = 0; y < NATRON_OUTPUT_DIRTY_REGION_TILES; ++y) {
+        for (int x = 0; x < NATRON_OUTPUT_DIRTY_REGION_TILES; ++x) {
+            RectD tile(rod.x1 + x * tileWidth, rod.y1 + y * tileHeight,
+                       x == NATRON_OUTPUT_DIRTY_REGION_TILES - 1 ? rod.x2 : rod.x1 + (x + 1) * tileWidth,
+                       y == NATRON_OUTPUT_DIRTY_REGION_TILES - 1 ? rod.y2 : rod.y1 + (y + 1) * tileHeight);
+            RoIMap rois;
+            getRegionsOfInterest_public(time, scale, rod, tile, ViewIdx(0), &rois);
+            RoIMap::const_iterator foundRoI = rois.find(input);
+            if ( ( foundRoI == rois.end() ) || !foundRoI->second.intersects(inputRegion) ) {
+                continue;
+            }
+            if (hasRegion) {
+                outputRegion->merge(tile);
+            } else {
+                *outputRegion = tile;
+                hasRegion = true;
+            }
+        }
+    }
+    if (!hasRegion) {
+        // The output does not depend on the dirty pixels, but the hash changed anyway: keep a degenerate region
+        outputRegion->clear();
+    }
+
+    return true;
+}
+
 void
 EffectInstance::getFrameRange_public(U64 hash,
                                      double *first,
@@ -4109,6 +4661,15 @@ EffectInstance::releaseRenderInstance(const EffectInstancePtr& instance)
         return;
     }
 
+    // Keep at most as many idle clones as there can be parallel renders, the others are destroyed
+    int maxClones = appPTR->getCurrentSettings()->getNumberOfParallelRenders();
+    if (maxClones == 0) {
+        maxClones = appPTR->getHardwareIdealThreadCount();
+    }
+    if ( (int)_imp->renderClonesPool.size() >= std::max(1, maxClones) ) {
+        return;
+    }
+
     // Make this instance available again
     _imp->renderClonesPool.push_back(instance);
 }
@@ -4884,7 +5445,7 @@ EffectInstance::aboutToRestoreDefaultValues()
     ///Invalidate the cache by incrementing the age
     NodePtr node = getNode();
 
-    node->incrementKnobsAge();
+    node->incrementKnobsAge(/*knobValuesChanged=*/true);
 
     if ( node->areKeyframesVisibleOnTimeline() ) {
         node->hideKeyframesFromTimeline(true);
@@ -5646,38 +6207,118 @@ EffectInstance::getFieldingOrder() const
     return _imp->metadata.getOutputFielding();
 }
 
+/**
+ * @brief Post-order depth-first walk of the outputs of node: reversing postOrder gives the nodes in topological order.
+ **/
+static void
+sortMetadataDependents(Node* node,
+                       std::set<Node*>& visited,
+                       std::map<Node*, NodesList>& outputs,
+                       std::vector<Node*>* postOrder)
+{
+    if ( !visited.insert(node).second ) {
+        return;
+    }
+    NodesList& nodeOutputs = outputs[node];
+    node->getOutputsWithGroupRedirection(nodeOutputs);
+    for (NodesList::const_iterator it = nodeOutputs.begin(); it != nodeOutputs.end(); ++it) {
+        sortMetadataDependents(it->get(), visited, outputs, postOrder);
+    }
+    postOrder->push_back(node);
+}
+
 bool
-EffectInstance::refreshMetadata_recursive(std::list<Node*> & markedNodes)
+EffectInstance::refreshMetadataRecursive(const std::list<EffectInstancePtr>& roots)
 {
-    NodePtr node = getNode();
-    std::list<Node*>::iterator found = std::find( markedNodes.begin(), markedNodes.end(), node.get() );
+    std::set<Node*> visited;
+    std::map<Node*, NodesList> outputs;
+    std::vector<Node*> postOrder;
+    std::set<Node*> rootNodes;
 
-    if ( found != markedNodes.end() ) {
-        return false;
+    for (std::list<EffectInstancePtr>::const_iterator it = roots.begin(); it != roots.end(); ++it) {
+        NodePtr node = (*it)->getNode();
+        if (!node) {
+            continue;
+        }
+        rootNodes.insert( node.get() );
+        sortMetadataDependents(node.get(), visited, outputs, &postOrder);
     }
 
-    if (_imp->runningClipPreferences) {
-        return false;
-    }
+    // Only nodes with an input that changed are refreshed
+    std::set<Node*> dirty = rootNodes;
+    bool ret = false;
+    for (std::vector<Node*>::reverse_iterator it = postOrder.rbegin(); it != postOrder.rend(); ++it) {
+        Node* node = *it;
+        if ( dirty.find(node) == dirty.end() ) {
+            continue;
+        }
+        EffectInstancePtr effect = node->getEffectInstance();
+        if (!effect || effect->_imp->runningClipPreferences) {
+            continue;
+        }
 
-    ClipPreferencesRunning_RAII runningflag_(this);
-    bool ret = refreshMetadata_public(false);
-    node->refreshIdentityState();
+        bool metadataChanged;
+        bool layersChanged = true;
+        {
+            ClipPreferencesRunning_RAII runningflag_( effect.get() );
+            metadataChanged = effect->refreshMetadata_public(false);
+            node->refreshIdentityState();
+
+            if ( !node->duringInputChangedAction() ) {
+                ///The channels selector refreshing is already taken care of in the inputChanged action
+                bool selectorsChanged = node->refreshChannelSelectors();
+                // Without an output layer menu we cannot tell whether the layers seen downstream changed
+                layersChanged = selectorsChanged || !node->hasHostOutputLayerSelector();
+            }
+        }
+
+        bool isRoot = rootNodes.find(node) != rootNodes.end();
+        if (isRoot) {
+            ret |= metadataChanged;
+        }
 
-    if ( !node->duringInputChangedAction() ) {
-        ///The channels selector refreshing is already taken care of in the inputChanged action
-        node->refreshChannelSelectors();
+        // The roots were refreshed because something upstream or in the graph changed (e.g: a connection or a user layer),
+        // their outputs are always refreshed. Further down, only follow nodes whose state actually changed.
+        if (isRoot || metadataChanged || layersChanged) {
+            const NodesList& nodeOutputs = outputs[node];
+            for (NodesList::const_iterator it2 = nodeOutputs.begin(); it2 != nodeOutputs.end(); ++it2) {
+                dirty.insert( it2->get() );
+            }
+        }
     }
 
-    markedNodes.push_back( node.get() );
+    return ret;
+} // EffectInstance::refreshMetadataRecursive
+
+// Effects recorded by refreshMetadata_public(true) while a MetadataRefreshBatch_RAII is alive. Main-thread only.
+static int metadataRefreshBatchLevel = 0;
+static std::list<EffectInstanceWPtr> metadataRefreshBatchRoots;
 
-    NodesList outputs;
-    node->getOutputsWithGroupRedirection(outputs);
-    for (NodesList::const_iterator it = outputs.begin(); it != outputs.end(); ++it) {
-        (*it)->getEffectInstance()->refreshMetadata_recursive(markedNodes);
+MetadataRefreshBatch_RAII::MetadataRefreshBatch_RAII()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    ++metadataRefreshBatchLevel;
+}
+
+MetadataRefreshBatch_RAII::~MetadataRefreshBatch_RAII()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    assert(metadataRefreshBatchLevel > 0);
+    if (--metadataRefreshBatchLevel > 0) {
+        return;
     }
 
-    return ret;
+    std::list<EffectInstancePtr> roots;
+    for (std::list<EffectInstanceWPtr>::const_iterator it = metadataRefreshBatchRoots.begin(); it != metadataRefreshBatchRoots.end(); ++it) {
+        EffectInstancePtr effect = it->lock();
+        if (effect) {
+            roots.push_back(effect);
+        }
+    }
+    metadataRefreshBatchRoots.clear();
+    if ( !roots.empty() ) {
+        EffectInstance::refreshMetadataRecursive(roots);
+    }
 }
 
 void
@@ -5738,12 +6379,22 @@ EffectInstance::refreshMetadata_public(bool recurse)
     assert( QThread::currentThread() == qApp->thread() );
 
     if (recurse) {
+        if (metadataRefreshBatchLevel > 0) {
+            // Refreshed when the batch ends
+            for (std::list<EffectInstanceWPtr>::const_iterator it = metadataRefreshBatchRoots.begin(); it != metadataRefreshBatchRoots.end(); ++it) {
+                if (it->lock().get() == this) {
+                    return false;
+                }
+            }
+            metadataRefreshBatchRoots.push_back( shared_from_this() );
 
-        {
-            std::list<Node*> markedNodes;
-
-            return refreshMetadata_recursive(markedNodes);
+            return false;
         }
+
+        std::list<EffectInstancePtr> roots;
+        roots.push_back( shared_from_this() );
+
+        return refreshMetadataRecursive(roots);
     } else {
         bool ret = refreshMetadata_internal();
         if (ret) {
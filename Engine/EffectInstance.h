@@ -595,6 +595,20 @@ public:
                                              const OSGLContextAttacherPtr& glContextAttacher,
                                              ImagePtr* image);
 
+    /**
+     * @brief If the node hash comes from a change localized to a region (see Node::incrementKnobsAgeInRegion), creates in the cache
+     * the image for the given key from the image cached with the previous hash, with the dirty region marked as not rendered.
+     * @param keyHashSalt Appended to the previous hash as it was to the node hash to make the key, or 0
+     **/
+    void getImageFromPreviousHashInCache(const ImageKey & key,
+                                         U64 nodeHash,
+                                         U64 keyHashSalt,
+                                         unsigned int mipMapLevel,
+                                         const RectD & rod,
+                                         ImageBitDepthEnum bitdepth,
+                                         const ImagePlaneDesc & components,
+                                         ImagePtr* image);
+
     /**
      * @brief Converts the given OpenGL texture to a RAM-stored image. The resulting image will be cached.
      * This function is SLOW as it makes use of glReadPixels.
@@ -771,9 +785,16 @@ protected:
 
     virtual void onMetadataRefreshed(const NodeMetadata& /*metadata*/) {}
 
-    bool refreshMetadata_recursive(std::list<Node*> & markedNodes);
+    /**
+     * @brief Refreshes the metadata of the given effects and of the nodes downstream, each node being visited at most
+     * once and in topological order, so that it is refreshed after all its inputs.
+     * The propagation stops at nodes whose metadata and layers did not change.
+     * @returns True if the metadata of one of the roots changed.
+     **/
+    static bool refreshMetadataRecursive(const std::list<EffectInstancePtr>& roots);
 
     friend class ClipPreferencesRunning_RAII;
+    friend class MetadataRefreshBatch_RAII;
     void setClipPreferencesRunning(bool running);
 
 public:
@@ -921,6 +942,21 @@ public:
         return eViewInvarianceAllViewsVariant;
     }
 
+    /**
+     * @brief Same as isViewInvariant() but also returns eViewInvarianceAllViewsInvariant if the render of the current frame
+     * detected that this node and its upstream tree render the same image for all views.
+     **/
+    ViewInvarianceLevel getCurrentRenderViewInvariance() const;
+
+    /**
+     * @brief Restricts processChannels to the channels of the output requested by the tree root of the current render,
+     * e.g the single channel displayed by the viewer. This is only done for nodes using the host channel selector.
+     * If renderActionOnly is true, this is only done while the render action of this effect is running on this thread, so that
+     * the results of other actions, which are cached for all renders, do not depend on it.
+     * Returns true if processChannels was modified.
+     **/
+    bool restrictProcessChannelsForCurrentRender(std::bitset<4>* processChannels, bool renderActionOnly = false) const;
+
     class OpenGLContextEffectData
     {
         // True if we did not unlock the context mutex in attachOpenGLContext()
@@ -1074,6 +1110,16 @@ public:
                                       const ImageBitDepthEnum* textureDepth,
                                       RectI* roiPixel,
                                       Transform::Matrix3x3Ptr* transform = 0) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Follows, from the given effect, the nodes that the request pass of the current render found to be identity
+     * on one of their inputs for the given time and view (Dots, disabled nodes, NoOps, GroupInput/GroupOutput, identity
+     * results...) and returns the first effect upstream that actually renders, with the time and view it should be rendered at.
+     * Nodes with a channel selector on their identity input are not skipped since they may remap the planes.
+     * Returns the given effect if it does not pass-through or if there is no request pass (e.g: analysis).
+     **/
+    static EffectInstancePtr resolvePassThroughInput(const EffectInstancePtr& effect, double* time, ViewIdx* view);
+
     virtual void aboutToRestoreDefaultValues() OVERRIDE FINAL;
     virtual bool shouldCacheOutput(bool isFrameVaryingOrAnimated, double time, ViewIdx view, int visitsCount) const;
 
@@ -1159,6 +1205,20 @@ public:
 
     FramesNeededMap getFramesNeeded_public(U64 hash, double time, ViewIdx view, unsigned int mipMapLevel) WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Computes the region of the output image at the given time that depends on the given region of the input image
+     * at the same time, see Node::incrementKnobsAgeInRegion(). The output is split in tiles and the tiles whose region of
+     * interest on the input intersects the region are kept.
+     * Returns false if the effect does not support tiles or if the output at this time depends on other frames of the input.
+     **/
+    bool getOutputDirtyRegion(double time, int inputNb, const RectD& inputRegion, RectD* outputRegion) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Same as incrHashAndEvaluate(true, false) for a change that only affects the given region (in canonical coordinates)
+     * at the given time: only this region is re-rendered, see Node::incrementKnobsAgeInRegion().
+     **/
+    void incrHashInRegionAndEvaluate(double time, const RectD& region);
+
     void getFrameRange_public(U64 hash, double *first, double *last, bool bypasscache = false);
 
     /**
@@ -1432,6 +1492,9 @@ public:
         bool useOpenGL;
         EffectInstance::OpenGLContextEffectDataPtr glContextData;
 
+        // The mipmaps of the sources resampled by renderTransformInHost(), shared by the copies made for each tile
+        ResamplerMipMapCachePtr resamplerMipMaps;
+
         ImagePlanesToRender()
             : rectsToRender()
             , planes()
@@ -1439,6 +1502,7 @@ public:
             , outputPremult(eImagePremultiplicationPremultiplied)
             , useOpenGL(false)
             , glContextData()
+            , resamplerMipMaps()
         {
         }
     };
@@ -1746,6 +1810,15 @@ public:
 
     void clearRenderInstances();
 
+    /**
+     * @brief Returns an instance of the effect to render with: the effect itself if it is not already rendering,
+     * otherwise a render clone (or the effect itself if it does not support render clones).
+     * It must be given back with releaseRenderInstance() once the render is done.
+     **/
+    EffectInstancePtr getOrCreateRenderInstance();
+
+    void releaseRenderInstance(const EffectInstancePtr& instance);
+
 protected:
 
 
@@ -1766,11 +1839,6 @@ protected:
 
 private:
 
-    EffectInstancePtr getOrCreateRenderInstance();
-
-
-    void releaseRenderInstance(const EffectInstancePtr& instance);
-
     /**
      * @brief This function must initialize all OpenGL context related data such as shaders, LUTs, etc...
      * This function will be called once per context. The function dettachOpenGLContext() will be called
@@ -1839,6 +1907,13 @@ public:
                                   const RenderScale & scale,
                                   InputMatrixMap* inputTransforms);
 
+    /**
+     * @brief If the user selected a host filter for transforms in the preferences and this effect can transform,
+     * fills the output planes of args by resampling its source through its transform, concatenated with the transforms upstream,
+     * instead of calling the render action. Returns false if the plug-in must render.
+     **/
+    bool renderTransformInHost(const RenderActionArgs& args, const ResamplerMipMapCachePtr& mipmaps, StatusEnum* status);
+
 
     static void transformInputRois(const EffectInstance* self,
                                    const InputMatrixMapPtr& inputTransforms,
@@ -2264,6 +2339,21 @@ public:
 };
 
 
+/**
+ * @brief While an instance of this class is alive, calls to refreshMetadata_public(true) made on the main thread
+ * only record the effect: the metadata of all recorded effects is refreshed in a single propagation wave
+ * when the outermost instance is destroyed. Use it around code doing many graph edits in a row.
+ **/
+class MetadataRefreshBatch_RAII
+{
+public:
+
+    MetadataRefreshBatch_RAII();
+
+    ~MetadataRefreshBatch_RAII();
+};
+
+
 /**
  * @typedef Any plug-in should have a static function called BuildEffect with the following signature.
  * It is used to build a new instance of an effect. Basically it should just call the constructor.
@@ -25,13 +25,17 @@
 
 #include "EffectInstancePrivate.h"
 
+#include <algorithm> // max
 #include <cassert>
 #include <stdexcept>
 #include <sstream> // stringstream
 
+#include <QtCore/QThread>
+
 #include "Engine/AppInstance.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
+#include "Engine/ThreadPool.h"
 #include "Engine/ViewIdx.h"
 
 
@@ -47,41 +51,53 @@ ActionsCache::ActionsCacheInstance::ActionsCacheInstance()
 {
 }
 
-std::list<ActionsCache::ActionsCacheInstance>::iterator
+ActionsCache::ActionsCacheInstancesList::iterator
 ActionsCache::createActionCacheInternal(U64 newHash)
 {
-    if (_instances.size() >= _maxInstances) {
+    while ( !_instances.empty() && (_instances.size() >= _maxInstances) ) {
+        _instancesIndex.erase(_instances.front()._hash);
         _instances.pop_front();
     }
     ActionsCacheInstance cache;
     cache._hash = newHash;
 
-    return _instances.insert(_instances.end(), cache);
+    ActionsCacheInstancesList::iterator ret = _instances.insert(_instances.end(), cache);
+    _instancesIndex[newHash] = ret;
+
+    return ret;
+}
+
+ActionsCache::ActionsCacheInstance*
+ActionsCache::findActionCache(U64 hash)
+{
+    ActionsCacheInstancesIndex::iterator found = _instancesIndex.find(hash);
+
+    if ( found == _instancesIndex.end() ) {
+        return 0;
+    }
+    // Move it to the back of the LRU, splice does not invalidate the iterator held by the index
+    _instances.splice(_instances.end(), _instances, found->second);
+
+    return &(*found->second);
 }
 
 ActionsCache::ActionsCacheInstance &
 ActionsCache::getOrCreateActionCache(U64 newHash)
 {
-    std::list<ActionsCacheInstance>::iterator found = _instances.end();
+    ActionsCacheInstance* found = findActionCache(newHash);
 
-    for (std::list<ActionsCacheInstance>::iterator it = _instances.begin(); it != _instances.end(); ++it) {
-        if (it->_hash == newHash) {
-            found = it;
-            break;
-        }
+    if (found) {
+        return *found;
     }
-    if ( found == _instances.end() ) {
-        found = createActionCacheInternal(newHash);
-    }
-    assert( found != _instances.end() );
 
-    return *found;
+    return *createActionCacheInternal(newHash);
 }
 
 ActionsCache::ActionsCache(int maxAvailableHashes)
     : _cacheMutex()
     , _instances()
-    , _maxInstances( (std::size_t)maxAvailableHashes )
+    , _instancesIndex()
+    , _maxInstances( (std::size_t)std::max(maxAvailableHashes, 1) )
 {
 }
 
@@ -91,6 +107,7 @@ ActionsCache::clearAll()
     QMutexLocker l(&_cacheMutex);
 
     _instances.clear();
+    _instancesIndex.clear();
 }
 
 void
@@ -98,7 +115,9 @@ ActionsCache::invalidateAll(U64 newHash)
 {
     QMutexLocker l(&_cacheMutex);
 
-    createActionCacheInternal(newHash);
+    // The results cached for other hashes stay valid for these hashes: keep them around until they get evicted,
+    // in case the node comes back to one of them.
+    (void)getOrCreateActionCache(newHash);
 }
 
 bool
@@ -111,24 +130,23 @@ ActionsCache::getIdentityResult(U64 hash,
 {
     QMutexLocker l(&_cacheMutex);
 
-    for (std::list<ActionsCacheInstance>::iterator it = _instances.begin(); it != _instances.end(); ++it) {
-        if (it->_hash == hash) {
-            ActionKey key;
-            key.time = time;
-            key.view = view;
-            key.mipMapLevel = 0;
+    ActionsCacheInstance* cache = findActionCache(hash);
 
-            IdentityCacheMap::const_iterator found = it->_identityCache.find(key);
-            if ( found != it->_identityCache.end() ) {
-                *inputNbIdentity = found->second.inputIdentityNb;
-                *identityTime = found->second.inputIdentityTime;
-                *inputView = found->second.inputView;
+    if (!cache) {
+        return false;
+    }
+    ActionKey key;
+    key.time = time;
+    key.view = view;
+    key.mipMapLevel = 0;
 
-                return true;
-            }
+    IdentityCacheMap::const_iterator found = cache->_identityCache.find(key);
+    if ( found != cache->_identityCache.end() ) {
+        *inputNbIdentity = found->second.inputIdentityNb;
+        *identityTime = found->second.inputIdentityTime;
+        *inputView = found->second.inputView;
 
-            return false;
-        }
+        return true;
     }
 
     return false;
@@ -162,29 +180,28 @@ ActionsCache::getComponentsNeededResults(U64 hash, double time, ViewIdx view, Ef
 {
     QMutexLocker l(&_cacheMutex);
 
-    for (std::list<ActionsCacheInstance>::iterator it = _instances.begin(); it != _instances.end(); ++it) {
-        if (it->_hash == hash) {
-            ActionKey key;
-            key.time = time;
-            key.view = view;
-            key.mipMapLevel = 0;
-
-            ComponentsNeededCacheMap::const_iterator found = it->_componentsNeededCache.find(key);
-            if ( found != it->_componentsNeededCache.end() ) {
-                *passThroughInputNb = found->second.passThroughInputNb;
-                *passThroughTime = found->second.passThroughTime;
-                *passThroughView = found->second.passThroughView;
-                *neededComps = found->second.neededComps;
-                *processChannels = found->second.processChannels;
-                *processAll = found->second.processAll;
-                *passThroughPlanes = found->second.passThroughPlanes;
-                return true;
-            }
-
-            return false;
-        }
+    ActionsCacheInstance* cache = findActionCache(hash);
+
+    if (!cache) {
+        return false;
     }
-    
+    ActionKey key;
+    key.time = time;
+    key.view = view;
+    key.mipMapLevel = 0;
+
+    ComponentsNeededCacheMap::const_iterator found = cache->_componentsNeededCache.find(key);
+    if ( found != cache->_componentsNeededCache.end() ) {
+        *passThroughInputNb = found->second.passThroughInputNb;
+        *passThroughTime = found->second.passThroughTime;
+        *passThroughView = found->second.passThroughView;
+        *neededComps = found->second.neededComps;
+        *processChannels = found->second.processChannels;
+        *processAll = found->second.processAll;
+        *passThroughPlanes = found->second.passThroughPlanes;
+        return true;
+    }
+
     return false;
 }
 
@@ -222,22 +239,21 @@ ActionsCache::getRoDResult(U64 hash,
 {
     QMutexLocker l(&_cacheMutex);
 
-    for (std::list<ActionsCacheInstance>::iterator it = _instances.begin(); it != _instances.end(); ++it) {
-        if (it->_hash == hash) {
-            ActionKey key;
-            key.time = time;
-            key.view = view;
-            key.mipMapLevel = mipMapLevel;
+    ActionsCacheInstance* cache = findActionCache(hash);
 
-            RoDCacheMap::const_iterator found = it->_rodCache.find(key);
-            if ( found != it->_rodCache.end() ) {
-                *rod = found->second;
+    if (!cache) {
+        return false;
+    }
+    ActionKey key;
+    key.time = time;
+    key.view = view;
+    key.mipMapLevel = mipMapLevel;
 
-                return true;
-            }
+    RoDCacheMap::const_iterator found = cache->_rodCache.find(key);
+    if ( found != cache->_rodCache.end() ) {
+        *rod = found->second;
 
-            return false;
-        }
+        return true;
     }
 
     return false;
@@ -270,22 +286,21 @@ ActionsCache::getFramesNeededResult(U64 hash,
 {
     QMutexLocker l(&_cacheMutex);
 
-    for (std::list<ActionsCacheInstance>::iterator it = _instances.begin(); it != _instances.end(); ++it) {
-        if (it->_hash == hash) {
-            ActionKey key;
-            key.time = time;
-            key.view = view;
-            key.mipMapLevel = mipMapLevel;
+    ActionsCacheInstance* cache = findActionCache(hash);
 
-            FramesNeededCacheMap::const_iterator found = it->_framesNeededCache.find(key);
-            if ( found != it->_framesNeededCache.end() ) {
-                *framesNeeded = found->second;
+    if (!cache) {
+        return false;
+    }
+    ActionKey key;
+    key.time = time;
+    key.view = view;
+    key.mipMapLevel = mipMapLevel;
 
-                return true;
-            }
+    FramesNeededCacheMap::const_iterator found = cache->_framesNeededCache.find(key);
+    if ( found != cache->_framesNeededCache.end() ) {
+        *framesNeeded = found->second;
 
-            return false;
-        }
+        return true;
     }
 
     return false;
@@ -316,16 +331,15 @@ ActionsCache::getTimeDomainResult(U64 hash,
 {
     QMutexLocker l(&_cacheMutex);
 
-    for (std::list<ActionsCacheInstance>::iterator it = _instances.begin(); it != _instances.end(); ++it) {
-        if ( (it->_hash == hash) && it->_timeDomainSet ) {
-            *first = it->_timeDomain.min;
-            *last = it->_timeDomain.max;
+    ActionsCacheInstance* cache = findActionCache(hash);
 
-            return true;
-        }
+    if ( !cache || !cache->_timeDomainSet ) {
+        return false;
     }
+    *first = cache->_timeDomain.min;
+    *last = cache->_timeDomain.max;
 
-    return false;
+    return true;
 }
 
 void
@@ -432,7 +446,7 @@ EffectInstance::Implementation::Implementation(EffectInstance* publicInterface)
     , mustSyncPrivateData(false)
 {
     tlsData = boost::make_shared<TLSHolder<EffectTLSData> >();
-    actionsCache = boost::make_shared<ActionsCache>(appPTR->getHardwareIdealThreadCount() * 2);
+    actionsCache = boost::make_shared<ActionsCache>( std::max(appPTR->getHardwareIdealThreadCount() * 2, NATRON_ACTIONS_CACHE_MIN_HASHES) );
 }
 
 EffectInstance::Implementation::Implementation(const Implementation& other)
@@ -627,12 +641,16 @@ EffectInstance::Implementation::waitForImageBeingRenderedElsewhere(const RectI &
     bool ab = _publicInterface->aborted();
 
     QMutexLocker kk(&ibr->lock);
-    while (!ab && isBeingRenderedElseWhere && !ibr->failed && ibr->refCount > 1) {
-        ibr->cond.wait(&ibr->lock, 50);
-        restToRender.clear();
-        isBeingRenderedElseWhere = false;
-        img->getRestToRender_trimap(roi, restToRender, &isBeingRenderedElseWhere);
-        ab = _publicInterface->aborted();
+    if (!ab && isBeingRenderedElseWhere && !ibr->failed && ibr->refCount > 1) {
+        ///While this thread sleeps, let the thread pool run its tasks on another thread so that the core is not left idle
+        ThreadPoolWaitScope waitScope( QThread::currentThread() );
+        do {
+            ibr->cond.wait(&ibr->lock, 50);
+            restToRender.clear();
+            isBeingRenderedElseWhere = false;
+            img->getRestToRender_trimap(roi, restToRender, &isBeingRenderedElseWhere);
+            ab = _publicInterface->aborted();
+        } while (!ab && isBeingRenderedElseWhere && !ibr->failed && ibr->refCount > 1);
     }
     ///Everything should be rendered now unless we are aborted
     return restToRender.empty() && !ibr->failed && !ab;
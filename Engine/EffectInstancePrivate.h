@@ -47,6 +47,9 @@
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
 
+//Minimum number of distinct hashes whose action results (RoD, identity, frames needed...) are kept per effect
+#define NATRON_ACTIONS_CACHE_MIN_HASHES 32
+
 NATRON_NAMESPACE_ENTER
 
 struct ActionKey
@@ -159,10 +162,19 @@ private:
         ActionsCacheInstance();
     };
 
-    //In  a list to track the LRU
-    std::list<ActionsCacheInstance> _instances;
+    typedef std::list<ActionsCacheInstance> ActionsCacheInstancesList;
+    typedef std::map<U64, ActionsCacheInstancesList::iterator> ActionsCacheInstancesIndex;
+
+    // In a list to track the LRU: the most recently used hash is at the back.
+    // Results are only dropped when their hash is evicted or when the cache is cleared, so going back to
+    // a previous hash (e.g: toggling a parameter back and forth) finds them again.
+    ActionsCacheInstancesList _instances;
+    ActionsCacheInstancesIndex _instancesIndex;
     std::size_t _maxInstances;
-    std::list<ActionsCacheInstance>::iterator createActionCacheInternal(U64 newHash);
+    ActionsCacheInstancesList::iterator createActionCacheInternal(U64 newHash);
+
+    /// Returns the instance for the given hash, or NULL. The instance found is marked as most recently used.
+    ActionsCacheInstance* findActionCache(U64 hash);
     ActionsCacheInstance & getOrCreateActionCache(U64 newHash);
 };
 
@@ -56,8 +56,10 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/BlockingBackgroundRender.h"
 #include "Engine/DiskCacheNode.h"
 #include "Engine/Cache.h"
+#include "Engine/Hash64.h"
 #include "Engine/Image.h"
 #include "Engine/ImageParams.h"
+#include "Engine/ImageResampler.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/Log.h"
@@ -65,12 +67,15 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/OfxImageEffectInstance.h"
+#include "Engine/OutputEffectInstance.h"
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/OSGLContext.h"
 #include "Engine/GPUContextPool.h"
 #include "Engine/PluginMemory.h"
 #include "Engine/Project.h"
 #include "Engine/RenderStats.h"
+#include "Engine/PerfCounters.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/Settings.h"
@@ -342,6 +347,9 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
         return _imp->mainInstance->renderRoI(args, outputPlanes);
     }
 
+    RenderTraceScope traceScope("render", "renderRoI", this);
+    PerfCounters::increment(ePerfCounterRenderRoICalls);
+
     //Create the TLS data for this node if it did not exist yet
     EffectTLSDataPtr tls = _imp->tlsData->getOrCreateTLSData();
     assert(tls);
@@ -501,6 +509,9 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
     }
     const std::list<ImagePlaneDesc> & outputComponents = foundOutputNeededComps->second;
 
+    // Only process the channels needed downstream, e.g the channel displayed by the viewer
+    const bool processChannelsRestricted = restrictProcessChannelsForCurrentRender(&processChannels);
+
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     ////////////////////////////// Handle pass-through for planes //////////////////////////////////////////////////////////
     std::list<ImagePlaneDesc> requestedComponents;
@@ -569,7 +580,7 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
         bool identity;
         RectI pixelRod;
         rod.toPixelEnclosing(args.mipMapLevel, par, &pixelRod);
-        ViewInvarianceLevel viewInvariance = isViewInvariant();
+        ViewInvarianceLevel viewInvariance = getCurrentRenderViewInvariance();
 
         if ( (args.view != 0) && (viewInvariance == eViewInvarianceAllViewsInvariant) ) {
             identity = true;
@@ -676,6 +687,9 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
                 } else {
                     /// This corresponds to choice A)
                     inputArgs->components = requestedComponents;
+
+                    // The planes are passed as-is: also skip the pass-through nodes upstream
+                    inputEffectIdentity = resolvePassThroughInput(inputEffectIdentity, &inputArgs->time, &inputArgs->view);
                 }
 
 
@@ -901,8 +915,19 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
         renderScaleOneUpstreamIfRenderScaleSupportDisabled = true;
     }
 
+    // When some channels are not processed they are copied from the source image: such an image must not be shared
+    // with renders of all channels
+    U64 keyHash = nodeHash;
+    if (processChannelsRestricted) {
+        Hash64 hash;
+        hash.append(nodeHash);
+        hash.append( (U64)processChannels.to_ulong() );
+        hash.computeHash();
+        keyHash = hash.value();
+    }
+
     boost::scoped_ptr<ImageKey> key( new ImageKey(getNode().get(),
-                                                  nodeHash,
+                                                  keyHash,
                                                   isFrameVaryingOrAnimated,
                                                   args.time,
                                                   args.view,
@@ -910,7 +935,7 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
                                                   draftModeSupported && frameArgs->draftMode,
                                                   renderMappedMipMapLevel == 0 && !renderScaleOneUpstreamIfRenderScaleSupportDisabled) );
     boost::scoped_ptr<ImageKey> nonDraftKey( new ImageKey(getNode().get(),
-                                                          nodeHash,
+                                                          keyHash,
                                                           isFrameVaryingOrAnimated,
                                                           args.time,
                                                           args.view,
@@ -929,6 +954,10 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
     getMetadataComponents(-1, &outputClipPrefComps, &outputClipPrefCompsPaired);
     ImagePlanesToRenderPtr planesToRender = boost::make_shared<ImagePlanesToRender>();
     planesToRender->useOpenGL = storage == eStorageModeGLTex;
+    if ( !planesToRender->useOpenGL && getNode()->getCurrentCanTransform() ) {
+        // The tiles resampled by the host share the mipmaps of their sources
+        planesToRender->resamplerMipMaps = boost::make_shared<ResamplerMipMapCache>();
+    }
     FramesNeededMapPtr framesNeeded = boost::make_shared<FramesNeededMap>();
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     ////////////////////////////// Look-up the cache ///////////////////////////////////////////////////////////////
@@ -1022,6 +1051,13 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
 
                     }
                 }
+                if ( !plane.fullscaleImage && !byPassCache && createInCache && (storage == eStorageModeRAM) && !isDuringPaintStroke &&
+                     (renderMappedMipMapLevel == mipMapLevel) ) {
+                    // After a change localized to a region, the image of the previous hash is still valid outside of it:
+                    // only the dirty region is left to render
+                    getImageFromPreviousHashInCache(*nonDraftKey, nodeHash, processChannelsRestricted ? (U64)processChannels.to_ulong() : 0,
+                                                    renderMappedMipMapLevel, rod, args.bitdepth, *it, &plane.fullscaleImage);
+                }
                 
 
             }
@@ -1431,6 +1467,19 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
                                    createInCache,
                                    &it->second.fullscaleImage,
                                    &it->second.downscaleImage);
+
+                // Account the images of this render to the node, to find what uses the memory
+                std::size_t cachedBytes = 0, temporaryBytes = 0;
+                if (it->second.fullscaleImage) {
+                    (createInCache ? cachedBytes : temporaryBytes) += it->second.fullscaleImage->size();
+                }
+                if ( it->second.downscaleImage && (it->second.downscaleImage != it->second.fullscaleImage) ) {
+                    temporaryBytes += it->second.downscaleImage->size();
+                }
+                getNode()->addRenderImagesMemory(cachedBytes, temporaryBytes);
+                if ( frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
+                    frameArgs->stats->addMemoryInfosForNode(getNode(), cachedBytes, temporaryBytes);
+                }
             } else {
                 /*
                  * There might be a situation  where the RoD of the cached image
@@ -1536,11 +1585,10 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
 #endif // NATRON_ENABLE_TRIMAP
     if (!renderAborted && hasSomethingToRender) {
 
-        // eRenderSafetyInstanceSafe means that there is at most one render per instance
-        // NOTE: the per-instance lock should probably be shared between
-        // all clones of the same instance, because an InstanceSafe plugin may assume it is the sole owner of the output image,
-        // and read-write on it.
-        // It is probably safer to assume that several clones may write to the same output image only in the eRenderSafetyFullySafe case.
+        // eRenderSafetyInstanceSafe means that there is at most one render per instance: renders beyond the first one go
+        // through render clones, which getOrCreateRenderInstance() hands out to a single render at a time, so that
+        // parallel frame renders do not queue on this node. Two clones never write the same region of an output image
+        // concurrently since the image regions being rendered are marked as such.
 
         // eRenderSafetyFullySafe means that there is only one render per FRAME : the lock is by image and handled in Node.cpp
         ///locks belongs to an instance)
@@ -1564,7 +1612,14 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
         assert(renderInstance);
 
         if (safety == eRenderSafetyInstanceSafe) {
-            locker.reset( new QMutexLocker( &getNode()->getRenderInstancesSharedMutex() ) );
+            // A render clone is owned by this render only and may render concurrently with the main instance and the
+            // other clones. The main instance is still locked, since it is also what getOrCreateRenderInstance() returns
+            // when the effect cannot be cloned. Writers that need sequential renders encode a single stream: their
+            // clones are locked too.
+            bool isConcurrentClone = renderInstance.get() != this && ( !isWriter() || getSequentialPreference() != eSequentialPreferenceOnlySequential );
+            if (!isConcurrentClone) {
+                locker.reset( new QMutexLocker( &getNode()->getRenderInstancesSharedMutex() ) );
+            }
         } else if (safety == eRenderSafetyUnsafe) {
             const Plugin* p = getNode()->getPlugin();
             assert(p);
@@ -1578,7 +1633,13 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
         ///For eRenderSafetyFullySafe, don't take any lock, the image already has a lock on itself so we're sure it can't be written to by 2 different threads.
 
         if ( frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
-            frameArgs->stats->setGlobalRenderInfosForNode(getNode(), rod, planesToRender->outputPremult, processChannels, frameArgs->tilesSupported, !renderFullScaleThenDownscale, renderMappedMipMapLevel);
+            frameArgs->stats->setGlobalRenderInfosForNode(getNode(), rod, planesToRender->outputPremult, processChannels, frameArgs->tilesSupported, !renderFullScaleThenDownscale, renderMappedMipMapLevel, safety);
+            for (FramesNeededMap::const_iterator itNeeded = framesNeeded->begin(); itNeeded != framesNeeded->end(); ++itNeeded) {
+                EffectInstancePtr input = getInput(itNeeded->first);
+                if (input) {
+                    frameArgs->stats->addInputDependencyForNode( getNode(), input->getNode() );
+                }
+            }
         }
 
 # ifdef DEBUG
@@ -1787,6 +1848,14 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
             }
         }
         assert(comp);
+
+        // Keep the textures rendered on the GPU in the VRAM cache of the context, so that a later render needing them
+        // in a texture does not render them again nor read them back
+        if ( glContextLocker && (it->second.downscaleImage->getStorageMode() == eStorageModeGLTex) ) {
+            glContextLocker->attach();
+            glContextLocker->getContext()->insertCachedTexture(it->second.downscaleImage);
+        }
+
         ///The image might need to be converted to fit the original requested format
         if (comp) {
             it->second.downscaleImage = convertPlanesFormatsIfNeeded(getApp(), it->second.downscaleImage, originalRoI, *comp, args.bitdepth, useAlpha0ForRGBToRGBAConversion, planesToRender->outputPremult, -1);
@@ -1831,6 +1900,19 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     ////////////////// End requested format conversion ////////////////////////////////////////////////////////////////////
 
+    ///The images of a node that is not frame varying are the same for all frames of a sequence rendered on disk:
+    ///keep them referenced until the end of the render so that they are not evicted from the cache and rendered again.
+    if ( !isFrameVaryingOrAnimated && createInCache && (renderRetCode != eRenderRoIStatusRenderFailed) && frameArgs->treeRoot ) {
+        OutputEffectInstance* output = dynamic_cast<OutputEffectInstance*>( frameArgs->treeRoot->getEffectInstance().get() );
+        if ( output && (output != this) ) {
+            for (std::map<ImagePlaneDesc, EffectInstance::PlaneToRender>::iterator it = planesToRender->planes.begin(); it != planesToRender->planes.end(); ++it) {
+                if ( it->second.fullscaleImage && it->second.fullscaleImage->getCacheAPI() ) {
+                    output->pinImageForSequentialRender(it->second.fullscaleImage);
+                }
+            }
+        }
+    }
+
 
     ///// Termination
 #ifdef DEBUG
@@ -2002,7 +2084,12 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
                                                                                      *tiledArgs,
                                                                                      _1,
                                                                                      currentThread) );
-            ret.waitForFinished();
+            {
+                // This thread is often itself a thread of the pool rendering a downstream node: let the pool use its slot
+                // while it waits, otherwise nested renders park pool threads and the rectangles wait for a free thread.
+                ThreadPoolWaitScope waitScope(currentThread);
+                ret.waitForFinished();
+            }
             QFuture<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
 
 #endif
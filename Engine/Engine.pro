@@ -77,6 +77,7 @@ SOURCES += \
     BlockingBackgroundRender.cpp \
     CLArgs.cpp \
     Cache.cpp \
+    CacheCompression.cpp \
     CoonsRegularization.cpp \
     CreateNodeArgs.cpp \
     Curve.cpp \
@@ -104,12 +105,14 @@ SOURCES += \
     HistogramCPU.cpp \
     HostOverlaySupport.cpp \
     Image.cpp \
+    ImageBufferPool.cpp \
     ImageConvert.cpp \
     ImageCopyChannels.cpp \
     ImageKey.cpp \
     ImageMaskMix.cpp \
     ImageParamsSerialization.cpp \
     ImagePlaneDesc.cpp \
+    ImageResampler.cpp \
     Interpolation.cpp \
     JoinViewsNode.cpp \
     Knob.cpp \
@@ -137,6 +140,8 @@ SOURCES += \
     Noise.cpp \
     NonKeyParams.cpp \
     NonKeyParamsSerialization.cpp \
+    NumaInfo.cpp \
+    NumericExpression.cpp \
     OSGLContext.cpp \
     OSGLContext_mac.cpp \
     OSGLContext_win.cpp \
@@ -149,9 +154,11 @@ SOURCES += \
     OfxOverlayInteract.cpp \
     OfxParamInstance.cpp \
     OneViewNode.cpp \
+    OutOfCoreStorage.cpp \
     OutputEffectInstance.cpp \
     OutputSchedulerThread.cpp \
     ParallelRenderArgs.cpp \
+    PerfCounters.cpp \
     Plugin.cpp \
     PluginMemory.cpp \
     PrecompNode.cpp \
@@ -168,9 +175,12 @@ SOURCES += \
     PySideCompat.cpp \
     PyTracker.cpp \
     ReadNode.cpp \
+    ReaderProbeCache.cpp \
     RectD.cpp \
     RectI.cpp \
+    RenderRequestRecorder.cpp \
     RenderStats.cpp \
+    RenderTrace.cpp \
     RotoContext.cpp \
     RotoDrawableItem.cpp \
     RotoItem.cpp \
@@ -273,6 +283,7 @@ HEADERS += \
     BufferableObject.h \
     CLArgs.h \
     Cache.h \
+    CacheCompression.h \
     CacheEntry.h \
     CacheEntryHolder.h \
     CacheSerialization.h \
@@ -311,11 +322,13 @@ HEADERS += \
     HistogramCPU.h \
     HostOverlaySupport.h \
     Image.h \
+    ImageBufferPool.h \
     ImageKey.h \
     ImageLocker.h \
     ImageParams.h \
     ImageParamsSerialization.h \
     ImagePlaneDesc.h \
+    ImageResampler.h \
     ImageSerialization.h \
     Interpolation.h \
     JoinViewsNode.h \
@@ -336,6 +349,7 @@ HEADERS += \
     MemoryFile.h \
     MemoryInfo.h \
     MergingEnum.h \
+    MPSCQueue.h \
     NoOpBase.h \
     Node.h \
     NodeGraphI.h \
@@ -349,6 +363,8 @@ HEADERS += \
     NoiseTables.h \
     NonKeyParams.h \
     NonKeyParamsSerialization.h \
+    NumaInfo.h \
+    NumericExpression.h \
     OSGLContext.h \
     OSGLContext_mac.h \
     OSGLContext_win.h \
@@ -362,10 +378,12 @@ HEADERS += \
     OfxParamInstance.h \
     OneViewNode.h \
     OpenGLViewerI.h \
+    OutOfCoreStorage.h \
     OutputEffectInstance.h \
     OutputSchedulerThread.h \
     OverlaySupport.h \
     ParallelRenderArgs.h \
+    PerfCounters.h \
     Plugin.h \
     PluginActionShortcut.h \
     PluginMemory.h \
@@ -384,11 +402,15 @@ HEADERS += \
     PyTracker.h \
     Pyside_Engine_Python.h \
     ReadNode.h \
+    ReaderProbeCache.h \
     RectD.h \
     RectDSerialization.h \
     RectI.h \
     RectISerialization.h \
+    Region.h \
+    RenderRequestRecorder.h \
     RenderStats.h \
+    RenderTrace.h \
     RotoContext.h \
     RotoContextPrivate.h \
     RotoContextSerialization.h \
@@ -61,6 +61,7 @@ class QNetworkReply;
 class QNetworkRequest;
 class QProcess;
 class QSettings;
+class QSharedMemory;
 class QString;
 class QStringList;
 class QThread;
@@ -143,6 +144,7 @@ class FileSystemItem;
 class FileSystemModel;
 class Format;
 class FrameEntry;
+class FrameRequestPlanCache;
 class FrameKey;
 class FrameParams;
 class FramebufferConfig;
@@ -236,6 +238,7 @@ class RectI;
 class RenderEngine;
 class RenderStats;
 class RenderingFlagSetter;
+class ResamplerMipMapCache;
 class RotoContext;
 class RotoDrawableItem;
 class RotoItem;
@@ -402,6 +405,7 @@ typedef boost::shared_ptr<Project> ProjectPtr;
 typedef boost::shared_ptr<RenderEngine> RenderEnginePtr;
 typedef boost::shared_ptr<RenderStats> RenderStatsPtr;
 typedef boost::shared_ptr<RenderingFlagSetter> RenderingFlagSetterPtr;
+typedef boost::shared_ptr<ResamplerMipMapCache> ResamplerMipMapCachePtr;
 typedef boost::shared_ptr<RotoContext> RotoContextPtr;
 typedef boost::shared_ptr<RotoDrawableItem> RotoDrawableItemPtr;
 typedef boost::shared_ptr<RotoItem const> RotoItemConstPtr;
@@ -26,6 +26,8 @@
 #include "FileSystemModel.h"
 
 #include <vector>
+#include <list>
+#include <map>
 #include <cassert>
 #include <stdexcept>
 
@@ -100,6 +102,114 @@ getSplitPath(const QString& path)
     return splitPath;
 }
 
+// Number of directory listings kept in memory and shared by all the file dialogs
+#define NATRON_FILE_SYSTEM_MODEL_LISTING_CACHE_SIZE 32
+
+// A listing is not cached if the directory was modified less than this number of seconds ago, because the
+// modification time resolution of some file systems would not let us notice an entry created right after
+#define NATRON_FILE_SYSTEM_MODEL_LISTING_MIN_AGE_SECS 2
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief Listing the entries of a directory stats every file, which takes a long time on network storage
+ * for directories with large image sequences. The listing is kept as long as the directory modification time
+ * does not change, so that browsing back to a directory or reopening a file dialog does not list it again.
+ **/
+struct DirectoryListing
+{
+    QDateTime lastModified;
+    QDir::Filters filters;
+    QDir::SortFlags sort;
+    QFileInfoList entries;
+};
+
+typedef std::map<QString, DirectoryListing> DirectoryListingMap;
+
+struct DirectoryListingCache
+{
+    QMutex lock;
+    DirectoryListingMap listings;
+    std::list<QString> lru; // most recently used last
+};
+
+DirectoryListingCache directoryListingCache;
+
+void
+touchDirectoryListing(const QString& path)
+{
+    std::list<QString>& lru = directoryListingCache.lru;
+    for (std::list<QString>::iterator it = lru.begin(); it != lru.end(); ++it) {
+        if (*it == path) {
+            lru.erase(it);
+            break;
+        }
+    }
+    lru.push_back(path);
+}
+
+QFileInfoList
+listDirectory(const QDir& dir,
+              QDir::Filters filters,
+              QDir::SortFlags sort)
+{
+    QString path = dir.absolutePath();
+    QDateTime lastModified = QFileInfo(path).lastModified();
+    {
+        QMutexLocker k(&directoryListingCache.lock);
+        DirectoryListingMap::iterator found = directoryListingCache.listings.find(path);
+        if ( (found != directoryListingCache.listings.end()) && (found->second.lastModified == lastModified) &&
+             (found->second.filters == filters) && (found->second.sort == sort) ) {
+            touchDirectoryListing(path);
+
+            return found->second.entries;
+        }
+    }
+
+    QFileInfoList entries = dir.entryInfoList(filters, sort);
+    if ( !lastModified.isValid() || (lastModified.secsTo( QDateTime::currentDateTime() ) < NATRON_FILE_SYSTEM_MODEL_LISTING_MIN_AGE_SECS) ) {
+        return entries;
+    }
+
+    QMutexLocker k(&directoryListingCache.lock);
+    DirectoryListing& listing = directoryListingCache.listings[path];
+    listing.lastModified = lastModified;
+    listing.filters = filters;
+    listing.sort = sort;
+    listing.entries = entries;
+    touchDirectoryListing(path);
+    while ( (int)directoryListingCache.lru.size() > NATRON_FILE_SYSTEM_MODEL_LISTING_CACHE_SIZE ) {
+        directoryListingCache.listings.erase( directoryListingCache.lru.front() );
+        directoryListingCache.lru.pop_front();
+    }
+
+    return entries;
+}
+
+/**
+ * @brief Drops the cached listing of a directory whose files changed without changing the directory
+ * modification time (e.g: a file was rewritten).
+ **/
+void
+invalidateDirectoryListing(const QString& path)
+{
+    QString absolutePath = QDir(path).absolutePath();
+    QMutexLocker k(&directoryListingCache.lock);
+    DirectoryListingMap::iterator found = directoryListingCache.listings.find(absolutePath);
+
+    if ( found != directoryListingCache.listings.end() ) {
+        directoryListingCache.listings.erase(found);
+        for (std::list<QString>::iterator it = directoryListingCache.lru.begin(); it != directoryListingCache.lru.end(); ++it) {
+            if (*it == absolutePath) {
+                directoryListingCache.lru.erase(it);
+                break;
+            }
+        }
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 struct FileSystemModelPrivate
 {
     FileSystemModel* _publicInterface;
@@ -1285,6 +1395,7 @@ FileSystemModel::onDirectoryLoadedByGatherer(const QString& directory)
 void
 FileSystemModel::onWatchedDirectoryChanged(const QString& directory)
 {
+    invalidateDirectoryListing(directory);
     FileSystemItemPtr item = _imp->getItemFromPath(directory);
 
     if (item) {
@@ -1321,6 +1432,7 @@ FileSystemModel::onWatchedFileChanged(const QString& file)
 {
     ///Get the item corresponding to the current directory
     QFileInfo info(file);
+    invalidateDirectoryListing( info.absolutePath() );
     FileSystemItemPtr parent = _imp->getItemFromPath( info.absolutePath() );
 
     if (parent) {
@@ -1622,7 +1734,7 @@ FileGathererThread::gatheringKernel(const FileSystemItemPtr& item)
     sort |= QDir::DirsFirst;
 
     ///All entries in the directory
-    QFileInfoList all = dir.entryInfoList(model->filter(), sort);
+    QFileInfoList all = listDirectory(dir, model->filter(), sort);
 
     ///List of all possible file sequences in the directory or directories
     FileSequences sequences;
@@ -29,6 +29,12 @@
 #include <cassert>
 #include <stdexcept>
 
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/bind.hpp>
+#endif
+
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+
 #ifndef M_PI_2
 #define M_PI_2      1.57079632679489661923132169163975144   /* pi/2           */
 #endif
@@ -618,5 +624,30 @@ FitCurve::fit_cubic(const std::vector<Point>& points,
     }
 } // FitCurve::fit_cubic
 
+static void
+fitCubicFunctor(const std::vector<std::vector<Point> >* pointSets,
+                double error,
+                std::vector<std::vector<SimpleBezierCP> >* generatedBeziers,
+                int index)
+{
+    fit_cubic( (*pointSets)[index], error, &(*generatedBeziers)[index] );
+}
+
+void
+FitCurve::fit_cubic_batch(const std::vector<std::vector<Point> >& pointSets,
+                          double error,
+                          std::vector<std::vector<SimpleBezierCP> >* generatedBeziers)
+{
+    generatedBeziers->clear();
+    generatedBeziers->resize( pointSets.size() );
+
+    // Each set writes only to its own output vector
+    std::vector<int> indices( pointSets.size() );
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = (int)i;
+    }
+    QtConcurrent::blockingMap( indices, boost::bind(&fitCubicFunctor, &pointSets, error, generatedBeziers, _1) );
+}
+
 NATRON_NAMESPACE_EXIT
 
@@ -53,6 +53,12 @@ struct SimpleBezierCP
  * @param generatedBezier[out] The fitted bezier generated
  **/
 void fit_cubic(const std::vector<Point>& points, double error, std::vector<SimpleBezierCP>* generatedBezier);
+
+/**
+ * @brief Same as fit_cubic for each set of points, the sets being fitted concurrently in the global thread pool.
+ * @param generatedBeziers[out] Resized to the number of sets: the i-th bezier is fitted to the i-th set of points
+ **/
+void fit_cubic_batch(const std::vector<std::vector<Point> >& pointSets, double error, std::vector<std::vector<SimpleBezierCP> >* generatedBeziers);
 }
 
 NATRON_NAMESPACE_EXIT
@@ -25,10 +25,65 @@
 
 #include "GLShader.h"
 
+#include <string>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QString>
+#include <QtCore/QThread>
+
 #include "Global/GLIncludes.h"
 
+#include "Engine/AppManager.h"
+#include "Engine/Hash64.h"
+
+// Linked programs are stored in this sub-directory of the disk cache location, one file per program
+#define NATRON_GL_PROGRAM_CACHE_DIR "GLProgramsCache"
+
+// Bump whenever the layout of the program binary files changes
+#define NATRON_GL_PROGRAM_CACHE_FORMAT_VERSION 1
+
 NATRON_NAMESPACE_ENTER
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief Program binaries are only valid for the driver that produced them: they are keyed by the
+ * vendor, renderer and version strings of the current context as well as the shaders sources.
+ * Returns an empty string if the program binaries may not be cached.
+ **/
+QString
+getProgramBinaryFilePath(const std::string& vertexSource,
+                         const std::string& fragmentSource)
+{
+    if ( !GLAD_GL_ARB_get_program_binary || !appPTR ) {
+        return QString();
+    }
+    const char* vendor = (const char*)glGetString(GL_VENDOR);
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if (!vendor || !renderer || !version) {
+        return QString();
+    }
+
+    Hash64 hash;
+    Hash64_appendQString( &hash, QString::fromUtf8(vendor) );
+    Hash64_appendQString( &hash, QString::fromUtf8(renderer) );
+    Hash64_appendQString( &hash, QString::fromUtf8(version) );
+    Hash64_appendQString( &hash, QString::fromUtf8( vertexSource.c_str() ) );
+    hash.append(0);
+    Hash64_appendQString( &hash, QString::fromUtf8( fragmentSource.c_str() ) );
+    hash.computeHash();
+
+    return appPTR->getDiskCacheLocation() + QString::fromUtf8("/" NATRON_GL_PROGRAM_CACHE_DIR "/") +
+           QString::number(hash.value(), 16) + QString::fromUtf8(".bin");
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 struct GLShaderPrivate
 {
     GLuint shaderID;
@@ -37,6 +92,10 @@ struct GLShaderPrivate
     bool vertexAttached, fragmentAttached;
     bool firstTime;
 
+    // When program binaries can be cached, compilation is deferred to link() so that it can be skipped entirely
+    bool deferCompilation;
+    std::string vertexSource, fragmentSource;
+
     GLShaderPrivate()
         : shaderID(0)
         , vertexID(0)
@@ -44,9 +103,18 @@ struct GLShaderPrivate
         , vertexAttached(false)
         , fragmentAttached(false)
         , firstTime(true)
+        , deferCompilation(GLAD_GL_ARB_get_program_binary != 0)
+        , vertexSource()
+        , fragmentSource()
     {
     }
 
+    bool compileShader(GLShader::ShaderTypeEnum type, const char* src, std::string* error);
+
+    bool loadProgramBinary(const QString& filePath);
+
+    void saveProgramBinary(const QString& filePath);
+
     void getShaderInfoLog(GLuint shader,
                           std::string* error)
     {
@@ -91,13 +159,31 @@ GLShader::addShader(GLShader::ShaderTypeEnum type,
         _imp->shaderID = glCreateProgram();
     }
 
+    if (_imp->deferCompilation) {
+        if (type == eShaderTypeVertex) {
+            _imp->vertexSource = src;
+        } else {
+            _imp->fragmentSource = src;
+        }
+
+        return true;
+    }
+
+    return _imp->compileShader(type, src, error);
+}
+
+bool
+GLShaderPrivate::compileShader(GLShader::ShaderTypeEnum type,
+                               const char* src,
+                               std::string* error)
+{
     GLuint shader = 0;
-    if (type == eShaderTypeVertex) {
-        _imp->vertexID = glCreateShader(GL_VERTEX_SHADER);
-        shader = _imp->vertexID;
-    } else if (type == eShaderTypeFragment) {
-        _imp->fragmentID = glCreateShader(GL_FRAGMENT_SHADER);
-        shader = _imp->fragmentID;
+    if (type == GLShader::eShaderTypeVertex) {
+        vertexID = glCreateShader(GL_VERTEX_SHADER);
+        shader = vertexID;
+    } else if (type == GLShader::eShaderTypeFragment) {
+        fragmentID = glCreateShader(GL_FRAGMENT_SHADER);
+        shader = fragmentID;
     } else {
         assert(false);
     }
@@ -108,22 +194,86 @@ GLShader::addShader(GLShader::ShaderTypeEnum type,
     glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
     if (isCompiled == GL_FALSE) {
         if (error) {
-            _imp->getShaderInfoLog(shader, error);
+            getShaderInfoLog(shader, error);
         }
 
         return false;
     }
 
-    glAttachShader(_imp->shaderID, shader);
-    if (type == eShaderTypeVertex) {
-        _imp->vertexAttached = true;
+    glAttachShader(shaderID, shader);
+    if (type == GLShader::eShaderTypeVertex) {
+        vertexAttached = true;
     } else {
-        _imp->fragmentAttached = true;
+        fragmentAttached = true;
+    }
+
+    return true;
+}
+
+bool
+GLShaderPrivate::loadProgramBinary(const QString& filePath)
+{
+    QFile file(filePath);
+
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+    QDataStream ds(&file);
+    qint32 formatVersion = 0;
+    quint32 binaryFormat = 0;
+    QByteArray binary;
+    ds >> formatVersion >> binaryFormat >> binary;
+    if ( (ds.status() != QDataStream::Ok) || (formatVersion != NATRON_GL_PROGRAM_CACHE_FORMAT_VERSION) || binary.isEmpty() ) {
+        return false;
+    }
+
+    glProgramBinary( shaderID, (GLenum)binaryFormat, binary.constData(), (GLsizei)binary.size() );
+    GLint isLinked;
+    glGetProgramiv(shaderID, GL_LINK_STATUS, &isLinked);
+    if (isLinked == GL_FALSE) {
+        // The driver was updated and rejects the binary: it will be compiled and cached again
+        file.close();
+        QFile::remove(filePath);
+
+        return false;
     }
 
     return true;
 }
 
+void
+GLShaderPrivate::saveProgramBinary(const QString& filePath)
+{
+    GLint length = 0;
+
+    glGetProgramiv(shaderID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    QByteArray binary(length, 0);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(shaderID, length, &length, &binaryFormat, binary.data());
+    if (length <= 0) {
+        return;
+    }
+    binary.resize(length);
+
+    // Several contexts may build the same program concurrently: write to a file of our own and move it in place
+    QDir().mkpath( QFileInfo(filePath).absolutePath() );
+    QString tmpFilePath = filePath + QString::fromUtf8(".") + QString::number( (quint64)(quintptr)QThread::currentThreadId() );
+    {
+        QFile file(tmpFilePath);
+        if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+            return;
+        }
+        QDataStream ds(&file);
+        ds << (qint32)NATRON_GL_PROGRAM_CACHE_FORMAT_VERSION << (quint32)binaryFormat << binary;
+    }
+    if ( !QFile::rename(tmpFilePath, filePath) ) {
+        QFile::remove(tmpFilePath);
+    }
+}
+
 void
 GLShader::bind()
 {
@@ -133,6 +283,23 @@ GLShader::bind()
 bool
 GLShader::link(std::string* error)
 {
+    QString binaryFilePath;
+    if (_imp->deferCompilation) {
+        binaryFilePath = getProgramBinaryFilePath(_imp->vertexSource, _imp->fragmentSource);
+        if ( !binaryFilePath.isEmpty() && _imp->loadProgramBinary(binaryFilePath) ) {
+            return true;
+        }
+        if ( !_imp->vertexSource.empty() && !_imp->compileShader(eShaderTypeVertex, _imp->vertexSource.c_str(), error) ) {
+            return false;
+        }
+        if ( !_imp->fragmentSource.empty() && !_imp->compileShader(eShaderTypeFragment, _imp->fragmentSource.c_str(), error) ) {
+            return false;
+        }
+        if ( !binaryFilePath.isEmpty() ) {
+            glProgramParameteri(_imp->shaderID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+    }
+
     glLinkProgram(_imp->shaderID);
     GLint isLinked;
     glGetProgramiv(_imp->shaderID, GL_LINK_STATUS, &isLinked);
@@ -144,6 +311,10 @@ GLShader::link(std::string* error)
         return false;
     }
 
+    if ( !binaryFilePath.isEmpty() ) {
+        _imp->saveProgramBinary(binaryFilePath);
+    }
+
     return true;
 }
 
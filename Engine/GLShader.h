@@ -64,6 +64,10 @@ public:
      * When done, the shader is ready to be used. Call bind() to activate the shader
      * and unbind() to deactivate it.
      * To set uniforms, call the setUniform function.
+     *
+     * If the driver supports GL_ARB_get_program_binary, the linked program is cached on disk, keyed by the
+     * renderer and the shaders sources, and the compilation is deferred to link(): compilation errors are then
+     * reported by link() and not by addShader().
      **/
     GLShader();
 
@@ -25,6 +25,9 @@
 
 #include "GPUContextPool.h"
 
+#include <algorithm> // min, max
+#include <iterator> // advance
+#include <list>
 #include <set>
 #include <stdexcept>
 
@@ -32,6 +35,9 @@
 
 #include <QMutex>
 #include <QWaitCondition>
+#include <QtCore/QDebug>
+#include <QtCore/QFuture>
+#include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
 
 #include "Engine/AppManager.h"
 #include "Engine/OSGLContext.h"
@@ -58,6 +64,9 @@ struct GPUContextPoolPrivate
 
     int currentOpenGLRendererMaxTexSize;
 
+    // The contexts pre-warming started by prewarmGLContextsInBackground()
+    QFuture<void> prewarmFuture;
+
 
     GPUContextPoolPrivate()
         : contextPoolMutex()
@@ -70,7 +79,93 @@ struct GPUContextPoolPrivate
 #endif
         , glShareContext()
         , currentOpenGLRendererMaxTexSize(0)
+        , prewarmFuture()
+    {
+    }
+
+    /**
+     * @brief The number of contexts the pool may create, and how many of them share the memory of a device.
+     **/
+    static int getMaxContexts(const SettingsPtr& settings,
+                              int* contextsPerRenderer)
+    {
+        const bool multiGPU = settings && settings->isMultiGPURenderingEnabled();
+        int maxContexts = settings ? std::max(settings->getMaxOpenGLContexts(), 1) : 1;
+
+        if (multiGPU) {
+            // At least one context per device
+            maxContexts = std::max( maxContexts, (int)appPTR->getOpenGLRenderers().size() );
+        }
+        *contextsPerRenderer = multiGPU ? (maxContexts + (int)appPTR->getOpenGLRenderers().size() - 1) / (int)appPTR->getOpenGLRenderers().size() : maxContexts;
+
+        return maxContexts;
+    }
+
+    /**
+     * @brief Creates the nContextsCreated'th context of the pool. May throw an exception if the context creation failed.
+     **/
+    static OSGLContextPtr createContext(const SettingsPtr& settings,
+                                        int nContextsCreated,
+                                        int contextsPerRenderer,
+                                        const OSGLContext* shareContext)
+    {
+        GLRendererID rendererID = getRendererForNewContext(settings, nContextsCreated);
+        OSGLContextPtr ret = boost::make_shared<OSGLContext>( FramebufferConfig(), shareContext, GLVersion.major, GLVersion.minor, rendererID );
+
+        ret->setTextureCacheMaxSize( getTextureCacheMaxSizePerContext(rendererID, contextsPerRenderer) );
+
+        return ret;
+    }
+
+    int getNumContextsCreated_locked() const
     {
+#ifdef NATRON_RENDER_SHARED_CONTEXT
+        return (int)glContextPool.size();
+#else
+        return (int)( glContextPool.size() + attachedGLContexts.size() );
+#endif
+    }
+
+    void prewarmGLContexts();
+
+    /**
+     * @brief The renderer of the next context created: the active renderer, or with multi-GPU rendering the
+     * renderers in turn, so that contexts (which renders cycle through) are spread evenly across the devices.
+     **/
+    static GLRendererID getRendererForNewContext(const SettingsPtr& settings,
+                                                 int nContextsCreated)
+    {
+        if (!settings) {
+            return GLRendererID();
+        }
+        if ( !settings->isMultiGPURenderingEnabled() ) {
+            return settings->getActiveOpenGLRendererID();
+        }
+        const std::list<OpenGLRendererInfo>& renderers = appPTR->getOpenGLRenderers();
+        assert( !renderers.empty() );
+        std::list<OpenGLRendererInfo>::const_iterator it = renderers.begin();
+        std::advance( it, nContextsCreated % (int)renderers.size() );
+
+        return it->rendererID;
+    }
+
+    /**
+     * @brief The texture cache budget of each context, shared evenly between the contexts the pool may create on the renderer.
+     **/
+    static std::size_t getTextureCacheMaxSizePerContext(const GLRendererID& rendererID, int maxContexts)
+    {
+        std::size_t budget = NATRON_GL_TEXTURE_CACHE_DEFAULT_SIZE;
+        const std::list<OpenGLRendererInfo>& renderers = appPTR->getOpenGLRenderers();
+        for (std::list<OpenGLRendererInfo>::const_iterator it = renderers.begin(); it != renderers.end(); ++it) {
+            if ( (it->rendererID.renderID == rendererID.renderID) && (it->rendererID.rendererHandle == rendererID.rendererHandle) ) {
+                if (it->maxMemBytes > 0) {
+                    budget = it->maxMemBytes / NATRON_GL_TEXTURE_CACHE_GPU_MEMORY_DIVISOR;
+                }
+                break;
+            }
+        }
+
+        return budget / std::max(maxContexts, 1);
     }
 };
 
@@ -81,11 +176,14 @@ GPUContextPool::GPUContextPool()
 
 GPUContextPool::~GPUContextPool()
 {
+    _imp->prewarmFuture.waitForFinished();
 }
 
 void
 GPUContextPool::clear()
 {
+    _imp->prewarmFuture.waitForFinished();
+
     QMutexLocker k(&_imp->contextPoolMutex);
 
     _imp->glContextPool.clear();
@@ -99,6 +197,62 @@ GPUContextPool::getCurrentOpenGLRendererMaxTextureSize() const
     return _imp->currentOpenGLRendererMaxTexSize;
 }
 
+void
+GPUContextPoolPrivate::prewarmGLContexts()
+{
+    SettingsPtr settings = appPTR->getCurrentSettings();
+
+    if ( !settings || !appPTR->isOpenGLLoaded() || !settings->isOpenGLRenderingEnabled() ) {
+        return;
+    }
+
+    int contextsPerRenderer;
+    int maxContexts = getMaxContexts(settings, &contextsPerRenderer);
+
+    for (;;) {
+        int nContextsCreated;
+        {
+            QMutexLocker k(&contextPoolMutex);
+            nContextsCreated = getNumContextsCreated_locked();
+        }
+        if (nContextsCreated >= maxContexts) {
+            return;
+        }
+
+        // Create and warm the context outside of the pool so that renders do not wait for it or use it half-built
+        OSGLContextPtr context;
+        try {
+            context = createContext(settings, nContextsCreated, contextsPerRenderer, 0);
+        } catch (const std::exception& e) {
+            qDebug() << "Could not create OpenGL context:" << e.what();
+
+            return;
+        }
+        context->setContextCurrentNoRender();
+        context->createDefaultShaders();
+        OSGLContext::unsetCurrentContextNoRender();
+
+        QMutexLocker k(&contextPoolMutex);
+        if (getNumContextsCreated_locked() >= maxContexts) {
+            // Renders created the contexts they needed in the meantime
+            return;
+        }
+        glContextPool.insert(context);
+#ifndef NATRON_RENDER_SHARED_CONTEXT
+        glContextPoolEmpty.wakeOne();
+#endif
+    }
+}
+
+void
+GPUContextPool::prewarmGLContextsInBackground()
+{
+    if ( _imp->prewarmFuture.isRunning() ) {
+        return;
+    }
+    _imp->prewarmFuture = QtConcurrent::run(_imp.get(), &GPUContextPoolPrivate::prewarmGLContexts);
+}
+
 OSGLContextPtr
 GPUContextPool::attachGLContextToRender(bool checkIfGLLoaded)
 {
@@ -111,12 +265,11 @@ GPUContextPool::attachGLContextToRender(bool checkIfGLLoaded)
     OSGLContextPtr shareContext;// _imp->glShareContext.lock();
     OSGLContextPtr newContext;
     SettingsPtr settings =  appPTR->getCurrentSettings();
-    GLRendererID rendererID;
-    if (settings) {
-        rendererID = settings->getActiveOpenGLRendererID();
-    }
+    const bool multiGPU = settings && settings->isMultiGPURenderingEnabled();
 
-    int maxContexts = settings ? std::max(settings->getMaxOpenGLContexts(), 1) : 1;
+    // Number of contexts sharing the memory of a device
+    int contextsPerRenderer;
+    int maxContexts = GPUContextPoolPrivate::getMaxContexts(settings, &contextsPerRenderer);
 
 #ifndef NATRON_RENDER_SHARED_CONTEXT
     while (_imp->glContextPool.empty() && (int)_imp->attachedGLContexts.size() >= maxContexts) {
@@ -125,7 +278,7 @@ GPUContextPool::attachGLContextToRender(bool checkIfGLLoaded)
     if ( _imp->glContextPool.empty() ) {
         assert( (int)_imp->attachedGLContexts.size() < maxContexts );
         //  Create a new one
-        newContext = boost::make_shared<OSGLContext>( FramebufferConfig(), shareContext.get(), GLVersion.major, GLVersion.minor, rendererID );
+        newContext = GPUContextPoolPrivate::createContext( settings, (int)_imp->attachedGLContexts.size(), contextsPerRenderer, shareContext.get() );
     } else {
         std::set<OSGLContextPtr>::iterator it = _imp->glContextPool.begin();
         newContext = *it;
@@ -136,7 +289,7 @@ GPUContextPool::attachGLContextToRender(bool checkIfGLLoaded)
 
     if ( (int)_imp->glContextPool.size() < maxContexts ) {
         //  Create a new one
-        newContext = boost::make_shared<OSGLContext>( FramebufferConfig(), shareContext.get(), GLVersion.major, GLVersion.minor, rendererID );
+        newContext = GPUContextPoolPrivate::createContext( settings, (int)_imp->glContextPool.size(), contextsPerRenderer, shareContext.get() );
         _imp->glContextPool.insert(newContext);
     } else {
         while ((int)_imp->glContextPool.size() > maxContexts) {
@@ -170,6 +323,15 @@ GPUContextPool::attachGLContextToRender(bool checkIfGLLoaded)
         if (!_imp->currentOpenGLRendererMaxTexSize) {
             newContext->setContextCurrentNoRender();
             glGetIntegerv(GL_MAX_TEXTURE_SIZE, &_imp->currentOpenGLRendererMaxTexSize);
+            if (multiGPU) {
+                // Any context may be used for a render: textures must not exceed the smallest limit of all devices
+                const std::list<OpenGLRendererInfo>& renderers = appPTR->getOpenGLRenderers();
+                for (std::list<OpenGLRendererInfo>::const_iterator it = renderers.begin(); it != renderers.end(); ++it) {
+                    if (it->maxTextureSize > 0) {
+                        _imp->currentOpenGLRendererMaxTexSize = std::min(_imp->currentOpenGLRendererMaxTexSize, it->maxTextureSize);
+                    }
+                }
+            }
         }
     }
 
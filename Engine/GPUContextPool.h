@@ -40,6 +40,12 @@ NATRON_NAMESPACE_ENTER
 // If set, multiple frame renders may use the same GPU context instead of locking it for the whole render of a frame.
 #define NATRON_RENDER_SHARED_CONTEXT
 
+// The contexts of the pool keep rendered textures in at most 1/NATRON_GL_TEXTURE_CACHE_GPU_MEMORY_DIVISOR of the renderer memory
+#define NATRON_GL_TEXTURE_CACHE_GPU_MEMORY_DIVISOR 4
+
+// Texture cache budget of the pool when the renderer does not report its memory
+#define NATRON_GL_TEXTURE_CACHE_DEFAULT_SIZE (256 * 1024 * 1024)
+
 struct GPUContextPoolPrivate;
 class GPUContextPool
 {
@@ -82,6 +88,13 @@ public:
      **/
     int getCurrentOpenGLRendererMaxTextureSize() const;
 
+    /**
+     * @brief Creates in a separate thread the contexts of the pool, up to the maximum number of contexts
+     * set in the preferences, and builds their default shaders so that the first GPU render does not have to.
+     * The contexts are only made available to renders once they are ready.
+     **/
+    void prewarmGLContextsInBackground();
+
     ////////////////////////////////////////////////////////////////
 
     /**
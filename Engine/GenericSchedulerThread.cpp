@@ -72,11 +72,6 @@ struct GenericSchedulerThreadPrivate
     QWaitCondition mustQuitCond;
     mutable QMutex mustQuitMutex;
 
-    // Positive if a thread enqueued a task with startTask, protected by startRequestsMutex
-    int startRequests;
-    QWaitCondition startRequestsCond;
-    mutable QMutex startRequestsMutex;
-
     // positive when the user wants to stop the thread, protected by abortRequestedMutex
     int abortRequested;
     mutable QMutex abortRequestedMutex;
@@ -90,6 +85,9 @@ struct GenericSchedulerThreadPrivate
     std::list<GenericThreadStartArgsPtr> enqueuedTasks, queuedTaskWhileProcessingAbort;
     mutable QMutex enqueuedTasksMutex;
 
+    // Woken up when a task is enqueued, the thread sleeps on it while both queues are empty
+    QWaitCondition enqueuedTasksCond;
+
     // true when the main-thread is calling executeOnMainThread
     bool executingOnMainThread;
     QWaitCondition executingOnMainThreadCond;
@@ -105,9 +103,6 @@ struct GenericSchedulerThreadPrivate
         , lastQuitThreadAllowedRestart(true)
         , mustQuitCond()
         , mustQuitMutex()
-        , startRequests(0)
-        , startRequestsCond()
-        , startRequestsMutex()
         , abortRequested(0)
         , abortRequestedMutex()
         , abortRequestedCond()
@@ -116,6 +111,7 @@ struct GenericSchedulerThreadPrivate
         , enqueuedTasks()
         , queuedTaskWhileProcessingAbort()
         , enqueuedTasksMutex()
+        , enqueuedTasksCond()
         , executingOnMainThread(false)
         , executingOnMainThreadCond()
         , executingOnMainThreadMutex()
@@ -133,6 +129,18 @@ struct GenericSchedulerThreadPrivate
     // Returns the state of the thread
     GenericSchedulerThread::ThreadStateEnum resolveState();
 
+    // Must be called with enqueuedTasksMutex locked. If only the most recent task is processed, any task
+    // not picked up yet is superseded by the new one, so that the queue never grows and the thread wakes up once.
+    static void enqueueTask(GenericSchedulerThread::TaskQueueBehaviorEnum behavior,
+                            const GenericThreadStartArgsPtr& task,
+                            std::list<GenericThreadStartArgsPtr>* queue)
+    {
+        if (behavior == GenericSchedulerThread::eTaskQueueBehaviorSkipToMostRecent) {
+            queue->clear();
+        }
+        queue->push_back(task);
+    }
+
     bool waitForAbortToComplete_internal(bool allowBlockingForMainThread);
 
     bool waitForThreadsToQuit_internal(bool allowBlockingForMainThread);
@@ -180,20 +188,13 @@ GenericSchedulerThread::quitThread(bool allowRestarts)
     }
 
 
-    // Clear any task enqueued and push a fake request
+    // Clear any task enqueued and wake-up the thread with a fake request
     {
         QMutexLocker k(&_imp->enqueuedTasksMutex);
         _imp->enqueuedTasks.clear();
         GenericThreadStartArgsPtr stubArgs = boost::make_shared<GenericThreadStartArgs>(true);
         _imp->enqueuedTasks.push_back(stubArgs);
-    }
-
-
-    // Wake-up the thread with a fake request
-    {
-        QMutexLocker l3(&_imp->startRequestsMutex);
-        ++_imp->startRequests;
-        _imp->startRequestsCond.wakeOne();
+        _imp->enqueuedTasksCond.wakeOne();
     }
 #ifdef TRACE_GENERIC_SCHEDULER_THREAD
     qDebug() << QThread::currentThread() << ": Termination request on " << getThreadName().c_str();
@@ -435,27 +436,28 @@ GenericSchedulerThread::startTask(const GenericThreadStartArgsPtr& inArgs)
         }
     }
 
+    TaskQueueBehaviorEnum behavior = tasksQueueBehaviour();
     {
         QMutexLocker k1(&_imp->enqueuedTasksMutex);
-        QMutexLocker k2(&_imp->abortRequestedMutex);
+        {
+            QMutexLocker k2(&_imp->abortRequestedMutex);
 #ifdef TRACE_GENERIC_SCHEDULER_THREAD
-        qDebug() << QThread::currentThread() << ": Requesting task on" <<  getThreadName().c_str() << ", is thread aborted?" << (bool)(_imp->abortRequested > 0);
+            qDebug() << QThread::currentThread() << ": Requesting task on" <<  getThreadName().c_str() << ", is thread aborted?" << (bool)(_imp->abortRequested > 0);
 #endif
-        if (_imp->abortRequested > 0) {
-            _imp->queuedTaskWhileProcessingAbort.push_back(inArgs);
-        } else {
-            _imp->enqueuedTasks.push_back(inArgs);
+            if (_imp->abortRequested > 0) {
+                GenericSchedulerThreadPrivate::enqueueTask(behavior, inArgs, &_imp->queuedTaskWhileProcessingAbort);
+            } else {
+                GenericSchedulerThreadPrivate::enqueueTask(behavior, inArgs, &_imp->enqueuedTasks);
+            }
         }
+
+        // Wake up the thread if it is sleeping. If it is working it will pick up the task when done,
+        // superseded requests do not wake it up again
+        _imp->enqueuedTasksCond.wakeOne();
     }
 
     if ( !isRunning() ) {
-        start();
-    } else {
-        ///Wake up the thread with a start request
-        QMutexLocker locker(&_imp->startRequestsMutex);
-        ++_imp->startRequests;
-
-        _imp->startRequestsCond.wakeOne();
+        start( getThreadPriority() );
     }
 
     return true;
@@ -543,46 +545,48 @@ GenericSchedulerThread::run()
         
         // Reset the abort requested flag:
         // If a thread A called abortThreadedTask() multiple times and the scheduler thread B was running in the meantime, it could very well
-        // stop and wait in the startRequestsCond
+        // stop and wait in the enqueuedTasksCond
         {
             QMutexLocker tasksLocker(&_imp->enqueuedTasksMutex);
-            QMutexLocker k(&_imp->abortRequestedMutex);
-            if (state == eThreadStateAborted) {
-                // If the processing was aborted, clear task that were requested prior to the abort flag was passed, and insert the task that were posted
-                // after the abort was requested up until now
+            {
+                QMutexLocker k(&_imp->abortRequestedMutex);
+                if (state == eThreadStateAborted) {
+                    // If the processing was aborted, clear task that were requested prior to the abort flag was passed, and insert the task that were posted
+                    // after the abort was requested up until now
 #ifdef TRACE_GENERIC_SCHEDULER_THREAD
-                qDebug() << getThreadName().c_str() << ": Thread going idle after being aborted. " << _imp->queuedTaskWhileProcessingAbort.size() << "tasks were pushed while abort being processed.";
+                    qDebug() << getThreadName().c_str() << ": Thread going idle after being aborted. " << _imp->queuedTaskWhileProcessingAbort.size() << "tasks were pushed while abort being processed.";
 #endif
-                if (behavior == eTaskQueueBehaviorProcessInOrder) {
-                    _imp->enqueuedTasks.clear();
-                }
-
-                _imp->enqueuedTasks.insert( _imp->enqueuedTasks.end(), _imp->queuedTaskWhileProcessingAbort.begin(), _imp->queuedTaskWhileProcessingAbort.end() );
-                _imp->queuedTaskWhileProcessingAbort.clear();
-            } else {
+                    if (behavior == eTaskQueueBehaviorProcessInOrder) {
+                        _imp->enqueuedTasks.clear();
+                    }
+                } else {
 #ifdef TRACE_GENERIC_SCHEDULER_THREAD
-                qDebug() << getThreadName().c_str() << ": Thread going idle normally.";
+                    qDebug() << getThreadName().c_str() << ": Thread going idle normally.";
 #endif
-            }
-
-            if (_imp->abortRequested > 0) {
-                _imp->abortRequested = 0;
-                _imp->abortRequestedCond.wakeAll();
-            }
-        }
+                }
 
+                // The abort flag may have been raised after this loop resolved its state: the tasks posted since must not be lost
+                if ( !_imp->queuedTaskWhileProcessingAbort.empty() ) {
+                    if (behavior == eTaskQueueBehaviorSkipToMostRecent) {
+                        _imp->enqueuedTasks.clear();
+                    }
+                    _imp->enqueuedTasks.insert( _imp->enqueuedTasks.end(), _imp->queuedTaskWhileProcessingAbort.begin(), _imp->queuedTaskWhileProcessingAbort.end() );
+                    _imp->queuedTaskWhileProcessingAbort.clear();
+                }
 
-        {
-            QMutexLocker l(&_imp->startRequestsMutex);
-            while (_imp->startRequests <= 0) {
-                _imp->startRequestsCond.wait(&_imp->startRequestsMutex);
+                if (_imp->abortRequested > 0) {
+                    _imp->abortRequested = 0;
+                    _imp->abortRequestedCond.wakeAll();
+                }
             }
-            ///We got the request
-            if (_imp->startRequests > 0) {
-                --_imp->startRequests;
+
+            // Sleep until a task is enqueued. Tasks enqueued while this loop was processing are picked up without sleeping.
+            // Tasks enqueued while an abort is pending are moved to the queue by the next loop.
+            while ( _imp->enqueuedTasks.empty() && _imp->queuedTaskWhileProcessingAbort.empty() ) {
+                _imp->enqueuedTasksCond.wait(&_imp->enqueuedTasksMutex);
             }
 #ifdef TRACE_GENERIC_SCHEDULER_THREAD
-            qDebug() << getThreadName().c_str() << ": Received start request, startRequest = " << _imp->startRequests;
+            qDebug() << getThreadName().c_str() << ": Received start request, enqueued tasks = " << _imp->enqueuedTasks.size();
 #endif
         }
     } // for (;;)
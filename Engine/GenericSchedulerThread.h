@@ -263,6 +263,11 @@ protected:
      **/
     virtual TaskQueueBehaviorEnum tasksQueueBehaviour() const = 0;
 
+    /**
+     * @brief The priority with which the thread is started. Threads that respond to user interaction may raise it.
+     **/
+    virtual QThread::Priority getThreadPriority() const { return QThread::InheritPriority; }
+
     /**
      * @brief Called whenever abort is requested
      **/
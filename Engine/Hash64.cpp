@@ -25,13 +25,9 @@
 
 #include "Hash64.h"
 
-#include <algorithm>  // for std::for_each
 #include <cassert>
 #include <stdexcept>
 
-#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
-#include <boost/crc.hpp>
-#endif
 #include <QtCore/QString>
 
 #include "Engine/Node.h"
@@ -41,21 +37,28 @@ NATRON_NAMESPACE_ENTER
 void
 Hash64::computeHash()
 {
-    if ( node_values.empty() ) {
+    if (count == 0) {
         return;
     }
 
-    const unsigned char* data = reinterpret_cast<const unsigned char*>( &node_values.front() );
-    boost::crc_optimal<64, 0x42F0E1EBA9EA3693ULL, 0, 0, false, false> crc_64;
-    crc_64 = std::for_each( data, data + node_values.size() * sizeof(node_values[0]), crc_64 );
-    hash = crc_64();
+    // xxHash64 finalization: mix in the input length then avalanche
+    U64 h = state + count * sizeof(U64);
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+
+    // 0 is reserved for "invalid"
+    hash = h != 0 ? h : kPrime1;
 }
 
 void
 Hash64::reset()
 {
-    node_values.clear();
     hash = 0;
+    state = kSeed;
+    count = 0;
 }
 
 void
@@ -28,7 +28,6 @@
 
 #include "Global/Macros.h"
 
-#include <vector>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/static_assert.hpp>
 #endif
@@ -39,22 +38,23 @@
 
 NATRON_NAMESPACE_ENTER
 
-/*The hash of a Node is the checksum of the vector of data containing:
+/*The hash of a Node is the checksum of the stream of data containing:
     - the values of the current knob for this node + the name of the node
     - the hash values for the  tree upstream
+
+   Values are folded into the hash state as they are appended (using the
+   8-byte lane round of xxHash64), so no intermediate buffer is kept and
+   computeHash() only has to run the final avalanche.
  */
 
 class Hash64
 {
 public:
     Hash64()
+        : hash(0)
+        , state(kSeed)
+        , count(0)
     {
-        hash = 0;
-    }
-
-    ~Hash64()
-    {
-        node_values.clear();
     }
 
     U64 value() const
@@ -87,7 +87,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
     template<typename T>
     void append(T value)
     {
-        node_values.push_back( toU64(value) );
+        appendU64( toU64(value) );
     }
 
     bool operator== (const Hash64 & h) const
@@ -101,6 +101,30 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
     }
 
 private:
+
+    static const U64 kPrime1 = 0x9E3779B185EBCA87ULL;
+    static const U64 kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+    static const U64 kPrime3 = 0x165667B19E3779F9ULL;
+    static const U64 kPrime4 = 0x85EBCA77C2B2AE63ULL;
+    static const U64 kPrime5 = 0x27D4EB2F165667C5ULL;
+    static const U64 kSeed = kPrime5;
+
+    static U64 rotl(U64 x,
+                    int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    void appendU64(U64 v)
+    {
+        v *= kPrime2;
+        v = rotl(v, 31);
+        v *= kPrime1;
+        state ^= v;
+        state = rotl(state, 27) * kPrime1 + kPrime4;
+        ++count;
+    }
+
     template<typename T>
     struct alias_cast_t
     {
@@ -117,7 +141,8 @@ private:
     };
 
     U64 hash;
-    std::vector<U64> node_values;
+    U64 state; // running xxHash64 accumulator
+    U64 count; // number of values appended since the last reset()
 };
 
 void Hash64_appendQString(Hash64* hash, const QString & str);
@@ -29,12 +29,23 @@
 #include <cassert>
 #include <stdexcept>
 
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#include <boost/ref.hpp>
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 #include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
+#include <QtCore/QThreadPool>
+CLANG_DIAG_ON(deprecated)
 
 #ifdef DEBUG
 #include "Global/FloatingPointExceptions.h"
 #endif
+#include "Engine/AppManager.h"
 #include "Engine/Image.h"
 #include "Engine/Smooth1D.h"
 
@@ -89,6 +100,8 @@ struct FinishedHistogram
     int pixelsCount;
     double vmin, vmax;
     unsigned int mipMapLevel;
+    // for the scope modes, each histogram is a scopeWidth x scopeHeight density grid (row 0 at the bottom)
+    int scopeWidth, scopeHeight;
 
     FinishedHistogram()
         : histogram1()
@@ -100,6 +113,8 @@ struct FinishedHistogram
         , vmin(0)
         , vmax(0)
         , mipMapLevel(0)
+        , scopeWidth(0)
+        , scopeHeight(0)
     {
     }
 };
@@ -199,9 +214,11 @@ HistogramCPU::getMostRecentlyProducedHistogram(std::vector<float>* histogram1,
                                                int* mode,
                                                double* vmin,
                                                double* vmax,
-                                               unsigned int* mipMapLevel)
+                                               unsigned int* mipMapLevel,
+                                               unsigned int* scopeWidth,
+                                               unsigned int* scopeHeight)
 {
-    assert(histogram1 && histogram2 && histogram3 && binsCount && pixelsCount && mode && vmin && vmax);
+    assert(histogram1 && histogram2 && histogram3 && binsCount && pixelsCount && mode && vmin && vmax && scopeWidth && scopeHeight);
 
     QMutexLocker l(&_imp->producedMutex);
     if ( _imp->produced.empty() ) {
@@ -219,6 +236,8 @@ HistogramCPU::getMostRecentlyProducedHistogram(std::vector<float>* histogram1,
     *vmin = h->vmin;
     *vmax = h->vmax;
     *mipMapLevel = h->mipMapLevel;
+    *scopeWidth = h->scopeWidth;
+    *scopeHeight = h->scopeHeight;
     _imp->produced.pop_back();
 
     return true;
@@ -266,6 +285,43 @@ struct pix_lum
     }
 };
 
+///Number of value rows of the waveform and parade scopes, and size of the vectorscope grid
+#define NATRON_SCOPE_RESOLUTION 256
+
+
+///Minimum number of pixels for the histogram to be computed in parallel
+#define NATRON_HISTOGRAM_MIN_PIXELS_PER_THREAD (256 * 256)
+
+template <float pix_func(const float*)>
+std::vector<float>
+computeHistoForRect(const HistogramRequest & request,
+                    int binsCount,
+                    const RectI & rect)
+{
+    std::vector<float> histo(binsCount, 0.f);
+    double binSize = (request.vmax - request.vmin) / binsCount;
+    int nComps = request.image->getComponentsCount();
+
+    Image::ReadAccess acc = request.image->getReadRights();
+    const Image::ConstPixelSpan span = acc.spanAt(rect);
+
+    if ( span.isEmpty() ) {
+        return histo;
+    }
+    for (int y = span.bounds.y1; y < span.bounds.y2; ++y) {
+        const float *pix = span.rowAt<const float>(y);
+        for (int x = span.bounds.x1; x < span.bounds.x2; ++x, pix += nComps) {
+            float v = pix_func(pix);
+            if ( (request.vmin <= v) && (v < request.vmax) ) {
+                int index = (int)( (v - request.vmin) / binSize );
+                assert( 0 <= index && index < (int)histo.size() );
+                histo[index] += 1.f;
+            }
+        }
+    }
+
+    return histo;
+}
 
 template <float pix_func(const float*)>
 void
@@ -274,29 +330,184 @@ computeHisto(const HistogramRequest & request,
              std::vector<float> *histo)
 {
     assert(histo);
-    histo->resize(request.binsCount * upscale);
-    std::fill(histo->begin(), histo->end(), 0.f);
-    double binSize = (request.vmax - request.vmin) / histo->size();
+    int binsCount = request.binsCount * upscale;
 
     ///Images come from the viewer which is in float.
     assert(request.image->getBitDepth() == eImageBitDepthFloat);
 
+    ///Split the image in strips computed in parallel, each with its own bins, then merge the bins
+    int nThreads = std::min( appPTR->getMaxThreadCount(), (int)( request.rect.area() / NATRON_HISTOGRAM_MIN_PIXELS_PER_THREAD ) );
+    bool runInCurrentThread = nThreads <= 1 ||
+                              QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
+    if (runInCurrentThread) {
+        *histo = computeHistoForRect<pix_func>(request, binsCount, request.rect);
+
+        return;
+    }
+
+    std::vector<RectI> splitRects = request.rect.splitIntoSmallerRects(nThreads);
+    QFuture<std::vector<float> > future = QtConcurrent::mapped( splitRects,
+                                                                 boost::bind(&computeHistoForRect<pix_func>,
+                                                                             boost::cref(request),
+                                                                             binsCount,
+                                                                             _1) );
+    future.waitForFinished();
+
+    histo->resize(binsCount);
+    std::fill(histo->begin(), histo->end(), 0.f);
+    QList<std::vector<float> > results = future.results();
+    Q_FOREACH(const std::vector<float> &partial, results) {
+        assert( partial.size() == histo->size() );
+        for (std::size_t i = 0; i < partial.size(); ++i) {
+            (*histo)[i] += partial[i];
+        }
+    }
+}
+
+
+template <float pix_func(const float*)>
+std::vector<float>
+computeWaveformForRect(const HistogramRequest & request,
+                       int scopeWidth,
+                       int scopeHeight,
+                       const RectI & rect)
+{
+    std::vector<float> grid(scopeWidth * scopeHeight, 0.f);
+    double rowSize = (request.vmax - request.vmin) / scopeHeight;
+    double columnScale = (double)scopeWidth / request.rect.width();
+    int nComps = request.image->getComponentsCount();
+
     Image::ReadAccess acc = request.image->getReadRights();
+    const Image::ConstPixelSpan span = acc.spanAt(rect);
 
-    for (int y = request.rect.bottom(); y < request.rect.top(); ++y) {
-        for (int x = request.rect.left(); x < request.rect.right(); ++x) {
-            const float *pix = (const float*)acc.pixelAt(x, y);
+    if ( span.isEmpty() ) {
+        return grid;
+    }
+    for (int y = span.bounds.y1; y < span.bounds.y2; ++y) {
+        const float *pix = span.rowAt<const float>(y);
+        for (int x = span.bounds.x1; x < span.bounds.x2; ++x, pix += nComps) {
             float v = pix_func(pix);
             if ( (request.vmin <= v) && (v < request.vmax) ) {
-                int index = (int)( (v - request.vmin) / binSize );
-                assert( 0 <= index && index < (int)histo->size() );
-                (*histo)[index] += 1.f;
+                int column = std::min( (int)( (x - request.rect.x1) * columnScale ), scopeWidth - 1 );
+                int row = std::min( (int)( (v - request.vmin) / rowSize ), scopeHeight - 1 );
+                grid[row * scopeWidth + column] += 1.f;
             }
         }
     }
+
+    return grid;
 }
 
+static std::vector<float>
+computeVectorscopeForRect(const HistogramRequest & request,
+                          int scopeWidth,
+                          int scopeHeight,
+                          const RectI & rect)
+{
+    std::vector<float> grid(scopeWidth * scopeHeight, 0.f);
+    int nComps = request.image->getComponentsCount();
 
+    Image::ReadAccess acc = request.image->getReadRights();
+    const Image::ConstPixelSpan span = acc.spanAt(rect);
+
+    if ( span.isEmpty() ) {
+        return grid;
+    }
+    for (int y = span.bounds.y1; y < span.bounds.y2; ++y) {
+        const float *pix = span.rowAt<const float>(y);
+        for (int x = span.bounds.x1; x < span.bounds.x2; ++x, pix += nComps) {
+            // chroma with the same luma coefficients as pix_lum, both in [-0.5,0.5] for colors in [0,1]
+            float luma = pix_lum::val(pix);
+            float cb = 0.564f * (pix[2] - luma);
+            float cr = 0.713f * (pix[0] - luma);
+            int column = (int)( (cb + 0.5f) * scopeWidth );
+            int row = (int)( (cr + 0.5f) * scopeHeight );
+            if ( (0 <= column) && (column < scopeWidth) && (0 <= row) && (row < scopeHeight) ) {
+                grid[row * scopeWidth + column] += 1.f;
+            }
+        }
+    }
+
+    return grid;
+}
+
+typedef std::vector<float> (*ScopeForRectFunc)(const HistogramRequest &, int, int, const RectI &);
+
+static void
+computeScope(const HistogramRequest & request,
+             ScopeForRectFunc func,
+             int scopeWidth,
+             int scopeHeight,
+             std::vector<float> *grid)
+{
+    assert(grid);
+
+    ///Images come from the viewer which is in float.
+    assert(request.image->getBitDepth() == eImageBitDepthFloat);
+
+    ///Same strategy as computeHisto: each strip accumulates its own grid, then the grids are summed
+    int nThreads = std::min( appPTR->getMaxThreadCount(), (int)( request.rect.area() / NATRON_HISTOGRAM_MIN_PIXELS_PER_THREAD ) );
+    bool runInCurrentThread = nThreads <= 1 ||
+                              QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
+    if (runInCurrentThread) {
+        *grid = func(request, scopeWidth, scopeHeight, request.rect);
+
+        return;
+    }
+
+    std::vector<RectI> splitRects = request.rect.splitIntoSmallerRects(nThreads);
+    QFuture<std::vector<float> > future = QtConcurrent::mapped( splitRects,
+                                                                 boost::bind(func,
+                                                                             boost::cref(request),
+                                                                             scopeWidth,
+                                                                             scopeHeight,
+                                                                             _1) );
+    future.waitForFinished();
+
+    grid->resize(scopeWidth * scopeHeight);
+    std::fill(grid->begin(), grid->end(), 0.f);
+    QList<std::vector<float> > results = future.results();
+    Q_FOREACH(const std::vector<float> &partial, results) {
+        assert( partial.size() == grid->size() );
+        for (std::size_t i = 0; i < partial.size(); ++i) {
+            (*grid)[i] += partial[i];
+        }
+    }
+}
+
+static void
+computeScopeStatic(const HistogramRequest & request,
+                   FinishedHistogramPtr ret)
+{
+    /// keep the mode parameter in sync with Histogram::DisplayModeEnum
+
+    ret->pixelsCount = request.rect.area();
+    if ( request.rect.isNull() ) {
+        return;
+    }
+    switch (request.mode) {
+    case 6:     //< Waveform
+        ret->scopeWidth = std::max(request.binsCount, 1);
+        ret->scopeHeight = NATRON_SCOPE_RESOLUTION;
+        computeScope(request, &computeWaveformForRect<&pix_lum::val>, ret->scopeWidth, ret->scopeHeight, &ret->histogram1);
+        break;
+    case 7:     //< Parade: the three channels are drawn side by side, each in a third of the width
+        ret->scopeWidth = std::max(request.binsCount / 3, 1);
+        ret->scopeHeight = NATRON_SCOPE_RESOLUTION;
+        computeScope(request, &computeWaveformForRect<&pix_red::val>, ret->scopeWidth, ret->scopeHeight, &ret->histogram1);
+        computeScope(request, &computeWaveformForRect<&pix_green::val>, ret->scopeWidth, ret->scopeHeight, &ret->histogram2);
+        computeScope(request, &computeWaveformForRect<&pix_blue::val>, ret->scopeWidth, ret->scopeHeight, &ret->histogram3);
+        break;
+    case 8:     //< Vectorscope
+        ret->scopeWidth = NATRON_SCOPE_RESOLUTION;
+        ret->scopeHeight = NATRON_SCOPE_RESOLUTION;
+        computeScope(request, &computeVectorscopeForRect, ret->scopeWidth, ret->scopeHeight, &ret->histogram1);
+        break;
+    default:
+        assert(false);
+        break;
+    }
+} // computeScopeStatic
 
 static void
 computeHistogramStatic(const HistogramRequest & request,
@@ -433,6 +644,11 @@ HistogramCPU::run()
         case 5:
             computeHistogramStatic(request, ret, 1);
             break;
+        case 6:
+        case 7:
+        case 8:
+            computeScopeStatic(request, ret);
+            break;
         default:
             assert(false);     //< unknown case.
             break;
@@ -74,13 +74,16 @@ public:
     ///to the histogramProduced signal.
     ///
     ///This function returns in histogram1 the first histogram of the produced histogram
+    ///For the waveform, parade and vectorscope modes, each histogram is instead a
+    ///scopeWidth x scopeHeight grid of pixel counts, stored row by row from the bottom.
     bool getMostRecentlyProducedHistogram(std::vector<float>* histogram1,
                                           std::vector<float>* histogram2,
                                           std::vector<float>* histogram3,
                                           unsigned int* binsCount,
                                           unsigned int* pixelsCount,
                                           int* mode,
-                                          double* vmin, double* vmax, unsigned int* mipMapLevel);
+                                          double* vmin, double* vmax, unsigned int* mipMapLevel,
+                                          unsigned int* scopeWidth, unsigned int* scopeHeight);
 
     void quitAnyComputation();
 
@@ -27,6 +27,7 @@
 
 #include <algorithm> // min, max
 #include <cassert>
+#include <cmath> // floor, ceil
 #include <cstring> // for std::memcpy, std::memset
 #include <stdexcept>
 
@@ -50,98 +51,246 @@ NATRON_NAMESPACE_ENTER
 
 #define PIXEL_UNAVAILABLE 2
 
+///The grid on which the bounds of an image are aligned when they need to grow, see Image::getGrownBounds()
+#define NATRON_IMAGE_RESIZE_TILE_SIZE 128
+
+///Bits of the masks returned by Bitmap::getRowValues() and Bitmap::getColumnValues()
+#define BM_HAS_UNRENDERED (1 << 0)
+#define BM_HAS_RENDERED (1 << 1)
+#define BM_HAS_UNAVAILABLE (1 << PIXEL_UNAVAILABLE)
+
+// The bitmap is summarized by square tiles of this size, see Bitmap::_tiles
+#define NATRON_BITMAP_TILE_SIZE_SHIFT 6
+#define NATRON_BITMAP_TILE_SIZE (1 << NATRON_BITMAP_TILE_SIZE_SHIFT)
+#define NATRON_BITMAP_TILE_MIXED 3
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// Returns true if any of the 8 bytes of word is 0
+inline bool
+wordHasZeroByte(U64 word)
+{
+    return ( ( word - 0x0101010101010101ULL ) & ~word & 0x8080808080808080ULL ) != 0;
+}
+
+/**
+ * @brief Returns the mask of the values in buf[0..n[, 8 pixels at a time.
+ * The scan stops as soon as the mask intersects stopMask.
+ **/
+int
+scanBitmapValues(const char* buf,
+                 int n,
+                 int stopMask)
+{
+    int mask = 0;
+    const char* end = buf + n;
+
+    while ( ( buf < end ) && ( (std::size_t)buf & (sizeof(U64) - 1) ) ) {
+        mask |= 1 << *buf;
+        ++buf;
+    }
+    if (mask & stopMask) {
+        return mask;
+    }
+    for (; buf + sizeof(U64) <= end; buf += sizeof(U64)) {
+        U64 word;
+        std::memcpy( &word, buf, sizeof(U64) );
+        if (word == 0x0101010101010101ULL) {
+            // fast path: everything is rendered
+            mask |= BM_HAS_RENDERED;
+            continue;
+        }
+        if ( wordHasZeroByte(word) ) {
+            mask |= BM_HAS_UNRENDERED;
+        }
+        if ( wordHasZeroByte(word ^ 0x0101010101010101ULL) ) {
+            mask |= BM_HAS_RENDERED;
+        }
+        if ( wordHasZeroByte(word ^ 0x0202020202020202ULL) ) {
+            mask |= BM_HAS_UNAVAILABLE;
+        }
+        if (mask & stopMask) {
+            return mask;
+        }
+    }
+    while (buf < end) {
+        mask |= 1 << *buf;
+        ++buf;
+    }
+
+    return mask;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+int
+Bitmap::getRowValues(int y,
+                     int x1,
+                     int x2,
+                     int stopMask) const
+{
+    assert(y >= _bounds.y1 && y < _bounds.y2 && x1 >= _bounds.x1 && x2 <= _bounds.x2);
+    const char* tileRow = &_tiles[( (y - _bounds.y1) >> NATRON_BITMAP_TILE_SIZE_SHIFT ) * _tilesPerRow];
+    int mask = 0;
+    int x = x1;
+    while (x < x2) {
+        int tx = (x - _bounds.x1) >> NATRON_BITMAP_TILE_SIZE_SHIFT;
+        int tileEnd = std::min(x2, _bounds.x1 + ( (tx + 1) << NATRON_BITMAP_TILE_SIZE_SHIFT ));
+        char state = tileRow[tx];
+        if (state != NATRON_BITMAP_TILE_MIXED) {
+            mask |= 1 << state;
+        } else {
+            mask |= scanBitmapValues(BM_GET(y, x), tileEnd - x, stopMask);
+        }
+        if (mask & stopMask) {
+            return mask;
+        }
+        x = tileEnd;
+    }
+
+    return mask;
+}
+
+int
+Bitmap::getColumnValues(int x,
+                        int y1,
+                        int y2,
+                        int stopMask) const
+{
+    assert(x >= _bounds.x1 && x < _bounds.x2 && y1 >= _bounds.y1 && y2 <= _bounds.y2);
+    int tx = (x - _bounds.x1) >> NATRON_BITMAP_TILE_SIZE_SHIFT;
+    int w = _bounds.width();
+    int mask = 0;
+    int y = y1;
+    while (y < y2) {
+        int ty = (y - _bounds.y1) >> NATRON_BITMAP_TILE_SIZE_SHIFT;
+        int tileEnd = std::min(y2, _bounds.y1 + ( (ty + 1) << NATRON_BITMAP_TILE_SIZE_SHIFT ));
+        char state = _tiles[ty * _tilesPerRow + tx];
+        if (state != NATRON_BITMAP_TILE_MIXED) {
+            mask |= 1 << state;
+        } else {
+            const char* pix = BM_GET(y, x);
+            for (int i = y; i < tileEnd; ++i, pix += w) {
+                mask |= 1 << *pix;
+            }
+        }
+        if (mask & stopMask) {
+            return mask;
+        }
+        y = tileEnd;
+    }
+
+    return mask;
+}
+
+void
+Bitmap::initializeTiles(char value)
+{
+    if ( _bounds.isNull() ) {
+        _tiles.clear();
+        _tilesPerRow = 0;
+
+        return;
+    }
+    _tilesPerRow = ( _bounds.width() + NATRON_BITMAP_TILE_SIZE - 1 ) >> NATRON_BITMAP_TILE_SIZE_SHIFT;
+    int nRows = ( _bounds.height() + NATRON_BITMAP_TILE_SIZE - 1 ) >> NATRON_BITMAP_TILE_SIZE_SHIFT;
+    _tiles.resize(_tilesPerRow * nRows);
+    std::fill(_tiles.begin(), _tiles.end(), value);
+}
+
+void
+Bitmap::invalidateTiles()
+{
+    std::fill(_tiles.begin(), _tiles.end(), (char)NATRON_BITMAP_TILE_MIXED);
+}
+
+void
+Bitmap::updateTiles(const RectI& roi,
+                    int value)
+{
+    if ( (roi.x1 >= roi.x2) || (roi.y1 >= roi.y2) ) {
+        return;
+    }
+    int tx1 = (roi.x1 - _bounds.x1) >> NATRON_BITMAP_TILE_SIZE_SHIFT;
+    int tx2 = (roi.x2 - 1 - _bounds.x1) >> NATRON_BITMAP_TILE_SIZE_SHIFT;
+    int ty1 = (roi.y1 - _bounds.y1) >> NATRON_BITMAP_TILE_SIZE_SHIFT;
+    int ty2 = (roi.y2 - 1 - _bounds.y1) >> NATRON_BITMAP_TILE_SIZE_SHIFT;
+    int w = _bounds.width();
+
+    for (int ty = ty1; ty <= ty2; ++ty) {
+        RectI tile;
+        tile.y1 = _bounds.y1 + (ty << NATRON_BITMAP_TILE_SIZE_SHIFT);
+        tile.y2 = std::min(_bounds.y2, tile.y1 + NATRON_BITMAP_TILE_SIZE);
+        for (int tx = tx1; tx <= tx2; ++tx) {
+            tile.x1 = _bounds.x1 + (tx << NATRON_BITMAP_TILE_SIZE_SHIFT);
+            tile.x2 = std::min(_bounds.x2, tile.x1 + NATRON_BITMAP_TILE_SIZE);
+            char& state = _tiles[ty * _tilesPerRow + tx];
+            if ( value >= 0 && ( (state == value) || roi.contains(tile) ) ) {
+                state = (char)value;
+                continue;
+            }
+
+            // The tile is partially covered: find out whether it is still uniform
+            int mask = 0;
+            const char* buf = BM_GET(tile.y1, tile.x1);
+            for (int y = tile.y1; y < tile.y2 && !( mask & (mask - 1) ); ++y, buf += w) {
+                mask |= scanBitmapValues(buf, tile.width(), 0);
+            }
+            switch (mask) {
+            case BM_HAS_UNRENDERED:
+                state = 0;
+                break;
+            case BM_HAS_RENDERED:
+                state = 1;
+                break;
+            case BM_HAS_UNAVAILABLE:
+                state = PIXEL_UNAVAILABLE;
+                break;
+            default:
+                state = NATRON_BITMAP_TILE_MIXED;
+                break;
+            }
+        }
+    }
+}
+
 template <int trimap>
 RectI
 minimalNonMarkedBbox_internal(const RectI& roi,
-                              const RectI& _bounds,
-                              const std::vector<char>& _map,
+                              const Bitmap& bitmap,
                               bool* isBeingRenderedElsewhere)
 {
     RectI bbox;
 
-    assert( _bounds.contains(roi) );
+    assert( bitmap.getBounds().contains(roi) );
     bbox = roi;
 
+    // A row (resp. column) is fully rendered if it has no 0. Pixels being rendered elsewhere are considered
+    // rendered in trimap mode (the caller will wait for them) and unrendered otherwise.
+    const int stopMask = trimap ? BM_HAS_UNRENDERED : (BM_HAS_UNRENDERED | BM_HAS_UNAVAILABLE);
+
     //find bottom
     for (int i = bbox.bottom(); i < bbox.top(); ++i) {
-        const char* buf = BM_GET( i, bbox.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bbox.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (!*buf) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE) {
-                    metUnavailablePixel = true;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else if (metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
-                ++bbox.y1;
-            } else {
-                ++bbox.y1;
-            }
-        } else {
-            const char* lineEnd = buf + bbox.width();
-            while (buf < lineEnd) {
-                if ( !*buf || (*buf == PIXEL_UNAVAILABLE) ) {
-                    buf = 0;
-                    break;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else {
-                ++bbox.y1;
-            }
+        int mask = bitmap.getRowValues(i, bbox.left(), bbox.right(), stopMask);
+        if (mask & stopMask) {
+            break;
         }
+        if ( trimap && (mask & BM_HAS_UNAVAILABLE) ) {
+            *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
+        }
+        ++bbox.y1;
     }
 
     //find top (will do zero iteration if the bbox is already empty)
     for (int i = bbox.top() - 1; i >= bbox.bottom(); --i) {
-        const char* buf = BM_GET( i, bbox.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bbox.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (!*buf) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE) {
-                    metUnavailablePixel = true;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else if (metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
-                --bbox.y2;
-            } else {
-                --bbox.y2;
-            }
-        } else {
-            const char* lineEnd = buf + bbox.width();
-            while (buf < lineEnd) {
-                if ( !*buf || (*buf == PIXEL_UNAVAILABLE) ) {
-                    buf = 0;
-                    break;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else {
-                --bbox.y2;
-            }
+        int mask = bitmap.getRowValues(i, bbox.left(), bbox.right(), stopMask);
+        if (mask & stopMask) {
+            break;
         }
+        if ( trimap && (mask & BM_HAS_UNAVAILABLE) ) {
+            *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
+        }
+        --bbox.y2;
     }
 
     // avoid making bbox.width() iterations for nothing
@@ -151,58 +300,26 @@ minimalNonMarkedBbox_internal(const RectI& roi,
 
     //find left
     for (int j = bbox.left(); j < bbox.right(); ++j) {
-        const char* pix = BM_GET(bbox.bottom(), j);
-        bool metUnavailablePixel = false;
-
-        for ( int i = bbox.bottom(); i < bbox.top(); ++i, pix += _bounds.width() ) {
-            if (!*pix) {
-                pix = 0;
-                break;
-            } else if (*pix == PIXEL_UNAVAILABLE) {
-                if (trimap) {
-                    metUnavailablePixel = true;
-                } else {
-                    pix = 0;
-                    break;
-                }
-            }
-        }
-        if (pix) {
-            ++bbox.x1;
-            if (trimap && metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
-            }
-        } else {
+        int mask = bitmap.getColumnValues(j, bbox.bottom(), bbox.top(), stopMask);
+        if (mask & stopMask) {
             break;
         }
+        if ( trimap && (mask & BM_HAS_UNAVAILABLE) ) {
+            *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
+        }
+        ++bbox.x1;
     }
 
     //find right
     for (int j = bbox.right() - 1; j >= bbox.left(); --j) {
-        const char* pix = BM_GET(bbox.bottom(), j);
-        bool metUnavailablePixel = false;
-
-        for ( int i = bbox.bottom(); i < bbox.top(); ++i, pix += _bounds.width() ) {
-            if (!*pix) {
-                pix = 0;
-                break;
-            } else if (*pix == PIXEL_UNAVAILABLE) {
-                if (trimap) {
-                    metUnavailablePixel = true;
-                } else {
-                    pix = 0;
-                    break;
-                }
-            }
-        }
-        if (pix) {
-            --bbox.x2;
-            if (trimap && metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
-            }
-        } else {
+        int mask = bitmap.getColumnValues(j, bbox.bottom(), bbox.top(), stopMask);
+        if (mask & stopMask) {
             break;
         }
+        if ( trimap && (mask & BM_HAS_UNAVAILABLE) ) {
+            *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
+        }
+        --bbox.x2;
     }
 
     return bbox;
@@ -212,12 +329,12 @@ minimalNonMarkedBbox_internal(const RectI& roi,
 template <int trimap>
 void
 minimalNonMarkedRects_internal(const RectI & roi,
-                               const RectI& _bounds,
-                               const std::vector<char>& _map,
+                               const Bitmap& bitmap,
                                std::list<RectI>& ret,
                                bool* isBeingRenderedElsewhere)
 {
     assert(ret.empty());
+    const RectI& _bounds = bitmap.getBounds();
     ///Any out of bounds portion is pushed to the rectangles to render
     RectI intersection;
 
@@ -251,7 +368,7 @@ minimalNonMarkedRects_internal(const RectI & roi,
         return;
     }
 
-    RectI bboxM = minimalNonMarkedBbox_internal<trimap>(intersection, _bounds, _map, isBeingRenderedElsewhere);
+    RectI bboxM = minimalNonMarkedBbox_internal<trimap>(intersection, bitmap, isBeingRenderedElsewhere);
     assert( (trimap && isBeingRenderedElsewhere) || (!trimap && !isBeingRenderedElsewhere) );
 
     //#define NATRON_BITMAP_DISABLE_OPTIMIZATION
@@ -285,44 +402,25 @@ minimalNonMarkedRects_internal(const RectI & roi,
     // CXXXXXXXXXXDDD
     // AAAAAAAAAAAAAA
 
+    // A row (resp. column) belongs to one of these rectangles if it has nothing rendered. In trimap mode
+    // the pixels being rendered elsewhere are not ours to render.
+    const int stopMask = trimap ? (BM_HAS_RENDERED | BM_HAS_UNAVAILABLE) : BM_HAS_RENDERED;
+
     // First, find if there's an "A" rectangle, and push it to the result
     //find bottom
     RectI bboxX = bboxM;
     RectI bboxA = bboxX;
     bboxA.set_top( bboxX.bottom() );
     for (int i = bboxX.bottom(); i < bboxX.top(); ++i) {
-        const char* buf = BM_GET( i, bboxX.left() );
-        if (trimap) {
-            const char* lineEnd = buf + bboxX.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (*buf == 1) {
-                    buf = 0;
-                    break;
-                } else if ( (*buf == PIXEL_UNAVAILABLE) && trimap ) {
-                    buf = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-                ++buf;
-            }
-            if (buf) {
-                ++bboxX.y1;
-                bboxA.y2 = bboxX.y1;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        } else {
-            if ( !memchr( buf, 1, bboxX.width() ) ) {
-                ++bboxX.y1;
-                bboxA.y2 = bboxX.y1;
-            } else {
-                break;
+        int mask = bitmap.getRowValues(i, bboxX.left(), bboxX.right(), stopMask);
+        if (mask & stopMask) {
+            if ( trimap && (mask & BM_HAS_UNAVAILABLE) ) {
+                *isBeingRenderedElsewhere = true;
             }
+            break;
         }
+        ++bboxX.y1;
+        bboxA.y2 = bboxX.y1;
     }
     if ( !bboxA.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxA);
@@ -333,39 +431,15 @@ minimalNonMarkedRects_internal(const RectI & roi,
     RectI bboxB = bboxX;
     bboxB.set_bottom( bboxX.top() );
     for (int i = bboxX.top() - 1; i >= bboxX.bottom(); --i) {
-        const char* buf = BM_GET( i, bboxX.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bboxX.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (*buf == 1) {
-                    buf = 0;
-                    break;
-                } else if ( (*buf == PIXEL_UNAVAILABLE) && trimap ) {
-                    buf = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-                ++buf;
-            }
-            if (buf) {
-                --bboxX.y2;
-                bboxB.y1 = bboxX.y2;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        } else {
-            if ( !memchr( buf, 1, bboxX.width() ) ) {
-                --bboxX.y2;
-                bboxB.y1 = bboxX.y2;
-            } else {
-                break;
+        int mask = bitmap.getRowValues(i, bboxX.left(), bboxX.right(), stopMask);
+        if (mask & stopMask) {
+            if ( trimap && (mask & BM_HAS_UNAVAILABLE) ) {
+                *isBeingRenderedElsewhere = true;
             }
+            break;
         }
+        --bboxX.y2;
+        bboxB.y1 = bboxX.y2;
     }
     if ( !bboxB.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxB);
@@ -376,28 +450,15 @@ minimalNonMarkedRects_internal(const RectI & roi,
     bboxC.set_right( bboxX.left() );
     if ( bboxX.bottom() < bboxX.top() ) {
         for (int j = bboxX.left(); j < bboxX.right(); ++j) {
-            const char* pix = BM_GET(bboxX.bottom(), j);
-            bool metUnavailablePixel = false;
-
-            for ( int i = bboxX.bottom(); i < bboxX.top(); ++i, pix += _bounds.width() ) {
-                if (*pix == 1) {
-                    pix = 0;
-                    break;
-                } else if ( trimap && (*pix == PIXEL_UNAVAILABLE) ) {
-                    pix = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-            }
-            if (pix) {
-                ++bboxX.x1;
-                bboxC.x2 = bboxX.x1;
-            } else {
-                if (metUnavailablePixel) {
+            int mask = bitmap.getColumnValues(j, bboxX.bottom(), bboxX.top(), stopMask);
+            if (mask & stopMask) {
+                if ( trimap && (mask & BM_HAS_UNAVAILABLE) ) {
                     *isBeingRenderedElsewhere = true;
                 }
                 break;
             }
+            ++bboxX.x1;
+            bboxC.x2 = bboxX.x1;
         }
     }
     if ( !bboxC.isNull() ) { // empty boxes should not be pushed
@@ -409,28 +470,15 @@ minimalNonMarkedRects_internal(const RectI & roi,
     bboxD.set_left( bboxX.right() );
     if ( bboxX.bottom() < bboxX.top() ) {
         for (int j = bboxX.right() - 1; j >= bboxX.left(); --j) {
-            const char* pix = BM_GET(bboxX.bottom(), j);
-            bool metUnavailablePixel = false;
-
-            for ( int i = bboxX.bottom(); i < bboxX.top(); ++i, pix += _bounds.width() ) {
-                if (*pix == 1) {
-                    pix = 0;
-                    break;
-                } else if ( trimap && (*pix == PIXEL_UNAVAILABLE) ) {
-                    pix = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-            }
-            if (pix) {
-                --bboxX.x2;
-                bboxD.x1 = bboxX.x2;
-            } else {
-                if (metUnavailablePixel) {
+            int mask = bitmap.getColumnValues(j, bboxX.bottom(), bboxX.top(), stopMask);
+            if (mask & stopMask) {
+                if ( trimap && (mask & BM_HAS_UNAVAILABLE) ) {
                     *isBeingRenderedElsewhere = true;
                 }
                 break;
             }
+            --bboxX.x2;
+            bboxD.x1 = bboxX.x2;
         }
     }
     if ( !bboxD.isNull() ) { // empty boxes should not be pushed
@@ -458,7 +506,7 @@ minimalNonMarkedRects_internal(const RectI & roi,
     assert( bboxD.bottom() == bboxX.bottom() );
 
     // get the bounding box of what's left (the X rectangle in the drawing above)
-    bboxX = minimalNonMarkedBbox_internal<trimap>(bboxX, _bounds, _map, isBeingRenderedElsewhere);
+    bboxX = minimalNonMarkedBbox_internal<trimap>(bboxX, bitmap, isBeingRenderedElsewhere);
 
     if ( !bboxX.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxX);
@@ -476,9 +524,9 @@ Bitmap::minimalNonMarkedBbox(const RectI & roi) const
             return RectI();
         }
 
-        return minimalNonMarkedBbox_internal<0>(realRoi, _bounds, _map, NULL);
+        return minimalNonMarkedBbox_internal<0>(realRoi, *this, NULL);
     } else {
-        return minimalNonMarkedBbox_internal<0>(roi, _bounds, _map, NULL);
+        return minimalNonMarkedBbox_internal<0>(roi, *this, NULL);
     }
 }
 
@@ -491,9 +539,9 @@ Bitmap::minimalNonMarkedRects(const RectI & roi,
         if ( !roi.intersect(_dirtyZone, &realRoi) ) {
             return;
         }
-        minimalNonMarkedRects_internal<0>(realRoi, _bounds, _map, ret, NULL);
+        minimalNonMarkedRects_internal<0>(realRoi, *this, ret, NULL);
     } else {
-        minimalNonMarkedRects_internal<0>(roi, _bounds, _map, ret, NULL);
+        minimalNonMarkedRects_internal<0>(roi, *this, ret, NULL);
     }
 }
 
@@ -510,9 +558,9 @@ Bitmap::minimalNonMarkedBbox_trimap(const RectI & roi,
             return RectI();
         }
 
-        return minimalNonMarkedBbox_internal<1>(realRoi, _bounds, _map, isBeingRenderedElsewhere);
+        return minimalNonMarkedBbox_internal<1>(realRoi, *this, isBeingRenderedElsewhere);
     } else {
-        return minimalNonMarkedBbox_internal<1>(roi, _bounds, _map, isBeingRenderedElsewhere);
+        return minimalNonMarkedBbox_internal<1>(roi, *this, isBeingRenderedElsewhere);
     }
 }
 
@@ -528,9 +576,9 @@ Bitmap::minimalNonMarkedRects_trimap(const RectI & roi,
 
             return;
         }
-        minimalNonMarkedRects_internal<1>(realRoi, _bounds, _map, ret, isBeingRenderedElsewhere);
+        minimalNonMarkedRects_internal<1>(realRoi, *this, ret, isBeingRenderedElsewhere);
     } else {
-        minimalNonMarkedRects_internal<1>(roi, _bounds, _map, ret, isBeingRenderedElsewhere);
+        minimalNonMarkedRects_internal<1>(roi, *this, ret, isBeingRenderedElsewhere);
     }
 }
 
@@ -544,6 +592,10 @@ Bitmap::markFor(const RectI & roi, char value)
     int x2 = std::min(roi.x2, _bounds.x2);
     int y2 = std::min(roi.y2, _bounds.y2);
 
+    if ( (x1 >= x2) || (y1 >= y2) ) {
+        return;
+    }
+
     char* buf = BM_GET(y1, x1);
     int w = _bounds.width();
     int roiw = x2 - x1;
@@ -551,6 +603,7 @@ Bitmap::markFor(const RectI & roi, char value)
     for (int i = y1; i < y2; ++i, buf += w) {
         std::memset( buf, value, roiw);
     }
+    updateTiles(RectI(x1, y1, x2, y2), value);
 }
 
 bool
@@ -560,16 +613,11 @@ Bitmap::isNonMarked(const RectI & roi) const
     int y1 = std::max(roi.y1, _bounds.y1);
     int x2 = std::min(roi.x2, _bounds.x2);
     int y2 = std::min(roi.y2, _bounds.y2);
+    const int stopMask = BM_HAS_RENDERED | BM_HAS_UNAVAILABLE;
 
-    const char* buf = BM_GET(y1, x1);
-    int w = _bounds.width();
-    int roiw = x2 - x1;
-
-    for (int i = y1; i < y2; ++i, buf += w) {
-        for (int j = 0; j < roiw; ++j) {
-            if (buf[j]) {
-                return false;
-            }
+    for (int i = y1; i < y2; ++i) {
+        if (getRowValues(i, x1, x2, stopMask) & stopMask) {
+            return false;
         }
     }
     return true;
@@ -588,6 +636,8 @@ void
 Bitmap::swap(Bitmap& other)
 {
     _map.swap(other._map);
+    _tiles.swap(other._tiles);
+    std::swap(_tilesPerRow, other._tilesPerRow);
     _bounds = other._bounds;
     _dirtyZone.clear(); //merge(other._dirtyZone);
     _dirtyZoneSet = false;
@@ -686,6 +736,7 @@ Image::Image(const ImageKey & key,
              const CacheAPI* cache)
     : CacheEntryHelper<unsigned char, ImageKey, ImageParams>(key, params, cache)
     , _useBitmap(true)
+    , _layout(eImagePixelLayoutPacked)
 {
     _bitDepth = params->getBitDepth();
     _depthBytesSize = getSizeOfForBitDepth(_bitDepth);
@@ -701,6 +752,7 @@ Image::Image(const ImageKey & key,
              const ImageParamsPtr& params)
     : CacheEntryHelper<unsigned char, ImageKey, ImageParams>( key, params, NULL )
     , _useBitmap(false)
+    , _layout(eImagePixelLayoutPacked)
 {
     _bitDepth = params->getBitDepth();
     _depthBytesSize = getSizeOfForBitDepth(_bitDepth);
@@ -727,10 +779,14 @@ Image::Image(const ImagePlaneDesc& components,
              ImageFieldingOrderEnum fielding,
              bool useBitmap,
              StorageModeEnum storage,
-             U32 textureTarget)
+             U32 textureTarget,
+             ImagePixelLayoutEnum layout)
     : CacheEntryHelper<unsigned char, ImageKey, ImageParams>()
     , _useBitmap(useBitmap)
+    , _layout(layout)
 {
+    // planes only make sense for buffers we own, textures are always packed
+    assert(layout == eImagePixelLayoutPacked || storage == eStorageModeRAM);
     setCacheEntry(makeKey(0, 0, false, 0, ViewIdx(0), false, false),
 #ifdef BOOST_NO_CXX11_VARIADIC_TEMPLATES
                   ImageParamsPtr( new ImageParams(regionOfDefinition,
@@ -952,18 +1008,43 @@ Image::pasteFromForDepth(const Image & srcImg,
     }
     // now we're safe: both images contain the area in roi
 
-    int srcRowElements = _nbComponents * srcBounds.width();
-    int dstRowElements = _nbComponents * bounds.width();
-    const PIX* src = (const PIX*)srcImg.pixelAt(roi.x1, roi.y1);
-    PIX* dst = (PIX*)pixelAt(roi.x1, roi.y1);
+    if ( (_layout != eImagePixelLayoutPacked) || (srcImg._layout != eImagePixelLayoutPacked) ) {
+        // copy channel by channel, which also converts between the packed and planar layouts
+        for (int k = 0; k < _nbComponents; ++k) {
+            ConstPixelSpan srcChannel;
+            PixelSpan dstChannel;
+            srcImg.getChannelSpan(k, roi, &srcChannel);
+            getChannelSpan(k, roi, &dstChannel);
+            assert( !srcChannel.isEmpty() && !dstChannel.isEmpty() );
+            const int srcStep = (int)(srcChannel.pixelStride / sizeof(PIX));
+            const int dstStep = (int)(dstChannel.pixelStride / sizeof(PIX));
+            const int width = roi.width();
+            for (int y = roi.y1; y < roi.y2; ++y) {
+                const PIX* src = srcChannel.rowAt<const PIX>(y);
+                PIX* dst = dstChannel.rowAt<PIX>(y);
+                if ( (srcStep == 1) && (dstStep == 1) ) {
+                    std::memcpy( dst, src, width * sizeof(PIX) );
+                } else {
+                    for (int x = 0; x < width; ++x, src += srcStep, dst += dstStep) {
+                        *dst = *src;
+                    }
+                }
+            }
+        }
+
+        return;
+    }
 
-    assert(src && dst);
+    ConstPixelSpan srcSpan;
+    PixelSpan dstSpan;
+    srcImg.getPixelSpan(roi, &srcSpan);
+    getPixelSpan(roi, &dstSpan);
+
+    assert( !srcSpan.isEmpty() && !dstSpan.isEmpty() );
+    const std::size_t rowBytes = roi.width() * dstSpan.pixelStride;
 
-    for (int y = roi.y1; y < roi.y2;
-         ++y,
-         src += srcRowElements,
-         dst += dstRowElements) {
-        std::memcpy(dst, src, roi.width() * sizeof(PIX) * _nbComponents);
+    for (int y = roi.y1; y < roi.y2; ++y) {
+        std::memcpy(dstSpan.rowAt<PIX>(y), srcSpan.rowAt<const PIX>(y), rowBytes);
     }
 } // Image::pasteFromForDepth
 
@@ -985,6 +1066,9 @@ Image::resizeInternal(const Image* srcImg,
                       bool createInCache,
                       ImagePtr* outputImage)
 {
+    // planar images are local images with fixed bounds
+    assert(srcImg->getPixelLayout() == eImagePixelLayoutPacked);
+
     ///Allocate to resized image
     if (!createInCache) {
         *outputImage = boost::make_shared<Image>( srcImg->getComponents(),
@@ -1051,9 +1135,7 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t memsize = a * pixelSize;
             std::memset(pix, 0, memsize);
             if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
-                char* bm = wacc.bitmapAt(aRect.x1, aRect.y1);
-                assert(bm);
-                std::memset(bm, 1, a);
+                (*outputImage)->_bitmap.markForRendered(aRect);
             }
         }
         if ( !cRect.isNull() ) {
@@ -1063,9 +1145,7 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t memsize = a * pixelSize;
             std::memset(pix, 0, memsize);
             if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
-                char* bm = (char*)wacc.bitmapAt(cRect.x1, cRect.y1);
-                assert(bm);
-                std::memset(bm, 1, a);
+                (*outputImage)->_bitmap.markForRendered(cRect);
             }
         }
         if ( !bRect.isNull() ) {
@@ -1075,13 +1155,11 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t rowsize = mw * pixelSize;
             int bw = bRect.width();
             std::size_t rectRowSize = bw * pixelSize;
-            char* bm = ( setBitmapTo1 && (*outputImage)->usesBitMap() ) ? wacc.bitmapAt(bRect.x1, bRect.y1) : 0;
             for (int y = bRect.y1; y < bRect.y2; ++y, pix += rowsize) {
                 std::memset(pix, 0, rectRowSize);
-                if (bm) {
-                    std::memset(bm, 1, bw);
-                    bm += mw;
-                }
+            }
+            if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
+                (*outputImage)->_bitmap.markForRendered(bRect);
             }
         }
         if ( !dRect.isNull() ) {
@@ -1091,13 +1169,11 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t rowsize = mw * pixelSize;
             int dw = dRect.width();
             std::size_t rectRowSize = dw * pixelSize;
-            char* bm = ( setBitmapTo1 && (*outputImage)->usesBitMap() ) ? wacc.bitmapAt(dRect.x1, dRect.y1) : 0;
             for (int y = dRect.y1; y < dRect.y2; ++y, pix += rowsize) {
                 std::memset(pix, 0, rectRowSize);
-                if (bm) {
-                    std::memset(bm, 1, dw);
-                    bm += mw;
-                }
+            }
+            if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
+                (*outputImage)->_bitmap.markForRendered(dRect);
             }
         }
     } // fillWithBlackAndTransparent
@@ -1121,6 +1197,47 @@ Image::resizeInternal(const Image* srcImg,
     }
 } // Image::resizeInternal
 
+RectI
+Image::getGrownBounds(const RectI& newBounds,
+                      bool setBitmapTo1) const
+{
+    RectI merge = newBounds;
+
+    merge.merge(_bounds);
+
+    /*
+       Without a bitmap every pixel within the bounds is considered rendered, and when setting the bitmap to 1 the
+       grown area is considered rendered black: in both cases we cannot allocate more than what was asked.
+     */
+    if ( !usesBitMap() || setBitmapTo1 ) {
+        return merge;
+    }
+
+    /*
+       Align the grown bounds on a fixed grid so that successive small growths of the RoI (e.g: when panning
+       the viewer over a large image) get absorbed by the previous reallocation instead of copying the whole
+       buffer each time. The extra pixels are left with a bitmap of 0 and will be rendered on demand.
+     */
+    const int tileSize = NATRON_IMAGE_RESIZE_TILE_SIZE;
+    RectI aligned;
+    aligned.x1 = (int)std::floor( (double)merge.x1 / tileSize ) * tileSize;
+    aligned.y1 = (int)std::floor( (double)merge.y1 / tileSize ) * tileSize;
+    aligned.x2 = (int)std::ceil( (double)merge.x2 / tileSize ) * tileSize;
+    aligned.y2 = (int)std::ceil( (double)merge.y2 / tileSize ) * tileSize;
+
+    // Never allocate outside of the region of definition
+    RectI pixelRod;
+    _rod.toPixelEnclosing(getMipMapLevel(), getPixelAspectRatio(), &pixelRod);
+    pixelRod.merge(merge);
+    RectI clipped;
+    if ( !aligned.intersect(pixelRod, &clipped) ) {
+        return merge;
+    }
+    assert( clipped.contains(merge) );
+
+    return clipped;
+}
+
 bool
 Image::copyAndResizeIfNeeded(const RectI& newBounds,
                              bool fillWithBlackAndTransparent,
@@ -1134,8 +1251,7 @@ Image::copyAndResizeIfNeeded(const RectI& newBounds,
     assert(output);
 
     QReadLocker k(&_entryLock);
-    RectI merge = newBounds;
-    merge.merge(_bounds);
+    RectI merge = getGrownBounds(newBounds, setBitmapTo1);
 
     resizeInternal(this, _bounds, merge, fillWithBlackAndTransparent, setBitmapTo1, usesBitMap(), output);
 
@@ -1154,8 +1270,7 @@ Image::ensureBounds(const RectI& newBounds,
     }
 
     QWriteLocker k(&_entryLock);
-    RectI merge = newBounds;
-    merge.merge(_bounds);
+    RectI merge = getGrownBounds(newBounds, setBitmapTo1);
 
     ImagePtr tmpImg;
     resizeInternal(this, _bounds, merge, fillWithBlackAndTransparent, setBitmapTo1, false, &tmpImg);
@@ -1353,10 +1468,27 @@ Image::pasteFrom(const Image & src,
         //glViewport( 0, 0, srcBounds.width(), srcBounds.height() );
         glViewport( roi.x1 - srcBounds.x1, roi.y1 - srcBounds.y1, roi.width(), roi.height() );
         glCheckFramebufferError();
-        // Ensure all drawing commands are finished
-        glFlush();
-        glFinish();
-        glCheckError();
+        // No glFinish() here: glReadPixels already waits for the commands that render to the framebuffer,
+        // and a full pipeline flush would also wait for unrelated work queued on the context.
+        if ( (getComponentsCount() == 4) && (getBitDepth() == src.getBitDepth()) ) {
+            // Same layout as the texture: read the rows directly into this image
+            // and skip the temporary RGBA buffer.
+            {
+                Image::WriteAccess acc(this);
+                unsigned char* data = acc.pixelAt(roi.x1, roi.y1);
+                glPixelStorei( GL_PACK_ROW_LENGTH, dstBounds.width() );
+                glPixelStorei(GL_PACK_ALIGNMENT, 1);
+                glReadPixels(roi.x1 - srcBounds.x1, roi.y1 - srcBounds.y1, roi.width(), roi.height(), src.getGLTextureFormat(), src.getGLTextureType(), (GLvoid*)data);
+                glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+                glPixelStorei(GL_PACK_ALIGNMENT, 4);
+                glBindTexture(target, 0);
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glCheckError();
+
+            return;
+        }
+
         // Read to a temporary RGBA buffer then convert to the image which may not be RGBA
 #ifdef BOOST_NO_CXX11_VARIADIC_TEMPLATES
         ImagePtr tmpImg( new Image( ImagePlaneDesc::getRGBAComponents(), getRoD(), roi, 0, getPixelAspectRatio(), getBitDepth(), getPremultiplication(), getFieldingOrder(), false, eStorageModeRAM) );
@@ -1413,23 +1545,41 @@ Image::fillForDepthForComponents(const RectI & roi_,
 {
     assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
 
-    RectI roi = roi_;
-    bool doInteresect = roi.intersect(_bounds, &roi);
-    if (!doInteresect) {
-        // no intersection between roi and the bounds of the image
-        return;
-    }
-
-    int rowElems = (int)getComponentsCount() * _bounds.width();
     const float fillValue[4] = {
         nComps == 1 ? a * maxValue : r * maxValue, g * maxValue, b * maxValue, a * maxValue
     };
 
+    if (_layout == eImagePixelLayoutPlanar) {
+        // each plane holds a single value
+        for (int k = 0; k < nComps; ++k) {
+            PixelSpan plane;
+            getChannelSpan(k, roi_, &plane);
+            if ( plane.isEmpty() ) {
+                return;
+            }
+            const PIX value = (PIX)fillValue[k];
+            const int width = plane.bounds.width();
+            for (int y = plane.bounds.y1; y < plane.bounds.y2; ++y) {
+                PIX* dst = plane.rowAt<PIX>(y);
+                std::fill(dst, dst + width, value);
+            }
+        }
 
-    // now we're safe: the image contains the area in roi
-    PIX* dst = (PIX*)pixelAt(roi.x1, roi.y1);
-    for ( int i = 0; i < roi.height(); ++i, dst += (rowElems - roi.width() * nComps) ) {
-        for (int j = 0; j < roi.width(); ++j, dst += nComps) {
+        return;
+    }
+
+    PixelSpan span;
+    getPixelSpan(roi_, &span);
+    if ( span.isEmpty() ) {
+        // no intersection between roi and the bounds of the image
+        return;
+    }
+
+    // now we're safe: the image contains the area in the span
+    const int width = span.bounds.width();
+    for (int y = span.bounds.y1; y < span.bounds.y2; ++y) {
+        PIX* dst = span.rowAt<PIX>(y);
+        for (int j = 0; j < width; ++j, dst += nComps) {
             for (int k = 0; k < nComps; ++k) {
                 dst[k] = fillValue[k];
             }
@@ -1624,6 +1774,7 @@ unsigned char*
 Image::pixelAt(int x,
                int y)
 {
+    assert(_layout == eImagePixelLayoutPacked);
     if ( ( x < _bounds.x1 ) || ( x >= _bounds.x2 ) || ( y < _bounds.y1 ) || ( y >= _bounds.y2 ) ) {
         return NULL;
     } else {
@@ -1666,6 +1817,7 @@ const unsigned char*
 Image::pixelAt(int x,
                int y) const
 {
+    assert(_layout == eImagePixelLayoutPacked);
     if ( ( x < _bounds.x1 ) || ( x >= _bounds.x2 ) || ( y < _bounds.y1 ) || ( y >= _bounds.y2 ) ) {
         return NULL;
     } else {
@@ -1681,6 +1833,92 @@ Image::pixelAt(int x,
     }
 }
 
+void
+Image::getPixelSpan(const RectI& roi,
+                    PixelSpan* span)
+{
+    RectI intersection;
+
+    if ( !roi.intersect(_bounds, &intersection) ) {
+        return;
+    }
+    span->data = pixelAt(intersection.x1, intersection.y1);
+    span->bounds = intersection;
+    span->pixelStride = _depthBytesSize * _nbComponents;
+    span->rowStride = span->pixelStride * _bounds.width();
+}
+
+void
+Image::getPixelSpan(const RectI& roi,
+                    ConstPixelSpan* span) const
+{
+    RectI intersection;
+
+    if ( !roi.intersect(_bounds, &intersection) ) {
+        return;
+    }
+    span->data = pixelAt(intersection.x1, intersection.y1);
+    span->bounds = intersection;
+    span->pixelStride = _depthBytesSize * _nbComponents;
+    span->rowStride = span->pixelStride * _bounds.width();
+}
+
+void
+Image::getChannelSpan(int channel,
+                      const RectI& roi,
+                      PixelSpan* span)
+{
+    assert(channel >= 0 && channel < _nbComponents);
+    RectI intersection;
+
+    if ( !roi.intersect(_bounds, &intersection) ) {
+        return;
+    }
+    unsigned char* data = (unsigned char*)_data.writable();
+    if (!data) {
+        return;
+    }
+    const std::size_t planeBytes = (std::size_t)_depthBytesSize * _bounds.area();
+    const std::size_t offset = (std::size_t)(intersection.y1 - _bounds.y1) * _bounds.width() + (intersection.x1 - _bounds.x1);
+    if (_layout == eImagePixelLayoutPlanar) {
+        span->data = data + channel * planeBytes + offset * _depthBytesSize;
+        span->pixelStride = _depthBytesSize;
+    } else {
+        span->data = data + (offset * _nbComponents + channel) * _depthBytesSize;
+        span->pixelStride = _depthBytesSize * _nbComponents;
+    }
+    span->bounds = intersection;
+    span->rowStride = span->pixelStride * _bounds.width();
+}
+
+void
+Image::getChannelSpan(int channel,
+                      const RectI& roi,
+                      ConstPixelSpan* span) const
+{
+    assert(channel >= 0 && channel < _nbComponents);
+    RectI intersection;
+
+    if ( !roi.intersect(_bounds, &intersection) ) {
+        return;
+    }
+    const unsigned char* data = (const unsigned char*)_data.readable();
+    if (!data) {
+        return;
+    }
+    const std::size_t planeBytes = (std::size_t)_depthBytesSize * _bounds.area();
+    const std::size_t offset = (std::size_t)(intersection.y1 - _bounds.y1) * _bounds.width() + (intersection.x1 - _bounds.x1);
+    if (_layout == eImagePixelLayoutPlanar) {
+        span->data = data + channel * planeBytes + offset * _depthBytesSize;
+        span->pixelStride = _depthBytesSize;
+    } else {
+        span->data = data + (offset * _nbComponents + channel) * _depthBytesSize;
+        span->pixelStride = _depthBytesSize * _nbComponents;
+    }
+    span->bounds = intersection;
+    span->rowStride = span->pixelStride * _bounds.width();
+}
+
 unsigned int
 Image::getComponentsCount() const
 {
@@ -1914,18 +2152,26 @@ Image::halveRoIForDepth(const RectI & roi,
                 continue;
             }
 
-            for (int k = 0; k < _nbComponents; ++k) {
-                ///a b
-                ///c d
+            if (sum == 4) {
+                // general case: the 4 source pixels are within srcBounds
+                for (int k = 0; k < _nbComponents; ++k) {
+                    dstPixStart[k] = ( srcPixStart[k] + srcPixStart[k + _nbComponents] +
+                                       srcPixStart[k + srcRowSize] + srcPixStart[k + srcRowSize + _nbComponents] ) / 4;
+                }
+            } else {
+                for (int k = 0; k < _nbComponents; ++k) {
+                    ///a b
+                    ///c d
 
-                const PIX a = (pickThisCol && pickThisRow) ? *(srcPixStart + k) : 0;
-                const PIX b = (pickNextCol && pickThisRow) ? *(srcPixStart + k + _nbComponents) : 0;
-                const PIX c = (pickThisCol && pickNextRow) ? *(srcPixStart + k + srcRowSize) : 0;
-                const PIX d = (pickNextCol && pickNextRow) ? *(srcPixStart + k + srcRowSize  + _nbComponents)  : 0;
+                    const PIX a = (pickThisCol && pickThisRow) ? *(srcPixStart + k) : 0;
+                    const PIX b = (pickNextCol && pickThisRow) ? *(srcPixStart + k + _nbComponents) : 0;
+                    const PIX c = (pickThisCol && pickNextRow) ? *(srcPixStart + k + srcRowSize) : 0;
+                    const PIX d = (pickNextCol && pickNextRow) ? *(srcPixStart + k + srcRowSize  + _nbComponents)  : 0;
 
-                assert( sumW == 2 || ( sumW == 1 && ( (a == 0 && c == 0) || (b == 0 && d == 0) ) ) );
-                assert( sumH == 2 || ( sumH == 1 && ( (a == 0 && b == 0) || (c == 0 && d == 0) ) ) );
-                dstPixStart[k] = (a + b + c + d) / sum;
+                    assert( sumW == 2 || ( sumW == 1 && ( (a == 0 && c == 0) || (b == 0 && d == 0) ) ) );
+                    assert( sumH == 2 || ( sumH == 1 && ( (a == 0 && b == 0) || (c == 0 && d == 0) ) ) );
+                    dstPixStart[k] = (a + b + c + d) / sum;
+                }
             }
 
             if (copyBitMap) {
@@ -1963,6 +2209,9 @@ Image::halveRoIForDepth(const RectI & roi,
             }
         }
     }
+    if (copyBitMap) {
+        output->_bitmap.notifyModified(dstRoI);
+    }
 } // halveRoIForDepth
 
 // code proofread and fixed by @devernay on 8/8/2014
@@ -2091,9 +2340,6 @@ Image::downscaleMipMap(const RectD& dstRod,
     assert( !copyBitMap || _bitmap.getBitmap() );
 
     RectI dstRoI  = roi.downscalePowerOfTwoSmallestEnclosing(downscaleLvls);
-    ImagePtr tmpImg = boost::make_shared<Image>( getComponents(), dstRod, dstRoI, toLevel, par, getBitDepth(), getPremultiplication(), getFieldingOrder(), true);
-
-    buildMipMapLevel( dstRod, roi, downscaleLvls, copyBitMap, tmpImg.get() );
 
     // check that the downscaled mipmap is inside the output image (it may not be equal to it)
     assert(dstRoI.x1 >= output->_bounds.x1);
@@ -2101,8 +2347,8 @@ Image::downscaleMipMap(const RectD& dstRod,
     assert(dstRoI.y1 >= output->_bounds.y1);
     assert(dstRoI.y2 <= output->_bounds.y2);
 
-    ///Now copy the result of tmpImg into the output image
-    output->pasteFrom(*tmpImg, dstRoI, copyBitMap);
+    ///Build the mipmap directly into the output image
+    buildMipMapLevel( dstRod, roi, downscaleLvls, copyBitMap, output );
 }
 
 bool
@@ -2275,13 +2521,24 @@ Image::buildMipMapLevel(const RectD& dstRoD,
         ///Halve the smallest enclosing po2 rect as we need to render a minimum of the renderWindow
         RectI halvedRoI = previousRoI.downscalePowerOfTwoSmallestEnclosing(1);
 
-        ///Allocate an image with half the size of the source image
-        dstImg = new Image( getComponents(), dstRoD, halvedRoI, getMipMapLevel() + i, getPixelAspectRatio(), getBitDepth(), getPremultiplication(), getFieldingOrder(), true);
+        /*
+           The last level is halved directly into the output image, saving an allocation and a full copy.
+           The 1D halving assumes the destination bounds start at the halved roi, so it still goes through
+           an intermediate image.
+         */
+        const bool halveToOutput = (i == level) && ( ( (previousRoI.width() > 1) && (previousRoI.height() > 1) ) ||
+                                                     (output->getBounds() == halvedRoI) );
+        if (halveToOutput) {
+            dstImg = output;
+        } else {
+            ///Allocate an image with half the size of the source image
+            dstImg = new Image( getComponents(), dstRoD, halvedRoI, getMipMapLevel() + i, getPixelAspectRatio(), getBitDepth(), getPremultiplication(), getFieldingOrder(), true);
+        }
 
         ///Half the source image into dstImg.
         ///We pass the closestPo2 roi which might not be the entire size of the source image
         ///If the source image'sroi was originally a po2.
-        srcImg->halveRoI(previousRoI, copyBitMap, dstImg);
+        srcImg->halveRoI(previousRoI, copyBitMap && dstImg->usesBitMap(), dstImg);
 
         ///Clean-up, we should use shared_ptrs for safety
         if (mustFreeSrc) {
@@ -2291,16 +2548,18 @@ Image::buildMipMapLevel(const RectD& dstRoD,
         ///Switch for next pass
         previousRoI = halvedRoI;
         srcImg = dstImg;
-        mustFreeSrc = true;
+        mustFreeSrc = !halveToOutput;
     }
 
-    assert(srcImg->getBounds() == lastLevelRoI);
-
-    ///Finally copy the last mipmap level into output.
-    output->pasteFrom( *srcImg, srcImg->getBounds(), copyBitMap);
+    assert(previousRoI == lastLevelRoI);
 
-    ///Clean-up, we should use shared_ptrs for safety
     if (mustFreeSrc) {
+        assert(srcImg->getBounds() == lastLevelRoI);
+
+        ///Finally copy the last mipmap level into output.
+        output->pasteFrom( *srcImg, srcImg->getBounds(), copyBitMap);
+
+        ///Clean-up, we should use shared_ptrs for safety
         delete srcImg;
     }
 } // buildMipMapLevel
@@ -2339,8 +2598,9 @@ Bitmap::copyRowPortion(int x1,
                        int y,
                        const Bitmap& other)
 {
+    assert(x1 >= _bounds.x1 && x2 <= _bounds.x2 && y >= _bounds.y1 && y < _bounds.y2);
     const char* srcBitmap = other.getBitmapAt(x1, y);
-    char* dstBitmap = getBitmapAt(x1, y);
+    char* dstBitmap = BM_GET(y, x1);
     const char* end = dstBitmap + (x2 - x1);
 
     while (dstBitmap < end) {
@@ -2348,6 +2608,7 @@ Bitmap::copyRowPortion(int x1,
         ++dstBitmap;
         ++srcBitmap;
     }
+    updateTiles(RectI(x1, y, x2, y + 1), -1);
 }
 
 void
@@ -2366,8 +2627,11 @@ Bitmap::copyBitmapPortion(const RectI& roi,
 
     int srcRowSize = other._bounds.width();
     int dstRowSize = _bounds.width();
+    if ( roi.isNull() ) {
+        return;
+    }
     const char* srcBitmap = other.getBitmapAt(roi.x1, roi.y1);
-    char* dstBitmap = getBitmapAt(roi.x1, roi.y1);
+    char* dstBitmap = BM_GET(roi.y1, roi.x1);
 
     for (int y = roi.y1; y < roi.y2; ++y,
          srcBitmap += srcRowSize,
@@ -2381,6 +2645,7 @@ Bitmap::copyBitmapPortion(const RectI& roi,
             ++dstCur;
         }
     }
+    updateTiles(roi, -1);
 }
 
 template <typename PIX, bool doPremult>
@@ -2398,13 +2663,15 @@ Image::premultInternal(const RectI& roi)
     PIX* dstPix = (PIX*)acc.pixelAt(renderWindow.x1, renderWindow.y1);
     for ( int y = renderWindow.y1; y < renderWindow.y2; ++y, dstPix += (srcRowElements - (renderWindow.x2 - renderWindow.x1) * 4) ) {
         for (int x = renderWindow.x1; x < renderWindow.x2; ++x, dstPix += 4) {
-            for (int c = 0; c < 3; ++c) {
-                if (doPremult) {
-                    dstPix[c] = PIX(float(dstPix[c]) * dstPix[3]);
-                } else {
-                    if (dstPix[3] != 0) {
-                        dstPix[c] = PIX( dstPix[c] / float(dstPix[3]) );
-                    }
+            // read alpha once: the writes to the color channels could otherwise alias it
+            const float alpha = dstPix[3];
+            if (doPremult) {
+                for (int c = 0; c < 3; ++c) {
+                    dstPix[c] = PIX(float(dstPix[c]) * alpha);
+                }
+            } else if (alpha != 0) {
+                for (int c = 0; c < 3; ++c) {
+                    dstPix[c] = PIX(dstPix[c] / alpha);
                 }
             }
         }
@@ -70,6 +70,8 @@ public:
     Bitmap(const RectI & bounds)
         : _bounds(bounds)
         , _map( bounds.area() )
+        , _tiles()
+        , _tilesPerRow(0)
         , _dirtyZone()
         , _dirtyZoneSet(false)
     {
@@ -78,11 +80,14 @@ public:
         // "!!!Note that if isIdentity is true it will allocate an empty image object with 0 bytes of data."
         //assert(!rod.isNull());
         std::fill(_map.begin(), _map.end(), 0);
+        initializeTiles(0);
     }
 
     Bitmap()
         : _bounds()
         , _map()
+        , _tiles()
+        , _tilesPerRow(0)
         , _dirtyZone()
         , _dirtyZoneSet(false)
     {
@@ -94,6 +99,7 @@ public:
         _map.resize( _bounds.area() );
 
         std::fill(_map.begin(), _map.end(), 0);
+        initializeTiles(0);
     }
 
     ~Bitmap()
@@ -103,6 +109,7 @@ public:
     void setTo1()
     {
         std::fill(_map.begin(), _map.end(), 1);
+        std::fill(_tiles.begin(), _tiles.end(), 1);
     }
 
     const RectI & getBounds() const
@@ -138,14 +145,30 @@ public:
         return &_map.front();
     }
 
+    /**
+     * @brief Non-const accessors to the raw map: the caller may write to it directly, so the
+     * tiles summary can no longer be trusted until the next marking.
+     **/
     char* getBitmap()
     {
+        invalidateTiles();
+
         return &_map.front();
     }
 
     const char* getBitmapAt(int x, int y) const;
+
+    /**
+     * @brief The caller writing through the returned pointer must call notifyModified() with the written
+     * portion once done, so that the tiles summary is updated.
+     **/
     char* getBitmapAt(int x, int y);
 
+    /**
+     * @brief Updates the tiles summary after roi was written through getBitmapAt().
+     **/
+    void notifyModified(const RectI& roi) { updateTiles(roi, -1); }
+
     void copyRowPortion(int x1, int x2, int y, const Bitmap& other);
 
     void copyBitmapPortion(const RectI& roi, const Bitmap& other);
@@ -156,13 +179,39 @@ public:
         _dirtyZoneSet = true;
     }
 
+    /**
+     * @brief Returns a mask of the values found in the given portion of a row (resp. column) of the bitmap:
+     * bit N is set if a pixel with the value N was found. The scan stops as soon as the mask intersects stopMask.
+     * The portion must be contained in the bounds of the bitmap.
+     **/
+    int getRowValues(int y, int x1, int x2, int stopMask) const;
+    int getColumnValues(int x, int y1, int y2, int stopMask) const;
+
 private:
     void markFor(const RectI & roi, char value);
 
+    void initializeTiles(char value);
+
+    void invalidateTiles();
+
+    /**
+     * @brief Updates the summary of the tiles intersecting roi after it was filled with value, or
+     * after it was modified arbitrarily if value is -1.
+     **/
+    void updateTiles(const RectI& roi, int value);
+
 private:
     RectI _bounds;
     std::vector<char> _map;
 
+    /**
+     * A coarse summary of _map: one entry per square tile of NATRON_BITMAP_TILE_SIZE pixels, holding the value
+     * shared by all the pixels of the tile, or NATRON_BITMAP_TILE_MIXED. Queries skip uniform tiles entirely and
+     * only scan the pixels of mixed tiles.
+     **/
+    std::vector<char> _tiles;
+    int _tilesPerRow;
+
     /**
      * This represents the zone that has potentially something to render. In minimalNonMarkedRects
      * we intersect the region of interest with the dirty zone. This is useful to optimize the bitmap checking
@@ -196,7 +245,8 @@ public:
           ImageFieldingOrderEnum fielding,
           bool useBitmap = false,
           StorageModeEnum storage = eStorageModeRAM,
-          U32 textureTarget = GL_TEXTURE_2D);
+          U32 textureTarget = GL_TEXTURE_2D,
+          ImagePixelLayoutEnum layout = eImagePixelLayoutPacked);
 
     //Same as above but parameters are in the ImageParams object
     Image(const ImageKey & key,
@@ -207,6 +257,12 @@ public:
 
     bool usesBitMap() const { return _useBitmap; }
 
+    /**
+     * @brief Cached images are always packed. A planar image is a local RAM image only meant to be passed
+     * between host-side processing steps, it is never handed to plug-ins.
+     **/
+    ImagePixelLayoutEnum getPixelLayout() const { return _layout; }
+
     StorageModeEnum getStorageMode() const
     {
         return _params->getStorageInfo().mode;
@@ -261,6 +317,12 @@ public:
 
 private:
 
+    /**
+     * @brief Returns the bounds to allocate so that the image contains both its current bounds and newBounds.
+     * When possible these are rounded out to a fixed grid so that consecutive growths reallocate less often.
+     **/
+    RectI getGrownBounds(const RectI& newBounds, bool setBitmapTo1) const;
+
     static void resizeInternal(const Image* srcImg,
                                const RectI& srcBounds,
                                const RectI& merge,
@@ -362,6 +424,58 @@ public:
     unsigned int getRowElements() const;
 
 
+    /**
+     * @brief A rectangular portion of the image buffer, obtained from a ReadAccess or WriteAccess: a whole region
+     * can be processed under a single lock acquisition, without computing the address of each pixel.
+     * Consecutive pixels of a row are pixelStride bytes apart and consecutive rows are rowStride bytes apart.
+     * The span may no longer be used once the access it was obtained from dies.
+     **/
+    template <typename BYTE>
+    struct PixelSpanT
+    {
+        // The pixel at (bounds.x1, bounds.y1), NULL if the span is empty
+        BYTE* data;
+
+        // The part of the requested region which is inside the image
+        RectI bounds;
+
+        // Size in bytes of a pixel and of a row of the image
+        std::size_t pixelStride;
+        std::size_t rowStride;
+
+        PixelSpanT()
+            : data(0)
+            , bounds()
+            , pixelStride(0)
+            , rowStride(0)
+        {
+        }
+
+        bool isEmpty() const
+        {
+            return !data;
+        }
+
+        bool containsRow(int y) const
+        {
+            return data && y >= bounds.y1 && y < bounds.y2;
+        }
+
+        /**
+         * @brief Returns the pixel at (bounds.x1, y), y must be in [bounds.y1, bounds.y2[.
+         **/
+        template <typename PIX>
+        PIX* rowAt(int y) const
+        {
+            assert( containsRow(y) );
+
+            return reinterpret_cast<PIX*>( data + (std::size_t)(y - bounds.y1) * rowStride );
+        }
+    };
+
+    typedef PixelSpanT<unsigned char> PixelSpan;
+    typedef PixelSpanT<const unsigned char> ConstPixelSpan;
+
     /**
      * @brief Lock the image for reading, while this object is living, the image buffer can't be written to.
      * You must ensure that the image will live as long as this object lives otherwise the pointer will be invalidated.
@@ -411,6 +525,37 @@ public:
             return img->pixelAt(x, y);
         }
 
+        /**
+         * @brief Returns the portion of roi inside the image, empty if there is no image.
+         **/
+        ConstPixelSpan spanAt(const RectI& roi) const
+        {
+            ConstPixelSpan ret;
+
+            if (img) {
+                img->getPixelSpan(roi, &ret);
+            }
+
+            return ret;
+        }
+
+        /**
+         * @brief Returns the given channel of the portion of roi inside the image, empty if there is no image.
+         * This works for both pixel layouts and does not copy anything: the pixelStride of the span tells
+         * how far apart the samples of the channel are.
+         **/
+        ConstPixelSpan channelSpanAt(int channel,
+                                     const RectI& roi) const
+        {
+            ConstPixelSpan ret;
+
+            if (img) {
+                img->getChannelSpan(channel, roi, &ret);
+            }
+
+            return ret;
+        }
+
         const char* bitmapAt(int x,
                              int y) const
         {
@@ -463,6 +608,34 @@ public:
             return img->pixelAt(x, y);
         }
 
+        /**
+         * @brief Returns the portion of roi inside the image.
+         **/
+        PixelSpan spanAt(const RectI& roi)
+        {
+            PixelSpan ret;
+
+            img->getPixelSpan(roi, &ret);
+
+            return ret;
+        }
+
+        /**
+         * @brief Returns the given channel of the portion of roi inside the image.
+         **/
+        PixelSpan channelSpanAt(int channel,
+                                const RectI& roi)
+        {
+            PixelSpan ret;
+
+            img->getChannelSpan(channel, roi, &ret);
+
+            return ret;
+        }
+
+        /**
+         * @brief The caller writing to the bitmap must call notifyBitmapModified() with the written portion once done.
+         **/
         char* bitmapAt(int x,
                        int y) const
         {
@@ -470,6 +643,12 @@ public:
 
             return img->getBitmapAt(x, y);
         }
+
+        void notifyBitmapModified(const RectI& roi) const
+        {
+            assert(img);
+            img->_bitmap.notifyModified(roi);
+        }
     };
 
     typedef boost::shared_ptr<WriteAccess> WriteAccessPtr;
@@ -510,10 +689,23 @@ private:
 
     /**
      * @brief Access pixels. The pointer must be cast to the appropriate type afterwards.
+     * Only valid for packed images.
      **/
     unsigned char* pixelAt(int x, int y);
     const unsigned char* pixelAt(int x, int y) const;
 
+    /**
+     * @brief Fills span with the portion of roi inside the bounds of the image. Only valid for packed images.
+     **/
+    void getPixelSpan(const RectI& roi, PixelSpan* span);
+    void getPixelSpan(const RectI& roi, ConstPixelSpan* span) const;
+
+    /**
+     * @brief Fills span with the given channel of the portion of roi inside the bounds of the image.
+     **/
+    void getChannelSpan(int channel, const RectI& roi, PixelSpan* span);
+    void getChannelSpan(int channel, const RectI& roi, ConstPixelSpan* span) const;
+
     /**
      * @brief Locks the image for read/write access.
      * There can be a deadlock situation in the following situation:
@@ -1037,6 +1229,7 @@ private:
     ImagePremultiplicationEnum _premult;
     bool _useBitmap;
     int _nbComponents;
+    ImagePixelLayoutEnum _layout;
 };
 
 //template <> inline unsigned char clamp(unsigned char v) { return v; }
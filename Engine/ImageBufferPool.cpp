@@ -0,0 +1,345 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ImageBufferPool.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+#include <cstdlib> // free
+#include <map>
+#include <new> // bad_alloc
+#include <utility>
+#include <vector>
+
+#ifdef __NATRON_WIN32__
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+#include <QtCore/QMutex>
+
+#include "Engine/NumaInfo.h"
+
+// Size of the huge pages used with MAP_HUGETLB, the default huge page size on x86 and arm64
+#define NATRON_IMAGE_BUFFER_POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Large buffers are unmapped by chunks of this size (a multiple of the huge page size): the process address space
+// is locked while unmapping, which would otherwise stall the page faults of all the other threads
+#define NATRON_IMAGE_BUFFER_POOL_UNMAP_CHUNK_SIZE (16 * 1024 * 1024)
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// The free buffers, by size class
+typedef std::map<std::size_t, std::vector<void*> > FreeLists;
+
+struct PoolData
+{
+    QMutex lock;
+
+    // The free lists of each NUMA node
+    std::vector<FreeLists> freeLists;
+
+    // The node of the buffers that were bound to a node
+    std::map<void*, int> bufferNodes;
+    std::size_t maxFreeBytes;
+    ImageBufferPool::Stats stats;
+    ImageBufferPool::HugePagesModeEnum hugePagesMode;
+    bool prefault;
+
+    PoolData()
+        : lock()
+        , freeLists()
+        , bufferNodes()
+        , maxFreeBytes(0)
+        , stats()
+        , hugePagesMode(ImageBufferPool::eHugePagesModeNone)
+        , prefault(false)
+    {
+        stats.usedBytes = stats.freeBytes = stats.hits = stats.misses = 0;
+    }
+};
+
+// Never destroyed: buffers may still be released while the application exits
+PoolData* pool = new PoolData();
+
+// Rounds size up to its size class: 4 classes per power of 2
+std::size_t
+getClassSize(std::size_t size)
+{
+    int log2 = 0;
+
+    while ( ( (std::size_t)2 << log2 ) <= size ) {
+        ++log2;
+    }
+    std::size_t p = (std::size_t)1 << log2;
+    std::size_t step = p / 4;
+    std::size_t k = (size - p + step - 1) / step;
+
+    return p + k * step;
+}
+
+void*
+mapBuffer(std::size_t size,
+          ImageBufferPool::HugePagesModeEnum mode,
+          bool prefault)
+{
+#ifdef __NATRON_WIN32__
+    Q_UNUSED(mode);
+    Q_UNUSED(prefault);
+
+    return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+    if (prefault) {
+        // Fault all the pages in at once rather than one by one while the image is rendered
+        flags |= MAP_POPULATE;
+    }
+#else
+    Q_UNUSED(prefault);
+#endif
+    void* ret = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if ( (mode == ImageBufferPool::eHugePagesModeExplicit) && (size % NATRON_IMAGE_BUFFER_POOL_HUGE_PAGE_SIZE == 0) ) {
+        // Fails if the system has no huge pages left
+        ret = mmap(0, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if (ret == MAP_FAILED) {
+        ret = mmap(0, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (ret == MAP_FAILED) {
+            return 0;
+        }
+#ifdef MADV_HUGEPAGE
+        if (mode != ImageBufferPool::eHugePagesModeNone) {
+            madvise(ret, size, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    return ret;
+#endif // ifdef __NATRON_WIN32__
+}
+
+void
+unmapBuffer(void* ptr,
+            std::size_t size)
+{
+#ifdef __NATRON_WIN32__
+    Q_UNUSED(size);
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    char* p = (char*)ptr;
+    while (size > 0) {
+        std::size_t chunk = std::min(size, (std::size_t)NATRON_IMAGE_BUFFER_POOL_UNMAP_CHUNK_SIZE);
+        munmap(p, chunk);
+        p += chunk;
+        size -= chunk;
+    }
+#endif
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+namespace ImageBufferPool {
+
+void*
+allocate(std::size_t size,
+         std::size_t* allocatedSize)
+{
+    if (size < NATRON_IMAGE_BUFFER_POOL_MIN_SIZE) {
+        void* ret = allocateNumaLocalMemory(size);
+        if (!ret) {
+            throw std::bad_alloc();
+        }
+        *allocatedSize = size;
+
+        return ret;
+    }
+
+    std::size_t classSize = getClassSize(size);
+    int node = -1;
+    if ( isNumaAwareRenderingEnabled() && (getNumaNodesCount() > 1) ) {
+        node = getCurrentThreadNumaNode();
+    }
+
+    HugePagesModeEnum mode;
+    bool prefault;
+    {
+        QMutexLocker k(&pool->lock);
+        std::size_t listIndex = node < 0 ? 0 : node;
+        if ( listIndex < pool->freeLists.size() ) {
+            FreeLists::iterator found = pool->freeLists[listIndex].find(classSize);
+            if ( ( found != pool->freeLists[listIndex].end() ) && !found->second.empty() ) {
+                void* ret = found->second.back();
+                found->second.pop_back();
+                pool->stats.freeBytes -= classSize;
+                pool->stats.usedBytes += classSize;
+                ++pool->stats.hits;
+                *allocatedSize = classSize;
+
+                return ret;
+            }
+        }
+        ++pool->stats.misses;
+        mode = pool->hugePagesMode;
+        prefault = pool->prefault;
+    }
+
+    // Pre-faulting would place the pages before they are bound to the node
+    prefault = prefault && node < 0;
+    void* ret = mapBuffer(classSize, mode, prefault);
+    if (!ret) {
+        // Give the memory kept for reuse back to the system and try again
+        purge();
+        ret = mapBuffer(classSize, mode, prefault);
+        if (!ret) {
+            throw std::bad_alloc();
+        }
+    }
+    // The pages are not touched yet, bind them before the render thread fills them
+    bool bound = (node >= 0) && bindMemoryToNumaNode(ret, classSize, node);
+
+    QMutexLocker k(&pool->lock);
+    if (bound) {
+        pool->bufferNodes[ret] = node;
+    }
+    pool->stats.usedBytes += classSize;
+    *allocatedSize = classSize;
+
+    return ret;
+} // allocate
+
+void
+release(void* ptr,
+        std::size_t allocatedSize)
+{
+    if (!ptr) {
+        return;
+    }
+    if (allocatedSize < NATRON_IMAGE_BUFFER_POOL_MIN_SIZE) {
+        std::free(ptr);
+
+        return;
+    }
+
+    assert(getClassSize(allocatedSize) == allocatedSize);
+    {
+        QMutexLocker k(&pool->lock);
+        pool->stats.usedBytes -= std::min(allocatedSize, pool->stats.usedBytes);
+        if (pool->stats.freeBytes + allocatedSize <= pool->maxFreeBytes) {
+            std::size_t listIndex = 0;
+            std::map<void*, int>::iterator found = pool->bufferNodes.find(ptr);
+            if ( found != pool->bufferNodes.end() ) {
+                listIndex = found->second;
+            }
+            if ( listIndex >= pool->freeLists.size() ) {
+                pool->freeLists.resize( std::max( (std::size_t)getNumaNodesCount(), listIndex + 1 ) );
+            }
+            pool->freeLists[listIndex][allocatedSize].push_back(ptr);
+            pool->stats.freeBytes += allocatedSize;
+
+            return;
+        }
+        pool->bufferNodes.erase(ptr);
+    }
+    unmapBuffer(ptr, allocatedSize);
+} // release
+
+void
+setMaximumFreeSize(std::size_t size)
+{
+    bool mustPurge;
+    {
+        QMutexLocker k(&pool->lock);
+        pool->maxFreeBytes = size;
+        mustPurge = pool->stats.freeBytes > size;
+    }
+    if (mustPurge) {
+        purge();
+    }
+}
+
+void
+setHugePagesMode(HugePagesModeEnum mode)
+{
+    QMutexLocker k(&pool->lock);
+
+    // The buffers already allocated keep their pages
+    pool->hugePagesMode = mode;
+}
+
+void
+setPrefaultEnabled(bool enabled)
+{
+    QMutexLocker k(&pool->lock);
+
+    pool->prefault = enabled;
+}
+
+void
+purge()
+{
+    std::vector<FreeLists> freeLists;
+    {
+        QMutexLocker k(&pool->lock);
+        freeLists.swap(pool->freeLists);
+        for (std::size_t i = 0; i < freeLists.size(); ++i) {
+            for (FreeLists::iterator it = freeLists[i].begin(); it != freeLists[i].end(); ++it) {
+                for (std::size_t j = 0; j < it->second.size(); ++j) {
+                    pool->bufferNodes.erase(it->second[j]);
+                }
+            }
+        }
+        pool->stats.freeBytes = 0;
+    }
+
+    // Unmap outside of the lock, this may be slow
+    for (std::size_t i = 0; i < freeLists.size(); ++i) {
+        for (FreeLists::iterator it = freeLists[i].begin(); it != freeLists[i].end(); ++it) {
+            for (std::size_t j = 0; j < it->second.size(); ++j) {
+                unmapBuffer(it->second[j], it->first);
+            }
+        }
+    }
+} // purge
+
+void
+getStats(Stats* stats)
+{
+    QMutexLocker k(&pool->lock);
+
+    *stats = pool->stats;
+}
+
+} // namespace ImageBufferPool
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,105 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_ImageBufferPool_h
+#define Engine_ImageBufferPool_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef> // std::size_t
+
+// Buffers smaller than this are allocated with malloc and never pooled
+#define NATRON_IMAGE_BUFFER_POOL_MIN_SIZE (256 * 1024)
+
+// Default percentage of the RAM cache size that the pool may keep for reuse
+#define NATRON_IMAGE_BUFFER_POOL_MAX_PERCENT 0.1
+
+NATRON_NAMESPACE_ENTER
+
+// A size-class pool for the RAM buffers of the cache entries (see RamBuffer).
+// Images are sized to their region of interest and destroyed constantly, which makes the system allocator
+// map, zero and unmap the same amount of memory over and over. Large buffers are instead rounded up to a size class
+// (4 classes per power of 2, so at most 25% of waste) and released buffers, e.g. by the cache deleter thread, are
+// kept in a free list of their class to be reused right away, up to a maximum amount of memory.
+// Pooled buffers are mapped directly, optionally with huge pages, and are bound to the NUMA node of the allocating
+// thread when NUMA-aware rendering is enabled: each node has its own free lists.
+
+namespace ImageBufferPool {
+
+enum HugePagesModeEnum
+{
+    eHugePagesModeNone = 0, // Use regular pages
+    eHugePagesModeTransparent, // Advise the kernel to back the buffers with transparent huge pages
+    eHugePagesModeExplicit // Use the pre-allocated huge pages of the system, falling back on transparent huge pages
+};
+
+struct Stats
+{
+    // Memory of the pooled buffers currently used
+    std::size_t usedBytes;
+
+    // Memory kept in the free lists for reuse
+    std::size_t freeBytes;
+
+    // Number of allocations served from the free lists, and by mapping new memory
+    std::size_t hits, misses;
+};
+
+/**
+ * @brief Allocates at least size bytes. *allocatedSize is set to the amount that must be given back to release().
+ * WARNING: This function throws a std::bad_alloc if the allocation fails.
+ **/
+void* allocate(std::size_t size, std::size_t* allocatedSize);
+
+/**
+ * @brief Releases a buffer returned by allocate(), it is kept for reuse if the pool is not full.
+ **/
+void release(void* ptr, std::size_t allocatedSize);
+
+/**
+ * @brief Sets the maximum amount of memory the free lists may hold, the extra buffers are released to the system.
+ **/
+void setMaximumFreeSize(std::size_t size);
+
+void setHugePagesMode(HugePagesModeEnum mode);
+
+/**
+ * @brief When enabled, the new buffers are faulted in when they are mapped rather than one page at a time while
+ * they are first written to. Combined with the reuse of released buffers, the render threads rarely page-fault.
+ **/
+void setPrefaultEnabled(bool enabled);
+
+/**
+ * @brief Releases all the buffers of the free lists to the system, e.g: when the system runs out of memory.
+ **/
+void purge();
+
+void getStats(Stats* stats);
+
+} // namespace ImageBufferPool
+
+NATRON_NAMESPACE_EXIT
+
+#endif // ifndef Engine_ImageBufferPool_h
@@ -39,6 +39,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #include "Engine/AppManager.h"
 #include "Engine/Lut.h"
+#include "Engine/RenderTrace.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -163,6 +164,32 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
     if ( intersection.isNull() ) {
         return;
     }
+
+    if (!srcLut && !dstLut) {
+        /*
+           Without colorspace conversion there is no error diffusion: every channel is converted independently.
+           Process each row as a flat array so that the compiler can vectorize the conversion.
+         */
+        const int rowElements = intersection.width() * nComp;
+        for (int y = intersection.y1; y < intersection.y2; ++y) {
+            const SRCPIX* srcPixels = (const SRCPIX*)srcImg.pixelAt(intersection.x1, y);
+            DSTPIX* dstPixels = (DSTPIX*)dstImg.pixelAt(intersection.x1, y);
+#         ifdef DEBUG
+            for (int i = 0; i < rowElements; ++i) {
+                assert( !(boost::math::isnan)(srcPixels[i]) ); // check for NaN
+            }
+#         endif
+            for (int i = 0; i < rowElements; ++i) {
+                dstPixels[i] = convertPixelDepth<SRCPIX, DSTPIX>(srcPixels[i]);
+            }
+            if (copyBitmap) {
+                dstImg.copyBitmapRowPortion(intersection.x1, intersection.x2, y, srcImg);
+            }
+        }
+
+        return;
+    }
+
     for (int y = 0; y < intersection.height(); ++y) {
         // coverity[dont_call]
         int start = rand() % intersection.width();
@@ -679,6 +706,7 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                              bool requiresUnpremult,
                              Image* dstImg) const
 {
+    RenderTraceScope traceScope("convert", "convertToFormat");
     QWriteLocker k(&dstImg->_entryLock);
     QReadLocker k2(&_entryLock);
 
@@ -66,6 +66,7 @@ Image::copyUnProcessedChannelsForPremult(const std::bitset<4> processChannels,
             ( (doB == !processChannels[2]) || !(dstNComps >= 3) ) &&
             ( (doA == !processChannels[3]) || !(dstNComps == 1 || dstNComps == 4) ) );
     ReadAccess acc( originalImage.get() );
+    const ConstPixelSpan srcSpan = acc.spanAt(roi);
     int dstRowElements = dstNComps * _bounds.width();
     PIX* dst_pixels = (PIX*)pixelAt(roi.x1, roi.y1);
     assert(dst_pixels);
@@ -73,8 +74,11 @@ Image::copyUnProcessedChannelsForPremult(const std::bitset<4> processChannels,
     assert(dstNComps == 1 || dstNComps == 4 || !premult); // only A or RGBA can be premult
 
     for ( int y = roi.y1; y < roi.y2; ++y, dst_pixels += (dstRowElements - (roi.x2 - roi.x1) * dstNComps) ) {
+        // Fetch the row of the original image once, pixelAt() is too costly to be called for each pixel
+        const int srcX1 = srcSpan.bounds.x1, srcX2 = srcSpan.bounds.x2;
+        const PIX* src_row = srcSpan.containsRow(y) ? srcSpan.rowAt<const PIX>(y) : 0;
         for (int x = roi.x1; x < roi.x2; ++x, dst_pixels += dstNComps) {
-            const PIX* src_pixels = originalImage ? (const PIX*)acc.pixelAt(x, y) : 0;
+            const PIX* src_pixels = ( src_row && (x >= srcX1) && (x < srcX2) ) ? src_row + (x - srcX1) * srcNComps : 0;
             PIX srcA = src_pixels ? maxValue : 0; /* be opaque for anything that doesn't contain alpha */
             if ( ( (srcNComps == 1) || (srcNComps == 4) ) && src_pixels ) {
 #             ifdef DEBUG
@@ -213,6 +217,7 @@ Image::copyUnProcessedChannelsForPremult(const bool premult,
                                          const ImagePtr& originalImage)
 {
     ReadAccess acc( originalImage.get() );
+    const ConstPixelSpan srcSpan = acc.spanAt(roi);
     int dstRowElements = dstNComps * _bounds.width();
     PIX* dst_pixels = (PIX*)pixelAt(roi.x1, roi.y1);
 
@@ -227,8 +232,11 @@ Image::copyUnProcessedChannelsForPremult(const bool premult,
     Q_UNUSED(originalPremult);
 
     for ( int y = roi.y1; y < roi.y2; ++y, dst_pixels += (dstRowElements - (roi.x2 - roi.x1) * dstNComps) ) {
+        // Fetch the row of the original image once, pixelAt() is too costly to be called for each pixel
+        const int srcX1 = srcSpan.bounds.x1, srcX2 = srcSpan.bounds.x2;
+        const PIX* src_row = srcSpan.containsRow(y) ? srcSpan.rowAt<const PIX>(y) : 0;
         for (int x = roi.x1; x < roi.x2; ++x, dst_pixels += dstNComps) {
-            const PIX* src_pixels = originalImage ? (const PIX*)acc.pixelAt(x, y) : 0;
+            const PIX* src_pixels = ( src_row && (x >= srcX1) && (x < srcX2) ) ? src_row + (x - srcX1) * srcNComps : 0;
             PIX srcA = src_pixels ? maxValue : 0; /* be opaque for anything that doesn't contain alpha */
             if ( ( (srcNComps == 1) || (srcNComps == 4) ) && src_pixels ) {
 #             ifdef DEBUG
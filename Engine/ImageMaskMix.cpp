@@ -42,11 +42,25 @@ Image::applyMaskMixForMaskInvert(const RectI& roi,
     PIX* dst_pixels = (PIX*)pixelAt(roi.x1, roi.y1);
     unsigned int dstRowElements = _bounds.width() * getComponentsCount();
 
+    const int maskNComps = maskImg ? (int)maskImg->getComponentsCount() : 0;
+
+    // Lock the original and mask images once for the whole roi
+    ReadAccess srcAcc(originalImg);
+    ReadAccess maskAcc(masked ? maskImg : 0);
+    const ConstPixelSpan srcSpan = srcAcc.spanAt(roi);
+    const ConstPixelSpan maskSpan = maskAcc.spanAt(roi);
+    const int srcX1 = srcSpan.bounds.x1, srcX2 = srcSpan.bounds.x2;
+    const int maskX1 = maskSpan.bounds.x1, maskX2 = maskSpan.bounds.x2;
+
     for ( int y = roi.y1; y < roi.y2; ++y,
           dst_pixels += (dstRowElements - (roi.x2 - roi.x1) * dstNComps) ) { // 1 row stride minus what was done at previous iteration
+        // Fetch the rows of the original and mask images once, pixelAt() is too costly to be called for each pixel
+        const PIX* src_row = srcSpan.containsRow(y) ? srcSpan.rowAt<const PIX>(y) : 0;
+        const PIX* mask_row = maskSpan.containsRow(y) ? maskSpan.rowAt<const PIX>(y) : 0;
+
         for (int x = roi.x1; x < roi.x2; ++x,
              dst_pixels += dstNComps) {
-            const PIX* src_pixels = originalImg ? (const PIX*)originalImg->pixelAt(x, y) : 0;
+            const PIX* src_pixels = ( src_row && (x >= srcX1) && (x < srcX2) ) ? src_row + (x - srcX1) * srcNComps : 0;
             float maskScale = 1.f;
             if (!masked) {
                 // just mix
@@ -65,7 +79,7 @@ Image::applyMaskMixForMaskInvert(const RectI& roi,
                     }
                 }
             } else {
-                const PIX* maskPixels = maskImg ? (const PIX*)maskImg->pixelAt(x, y) : 0;
+                const PIX* maskPixels = ( mask_row && (x >= maskX1) && (x < maskX2) ) ? mask_row + (x - maskX1) * maskNComps : 0;
                 // figure the scale factor from that pixel
                 if (maskPixels == 0) {
                     maskScale = maskInvert ? 1.f : 0.f;
@@ -75,10 +75,10 @@ void
 ImagePlaneDesc::save(Archive & ar,
                            const unsigned int /*version*/) const
 {
-    ar &  boost::serialization::make_nvp("PlaneID", _planeID);
-    ar &  boost::serialization::make_nvp("PlaneLabel", _planeLabel);
-    ar &  boost::serialization::make_nvp("ChannelsLabel", _channelsLabel);
-    ar &  boost::serialization::make_nvp("Channels", _channels);
+    ar &  boost::serialization::make_nvp("PlaneID", getPlaneID());
+    ar &  boost::serialization::make_nvp("PlaneLabel", getPlaneLabel());
+    ar &  boost::serialization::make_nvp("ChannelsLabel", getChannelsLabel());
+    ar &  boost::serialization::make_nvp("Channels", getChannels());
 }
 
 template<class Archive>
@@ -86,17 +86,21 @@ void
 ImagePlaneDesc::load(Archive & ar,
                      const unsigned int version)
 {
+    std::string planeID, planeLabel, channelsLabel;
+    std::vector<std::string> channels;
+
     if (version < IMAGEPLANEDESC_SERIALIZATION_INTRODUCES_ID) {
-        ar &  boost::serialization::make_nvp("Layer", _planeID);
-        _planeLabel = _planeID;
-        ar &  boost::serialization::make_nvp("Components", _channels);
-        ar &  boost::serialization::make_nvp("CompName", _channelsLabel);
+        ar &  boost::serialization::make_nvp("Layer", planeID);
+        planeLabel = planeID;
+        ar &  boost::serialization::make_nvp("Components", channels);
+        ar &  boost::serialization::make_nvp("CompName", channelsLabel);
     } else {
-        ar &  boost::serialization::make_nvp("PlaneID", _planeID);
-        ar &  boost::serialization::make_nvp("PlaneLabel", _planeLabel);
-        ar &  boost::serialization::make_nvp("ChannelsLabel", _channelsLabel);
-        ar &  boost::serialization::make_nvp("Channels", _channels);
+        ar &  boost::serialization::make_nvp("PlaneID", planeID);
+        ar &  boost::serialization::make_nvp("PlaneLabel", planeLabel);
+        ar &  boost::serialization::make_nvp("ChannelsLabel", channelsLabel);
+        ar &  boost::serialization::make_nvp("Channels", channels);
     }
+    _imp = intern(planeID, planeLabel, channelsLabel, channels);
 }
 
 template<class Archive>
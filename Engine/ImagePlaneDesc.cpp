@@ -31,6 +31,9 @@
 #include <stdexcept>
 #include <cstring>
 #include <sstream>
+#include <map>
+
+#include <QtCore/QMutex>
 
 NATRON_NAMESPACE_ENTER
 
@@ -41,13 +44,115 @@ static const char* motionComps[2] = {"U", "V"};
 static const char* disparityComps[2] = {"X", "Y"};
 static const char* xyComps[2] = {"X", "Y"};
 
+struct ImagePlaneDescData
+{
+    std::string planeID, planeLabel;
+    std::vector<std::string> channels;
+    std::string channelsLabel;
 
-ImagePlaneDesc::ImagePlaneDesc()
-: _planeID("none")
+    // Index of planeID in the registry
+    int planeIndex;
 
-, _planeLabel("none")
-, _channels()
-, _channelsLabel("none")
+    ImagePlaneDescData()
+    : planeID()
+    , planeLabel()
+    , channels()
+    , channelsLabel()
+    , planeIndex(-1)
+    {
+    }
+};
+
+typedef boost::shared_ptr<const ImagePlaneDescData> ImagePlaneDescDataPtr;
+
+namespace {
+/**
+ * @brief Holds all the plane descriptions created during the lifetime of the process.
+ * Entries are never removed: the number of distinct planes stays small, even for multi-layer EXR files.
+ **/
+struct ImagePlaneDescRegistry
+{
+    struct DataKey
+    {
+        std::string planeID, planeLabel, channelsLabel;
+        std::vector<std::string> channels;
+
+        bool operator<(const DataKey& other) const
+        {
+            if (planeID != other.planeID) {
+                return planeID < other.planeID;
+            }
+            if (channels != other.channels) {
+                return channels < other.channels;
+            }
+            if (planeLabel != other.planeLabel) {
+                return planeLabel < other.planeLabel;
+            }
+
+            return channelsLabel < other.channelsLabel;
+        }
+    };
+
+    QMutex lock;
+    std::map<std::string, int> planeIndices;
+    std::map<DataKey, ImagePlaneDescDataPtr> descs;
+
+    ImagePlaneDescRegistry()
+    : lock()
+    , planeIndices()
+    , descs()
+    {
+    }
+};
+
+ImagePlaneDescRegistry&
+getImagePlaneDescRegistry()
+{
+    static ImagePlaneDescRegistry registry;
+
+    return registry;
+}
+} // anon namespace
+
+boost::shared_ptr<const ImagePlaneDescData>
+ImagePlaneDesc::intern(const std::string& planeID,
+                       const std::string& planeLabel,
+                       const std::string& channelsLabel,
+                       const std::vector<std::string>& channels)
+{
+    ImagePlaneDescRegistry& registry = getImagePlaneDescRegistry();
+    ImagePlaneDescRegistry::DataKey key;
+
+    key.planeID = planeID;
+    key.planeLabel = planeLabel;
+    key.channelsLabel = channelsLabel;
+    key.channels = channels;
+
+    QMutexLocker k(&registry.lock);
+    std::map<ImagePlaneDescRegistry::DataKey, ImagePlaneDescDataPtr>::iterator found = registry.descs.find(key);
+    if ( found != registry.descs.end() ) {
+        return found->second;
+    }
+
+    boost::shared_ptr<ImagePlaneDescData> data(new ImagePlaneDescData);
+    data->planeID = planeID;
+    data->planeLabel = planeLabel;
+    data->channels = channels;
+    data->channelsLabel = channelsLabel;
+    std::map<std::string, int>::iterator foundIndex = registry.planeIndices.find(planeID);
+    if ( foundIndex != registry.planeIndices.end() ) {
+        data->planeIndex = foundIndex->second;
+    } else {
+        data->planeIndex = (int)registry.planeIndices.size();
+        registry.planeIndices.insert( std::make_pair(planeID, data->planeIndex) );
+    }
+    registry.descs.insert( std::make_pair(key, data) );
+
+    return data;
+}
+
+ImagePlaneDesc::ImagePlaneDesc()
+: _imp( intern( "none", "none", "none", std::vector<std::string>() ) )
 {
 }
 
@@ -55,21 +160,19 @@ ImagePlaneDesc::ImagePlaneDesc(const std::string& planeID,
                                const std::string& planeLabel,
                                const std::string& channelsLabel,
                                const std::vector<std::string>& channels)
-: _planeID(planeID)
-, _planeLabel(planeLabel)
-, _channels(channels)
-, _channelsLabel(channelsLabel)
-{
-    if (planeLabel.empty()) {
-        // Plane label is the ID if empty
-        _planeLabel = _planeID;
-    }
+: _imp()
+{
+    // Plane label is the ID if empty
+    std::string label = planeLabel.empty() ? planeID : planeLabel;
+    std::string compsLabel = channelsLabel;
+
     if ( channelsLabel.empty() ) {
         // Channels label is the concatenation of all channels
         for (std::size_t i = 0; i < channels.size(); ++i) {
-            _channelsLabel.append(channels[i]);
+            compsLabel.append(channels[i]);
         }
     }
+    _imp = intern(planeID, label, compsLabel, channels);
 }
 
 ImagePlaneDesc::ImagePlaneDesc(const std::string& planeName,
@@ -77,40 +180,35 @@ ImagePlaneDesc::ImagePlaneDesc(const std::string& planeName,
                                const std::string& channelsLabel,
                                const char** channels,
                                int count)
-: _planeID(planeName)
-, _planeLabel(planeLabel)
-, _channels()
-, _channelsLabel(channelsLabel)
+: _imp()
 {
-    _channels.resize(count);
+    std::vector<std::string> comps(count);
     for (int i = 0; i < count; ++i) {
-        _channels[i] = channels[i];
+        comps[i] = channels[i];
     }
 
-    if (planeLabel.empty()) {
-        // Plane label is the ID if empty
-        _planeLabel = _planeID;
-    }
+    // Plane label is the ID if empty
+    std::string label = planeLabel.empty() ? planeName : planeLabel;
+    std::string compsLabel = channelsLabel;
     if ( channelsLabel.empty() ) {
         // Channels label is the concatenation of all channels
-        for (std::size_t i = 0; i < _channels.size(); ++i) {
-            _channelsLabel.append(channels[i]);
+        for (std::size_t i = 0; i < comps.size(); ++i) {
+            compsLabel.append(comps[i]);
         }
     }
+    _imp = intern(planeName, label, compsLabel, comps);
 }
 
 ImagePlaneDesc::ImagePlaneDesc(const ImagePlaneDesc& other)
+: _imp(other._imp)
 {
-    *this = other;
 }
 
 ImagePlaneDesc&
 ImagePlaneDesc::operator=(const ImagePlaneDesc& other)
 {
-    _planeID = other._planeID;
-    _planeLabel = other._planeLabel;
-    _channels = other._channels;
-    _channelsLabel = other._channelsLabel;
+    _imp = other._imp;
+
     return *this;
 }
 
@@ -127,7 +225,7 @@ ImagePlaneDesc::isColorPlane(const std::string& planeID)
 bool
 ImagePlaneDesc::isColorPlane() const
 {
-    return ImagePlaneDesc::isColorPlane(_planeID);
+    return ImagePlaneDesc::isColorPlane(_imp->planeID);
 }
 
 
@@ -135,46 +233,62 @@ ImagePlaneDesc::isColorPlane() const
 bool
 ImagePlaneDesc::operator==(const ImagePlaneDesc& other) const
 {
-    if ( _channels.size() != other._channels.size() ) {
+    if (_imp == other._imp) {
+        return true;
+    }
+    if ( _imp->channels.size() != other._imp->channels.size() ) {
         return false;
     }
-    return _planeID == other._planeID;
+
+    return _imp->planeIndex == other._imp->planeIndex;
 }
 
 bool
 ImagePlaneDesc::operator<(const ImagePlaneDesc& other) const
 {
-    return _planeID < other._planeID;
+    // Keep the plane ID ordering so that the iteration order of the maps is unchanged,
+    // but only compare the strings of distinct planes
+    if (_imp->planeIndex == other._imp->planeIndex) {
+        return false;
+    }
+
+    return _imp->planeID < other._imp->planeID;
 }
 
 int
 ImagePlaneDesc::getNumComponents() const
 {
-    return (int)_channels.size();
+    return (int)_imp->channels.size();
 }
 
 const std::string&
 ImagePlaneDesc::getPlaneID() const
 {
-    return _planeID;
+    return _imp->planeID;
+}
+
+int
+ImagePlaneDesc::getPlaneIndex() const
+{
+    return _imp->planeIndex;
 }
 
 const std::string&
 ImagePlaneDesc::getPlaneLabel() const
 {
-    return _planeLabel;
+    return _imp->planeLabel;
 }
 
 const std::string&
 ImagePlaneDesc::getChannelsLabel() const
 {
-    return _channelsLabel;
+    return _imp->channelsLabel;
 }
 
 const std::vector<std::string>&
 ImagePlaneDesc::getChannels() const
 {
-    return _channels;
+    return _imp->channels;
 }
 
 const ImagePlaneDesc&
@@ -253,13 +367,13 @@ ImagePlaneDesc::getDisparityRightComponents()
 ChoiceOption
 ImagePlaneDesc::getChannelOption(int channelIndex) const
 {
-    if (channelIndex < 0 || channelIndex >= (int)_channels.size()) {
+    if (channelIndex < 0 || channelIndex >= (int)_imp->channels.size()) {
         assert(false);
         return ChoiceOption("","","");
     }
     std::string optionID, optionLabel;
-    optionLabel += _planeLabel;
-    optionID += _planeID;
+    optionLabel += _imp->planeLabel;
+    optionID += _imp->planeID;
     if ( !optionLabel.empty() ) {
         optionLabel += '.';
     }
@@ -268,8 +382,8 @@ ImagePlaneDesc::getChannelOption(int channelIndex) const
     }
 
     // For the option label, append the name of the channel
-    optionLabel += _channels[channelIndex];
-    optionID += _channels[channelIndex];
+    optionLabel += _imp->channels[channelIndex];
+    optionID += _imp->channels[channelIndex];
 
     return ChoiceOption(optionID, optionLabel, "");
 }
@@ -277,11 +391,11 @@ ImagePlaneDesc::getChannelOption(int channelIndex) const
 ChoiceOption
 ImagePlaneDesc::getPlaneOption() const
 {
-    std::string optionLabel = _planeLabel + "." + _channelsLabel;
+    std::string optionLabel = _imp->planeLabel + "." + _imp->channelsLabel;
 
     // The option ID is always the name of the layer, this ensures for the Color plane that even if the components type changes, the choice stays
     // the same in the parameter.
-    return ChoiceOption(_planeID, optionLabel, "");
+    return ChoiceOption(_imp->planeID, optionLabel, "");
 
 }
 
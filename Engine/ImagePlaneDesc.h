@@ -70,6 +70,13 @@ GCC_DIAG_ON(unused-parameter)
 
 NATRON_NAMESPACE_ENTER
 
+struct ImagePlaneDescData;
+
+/**
+ * @brief Describes an image plane. The strings describing the plane are interned in a global registry:
+ * copying an ImagePlaneDesc only copies a pointer and comparing two of them compares integers,
+ * which matters since they are copied and compared many times for each render.
+ **/
 class ImagePlaneDesc
 {
 public:
@@ -110,6 +117,13 @@ public:
      **/
     const std::string& getPlaneID() const;
 
+    /**
+     * @brief Returns an integer uniquely identifying the plane ID for the lifetime of the process.
+     * Two planes with the same plane ID have the same index. This is not persistent across runs
+     * and must not be serialized.
+     **/
+    int getPlaneIndex() const;
+
     /**
      * @brief Returns the plane label.
      * This is what is used to display to the user.
@@ -249,10 +263,17 @@ public:
     void load(Archive & ar, const unsigned int version);
 
 private:
-    std::string _planeID, _planeLabel;
-    std::vector<std::string> _channels;
-    std::string _channelsLabel;
-    
+
+    /**
+     * @brief Returns the interned description with the given strings, creating it if needed.
+     **/
+    static boost::shared_ptr<const ImagePlaneDescData> intern(const std::string& planeID,
+                                                              const std::string& planeLabel,
+                                                              const std::string& channelsLabel,
+                                                              const std::vector<std::string>& channels);
+
+    boost::shared_ptr<const ImagePlaneDescData> _imp;
+
     friend class boost::serialization::access;
 
     BOOST_SERIALIZATION_SPLIT_MEMBER()
@@ -0,0 +1,426 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ImageResampler.h"
+
+#include <cmath>
+#include <algorithm> // min, max
+#include <cassert>
+#include <vector>
+
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#include <boost/ref.hpp>
+#include <boost/make_shared.hpp>
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+#include <QtCore/QThreadPool>
+CLANG_DIAG_ON(deprecated)
+
+#include "Engine/AppManager.h"
+#include "Engine/Image.h"
+
+// Below this many pixels per thread, the roi is resampled in the calling thread
+#define NATRON_RESAMPLER_MIN_PIXELS_PER_THREAD 16384
+
+// The source is never downscaled further than this mipmap level
+#define NATRON_RESAMPLER_MAX_MIPMAP_LEVEL 8
+
+// Matrices whose determinant is below this are considered singular
+#define NATRON_RESAMPLER_MIN_DETERMINANT 1e-12
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846264338327950288
+#endif
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct ResampleArgs
+{
+    const unsigned char* srcPixels; // pixel at (srcBounds.x1, srcBounds.y1)
+    RectI srcBounds;
+    unsigned char* dstPixels; // pixel at (dstBounds.x1, dstBounds.y1)
+    RectI dstBounds;
+    int nComps;
+    Transform::Matrix3x3 dstToSrc;
+    ImageResampler::FilterEnum filter;
+};
+
+int
+getFilterRadius(ImageResampler::FilterEnum filter)
+{
+    switch (filter) {
+    case ImageResampler::eFilterBilinear:
+
+        return 1;
+    case ImageResampler::eFilterCubic:
+
+        return 2;
+    case ImageResampler::eFilterLanczos:
+
+        return 3;
+    }
+
+    return 1;
+}
+
+double
+sinc(double x)
+{
+    if (x == 0.) {
+        return 1.;
+    }
+    x *= M_PI;
+
+    return std::sin(x) / x;
+}
+
+double
+getFilterWeight(ImageResampler::FilterEnum filter,
+                double t)
+{
+    t = std::fabs(t);
+    switch (filter) {
+    case ImageResampler::eFilterBilinear:
+
+        return t < 1. ? 1. - t : 0.;
+    case ImageResampler::eFilterCubic:
+        // Catmull-Rom, i.e. Keys with a = -0.5
+        if (t < 1.) {
+            return (1.5 * t - 2.5) * t * t + 1.;
+        } else if (t < 2.) {
+            return ( (-0.5 * t + 2.5) * t - 4. ) * t + 2.;
+        }
+
+        return 0.;
+    case ImageResampler::eFilterLanczos:
+
+        return t < 3. ? sinc(t) * sinc(t / 3.) : 0.;
+    }
+
+    return 0.;
+}
+
+/**
+ * @brief Computes the weights of the taps [*first, *first + 2 * radius[ used to sample at the given position along one axis.
+ * Returns the sum of the weights.
+ **/
+double
+computeTaps(ImageResampler::FilterEnum filter,
+            int radius,
+            double pos,
+            int* first,
+            double* weights)
+{
+    // Pixel centers are at integer + 0.5
+    double p = pos - 0.5;
+    int floorP = (int)std::floor(p);
+
+    *first = floorP - radius + 1;
+    double sum = 0.;
+    for (int k = 0; k < 2 * radius; ++k) {
+        weights[k] = getFilterWeight(filter, p - (*first + k));
+        sum += weights[k];
+    }
+
+    return sum;
+}
+
+template <typename PIX, int maxValue>
+RectI
+resampleForRect(const ResampleArgs& args,
+                const RectI& rect)
+{
+    const int radius = getFilterRadius(args.filter);
+    const int nComps = args.nComps;
+    const RectI& sb = args.srcBounds;
+    const std::size_t srcRowElements = (std::size_t)sb.width() * nComps;
+    const std::size_t dstRowElements = (std::size_t)args.dstBounds.width() * nComps;
+    const Transform::Matrix3x3& m = args.dstToSrc;
+    const PIX* srcPixels = (const PIX*)args.srcPixels;
+    std::vector<double> xWeights(2 * radius), yWeights(2 * radius);
+    double acc[4];
+
+    for (int y = rect.y1; y < rect.y2; ++y) {
+        PIX* dstPix = (PIX*)args.dstPixels + (std::size_t)(y - args.dstBounds.y1) * dstRowElements + (std::size_t)(rect.x1 - args.dstBounds.x1) * nComps;
+        // Sample at the center of the pixels, the homogeneous coordinates are incremented along the row
+        double yc = y + 0.5;
+        double xc = rect.x1 + 0.5;
+        double hx = m.a * xc + m.b * yc + m.c;
+        double hy = m.d * xc + m.e * yc + m.f;
+        double hz = m.g * xc + m.h * yc + m.i;
+
+        for (int x = rect.x1; x < rect.x2; ++x, dstPix += nComps, hx += m.a, hy += m.d, hz += m.g) {
+            for (int c = 0; c < nComps; ++c) {
+                acc[c] = 0.;
+            }
+            if (hz != 0.) {
+                double sx = hx / hz;
+                double sy = hy / hz;
+                // Points farther than the filter radius from the source contribute nothing
+                if ( (sx > sb.x1 - radius) && (sx < sb.x2 + radius) && (sy > sb.y1 - radius) && (sy < sb.y2 + radius) ) {
+                    int x0, y0;
+                    double xSum = computeTaps(args.filter, radius, sx, &x0, &xWeights[0]);
+                    double ySum = computeTaps(args.filter, radius, sy, &y0, &yWeights[0]);
+                    double norm = xSum * ySum;
+                    for (int j = 0; j < 2 * radius; ++j) {
+                        int sy_j = y0 + j;
+                        if ( (sy_j < sb.y1) || (sy_j >= sb.y2) || (yWeights[j] == 0.) ) {
+                            continue;
+                        }
+                        const PIX* srcRow = srcPixels + (std::size_t)(sy_j - sb.y1) * srcRowElements;
+                        for (int i = 0; i < 2 * radius; ++i) {
+                            int sx_i = x0 + i;
+                            if ( (sx_i < sb.x1) || (sx_i >= sb.x2) ) {
+                                continue;
+                            }
+                            double w = xWeights[i] * yWeights[j];
+                            const PIX* srcPix = srcRow + (std::size_t)(sx_i - sb.x1) * nComps;
+                            for (int c = 0; c < nComps; ++c) {
+                                acc[c] += w * srcPix[c];
+                            }
+                        }
+                    }
+                    if (norm != 0.) {
+                        for (int c = 0; c < nComps; ++c) {
+                            acc[c] /= norm;
+                        }
+                    }
+                }
+            }
+            for (int c = 0; c < nComps; ++c) {
+                if (maxValue == 1) {
+                    dstPix[c] = (PIX)acc[c];
+                } else {
+                    // Cubic and Lanczos overshoot: clamp to the range of the integer type
+                    dstPix[c] = (PIX)std::floor(std::max(0., std::min(acc[c], (double)maxValue)) + 0.5);
+                }
+            }
+        }
+    }
+
+    return rect;
+} // resampleForRect
+
+template <typename PIX, int maxValue>
+void
+resampleForDepth(const ResampleArgs& args,
+                 const RectI& roi)
+{
+    int nThreads = std::min( appPTR->getMaxThreadCount(), (int)( roi.area() / NATRON_RESAMPLER_MIN_PIXELS_PER_THREAD ) );
+    bool runInCurrentThread = nThreads <= 1 ||
+                              QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
+
+    if (runInCurrentThread) {
+        resampleForRect<PIX, maxValue>(args, roi);
+
+        return;
+    }
+
+    std::vector<RectI> splitRects = roi.splitIntoSmallerRects(nThreads);
+    QFuture<RectI> future = QtConcurrent::mapped( splitRects,
+                                                  boost::bind(&resampleForRect<PIX, maxValue>,
+                                                              boost::cref(args),
+                                                              _1) );
+    future.waitForFinished();
+}
+
+/**
+ * @brief Returns the mipmap level of the source to sample so that one destination pixel covers less than 2 source pixels,
+ * estimated from the area covered in the source by the pixel at the center of the roi.
+ **/
+unsigned int
+getMipMapLevelForMinification(const Transform::Matrix3x3& dstToSrc,
+                              const RectI& roi,
+                              const RectI& srcBounds)
+{
+    double cx = (roi.x1 + roi.x2) / 2.;
+    double cy = (roi.y1 + roi.y2) / 2.;
+    double px[3] = { cx, cx + 1., cx };
+    double py[3] = { cy, cy, cy + 1. };
+
+    for (int k = 0; k < 3; ++k) {
+        double z = 1.;
+        Transform::matApply(dstToSrc, &px[k], &py[k], &z);
+        if (z == 0.) {
+            return 0;
+        }
+        px[k] /= z;
+        py[k] /= z;
+    }
+    double area = std::fabs( (px[1] - px[0]) * (py[2] - py[0]) - (py[1] - py[0]) * (px[2] - px[0]) );
+    double scale = std::sqrt(area);
+    unsigned int level = 0;
+    while ( (scale >= 2.) && (level < NATRON_RESAMPLER_MAX_MIPMAP_LEVEL) && !srcBounds.downscalePowerOfTwoSmallestEnclosing(level + 1).isNull() ) {
+        scale /= 2.;
+        ++level;
+    }
+
+    return level;
+}
+
+/**
+ * @brief Returns the given mipmap level of src, relative to the level of src.
+ **/
+ImagePtr
+downscaleSource(const Image& src,
+                unsigned int level)
+{
+    RectI mipmapBounds = src.getBounds().downscalePowerOfTwoSmallestEnclosing(level);
+    ImagePtr mipmap = boost::make_shared<Image>(src.getComponents(),
+                                                src.getRoD(),
+                                                mipmapBounds,
+                                                src.getMipMapLevel() + level,
+                                                src.getPixelAspectRatio(),
+                                                src.getBitDepth(),
+                                                src.getPremultiplication(),
+                                                src.getFieldingOrder(),
+                                                false);
+
+    src.downscaleMipMap( src.getRoD(), src.getBounds(), src.getMipMapLevel(), src.getMipMapLevel() + level, false, mipmap.get() );
+
+    return mipmap;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+ResamplerMipMapCache::ResamplerMipMapCache()
+    : _lock()
+    , _mipmaps()
+{
+}
+
+ResamplerMipMapCache::~ResamplerMipMapCache()
+{
+}
+
+ImagePtr
+ResamplerMipMapCache::getMipMap(const ImagePtr& src,
+                                unsigned int level)
+{
+    assert(src && level > 0);
+
+    // The lock is held while downscaling: the other tiles need the same mipmap anyway
+    QMutexLocker k(&_lock);
+
+    // Start from the closest level already built
+    ImagePtr closest = src;
+    unsigned int closestLevel = 0;
+    for (std::list<MipMap>::const_iterator it = _mipmaps.begin(); it != _mipmaps.end(); ++it) {
+        if ( (it->src != src) || (it->level > level) || (it->level <= closestLevel) ) {
+            continue;
+        }
+        closest = it->image;
+        closestLevel = it->level;
+    }
+    if (closestLevel == level) {
+        return closest;
+    }
+
+    MipMap mipmap;
+    mipmap.src = src;
+    mipmap.level = level;
+    mipmap.image = downscaleSource(*closest, level - closestLevel);
+    _mipmaps.push_back(mipmap);
+
+    return mipmap.image;
+}
+
+bool
+ImageResampler::resample(const ImagePtr& srcPtr,
+                         const Transform::Matrix3x3& srcToDst,
+                         FilterEnum filter,
+                         const RectI& roi,
+                         ResamplerMipMapCache* mipmaps,
+                         Image* dst)
+{
+    assert(srcPtr && dst);
+    const Image& src = *srcPtr;
+    if ( (src.getStorageMode() == eStorageModeGLTex) || (dst->getStorageMode() == eStorageModeGLTex) ||
+         ( src.getComponentsCount() != dst->getComponentsCount() ) || ( src.getBitDepth() != dst->getBitDepth() ) ) {
+        return false;
+    }
+    double det = Transform::matDeterminant(srcToDst);
+    if (std::fabs(det) < NATRON_RESAMPLER_MIN_DETERMINANT) {
+        return false;
+    }
+
+    RectI dstRoI;
+    if ( !roi.intersect(dst->getBounds(), &dstRoI) ) {
+        return true;
+    }
+
+    ResampleArgs args;
+    args.dstToSrc = Transform::matInverse(srcToDst, det);
+    args.filter = filter;
+    args.nComps = (int)dst->getComponentsCount();
+    args.dstBounds = dst->getBounds();
+
+    // When minifying, sample a mipmap of the source instead of widening the filter
+    const Image* srcToSample = &src;
+    ImagePtr mipmap;
+    unsigned int level = getMipMapLevelForMinification(args.dstToSrc, dstRoI, src.getBounds());
+    if (level > 0) {
+        mipmap = mipmaps ? mipmaps->getMipMap(srcPtr, level) : downscaleSource(src, level);
+        double s = 1. / (1 << level);
+        args.dstToSrc = Transform::matMul(Transform::matScale(s, s), args.dstToSrc);
+        srcToSample = mipmap.get();
+    }
+    args.srcBounds = srcToSample->getBounds();
+
+    // Pointers are taken once under the locks of the images, the strips then address the buffers directly
+    Image::ReadAccess srcAcc = srcToSample->getReadRights();
+    Image::WriteAccess dstAcc = dst->getWriteRights();
+    args.srcPixels = srcAcc.pixelAt(args.srcBounds.x1, args.srcBounds.y1);
+    args.dstPixels = dstAcc.pixelAt(args.dstBounds.x1, args.dstBounds.y1);
+    if (!args.srcPixels || !args.dstPixels) {
+        return false;
+    }
+
+    switch ( dst->getBitDepth() ) {
+    case eImageBitDepthByte:
+        resampleForDepth<unsigned char, 255>(args, dstRoI);
+        break;
+    case eImageBitDepthShort:
+        resampleForDepth<unsigned short, 65535>(args, dstRoI);
+        break;
+    case eImageBitDepthFloat:
+        resampleForDepth<float, 1>(args, dstRoI);
+        break;
+    case eImageBitDepthHalf:
+    case eImageBitDepthNone:
+
+        return false;
+    }
+
+    return true;
+} // ImageResampler::resample
+
+NATRON_NAMESPACE_EXIT
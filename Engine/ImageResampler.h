@@ -0,0 +1,108 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_IMAGERESAMPLER_H
+#define NATRON_ENGINE_IMAGERESAMPLER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+
+#include <QtCore/QMutex>
+
+#include "Engine/RectI.h"
+#include "Engine/Transform.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief The mipmaps of the source images built by ImageResampler::resample() when minifying. The tiles of a render
+ * share one instance so that each level of a source is downscaled once per render instead of once per tile.
+ * Each level is built from the closest level already built. This class is MT-safe.
+ **/
+class ResamplerMipMapCache
+{
+public:
+
+    ResamplerMipMapCache();
+
+    ~ResamplerMipMapCache();
+
+    /**
+     * @brief Returns the given mipmap level of src, relative to the level of src, building it if needed.
+     **/
+    ImagePtr getMipMap(const ImagePtr& src, unsigned int level);
+
+private:
+
+    struct MipMap
+    {
+        ImagePtr src;
+        unsigned int level;
+        ImagePtr image;
+    };
+
+    QMutex _lock;
+    std::list<MipMap> _mipmaps;
+};
+
+/**
+ * @brief Resamples an image through a 2D projective matrix on the CPU. This is used to apply the concatenated matrix
+ * of a chain of transform effects in a single filtering pass, without going through the render action of the plug-in
+ * at the end of the chain.
+ **/
+class ImageResampler
+{
+public:
+
+    enum FilterEnum
+    {
+        eFilterBilinear = 0,
+        eFilterCubic, // Catmull-Rom
+        eFilterLanczos, // Lanczos with 3 lobes
+    };
+
+    /**
+     * @brief Fills the roi of dst with src resampled through srcToDst, which maps the pixel coordinates of src to the pixel
+     * coordinates of dst. Pixels of dst that map outside of the bounds of src are transparent black.
+     * When the matrix minifies src by a large amount, a mipmap level of src is sampled instead so that the filter
+     * footprint stays small. The mipmap is taken from mipmaps, if not NULL, so that it can be reused by the other tiles
+     * of the render.
+     * The roi is split in strips processed in parallel if threads are available.
+     * Returns false, without modifying dst, if src and dst do not have the same components and bitdepth, if either of
+     * them is not stored in RAM or if the matrix is not invertible.
+     **/
+    static bool resample(const ImagePtr& src,
+                         const Transform::Matrix3x3& srcToDst,
+                         FilterEnum filter,
+                         const RectI& roi,
+                         ResamplerMipMapCache* mipmaps,
+                         Image* dst);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_IMAGERESAMPLER_H
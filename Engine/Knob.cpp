@@ -27,6 +27,9 @@
 #include "KnobImpl.h"
 
 #include <algorithm> // min, max
+#include <map>
+#include <set>
+#include <vector>
 #include <cassert>
 #include <stdexcept>
 #include <sstream> // stringstream
@@ -52,7 +55,11 @@
 #include "Engine/KnobTypes.h"
 #include "Engine/LibraryBinary.h"
 #include "Engine/Node.h"
+#include "Engine/NumericExpression.h"
+#include "Engine/ParallelRenderArgs.h"
 #include "Engine/Project.h"
+#include "Engine/RenderRequestRecorder.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/StringAnimationManager.h"
 #include "Engine/TLSHolder.h"
 #include "Engine/TimeLine.h"
@@ -227,10 +234,13 @@ struct Expr
     ///The list of pair<knob, dimension> dpendencies for an expression
     std::list<std::pair<KnobIWPtr, int> > dependencies;
 
+    ///Set if the expression is plain arithmetic that can be evaluated without Python
+    boost::shared_ptr<NumericExpression> numeric;
+
     //PyObject* code;
 
     Expr()
-        : expression(), originalExpression(), exprInvalid(), hasRet(false) /*, code(0)*/ {}
+        : expression(), originalExpression(), exprInvalid(), hasRet(false), dependencies(), numeric() /*, code(0)*/ {}
 };
 
 struct KnobHelperPrivate
@@ -415,6 +425,9 @@ struct KnobHelperPrivate
 
     std::string declarePythonVariables(bool addTab, int dimension);
 
+    /// Returns false if a variable declared by declarePythonVariables() (a sibling node) hides a name used by the expression
+    bool isNumericExpressionScopeFree(const NumericExpression& expr) const;
+
     bool shouldUseGuiCurve() const
     {
         if (!holder) {
@@ -1689,6 +1702,12 @@ KnobHelper::evaluateValueChangeInternal(int dimension,
     KnobGuiIPtr hasGui = getKnobGuiPointer();
     bool refreshWidget = !app || hasAnimation() || time == app->getTimeLine()->currentFrame();
 
+    // Record the change before it triggers any render, so that a replay issues them in the same order
+    if ( ( (originalReason == eValueChangedReasonUserEdited) || (originalReason == eValueChangedReasonNatronGuiEdited) ) &&
+         RenderRequestRecorder::isEnabled() ) {
+        RenderRequestRecorder::recordKnobChanged(this, dimension, time);
+    }
+
     /// For eValueChangedReasonTimeChanged we never call the instanceChangedAction and evaluate otherwise it would just throttle
     /// the application responsiveness
     onInternalValueChanged(dimension, time, view);
@@ -2261,6 +2280,28 @@ extractAllOcurrences(const std::string& str,
     return true;
 }
 
+bool
+KnobHelperPrivate::isNumericExpressionScopeFree(const NumericExpression& expr) const
+{
+    EffectInstance* effect = dynamic_cast<EffectInstance*>(holder);
+    if (!effect) {
+        return false;
+    }
+    NodePtr node = effect->getNode();
+    NodeCollectionPtr collection = node ? node->getGroup() : NodeCollectionPtr();
+    if (!collection) {
+        return false;
+    }
+    const std::vector<std::string>& names = expr.getIdentifiers();
+    for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+        if ( collection->getNodeByName(*it) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 std::string
 KnobHelperPrivate::declarePythonVariables(bool addTab,
                                           int dim)
@@ -2701,6 +2742,15 @@ KnobHelper::setExpressionInternal(int dimension,
         }
     }
 
+    ///Single-line arithmetic expressions are also compiled to be evaluated by render threads without the GIL
+    boost::shared_ptr<NumericExpression> numeric;
+    if ( !hasRetVariable && exprInvalid.empty() && !dynamic_cast<KnobStringBase*>(this) ) {
+        numeric.reset(new NumericExpression);
+        if ( !numeric->compile(expression) || !_imp->isNumericExpressionScopeFree( *numeric ) ) {
+            numeric.reset();
+        }
+    }
+
     //Set internal fields
 
     {
@@ -2709,6 +2759,7 @@ KnobHelper::setExpressionInternal(int dimension,
         _imp->expressions[dimension].expression = exprCpy;
         _imp->expressions[dimension].originalExpression = expression;
         _imp->expressions[dimension].exprInvalid = exprInvalid;
+        _imp->expressions[dimension].numeric = numeric;
 
         ///This may throw an exception upon failure
         //NATRON_PYTHON_NAMESPACE::compilePyScript(exprCpy, &_imp->expressions[dimension].code);
@@ -2801,6 +2852,7 @@ KnobHelper::clearExpression(int dimension,
         _imp->expressions[dimension].expression.clear();
         _imp->expressions[dimension].originalExpression.clear();
         _imp->expressions[dimension].exprInvalid.clear();
+        _imp->expressions[dimension].numeric.reset();
         //Py_XDECREF(_imp->expressions[dimension].code); //< new ref
         //_imp->expressions[dimension].code = 0;
     }
@@ -2932,11 +2984,35 @@ KnobHelper::executeExpression(double time,
 }
 
 
+bool
+KnobHelper::evaluateNumericExpression(double time,
+                                      ViewIdx view,
+                                      int dimension,
+                                      double* ret,
+                                      bool* isInt) const
+{
+    boost::shared_ptr<NumericExpression> numeric;
+    {
+        QMutexLocker k(&_imp->expressionMutex);
+        if ( !_imp->expressions[dimension].exprInvalid.empty() ) {
+            return false;
+        }
+        numeric = _imp->expressions[dimension].numeric;
+    }
+    if (!numeric) {
+        return false;
+    }
+
+    return numeric->evaluate(time, view, dimension, ret, isInt);
+}
+
 bool
 KnobHelper::executeExpression(const std::string& expr,
                               PyObject** ret,
                               std::string* error)
 {
+    // Also records the time spent waiting for the GIL, which other threads may hold
+    RenderTraceScope traceScope("python", "expression");
     PythonGILLocker pgl;
 
     //returns a new ref, this function's documentation is not clear onto what it returns...
@@ -3832,63 +3908,180 @@ KnobHelper::getKeyFrameIndex(ViewSpec view,
     return curve->keyFrameIndex(time);
 }
 
+bool
+KnobHelper::isRefreshingListeners() const
+{
+    KnobDataTLSPtr tls = _imp->tlsData->getTLSData();
+
+    return tls && tls->listenersRefreshLevel > 0;
+}
+
 void
 KnobHelper::refreshListenersAfterValueChange(ViewSpec view,
                                              ValueChangedReasonEnum reason,
                                              int dimension)
 {
-    ListenerDimsMap listeners;
+    std::vector<ListenersRefreshRoot> roots(1);
 
-    getListeners(listeners);
+    roots[0].knob = this;
+    roots[0].view = view;
+    roots[0].reason = reason;
+    roots[0].dimension = dimension;
+    refreshListenersOfKnobs(roots);
+}
+
+typedef std::set<std::pair<KnobHelper*, KnobHelper*> > KnobLinksSet;
 
-    if ( listeners.empty() ) {
+/**
+ * @brief Post-order depth-first walk of the listeners of knob: reversing postOrder gives the knobs in topological order.
+ * A link to a knob that is on the current path closes a cycle: it is recorded in cyclicLinks and not followed.
+ **/
+static void
+sortKnobListeners(KnobHelper* knob,
+                  std::map<KnobHelper*, KnobI::ListenerDimsMap>& listeners,
+                  std::set<KnobHelper*>& onPath,
+                  KnobLinksSet& cyclicLinks,
+                  std::vector<KnobHelper*>* postOrder)
+{
+    if ( listeners.find(knob) != listeners.end() ) {
         return;
     }
+    KnobI::ListenerDimsMap& knobListeners = listeners[knob];
+    knob->getListeners(knobListeners);
 
-    double time = getCurrentTime();
-    for (ListenerDimsMap::iterator it = listeners.begin(); it != listeners.end(); ++it) {
+    onPath.insert(knob);
+    for (KnobI::ListenerDimsMap::iterator it = knobListeners.begin(); it != knobListeners.end(); ++it) {
         KnobHelper* slaveKnob = dynamic_cast<KnobHelper*>( it->first.lock().get() );
         if (!slaveKnob) {
             continue;
         }
+        if ( onPath.find(slaveKnob) != onPath.end() ) {
+            cyclicLinks.insert( std::make_pair(knob, slaveKnob) );
+            continue;
+        }
+        sortKnobListeners(slaveKnob, listeners, onPath, cyclicLinks, postOrder);
+    }
+    onPath.erase(knob);
+    postOrder->push_back(knob);
+}
 
+struct KnobListenersChange
+{
+    std::set<int> dimensions;
+    double time;
+    ViewSpec view;
+    ValueChangedReasonEnum reason;
+};
 
-        std::set<int> dimensionsToEvaluate;
-        for (std::size_t i = 0; i < it->second.size(); ++i) {
-            if ( it->second[i].isListening && ( (it->second[i].targetDim == dimension) || (it->second[i].targetDim == -1) || (dimension == -1) ) ) {
-                dimensionsToEvaluate.insert(i);
-                if (!it->second[i].isExpr) {
-                    ///We still want to clone the master's dimension because otherwise we couldn't edit the curve e.g in the curve editor
-                    ///For example we use it for roto knobs where selected beziers have their knobs slaved to the gui knobs
-                    slaveKnob->clone(this, i, it->second[i].targetDim);
-                }
-            }
-        }
+void
+KnobHelper::refreshListenersOfKnobs(const std::vector<ListenersRefreshRoot>& roots)
+{
+    std::map<KnobHelper*, KnobI::ListenerDimsMap> listeners;
+    std::set<KnobHelper*> onPath;
+    KnobLinksSet cyclicLinks;
+    std::vector<KnobHelper*> postOrder;
+    std::map<KnobHelper*, const ListenersRefreshRoot*> rootKnobs;
+    bool hasListeners = false;
 
-        if ( dimensionsToEvaluate.empty() ) {
+    for (std::vector<ListenersRefreshRoot>::const_iterator it = roots.begin(); it != roots.end(); ++it) {
+        // The listeners of a knob already part of a refresh in progress are handled by that refresh
+        if ( it->knob->isRefreshingListeners() || ( rootKnobs.find(it->knob) != rootKnobs.end() ) ) {
             continue;
         }
+        rootKnobs[it->knob] = &*it;
+        sortKnobListeners(it->knob, listeners, onPath, cyclicLinks, &postOrder);
+        hasListeners |= !listeners[it->knob].empty();
+    }
+    if (!hasListeners) {
+        return;
+    }
+
+    // Keep the knobs alive and flag them for the duration of the refresh: changes they notify in the meantime
+    // (e.g: from the endChanges() of their holder) do not start another refresh of their listeners.
+    std::vector<KnobIPtr> knobsInRefresh;
+    for (std::vector<KnobHelper*>::iterator it = postOrder.begin(); it != postOrder.end(); ++it) {
+        knobsInRefresh.push_back( (*it)->shared_from_this() );
+        ++(*it)->_imp->tlsData->getOrCreateTLSData()->listenersRefreshLevel;
+    }
 
+    // Each knob is evaluated once, after all its masters, with the union of the dimensions they changed
+    std::map<KnobHelper*, KnobListenersChange> changes;
+    for (std::vector<KnobHelper*>::reverse_iterator it = postOrder.rbegin(); it != postOrder.rend(); ++it) {
+        KnobHelper* knob = *it;
+        std::map<KnobHelper*, KnobListenersChange>::iterator foundChange = changes.find(knob);
+        std::map<KnobHelper*, const ListenersRefreshRoot*>::iterator foundRoot = rootKnobs.find(knob);
         int dimChanged;
-        if (dimensionsToEvaluate.size() > 1) {
-            dimChanged = -1;
+        ViewSpec view;
+        ValueChangedReasonEnum reason;
+
+        if ( foundChange != changes.end() ) {
+            const std::set<int>& dimensions = foundChange->second.dimensions;
+            if ( (dimensions.size() > 1) || ( ( foundRoot != rootKnobs.end() ) && (foundRoot->second->dimension != *dimensions.begin()) ) ) {
+                dimChanged = -1;
+            } else {
+                dimChanged = *dimensions.begin();
+            }
+            view = foundChange->second.view;
+            reason = foundChange->second.reason;
+
+            for (int i = 0; i < knob->getDimension(); ++i) {
+                knob->clearExpressionsResults(i);
+            }
+            knob->evaluateValueChangeInternal(dimChanged, foundChange->second.time, view, eValueChangedReasonSlaveRefresh, reason);
+
+            if ( knob->isListenersNotificationBlocked() ) {
+                continue;
+            }
+        } else if ( foundRoot != rootKnobs.end() ) {
+            dimChanged = foundRoot->second->dimension;
+            view = foundRoot->second->view;
+            reason = foundRoot->second->reason;
         } else {
-            dimChanged = *dimensionsToEvaluate.begin();
+            // None of its masters changed
+            continue;
         }
 
-        for (int i = 0; i < slaveKnob->getDimension(); ++i) {
-            slaveKnob->clearExpressionsResults(i);
-        }
+        double time = knob->getCurrentTime();
+        KnobI::ListenerDimsMap& knobListeners = listeners[knob];
+        for (KnobI::ListenerDimsMap::iterator it2 = knobListeners.begin(); it2 != knobListeners.end(); ++it2) {
+            KnobHelper* slaveKnob = dynamic_cast<KnobHelper*>( it2->first.lock().get() );
+            if ( !slaveKnob || ( cyclicLinks.find( std::make_pair(knob, slaveKnob) ) != cyclicLinks.end() ) ) {
+                continue;
+            }
+
+            std::set<int> dimensionsToEvaluate;
+            for (std::size_t i = 0; i < it2->second.size(); ++i) {
+                if ( it2->second[i].isListening && ( (it2->second[i].targetDim == dimChanged) || (it2->second[i].targetDim == -1) || (dimChanged == -1) ) ) {
+                    dimensionsToEvaluate.insert(i);
+                    if (!it2->second[i].isExpr) {
+                        ///We still want to clone the master's dimension because otherwise we couldn't edit the curve e.g in the curve editor
+                        ///For example we use it for roto knobs where selected beziers have their knobs slaved to the gui knobs
+                        slaveKnob->clone(knob, i, it2->second[i].targetDim);
+                    }
+                }
+            }
 
+            if ( dimensionsToEvaluate.empty() ) {
+                continue;
+            }
 
-        slaveKnob->evaluateValueChangeInternal(dimChanged, time, view, eValueChangedReasonSlaveRefresh, reason);
+            std::map<KnobHelper*, KnobListenersChange>::iterator foundSlaveChange = changes.find(slaveKnob);
+            if ( foundSlaveChange == changes.end() ) {
+                KnobListenersChange& change = changes[slaveKnob];
+                change.dimensions = dimensionsToEvaluate;
+                change.time = time;
+                change.view = view;
+                change.reason = reason;
+            } else {
+                foundSlaveChange->second.dimensions.insert( dimensionsToEvaluate.begin(), dimensionsToEvaluate.end() );
+            }
+        } // for all listeners
+    }
 
-        //call recursively
-        if ( !slaveKnob->isListenersNotificationBlocked() ) {
-            slaveKnob->refreshListenersAfterValueChange(view, reason, dimChanged);
-        }
-    } // for all listeners
-} // KnobHelper::refreshListenersAfterValueChange
+    for (std::vector<KnobHelper*>::iterator it = postOrder.begin(); it != postOrder.end(); ++it) {
+        --(*it)->_imp->tlsData->getTLSData()->listenersRefreshLevel;
+    }
+} // KnobHelper::refreshListenersOfKnobs
 
 void
 KnobHelper::cloneExpressions(KnobI* other,
@@ -4204,6 +4397,25 @@ KnobHelper::getCurrentView() const
     return ( holder && holder->getApp() ) ? holder->getCurrentView() : ViewIdx(0);
 }
 
+bool
+KnobHelper::getRenderValuesSnapshotValue(double time,
+                                         ViewSpec view,
+                                         int dimension,
+                                         double* value) const
+{
+    EffectInstance* effect = dynamic_cast<EffectInstance*>( getHolder() );
+
+    if (!effect) {
+        return false;
+    }
+    ParallelRenderArgsPtr frameArgs = effect->getParallelRenderArgsTLS();
+    if (!frameArgs || !frameArgs->knobsValues) {
+        return false;
+    }
+
+    return frameArgs->knobsValues->getValue(this, time, view, dimension, value);
+}
+
 double
 KnobHelper::random(double min,
                    double max,
@@ -5599,6 +5811,7 @@ KnobHolder::endChanges(bool discardRendering)
 
     // Call instanceChanged on each knob
     bool ret = false;
+    std::vector<KnobHelper::ListenersRefreshRoot> listenersToRefresh;
     for (KnobChanges::iterator it = knobChanged.begin(); it != knobChanged.end(); ++it) {
         if (it->knob && !it->valueChangeBlocked && !isLoadingProject) {
             if ( !it->originatedFromMainThread && !canHandleEvaluateOnChangeInOtherThread() ) {
@@ -5623,10 +5836,25 @@ KnobHolder::endChanges(bool discardRendering)
         }
 
         if ( !it->valueChangeBlocked && !it->knob->isListenersNotificationBlocked() && firstKnobReason != eValueChangedReasonTimeChanged) {
-            it->knob->refreshListenersAfterValueChange(it->view, it->originalReason, dimension);
+            KnobHelper* isHelper = dynamic_cast<KnobHelper*>( it->knob.get() );
+            if (isHelper) {
+                KnobHelper::ListenersRefreshRoot root;
+                root.knob = isHelper;
+                root.view = it->view;
+                root.reason = it->originalReason;
+                root.dimension = dimension;
+                listenersToRefresh.push_back(root);
+            } else {
+                it->knob->refreshListenersAfterValueChange(it->view, it->originalReason, dimension);
+            }
         }
     }
 
+    // Knobs depending on several of the changed knobs are evaluated once
+    if ( !listenersToRefresh.empty() ) {
+        KnobHelper::refreshListenersOfKnobs(listenersToRefresh);
+    }
+
     int evaluationBlocked;
     bool hasHadSignificantChange = false;
     bool hasHadAnyChange = false;
@@ -716,6 +716,12 @@ public:
     virtual bool onKeyFrameSet(double time, ViewSpec view, const KeyFrame& key, int dimension) = 0;
     virtual bool setKeyFrame(const KeyFrame& key, ViewSpec view,  int dimension, ValueChangedReasonEnum reason) = 0;
 
+    /**
+     * @brief Same as setKeyFrame but for several keyframes at once: the keys are inserted in the curve in a single pass
+     * and the curve change is notified only once instead of once per key.
+     **/
+    virtual bool setKeyFrames(const std::vector<KeyFrame>& keys, ViewSpec view,  int dimension, ValueChangedReasonEnum reason) = 0;
+
     /**
      * @brief Called when the current time of the timeline changes.
      * It must get the value at the given time and notify  the gui it must
@@ -1303,8 +1309,12 @@ public:
     {
         int expressionRecursionLevel;
 
+        // Non zero while the listeners of this knob are being refreshed by refreshListenersOfKnobs() on this thread
+        int listenersRefreshLevel;
+
         KnobTLSData()
             : expressionRecursionLevel(0)
+            , listenersRefreshLevel(0)
         {
         }
     };
@@ -1366,6 +1376,12 @@ protected:
     {
     }
 
+    /**
+     * @brief Returns true and sets value if the value of this knob at the given time and view was taken in the snapshot
+     * of the frame rendered by the current thread (@see KnobsValuesSnapshot). This does not take any lock of the knob.
+     **/
+    bool getRenderValuesSnapshotValue(double time, ViewSpec view, int dimension, double* value) const;
+
 public:
 
 
@@ -1457,6 +1473,23 @@ protected:
 
     virtual void refreshListenersAfterValueChange(ViewSpec view, ValueChangedReasonEnum reason, int dimension) OVERRIDE FINAL;
 
+    struct ListenersRefreshRoot
+    {
+        KnobHelper* knob;
+        ViewSpec view;
+        ValueChangedReasonEnum reason;
+        int dimension;
+    };
+
+    /**
+     * @brief Evaluates once every knob that depends, through an expression or a link, on one of the given knobs.
+     * The dependency graph is walked in topological order so that a knob is evaluated after all its masters,
+     * even with diamond dependencies. Cycles are detected on the graph itself and are not followed.
+     **/
+    static void refreshListenersOfKnobs(const std::vector<ListenersRefreshRoot>& roots);
+
+    bool isRefreshingListeners() const;
+
 public:
 
     virtual bool isExpressionUsingRetVariable(int dimension = 0) const OVERRIDE FINAL WARN_UNUSED_RETURN;
@@ -1589,6 +1622,13 @@ protected:
     ///The return value must be Py_DECRREF
     bool executeExpression(double time, ViewIdx view, int dimension, PyObject** ret, std::string* error) const;
 
+    /**
+     * @brief Evaluates the expression of the given dimension without Python if it is made only of arithmetic
+     * (see NumericExpression). Returns false if the expression must be run by Python.
+     * @param isInt Set to true if Python would have returned an int.
+     **/
+    bool evaluateNumericExpression(double time, ViewIdx view, int dimension, double* ret, bool* isInt) const;
+
 public:
 
     /// The return value must be Py_DECRREF
@@ -1821,6 +1861,19 @@ public:
                                               bool hasChanged = false); //!< set to true if any previous dimension of the same knob have changed
 
     virtual bool setKeyFrame(const KeyFrame& key, ViewSpec view, int dimension, ValueChangedReasonEnum reason) OVERRIDE FINAL;
+    virtual bool setKeyFrames(const std::vector<KeyFrame>& keys, ViewSpec view, int dimension, ValueChangedReasonEnum reason) OVERRIDE FINAL;
+
+    /**
+     * @brief Sets keyframes with the given values at the given times in the given dimension, as setValueAtTime would
+     * do for each of them, but the curve is updated and the change is notified only once.
+     * Falls back to setValueAtTime when the values cannot be set directly on the curve (queued values,
+     * non animated knobs or edits coming from a plug-in while the GUI is up).
+     **/
+    void setValuesAtTimes(const std::vector<double>& times,
+                          const std::vector<T>& values,
+                          ViewSpec view,
+                          int dimension,
+                          ValueChangedReasonEnum reason);
 
     /**
      * @brief Set the value of the knob in the given dimension with the given reason.
@@ -2061,11 +2114,32 @@ public:
         map = _exprRes[dim];
     }
 
+    /**
+     * @brief Returns the result of the expression of the given dimension at the given time if it was already
+     * evaluated since the last change of the knob (or of the node hash).
+     **/
+    bool getExpressionResult(double time,
+                             int dim,
+                             T* value) const
+    {
+        QMutexLocker k(&_valueMutex);
+        typename FrameValueMap::const_iterator found = _exprRes[dim].find(time);
+
+        if ( found == _exprRes[dim].end() ) {
+            return false;
+        }
+        *value = found->second;
+
+        return true;
+    }
+
     T getValueFromMasterAt(double time, ViewSpec view, int dimension, KnobI* master);
     T getValueFromMaster(ViewSpec view, int dimension, KnobI* master, bool clamp);
 
     bool getValueFromCurve(double time, ViewSpec view, int dimension, bool useGuiCurve, bool byPassMaster, bool clamp, T* ret);
 
+    bool getValueFromRenderValuesSnapshot(double time, ViewSpec view, int dimension, bool clamp, T* ret) const;
+
 protected:
 
     virtual void resetExtraToDefaultValue(int /*dimension*/) {}
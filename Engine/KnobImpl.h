@@ -476,6 +476,49 @@ Knob<T>::evaluateExpression_pod(double time,
     return true;
 }
 
+///Convert the result of a NumericExpression like pyObjectToType() would convert the Python object
+inline bool
+numericExpressionResultToType(double v,
+                              bool isInt,
+                              int* ret)
+{
+    if (!isInt) {
+        // let Python perform (or refuse) the float to int conversion
+        return false;
+    }
+    *ret = (int)v;
+
+    return true;
+}
+
+inline bool
+numericExpressionResultToType(double v,
+                              bool /*isInt*/,
+                              bool* ret)
+{
+    *ret = v != 0.;
+
+    return true;
+}
+
+inline bool
+numericExpressionResultToType(double v,
+                              bool /*isInt*/,
+                              double* ret)
+{
+    *ret = v;
+
+    return true;
+}
+
+inline bool
+numericExpressionResultToType(double /*v*/,
+                              bool /*isInt*/,
+                              std::string* /*ret*/)
+{
+    return false;
+}
+
 template <typename T>
 bool
 Knob<T>::getValueFromExpression(double time,
@@ -491,17 +534,32 @@ Knob<T>::getValueFromExpression(double time,
 
 
     ///Check first if a value was already computed:
+    if ( getExpressionResult(time, dimension, ret) ) {
+        return true;
+    }
 
+    ///Plain arithmetic does not need Python
     {
-        QMutexLocker k(&_valueMutex);
-        typename FrameValueMap::iterator found = _exprRes[dimension].find(time);
-        if ( found != _exprRes[dimension].end() ) {
-            *ret = found->second;
+        double v;
+        bool isInt;
+        if ( evaluateNumericExpression(time, view, dimension, &v, &isInt) && numericExpressionResultToType(v, isInt, ret) ) {
+            if (clamp) {
+                *ret =  clampToMinMax(*ret, dimension);
+            }
+            QMutexLocker k(&_valueMutex);
+            _exprRes[dimension].insert( std::make_pair(time, *ret) );
 
             return true;
         }
     }
 
+    ///Render threads requesting the same frame wait on the GIL: check again once we own it, so that the
+    ///expression runs once per frame and the other threads read its result
+    PythonGILLocker pgl;
+    if ( getExpressionResult(time, dimension, ret) ) {
+        return true;
+    }
+
     bool exprWasValid = isExpressionValid(dimension, 0);
     {
         EXPR_RECURSION_LEVEL();
@@ -579,17 +637,37 @@ Knob<T>::getValueFromExpression_pod(double time,
 
 
     ///Check first if a value was already computed:
+    ///The value mutex is not held while the expression runs: it may read other knobs
+    T cached;
+    if ( getExpressionResult(time, dimension, &cached) ) {
+        *ret = cached;
+
+        return true;
+    }
 
+    {
+        double v;
+        bool isInt;
+        if ( evaluateNumericExpression(time, view, dimension, &v, &isInt) && numericExpressionResultToType(v, isInt, &cached) ) {
+            if (clamp) {
+                cached = clampToMinMax(cached, dimension);
+            }
+            *ret = cached;
+            QMutexLocker k(&_valueMutex);
+            _exprRes[dimension].insert( std::make_pair(time, cached) );
 
-    QMutexLocker k(&_valueMutex);
-    typename FrameValueMap::iterator found = _exprRes[dimension].find(time);
-    if ( found != _exprRes[dimension].end() ) {
-        *ret = found->second;
+            return true;
+        }
+    }
+
+    ///Same as getValueFromExpression: look again once the GIL is owned
+    PythonGILLocker pgl;
+    if ( getExpressionResult(time, dimension, &cached) ) {
+        *ret = cached;
 
         return true;
     }
 
-
     bool exprWasValid = isExpressionValid(dimension, 0);
     {
         EXPR_RECURSION_LEVEL();
@@ -610,7 +688,7 @@ Knob<T>::getValueFromExpression_pod(double time,
         *ret =  clampToMinMax(*ret, dimension);
     }
 
-    //QWriteLocker k(&_valueMutex);
+    QMutexLocker k(&_valueMutex);
     _exprRes[dimension].insert( std::make_pair(time, *ret) );
 
     return true;
@@ -819,6 +897,35 @@ KnobStringBase::getValueFromCurve(double time,
     return false;
 }
 
+template<typename T>
+bool
+Knob<T>::getValueFromRenderValuesSnapshot(double time,
+                                          ViewSpec view,
+                                          int dimension,
+                                          bool clamp,
+                                          T* ret) const
+{
+    // The snapshot only holds clamped values
+    double value;
+    if ( !clamp || !getRenderValuesSnapshotValue(time, view, dimension, &value) ) {
+        return false;
+    }
+    *ret = (T)value;
+
+    return true;
+}
+
+template<>
+bool
+KnobStringBase::getValueFromRenderValuesSnapshot(double /*time*/,
+                                                 ViewSpec /*view*/,
+                                                 int /*dimension*/,
+                                                 bool /*clamp*/,
+                                                 std::string* /*ret*/) const
+{
+    return false;
+}
+
 template<typename T>
 T
 Knob<T>::getValueAtTime(double time,
@@ -833,6 +940,13 @@ Knob<T>::getValueAtTime(double time,
     }
 
     bool useGuiValues = QThread::currentThread() == qApp->thread();
+    if (!useGuiValues && !byPassMaster) {
+        // Render threads read the values taken when the render of the frame was set up
+        T snapshotValue;
+        if ( getValueFromRenderValuesSnapshot(time, view, dimension, clamp, &snapshotValue) ) {
+            return snapshotValue;
+        }
+    }
     std::string hasExpr = getExpression(dimension);
     if ( !hasExpr.empty() ) {
         T ret;
@@ -2247,6 +2361,95 @@ Knob<T>::setKeyFrame(const KeyFrame& key,
     return ret;
 }
 
+template<typename T>
+bool
+Knob<T>::setKeyFrames(const std::vector<KeyFrame>& keys,
+                      ViewSpec view,
+                      int dimension,
+                      ValueChangedReasonEnum reason)
+{
+    if ( keys.empty() ) {
+        return false;
+    }
+    CurvePtr curve;
+    KnobHolder* holder = getHolder();
+    bool useGuiCurve = ( !holder || !holder->isSetValueCurrentlyPossible() ) && getKnobGuiPointer();
+
+    if (!useGuiCurve) {
+        assert(holder);
+        curve = getCurve(view, dimension);
+    } else {
+        curve = getGuiCurve(view, dimension);
+        setGuiCurveHasChanged(view, dimension, true);
+    }
+
+    bool ret = curve->addKeyFrames(keys);
+
+    if (!useGuiCurve) {
+        guiCurveCloneInternalCurve(eCurveChangeReasonInternal, view, dimension, reason);
+        evaluateValueChange(dimension, keys.front().getTime(), view, reason);
+    }
+
+    return ret;
+}
+
+template<typename T>
+void
+Knob<T>::setValuesAtTimes(const std::vector<double>& times,
+                          const std::vector<T>& values,
+                          ViewSpec view,
+                          int dimension,
+                          ValueChangedReasonEnum reason)
+{
+    assert( times.size() == values.size() );
+    if ( times.empty() || ( times.size() != values.size() ) || (dimension < 0) || ( dimension >= (int)_values.size() ) ) {
+        return;
+    }
+
+    KnobHolder* holder = getHolder();
+    bool setOneByOne = !canAnimate() || !isAnimationEnabled() || ( holder && !holder->isSetValueCurrentlyPossible() ) ||
+                       ( (reason == eValueChangedReasonPluginEdited) && getKnobGuiPointer() );
+    if (setOneByOne) {
+        // setValueAtTime knows how to queue the values or create the undo/redo commands
+        beginChanges();
+        KeyFrame k;
+        for (std::size_t i = 0; i < times.size(); ++i) {
+            setValueAtTime(times[i], values[i], view, dimension, reason, &k);
+        }
+        endChanges();
+
+        return;
+    }
+
+    dequeueValuesSet(true);
+
+    CurvePtr curve = getCurve(view, dimension, true);
+    assert(curve);
+    if (!curve) {
+        return;
+    }
+
+    std::vector<KeyFrame> keys( times.size() );
+    std::list<double> keysTimes;
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        makeKeyFrame(curve.get(), times[i], view, values[i], &keys[i]);
+        keysTimes.push_back(times[i]);
+    }
+
+    curve->addKeyFrames(keys);
+
+    if (holder) {
+        holder->setHasAnimation(true);
+    }
+    guiCurveCloneInternalCurve(eCurveChangeReasonInternal, view, dimension, reason);
+
+    if (_signalSlotHandler) {
+        _signalSlotHandler->s_multipleKeyFramesSet(keysTimes, view, dimension, (int)reason);
+    }
+
+    evaluateValueChange(dimension, times.front(), view, reason);
+} // setValuesAtTimes
+
 template<typename T>
 bool
 Knob<T>::onKeyFrameSet(double /*time*/,
@@ -45,7 +45,10 @@
 
 #include <map>
 #include <list>
+#include <vector>
 #include <utility>
+#include <cassert>
+#include <algorithm>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 CLANG_DIAG_OFF(unknown-pragmas)
 CLANG_DIAG_OFF(redeclared-class-member)
@@ -54,6 +57,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/bimap/set_of.hpp>
 #include <boost/bimap/unordered_set_of.hpp>
 #include <boost/bimap.hpp>
+#include <boost/cstdint.hpp>
 CLANG_DIAG_ON(redeclared-class-member)
 CLANG_DIAG_ON(unknown-pragmas)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
@@ -65,10 +69,12 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 //#define USE_VARIADIC_TEMPLATES
 #define NATRON_CACHE_USE_HASH
 #define NATRON_CACHE_USE_BOOST
+#define NATRON_CACHE_USE_INTRUSIVE
 
 
-/**@brief 4 types of LRU caches are defined here:
+/**@brief 5 types of LRU caches are defined here:
  *
+ *- Intrusive: open-addressing table with the access history threaded through its slots
  *- STL with hashing : std::unordered_map
  *- STL with comparison: std::map
  *- BOOST with hashing: boost::bimap with boost::unordered_set_of
@@ -89,6 +95,10 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
  *(std::unordered_map or boost::unordered_set_of) instead of a
  * tree-based version (std::map or boost::set_of).
  *
+ * NATRON_CACHE_USE_INTRUSIVE : define this to use the intrusive table, which does not
+ * allocate anything when a record is accessed. It takes precedence over all the other
+ * defines and only works with integral keys.
+ *
  * WARNING:  defining NATRON_CACHE_USE_HASH and not defining
  * NATRON_CACHE_USE_BOOST will require USE_VARIADIC_TEMPLATES to be
  * defined otherwise it will not compile. (no std::unordered_map
@@ -96,6 +106,466 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
  *
  **/
 
+#ifdef NATRON_CACHE_USE_INTRUSIVE
+
+// LRU-replacement hash table where records are stored in place in an open-addressing
+// table (linear probing) indexed by the hash key itself. The access history is an intrusive
+// doubly-linked list threaded through the table slots with slot indices, hence touching a
+// record on a cache hit is O(1) and does not allocate anything.
+// The table is grown (rehashed) when its load factor goes beyond 0.7, the access history is preserved.
+// Erasing a record uses backward-shift deletion so that no tombstone is ever left in the table.
+//
+// K must be an integral type (the cache hash keys). The records have the same layout as the
+// other tables of this file: a key and a list of values sharing that key.
+//
+// Which record gets evicted is decided by the EvictionPolicy template parameter, see below.
+
+/**
+ * @brief Strict LRU eviction: the least recently used record that is not referenced anywhere else is evicted.
+ *
+ * An eviction policy gives records "credits": when a record is about to be evicted and still has credits,
+ * one credit is consumed and the record is moved to the most recently used end of the history instead
+ * (second chance, as in the CLOCK algorithm). A policy must provide:
+ *
+ * - getMaxCredit(): the maximum number of credits a record may accumulate with hits. Each hit on the record
+ *   (the table operator()) gives one credit.
+ * - getCostCredit(value): the credits to give once to a record the first time it is considered for eviction,
+ *   e.g: depending on how expensive the value is to compute again.
+ * - isPinned(value): whether the value must be skipped when evict() is asked to keep the pinned values.
+ **/
+template <typename V>
+class LRUEvictionPolicy
+{
+public:
+
+    static unsigned int getMaxCredit()
+    {
+        return 0;
+    }
+
+    static unsigned int getCostCredit(const V & /*value*/)
+    {
+        return 0;
+    }
+
+    static bool isPinned(const V & /*value*/)
+    {
+        return false;
+    }
+};
+
+/**
+ * @brief Scan-resistant eviction: records that were accessed more than once are given second chances,
+ * hence a long sequence of records accessed only once (e.g: the user scrubbing the timeline) does not flush
+ * the records that are frequently used.
+ **/
+template <typename V>
+class ScanResistantEvictionPolicy
+{
+public:
+
+    static unsigned int getMaxCredit()
+    {
+        return 3;
+    }
+
+    static unsigned int getCostCredit(const V & /*value*/)
+    {
+        return 0;
+    }
+
+    static bool isPinned(const V & /*value*/)
+    {
+        return false;
+    }
+};
+
+///WARNING: Cached element must have a use_count() method that returns
+///the current reference counting of the object. Typically a shared_ptr.
+
+template <typename K, typename V, typename EvictionPolicy = LRUEvictionPolicy<V> >
+class IntrusiveLRUHashTable
+{
+public:
+    typedef K key_type;
+    typedef std::list<V> value_type;
+
+    struct Slot
+    {
+        key_type first;
+        value_type second;
+
+        // LRU hooks: index of the previous (less recently used) and next (more recently used) slots, -1 if none
+        int lruPrev;
+        int lruNext;
+
+        // Second chances left before the record gets evicted, see LRUEvictionPolicy
+        unsigned int credit;
+
+        // True once the cost credit of the record was given by the policy
+        bool costCredited;
+        bool used;
+
+        Slot()
+            : first()
+            , second()
+            , lruPrev(-1)
+            , lruNext(-1)
+            , credit(0)
+            , costCredited(false)
+            , used(false)
+        {
+        }
+    };
+
+    class iterator
+    {
+        friend class IntrusiveLRUHashTable;
+
+        std::vector<Slot>* _slots;
+        std::size_t _index;
+
+    public:
+
+        iterator()
+            : _slots(0)
+            , _index(0)
+        {
+        }
+
+        iterator(std::vector<Slot>* slots,
+                 std::size_t index)
+            : _slots(slots)
+            , _index(index)
+        {
+        }
+
+        Slot* operator->() const
+        {
+            return &(*_slots)[_index];
+        }
+
+        Slot& operator*() const
+        {
+            return (*_slots)[_index];
+        }
+
+        iterator& operator++()
+        {
+            ++_index;
+            while ( _index < _slots->size() && !(*_slots)[_index].used ) {
+                ++_index;
+            }
+
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const
+        {
+            return _index == other._index;
+        }
+
+        bool operator!=(const iterator& other) const
+        {
+            return _index != other._index;
+        }
+    };
+
+    typedef iterator const_iterator;
+
+    IntrusiveLRUHashTable()
+        : _slots(16)
+        , _size(0)
+        , _lruHead(-1)
+        , _lruTail(-1)
+    {
+    }
+
+    // Obtain the record for k and mark it as the most recently used
+    iterator operator()(const key_type & k)
+    {
+        int index = findSlot(k);
+
+        if (index == -1) {
+            return end();
+        }
+        // We do have it:
+        // Update access record by moving it to the back of the history
+        if ( _slots[index].credit < EvictionPolicy::getMaxCredit() ) {
+            ++_slots[index].credit;
+        }
+        lruUnlink(index);
+        lruAppend(index);
+
+        return iterator(&_slots, index);
+    }
+
+    void erase(iterator it)
+    {
+        eraseSlot(it._index);
+    }
+
+    iterator end()
+    {
+        return iterator( &_slots, _slots.size() );
+    }
+
+    iterator begin()
+    {
+        iterator it(&_slots, 0);
+
+        if ( !_slots[0].used ) {
+            ++it;
+        }
+
+        return it;
+    }
+
+    void insert(const key_type & k,
+                const value_type& list)
+    {
+        if (findSlot(k) != -1) {
+            return;
+        }
+        int index = insertSlot(k);
+        _slots[index].second = list;
+    }
+
+    // Record a fresh key-value pair in the cache
+    void insert(const key_type & k,
+                const V & v)
+    {
+        int index = findSlot(k);
+
+        if (index != -1) {
+            _slots[index].second.push_back(v);
+            lruUnlink(index);
+            lruAppend(index);
+        } else {
+            index = insertSlot(k);
+            _slots[index].second.push_back(v);
+        }
+    }
+
+    void clear()
+    {
+        std::vector<Slot>(16).swap(_slots);
+        _size = 0;
+        _lruHead = _lruTail = -1;
+    }
+
+    // Purge the least-recently-used element in the cache which is not referenced anywhere else
+    // and which has no credit left according to the eviction policy.
+    // If keepPinned is true, the values pinned according to the eviction policy are not evicted.
+    std::pair<key_type, V> evict(bool keepPinned = false)
+    {
+        int index = _lruHead;
+
+        while (index != -1) {
+            Slot& slot = _slots[index];
+            int next = slot.lruNext;
+            typename value_type::iterator it2 = slot.second.begin();
+            while ( it2 != slot.second.end() && ( ( (*it2).use_count() != 1 ) || ( keepPinned && EvictionPolicy::isPinned(*it2) ) ) ) {
+                ++it2;
+            }
+            if ( it2 == slot.second.end() ) {
+                index = next;
+                continue;
+            }
+            if (!slot.costCredited) {
+                slot.costCredited = true;
+                slot.credit = std::min( slot.credit + EvictionPolicy::getCostCredit(*it2), EvictionPolicy::getMaxCredit() );
+            }
+            if (slot.credit > 0) {
+                // Second chance: move it to the back of the history, it will be visited again
+                // once all the records that were before it have been considered
+                --slot.credit;
+                if (next == -1) {
+                    // Already the most recently used, go around
+                    index = _lruHead;
+                } else {
+                    lruUnlink(index);
+                    lruAppend(index);
+                    index = next;
+                }
+                continue;
+            }
+            std::pair<key_type, V> ret = std::make_pair(slot.first, *it2);
+            if (slot.second.size() == 1) {
+                eraseSlot(index);
+            } else {
+                slot.second.erase(it2);
+            }
+
+            return ret;
+        }
+
+        return std::make_pair( key_type(), V() );
+    }
+
+    unsigned int size()
+    {
+        return (unsigned int)_size;
+    }
+
+private:
+
+    std::size_t homeSlot(const key_type & k) const
+    {
+        // Fibonacci hashing: the keys are hashes already but their low bits may be poorly distributed
+        boost::uint64_t h = (boost::uint64_t)k * 0x9E3779B97F4A7C15ULL;
+
+        return (std::size_t)(h ^ (h >> 32)) & (_slots.size() - 1);
+    }
+
+    int findSlot(const key_type & k) const
+    {
+        const std::size_t mask = _slots.size() - 1;
+
+        for (std::size_t i = homeSlot(k); _slots[i].used; i = (i + 1) & mask) {
+            if (_slots[i].first == k) {
+                return (int)i;
+            }
+        }
+
+        return -1;
+    }
+
+    // Insert a new empty record for k which must not be in the table already, it becomes the most recently used
+    int insertSlot(const key_type & k)
+    {
+        if ( (_size + 1) * 10 > _slots.size() * 7 ) {
+            rehash(_slots.size() * 2);
+        }
+        const std::size_t mask = _slots.size() - 1;
+        std::size_t i = homeSlot(k);
+        while (_slots[i].used) {
+            i = (i + 1) & mask;
+        }
+        _slots[i].used = true;
+        _slots[i].first = k;
+        _slots[i].credit = 0;
+        _slots[i].costCredited = false;
+        ++_size;
+        lruAppend(i);
+
+        return (int)i;
+    }
+
+    void eraseSlot(std::size_t index)
+    {
+        const std::size_t mask = _slots.size() - 1;
+
+        lruUnlink(index);
+        _slots[index].used = false;
+        value_type().swap(_slots[index].second);
+        --_size;
+
+        // Backward-shift deletion: move back the following records of the probe sequence
+        // that would no longer be reachable because of the hole
+        std::size_t hole = index;
+        for (std::size_t j = (hole + 1) & mask; _slots[j].used; j = (j + 1) & mask) {
+            std::size_t home = homeSlot(_slots[j].first);
+            // Can the record at j be moved to the hole, i.e: is its home slot cyclically outside ]hole, j] ?
+            bool movable = (hole <= j) ? (home <= hole || home > j) : (home <= hole && home > j);
+            if (!movable) {
+                continue;
+            }
+            moveSlot(j, hole);
+            hole = j;
+        }
+    }
+
+    // Move the record at index from to the unused slot at index to and fix the access history links
+    void moveSlot(std::size_t from,
+                  std::size_t to)
+    {
+        Slot& src = _slots[from];
+        Slot& dst = _slots[to];
+
+        assert(!dst.used);
+        dst.first = src.first;
+        dst.second.swap(src.second);
+        dst.lruPrev = src.lruPrev;
+        dst.lruNext = src.lruNext;
+        dst.credit = src.credit;
+        dst.costCredited = src.costCredited;
+        dst.used = true;
+        if (dst.lruPrev != -1) {
+            _slots[dst.lruPrev].lruNext = (int)to;
+        } else {
+            _lruHead = (int)to;
+        }
+        if (dst.lruNext != -1) {
+            _slots[dst.lruNext].lruPrev = (int)to;
+        } else {
+            _lruTail = (int)to;
+        }
+        src.used = false;
+        src.lruPrev = src.lruNext = -1;
+    }
+
+    void rehash(std::size_t newCapacity)
+    {
+        std::vector<Slot> oldSlots(newCapacity);
+        oldSlots.swap(_slots);
+        int oldIndex = _lruHead;
+
+        _size = 0;
+        _lruHead = _lruTail = -1;
+        // Re-insert in the access history order so that it is preserved
+        while (oldIndex != -1) {
+            Slot& oldSlot = oldSlots[oldIndex];
+            int index = insertSlot(oldSlot.first);
+            _slots[index].second.swap(oldSlot.second);
+            _slots[index].credit = oldSlot.credit;
+            _slots[index].costCredited = oldSlot.costCredited;
+            oldIndex = oldSlot.lruNext;
+        }
+    }
+
+    void lruUnlink(std::size_t index)
+    {
+        Slot& slot = _slots[index];
+
+        if (slot.lruPrev != -1) {
+            _slots[slot.lruPrev].lruNext = slot.lruNext;
+        } else {
+            _lruHead = slot.lruNext;
+        }
+        if (slot.lruNext != -1) {
+            _slots[slot.lruNext].lruPrev = slot.lruPrev;
+        } else {
+            _lruTail = slot.lruPrev;
+        }
+        slot.lruPrev = slot.lruNext = -1;
+    }
+
+    void lruAppend(std::size_t index)
+    {
+        Slot& slot = _slots[index];
+
+        slot.lruPrev = _lruTail;
+        slot.lruNext = -1;
+        if (_lruTail != -1) {
+            _slots[_lruTail].lruNext = (int)index;
+        } else {
+            _lruHead = (int)index;
+        }
+        _lruTail = (int)index;
+    }
+
+    // The table, its size is always a power of 2
+    std::vector<Slot> _slots;
+    std::size_t _size;
+
+    // Least and most recently used records
+    int _lruHead;
+    int _lruTail;
+};
+
+#else // !NATRON_CACHE_USE_INTRUSIVE
+
 #ifdef USE_VARIADIC_TEMPLATES // c++11 is defined as well as unordered_map
 
 #  ifndef NATRON_CACHE_USE_BOOST
@@ -193,8 +663,8 @@ public:
         _key_tracker.clear();
     }
 
-    // Purge the least-recently-used element in the cache
-    std::pair<key_type, V> evict()
+    // Purge the least-recently-used element in the cache. Eviction policies, hence pinning, are not supported.
+    std::pair<key_type, V> evict(bool /*keepPinned*/ = false)
     {
         // Assert method is never called when cache is empty
         assert( !_key_tracker.empty() );
@@ -309,7 +779,7 @@ public:
         _container.clear();
     }
 
-    std::pair<key_type, V> evict()
+    std::pair<key_type, V> evict(bool /*keepPinned*/ = false)
     {
         typename container_type::right_iterator it = _container.right.begin();
         while ( it != _container.right.end() ) {
@@ -427,8 +897,8 @@ public:
         _key_tracker.clear();
     }
 
-    // Purge the least-recently-used element in the cache
-    std::pair<key_type, V> evict()
+    // Purge the least-recently-used element in the cache. Eviction policies, hence pinning, are not supported.
+    std::pair<key_type, V> evict(bool /*keepPinned*/ = false)
     {
         // Assert method is never called when cache is empty
         assert( !_key_tracker.empty() );
@@ -539,7 +1009,7 @@ public:
         _container.clear();
     }
 
-    std::pair<key_type, V> evict()
+    std::pair<key_type, V> evict(bool /*keepPinned*/ = false)
     {
         typename container_type::right_iterator it = _container.right.begin();
         while ( it != _container.right.end() ) {
@@ -641,7 +1111,7 @@ public:
         _container.clear();
     }
 
-    std::pair<key_type, V> evict()
+    std::pair<key_type, V> evict(bool /*keepPinned*/ = false)
     {
         typename container_type::right_iterator it = _container.right.begin();
         while ( it != _container.right.end() ) {
@@ -677,4 +1147,6 @@ private:
 
 #endif // !USE_VARIADIC_TEMPLATES
 
+#endif // NATRON_CACHE_USE_INTRUSIVE
+
 #endif // ifndef NATRON_ENGINE_LRUCACHE_H
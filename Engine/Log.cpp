@@ -35,9 +35,11 @@
 #include <cassert>
 #include <stdexcept>
 
+#include <QtCore/QCoreApplication>
 #include <QtCore/QFile>
-#include <QtCore/QTextStream>
 #include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
 
 #include "Global/GlobalDefines.h"
 
@@ -73,26 +75,71 @@ string_format(const std::string fmt,
     return str;
 }
 
+class LogPrivate;
+
+/**
+ * @brief Writes the lines queued by LogPrivate to the log file, so that the threads
+ * calling Log::print() never wait for the disk. Whatever was queued while the previous
+ * batch was being written is written and flushed at once.
+ **/
+class LogWriterThread
+    : public QThread
+{
+public:
+
+    LogWriterThread(LogPrivate* imp)
+        : QThread()
+        , _imp(imp)
+    {
+        setObjectName( QString::fromUtf8("LogWriter") );
+    }
+
+    virtual ~LogWriterThread()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    LogPrivate* _imp;
+};
+
 class LogPrivate
 {
 public:
 
+    // protects all members below except _file, which is only used by the writer thread once opened
     mutable QMutex _lock;
+    QWaitCondition _pendingCond;
     QFile* _file;
-    QTextStream* _stream;
+    std::string _pending; //< text not written yet
+    bool _mustQuit;
     int _beginsCount;
+    LogWriterThread _writer;
 
     LogPrivate()
         : _lock()
+        , _pendingCond()
         , _file(NULL)
-        , _stream(NULL)
+        , _pending()
+        , _mustQuit(false)
         , _beginsCount(0)
+        , _writer(this)
     {
     }
 
     ~LogPrivate()
     {
-        delete _stream;
+        if ( _writer.isRunning() ) {
+            {
+                QMutexLocker locker(&_lock);
+                _mustQuit = true;
+                _pendingCond.wakeOne();
+            }
+            // the writer empties the queue before quitting
+            _writer.wait();
+        }
         if (_file) {
             _file->close();
             delete _file;
@@ -106,78 +153,141 @@ public:
         if (_file) {
             return;
         }
-        _file = new QFile( fileName.c_str() );
+        _file = new QFile( QString::fromUtf8( fileName.c_str() ) );
         _file->open(QIODevice::WriteOnly | QIODevice::Truncate);
-        _stream = new QTextStream(_file);
+        _writer.start(QThread::LowPriority);
+    }
+
+    bool isOpen() const
+    {
+        QMutexLocker locker(&_lock);
+
+        return _file != NULL;
+    }
+
+    /// Queues text for the writer thread: the only work done under the lock is the append.
+    void enqueue(const std::string & text)
+    {
+        QMutexLocker locker(&_lock);
+        bool wasEmpty = _pending.empty();
+
+        _pending.append(text);
+        if (wasEmpty) {
+            _pendingCond.wakeOne();
+        }
+    }
+
+    /// Returns the indentation depth to use for a line, and moves it by 'delta' afterwards (or before if delta < 0)
+    int nextIndentation(int delta)
+    {
+        QMutexLocker locker(&_lock);
+
+        if (delta < 0) {
+            _beginsCount += delta;
+
+            return _beginsCount;
+        }
+        int ret = _beginsCount;
+        _beginsCount += delta;
+
+        return ret;
+    }
+
+    static void indent(int count,
+                       std::string* line)
+    {
+        for (int i = 0; i < count; ++i) {
+            line->append("    ");
+        }
     }
 
     void beginFunction(const std::string & callerName,
                        const std::string & function)
     {
-        if (!_file) {
+        if ( !isOpen() ) {
             QString filename(NATRON_APPLICATION_NAME + QString("_log") + QString::number( QCoreApplication::instance()->applicationPid() ) + ".txt");
             open( filename.toStdString() );
         }
-        QMutexLocker locker(&_lock);
-        _stream->operator <<("********************************************************************************\n");
-        for (int i = 0; i < _beginsCount; ++i) {
-            _stream->operator <<("    ");
-        }
-        _stream->operator <<("START ");
-        _stream->operator <<( callerName.c_str() );
-        _stream->operator <<("    ");
-        _stream->operator <<( function.c_str() );
-        _stream->operator <<('\n');
-        _stream->flush();
-        ++_beginsCount;
+
+        std::string line("********************************************************************************\n");
+        indent(nextIndentation(1), &line);
+        line.append("START ");
+        line.append(callerName);
+        line.append("    ");
+        line.append(function);
+        line.push_back('\n');
+        enqueue(line);
     }
 
     void print(const std::string & log)
     {
-        QMutexLocker locker(&_lock);
-
-        assert(_file);
-        for (int i = 0; i < _beginsCount; ++i) {
-            _stream->operator <<("    ");
-        }
-        QString str( log.c_str() );
-        for (int i = 0; i < str.size(); ++i) {
-            _stream->operator <<( str.at(i).toLatin1() );
+        assert( isOpen() );
+
+        int beginsCount = nextIndentation(0);
+        std::string line;
+        line.reserve( log.size() + (log.size() / 80 + 1) * (4 * beginsCount + 1) + 1 );
+        indent(beginsCount, &line);
+        for (std::size_t i = 0; i < log.size(); ++i) {
+            line.push_back(log[i]);
             if ( (i % 80 == 0) && (i != 0) ) { // format to 80 columns
                 /*Find closest word end and insert a new line*/
                 ++i;
-                while ( i < str.size() && str.at(i) != QChar(' ') ) {
-                    _stream->operator <<( str.at(i).toLatin1() );
+                while ( i < log.size() && log[i] != ' ' ) {
+                    line.push_back(log[i]);
                     ++i;
                 }
-                _stream->operator <<('\n');
-                for (int i = 0; i < _beginsCount; ++i) {
-                    _stream->operator <<("    ");
-                }
+                line.push_back('\n');
+                indent(beginsCount, &line);
             }
         }
-        _stream->operator <<( log.c_str() );
-        _stream->operator <<('\n');
-        _stream->flush();
+        line.push_back('\n');
+        enqueue(line);
     }
 
     void endFunction(const std::string & callerName,
                      const std::string & function)
     {
-        QMutexLocker locker(&_lock);
+        std::string line;
+
+        indent(nextIndentation(-1), &line);
+        line.append("STOP ");
+        line.append(callerName);
+        line.append("    ");
+        line.append(function);
+        line.push_back('\n');
+        enqueue(line);
+    }
+};
 
-        --_beginsCount;
-        for (int i = 0; i < _beginsCount; ++i) {
-            _stream->operator <<("    ");
+void
+LogWriterThread::run()
+{
+    std::string batch;
+
+    for (;;) {
+        bool mustQuit;
+        {
+            QMutexLocker locker(&_imp->_lock);
+            while ( _imp->_pending.empty() && !_imp->_mustQuit ) {
+                _imp->_pendingCond.wait(&_imp->_lock);
+            }
+            batch.swap(_imp->_pending);
+            mustQuit = _imp->_mustQuit;
+        }
+        if ( !batch.empty() ) {
+            _imp->_file->write( batch.data(), (qint64)batch.size() );
+            _imp->_file->flush();
+            // keep the capacity for the next swap
+            batch.clear();
+        }
+        if (mustQuit) {
+            QMutexLocker locker(&_imp->_lock);
+            if ( _imp->_pending.empty() ) {
+                return;
+            }
         }
-        _stream->operator <<("STOP ");
-        _stream->operator <<( callerName.c_str() );
-        _stream->operator <<("    ");
-        _stream->operator <<( function.c_str() );
-        _stream->operator <<('\n');
-        _stream->flush();
     }
-};
+}
 
 Log::Log()
     : Singleton<Log>()
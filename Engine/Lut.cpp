@@ -269,39 +269,37 @@ Lut::toColorSpaceUint16FromLinearFloatFast(float v) const
     assert(init_);
     // algorithm:
     // - convert to 8 bits -> val8u
-    // - convert val8u-1, val8u and val8u+1 to float
-    // - interpolate linearly in the right interval
+    // - find the interval [val8u, val8u+1] whose float values contain v
+    // - interpolate linearly in that interval
     unsigned char v8u = toColorSpaceUint8FromLinearFloatFast(v);
-    unsigned char v8u_next, v8u_prev;
-    float v32f_next, v32f_prev;
-    if (v8u == 0) {
-        v8u_prev = 0;
-        v8u_next = 1;
-        v32f_prev = fromColorSpaceUint8ToLinearFloatFast(0);
-        v32f_next = fromColorSpaceUint8ToLinearFloatFast(1);
-    } else if (v8u == 255) {
-        v8u_prev = 254;
-        v8u_next = 255;
-        v32f_prev = fromColorSpaceUint8ToLinearFloatFast(254);
-        v32f_next = fromColorSpaceUint8ToLinearFloatFast(255);
-    } else {
-        float v32f = fromColorSpaceUint8ToLinearFloatFast(v8u);
-        // we suppose the LUT is an increasing func
-        if (v < v32f) {
-            v8u_prev = v8u - 1;
-            v32f_prev = fromColorSpaceUint8ToLinearFloatFast(v8u_prev);
-            v8u_next = v8u;
-            v32f_next = v32f;
-        } else {
-            v8u_prev = v8u;
-            v32f_prev = v32f;
-            v8u_next = v8u + 1;
-            v32f_next = fromColorSpaceUint8ToLinearFloatFast(v8u_next);
-        }
+    // toFunc_hipart_to_uint8xx is indexed by the 7 upper bits of the mantissa, so near 1.
+    // the first guess may be off by more than one code value: walk to the right interval
+    // (we suppose the LUT is an increasing func)
+    while ( v8u > 0 && v < fromFunc_uint8_to_float[v8u] ) {
+        --v8u;
+    }
+    while ( v8u < 254 && v >= fromFunc_uint8_to_float[v8u + 1] ) {
+        ++v8u;
+    }
+    if (v8u == 255) {
+        v8u = 254;
     }
+    unsigned char v8u_prev = v8u;
+    unsigned char v8u_next = v8u + 1;
+    float v32f_prev = fromFunc_uint8_to_float[v8u_prev];
+    float v32f_next = fromFunc_uint8_to_float[v8u_next];
 
     // interpolate linearly
-    return (v8u_prev << 8) + v8u_prev + (v - v32f_prev) * ( ( (v8u_next - v8u_prev) << 8 ) + (v8u_next + v8u_prev) ) / (v32f_next - v32f_prev) + 0.5;
+    float v16f = (v8u_prev << 8) + v8u_prev + (v - v32f_prev) * ( ( (v8u_next - v8u_prev) << 8 ) + (v8u_next - v8u_prev) ) / (v32f_next - v32f_prev) + 0.5f;
+
+    // values outside of the LUT range extrapolate beyond [0, 65535]
+    if (v16f <= 0.f) {
+        return 0;
+    } else if (v16f >= 65535.f) {
+        return 65535;
+    }
+
+    return (unsigned short)v16f;
 }
 
 float
@@ -399,20 +397,28 @@ Lut::to_byte_planar(unsigned char* to,
 
 #endif // DEAD_CODE
 
-#ifdef DEAD_CODE
 void
-Lut::to_short_planar(unsigned short* /*to*/,
-                     const float* /*from*/,
-                     int /*W*/,
-                     const float* /*alpha*/,
-                     int /*inDelta*/,
-                     int /*outDelta*/) const
+Lut::to_short_planar(unsigned short* to,
+                     const float* from,
+                     int W,
+                     const float* alpha,
+                     int inDelta,
+                     int outDelta) const
 {
-    throw std::runtime_error("Lut::to_short_planar not implemented yet.");
+    validate();
+    // 16-bit output does not need error diffusion: the locally linear
+    // approximation of toColorSpaceUint16FromLinearFloatFast is precise enough.
+    if (!alpha) {
+        for (int f = 0, t = 0; f < W; f += inDelta, t += outDelta) {
+            to[t] = toColorSpaceUint16FromLinearFloatFast(from[f]);
+        }
+    } else {
+        for (int f = 0, t = 0; f < W; f += inDelta, t += outDelta) {
+            to[t] = toColorSpaceUint16FromLinearFloatFast(from[f] * alpha[f]);
+        }
+    }
 }
 
-#endif // DEAD_CODE
-
 void
 Lut::to_float_planar(float* to,
                      const float* from,
@@ -517,22 +523,61 @@ Lut::to_byte_packed(unsigned char* to,
     }
 } // to_byte_packed
 
-#ifdef DEAD_CODE
 void
-Lut::to_short_packed(unsigned short* /*to*/,
-                     const float* /*from*/,
-                     const RectI & /*conversionRect*/,
-                     const RectI & /*srcBounds*/,
-                     const RectI & /*dstBounds*/,
-                     PixelPackingEnum /*inputPacking*/,
-                     PixelPackingEnum /*outputPacking*/,
-                     bool /*invertY*/,
-                     bool /*premult*/) const
+Lut::to_short_packed(unsigned short* to,
+                     const float* from,
+                     const RectI & conversionRect,
+                     const RectI & srcBounds,
+                     const RectI & dstBounds,
+                     PixelPackingEnum inputPacking,
+                     PixelPackingEnum outputPacking,
+                     bool invertY,
+                     bool premult) const
 {
-    throw std::runtime_error("Lut::to_short_packed not implemented yet.");
-}
+    ///clip the conversion rect to srcBounds and dstBounds
+    RectI rect = conversionRect;
 
-#endif // DEAD_CODE
+    if ( !clip(&rect, srcBounds) || !clip(&rect, dstBounds) ) {
+        return;
+    }
+
+    bool inputHasAlpha = inputPacking == ePixelPackingBGRA || inputPacking == ePixelPackingRGBA;
+    bool outputHasAlpha = outputPacking == ePixelPackingBGRA || outputPacking == ePixelPackingRGBA;
+    int inROffset, inGOffset, inBOffset, inAOffset;
+    int outROffset, outGOffset, outBOffset, outAOffset;
+    getOffsetsForPacking(inputPacking, &inROffset, &inGOffset, &inBOffset, &inAOffset);
+    getOffsetsForPacking(outputPacking, &outROffset, &outGOffset, &outBOffset, &outAOffset);
+
+    int inPackingSize, outPackingSize;
+    inPackingSize = inputHasAlpha ? 4 : 3;
+    outPackingSize = outputHasAlpha ? 4 : 3;
+
+    validate();
+
+    for (int y = rect.y1; y < rect.y2; ++y) {
+        int srcY = y;
+        if (invertY) {
+            srcY = srcBounds.y2 - y - 1;
+        }
+
+        int dstY = dstBounds.y2 - y - 1;
+        const float *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
+        unsigned short *dst_pixels = to + (dstY * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
+        for (int x = rect.x1; x < rect.x2; ++x) {
+            int inCol = x * inPackingSize;
+            int outCol = x * outPackingSize;
+            float a = inputHasAlpha ? src_pixels[inCol + inAOffset] : 1.f;
+            float m = premult ? a : 1.f;
+            dst_pixels[outCol + outROffset] = toColorSpaceUint16FromLinearFloatFast(src_pixels[inCol + inROffset] * m);
+            dst_pixels[outCol + outGOffset] = toColorSpaceUint16FromLinearFloatFast(src_pixels[inCol + inGOffset] * m);
+            dst_pixels[outCol + outBOffset] = toColorSpaceUint16FromLinearFloatFast(src_pixels[inCol + inBOffset] * m);
+            if (outputHasAlpha) {
+                // alpha is linear
+                dst_pixels[outCol + outAOffset] = floatToInt<65536>(a);
+            }
+        }
+    }
+} // to_short_packed
 
 void
 Lut::to_float_packed(float* to,
@@ -611,14 +656,24 @@ Lut::from_byte_planar(float* to,
 }
 
 void
-Lut::from_short_planar(float* /*to*/,
-                       const unsigned short* /*from*/,
-                       int /*W*/,
-                       const unsigned short*/* alpha*/,
-                       int /*inDelta*/,
-                       int /* outDelta*/) const
+Lut::from_short_planar(float* to,
+                       const unsigned short* from,
+                       int W,
+                       const unsigned short* alpha,
+                       int inDelta,
+                       int outDelta) const
 {
-    throw std::runtime_error("Lut::from_short_planar not implemented yet.");
+    validate();
+    if (!alpha) {
+        for (int f = 0, t = 0; f < W; f += inDelta, t += outDelta) {
+            to[t] = fromColorSpaceUint16ToLinearFloatFast(from[f]);
+        }
+    } else {
+        for (int f = 0, t = 0; f < W; f += inDelta, t += outDelta) {
+            float a = Color::intToFloat<65536>(alpha[f]);
+            to[t] = a <= 0. ? 0. : fromColorSpaceUint16ToLinearFloatFast( Color::floatToInt<65536>(Color::intToFloat<65536>(from[f]) / a) ) * a;
+        }
+    }
 }
 
 void
@@ -723,18 +778,77 @@ Lut::from_byte_packed(float* to,
 } // from_byte_packed
 
 void
-Lut::from_short_packed(float* /*to*/,
-                       const unsigned short* /*from*/,
-                       const RectI & /*conversionRect*/,
-                       const RectI & /*srcBounds*/,
-                       const RectI & /*dstBounds*/,
-                       PixelPackingEnum /*inputPacking*/,
-                       PixelPackingEnum /*outputPacking*/,
-                       bool /*invertY*/,
-                       bool /*premult*/) const
-{
-    throw std::runtime_error("Lut::from_short_packed not implemented yet.");
-}
+Lut::from_short_packed(float* to,
+                       const unsigned short* from,
+                       const RectI & conversionRect,
+                       const RectI & srcBounds,
+                       const RectI & dstBounds,
+                       PixelPackingEnum inputPacking,
+                       PixelPackingEnum outputPacking,
+                       bool invertY,
+                       bool premult) const
+{
+    if ( ( inputPacking == ePixelPackingPLANAR) || ( outputPacking == ePixelPackingPLANAR) ) {
+        throw std::runtime_error("Invalid pixel format.");
+    }
+
+    ///clip the conversion rect to srcBounds and dstBounds
+    RectI rect = conversionRect;
+    if ( !clip(&rect, srcBounds) || !clip(&rect, dstBounds) ) {
+        return;
+    }
+
+
+    bool inputHasAlpha = inputPacking == ePixelPackingBGRA || inputPacking == ePixelPackingRGBA;
+    bool outputHasAlpha = outputPacking == ePixelPackingBGRA || outputPacking == ePixelPackingRGBA;
+    int inROffset, inGOffset, inBOffset, inAOffset;
+    int outROffset, outGOffset, outBOffset, outAOffset;
+    getOffsetsForPacking(inputPacking, &inROffset, &inGOffset, &inBOffset, &inAOffset);
+    getOffsetsForPacking(outputPacking, &outROffset, &outGOffset, &outBOffset, &outAOffset);
+
+    int inPackingSize, outPackingSize;
+    inPackingSize = inputHasAlpha ? 4 : 3;
+    outPackingSize = outputHasAlpha ? 4 : 3;
+
+    validate();
+    for (int y = rect.y1; y < rect.y2; ++y) {
+        int srcY = y;
+        if (invertY) {
+            srcY = srcBounds.y2 - y - 1;
+        }
+
+        const unsigned short *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
+        float *dst_pixels = to + (y * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
+        for (int x = rect.x1; x < rect.x2; ++x) {
+            int inCol = x * inPackingSize;
+            int outCol = x * outPackingSize;
+            if (inputHasAlpha && premult) {
+                float rf = 0., gf = 0., bf = 0.;
+                float a = Color::intToFloat<65536>(src_pixels[inCol + inAOffset]);
+                if (a > 0) {
+                    rf = Color::intToFloat<65536>(src_pixels[inCol + inROffset]) / a;
+                    gf = Color::intToFloat<65536>(src_pixels[inCol + inGOffset]) / a;
+                    bf = Color::intToFloat<65536>(src_pixels[inCol + inBOffset]) / a;
+                }
+                dst_pixels[outCol + outROffset] = fromColorSpaceUint16ToLinearFloatFast( Color::floatToInt<65536>(rf) ) * a;
+                dst_pixels[outCol + outGOffset] = fromColorSpaceUint16ToLinearFloatFast( Color::floatToInt<65536>(gf) ) * a;
+                dst_pixels[outCol + outBOffset] = fromColorSpaceUint16ToLinearFloatFast( Color::floatToInt<65536>(bf) ) * a;
+                if (outputHasAlpha) {
+                    // alpha is linear
+                    dst_pixels[outCol + outAOffset] = a;
+                }
+            } else {
+                dst_pixels[outCol + outROffset] = fromColorSpaceUint16ToLinearFloatFast(src_pixels[inCol + inROffset]);
+                dst_pixels[outCol + outGOffset] = fromColorSpaceUint16ToLinearFloatFast(src_pixels[inCol + inGOffset]);
+                dst_pixels[outCol + outBOffset] = fromColorSpaceUint16ToLinearFloatFast(src_pixels[inCol + inBOffset]);
+                if (outputHasAlpha) {
+                    // alpha is linear
+                    dst_pixels[outCol + outAOffset] = Color::intToFloat<65536>(src_pixels[inCol + inAOffset]);
+                }
+            }
+        }
+    }
+} // from_short_packed
 
 void
 Lut::from_float_packed(float* to,
@@ -0,0 +1,168 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_MPSCQueue_h
+#define Engine_MPSCQueue_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef> // std::size_t
+#include <utility> // std::swap
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/atomic.hpp>
+#endif
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A lock-free multiple producers, single consumer FIFO queue (D. Vyukov's intrusive MPSC node-based queue).
+ * push() is wait-free and may be called by any thread, pop() must always be called by the same thread.
+ * pop() may fail while a push() is in progress on another thread even though the queue is not empty: use size()
+ * to know whether there is something to pop.
+ **/
+template <typename T>
+class MPSCQueue
+{
+    struct Node
+    {
+        boost::atomic<Node*> next;
+        T value;
+
+        Node()
+            : next(0)
+            , value()
+        {
+        }
+    };
+
+    // The last pushed node, producers swap it
+    boost::atomic<Node*> _head;
+
+    // The next node to pop, only accessed by the consumer
+    Node* _tail;
+    Node _stub;
+    boost::atomic<std::size_t> _size;
+
+public:
+
+    MPSCQueue()
+        : _head(&_stub)
+        , _tail(&_stub)
+        , _stub()
+        , _size(0)
+    {
+    }
+
+    ~MPSCQueue()
+    {
+        T value;
+
+        while ( pop(&value) ) {
+        }
+    }
+
+    /**
+     * @brief Pushes value. The value is swapped with a default-constructed T so that large containers are
+     * handed over without copy.
+     **/
+    void push(T& value)
+    {
+        Node* n = new Node();
+
+        std::swap(n->value, value);
+        _size.fetch_add(1, boost::memory_order_relaxed);
+        pushNode(n);
+    }
+
+    /**
+     * @brief Pops the oldest value into value. Returns false if the queue is empty or if the oldest push
+     * is not finished yet.
+     **/
+    bool pop(T* value)
+    {
+        Node* tail = _tail;
+        Node* next = tail->next.load(boost::memory_order_acquire);
+
+        if (tail == &_stub) {
+            if (!next) {
+                return false;
+            }
+            _tail = next;
+            tail = next;
+            next = next->next.load(boost::memory_order_acquire);
+        }
+        if (next) {
+            _tail = next;
+
+            return takeNode(tail, value);
+        }
+        if ( tail != _head.load(boost::memory_order_acquire) ) {
+            // A producer swapped the head but did not link it yet
+            return false;
+        }
+        // tail is the last node: put the stub back behind it so that it can be popped
+        pushNode(&_stub);
+        next = tail->next.load(boost::memory_order_acquire);
+        if (next) {
+            _tail = next;
+
+            return takeNode(tail, value);
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Returns the number of values pushed that were not popped yet
+     **/
+    std::size_t size() const
+    {
+        return _size.load(boost::memory_order_acquire);
+    }
+
+private:
+
+    void pushNode(Node* n)
+    {
+        n->next.store(0, boost::memory_order_relaxed);
+        Node* prev = _head.exchange(n, boost::memory_order_acq_rel);
+        prev->next.store(n, boost::memory_order_release);
+    }
+
+    bool takeNode(Node* n,
+                  T* value)
+    {
+        std::swap(*value, n->value);
+        delete n;
+        _size.fetch_sub(1, boost::memory_order_release);
+
+        return true;
+    }
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_MPSCQueue_h
@@ -330,6 +330,59 @@ MemoryFile::resize(size_t new_size)
     _imp->size = new_size;
 }
 
+bool
+MemoryFile::allocateDiskSpace()
+{
+    if (!_imp->data || !_imp->size) {
+        return false;
+    }
+#if defined(__NATRON_LINUX__)
+    // Unlike posix_fallocate(), this fails instead of writing zeroes if the file system cannot reserve blocks
+    return ::fallocate(_imp->file_handle, 0, 0, _imp->size) == 0;
+#else
+    return false;
+#endif
+}
+
+bool
+MemoryFile::discard(void* data,
+                    std::size_t size)
+{
+    if (!_imp->data || !data || !size) {
+        return false;
+    }
+    assert( (char*)data >= _imp->data && (char*)data + size <= _imp->data + _imp->size );
+#if defined(__NATRON_LINUX__) && defined(FALLOC_FL_PUNCH_HOLE)
+    off_t offset = (off_t)( (char*)data - _imp->data );
+    if (::fallocate(_imp->file_handle, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, size) == 0) {
+        return true;
+    }
+#endif
+#if defined(__NATRON_UNIX__) && defined(MADV_REMOVE)
+    return ::madvise(data, size, MADV_REMOVE) == 0;
+#else
+    return false;
+#endif
+}
+
+void
+MemoryFile::prefetch()
+{
+    if (!_imp->data || !_imp->size) {
+        return;
+    }
+#if defined(__NATRON_UNIX__)
+#ifdef POSIX_MADV_WILLNEED
+    int rc = ::posix_madvise(_imp->data, _imp->size, POSIX_MADV_SEQUENTIAL);
+    rc = ::posix_madvise(_imp->data, _imp->size, POSIX_MADV_WILLNEED);
+#else
+    int rc = ::madvise(_imp->data, _imp->size, MADV_SEQUENTIAL);
+    rc = ::madvise(_imp->data, _imp->size, MADV_WILLNEED);
+#endif
+    Q_UNUSED(rc);
+#endif
+}
+
 void
 MemoryFilePrivate::closeMapping(bool drop_pages)
 {
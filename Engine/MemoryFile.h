@@ -146,6 +146,26 @@ public:
      **/
     bool flush(FlushTypeEnum type, void* data, std::size_t size);
 
+    /**
+     * @brief Reserves the disk blocks for the whole file, so that writing to the mapping later on does not have to
+     * allocate them. Returns false if the system or the file system does not support it, in which case the blocks
+     * are allocated when pages are first written, as before.
+     **/
+    bool allocateDiskSpace();
+
+    /**
+     * @brief Releases the disk blocks and the pages backing the portion starting at data and spanning size bytes.
+     * The portion then reads as zeroes and the file keeps its size. data and size should be multiples of the page size.
+     * Returns false if the system does not support it.
+     **/
+    bool discard(void* data, std::size_t size);
+
+    /**
+     * @brief Hints the system that the whole mapping is about to be read sequentially, so that it is read ahead
+     * in large chunks rather than faulted in page by page. This is only a hint and has no effect on failure.
+     **/
+    void prefetch();
+
     /**
      * @brief Returns the filepath of the backing file.
      **/
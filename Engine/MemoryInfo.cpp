@@ -37,6 +37,7 @@
 #include <algorithm> // min, max
 #include <stdexcept>
 #include <sstream> // stringstream
+#include <cstring> // strcmp
 
 #if defined(_WIN32)
 #  include <windows.h>
@@ -79,6 +80,61 @@
 
 NATRON_NAMESPACE_ENTER
 
+#if defined(__linux__) || defined(__linux) || defined(linux) || defined(__gnu_linux__)
+// Returns the value in bytes of the given field (e.g: "MemAvailable:") of /proc/meminfo, or -1 if it is not available
+static long long
+readProcMemInfoField(const char* field)
+{
+    FILE* f = fopen("/proc/meminfo", "r");
+
+    if (!f) {
+        return -1;
+    }
+    long long ret = -1;
+    char name[64];
+    long long valueKB;
+    while (fscanf(f, "%63s %lld kB\n", name, &valueKB) == 2) {
+        if (strcmp(name, field) == 0) {
+            ret = valueKB * 1024;
+            break;
+        }
+    }
+    fclose(f);
+
+    return ret;
+}
+
+// Returns the value in bytes stored in a cgroup memory file, trying the cgroup v2 file first, or -1 if there is no limit
+static long long
+readCGroupMemoryValue(const char* v2File,
+                      const char* v1File)
+{
+    const char* files[2] = { v2File, v1File };
+
+    for (int i = 0; i < 2; ++i) {
+        FILE* f = fopen(files[i], "r");
+        if (!f) {
+            continue;
+        }
+        long long value;
+        // cgroup v2 writes "max" when there is no limit
+        bool ok = fscanf(f, "%lld", &value) == 1;
+        fclose(f);
+
+        return ok ? value : -1;
+    }
+
+    return -1;
+}
+
+// The memory limit of the cgroup of the process (e.g: in a container), or -1
+static long long
+getCGroupMemoryLimit()
+{
+    return readCGroupMemoryValue("/sys/fs/cgroup/memory.max", "/sys/fs/cgroup/memory/memory.limit_in_bytes");
+}
+#endif
+
 U64
 getSystemTotalRAM()
 {
@@ -145,8 +201,15 @@ getSystemTotalRAM()
 
     long pages = sysconf(_SC_PHYS_PAGES);
     long page_size = sysconf(_SC_PAGE_SIZE);
+    U64 total = (U64)pages * page_size;
 
-    return pages * page_size;
+    // Inside a container the process cannot use more than the limit of its cgroup
+    long long cgroupLimit = getCGroupMemoryLimit();
+    if ( (cgroupLimit > 0) && ( (U64)cgroupLimit < total ) ) {
+        total = cgroupLimit;
+    }
+
+    return total;
 
 #endif
 }
@@ -313,10 +376,23 @@ getAmountFreePhysicalRAM()
 
     return statex.ullAvailPhys;
 #elif defined(__linux__) || defined(__linux) || defined(linux) || defined(__gnu_linux__)
-    struct sysinfo memInfo;
-    sysinfo (&memInfo);
-    long long totalAvailableRAM = memInfo.freeram;
-    totalAvailableRAM *= memInfo.mem_unit;
+    // MemAvailable accounts for the page cache that the kernel can reclaim, whereas freeram does not
+    long long totalAvailableRAM = readProcMemInfoField("MemAvailable:");
+    if (totalAvailableRAM < 0) {
+        struct sysinfo memInfo;
+        sysinfo (&memInfo);
+        totalAvailableRAM = memInfo.freeram;
+        totalAvailableRAM *= memInfo.mem_unit;
+    }
+
+    // Inside a container, what is left to the cgroup may be lower
+    long long cgroupLimit = getCGroupMemoryLimit();
+    if (cgroupLimit > 0) {
+        long long cgroupUsage = readCGroupMemoryValue("/sys/fs/cgroup/memory.current", "/sys/fs/cgroup/memory/memory.usage_in_bytes");
+        if ( (cgroupUsage >= 0) && (cgroupLimit - cgroupUsage < totalAvailableRAM) ) {
+            totalAvailableRAM = std::max(0LL, cgroupLimit - cgroupUsage);
+        }
+    }
 
     return totalAvailableRAM;
 #elif defined(__FreeBSD__) || defined(__FreeBSD_kernel__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__) || defined(__APPLE__)
@@ -421,4 +497,27 @@ getAmountFreePhysicalRAM()
 #endif
 }
 
+double
+getSystemMemoryPressure()
+{
+#if defined(__linux__) || defined(__linux) || defined(linux) || defined(__gnu_linux__)
+    // Pressure stall information (Linux >= 4.20): share of the last 10 seconds during which
+    // at least one task was stalled waiting for memory
+    FILE* f = fopen("/proc/pressure/memory", "r");
+    if (!f) {
+        return 0.;
+    }
+    double avg10 = 0.;
+    if (fscanf(f, "some avg10=%lf", &avg10) != 1) {
+        avg10 = 0.;
+    }
+    fclose(f);
+
+    return avg10 / 100.;
+#else
+
+    return 0.;
+#endif
+}
+
 NATRON_NAMESPACE_EXIT
@@ -67,6 +67,9 @@ std::size_t getCurrentRSS( );
 
 std::size_t getAmountFreePhysicalRAM();
 
+// Returns in [0,1] how much the system is currently stalled waiting for memory, 0 when this is not known
+double getSystemMemoryPressure();
+
 NATRON_NAMESPACE_EXIT
 
 #endif // ifndef Engine_MemoryInfo_h
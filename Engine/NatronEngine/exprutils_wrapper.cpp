@@ -961,6 +961,109 @@ static PyObject* Sbk_ExprUtilsFunc_fbm4(PyObject* self, PyObject* args, PyObject
         return 0;
 }
 
+static PyObject* Sbk_ExprUtilsFunc_fbmArray(PyObject* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* pyResult = 0;
+    int overloadId = -1;
+    PythonToCppFunc pythonToCpp[] = { 0, 0, 0, 0 };
+    SBK_UNUSED(pythonToCpp)
+    int numNamedArgs = (kwds ? PyDict_Size(kwds) : 0);
+    int numArgs = PyTuple_GET_SIZE(args);
+    PyObject* pyArgs[] = {0, 0, 0, 0};
+
+    // invalid argument lengths
+    if (numArgs + numNamedArgs > 4) {
+        PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.fbmArray(): too many arguments");
+        return 0;
+    } else if (numArgs < 1) {
+        PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.fbmArray(): not enough arguments");
+        return 0;
+    }
+
+    if (!PyArg_ParseTuple(args, "|OOOO:fbmArray", &(pyArgs[0]), &(pyArgs[1]), &(pyArgs[2]), &(pyArgs[3])))
+        return 0;
+
+
+    // Overloaded function decisor
+    // 0: fbmArray(std::vector<double>,int,double,double)
+    if ((pythonToCpp[0] = Shiboken::Conversions::isPythonToCppConvertible(SbkNatronEngineTypeConverters[SBK_NATRONENGINE_STD_VECTOR_DOUBLE_IDX], (pyArgs[0])))) {
+        if (numArgs == 1) {
+            overloadId = 0; // fbmArray(std::vector<double>,int,double,double)
+        } else if ((pythonToCpp[1] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<int>(), (pyArgs[1])))) {
+            if (numArgs == 2) {
+                overloadId = 0; // fbmArray(std::vector<double>,int,double,double)
+            } else if ((pythonToCpp[2] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[2])))) {
+                if (numArgs == 3) {
+                    overloadId = 0; // fbmArray(std::vector<double>,int,double,double)
+                } else if ((pythonToCpp[3] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[3])))) {
+                    overloadId = 0; // fbmArray(std::vector<double>,int,double,double)
+                }
+            }
+        }
+    }
+
+    // Function signature not found.
+    if (overloadId == -1) goto Sbk_ExprUtilsFunc_fbmArray_TypeError;
+
+    // Call function/method
+    {
+        if (kwds) {
+            PyObject* value = PyDict_GetItemString(kwds, "octaves");
+            if (value && pyArgs[1]) {
+                PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.fbmArray(): got multiple values for keyword argument 'octaves'.");
+                return 0;
+            } else if (value) {
+                pyArgs[1] = value;
+                if (!(pythonToCpp[1] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<int>(), (pyArgs[1]))))
+                    goto Sbk_ExprUtilsFunc_fbmArray_TypeError;
+            }
+            value = PyDict_GetItemString(kwds, "lacunarity");
+            if (value && pyArgs[2]) {
+                PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.fbmArray(): got multiple values for keyword argument 'lacunarity'.");
+                return 0;
+            } else if (value) {
+                pyArgs[2] = value;
+                if (!(pythonToCpp[2] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[2]))))
+                    goto Sbk_ExprUtilsFunc_fbmArray_TypeError;
+            }
+            value = PyDict_GetItemString(kwds, "gain");
+            if (value && pyArgs[3]) {
+                PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.fbmArray(): got multiple values for keyword argument 'gain'.");
+                return 0;
+            } else if (value) {
+                pyArgs[3] = value;
+                if (!(pythonToCpp[3] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[3]))))
+                    goto Sbk_ExprUtilsFunc_fbmArray_TypeError;
+            }
+        }
+        ::std::vector<double > cppArg0;
+        pythonToCpp[0](pyArgs[0], &cppArg0);
+        int cppArg1 = 6;
+        if (pythonToCpp[1]) pythonToCpp[1](pyArgs[1], &cppArg1);
+        double cppArg2 = 2.;
+        if (pythonToCpp[2]) pythonToCpp[2](pyArgs[2], &cppArg2);
+        double cppArg3 = 0.5;
+        if (pythonToCpp[3]) pythonToCpp[3](pyArgs[3], &cppArg3);
+
+        if (!PyErr_Occurred()) {
+            // fbmArray(std::vector<double>,int,double,double)
+            std::vector<double > cppResult = ::ExprUtils::fbmArray(cppArg0, cppArg1, cppArg2, cppArg3);
+            pyResult = Shiboken::Conversions::copyToPython(SbkNatronEngineTypeConverters[SBK_NATRONENGINE_STD_VECTOR_DOUBLE_IDX], &cppResult);
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+
+    Sbk_ExprUtilsFunc_fbmArray_TypeError:
+        const char* overloads[] = {"list, int = 6, float = 2., float = 0.5", 0};
+        Shiboken::setErrorAboutWrongArguments(args, "NatronEngine.ExprUtils.fbmArray", overloads);
+        return 0;
+}
+
 static PyObject* Sbk_ExprUtilsFunc_gaussstep(PyObject* self, PyObject* args)
 {
     PyObject* pyResult = 0;
@@ -1264,6 +1367,46 @@ static PyObject* Sbk_ExprUtilsFunc_noise(PyObject* self, PyObject* pyArg)
         return 0;
 }
 
+static PyObject* Sbk_ExprUtilsFunc_noiseArray(PyObject* self, PyObject* pyArg)
+{
+    PyObject* pyResult = 0;
+    int overloadId = -1;
+    PythonToCppFunc pythonToCpp;
+    SBK_UNUSED(pythonToCpp)
+
+    // Overloaded function decisor
+    // 0: noiseArray(std::vector<double>)
+    if ((pythonToCpp = Shiboken::Conversions::isPythonToCppConvertible(SbkNatronEngineTypeConverters[SBK_NATRONENGINE_STD_VECTOR_DOUBLE_IDX], (pyArg)))) {
+        overloadId = 0; // noiseArray(std::vector<double>)
+    }
+
+    // Function signature not found.
+    if (overloadId == -1) goto Sbk_ExprUtilsFunc_noiseArray_TypeError;
+
+    // Call function/method
+    {
+        ::std::vector<double > cppArg0;
+        pythonToCpp(pyArg, &cppArg0);
+
+        if (!PyErr_Occurred()) {
+            // noiseArray(std::vector<double>)
+            std::vector<double > cppResult = ::ExprUtils::noiseArray(cppArg0);
+            pyResult = Shiboken::Conversions::copyToPython(SbkNatronEngineTypeConverters[SBK_NATRONENGINE_STD_VECTOR_DOUBLE_IDX], &cppResult);
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+
+    Sbk_ExprUtilsFunc_noiseArray_TypeError:
+        const char* overloads[] = {"list", 0};
+        Shiboken::setErrorAboutWrongArguments(pyArg, "NatronEngine.ExprUtils.noiseArray", overloads);
+        return 0;
+}
+
 static PyObject* Sbk_ExprUtilsFunc_pnoise(PyObject* self, PyObject* args)
 {
     PyObject* pyResult = 0;
@@ -1701,6 +1844,109 @@ static PyObject* Sbk_ExprUtilsFunc_turbulence(PyObject* self, PyObject* args, Py
         return 0;
 }
 
+static PyObject* Sbk_ExprUtilsFunc_turbulenceArray(PyObject* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* pyResult = 0;
+    int overloadId = -1;
+    PythonToCppFunc pythonToCpp[] = { 0, 0, 0, 0 };
+    SBK_UNUSED(pythonToCpp)
+    int numNamedArgs = (kwds ? PyDict_Size(kwds) : 0);
+    int numArgs = PyTuple_GET_SIZE(args);
+    PyObject* pyArgs[] = {0, 0, 0, 0};
+
+    // invalid argument lengths
+    if (numArgs + numNamedArgs > 4) {
+        PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.turbulenceArray(): too many arguments");
+        return 0;
+    } else if (numArgs < 1) {
+        PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.turbulenceArray(): not enough arguments");
+        return 0;
+    }
+
+    if (!PyArg_ParseTuple(args, "|OOOO:turbulenceArray", &(pyArgs[0]), &(pyArgs[1]), &(pyArgs[2]), &(pyArgs[3])))
+        return 0;
+
+
+    // Overloaded function decisor
+    // 0: turbulenceArray(std::vector<double>,int,double,double)
+    if ((pythonToCpp[0] = Shiboken::Conversions::isPythonToCppConvertible(SbkNatronEngineTypeConverters[SBK_NATRONENGINE_STD_VECTOR_DOUBLE_IDX], (pyArgs[0])))) {
+        if (numArgs == 1) {
+            overloadId = 0; // turbulenceArray(std::vector<double>,int,double,double)
+        } else if ((pythonToCpp[1] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<int>(), (pyArgs[1])))) {
+            if (numArgs == 2) {
+                overloadId = 0; // turbulenceArray(std::vector<double>,int,double,double)
+            } else if ((pythonToCpp[2] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[2])))) {
+                if (numArgs == 3) {
+                    overloadId = 0; // turbulenceArray(std::vector<double>,int,double,double)
+                } else if ((pythonToCpp[3] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[3])))) {
+                    overloadId = 0; // turbulenceArray(std::vector<double>,int,double,double)
+                }
+            }
+        }
+    }
+
+    // Function signature not found.
+    if (overloadId == -1) goto Sbk_ExprUtilsFunc_turbulenceArray_TypeError;
+
+    // Call function/method
+    {
+        if (kwds) {
+            PyObject* value = PyDict_GetItemString(kwds, "octaves");
+            if (value && pyArgs[1]) {
+                PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.turbulenceArray(): got multiple values for keyword argument 'octaves'.");
+                return 0;
+            } else if (value) {
+                pyArgs[1] = value;
+                if (!(pythonToCpp[1] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<int>(), (pyArgs[1]))))
+                    goto Sbk_ExprUtilsFunc_turbulenceArray_TypeError;
+            }
+            value = PyDict_GetItemString(kwds, "lacunarity");
+            if (value && pyArgs[2]) {
+                PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.turbulenceArray(): got multiple values for keyword argument 'lacunarity'.");
+                return 0;
+            } else if (value) {
+                pyArgs[2] = value;
+                if (!(pythonToCpp[2] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[2]))))
+                    goto Sbk_ExprUtilsFunc_turbulenceArray_TypeError;
+            }
+            value = PyDict_GetItemString(kwds, "gain");
+            if (value && pyArgs[3]) {
+                PyErr_SetString(PyExc_TypeError, "NatronEngine.ExprUtils.turbulenceArray(): got multiple values for keyword argument 'gain'.");
+                return 0;
+            } else if (value) {
+                pyArgs[3] = value;
+                if (!(pythonToCpp[3] = Shiboken::Conversions::isPythonToCppConvertible(Shiboken::Conversions::PrimitiveTypeConverter<double>(), (pyArgs[3]))))
+                    goto Sbk_ExprUtilsFunc_turbulenceArray_TypeError;
+            }
+        }
+        ::std::vector<double > cppArg0;
+        pythonToCpp[0](pyArgs[0], &cppArg0);
+        int cppArg1 = 6;
+        if (pythonToCpp[1]) pythonToCpp[1](pyArgs[1], &cppArg1);
+        double cppArg2 = 2.;
+        if (pythonToCpp[2]) pythonToCpp[2](pyArgs[2], &cppArg2);
+        double cppArg3 = 0.5;
+        if (pythonToCpp[3]) pythonToCpp[3](pyArgs[3], &cppArg3);
+
+        if (!PyErr_Occurred()) {
+            // turbulenceArray(std::vector<double>,int,double,double)
+            std::vector<double > cppResult = ::ExprUtils::turbulenceArray(cppArg0, cppArg1, cppArg2, cppArg3);
+            pyResult = Shiboken::Conversions::copyToPython(SbkNatronEngineTypeConverters[SBK_NATRONENGINE_STD_VECTOR_DOUBLE_IDX], &cppResult);
+        }
+    }
+
+    if (PyErr_Occurred() || !pyResult) {
+        Py_XDECREF(pyResult);
+        return 0;
+    }
+    return pyResult;
+
+    Sbk_ExprUtilsFunc_turbulenceArray_TypeError:
+        const char* overloads[] = {"list, int = 6, float = 2., float = 0.5", 0};
+        Shiboken::setErrorAboutWrongArguments(args, "NatronEngine.ExprUtils.turbulenceArray", overloads);
+        return 0;
+}
+
 static PyObject* Sbk_ExprUtilsFunc_vfbm(PyObject* self, PyObject* args, PyObject* kwds)
 {
     PyObject* pyResult = 0;
@@ -2205,17 +2451,20 @@ static PyMethodDef Sbk_ExprUtils_methods[] = {
     {"cturbulence", (PyCFunction)Sbk_ExprUtilsFunc_cturbulence, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"fbm", (PyCFunction)Sbk_ExprUtilsFunc_fbm, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"fbm4", (PyCFunction)Sbk_ExprUtilsFunc_fbm4, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
+    {"fbmArray", (PyCFunction)Sbk_ExprUtilsFunc_fbmArray, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"gaussstep", (PyCFunction)Sbk_ExprUtilsFunc_gaussstep, METH_VARARGS|METH_STATIC},
     {"hash", (PyCFunction)Sbk_ExprUtilsFunc_hash, METH_O|METH_STATIC},
     {"linearstep", (PyCFunction)Sbk_ExprUtilsFunc_linearstep, METH_VARARGS|METH_STATIC},
     {"mix", (PyCFunction)Sbk_ExprUtilsFunc_mix, METH_VARARGS|METH_STATIC},
     {"noise", (PyCFunction)Sbk_ExprUtilsFunc_noise, METH_O|METH_STATIC},
+    {"noiseArray", (PyCFunction)Sbk_ExprUtilsFunc_noiseArray, METH_O|METH_STATIC},
     {"pnoise", (PyCFunction)Sbk_ExprUtilsFunc_pnoise, METH_VARARGS|METH_STATIC},
     {"remap", (PyCFunction)Sbk_ExprUtilsFunc_remap, METH_VARARGS|METH_STATIC},
     {"smoothstep", (PyCFunction)Sbk_ExprUtilsFunc_smoothstep, METH_VARARGS|METH_STATIC},
     {"snoise", (PyCFunction)Sbk_ExprUtilsFunc_snoise, METH_O},
     {"snoise4", (PyCFunction)Sbk_ExprUtilsFunc_snoise4, METH_O|METH_STATIC},
     {"turbulence", (PyCFunction)Sbk_ExprUtilsFunc_turbulence, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
+    {"turbulenceArray", (PyCFunction)Sbk_ExprUtilsFunc_turbulenceArray, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"vfbm", (PyCFunction)Sbk_ExprUtilsFunc_vfbm, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"vfbm4", (PyCFunction)Sbk_ExprUtilsFunc_vfbm4, METH_VARARGS|METH_KEYWORDS|METH_STATIC},
     {"vnoise", (PyCFunction)Sbk_ExprUtilsFunc_vnoise, METH_O|METH_STATIC},
@@ -30,6 +30,7 @@
 #include <algorithm> // min, max
 #include <bitset>
 #include <cassert>
+#include <set>
 #include <stdexcept>
 #include <sstream> // stringstream
 
@@ -60,6 +61,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/AppManager.h"
 #include "Engine/Backdrop.h"
 #include "Engine/CreateNodeArgs.h"
+#include "Engine/Curve.h"
 #include "Engine/DiskCacheNode.h"
 #include "Engine/Dot.h"
 #include "Engine/EffectInstance.h"
@@ -114,6 +116,14 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 ///at most every...
 #define NATRON_RENDER_GRAPHS_HINTS_REFRESH_RATE_SECONDS 1
 
+///Below that render time per byte of output, a node is considered cheaper to render again than to
+///keep in the cache (e.g: Dot, Shuffle). Beyond the other one, its output is always worth caching.
+#define NATRON_CHEAP_RENDER_TIME_PER_BYTE 2e-9
+#define NATRON_COSTLY_RENDER_TIME_PER_BYTE 5e-8
+
+///Weight of the last sample in the running average of the render time per byte
+#define NATRON_RENDER_COST_AVERAGE_WEIGHT 0.25
+
 NATRON_NAMESPACE_ENTER
 
 using std::make_pair;
@@ -185,6 +195,30 @@ Node::isGLFinishRequiredBeforeRender() const
     return _imp->requiresGLFinishBeforeRender;
 }
 
+void
+Node::addRenderCostSample(double timeSpent,
+                          std::size_t bytesRendered)
+{
+    if (bytesRendered == 0) {
+        return;
+    }
+    double sample = timeSpent / bytesRendered;
+    QMutexLocker k(&_imp->renderCostMutex);
+    if (_imp->renderTimePerByte < 0) {
+        _imp->renderTimePerByte = sample;
+    } else {
+        _imp->renderTimePerByte += (sample - _imp->renderTimePerByte) * NATRON_RENDER_COST_AVERAGE_WEIGHT;
+    }
+}
+
+double
+Node::getRenderTimePerByte() const
+{
+    QMutexLocker k(&_imp->renderCostMutex);
+
+    return _imp->renderTimePerByte;
+}
+
 bool
 Node::isPartOfProject() const
 {
@@ -784,6 +818,96 @@ Node::getCacheID() const
     return _imp->cacheID;
 }
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+void
+appendCurveToHash(const CurvePtr& curve,
+                  Hash64* hash)
+{
+    if (!curve) {
+        return;
+    }
+    KeyFrameSet keys = curve->getKeyFrames_mt_safe();
+    hash->append( (U64)keys.size() );
+    for (KeyFrameSet::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        hash->append( it->getTime() );
+        hash->append( it->getValue() );
+        hash->append( it->getLeftDerivative() );
+        hash->append( it->getRightDerivative() );
+        hash->append( (int)it->getInterpolation() );
+    }
+}
+
+/**
+ * @brief Appends to the hash the values, animation curves and expressions of the knobs that have an effect on the render.
+ * @returns True if some of that state could not be hashed: the result of expressions and the strings of animated string knobs.
+ **/
+bool
+appendKnobValuesToHash(const KnobsVec& knobs,
+                       Hash64* hash)
+{
+    bool hasUnhashedState = false;
+
+    for (KnobsVec::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+        const KnobIPtr& knob = *it;
+        if ( !knob->getEvaluateOnChange() || !knob->getIsPersistent() ) {
+            continue;
+        }
+        KnobIntBase* isInt = dynamic_cast<KnobIntBase*>( knob.get() );
+        KnobBoolBase* isBool = dynamic_cast<KnobBoolBase*>( knob.get() );
+        KnobDoubleBase* isDouble = dynamic_cast<KnobDoubleBase*>( knob.get() );
+        KnobStringBase* isString = dynamic_cast<KnobStringBase*>( knob.get() );
+        int nDims = knob->getDimension();
+        for (int i = 0; i < nDims; ++i) {
+            std::string expr = knob->getExpression(i);
+            if ( !expr.empty() ) {
+                Hash64_appendQString( hash, QString::fromUtf8( expr.c_str() ) );
+                hasUnhashedState = true;
+                continue;
+            }
+            if ( knob->isAnimated( i, ViewIdx(0) ) ) {
+                if (isString) {
+                    ///The keyframes of animated strings only hold indexes of the strings
+                    hasUnhashedState = true;
+                } else {
+                    appendCurveToHash(knob->getCurve(ViewIdx(0), i), hash);
+                }
+                continue;
+            }
+            if (isInt) {
+                hash->append( isInt->getValue( i, ViewIdx(0) ) );
+            } else if (isBool) {
+                hash->append( isBool->getValue( i, ViewIdx(0) ) );
+            } else if (isDouble) {
+                hash->append( isDouble->getValue( i, ViewIdx(0) ) );
+            } else if (isString) {
+                Hash64_appendQString( hash, QString::fromUtf8( isString->getValue( i, ViewIdx(0) ).c_str() ) );
+            }
+        }
+        KnobParametric* isParametric = dynamic_cast<KnobParametric*>( knob.get() );
+        if (isParametric) {
+            for (int i = 0; i < nDims; ++i) {
+                appendCurveToHash(isParametric->getParametricCurve(i), hash);
+            }
+        }
+    }
+
+    return hasUnhashedState;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+U64
+Node::computeKnobValuesHash(bool* hasUnhashedState) const
+{
+    Hash64 knobValues;
+
+    *hasUnhashedState = _imp->effect ? appendKnobValuesToHash(_imp->effect->getKnobs(), &knobValues) : false;
+    knobValues.computeHash();
+
+    return knobValues.value();
+}
+
 bool
 Node::computeHashInternal()
 {
@@ -796,17 +920,45 @@ Node::computeHashInternal()
         qDebug() << "Node::computeHash(): inputs not initialized";
     }
 
+    ///Hash what the render depends on rather than the number of changes, so that going back to a previous state
+    ///(undo, or the project opened again) produces the same hash and finds the images in the cache
+    const bool contentBasedHash = appPTR->getCurrentSettings()->isContentBasedNodeHashEnabled();
+    U64 knobValuesHash = 0;
+    bool hasUnhashedState = false;
+    if (contentBasedHash) {
+        knobValuesHash = computeKnobValuesHash(&hasUnhashedState);
+    }
+
+    ViewerInstance* isViewer = dynamic_cast<ViewerInstance*>( _imp->effect.get() );
     U64 oldHash, newHash;
+    bool knobsAgeChanged;
+    bool hasPendingDirtyRegion;
+    NodeDirtyRegion dirtyRegion;
+    std::vector<U64> oldInputHashes, newInputHashes;
     {
         QWriteLocker l(&_imp->knobsAgeMutex);
 
         oldHash = _imp->hash.value();
+        knobsAgeChanged = _imp->knobsAge != _imp->hashedKnobsAge;
+        _imp->hashedKnobsAge = _imp->knobsAge;
+        hasPendingDirtyRegion = _imp->hasPendingDirtyRegion;
+        dirtyRegion = _imp->pendingDirtyRegion;
+        _imp->hasPendingDirtyRegion = false;
 
         ///reset the hash value
         _imp->hash.reset();
 
-        ///append the effect's own age
-        _imp->hash.append(_imp->knobsAge);
+        if (contentBasedHash) {
+            _imp->hash.append(knobValuesHash);
+            _imp->hash.append(_imp->hashInvalidationAge);
+            if (hasUnhashedState) {
+                ///e.g: expressions may depend on anything, only the age tells when their result changed
+                _imp->hash.append(_imp->knobsAge);
+            }
+        } else {
+            ///append the effect's own age
+            _imp->hash.append(_imp->knobsAge);
+        }
 
         ///append all inputs hash
         RotoDrawableItemPtr attachedStroke = _imp->paintStroke.lock();
@@ -815,8 +967,6 @@ Node::computeHashInternal()
             attachedStrokeContextNode = attachedStroke->getContext()->getNode();
         }
         {
-            ViewerInstance* isViewer = dynamic_cast<ViewerInstance*>( _imp->effect.get() );
-
             if (isViewer) {
                 int activeInput[2];
                 isViewer->getActiveInputs(activeInput[0], activeInput[1]);
@@ -828,6 +978,7 @@ Node::computeHashInternal()
                     }
                 }
             } else {
+                newInputHashes.resize(_imp->inputs.size(), 0);
                 for (U32 i = 0; i < _imp->inputs.size(); ++i) {
                     NodePtr input = getInput(i);
                     if (input) {
@@ -835,14 +986,17 @@ Node::computeHashInternal()
                         if ( attachedStroke && (input == attachedStrokeContextNode) ) {
                             continue;
                         }
+                        newInputHashes[i] = input->getHashValue();
                         ///Add the index of the input to its hash.
                         ///Explanation: if we didn't add this, just switching inputs would produce a similar
                         ///hash.
-                        _imp->hash.append(input->getHashValue() + i);
+                        _imp->hash.append(newInputHashes[i] + i);
                     }
                 }
             }
         }
+        oldInputHashes.swap(_imp->hashedInputs);
+        _imp->hashedInputs = newInputHashes;
 
         // We do not append the roto age any longer since now every tool in the RotoContext is backed-up by nodes which
         // have their own age. Instead each action in the Rotocontext is followed by a incrementNodesAge() call so that each
@@ -868,12 +1022,40 @@ Node::computeHashInternal()
     } // QWriteLocker l(&_imp->knobsAgeMutex);
     bool hashChanged = oldHash != newHash;
 
+    /*
+     * If the change is localized, either because the caller gave its region or because the only inputs that changed
+     * did so in a region, remember it so that the images cached with the previous hash can be reused outside of it.
+     */
+    bool hasDirtyRegion = false;
+    if ( hashChanged && (oldHash != 0) ) {
+        if (hasPendingDirtyRegion) {
+            hasDirtyRegion = true;
+        } else if ( !knobsAgeChanged && !isViewer && !newInputHashes.empty() ) {
+            hasDirtyRegion = getDirtyRegionFromInputs(oldInputHashes, newInputHashes, &dirtyRegion.time, &dirtyRegion.region);
+        }
+    }
+    {
+        QWriteLocker l(&_imp->knobsAgeMutex);
+        if (hasDirtyRegion) {
+            dirtyRegion.previousHash = oldHash;
+            dirtyRegion.hash = newHash;
+            _imp->dirtyRegions.push_front(dirtyRegion);
+            if (_imp->dirtyRegions.size() > NATRON_NODE_MAX_DIRTY_REGIONS) {
+                _imp->dirtyRegions.pop_back();
+            }
+        } else if (hashChanged) {
+            _imp->dirtyRegions.clear();
+        }
+    }
+
     if (hashChanged) {
         _imp->effect->onNodeHashChanged(newHash);
-        if ( _imp->nodeCreated && !getApp()->getProject()->isProjectClosing() ) {
+        ///The images of the previous hash are still needed outside of the dirty region
+        if ( !hasDirtyRegion && _imp->nodeCreated && !contentBasedHash && !getApp()->getProject()->isProjectClosing() ) {
             /*
              * We changed the node hash. That means all cache entries for this node with a different hash
              * are impossible to re-create again. Just discard them all. This is done in a separate thread.
+             * When the hash is computed from the knob values, a previous hash comes back with the previous values: keep them.
              */
             removeAllImagesFromCacheWithMatchingIDAndDifferentKey(newHash);
         }
@@ -882,25 +1064,61 @@ Node::computeHashInternal()
     return hashChanged;
 } // Node::computeHashInternal
 
-void
-Node::computeHashRecursive(std::list<Node*>& marked)
+bool
+Node::getDirtyRegionFromInputs(const std::vector<U64>& oldInputHashes,
+                               const std::vector<U64>& newInputHashes,
+                               double* time,
+                               RectD* region) const
 {
-    if ( std::find(marked.begin(), marked.end(), this) != marked.end() ) {
-        return;
+    if ( oldInputHashes.size() != newInputHashes.size() ) {
+        return false;
     }
-
-    bool hasChanged = computeHashInternal();
-    marked.push_back(this);
-    if (!hasChanged) {
-        //Nothing changed, no need to recurse on outputs
-        return;
+    bool hasRegion = false;
+    for (std::size_t i = 0; i < newInputHashes.size(); ++i) {
+        if (oldInputHashes[i] == newInputHashes[i]) {
+            continue;
+        }
+        ///A connection changed
+        if ( (oldInputHashes[i] == 0) || (newInputHashes[i] == 0) ) {
+            return false;
+        }
+        NodePtr input = getInput(i);
+        if (!input) {
+            return false;
+        }
+        U64 previousHash;
+        double inputTime;
+        RectD inputRegion;
+        if ( !input->getDirtyRegionForHash(newInputHashes[i], &previousHash, &inputTime, &inputRegion) || (previousHash != oldInputHashes[i]) ) {
+            return false;
+        }
+        if ( hasRegion && (inputTime != *time) ) {
+            return false;
+        }
+        RectD outputRegion;
+        if ( !_imp->effect->getOutputDirtyRegion(inputTime, i, inputRegion, &outputRegion) ) {
+            return false;
+        }
+        if (!hasRegion) {
+            *region = outputRegion;
+            *time = inputTime;
+            hasRegion = true;
+        } else if ( region->isNull() ) {
+            *region = outputRegion;
+        } else if ( !outputRegion.isNull() ) {
+            region->merge(outputRegion);
+        }
     }
 
+    return hasRegion;
+}
 
+void
+Node::getHashDependents(std::vector<Node*>* dependents) const
+{
     bool isRotoPaint = _imp->effect->isRotoPaintNode();
-
-    ///call it on all the outputs
     NodesList outputs;
+
     getOutputsWithGroupRedirection(outputs);
     for (NodesList::iterator it = outputs.begin(); it != outputs.end(); ++it) {
         assert(*it);
@@ -910,17 +1128,68 @@ Node::computeHashRecursive(std::list<Node*>& marked)
         if ( isRotoPaint && attachedStroke && (attachedStroke->getContext()->getNode().get() == this) ) {
             continue;
         }
-        (*it)->computeHashRecursive(marked);
+        dependents->push_back( it->get() );
     }
 
-
-    ///If the node has a rotopaint tree, compute the hash of the nodes in the tree
+    ///If the node has a rotopaint tree, the nodes in the tree depend on it too
     if (_imp->rotoContext) {
         NodesList allItems;
         _imp->rotoContext->getRotoPaintTreeNodes(&allItems);
         for (NodesList::iterator it = allItems.begin(); it != allItems.end(); ++it) {
-            (*it)->computeHashRecursive(marked);
+            dependents->push_back( it->get() );
+        }
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+///Post-order depth-first walk: reversing the result gives the dependents in topological order
+void
+sortHashDependents(Node* node,
+                   std::set<Node*>& visited,
+                   std::map<Node*, std::vector<Node*> >& dependents,
+                   std::vector<Node*>* postOrder)
+{
+    if ( !visited.insert(node).second ) {
+        return;
+    }
+    std::vector<Node*>& nodeDependents = dependents[node];
+    node->getHashDependents(&nodeDependents);
+    for (std::vector<Node*>::const_iterator it = nodeDependents.begin(); it != nodeDependents.end(); ++it) {
+        sortHashDependents(*it, visited, dependents, postOrder);
+    }
+    postOrder->push_back(node);
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+Node::computeHashRecursive(const std::list<Node*>& roots)
+{
+    /*
+     * The nodes downstream are visited in topological order so that a node is hashed once, after all of its
+     * inputs: with a depth-first recursion a node reachable through 2 paths would keep the hash computed
+     * before its second input got refreshed.
+     * Only the nodes having an input whose hash changed are recomputed: the others are just skipped.
+     */
+    std::set<Node*> visited;
+    std::map<Node*, std::vector<Node*> > dependents;
+    std::vector<Node*> postOrder;
+    for (std::list<Node*>::const_iterator it = roots.begin(); it != roots.end(); ++it) {
+        sortHashDependents(*it, visited, dependents, &postOrder);
+    }
+
+    std::set<Node*> dirty( roots.begin(), roots.end() );
+    for (std::vector<Node*>::reverse_iterator it = postOrder.rbegin(); it != postOrder.rend(); ++it) {
+        if ( dirty.find(*it) == dirty.end() ) {
+            continue;
+        }
+        if ( !(*it)->computeHashInternal() ) {
+            //Nothing changed, the outputs do not need to be recomputed on our behalf
+            continue;
         }
+        const std::vector<Node*>& nodeDependents = dependents[*it];
+        dirty.insert( nodeDependents.begin(), nodeDependents.end() );
     }
 }
 
@@ -977,8 +1246,9 @@ Node::computeHash()
 
         return;
     }
-    std::list<Node*> marked;
-    computeHashRecursive(marked);
+    std::list<Node*> roots;
+    roots.push_back(this);
+    computeHashRecursive(roots);
 } // computeHash
 
 
@@ -1017,6 +1287,9 @@ Node::loadKnobs(const NodeSerialization & serialization,
 
     setKnobsAge( serialization.getKnobsAge() );
 
+    if ( isForceCachingEnabled() ) {
+        appPTR->setCacheEntriesPinnedForHolder(this, true);
+    }
 
     _imp->effect->onKnobsLoaded();
 }
@@ -1270,6 +1543,7 @@ Node::incrementKnobsAge_internal()
     {
         QWriteLocker l(&_imp->knobsAgeMutex);
         ++_imp->knobsAge;
+        ++_imp->hashInvalidationAge;
 
         ///if the age of an effect somehow reaches the maximum age (will never happen)
         ///handle it by clearing the cache and resetting the age to 0.
@@ -1281,12 +1555,15 @@ Node::incrementKnobsAge_internal()
 }
 
 void
-Node::incrementKnobsAge()
+Node::incrementKnobsAge(bool knobValuesChanged)
 {
     U32 newAge;
     {
         QWriteLocker l(&_imp->knobsAgeMutex);
         ++_imp->knobsAge;
+        if (!knobValuesChanged) {
+            ++_imp->hashInvalidationAge;
+        }
 
         ///if the age of an effect somehow reaches the maximum age (will never happen)
         ///handle it by clearing the cache and resetting the age to 0.
@@ -1301,6 +1578,40 @@ Node::incrementKnobsAge()
     computeHash();
 }
 
+void
+Node::incrementKnobsAgeInRegion(double time,
+                                const RectD& region)
+{
+    {
+        QWriteLocker l(&_imp->knobsAgeMutex);
+        _imp->hasPendingDirtyRegion = true;
+        _imp->pendingDirtyRegion.time = time;
+        _imp->pendingDirtyRegion.region = region;
+    }
+    incrementKnobsAge();
+}
+
+bool
+Node::getDirtyRegionForHash(U64 hash,
+                            U64* previousHash,
+                            double* time,
+                            RectD* region) const
+{
+    QReadLocker l(&_imp->knobsAgeMutex);
+
+    for (std::list<NodeDirtyRegion>::const_iterator it = _imp->dirtyRegions.begin(); it != _imp->dirtyRegions.end(); ++it) {
+        if (it->hash == hash) {
+            *previousHash = it->previousHash;
+            *time = it->time;
+            *region = it->region;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
 U64
 Node::getKnobsAge() const
 {
@@ -1528,12 +1839,25 @@ std::string
 Node::makeCacheInfo() const
 {
     std::size_t ram, disk;
+    ImageBufferPool::Stats poolStats;
 
-    appPTR->getMemoryStatsForCacheEntryHolder(this, &ram, &disk);
+    appPTR->getMemoryStatsForCacheEntryHolder(this, &ram, &disk, &poolStats);
     QString ramSizeStr = printAsRAM( (U64)ram );
     QString diskSizeStr = printAsRAM( (U64)disk );
     std::stringstream ss;
     ss << "<b><font color=\"green\">Cache occupancy:</font></b> RAM: <font color=#c8c8c8>" << ramSizeStr.toStdString() << "</font> / Disk: <font color=#c8c8c8>" << diskSizeStr.toStdString() << "</font>";
+    ss << "<br /><b><font color=\"green\">Image buffers pool (all nodes):</font></b> Used: <font color=#c8c8c8>" << printAsRAM( (U64)poolStats.usedBytes ).toStdString()
+       << "</font> / Free: <font color=#c8c8c8>" << printAsRAM( (U64)poolStats.freeBytes ).toStdString()
+       << "</font> / Reused: <font color=#c8c8c8>" << poolStats.hits << "/" << (poolStats.hits + poolStats.misses) << "</font>";
+
+    std::size_t pluginMemory, pluginMemoryPeak, renderImagesPeak;
+    U64 renderImagesCached, renderImagesTemporary;
+    getMemoryUsage(&pluginMemory, &pluginMemoryPeak, &renderImagesCached, &renderImagesTemporary, &renderImagesPeak);
+    ss << "<br /><b><font color=\"green\">Images allocated by renders:</font></b> Cached: <font color=#c8c8c8>" << printAsRAM(renderImagesCached).toStdString()
+       << "</font> / Temporary: <font color=#c8c8c8>" << printAsRAM(renderImagesTemporary).toStdString()
+       << "</font> / Largest render: <font color=#c8c8c8>" << printAsRAM( (U64)renderImagesPeak ).toStdString() << "</font>";
+    ss << "<br /><b><font color=\"green\">Plug-in memory:</font></b> Used: <font color=#c8c8c8>" << printAsRAM( (U64)pluginMemory ).toStdString()
+       << "</font> / Peak: <font color=#c8c8c8>" << printAsRAM( (U64)pluginMemoryPeak ).toStdString() << "</font>";
 
     return ss.str();
 }
@@ -1752,7 +2076,7 @@ Node::createNodePage(const KnobPagePtr& settingsPage)
     fCaching->setIsPersistent(true);
     fCaching->setEvaluateOnChange(false);
     fCaching->setHintToolTip( tr("When checked, the output of this node will always be kept in the RAM cache for fast access of already computed "
-                                 "images.") );
+                                 "images. These images are not evicted by the images of the other nodes or projects, unless they alone fill the cache.") );
     _imp->forceCaching = fCaching;
     settingsPage->addKnob(fCaching);
 
@@ -4080,6 +4404,7 @@ Node::registerPluginMemory(size_t nBytes)
     {
         QMutexLocker l(&_imp->memoryUsedMutex);
         _imp->pluginInstanceMemoryUsed += nBytes;
+        _imp->pluginInstanceMemoryPeak = std::max(_imp->pluginInstanceMemoryPeak, _imp->pluginInstanceMemoryUsed);
     }
     Q_EMIT pluginMemoryUsageChanged(nBytes);
 }
@@ -4094,6 +4419,41 @@ Node::unregisterPluginMemory(size_t nBytes)
     Q_EMIT pluginMemoryUsageChanged(-nBytes);
 }
 
+void
+Node::addRenderImagesMemory(std::size_t cachedBytes,
+                            std::size_t temporaryBytes)
+{
+    QMutexLocker l(&_imp->memoryUsedMutex);
+
+    _imp->renderImagesCachedBytes += cachedBytes;
+    _imp->renderImagesTemporaryBytes += temporaryBytes;
+    _imp->renderImagesPeak = std::max(_imp->renderImagesPeak, cachedBytes + temporaryBytes);
+}
+
+void
+Node::getMemoryUsage(std::size_t* pluginMemory,
+                     std::size_t* pluginMemoryPeak,
+                     U64* renderImagesCachedBytes,
+                     U64* renderImagesTemporaryBytes,
+                     std::size_t* renderImagesPeak) const
+{
+    QMutexLocker l(&_imp->memoryUsedMutex);
+
+    *pluginMemory = _imp->pluginInstanceMemoryUsed;
+    *pluginMemoryPeak = _imp->pluginInstanceMemoryPeak;
+    *renderImagesCachedBytes = _imp->renderImagesCachedBytes;
+    *renderImagesTemporaryBytes = _imp->renderImagesTemporaryBytes;
+    *renderImagesPeak = _imp->renderImagesPeak;
+}
+
+std::size_t
+Node::getPluginMemoryUsed() const
+{
+    QMutexLocker l(&_imp->memoryUsedMutex);
+
+    return _imp->pluginInstanceMemoryUsed;
+}
+
 QMutex &
 Node::getRenderInstancesSharedMutex()
 {
@@ -4917,12 +5277,13 @@ Node::onEffectKnobValueChanged(KnobI* what,
             ///When a group is disabled we have to force a hash change of all nodes inside otherwise the image will stay cached
 
             NodesList nodes = isGroup->getNodes();
-            std::list<Node*> markedNodes;
+            std::list<Node*> roots;
             for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
                 //This will not trigger a hash recomputation
                 (*it)->incrementKnobsAge_internal();
-                (*it)->computeHashRecursive(markedNodes);
+                roots.push_back( it->get() );
             }
+            computeHashRecursive(roots);
         }
     } else if ( what == _imp->nodeLabelKnob.lock().get() ) {
         Q_EMIT nodeExtraLabelChanged( QString::fromUtf8( _imp->nodeLabelKnob.lock()->getValue().c_str() ) );
@@ -4939,6 +5300,8 @@ Node::onEffectKnobValueChanged(KnobI* what,
         }
     } else if ( what == _imp->hideInputs.lock().get() ) {
         Q_EMIT hideInputsKnobChanged( _imp->hideInputs.lock()->getValue() );
+    } else if ( what == _imp->forceCaching.lock().get() ) {
+        appPTR->setCacheEntriesPinnedForHolder( this, isForceCachingEnabled() );
     } else if ( _imp->effect->isReader() && (what->getName() == kReadOIIOAvailableViewsKnobName) ) {
         refreshCreatedViews(what, false /*silent*/);
     } else if ( what == _imp->refreshInfoButton.lock().get() ||
@@ -5934,8 +6297,17 @@ Node::shouldCacheOutput(bool isFrameVaryingOrAnimated,
     }
     std::size_t sz = outputs.size();
 
+    double renderTimePerByte = getRenderTimePerByte();
+    bool isCheapToRender = renderTimePerByte >= 0 && renderTimePerByte < NATRON_CHEAP_RENDER_TIME_PER_BYTE;
+
     if (sz > 1) {
-        ///The node is referenced multiple times below, cache it
+        ///The node is referenced multiple times below, cache it, unless it is so cheap to render again that caching it
+        ///would only evict more expensive images. Nodes that render full images or fetch several frames are never considered cheap.
+        if ( isCheapToRender && _imp->effect->supportsTiles() && !_imp->effect->doesTemporalClipAccess() &&
+             (_imp->effect->getRecursionLevel() == 0) && !isForceCachingEnabled() && !appPTR->isAggressiveCachingEnabled() ) {
+            return false;
+        }
+
         return true;
     } else {
         if (sz == 1) {
@@ -6015,6 +6387,11 @@ Node::shouldCacheOutput(bool isFrameVaryingOrAnimated,
                 ///Internal RotoPaint tree and the Roto node has its settings panel opened, cache it.
                 return true;
             }
+
+            if (renderTimePerByte >= NATRON_COSTLY_RENDER_TIME_PER_BYTE) {
+                ///The node is expensive to render (e.g: Defocus, optical flow), recomputing it costs more than keeping it resident.
+                return true;
+            }
         } else {
             // outputs == 0, never cache, unless explicitly set or rotopaint internal node
             RotoDrawableItemPtr attachedStroke = _imp->paintStroke.lock();
@@ -7074,6 +7451,12 @@ Node::getChannelSelectorKnob(int inputNb) const
     return found->second.layer.lock();
 }
 
+bool
+Node::hasHostOutputLayerSelector() const
+{
+    return _imp->channelsSelectors.find(-1) != _imp->channelsSelectors.end();
+}
+
 KnobBoolPtr
 Node::getProcessAllLayersKnob() const
 {
@@ -223,6 +223,14 @@ public:
      **/
     U64 getHashValue() const;
 
+    /**
+     * @brief Returns a hash of the values, animation curves and expressions of the knobs that have an effect on the render.
+     * Unlike the node hash, it does not depend on the inputs nor on the session.
+     * *hasUnhashedState is set to true if some of that state cannot be hashed: the result of expressions and the strings
+     * of animated string knobs.
+     **/
+    U64 computeKnobValuesHash(bool* hasUnhashedState) const;
+
     virtual std::string getCacheID() const OVERRIDE FINAL;
 
     /**
@@ -529,6 +537,12 @@ public:
      **/
     void getOutputsWithGroupRedirection(NodesList& outputs) const;
 
+    /**
+     * @brief The nodes whose hash is computed from the hash of this node: its outputs (entering into subgroups)
+     * and the nodes of its rotopaint tree, if any.
+     **/
+    void getHashDependents(std::vector<Node*>* dependents) const;
+
     /**
      * @brief Each input name is appended to the vector, in the same order
      * as they are in the internal inputs vector. Disconnected inputs are
@@ -861,6 +875,22 @@ public:
     ///called by EffectInstance
     void unregisterPluginMemory(size_t nBytes);
 
+    ///called by EffectInstance::renderRoI: accounts the images allocated by a render of this node
+    void addRenderImagesMemory(std::size_t cachedBytes, std::size_t temporaryBytes);
+
+    /**
+     * @brief Returns the memory accounted to this node since it was created: the memory currently held by the plug-in
+     * through the OpenFX memory suite and its peak, the totals of the images allocated by its renders, in and out of the cache,
+     * and the largest amount allocated by a single render.
+     **/
+    void getMemoryUsage(std::size_t* pluginMemory,
+                        std::size_t* pluginMemoryPeak,
+                        U64* renderImagesCachedBytes,
+                        U64* renderImagesTemporaryBytes,
+                        std::size_t* renderImagesPeak) const;
+
+    std::size_t getPluginMemoryUsed() const;
+
     //see eRenderSafetyInstanceSafe in EffectInstance::renderRoI
     //only 1 clone can render at any time
     QMutex & getRenderInstancesSharedMutex();
@@ -869,7 +899,25 @@ public:
 
     void refreshPreviewsRecursivelyUpstream(double time);
 
-    void incrementKnobsAge();
+    /**
+     * @brief Increments the age of the node, changing its hash. Pass knobValuesChanged=true when the change is reflected by the values of
+     * the knobs: otherwise, the hash also changes when it is computed from the knob values (see Settings::isContentBasedNodeHashEnabled()).
+     **/
+    void incrementKnobsAge(bool knobValuesChanged = false);
+
+    /**
+     * @brief Same as incrementKnobsAge() for a change that only affects the given region (in canonical coordinates) at the given time.
+     * The images cached with the previous hash remain valid outside of the region: they are not discarded and renderRoI
+     * re-renders only the dirty region, see getDirtyRegionForHash(). The region is propagated downstream to the nodes
+     * for which only this input changed, see EffectInstance::getOutputDirtyRegion().
+     **/
+    void incrementKnobsAgeInRegion(double time, const RectD& region);
+
+    /**
+     * @brief Returns true if the given hash of the node was produced by a change localized to a region, in which case
+     * the images cached with previousHash at the given time are still valid outside of the region.
+     **/
+    bool getDirtyRegionForHash(U64 hash, U64* previousHash, double* time, RectD* region) const;
 
     void incrementKnobsAge_internal();
 
@@ -1081,6 +1129,18 @@ public:
 
     bool isForceCachingEnabled() const;
 
+    /**
+     * @brief Records the time spent to render the given amount of bytes of output images.
+     * This is used by shouldCacheOutput() to determine whether the output of the node is worth caching.
+     **/
+    void addRenderCostSample(double timeSpent, std::size_t bytesRendered);
+
+    /**
+     * @brief Returns the average time in seconds spent to render a byte of output image, or -1 if the node
+     * did not render anything yet.
+     **/
+    double getRenderTimePerByte() const;
+
 
     /**
      * @brief Declares to Python all parameters as attribute of the variable representing this node.
@@ -1264,6 +1324,12 @@ public:
 
     KnobChoicePtr getChannelSelectorKnob(int inputNb) const;
 
+    /**
+     * @brief Returns true if the output layer menu of this node is managed by refreshChannelSelectors(),
+     * in which case a change of the layers flowing out of the node is reported by its return value.
+     **/
+    bool hasHostOutputLayerSelector() const;
+
     KnobBoolPtr getProcessAllLayersKnob() const;
 
     bool getSelectedLayer(int inputNb, const std::list<ImagePlaneDesc>& availableLayers, std::bitset<4> *processChannels, bool* isAll, ImagePlaneDesc *layer) const;
@@ -1333,7 +1399,11 @@ private:
 
     bool setStreamWarningInternal(StreamWarningEnum warning, const QString& message);
 
-    void computeHashRecursive(std::list<Node*>& marked);
+    /**
+     * @brief Refreshes the hash of the given nodes and of the nodes downstream whose hash depends on them.
+     * Each node is recomputed at most once, after its inputs, and only if the hash of one of them changed.
+     **/
+    static void computeHashRecursive(const std::list<Node*>& roots);
 
     /**
      * @brief Refreshes the node hash depending on its context (knobs age, inputs etc...)
@@ -1341,6 +1411,15 @@ private:
      **/
     bool computeHashInternal() WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Maps the dirty regions of the inputs whose hash changed from oldInputHashes to newInputHashes
+     * through the effect. Returns false if one of them changed for another reason than a localized change.
+     **/
+    bool getDirtyRegionFromInputs(const std::vector<U64>& oldInputHashes,
+                                  const std::vector<U64>& newInputHashes,
+                                  double* time,
+                                  RectD* region) const;
+
     void refreshCreatedViews(KnobI* knob, bool silent);
 
     void refreshInputRelatedDataRecursiveInternal(std::set<Node*>& markedNodes);
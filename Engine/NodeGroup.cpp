@@ -34,6 +34,8 @@
 #include <sstream> // stringstream
 #include <limits>
 
+#include <boost/unordered_map.hpp>
+
 #include <QtCore/QCoreApplication>
 #include <QtCore/QTextStream>
 
@@ -71,17 +73,59 @@ struct NodeCollectionPrivate
     mutable QMutex nodesMutex;
     NodesList nodes;
 
+    // The nodes indexed by script-name, protected by nodesMutex.
+    // A node may transiently be indexed under its previous name while it is being renamed: lookups always check the name.
+    typedef boost::unordered_multimap<std::string, Node*> NodesByNameMap;
+    NodesByNameMap nodesByName;
+
     NodeCollectionPrivate(const AppInstancePtr& app)
         : app(app)
         , graph(0)
         , nodesMutex()
         , nodes()
+        , nodesByName()
     {
     }
 
     NodePtr findNodeInternal(const std::string& name, const std::string& recurseName) const;
+
+    // Must be called with nodesMutex locked
+    Node* findNodeByNameLocked(const std::string& name, const Node* ignored) const;
+
+    // Must be called with nodesMutex locked
+    void removeFromNameIndexLocked(const Node* node, const std::string& name);
 };
 
+Node*
+NodeCollectionPrivate::findNodeByNameLocked(const std::string& name,
+                                            const Node* ignored) const
+{
+    std::pair<NodesByNameMap::const_iterator, NodesByNameMap::const_iterator> range = nodesByName.equal_range(name);
+
+    for (NodesByNameMap::const_iterator it = range.first; it != range.second; ++it) {
+        if ( (it->second != ignored) && (it->second->getScriptName_mt_safe() == name) ) {
+            return it->second;
+        }
+    }
+
+    return 0;
+}
+
+void
+NodeCollectionPrivate::removeFromNameIndexLocked(const Node* node,
+                                                 const std::string& name)
+{
+    std::pair<NodesByNameMap::iterator, NodesByNameMap::iterator> range = nodesByName.equal_range(name);
+
+    for (NodesByNameMap::iterator it = range.first; it != range.second; ++it) {
+        if (it->second == node) {
+            nodesByName.erase(it);
+
+            return;
+        }
+    }
+}
+
 NodeCollection::NodeCollection(const AppInstancePtr& app)
     : _imp( new NodeCollectionPrivate(app) )
 {
@@ -154,6 +198,7 @@ NodeCollection::addNode(const NodePtr& node)
     {
         QMutexLocker k(&_imp->nodesMutex);
         _imp->nodes.push_back(node);
+        _imp->nodesByName.insert( std::make_pair( node->getScriptName_mt_safe(), node.get() ) );
     }
 }
 
@@ -164,6 +209,22 @@ NodeCollection::removeNode(const Node* node)
     for (NodesList::iterator it =_imp->nodes.begin(); it != _imp->nodes.end();++it) {
         if ( it->get() == node ) {
             _imp->nodes.erase(it);
+            _imp->removeFromNameIndexLocked( node, node->getScriptName_mt_safe() );
+            break;
+        }
+    }
+}
+
+void
+NodeCollection::onNodeScriptNameChanged(const Node* node,
+                                        const std::string& oldName)
+{
+    QMutexLocker k(&_imp->nodesMutex);
+
+    for (NodesList::iterator it = _imp->nodes.begin(); it != _imp->nodes.end(); ++it) {
+        if ( it->get() == node ) {
+            _imp->removeFromNameIndexLocked(node, oldName);
+            _imp->nodesByName.insert( std::make_pair( node->getScriptName_mt_safe(), it->get() ) );
             break;
         }
     }
@@ -445,6 +506,7 @@ NodeCollection::clearNodesInternal(bool blocking)
     {
         QMutexLocker l(&_imp->nodesMutex);
         _imp->nodes.clear();
+        _imp->nodesByName.clear();
     }
 
     nodesToDelete.clear();
@@ -509,12 +571,9 @@ NodeCollection::checkNodeName(const Node* node,
     }
     do {
         foundNodeWithName = false;
-        QMutexLocker l(&_imp->nodesMutex);
-        for (NodesList::iterator it = _imp->nodes.begin(); it != _imp->nodes.end(); ++it) {
-            if ( (it->get() != node) && ( (*it)->getScriptName_mt_safe() == *nodeName ) ) {
-                foundNodeWithName = true;
-                break;
-            }
+        {
+            QMutexLocker l(&_imp->nodesMutex);
+            foundNodeWithName = _imp->findNodeByNameLocked(*nodeName, node) != 0;
         }
         if (foundNodeWithName) {
             if (errorIfExists || !appendDigit) {
@@ -757,26 +816,30 @@ NodePtr
 NodeCollectionPrivate::findNodeInternal(const std::string& name,
                                         const std::string& recurseName) const
 {
-    QMutexLocker k(&nodesMutex);
+    NodePtr found;
+    {
+        QMutexLocker k(&nodesMutex);
+        Node* node = findNodeByNameLocked(name, 0);
+        if (!node) {
+            return NodePtr();
+        }
+        found = node->shared_from_this();
+    }
 
-    for (NodesList::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
-        if ( (*it)->getScriptName_mt_safe() == name ) {
-            if ( !recurseName.empty() ) {
-                NodeGroup* isGrp = (*it)->isEffectGroup();
-                if (isGrp) {
-                    return isGrp->getNodeByFullySpecifiedName(recurseName);
-                } else {
-                    NodesList children;
-                    (*it)->getChildrenMultiInstance(&children);
-                    for (NodesList::iterator it2 = children.begin(); it2 != children.end(); ++it2) {
-                        if ( (*it2)->getScriptName_mt_safe() == recurseName ) {
-                            return *it2;
-                        }
-                    }
-                }
-            } else {
-                return *it;
-            }
+    if ( recurseName.empty() ) {
+        return found;
+    }
+
+    NodeGroup* isGrp = found->isEffectGroup();
+    if (isGrp) {
+        return isGrp->getNodeByFullySpecifiedName(recurseName);
+    }
+
+    NodesList children;
+    found->getChildrenMultiInstance(&children);
+    for (NodesList::iterator it = children.begin(); it != children.end(); ++it) {
+        if ( (*it)->getScriptName_mt_safe() == recurseName ) {
+            return *it;
         }
     }
 
@@ -938,13 +1001,7 @@ NodeCollection::checkIfNodeNameExists(const std::string & n,
 {
     QMutexLocker k(&_imp->nodesMutex);
 
-    for (NodesList::const_iterator it = _imp->nodes.begin(); it != _imp->nodes.end(); ++it) {
-        if ( (it->get() != caller) && ( (*it)->getScriptName_mt_safe() == n ) ) {
-            return true;
-        }
-    }
-
-    return false;
+    return _imp->findNodeByNameLocked(n, caller) != 0;
 }
 
 static void
@@ -157,6 +157,12 @@ public:
      **/
     bool autoConnectNodes(const NodePtr& selected, const NodePtr& created);
 
+    /**
+     * @brief Must be called when the script-name of a node of this collection changed so that
+     * the name index used by getNodeByName() stays in sync.
+     **/
+    void onNodeScriptNameChanged(const Node* node, const std::string& oldName);
+
     /**
      * @brief Returns true if a node has the give name n in the group. This is not called recursively on subgroups.
      **/
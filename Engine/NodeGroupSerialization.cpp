@@ -26,6 +26,8 @@
 #include "NodeGroupSerialization.h"
 
 #include <cassert>
+#include <map>
+#include <set>
 #include <stdexcept>
 
 #include <QtCore/QDateTime>
@@ -80,6 +82,27 @@ static QString lookForFileRecursively(const QString& dirPath, const QString& fil
 
 }
 
+typedef std::map<std::string, NodePtr> NodesByScriptNameMap;
+
+/*
+ * @brief Same as NodeCollection::connectNodes with an input name, but looks the input up in a map of the group's nodes
+ * built once rather than visiting all the nodes of the group for each connection.
+ */
+static bool
+connectNodesByScriptName(const NodesByScriptNameMap& nodesByScriptName,
+                         int inputNumber,
+                         const std::string& inputName,
+                         const NodePtr& output)
+{
+    NodesByScriptNameMap::const_iterator found = nodesByScriptName.find(inputName);
+
+    if ( found == nodesByScriptName.end() ) {
+        return false;
+    }
+
+    return NodeCollection::connectNodes(inputNumber, found->second, output);
+}
+
 bool
 NodeCollectionSerialization::restoreFromSerialization(const std::list<NodeSerializationPtr> & serializedNodes,
                                                       const NodeCollectionPtr& group,
@@ -107,6 +130,13 @@ NodeCollectionSerialization::restoreFromSerialization(const std::list<NodeSerial
     std::map<NodePtr, std::list<NodeSerializationPtr>::const_iterator > parentsToReconnect;
     std::list<NodeSerializationPtr> multiInstancesToRecurse;
     std::map<NodePtr, NodeSerializationPtr> createdNodes;
+
+    // The script-names of the serialized nodes, to find the parents of multi-instance nodes without visiting them all for each child
+    std::set<std::string> serializedScriptNames;
+    for (std::list<NodeSerializationPtr>::const_iterator it = serializedNodes.begin(); it != serializedNodes.end(); ++it) {
+        serializedScriptNames.insert( (*it)->getNodeScriptName() );
+    }
+
     for (std::list<NodeSerializationPtr>::const_iterator it = serializedNodes.begin(); it != serializedNodes.end(); ++it) {
         std::string pluginID = (*it)->getPluginID();
 
@@ -119,14 +149,7 @@ NodeCollectionSerialization::restoreFromSerialization(const std::list<NodeSerial
         ///If not, create it
 
         if ( !(*it)->getMultiInstanceParentName().empty() ) {
-            bool foundParent = false;
-            for (std::list<NodeSerializationPtr>::const_iterator it2 = serializedNodes.begin();
-                 it2 != serializedNodes.end(); ++it2) {
-                if ( (*it2)->getNodeScriptName() == (*it)->getMultiInstanceParentName() ) {
-                    foundParent = true;
-                    break;
-                }
-            }
+            bool foundParent = serializedScriptNames.find( (*it)->getMultiInstanceParentName() ) != serializedScriptNames.end();
             if (!foundParent) {
                 ///Maybe it was created so far by another child who created it so look into the nodes
 
@@ -317,6 +340,16 @@ NodeCollectionSerialization::restoreFromSerialization(const std::list<NodeSerial
     appInst->updateProjectLoadStatus( tr("Restoring graph links in group: %1").arg(groupName) );
 
 
+    // Index the nodes of the group by script-name once: looking each input up in the group is quadratic in the number of nodes
+    NodesByScriptNameMap nodesByScriptName;
+    {
+        NodesList groupNodes = group->getNodes();
+        for (NodesList::const_iterator it = groupNodes.begin(); it != groupNodes.end(); ++it) {
+            // Keep the first node with a given name, as NodeCollection::connectNodes does
+            nodesByScriptName.insert( std::make_pair( (*it)->getScriptName(), *it ) );
+        }
+    }
+
     /// Connect the nodes together
     for (std::map<NodePtr, NodeSerializationPtr>::const_iterator it = createdNodes.begin(); it != createdNodes.end(); ++it) {
         if ( appPTR->isBackground() && ( it->first->isEffectViewer() ) ) {
@@ -362,7 +395,7 @@ NodeCollectionSerialization::restoreFromSerialization(const std::list<NodeSerial
             bool isOfxEffect = it->first->isOpenFXNode();
 
             for (U32 j = 0; j < oldInputs.size(); ++j) {
-                if ( !oldInputs[j].empty() && !group->connectNodes(isOfxEffect ? oldInputs.size() - 1 - j : j, oldInputs[j], it->first) ) {
+                if ( !oldInputs[j].empty() && !connectNodesByScriptName(nodesByScriptName, isOfxEffect ? oldInputs.size() - 1 - j : j, oldInputs[j], it->first) ) {
                     if (createNodes) {
                         qDebug() << tr("Failed to connect node %1 to %2 (this is normal if loading a PyPlug)")
                                     .arg( QString::fromUtf8( it->second->getNodeScriptName().c_str() ) )
@@ -383,7 +416,7 @@ NodeCollectionSerialization::restoreFromSerialization(const std::list<NodeSerial
                                                      .arg( QString::fromUtf8( it2->first.c_str() ) ) );
                     continue;
                 }
-                if ( !it2->second.empty() && !group->connectNodes(index, it2->second, it->first) ) {
+                if ( !it2->second.empty() && !connectNodesByScriptName(nodesByScriptName, index, it2->second, it->first) ) {
                     if (createNodes) {
                         qDebug() << tr("Failed to connect node %1 to %2 (this is normal if loading a PyPlug)")
                                     .arg( QString::fromUtf8( it->second->getNodeScriptName().c_str() ) )
@@ -422,7 +455,7 @@ NodeCollectionSerialization::restoreFromSerialization(const std::list<NodeSerial
             bool isOfxEffect = it->first->isOpenFXNode();
 
             for (U32 j = 0; j < oldInputs.size(); ++j) {
-                if ( !oldInputs[j].empty() && !group->connectNodes(isOfxEffect ? oldInputs.size() - 1 - j : j, oldInputs[j], it->first) ) {
+                if ( !oldInputs[j].empty() && !connectNodesByScriptName(nodesByScriptName, isOfxEffect ? oldInputs.size() - 1 - j : j, oldInputs[j], it->first) ) {
                     if (createNodes) {
                         qDebug() << tr("Failed to connect node %1 to %2 (this is normal if loading a PyPlug)")
                                     .arg( QString::fromUtf8( it->first->getPluginLabel().c_str() ) )
@@ -442,7 +475,7 @@ NodeCollectionSerialization::restoreFromSerialization(const std::list<NodeSerial
                                                      tr("Could not find input named %1").arg( QString::fromUtf8( it2->first.c_str() ) ) );
                     continue;
                 }
-                if ( !it2->second.empty() && !group->connectNodes(index, it2->second, it->first) ) {
+                if ( !it2->second.empty() && !connectNodesByScriptName(nodesByScriptName, index, it2->second, it->first) ) {
                     if (createNodes) {
                         qDebug() << tr("Failed to connect node %1 to %2 (this is normal if loading a PyPlug)")
                                     .arg( QString::fromUtf8( it->first->getPluginLabel().c_str() ) )
@@ -750,6 +750,7 @@ Node::doDestroyNodeInternalEnd(bool autoReconnect)
 
     ///Remove all images in the cache associated to this node
     ///This will not remove from the disk cache if the project is closing
+    appPTR->setCacheEntriesPinnedForHolder(this, false);
     removeAllImagesFromCache(false);
 
     AppInstancePtr app = getApp();
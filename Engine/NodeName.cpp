@@ -345,6 +345,9 @@ Node::setNameInternal(const std::string& name,
             _imp->label = newName;
         }
     }
+    if (collection) {
+        collection->onNodeScriptNameChanged(this, oldName);
+    }
     std::string fullySpecifiedName = getFullyQualifiedName();
 
     if (mustSetCacheID) {
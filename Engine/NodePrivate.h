@@ -35,6 +35,7 @@
 #include <QtCore/QMutex>
 
 #include "Engine/Hash64.h"
+#include "Engine/RectD.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -43,6 +44,29 @@ typedef std::map<NodeWPtr, int > DeactivatedState;
 typedef std::list<Node::KnobLink> KnobLinkList;
 typedef std::vector<NodeWPtr> InputsV;
 
+///Keep the region of the last localized changes only: older images are unlikely to be requested again
+#define NATRON_NODE_MAX_DIRTY_REGIONS 8
+
+/**
+ * @brief A change localized to a region, see Node::incrementKnobsAgeInRegion(): the images cached with previousHash
+ * at the given time are still valid for the hash outside of the region.
+ **/
+struct NodeDirtyRegion
+{
+    U64 previousHash;
+    U64 hash;
+    double time;
+    RectD region; //< in canonical coordinates
+
+    NodeDirtyRegion()
+        : previousHash(0)
+        , hash(0)
+        , time(0)
+        , region()
+    {
+    }
+};
+
 
 class ChannelSelector
 {
@@ -169,13 +193,24 @@ public:
         , previewThreadQuit(false)
         , computingPreviewMutex()
         , pluginInstanceMemoryUsed(0)
+        , pluginInstanceMemoryPeak(0)
+        , renderImagesCachedBytes(0)
+        , renderImagesTemporaryBytes(0)
+        , renderImagesPeak(0)
         , memoryUsedMutex()
         , mustQuitPreview(0)
         , mustQuitPreviewMutex()
         , mustQuitPreviewCond()
         , renderInstancesSharedMutex(QMutex::Recursive)
         , knobsAge(0)
+        , hashInvalidationAge(0)
         , knobsAgeMutex()
+        , hash()
+        , dirtyRegions()
+        , hasPendingDirtyRegion(false)
+        , pendingDirtyRegion()
+        , hashedInputs()
+        , hashedKnobsAge(0)
         , masterNodeMutex()
         , masterNode()
         , nodeLinks()
@@ -254,6 +289,8 @@ public:
         , streamWarnings()
         , requiresGLFinishBeforeRender(false)
         , hostChannelSelectorEnabled(false)
+        , renderCostMutex()
+        , renderTimePerByte(-1.)
     {
         ///Initialize timers
         gettimeofday(&lastRenderStartedSlotCallTime, 0);
@@ -351,15 +388,25 @@ public:
     bool previewThreadQuit;
     mutable QMutex computingPreviewMutex;
     size_t pluginInstanceMemoryUsed; //< global count on all EffectInstance's of the memory they use.
-    QMutex memoryUsedMutex; //< protects _pluginInstanceMemoryUsed
+    size_t pluginInstanceMemoryPeak; //< highest value of pluginInstanceMemoryUsed
+    U64 renderImagesCachedBytes; //< total of the images allocated in the cache by the renders of this node
+    U64 renderImagesTemporaryBytes; //< total of the images allocated outside of the cache by the renders of this node
+    size_t renderImagesPeak; //< highest amount of image memory allocated by a single render of this node
+    QMutex memoryUsedMutex; //< protects all the above
     int mustQuitPreview;
     QMutex mustQuitPreviewMutex;
     QWaitCondition mustQuitPreviewCond;
     QMutex renderInstancesSharedMutex; //< see eRenderSafetyInstanceSafe in EffectInstance::renderRoI
     //only 1 clone can render at any time
     U64 knobsAge; //< the age of the knobs in this effect. It gets incremented every times the effect has its evaluate() function called.
-    mutable QReadWriteLock knobsAgeMutex; //< protects knobsAge and hash
+    U64 hashInvalidationAge; //< incremented when the age changes for a reason that the knob values do not reflect, see Settings::isContentBasedNodeHashEnabled()
+    mutable QReadWriteLock knobsAgeMutex; //< protects knobsAge, hashInvalidationAge and hash
     Hash64 hash; //< recomputed every time knobsAge is changed.
+    std::list<NodeDirtyRegion> dirtyRegions; //< the most recent first, protected by knobsAgeMutex
+    bool hasPendingDirtyRegion; //< set by incrementKnobsAgeInRegion until the next hash computation, protected by knobsAgeMutex
+    NodeDirtyRegion pendingDirtyRegion; //< protected by knobsAgeMutex
+    std::vector<U64> hashedInputs; //< hash of each input when the hash was last computed, protected by knobsAgeMutex
+    U64 hashedKnobsAge; //< knobsAge when the hash was last computed, protected by knobsAgeMutex
     mutable QMutex masterNodeMutex; //< protects masterNode and nodeLinks
     NodeWPtr masterNode; //< this points to the master when the node is a clone
     KnobLinkList nodeLinks; //< these point to the parents of the params links
@@ -482,6 +529,10 @@ public:
     bool requiresGLFinishBeforeRender;
 
     bool hostChannelSelectorEnabled;
+
+    // Running average of the time (in seconds) spent to render a byte of output image, -1 until the node rendered
+    mutable QMutex renderCostMutex;
+    double renderTimePerByte; // protected by renderCostMutex
 };
 
 
@@ -24,6 +24,7 @@
 #include <smmintrin.h>
 #endif
 #include <cmath>
+#include <algorithm>
 
 #ifndef  SEEXPR_USE_SSE
 #include <boost/math/special_functions/round.hpp> // std::round appeared in C++11
@@ -236,6 +237,152 @@ void FBM(const T* in, T* out, int octaves, T lacunarity, T gain) {
     }
 }
 
+//! Number of points processed together by the batched noise functions
+static const int kNoiseLanes = 8;
+
+//! Same as noiseHelper, but on a block of points stored per dimension: X[k][l] is the k-th coordinate of lane l.
+//! Only the gradient lookup is done lane by lane, everything else is a loop over the lanes.
+template <int d, class T, bool periodic>
+void noiseHelperLanes(const T X[d][kNoiseLanes], int lanes, T out[kNoiseLanes], const int* period = 0) {
+    T weights[2][d][kNoiseLanes];
+    int index[d][kNoiseLanes];
+    for (int k = 0; k < d; k++) {
+        for (int l = 0; l < lanes; l++) {
+            T f = floorSSE(X[k][l]);
+            index[k][l] = (int)f;
+            weights[0][k][l] = X[k][l] - f;
+            weights[1][k][l] = weights[0][k][l] - 1;
+        }
+        if (periodic) {
+            for (int l = 0; l < lanes; l++) {
+                index[k][l] %= period[k];
+                if (index[k][l] < 0) index[k][l] += period[k];
+            }
+        }
+    }
+    int num = 1 << d;
+    T vals[1 << d][kNoiseLanes];
+    for (int dummy = 0; dummy < num; dummy++) {
+        int offset[d];
+        for (int k = 0; k < d; k++) offset[k] = ((dummy & (1 << k)) != 0);
+        for (int l = 0; l < lanes; l++) {
+            int latticeIndex[d];
+            for (int k = 0; k < d; k++) latticeIndex[k] = index[k][l] + offset[k];
+            int lookup = hashReduceChar<d>(latticeIndex);
+            T val = 0;
+            for (int k = 0; k < d; k++) val += NOISE_TABLES<d>::g[lookup][k] * weights[offset[k]][k][l];
+            vals[dummy][l] = val;
+        }
+    }
+    T alphas[d][kNoiseLanes];
+    for (int k = 0; k < d; k++) {
+        for (int l = 0; l < lanes; l++) alphas[k][l] = s_curve(weights[0][k][l]);
+    }
+    for (int newd = d - 1; newd >= 0; newd--) {
+        int newnum = 1 << newd;
+        int k = (d - newd - 1);
+        for (int dummy = 0; dummy < newnum; dummy++) {
+            int index = dummy * (1 << (d - newd));
+            int otherIndex = index + (1 << k);
+            for (int l = 0; l < lanes; l++) {
+                vals[index][l] = (T(1) - alphas[k][l]) * vals[index][l] + alphas[k][l] * vals[otherIndex][l];
+            }
+        }
+    }
+    for (int l = 0; l < lanes; l++) out[l] = vals[0][l];
+}
+
+//! Evaluates Noise or PNoise on one block of lanes, d_out values per lane
+template <int d_in, int d_out, class T, bool periodic>
+void noiseLanes(const T P[d_in][kNoiseLanes], int lanes, T out[d_out][kNoiseLanes], const int* period = 0) {
+    T Q[d_in][kNoiseLanes];
+    for (int k = 0; k < d_in; k++) {
+        for (int l = 0; l < lanes; l++) Q[k][l] = P[k][l];
+    }
+    int i = 0;
+    while (1) {
+        noiseHelperLanes<d_in, T, periodic>(Q, lanes, out[i], period);
+        if (++i >= d_out) break;
+        // coverity[dead_error_begin]
+        for (int k = 0; k < d_out; k++) {
+            for (int l = 0; l < lanes; l++) Q[k][l] += (T)1000;
+        }
+    }
+}
+
+//! Loads the block of points starting at first into lanes
+template <int d_in, class T>
+int loadLanes(const T* in, int first, int count, T P[d_in][kNoiseLanes]) {
+    int lanes = std::min(kNoiseLanes, count - first);
+    for (int l = 0; l < lanes; l++) {
+        for (int k = 0; k < d_in; k++) P[k][l] = in[(first + l) * d_in + k];
+    }
+    return lanes;
+}
+
+template <int d_out, class T>
+void storeLanes(const T res[d_out][kNoiseLanes], int first, int lanes, T* out) {
+    for (int l = 0; l < lanes; l++) {
+        for (int k = 0; k < d_out; k++) out[(first + l) * d_out + k] = res[k][l];
+    }
+}
+
+template <int d_in, int d_out, class T>
+void NoiseN(const T* in, T* out, int count) {
+    for (int first = 0; first < count; first += kNoiseLanes) {
+        T P[d_in][kNoiseLanes];
+        T res[d_out][kNoiseLanes];
+        int lanes = loadLanes<d_in>(in, first, count, P);
+        noiseLanes<d_in, d_out, T, false>(P, lanes, res);
+        storeLanes<d_out>(res, first, lanes, out);
+    }
+}
+
+template <int d_in, int d_out, class T>
+void PNoiseN(const T* in, const int* period, T* out, int count) {
+    for (int first = 0; first < count; first += kNoiseLanes) {
+        T P[d_in][kNoiseLanes];
+        T res[d_out][kNoiseLanes];
+        int lanes = loadLanes<d_in>(in, first, count, P);
+        noiseLanes<d_in, d_out, T, true>(P, lanes, res, period);
+        storeLanes<d_out>(res, first, lanes, out);
+    }
+}
+
+template <int d_in, int d_out, bool turbulence, class T>
+void FBMN(const T* in, T* out, int count, int octaves, T lacunarity, T gain) {
+    for (int first = 0; first < count; first += kNoiseLanes) {
+        T P[d_in][kNoiseLanes];
+        T res[d_out][kNoiseLanes];
+        int lanes = loadLanes<d_in>(in, first, count, P);
+        for (int k = 0; k < d_out; k++) {
+            for (int l = 0; l < lanes; l++) res[k][l] = 0;
+        }
+        T scale = 1;
+        int octave = 0;
+        while (1) {
+            T localResult[d_out][kNoiseLanes];
+            noiseLanes<d_in, d_out, T, false>(P, lanes, localResult);
+            for (int k = 0; k < d_out; k++) {
+                for (int l = 0; l < lanes; l++) {
+                    res[k][l] += (turbulence ? fabs(localResult[k][l]) : localResult[k][l]) * scale;
+                }
+            }
+            if (++octave >= octaves) break;
+            scale *= gain;
+            for (int k = 0; k < d_in; k++) {
+                for (int l = 0; l < lanes; l++) P[k][l] = P[k][l] * lacunarity + (T)1234;
+            }
+        }
+        storeLanes<d_out>(res, first, lanes, out);
+    }
+}
+
+template <int d_in, int d_out, class T>
+void CellNoiseN(const T* in, T* out, int count) {
+    for (int i = 0; i < count; i++) CellNoise<d_in, d_out>(in + i * d_in, out + i * d_out);
+}
+
 // Explicit instantiations
 template void CellNoise<3, 1, double>(const double*, double*);
 template void CellNoise<3, 3, double>(const double*, double*);
@@ -252,6 +399,20 @@ template void FBM<3, 3, false, double>(const double*, double*, int, double, doub
 template void FBM<3, 3, true, double>(const double*, double*, int, double, double);
 template void FBM<4, 1, false, double>(const double*, double*, int, double, double);
 template void FBM<4, 3, false, double>(const double*, double*, int, double, double);
+template void NoiseN<3, 1, double>(const double*, double*, int);
+template void NoiseN<3, 1, float>(const float*, float*, int);
+template void NoiseN<3, 3, double>(const double*, double*, int);
+template void NoiseN<3, 3, float>(const float*, float*, int);
+template void PNoiseN<3, 1, double>(const double*, const int*, double*, int);
+template void PNoiseN<3, 1, float>(const float*, const int*, float*, int);
+template void FBMN<3, 1, false, double>(const double*, double*, int, int, double, double);
+template void FBMN<3, 1, false, float>(const float*, float*, int, int, float, float);
+template void FBMN<3, 1, true, double>(const double*, double*, int, int, double, double);
+template void FBMN<3, 1, true, float>(const float*, float*, int, int, float, float);
+template void FBMN<3, 3, false, double>(const double*, double*, int, int, double, double);
+template void FBMN<3, 3, false, float>(const float*, float*, int, int, float, float);
+template void CellNoiseN<3, 1, double>(const double*, double*, int);
+template void CellNoiseN<3, 1, float>(const float*, float*, int);
 NATRON_NAMESPACE_EXIT
 
 #ifdef MAINTEST
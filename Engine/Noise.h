@@ -38,6 +38,22 @@ void FBM(const T* in, T* out, int octaves, T lacunarity, T gain);
 template <int d_in, int d_out, class T>
 void CellNoise(const T* in, T* out);
 
+//! Batched variants: evaluate count points at once. in holds count * d_in
+//! coordinates (point after point) and out receives count * d_out values.
+//! Points are processed in blocks of lanes so that the per-lane loops vectorize.
+template <int d_in, int d_out, class T>
+void NoiseN(const T* in, T* out, int count);
+
+template <int d_in, int d_out, class T>
+void PNoiseN(const T* in, const int* period, T* out, int count);
+
+//! The octaves are accumulated over a block of points at a time
+template <int d_in, int d_out, bool turbulence, class T>
+void FBMN(const T* in, T* out, int count, int octaves, T lacunarity, T gain);
+
+template <int d_in, int d_out, class T>
+void CellNoiseN(const T* in, T* out, int count);
+
 NATRON_NAMESPACE_EXIT
 
 #endif // NATRON_ENGINE_NOISE_H
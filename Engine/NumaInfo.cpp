@@ -0,0 +1,261 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Engine/NumaInfo.h"
+
+#include <cstdlib> // malloc
+#include <fstream>
+#include <sstream> // stringstream
+#include <string>
+#include <vector>
+
+#if defined(__linux__) || defined(__linux) || defined(linux) || defined(__gnu_linux__)
+#define NATRON_NUMA_LINUX
+#include <sched.h> // sched_getcpu, sched_setaffinity
+#include <unistd.h> // sysconf, syscall
+#include <sys/syscall.h> // SYS_mbind
+#endif
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+
+// Do not depend on libnuma for the only policy we use, see mbind(2)
+#define NATRON_MPOL_PREFERRED 1
+
+// Buffers smaller than this are not worth a system call, they stay wherever malloc puts them
+#define NATRON_NUMA_MIN_BOUND_ALLOCATION_SIZE (1024 * 1024)
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct NumaTopology
+{
+    // For each node, the CPUs of the node
+    std::vector<std::vector<int> > nodeCpus;
+
+    // For each node, its id for the kernel (nodes without CPUs are skipped)
+    std::vector<int> nodeIds;
+
+    // For each CPU, its node
+    std::vector<int> cpuNode;
+};
+
+QMutex topologyMutex;
+bool topologyInitialized = false;
+NumaTopology topology;
+QAtomicInt numaAwareRendering(0);
+QAtomicInt nextThreadNode(0);
+
+#ifdef NATRON_NUMA_LINUX
+// Parses a sysfs list such as "0-3,8-11"
+std::vector<int>
+parseSysfsList(const std::string& path)
+{
+    std::vector<int> ret;
+    std::ifstream ifs( path.c_str() );
+    std::string list;
+
+    if ( !ifs || !std::getline(ifs, list) ) {
+        return ret;
+    }
+    std::stringstream ss(list);
+    std::string range;
+    while ( std::getline(ss, range, ',') ) {
+        int first = 0, last = -1;
+        char dash = 0;
+        std::stringstream rs(range);
+        if ( !(rs >> first) ) {
+            continue;
+        }
+        if ( (rs >> dash) && (dash == '-') && (rs >> last) ) {
+        } else {
+            last = first;
+        }
+        for (int i = first; i <= last; ++i) {
+            ret.push_back(i);
+        }
+    }
+
+    return ret;
+}
+#endif
+
+const NumaTopology&
+getTopology()
+{
+    QMutexLocker k(&topologyMutex);
+
+    if (topologyInitialized) {
+        return topology;
+    }
+    topologyInitialized = true;
+#ifdef NATRON_NUMA_LINUX
+    std::vector<int> nodes = parseSysfsList("/sys/devices/system/node/online");
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        std::stringstream ss;
+        ss << "/sys/devices/system/node/node" << nodes[i] << "/cpulist";
+        std::vector<int> cpus = parseSysfsList( ss.str() );
+        if ( cpus.empty() ) {
+            // Memory-only node, no thread can be bound to it
+            continue;
+        }
+        int node = (int)topology.nodeCpus.size();
+        topology.nodeCpus.push_back(cpus);
+        topology.nodeIds.push_back(nodes[i]);
+        for (std::size_t c = 0; c < cpus.size(); ++c) {
+            if ( cpus[c] >= (int)topology.cpuNode.size() ) {
+                topology.cpuNode.resize(cpus[c] + 1, -1);
+            }
+            topology.cpuNode[cpus[c]] = node;
+        }
+    }
+#endif
+
+    return topology;
+} // getTopology
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+int
+getNumaNodesCount()
+{
+    const NumaTopology& t = getTopology();
+
+    return t.nodeCpus.empty() ? 1 : (int)t.nodeCpus.size();
+}
+
+int
+getCurrentThreadNumaNode()
+{
+#ifdef NATRON_NUMA_LINUX
+    const NumaTopology& t = getTopology();
+    int cpu = sched_getcpu();
+    if ( (cpu < 0) || ( cpu >= (int)t.cpuNode.size() ) ) {
+        return -1;
+    }
+
+    return t.cpuNode[cpu];
+#else
+
+    return -1;
+#endif
+}
+
+bool
+bindCurrentThreadToNumaNode(int node)
+{
+#ifdef NATRON_NUMA_LINUX
+    const NumaTopology& t = getTopology();
+    if ( (node < 0) || ( node >= (int)t.nodeCpus.size() ) ) {
+        return false;
+    }
+    const std::vector<int>& cpus = t.nodeCpus[node];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (std::size_t i = 0; i < cpus.size(); ++i) {
+        if (cpus[i] < CPU_SETSIZE) {
+            CPU_SET(cpus[i], &set);
+        }
+    }
+
+    // 0 means the calling thread
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    Q_UNUSED(node);
+
+    return false;
+#endif
+}
+
+int
+getNextNumaNodeForThread()
+{
+    int nNodes = getNumaNodesCount();
+
+    return (nextThreadNode.fetchAndAddRelaxed(1) & 0x7FFFFFFF) % nNodes;
+}
+
+void
+setNumaAwareRenderingEnabled(bool enabled)
+{
+    numaAwareRendering.fetchAndStoreRelaxed(enabled ? 1 : 0);
+}
+
+bool
+isNumaAwareRenderingEnabled()
+{
+    return numaAwareRendering.fetchAndAddRelaxed(0) != 0;
+}
+
+bool
+bindMemoryToNumaNode(void* ptr,
+                     std::size_t size,
+                     int node)
+{
+#ifdef NATRON_NUMA_LINUX
+    const NumaTopology& t = getTopology();
+    if ( (node < 0) || ( node >= (int)t.nodeIds.size() ) || (t.nodeIds[node] >= (int)(sizeof(unsigned long) * 8) ) ) {
+        return false;
+    }
+    // Pages that are not touched yet will be faulted in on the node
+    unsigned long nodeMask = 1UL << t.nodeIds[node];
+
+    return syscall(SYS_mbind, ptr, size, NATRON_MPOL_PREFERRED, &nodeMask, sizeof(nodeMask) * 8 + 1, 0) == 0;
+#else
+    Q_UNUSED(ptr);
+    Q_UNUSED(size);
+    Q_UNUSED(node);
+
+    return false;
+#endif
+}
+
+void*
+allocateNumaLocalMemory(std::size_t size)
+{
+#ifdef NATRON_NUMA_LINUX
+    if ( (size >= NATRON_NUMA_MIN_BOUND_ALLOCATION_SIZE) && isNumaAwareRenderingEnabled() && (getNumaNodesCount() > 1) ) {
+        int node = getCurrentThreadNumaNode();
+        long pageSize = sysconf(_SC_PAGESIZE);
+        if ( (node >= 0) && (pageSize > 0) ) {
+            // Allocate whole pages so that the policy does not apply to memory shared with other allocations
+            std::size_t len = ( (size + pageSize - 1) / pageSize ) * pageSize;
+            void* ret = 0;
+            if (posix_memalign(&ret, pageSize, len) != 0) {
+                return 0;
+            }
+            // A failure is harmless, the memory is then placed by the default first-touch policy
+            bindMemoryToNumaNode(ret, len, node);
+
+            return ret;
+        }
+    }
+#endif
+
+    return std::malloc(size);
+} // allocateNumaLocalMemory
+
+NATRON_NAMESPACE_EXIT
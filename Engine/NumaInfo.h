@@ -0,0 +1,83 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_NumaInfo_h
+#define Engine_NumaInfo_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef> // std::size_t
+
+NATRON_NAMESPACE_ENTER
+
+// NUMA (Non-Uniform Memory Access) utility functions.
+// On multi-socket systems, memory attached to another socket is slower to access: when NUMA-aware rendering is
+// enabled, render threads are each bound to a node and the image buffers are allocated on the node of the thread
+// that creates them, so that they are produced and consumed on the same node.
+// The topology is read from the Linux sysfs, other systems are seen as having a single node.
+
+/**
+ * @brief Returns the number of NUMA nodes of the system, 1 if it is not a NUMA system.
+ **/
+int getNumaNodesCount();
+
+/**
+ * @brief Returns the NUMA node of the CPU the calling thread is running on, or -1 if it cannot be determined.
+ **/
+int getCurrentThreadNumaNode();
+
+/**
+ * @brief Restricts the calling thread to the CPUs of the given node. Returns false if it failed.
+ **/
+bool bindCurrentThreadToNumaNode(int node);
+
+/**
+ * @brief Returns a node to bind a new render thread to, in a round-robin fashion so that the threads are
+ * spread evenly across the nodes.
+ **/
+int getNextNumaNodeForThread();
+
+/**
+ * @brief When enabled, render threads are bound to a NUMA node and allocateNumaLocalMemory allocates
+ * on the node of the calling thread. Has no effect on systems with a single node.
+ **/
+void setNumaAwareRenderingEnabled(bool enabled);
+bool isNumaAwareRenderingEnabled();
+
+/**
+ * @brief Sets the policy of the memory pages in [ptr, ptr + size) so that they are allocated on the given node
+ * when first touched. ptr must be aligned on a page. Returns false if it failed.
+ **/
+bool bindMemoryToNumaNode(void* ptr, std::size_t size, int node);
+
+/**
+ * @brief Allocates size bytes on the NUMA node of the calling thread if NUMA-aware rendering is enabled,
+ * otherwise this is equivalent to malloc. The memory must be released with free(). Returns NULL on failure.
+ **/
+void* allocateNumaLocalMemory(std::size_t size);
+
+NATRON_NAMESPACE_EXIT
+
+#endif // ifndef Engine_NumaInfo_h
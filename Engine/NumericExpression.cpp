@@ -0,0 +1,757 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "NumericExpression.h"
+
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream> // stringstream
+
+#if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+#include <boost/math/special_functions/fpclassify.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#endif
+
+// Integers are held in doubles: beyond this Python (arbitrary precision) and us would disagree
+#define NATRON_NUMERIC_EXPRESSION_MAX_INT 9007199254740992. // 2^53
+
+// The evaluation stack lives on the C++ stack: deeper expressions are left to Python
+#define NATRON_NUMERIC_EXPRESSION_MAX_STACK 64
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+enum FunctionEnum
+{
+    eFunctionSin = 0,
+    eFunctionCos,
+    eFunctionTan,
+    eFunctionAsin,
+    eFunctionAcos,
+    eFunctionAtan,
+    eFunctionSinh,
+    eFunctionCosh,
+    eFunctionTanh,
+    eFunctionExp,
+    eFunctionLog,
+    eFunctionLog10,
+    eFunctionSqrt,
+    eFunctionFabs,
+    eFunctionFloor,
+    eFunctionCeil,
+    eFunctionDegrees,
+    eFunctionRadians,
+    eFunctionPow,
+    eFunctionAtan2,
+    eFunctionFmod,
+    eFunctionHypot,
+    eFunctionAbs,
+    eFunctionInt,
+    eFunctionFloat,
+    eFunctionMin,
+    eFunctionMax
+};
+
+struct FunctionDesc
+{
+    const char* name;
+    FunctionEnum function;
+    int minArgs;
+    int maxArgs; // -1: any number
+};
+
+// The names brought in the expressions scope by "from math import *", and the builtins that make sense here
+const FunctionDesc functions[] = {
+    { "sin", eFunctionSin, 1, 1 },
+    { "cos", eFunctionCos, 1, 1 },
+    { "tan", eFunctionTan, 1, 1 },
+    { "asin", eFunctionAsin, 1, 1 },
+    { "acos", eFunctionAcos, 1, 1 },
+    { "atan", eFunctionAtan, 1, 1 },
+    { "sinh", eFunctionSinh, 1, 1 },
+    { "cosh", eFunctionCosh, 1, 1 },
+    { "tanh", eFunctionTanh, 1, 1 },
+    { "exp", eFunctionExp, 1, 1 },
+    { "log", eFunctionLog, 1, 2 },
+    { "log10", eFunctionLog10, 1, 1 },
+    { "sqrt", eFunctionSqrt, 1, 1 },
+    { "fabs", eFunctionFabs, 1, 1 },
+    { "floor", eFunctionFloor, 1, 1 },
+    { "ceil", eFunctionCeil, 1, 1 },
+    { "degrees", eFunctionDegrees, 1, 1 },
+    { "radians", eFunctionRadians, 1, 1 },
+    { "pow", eFunctionPow, 2, 2 }, // math.pow shadows the builtin
+    { "atan2", eFunctionAtan2, 2, 2 },
+    { "fmod", eFunctionFmod, 2, 2 },
+    { "hypot", eFunctionHypot, 2, 2 },
+    { "abs", eFunctionAbs, 1, 1 },
+    { "int", eFunctionInt, 1, 1 },
+    { "float", eFunctionFloat, 1, 1 },
+    { "min", eFunctionMin, 2, -1 },
+    { "max", eFunctionMax, 2, -1 },
+    { 0, eFunctionSin, 0, 0 }
+};
+
+struct Value
+{
+    double v;
+    bool isInt;
+};
+
+bool
+isFinite(double v)
+{
+    return (boost::math::isfinite)(v);
+}
+
+bool
+isNaN(double v)
+{
+    return (boost::math::isnan)(v);
+}
+
+/// Python raises ValueError when a math function returns NaN from non-NaN arguments and OverflowError
+/// when it returns an infinite value from finite arguments
+bool
+checkMathResult(double r,
+                const Value* args,
+                int nArgs)
+{
+    bool hasNaN = false;
+    bool allFinite = true;
+
+    for (int i = 0; i < nArgs; ++i) {
+        hasNaN |= isNaN(args[i].v);
+        allFinite &= isFinite(args[i].v);
+    }
+    if ( isNaN(r) && !hasNaN ) {
+        return false;
+    }
+    if ( !isFinite(r) && !isNaN(r) && allFinite ) {
+        return false;
+    }
+
+    return true;
+}
+
+bool
+checkIntResult(double r)
+{
+    return std::fabs(r) <= NATRON_NUMERIC_EXPRESSION_MAX_INT;
+}
+
+bool
+callFunction(FunctionEnum f,
+             const Value* args,
+             int nArgs,
+             Value* ret)
+{
+    const double x = args[0].v;
+
+    ret->isInt = false;
+    switch (f) {
+    case eFunctionSin:
+        ret->v = std::sin(x);
+        break;
+    case eFunctionCos:
+        ret->v = std::cos(x);
+        break;
+    case eFunctionTan:
+        ret->v = std::tan(x);
+        break;
+    case eFunctionAsin:
+        ret->v = std::asin(x);
+        break;
+    case eFunctionAcos:
+        ret->v = std::acos(x);
+        break;
+    case eFunctionAtan:
+        ret->v = std::atan(x);
+        break;
+    case eFunctionSinh:
+        ret->v = std::sinh(x);
+        break;
+    case eFunctionCosh:
+        ret->v = std::cosh(x);
+        break;
+    case eFunctionTanh:
+        ret->v = std::tanh(x);
+        break;
+    case eFunctionExp:
+        ret->v = std::exp(x);
+        break;
+    case eFunctionLog:
+        if (x <= 0.) {
+            return false;
+        }
+        ret->v = std::log(x);
+        if (nArgs == 2) {
+            if (args[1].v <= 0.) {
+                return false;
+            }
+            double logBase = std::log(args[1].v);
+            if (logBase == 0.) {
+                return false; // ZeroDivisionError
+            }
+            ret->v /= logBase;
+        }
+        break;
+    case eFunctionLog10:
+        if (x <= 0.) {
+            return false;
+        }
+        ret->v = std::log10(x);
+        break;
+    case eFunctionSqrt:
+        ret->v = std::sqrt(x);
+        break;
+    case eFunctionFabs:
+        ret->v = std::fabs(x);
+        break;
+    case eFunctionFloor:
+    case eFunctionCeil:
+        ret->v = (f == eFunctionFloor) ? std::floor(x) : std::ceil(x);
+#if PY_MAJOR_VERSION >= 3
+        // Python 3 returns an int
+        if ( !isFinite(x) || !checkIntResult(ret->v) ) {
+            return false;
+        }
+        ret->isInt = true;
+#endif
+        break;
+    case eFunctionDegrees:
+        ret->v = x * 180. / M_PI;
+        break;
+    case eFunctionRadians:
+        ret->v = x * M_PI / 180.;
+        break;
+    case eFunctionPow:
+        ret->v = std::pow(x, args[1].v);
+        break;
+    case eFunctionAtan2:
+        ret->v = std::atan2(x, args[1].v);
+        break;
+    case eFunctionFmod:
+        ret->v = std::fmod(x, args[1].v);
+        break;
+    case eFunctionHypot:
+        ret->v = std::sqrt(x * x + args[1].v * args[1].v);
+        break;
+    case eFunctionAbs:
+        *ret = args[0];
+        ret->v = std::fabs(x);
+
+        return true;
+    case eFunctionInt:
+        if ( !isFinite(x) ) {
+            return false;
+        }
+        ret->v = x < 0. ? std::ceil(x) : std::floor(x);
+        ret->isInt = true;
+
+        return checkIntResult(ret->v);
+    case eFunctionFloat:
+        ret->v = x;
+
+        return true;
+    case eFunctionMin:
+    case eFunctionMax:
+        // like Python, keep the first of equal values
+        *ret = args[0];
+        for (int i = 1; i < nArgs; ++i) {
+            if ( (f == eFunctionMin) ? (args[i].v < ret->v) : (args[i].v > ret->v) ) {
+                *ret = args[i];
+            }
+        }
+
+        return true;
+    } // switch
+
+    return checkMathResult(ret->v, args, nArgs);
+} // callFunction
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+/*
+ * Recursive descent parser following the Python grammar for arithmetic expressions:
+ *  expr    := term (('+' | '-') term)*
+ *  term    := unary (('*' | '/' | '//' | '%') unary)*
+ *  unary   := ('-' | '+') unary | power
+ *  power   := primary ['**' unary]
+ *  primary := number | name | name '(' expr (',' expr)* ')' | '(' expr ')'
+ */
+class NumericExpression::Parser
+{
+public:
+
+    Parser(const std::string& expr,
+           NumericExpression* e)
+        : _s( expr.c_str() )
+        , _e(e)
+        , _depth(0)
+    {
+    }
+
+    bool parse()
+    {
+        if ( !parseExpr() ) {
+            return false;
+        }
+        skipSpaces();
+
+        return *_s == '\0';
+    }
+
+private:
+
+    void skipSpaces()
+    {
+        while (*_s == ' ' || *_s == '\t') {
+            ++_s;
+        }
+    }
+
+    bool accept(const char* token)
+    {
+        skipSpaces();
+        std::size_t len = std::strlen(token);
+        if (std::strncmp(_s, token, len) != 0) {
+            return false;
+        }
+        _s += len;
+
+        return true;
+    }
+
+    /// Keeps track of the number of values on the evaluation stack
+    bool push(const Instruction& i,
+              int stackDelta)
+    {
+        _e->_program.push_back(i);
+        _depth += stackDelta;
+
+        return _depth <= NATRON_NUMERIC_EXPRESSION_MAX_STACK;
+    }
+
+    bool pushOp(OpCodeEnum op,
+                int stackDelta)
+    {
+        Instruction i;
+
+        i.op = op;
+        i.value = 0.;
+        i.isInt = false;
+        i.function = 0;
+        i.nArgs = 0;
+
+        return push(i, stackDelta);
+    }
+
+    bool parseExpr()
+    {
+        if ( !parseTerm() ) {
+            return false;
+        }
+        for (;;) {
+            if ( accept("+") ) {
+                if ( !parseTerm() || !pushOp(eOpCodeAdd, -1) ) {
+                    return false;
+                }
+            } else if ( accept("-") ) {
+                if ( !parseTerm() || !pushOp(eOpCodeSubtract, -1) ) {
+                    return false;
+                }
+            } else {
+                return true;
+            }
+        }
+    }
+
+    bool parseTerm()
+    {
+        if ( !parseUnary() ) {
+            return false;
+        }
+        for (;;) {
+            OpCodeEnum op;
+            if ( accept("**") ) {
+                return false; // handled by parsePower(): we only get here on a syntax error
+            } else if ( accept("*") ) {
+                op = eOpCodeMultiply;
+            } else if ( accept("//") ) {
+                op = eOpCodeFloorDivide;
+            } else if ( accept("/") ) {
+                op = eOpCodeDivide;
+            } else if ( accept("%") ) {
+                op = eOpCodeModulo;
+            } else {
+                return true;
+            }
+            if ( !parseUnary() || !pushOp(op, -1) ) {
+                return false;
+            }
+        }
+    }
+
+    bool parseUnary()
+    {
+        if ( accept("-") ) {
+            return parseUnary() && pushOp(eOpCodeNegate, 0);
+        } else if ( accept("+") ) {
+            return parseUnary();
+        }
+
+        return parsePower();
+    }
+
+    bool parsePower()
+    {
+        if ( !parsePrimary() ) {
+            return false;
+        }
+        if ( accept("**") ) {
+            return parseUnary() && pushOp(eOpCodePower, -1);
+        }
+
+        return true;
+    }
+
+    bool parsePrimary()
+    {
+        skipSpaces();
+        if ( accept("(") ) {
+            return parseExpr() && accept(")");
+        }
+        if ( ( (*_s >= '0') && (*_s <= '9') ) || (*_s == '.') ) {
+            return parseNumber();
+        }
+        if ( std::isalpha( (unsigned char)*_s ) || (*_s == '_') ) {
+            return parseName();
+        }
+
+        return false;
+    }
+
+    bool parseNumber()
+    {
+        const char* start = _s;
+        bool isInt = true;
+
+        while (*_s >= '0' && *_s <= '9') {
+            ++_s;
+        }
+        if (*_s == '.') {
+            isInt = false;
+            ++_s;
+            while (*_s >= '0' && *_s <= '9') {
+                ++_s;
+            }
+        }
+        if ( (_s - start == 1) && (*start == '.') ) {
+            return false;
+        }
+        if ( (*_s == 'e') || (*_s == 'E') ) {
+            isInt = false;
+            ++_s;
+            if ( (*_s == '+') || (*_s == '-') ) {
+                ++_s;
+            }
+            if ( (*_s < '0') || (*_s > '9') ) {
+                return false;
+            }
+            while (*_s >= '0' && *_s <= '9') {
+                ++_s;
+            }
+        }
+        // reject suffixes (1L, 1j) and hexadecimal/octal literals
+        if ( std::isalnum( (unsigned char)*_s ) || (*_s == '_') || (*_s == '.') ) {
+            return false;
+        }
+        if ( isInt && (*start == '0') && (_s - start > 1) ) {
+            return false;
+        }
+        Instruction i;
+        i.op = eOpCodePushConstant;
+        i.value = std::strtod(start, 0);
+        i.isInt = isInt;
+        i.function = 0;
+        i.nArgs = 0;
+        if ( isInt && !checkIntResult(i.value) ) {
+            return false;
+        }
+
+        return push(i, 1);
+    }
+
+    bool parseName()
+    {
+        const char* start = _s;
+
+        while ( std::isalnum( (unsigned char)*_s ) || (*_s == '_') ) {
+            ++_s;
+        }
+        std::string name(start, _s - start);
+        _e->_identifiers.push_back(name);
+
+        if ( accept("(") ) {
+            const FunctionDesc* desc = functions;
+            while ( desc->name && (name != desc->name) ) {
+                ++desc;
+            }
+            if (!desc->name) {
+                return false;
+            }
+            int nArgs = 0;
+            if ( !accept(")") ) {
+                do {
+                    if ( !parseExpr() ) {
+                        return false;
+                    }
+                    ++nArgs;
+                } while ( accept(",") );
+                if ( !accept(")") ) {
+                    return false;
+                }
+            }
+            if ( (nArgs < desc->minArgs) || ( (desc->maxArgs != -1) && (nArgs > desc->maxArgs) ) ) {
+                return false;
+            }
+            Instruction i;
+            i.op = eOpCodeCallFunction;
+            i.value = 0.;
+            i.isInt = false;
+            i.function = (int)desc->function;
+            i.nArgs = nArgs;
+
+            return push(i, 1 - nArgs);
+        }
+
+        // a '.' is an attribute access: this is not a plain number
+        skipSpaces();
+        if ( (*_s == '.') || (*_s == '[') ) {
+            return false;
+        }
+
+        if (name == "frame") {
+            return pushOp(eOpCodePushFrame, 1);
+        } else if (name == "view") {
+            return pushOp(eOpCodePushView, 1);
+        } else if (name == "dimension") {
+            return pushOp(eOpCodePushDimension, 1);
+        } else if ( (name == "pi") || (name == "e") ) {
+            Instruction i;
+            i.op = eOpCodePushConstant;
+            i.value = (name == "pi") ? M_PI : M_E;
+            i.isInt = false;
+            i.function = 0;
+            i.nArgs = 0;
+
+            return push(i, 1);
+        }
+
+        return false;
+    } // parseName
+
+    const char* _s;
+    NumericExpression* _e;
+    int _depth;
+};
+
+NumericExpression::NumericExpression()
+    : _program()
+    , _identifiers()
+{
+}
+
+bool
+NumericExpression::compile(const std::string& expression)
+{
+    _program.clear();
+    _identifiers.clear();
+
+    // multi-line scripts assigning "ret" are not expressions
+    if ( expression.find_first_of("\n\r;=#") != std::string::npos ) {
+        return false;
+    }
+
+    Parser p(expression, this);
+    if ( !p.parse() ) {
+        _program.clear();
+        _identifiers.clear();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool
+NumericExpression::evaluate(double frame,
+                            int view,
+                            int dimension,
+                            double* result,
+                            bool* isInt) const
+{
+    if ( _program.empty() ) {
+        return false;
+    }
+
+    // The Python function receives the frame formatted by a std::stringstream (see KnobHelper::executeExpression):
+    // use the same value, and its type (an integral time is passed as an int)
+    Value frameValue;
+    {
+        std::stringstream ss;
+        ss << frame;
+        std::string str = ss.str();
+        if ( !isFinite(frame) ) {
+            return false; // nan or inf: not a valid Python literal
+        }
+        ss >> frameValue.v;
+        frameValue.isInt = str.find_first_of(".e") == std::string::npos;
+    }
+
+    Value stack[NATRON_NUMERIC_EXPRESSION_MAX_STACK];
+    int top = 0; // number of values on the stack
+
+    for (std::vector<Instruction>::const_iterator it = _program.begin(); it != _program.end(); ++it) {
+        switch (it->op) {
+        case eOpCodePushConstant:
+            stack[top].v = it->value;
+            stack[top].isInt = it->isInt;
+            ++top;
+            break;
+        case eOpCodePushFrame:
+            stack[top] = frameValue;
+            ++top;
+            break;
+        case eOpCodePushView:
+            stack[top].v = view;
+            stack[top].isInt = true;
+            ++top;
+            break;
+        case eOpCodePushDimension:
+            stack[top].v = dimension;
+            stack[top].isInt = true;
+            ++top;
+            break;
+        case eOpCodeNegate:
+            stack[top - 1].v = -stack[top - 1].v;
+            break;
+        case eOpCodeCallFunction: {
+            Value* args = &stack[top - it->nArgs];
+            Value ret;
+            if ( !callFunction( (FunctionEnum)it->function, args, it->nArgs, &ret ) ) {
+                return false;
+            }
+            top -= it->nArgs;
+            stack[top] = ret;
+            ++top;
+            break;
+        }
+        default: {
+            // binary operators
+            assert(top >= 2);
+            const Value a = stack[top - 2];
+            const Value b = stack[top - 1];
+            Value& r = stack[top - 2];
+            --top;
+            r.isInt = a.isInt && b.isInt;
+            switch (it->op) {
+            case eOpCodeAdd:
+                r.v = a.v + b.v;
+                break;
+            case eOpCodeSubtract:
+                r.v = a.v - b.v;
+                break;
+            case eOpCodeMultiply:
+                r.v = a.v * b.v;
+                break;
+            case eOpCodeDivide:
+                if (b.v == 0.) {
+                    return false; // ZeroDivisionError
+                }
+#if PY_MAJOR_VERSION >= 3
+                r.isInt = false;
+                r.v = a.v / b.v;
+#else
+                r.v = r.isInt ? std::floor(a.v / b.v) : a.v / b.v;
+#endif
+                break;
+            case eOpCodeFloorDivide:
+                if (b.v == 0.) {
+                    return false;
+                }
+                r.v = std::floor(a.v / b.v);
+                break;
+            case eOpCodeModulo:
+                if (b.v == 0.) {
+                    return false;
+                }
+                // the result has the sign of the divisor
+                r.v = std::fmod(a.v, b.v);
+                if ( (r.v != 0.) && ( (r.v < 0.) != (b.v < 0.) ) ) {
+                    r.v += b.v;
+                }
+                break;
+            case eOpCodePower:
+                if ( (a.v == 0.) && (b.v < 0.) ) {
+                    return false; // ZeroDivisionError
+                }
+                if ( r.isInt && (b.v < 0.) ) {
+                    r.isInt = false; // int ** negative int is a float
+                } else if ( !r.isInt && (a.v < 0.) && ( b.v != std::floor(b.v) ) ) {
+                    return false; // ValueError (Python 2) or complex result (Python 3)
+                }
+                r.v = std::pow(a.v, b.v);
+                if ( !isFinite(r.v) && isFinite(a.v) && isFinite(b.v) ) {
+                    return false; // OverflowError
+                }
+                break;
+            default:
+                assert(false);
+
+                return false;
+            }
+            if ( r.isInt && !checkIntResult(r.v) ) {
+                return false;
+            }
+            break;
+        }
+        } // switch
+    }
+    assert(top == 1);
+
+    *result = stack[0].v;
+    *isInt = stack[0].isInt;
+
+    return true;
+} // NumericExpression::evaluate
+
+NATRON_NAMESPACE_EXIT
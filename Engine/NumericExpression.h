@@ -0,0 +1,108 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_NUMERICEXPRESSION_H
+#define NATRON_ENGINE_NUMERICEXPRESSION_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A single-line knob expression made only of numbers, arithmetic operators, the frame, view and dimension
+ * variables and functions of the Python math module, compiled to a small stack program.
+ * It evaluates without the Python interpreter (hence without the GIL) and is thread-safe once compiled.
+ * Operators follow the Python semantics of the interpreter Natron is built against (int/float results,
+ * floor division and modulo). Anything else (knob references, random, strings, comparisons...)
+ * fails to compile and the expression keeps going through Python.
+ **/
+class NumericExpression
+{
+public:
+
+    NumericExpression();
+
+    /**
+     * @brief Parses the expression. Returns false if it uses anything that is not supported.
+     **/
+    bool compile(const std::string& expression) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief The names (variables and functions) referenced by the compiled expression.
+     **/
+    const std::vector<std::string>& getIdentifiers() const
+    {
+        return _identifiers;
+    }
+
+    /**
+     * @brief Evaluates the expression. Returns false if Python would raise an exception (division by zero,
+     * math domain error, overflow...): the caller must then evaluate it with Python to report the error.
+     * @param isInt Set to true if Python would return an int object.
+     **/
+    bool evaluate(double frame, int view, int dimension, double* result, bool* isInt) const WARN_UNUSED_RETURN;
+
+private:
+
+    enum OpCodeEnum
+    {
+        eOpCodePushConstant = 0,
+        eOpCodePushFrame,
+        eOpCodePushView,
+        eOpCodePushDimension,
+        eOpCodeNegate,
+        eOpCodeAdd,
+        eOpCodeSubtract,
+        eOpCodeMultiply,
+        eOpCodeDivide,
+        eOpCodeFloorDivide,
+        eOpCodeModulo,
+        eOpCodePower,
+        eOpCodeCallFunction
+    };
+
+    struct Instruction
+    {
+        OpCodeEnum op;
+        double value; // eOpCodePushConstant
+        bool isInt; // eOpCodePushConstant
+        int function; // eOpCodeCallFunction
+        int nArgs; // eOpCodeCallFunction
+    };
+
+    class Parser;
+
+    std::vector<Instruction> _program;
+    std::vector<std::string> _identifiers;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_NUMERICEXPRESSION_H
@@ -46,6 +46,7 @@
 #include "Engine/DefaultShaders.h"
 #include "Engine/GPUContextPool.h"
 #include "Engine/GLShader.h"
+#include "Engine/Image.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -252,6 +253,13 @@ struct OSGLContextPrivate
     // One for enabled, one for disabled
     GLShaderPtr applyMaskMixShader[2];
     GLShaderPtr copyUnprocessedChannelsShader[16];
+    GLShaderPtr rotoShapeShader;
+
+    // Textures kept on the GPU, the most recently used at the back
+    mutable QMutex textureCacheMutex;
+    mutable std::list<ImagePtr> textureCache;
+    std::size_t textureCacheSize;
+    std::size_t textureCacheMaxSize;
 
     OSGLContextPrivate()
         : _platformContext()
@@ -269,6 +277,11 @@ struct OSGLContextPrivate
         , fillImageShader()
         , applyMaskMixShader()
         , copyUnprocessedChannelsShader()
+        , rotoShapeShader()
+        , textureCacheMutex()
+        , textureCache()
+        , textureCacheSize(0)
+        , textureCacheMaxSize(0)
     {
     }
 
@@ -302,6 +315,7 @@ OSGLContext::OSGLContext(const FramebufferConfig& pixelFormatAttrs,
 OSGLContext::~OSGLContext()
 {
     setContextCurrentNoRender();
+    clearTextureCache();
     if (_imp->pboID) {
         glDeleteBuffers(1, &_imp->pboID);
     }
@@ -310,6 +324,84 @@ OSGLContext::~OSGLContext()
     }
 }
 
+ImagePtr
+OSGLContext::getCachedTexture(const ImageKey& key,
+                              unsigned int mipMapLevel,
+                              const RectI& roi,
+                              ImageBitDepthEnum bitdepth,
+                              const ImagePlaneDesc& components) const
+{
+    QMutexLocker k(&_imp->textureCacheMutex);
+
+    // There are only a few textures in the cache: a linear search is fine
+    for (std::list<ImagePtr>::iterator it = _imp->textureCache.begin(); it != _imp->textureCache.end(); ++it) {
+        const ImagePtr& image = *it;
+        if ( (image->getKey() == key) &&
+             ( image->getMipMapLevel() == mipMapLevel) &&
+             ( image->getBitDepth() == bitdepth) &&
+             ( image->getComponents() == components) &&
+             image->getBounds().contains(roi) ) {
+            ImagePtr ret = image;
+            _imp->textureCache.splice(_imp->textureCache.end(), _imp->textureCache, it);
+
+            return ret;
+        }
+    }
+
+    return ImagePtr();
+}
+
+void
+OSGLContext::insertCachedTexture(const ImagePtr& image)
+{
+    assert(image && image->getStorageMode() == eStorageModeGLTex);
+    std::list<ImagePtr> evicted;
+    {
+        QMutexLocker k(&_imp->textureCacheMutex);
+        for (std::list<ImagePtr>::iterator it = _imp->textureCache.begin(); it != _imp->textureCache.end(); ++it) {
+            if (*it == image) {
+                _imp->textureCache.splice(_imp->textureCache.end(), _imp->textureCache, it);
+
+                return;
+            }
+        }
+        std::size_t size = image->size();
+        if ( size > _imp->textureCacheMaxSize ) {
+            return;
+        }
+        _imp->textureCache.push_back(image);
+        _imp->textureCacheSize += size;
+        while (_imp->textureCacheSize > _imp->textureCacheMaxSize) {
+            assert( !_imp->textureCache.empty() );
+            _imp->textureCacheSize -= _imp->textureCache.front()->size();
+            evicted.push_back( _imp->textureCache.front() );
+            _imp->textureCache.pop_front();
+        }
+    }
+    // The textures of evicted images are deleted here, with this context current, unless they are still in use by a render
+    evicted.clear();
+}
+
+void
+OSGLContext::clearTextureCache()
+{
+    std::list<ImagePtr> evicted;
+    {
+        QMutexLocker k(&_imp->textureCacheMutex);
+        evicted.swap(_imp->textureCache);
+        _imp->textureCacheSize = 0;
+    }
+}
+
+void
+OSGLContext::setTextureCacheMaxSize(std::size_t maxSize)
+{
+    QMutexLocker k(&_imp->textureCacheMutex);
+
+    // The cache only shrinks on the next insertion, when the context is current
+    _imp->textureCacheMaxSize = maxSize;
+}
+
 void
 OSGLContext::checkOpenGLVersion()
 {
@@ -595,6 +687,50 @@ OSGLContext::getOrCreateCopyUnprocessedChannelsShader(bool doR,
     return _imp->copyUnprocessedChannelsShader[index];
 } // OSGLContext::getOrCreateCopyUnprocessedChannelsShader
 
+GLShaderPtr
+OSGLContext::getOrCreateRotoShapeShader()
+{
+    if (_imp->rotoShapeShader) {
+        return _imp->rotoShapeShader;
+    }
+    _imp->rotoShapeShader = boost::make_shared<GLShader>();
+#ifdef DEBUG
+    std::string error;
+    bool ok = _imp->rotoShapeShader->addShader(GLShader::eShaderTypeFragment, rotoShape_FragmentShader, &error);
+    if (!ok) {
+        qDebug() << error.c_str();
+    }
+#else
+    bool ok = _imp->rotoShapeShader->addShader(GLShader::eShaderTypeFragment, rotoShape_FragmentShader, 0);
+#endif
+
+    assert(ok);
+#ifdef DEBUG
+    ok = _imp->rotoShapeShader->link(&error);
+    if (!ok) {
+        qDebug() << error.c_str();
+    }
+#else
+    ok = _imp->rotoShapeShader->link();
+#endif
+    assert(ok);
+    Q_UNUSED(ok);
+
+    return _imp->rotoShapeShader;
+}
+
+void
+OSGLContext::createDefaultShaders()
+{
+    getOrCreateFillShader();
+    getOrCreateMaskMixShader(false);
+    getOrCreateMaskMixShader(true);
+    for (int i = 0; i < 16; ++i) {
+        getOrCreateCopyUnprocessedChannelsShader( (i & 0x01) != 0, (i & 0x02) != 0, (i & 0x04) != 0, (i & 0x08) != 0 );
+    }
+    getOrCreateRotoShapeShader();
+}
+
 void
 OSGLContext::getGPUInfos(std::list<OpenGLRendererInfo>& renderers)
 {
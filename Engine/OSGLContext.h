@@ -70,6 +70,7 @@
 #include <boost/noncopyable.hpp>
 #endif
 
+#include "Global/GlobalDefines.h"
 #include "Engine/EngineFwd.h"
 #include "Global/GLIncludes.h"
 
@@ -186,6 +187,35 @@ public:
     GLShaderPtr getOrCreateMaskMixShader(bool maskEnabled);
     GLShaderPtr getOrCreateCopyUnprocessedChannelsShader(bool doR, bool doG, bool doB, bool doA);
 
+    /**
+     * @brief Returns the shader used to rasterize Roto shapes and their feather, see RotoContextPrivate::renderBezier_gl
+     * Note: this context must be made current before calling this function
+     **/
+    GLShaderPtr getOrCreateRotoShapeShader();
+
+    /**
+     * @brief Builds all the shaders above so that the renders using this context do not have to.
+     * Note: this context must be made current before calling this function
+     **/
+    void createDefaultShaders();
+
+    /**
+     * @brief Textures rendered or uploaded with this context are kept in a small LRU so that GPU renders
+     * of the same images do not go through RAM again. Its size is bounded by setTextureCacheMaxSize().
+     * getCachedTexture returns a texture of the image with the given key, mipmap level, components and bitdepth
+     * whose bounds contain the roi, or NULL.
+     * Note: this context must be current when calling insertCachedTexture() and clearTextureCache()
+     * since they may release textures.
+     **/
+    ImagePtr getCachedTexture(const ImageKey& key,
+                              unsigned int mipMapLevel,
+                              const RectI& roi,
+                              ImageBitDepthEnum bitdepth,
+                              const ImagePlaneDesc& components) const;
+    void insertCachedTexture(const ImagePtr& image);
+    void clearTextureCache();
+    void setTextureCacheMaxSize(std::size_t maxSize);
+
     /**
      * @brief Same as setContextCurrent() except that it should be used to bind the context to perform NON-RENDER operations!
      **/
@@ -267,6 +297,11 @@ public:
         }
     }
 
+    const OSGLContextPtr& getContext() const
+    {
+        return _c;
+    }
+
     void dettach()
     {
 
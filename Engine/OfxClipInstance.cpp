@@ -841,6 +841,82 @@ OfxClipInstance::getInputImageInternal(const OfxTime time,
     int inputnb = getInputNb();
     const std::string& thisClipComponents = getComponents();
 
+    unsigned int mipMapLevel = 0;
+    // Get mipmaplevel and view from the TLS
+#ifdef DEBUG
+    if ( !tls || tls->view.empty() ) {
+        if ( QThread::currentThread() != qApp->thread() ) {
+            qDebug() << effect->getNode()->getScriptName_mt_safe().c_str() << " is trying to call clipGetImage on a thread "
+                "not controlled by Natron (probably from the multi-thread suite).\n If you're a developer of that plug-in, please "
+                "fix it. Natron is now going to try to recover from that mistake but doing so can yield unpredictable results.";
+        }
+    }
+#endif
+    assert( !viewParam.isAll() );
+    ViewIdx view;
+    if (tls) {
+        if ( viewParam.isCurrent() ) {
+            if ( tls->view.empty() ) {
+                view = ViewIdx(0);
+            } else {
+                view = tls->view.back();
+            }
+        } else {
+            view = ViewIdx( viewParam.value() );
+        }
+
+        if ( tls->mipMapLevel.empty() ) {
+            mipMapLevel = 0;
+        } else {
+            mipMapLevel = tls->mipMapLevel.back();
+        }
+    } else {
+        if ( viewParam.isCurrent() ) {
+            // no TLS
+            view = ViewIdx(0);
+        } else {
+            view = ViewIdx( viewParam.value() );
+        }
+    }
+
+    //Check if the plug-in already fetched this image during the action
+    const std::string requestedPlane = ofxPlane ? *ofxPlane : std::string();
+    if (renderData) {
+        for (std::list<FetchedImage>::const_iterator it = renderData->fetchedImages.begin(); it != renderData->fetchedImages.end(); ++it) {
+            if ( (it->time != time) || (it->view != view) || (it->plane != requestedPlane) || (it->isTexture != (retTexture != 0)) ) {
+                continue;
+            }
+            if ( retTexture && ( it->textureDepth != (textureDepth ? *textureDepth : eImageBitDepthNone) ) ) {
+                continue;
+            }
+            if ( it->hasBounds != (optionalBounds != 0) ) {
+                continue;
+            }
+            if ( optionalBounds && ( (it->bounds.x1 != optionalBounds->x1) || (it->bounds.y1 != optionalBounds->y1) ||
+                                     (it->bounds.x2 != optionalBounds->x2) || (it->bounds.y2 != optionalBounds->y2) ) ) {
+                continue;
+            }
+            if (retImage) {
+                OfxImage* isImage = dynamic_cast<OfxImage*>(it->image);
+                if (isImage) {
+                    *retImage = isImage;
+                    isImage->addReference();
+
+                    return true;
+                }
+            } else {
+                OfxTexture* isTex = dynamic_cast<OfxTexture*>(it->image);
+                if (isTex) {
+                    *retTexture = isTex;
+                    isTex->addReference();
+
+                    return true;
+                }
+            }
+        }
+    }
+
+
     //If components param is not set (i.e: the plug-in uses regular clipGetImage call) then figure out the plane from the TLS set in OfxEffectInstance::render
     //otherwise use the param sent by the plug-in call of clipGetImagePlane
 
@@ -900,44 +976,6 @@ OfxClipInstance::getInputImageInternal(const OfxTime time,
     }
 
 
-    unsigned int mipMapLevel = 0;
-    // Get mipmaplevel and view from the TLS
-#ifdef DEBUG
-    if ( !tls || tls->view.empty() ) {
-        if ( QThread::currentThread() != qApp->thread() ) {
-            qDebug() << effect->getNode()->getScriptName_mt_safe().c_str() << " is trying to call clipGetImage on a thread "
-                "not controlled by Natron (probably from the multi-thread suite).\n If you're a developer of that plug-in, please "
-                "fix it. Natron is now going to try to recover from that mistake but doing so can yield unpredictable results.";
-        }
-    }
-#endif
-    assert( !viewParam.isAll() );
-    ViewIdx view;
-    if (tls) {
-        if ( viewParam.isCurrent() ) {
-            if ( tls->view.empty() ) {
-                view = ViewIdx(0);
-            } else {
-                view = tls->view.back();
-            }
-        } else {
-            view = ViewIdx( viewParam.value() );
-        }
-
-        if ( tls->mipMapLevel.empty() ) {
-            mipMapLevel = 0;
-        } else {
-            mipMapLevel = tls->mipMapLevel.back();
-        }
-    } else {
-        if ( viewParam.isCurrent() ) {
-            // no TLS
-            view = ViewIdx(0);
-        } else {
-            view = ViewIdx( viewParam.value() );
-        }
-    }
-
     // If the plug-in is requesting the colour plane, it is expected that we return
     // an image mapped to the clip components
     const bool mapImageToClipPref = !ofxPlane || *ofxPlane == kFnOfxImagePlaneColour;
@@ -1030,17 +1068,35 @@ OfxClipInstance::getInputImageInternal(const OfxTime time,
 
     double par = getAspectRatio();
     OfxImageCommon* retCommon = 0;
+    OFX::Host::ImageEffect::ImageBase* retBase = 0;
     if (retImage) {
         OfxImage* ofxImage = new OfxImage(renderData, image, true, renderWindow, transform, components, nComps, par);
         *retImage = ofxImage;
         retCommon = ofxImage;
+        retBase = ofxImage;
     } else if (retTexture) {
         OfxTexture* ofxTex = new OfxTexture(renderData, image, true, renderWindow, transform, components, nComps, par);
         *retTexture = ofxTex;
         retCommon = ofxTex;
+        retBase = ofxTex;
     }
     if (renderData) {
         renderData->imagesBeingRendered.push_back(retCommon);
+
+        FetchedImage fetched;
+        fetched.time = time;
+        fetched.view = view;
+        fetched.plane = requestedPlane;
+        fetched.hasBounds = optionalBounds != 0;
+        if (optionalBounds) {
+            fetched.bounds = *optionalBounds;
+        }
+        fetched.isTexture = retTexture != 0;
+        fetched.textureDepth = textureDepth ? *textureDepth : eImageBitDepthNone;
+        fetched.image = retBase;
+        // Keep the image alive until the end of the action, see releaseFetchedImages()
+        retBase->addReference();
+        renderData->fetchedImages.push_back(fetched);
     }
 
     return true;
@@ -1400,6 +1456,8 @@ OfxImageCommon::OfxImageCommon(OFX::Host::ImageEffect::ImageBase* ofxImageBase,
         // To circumvent this, we copy the source image into a local temporary buffer only used by the plug-in which is released
         // when this OfxImage is destroyed. By default this local copy is deactivated, to activate it, the user has to go
         // in the preferences and check "Use input image copy for plug-ins rendering"
+        // Images that are not cached are not private either: they are shared by all the tiles of the render and by the
+        // other nodes reading them, so they are copied as well.
         const bool copySrcToPluginLocalData = appPTR->isCopyInputImageForPluginRenderEnabled();
         NATRON_NAMESPACE::Image::ReadAccessPtr access( new NATRON_NAMESPACE::Image::ReadAccess( internalImage.get() ) );
 
@@ -1602,6 +1660,25 @@ OfxClipInstance::setClipTLS(ViewIdx view,
     tls->renderData.push_back(d);
 }
 
+/**
+ * @brief Drop the references held on the images fetched during the action that is ending.
+ **/
+static void
+releaseFetchedImages(const OfxClipInstance::RenderActionDataPtr& renderData)
+{
+    if (!renderData) {
+        return;
+    }
+    // Deleting an image removes it from renderData->imagesBeingRendered: take the list first
+    std::list<OfxClipInstance::FetchedImage> fetchedImages;
+    fetchedImages.swap(renderData->fetchedImages);
+    for (std::list<OfxClipInstance::FetchedImage>::iterator it = fetchedImages.begin(); it != fetchedImages.end(); ++it) {
+        if ( it->image->releaseReference() ) {
+            delete it->image;
+        }
+    }
+}
+
 void
 OfxClipInstance::invalidateClipTLS()
 {
@@ -1621,6 +1698,7 @@ OfxClipInstance::invalidateClipTLS()
     }
     assert( !tls->renderData.empty() );
     if ( !tls->renderData.empty() ) {
+        releaseFetchedImages( tls->renderData.back() );
         tls->renderData.pop_back();
     }
 }
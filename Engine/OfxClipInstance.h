@@ -236,6 +236,21 @@ public:
     static const std::string& natronsPremultToOfxPremult(ImagePremultiplicationEnum premult);
     static ImageFieldingOrderEnum ofxFieldingToNatronFielding(const std::string& fielding);
     static const std::string& natronsFieldingToOfxFielding(ImageFieldingOrderEnum fielding);
+    //An image fetched on an input clip during an action
+    struct FetchedImage
+    {
+        double time;
+        ViewIdx view;
+        //Empty if the plug-in did not ask for a specific plane (regular clipGetImage call)
+        std::string plane;
+        bool hasBounds;
+        OfxRectD bounds;
+        bool isTexture;
+        ImageBitDepthEnum textureDepth;
+        //We hold a reference on it until the end of the action
+        OFX::Host::ImageEffect::ImageBase* image;
+    };
+
     struct RenderActionData
     {
         //We keep track of the images being rendered (on the output clip) so that we return the same pointer
@@ -245,9 +260,23 @@ public:
         //Used to determine the plane to render in a call to getOutputImageInternal()
         ImagePlaneDesc clipComponents;
 
+        //The images fetched on this clip during the action: fetching the same image again (e.g: temporal plug-ins
+        //fetching the same neighbour frames in each pass) returns the same OfxImage without going through
+        //EffectInstance::getImage and the conversion again, even if the plug-in released it in between.
+        std::list<FetchedImage> fetchedImages;
+
         RenderActionData()
             : imagesBeingRendered()
             , clipComponents()
+            , fetchedImages()
+        {
+        }
+
+        //The references held by fetchedImages belong to the action that fetched them, do not share them
+        RenderActionData(const RenderActionData& other)
+            : imagesBeingRendered(other.imagesBeingRendered)
+            , clipComponents(other.clipComponents)
+            , fetchedImages()
         {
         }
     };
@@ -65,6 +65,7 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/OfxParamInstance.h"
 #include "Engine/Project.h"
 #include "Engine/ReadNode.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/RotoLayer.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Transform.h"
@@ -1392,6 +1393,7 @@ OfxEffectInstance::getRegionOfDefinition(U64 /*hash*/,
     if (!_imp->initialized) {
         return eStatusFailed;
     }
+    RenderTraceScope traceScope("ofx", "getRegionOfDefinition", this);
 
     assert(_imp->effect);
 
@@ -1809,6 +1811,8 @@ OfxEffectInstance::isIdentity(double time,
                               ViewIdx* inputView,
                               int* inputNb)
 {
+    RenderTraceScope traceScope("ofx", "isIdentity", this);
+
     *inputView = view;
     if (!_imp->created) {
         *inputNb = -1;
@@ -2026,6 +2030,7 @@ OfxEffectInstance::render(const RenderActionArgs& args)
     if (!_imp->initialized) {
         return eStatusFailed;
     }
+    RenderTraceScope traceScope("ofx", "render", this);
 
     assert( !args.outputPlanes.empty() );
 
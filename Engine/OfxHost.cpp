@@ -29,6 +29,7 @@
 #include <cstdarg>
 #include <memory>
 #include <fstream>
+#include <map>
 #include <new> // std::bad_alloc
 #include <stdexcept> // std::exception
 #include <cctype> // tolower
@@ -106,10 +107,12 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/OfxMemory.h"
 #include "Engine/Plugin.h"
 #include "Engine/Project.h"
+#include "Engine/RenderStats.h"
 #include "Engine/Settings.h"
 #include "Engine/StandardPaths.h"
 #include "Engine/TLSHolder.h"
 #include "Engine/ThreadPool.h"
+#include "Engine/Timer.h"
 
 //An effect may not use more than this amount of threads
 #define NATRON_MULTI_THREAD_SUITE_MAX_NUM_CPU 4
@@ -160,6 +163,11 @@ struct OfxHostPrivate
     int loadingPluginVersionMajor;
     int loadingPluginVersionMinor;
 
+    // How the multi-thread suite calls of each plug-in ID scaled, loaded from the settings on first use
+    QMutex threadScalingMutex;
+    bool threadScalingLoaded; // protected by threadScalingMutex
+    std::map<std::string, ThreadScalingHistory> threadScaling; // protected by threadScalingMutex
+
     OfxHostPrivate()
         : imageEffectPluginCache()
         , tlsData( new TLSHolder<OfxHost::OfxHostTLSData>() )
@@ -170,7 +178,25 @@ struct OfxHostPrivate
         , loadingPluginID()
         , loadingPluginVersionMajor(0)
         , loadingPluginVersionMinor(0)
+        , threadScalingMutex()
+        , threadScalingLoaded(false)
+        , threadScaling()
+    {
+    }
+
+    ThreadScalingHistory& getThreadScalingHistory(const std::string& pluginID)
     {
+        assert( !threadScalingMutex.tryLock() );
+        if (!threadScalingLoaded) {
+            threadScalingLoaded = true;
+            std::map<std::string, std::string> histories;
+            appPTR->getCurrentSettings()->getThreadScalingHistories(&histories);
+            for (std::map<std::string, std::string>::iterator it = histories.begin(); it != histories.end(); ++it) {
+                threadScaling[it->first].fromString(it->second);
+            }
+        }
+
+        return threadScaling[pluginID];
     }
 };
 
@@ -196,6 +222,37 @@ OfxHost::getTLSData() const
     return _imp->tlsData->getOrCreateTLSData();
 }
 
+void
+OfxHost::addThreadScalingCall(const std::string& pluginID,
+                              unsigned int nThreadsUsed,
+                              double timeSpent,
+                              U64 nPixels)
+{
+    QMutexLocker k(&_imp->threadScalingMutex);
+
+    _imp->getThreadScalingHistory(pluginID).addCall(nThreadsUsed, timeSpent, nPixels);
+}
+
+void
+OfxHost::saveThreadScalingHistories()
+{
+    std::map<std::string, std::string> histories;
+    {
+        QMutexLocker k(&_imp->threadScalingMutex);
+        if (!_imp->threadScalingLoaded) {
+            // Nothing was recorded during this session
+            return;
+        }
+        for (std::map<std::string, ThreadScalingHistory>::iterator it = _imp->threadScaling.begin(); it != _imp->threadScaling.end(); ++it) {
+            std::string history = it->second.toString();
+            if ( !history.empty() ) {
+                histories[it->first] = history;
+            }
+        }
+    }
+    appPTR->getCurrentSettings()->saveThreadScalingHistories(histories);
+}
+
 void
 OfxHost::setOfxHostOSHandle(void* handle)
 {
@@ -1309,6 +1366,69 @@ private:
     OfxStatus *_stat;
 };
 
+/**
+ * @brief Records how many threads ran a multiThread call concurrently and how long it took: in the render stats of
+ * the calling effect when its render is profiled, and in the ThreadScalingHistory of its plug-in when the threads
+ * per effect are autotuned.
+ **/
+class MultiThreadStatsRecorder_RAII
+{
+    RenderStatsPtr _stats;
+    NodePtr _node;
+    std::string _pluginID;
+    U64 _nPixels;
+    unsigned int _nThreadsUsed;
+    TimeLapse _timer;
+
+public:
+
+    MultiThreadStatsRecorder_RAII(unsigned int nThreadsUsed)
+        : _stats()
+        , _node()
+        , _pluginID()
+        , _nPixels(0)
+        , _nThreadsUsed(nThreadsUsed)
+        , _timer()
+    {
+        OfxHost::OfxHostDataTLSPtr tls = appPTR->getOFXHost()->getTLSData();
+
+        if ( !tls || !tls->lastEffectCallingMainEntry ) {
+            return;
+        }
+        OfxEffectInstancePtr effect = tls->lastEffectCallingMainEntry->getOfxEffectInstance();
+        if (!effect) {
+            return;
+        }
+        ParallelRenderArgsPtr frameArgs = effect->getParallelRenderArgsTLS();
+        if ( frameArgs && frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
+            _stats = frameArgs->stats;
+            _node = effect->getNode();
+        }
+        if ( appPTR->getCurrentSettings()->isThreadsPerEffectAutotuned() ) {
+            // Only the calls made by the render action can be compared, using the size of its render window
+            std::map<ImagePlaneDesc, EffectInstance::PlaneToRender> planes;
+            ImagePlaneDesc planeBeingRendered;
+            RectI renderWindow;
+            if ( effect->getThreadLocalRenderedPlanes(&planes, &planeBeingRendered, &renderWindow) ) {
+                _pluginID = effect->getPluginID();
+                _nPixels = renderWindow.area();
+            }
+        }
+    }
+
+    ~MultiThreadStatsRecorder_RAII()
+    {
+        double timeSpent = _timer.getTimeSinceCreation();
+
+        if (_stats && _node) {
+            _stats->addMultiThreadInfosForNode(_node, _nThreadsUsed, timeSpent);
+        }
+        if ( !_pluginID.empty() ) {
+            appPTR->getOFXHost()->addThreadScalingCall(_pluginID, _nThreadsUsed, timeSpent, _nPixels);
+        }
+    }
+};
+
 NATRON_NAMESPACE_ANONYMOUS_EXIT
 
 
@@ -1339,7 +1459,10 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
     // "nThreads can be more than the value returned by multiThreadNumCPUs, however
     // the threads will be limited to the number of CPUs returned by multiThreadNumCPUs."
 
-    if ( (nThreads == 1) || (maxConcurrentThread <= 1) || (appPTR->getCurrentSettings()->getNumberOfThreads() == -1) ) {
+    bool runSequentially = (nThreads == 1) || (maxConcurrentThread <= 1) || (appPTR->getCurrentSettings()->getNumberOfThreads() == -1);
+    MultiThreadStatsRecorder_RAII statsRecorder( runSequentially ? 1 : std::min(nThreads, maxConcurrentThread) );
+
+    if (runSequentially) {
         try {
             for (unsigned int i = 0; i < nThreads; ++i) {
                 func(i, nThreads, customArg);
@@ -1355,18 +1478,26 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
     bool useThreadPool = appPTR->getUseThreadPool();
 
     if (useThreadPool) {
-        std::vector<unsigned int> threadIndexes(nThreads);
-        for (unsigned int i = 0; i < nThreads; ++i) {
-            threadIndexes[i] = i;
+        ///The spawner thread runs the first index itself rather than just waiting: queue the others only
+        std::vector<unsigned int> threadIndexes(nThreads - 1);
+        for (unsigned int i = 1; i < nThreads; ++i) {
+            threadIndexes[i - 1] = i;
         }
 
         /// DON'T set the maximum thread count, this is a global application setting, and see the documentation excerpt above
         //QThreadPool::globalInstance()->setMaxThreadCount(nThreads);
         QFuture<OfxStatus> future = QtConcurrent::mapped( threadIndexes, boost::bind(threadFunctionWrapper, func, _1, nThreads, spawnerThread, customArg) );
-        future.waitForFinished();
+        OfxStatus spawnerStat = threadFunctionWrapper(func, 0, nThreads, spawnerThread, customArg);
+        {
+            ThreadPoolWaitScope waitScope(spawnerThread);
+            future.waitForFinished();
+        }
         ///DON'T reset back to the original value the maximum thread count
         //QThreadPool::globalInstance()->setMaxThreadCount(QThread::idealThreadCount());
 
+        if (spawnerStat != kOfxStatOK) {
+            return spawnerStat;
+        }
         for (QFuture<OfxStatus>::const_iterator it = future.begin(); it != future.end(); ++it) {
             OfxStatus stat = *it;
             if (stat != kOfxStatOK) {
@@ -1471,6 +1602,16 @@ OfxHost::multiThreadNumCPUS(unsigned int *nCPUs) const
                } else {
                 nThreadsPerEffect = NATRON_MULTI_THREAD_SUITE_MAX_NUM_CPU;
                }*/
+
+            ///Leave to the other renders the threads that did not speed up the previous calls of the plug-in
+            OfxHostDataTLSPtr tls = _imp->tlsData->getOrCreateTLSData();
+            if ( tls->lastEffectCallingMainEntry && appPTR->getCurrentSettings()->isThreadsPerEffectAutotuned() ) {
+                OfxEffectInstancePtr effect = tls->lastEffectCallingMainEntry->getOfxEffectInstance();
+                if (effect) {
+                    QMutexLocker k(&_imp->threadScalingMutex);
+                    nThreadsPerEffect = (int)_imp->getThreadScalingHistory( effect->getPluginID() ).getBestThreadCount(nThreadsPerEffect);
+                }
+            }
         }
         ///+1 because the current thread is going to wait during the multiThread call so we're better off
         ///not counting it.
@@ -29,6 +29,7 @@
 #include "Global/Macros.h"
 
 #include <list>
+#include <string>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
@@ -48,6 +49,7 @@ CLANG_DIAG_OFF(tautological-undefined-compare) // appeared in clang 3.5
 CLANG_DIAG_ON(tautological-undefined-compare)
 CLANG_DIAG_ON(unknown-pragmas)
 
+#include "Global/GlobalDefines.h"
 #include "Global/Enums.h"
 #include "Engine/EngineFwd.h"
 #include "Engine/Plugin.h"
@@ -190,6 +192,16 @@ public:
 
     OfxHostDataTLSPtr getTLSData() const;
 
+    /**
+     * @brief Records in the ThreadScalingHistory of the plug-in a multi-thread suite call made while rendering nPixels.
+     **/
+    void addThreadScalingCall(const std::string& pluginID, unsigned int nThreadsUsed, double timeSpent, U64 nPixels);
+
+    /**
+     * @brief Writes the ThreadScalingHistory of the plug-ins to the settings, so that the next sessions start from it.
+     **/
+    void saveThreadScalingHistories();
+
 private:
 
     /*Writes all plugins loaded and their descriptors to
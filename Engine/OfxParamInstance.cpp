@@ -1232,6 +1232,7 @@ OfxBooleanInstance::OfxBooleanInstance(const OfxEffectInstancePtr& node,
                                        OFX::Host::Param::Descriptor & descriptor)
     : OfxParamToKnob(node)
     , OFX::Host::Param::BooleanInstance( descriptor, node->effectInstance() )
+    , _processChannelIndex(-1)
 {
     const OFX::Host::Property::Set &properties = getProperties();
     KnobBoolPtr b = checkIfKnobExistsWithNameOrCreate<KnobBool>(descriptor.getName(), this, 1);
@@ -1241,6 +1242,37 @@ OfxBooleanInstance::OfxBooleanInstance(const OfxEffectInstancePtr& node,
     b->blockValueChanges();
     b->setDefaultValue( (bool)def, 0 );
     b->unblockValueChanges();
+
+    static const std::string channelNames[4] = {kNatronOfxParamProcessR, kNatronOfxParamProcessG, kNatronOfxParamProcessB, kNatronOfxParamProcessA};
+    for (int i = 0; i < 4; ++i) {
+        if (descriptor.getName() == channelNames[i]) {
+            _processChannelIndex = i;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief When the host channel selector is used, the plug-in reads the channels to process from its params:
+ * during the render action of a render where only some channels are requested downstream, report the other ones as unchecked.
+ **/
+void
+OfxBooleanInstance::restrictProcessChannelForRender(bool* b) const
+{
+    if ( (_processChannelIndex == -1) || !*b ) {
+        return;
+    }
+    EffectInstancePtr effect = getKnobHolder();
+    if ( !effect || !effect->getNode() ) {
+        return;
+    }
+    std::bitset<4> processChannels;
+    for (int i = 0; i < 4; ++i) {
+        processChannels[i] = effect->getNode()->getProcessChannel(i);
+    }
+    if ( effect->restrictProcessChannelsForCurrentRender(&processChannels, true) ) {
+        *b = processChannels[_processChannelIndex];
+    }
 }
 
 OfxStatus
@@ -1249,6 +1281,7 @@ OfxBooleanInstance::get(bool & b)
     KnobBoolPtr knob = _knob.lock();
 
     b = knob->getValue();
+    restrictProcessChannelForRender(&b);
 
     return kOfxStatOK;
 }
@@ -1260,6 +1293,7 @@ OfxBooleanInstance::get(OfxTime time,
     assert( KnobBool::canAnimateStatic() );
     KnobBoolPtr knob = _knob.lock();
     b = knob->getValueAtTime(time);
+    restrictProcessChannelForRender(&b);
 
     return kOfxStatOK;
 }
@@ -382,7 +382,12 @@ private:
 
     virtual bool hasDoubleMinMaxProps() const OVERRIDE FINAL { return false; }
 
+    void restrictProcessChannelForRender(bool* b) const;
+
     KnobBoolWPtr _knob;
+
+    // Index of the channel if this is one of the host channel selector "Process R/G/B/A" params, -1 otherwise
+    int _processChannelIndex;
 };
 
 class OfxChoiceInstance
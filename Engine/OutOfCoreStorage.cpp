@@ -0,0 +1,76 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "OutOfCoreStorage.h"
+
+#include <sstream> // stringstream
+
+#include <boost/atomic.hpp>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QString>
+
+#include "Engine/AppManager.h"
+#include "Engine/MemoryInfo.h"
+#include "Engine/Settings.h"
+
+NATRON_NAMESPACE_ENTER
+
+namespace OutOfCoreStorage {
+
+bool
+shouldAllocateOnDisk(std::size_t bytes)
+{
+    if ( (bytes < NATRON_OUT_OF_CORE_MIN_SIZE) || !appPTR ) {
+        return false;
+    }
+
+    // The images of the caches are evicted when the renders need memory: count them as available
+    std::size_t ramToKeepFree = getSystemTotalRAM() * appPTR->getCurrentSettings()->getUnreachableRamPercent();
+    std::size_t available = getAmountFreePhysicalRAM() + appPTR->getCachesTotalMemorySize();
+    available = available > ramToKeepFree ? available - ramToKeepFree : 0;
+
+    return bytes > available;
+}
+
+std::string
+getNewFilePath()
+{
+    static boost::atomic<U64> fileIndex(0);
+    QString dirPath = appPTR->getDiskCacheLocation() + QString::fromUtf8("/OutOfCore");
+
+    QDir().mkpath(dirPath);
+
+    // The process id keeps the files of several instances sharing the cache directory apart
+    std::stringstream ss;
+    ss << dirPath.toStdString() << '/' << QCoreApplication::applicationPid() << '_' << fileIndex.fetch_add(1) << "." NATRON_CACHE_FILE_EXT;
+
+    return ss.str();
+}
+
+} // namespace OutOfCoreStorage
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,63 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_OutOfCoreStorage_h
+#define Engine_OutOfCoreStorage_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <string>
+
+#include "Global/GlobalDefines.h"
+
+// Buffers smaller than this are always allocated in RAM, checking the free RAM is not worth it for them
+#define NATRON_OUT_OF_CORE_MIN_SIZE (64 * 1024 * 1024)
+
+NATRON_NAMESPACE_ENTER
+
+// Decides where the buffers of the images that do not fit in RAM are stored (e.g: a stitched panorama or a 16K plate
+// in float RGBA held by a few nodes). Such buffers are mapped from a temporary file of the disk cache directory instead:
+// the system then keeps in RAM only the pages being accessed and writes the others to the file, so that the render
+// completes instead of failing to allocate or making the whole system swap.
+
+namespace OutOfCoreStorage {
+
+/**
+ * @brief Returns true if a buffer of the given size should be mapped from a file rather than allocated in RAM,
+ * i.e: if it does not fit in the free RAM plus the RAM held by the caches, minus the RAM left to the system.
+ **/
+bool shouldAllocateOnDisk(std::size_t bytes);
+
+/**
+ * @brief Returns the path of a new file for an out-of-core buffer, in the disk cache directory.
+ **/
+std::string getNewFilePath();
+
+} // namespace OutOfCoreStorage
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_OutOfCoreStorage_h
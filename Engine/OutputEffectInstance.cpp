@@ -60,6 +60,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/Log.h"
+#include "Engine/MemoryInfo.h"
 #include "Engine/Node.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/OfxEffectInstance.h"
@@ -87,6 +88,8 @@ OutputEffectInstance::OutputEffectInstance(NodePtr node)
     : EffectInstance(node)
     , _outputEffectDataLock()
     , _renderSequenceRequests()
+    , _imagesPinnedForSequence()
+    , _sharedPassOutputs()
     , _engine()
 {
 }
@@ -95,6 +98,8 @@ OutputEffectInstance::OutputEffectInstance(const OutputEffectInstance& other)
 : EffectInstance(other)
 , _outputEffectDataLock()
 , _renderSequenceRequests()
+, _imagesPinnedForSequence()
+, _sharedPassOutputs()
 , _engine(other._engine)
 {
 }
@@ -349,13 +354,69 @@ OutputEffectInstance::createWriterPath()
     }
 }
 
+void
+OutputEffectInstance::pinImageForSequentialRender(const ImagePtr& image)
+{
+    QMutexLocker k(&_outputEffectDataLock);
+
+    if ( _renderSequenceRequests.empty() ) {
+        return;
+    }
+    for (std::list<ImagePtr>::iterator it = _imagesPinnedForSequence.begin(); it != _imagesPinnedForSequence.end(); ++it) {
+        if (*it == image) {
+            return;
+        }
+        if ( ( (*it)->getKey() == image->getKey() ) && ( (*it)->getComponents() == image->getComponents() ) &&
+             ( (*it)->getMipMapLevel() == image->getMipMapLevel() ) ) {
+            // The image was resized and swapped in the cache, do not hold the old one
+            *it = image;
+
+            return;
+        }
+    }
+    _imagesPinnedForSequence.push_back(image);
+}
+
+void
+OutputEffectInstance::setSharedPassOutputs(const std::list<OutputEffectInstancePtr>& outputs)
+{
+    QMutexLocker k(&_outputEffectDataLock);
+
+    _sharedPassOutputs.clear();
+    for (std::list<OutputEffectInstancePtr>::const_iterator it = outputs.begin(); it != outputs.end(); ++it) {
+        if (it->get() != this) {
+            _sharedPassOutputs.push_back(*it);
+        }
+    }
+}
+
+std::list<OutputEffectInstancePtr>
+OutputEffectInstance::getSharedPassOutputs() const
+{
+    std::list<OutputEffectInstancePtr> ret;
+    QMutexLocker k(&_outputEffectDataLock);
+
+    for (std::list<OutputEffectInstanceWPtr>::const_iterator it = _sharedPassOutputs.begin(); it != _sharedPassOutputs.end(); ++it) {
+        OutputEffectInstancePtr output = it->lock();
+        if (output) {
+            ret.push_back(output);
+        }
+    }
+
+    return ret;
+}
+
 void
 OutputEffectInstance::notifyRenderFinished()
 {
     RenderSequenceArgs newArgs;
+    std::list<ImagePtr> pinnedImages;
 
     {
         QMutexLocker k(&_outputEffectDataLock);
+        // Release the images outside of the lock since freeing them may be expensive
+        pinnedImages.swap(_imagesPinnedForSequence);
+        _sharedPassOutputs.clear();
         if ( !_renderSequenceRequests.empty() ) {
             const RenderSequenceArgs& args = _renderSequenceRequests.front();
             if (args.renderController) {
@@ -439,9 +500,37 @@ OutputEffectInstance::reportStats(int time,
     }
 
     ofile << "Time spent to render frame (wall clock time): " << Timer::printAsTime(wallTime, false).toStdString() << std::endl;
+
+    std::list<NodePtr> criticalPath;
+    RenderStats::computeCriticalPath(stats, &criticalPath);
+    if ( !criticalPath.empty() ) {
+        ofile << "Critical path: ";
+        for (std::list<NodePtr>::const_iterator it = criticalPath.begin(); it != criticalPath.end(); ++it) {
+            std::map<NodePtr, NodeRenderStats >::const_iterator found = stats.find(*it);
+            assert( found != stats.end() );
+            if ( it != criticalPath.begin() ) {
+                ofile << " -> ";
+            }
+            ofile << (*it)->getScriptName_mt_safe() << " (" << Timer::printAsTime(found->second.getTotalTimeSpentRendering(), false).toStdString() << ")";
+        }
+        ofile << std::endl;
+        for (std::list<NodePtr>::const_iterator it = criticalPath.begin(); it != criticalPath.end(); ++it) {
+            std::map<NodePtr, NodeRenderStats >::const_iterator found = stats.find(*it);
+            std::string reasons;
+            if ( found->second.isSerialBottleneck(&reasons) ) {
+                ofile << "Serial bottleneck on the critical path: " << (*it)->getScriptName_mt_safe() << ", " << reasons
+                      << ", " << Timer::printAsTime(found->second.getTotalTimeSpentRendering(), false).toStdString() << std::endl;
+            }
+        }
+    }
     for (std::map<NodePtr, NodeRenderStats >::const_iterator it = stats.begin(); it != stats.end(); ++it) {
         ofile << "------------------------------- " << it->first->getScriptName_mt_safe() << "------------------------------- " << std::endl;
         ofile << "Time spent rendering: " << Timer::printAsTime(it->second.getTotalTimeSpentRendering(), false).toStdString() << std::endl;
+        std::size_t cachedImagesBytes, temporaryImagesBytes;
+        it->second.getImagesMemoryAllocated(&cachedImagesBytes, &temporaryImagesBytes);
+        ofile << "Images allocated: " << printAsRAM(cachedImagesBytes).toStdString() << " cached, "
+              << printAsRAM(temporaryImagesBytes).toStdString() << " temporary" << std::endl;
+        ofile << "Plug-in memory peak: " << printAsRAM( it->second.getPluginMemoryHighWaterMark() ).toStdString() << std::endl;
         const RectD & rod = it->second.getRoD();
         ofile << "Region of definition: x1 = " << rod.x1  << " y1 = " << rod.y1 << " x2 = " << rod.x2 << " y2 = " << rod.y2 << std::endl;
         ofile << "Is Identity to Effect? ";
@@ -507,6 +596,15 @@ OutputEffectInstance::reportStats(int time,
         ofile << "Nb cache miss: " << nbCacheMiss << std::endl;
         ofile << "Nb cache hit requiring mipmap downscaling: " << nbCacheHitButDownscaled << std::endl;
 
+        int nbMultiThreadCalls;
+        double averageThreadsUsed, timeSpentMultiThreading;
+        it->second.getMultiThreadInfos(&nbMultiThreadCalls, &averageThreadsUsed, &timeSpentMultiThreading);
+        if (nbMultiThreadCalls > 0) {
+            ofile << "Nb multi-thread suite calls: " << nbMultiThreadCalls << std::endl;
+            ofile << "Average threads per multi-thread suite call: " << averageThreadsUsed << std::endl;
+            ofile << "Time spent in multi-thread suite calls: " << Timer::printAsTime(timeSpentMultiThreading, false).toStdString() << std::endl;
+        }
+
         const std::set<std::string> & planes = it->second.getPlanesRendered();
         ofile << "Plane(s) rendered: ";
         for (std::set<std::string>::const_iterator it2 = planes.begin(); it2 != planes.end(); ++it2) {
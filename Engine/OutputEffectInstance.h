@@ -67,6 +67,12 @@ private:
 
     mutable QMutex _outputEffectDataLock;
     std::list<RenderSequenceArgs> _renderSequenceRequests;
+
+    // Images of nodes upstream that are not frame varying, referenced until the sequence render finishes
+    std::list<ImagePtr> _imagesPinnedForSequence;
+
+    // Other writers rendered by the next sequence render of this node, see setSharedPassOutputs()
+    std::list<OutputEffectInstanceWPtr> _sharedPassOutputs;
     RenderEnginePtr _engine;
 
 public:
@@ -107,6 +113,23 @@ public:
 
     void notifyRenderFinished();
 
+    /**
+     * @brief Called by nodes upstream that are not frame varying when they produced a cached image while this node renders
+     * a sequence: the image is referenced until notifyRenderFinished() so that the cache cannot evict it and it is rendered
+     * only once for the whole sequence. Does nothing when no sequence is being rendered (e.g: viewer renders).
+     **/
+    void pinImageForSequentialRender(const ImagePtr& image);
+
+    /**
+     * @brief Other writers to render along with the next sequence render of this node: each frame is requested once by the
+     * scheduler of this node and rendered for all the writers in turn by the same render thread, so that the nodes they
+     * share upstream are rendered once and found in the cache by the next writers.
+     * The list is reset when the render finishes.
+     **/
+    void setSharedPassOutputs(const std::list<OutputEffectInstancePtr>& outputs);
+
+    std::list<OutputEffectInstancePtr> getSharedPassOutputs() const;
+
     void renderCurrentFrame(bool canAbort);
 
     void renderCurrentFrameWithRenderStats(bool canAbort);
@@ -30,6 +30,7 @@
 #include <list>
 #include <algorithm> // min, max
 #include <cassert>
+#include <climits> // INT_MAX
 #include <stdexcept>
 #include <sstream> // stringstream
 
@@ -42,6 +43,7 @@
 #include <QtCore/QCoreApplication>
 #include <QtCore/QString>
 #include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
 #include <QtCore/QDebug>
 #include <QtCore/QTextStream>
 #include <QtCore/QRunnable>
@@ -53,15 +55,21 @@
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
 #include "Engine/EffectInstance.h"
+#include "Engine/FrameEntry.h"
 #include "Engine/Image.h"
 #include "Engine/KnobFile.h"
+#include "Engine/MemoryInfo.h"
 #include "Engine/Node.h"
 #include "Engine/OpenGLViewerI.h"
 #include "Engine/GenericSchedulerThreadWatcher.h"
+#include "Engine/ParallelRenderArgs.h"
+#include "Engine/PerfCounters.h"
 #include "Engine/Project.h"
+#include "Engine/RenderRequestRecorder.h"
 #include "Engine/RenderStats.h"
 #include "Engine/RotoContext.h"
 #include "Engine/Settings.h"
+#include "Engine/ThreadPool.h"
 #include "Engine/Timer.h"
 #include "Engine/TimeLine.h"
 #include "Engine/TLSHolder.h"
@@ -91,6 +99,35 @@
 
 #define NATRON_SCHEDULER_ABORT_AFTER_X_UNSUCCESSFUL_ITERATIONS 5000
 
+/*
+   Fraction of the desired frame rate above which viewer playback is considered to keep up:
+   no more render threads are spawned as long as it is reached and frames are buffered ahead of the playhead.
+ */
+#define NATRON_SCHEDULER_PLAYBACK_FPS_TOLERANCE 0.95
+
+/*
+   Time in milliseconds without any new render request after a draft render of the viewer,
+   after which the interaction is considered paused and the frame is re-rendered at full quality.
+ */
+#define NATRON_VIEWER_DRAFT_REFINEMENT_DELAY_MS 150
+
+/*
+   Maximum number of mipmap levels below the viewer mipmap level at which frames are rendered
+   during playback to hold the requested frame rate.
+ */
+#define NATRON_PLAYBACK_MAX_DRAFT_LEVEL 3
+
+/*
+   Number of frames rendered at a playback draft level before the level may change again.
+ */
+#define NATRON_PLAYBACK_DRAFT_LEVEL_MIN_FRAMES 4
+
+/*
+   Time in milliseconds without any new render request on the viewer after which the user is considered idle
+   and the viewer cache starts being filled for the playback range, if enabled in the preferences.
+ */
+#define NATRON_VIEWER_CACHE_AHEAD_IDLE_DELAY_MS 2000
+
 NATRON_NAMESPACE_ENTER
 
 
@@ -243,6 +280,14 @@ struct OutputSchedulerThreadPrivate
     QMutex bufferedOutputMutex;
     int lastBufferedOutputSize;
 
+    // The largest memory estimate of a frame reported by the render threads since the render started
+    mutable QMutex framePeakMemoryMutex;
+    std::size_t framePeakMemory;
+
+    // The per-frame Python callbacks whose signature was already checked since the render started
+    mutable QMutex checkedFrameCallbacksMutex;
+    std::set<std::string> checkedFrameCallbacks;
+
 
     OutputSchedulerThreadPrivate(RenderEngine* engine,
                                  const OutputEffectInstancePtr& effect,
@@ -282,7 +327,38 @@ struct OutputSchedulerThreadPrivate
 #endif
         , bufferedOutputMutex()
         , lastBufferedOutputSize(0)
+        , framePeakMemoryMutex()
+        , framePeakMemory(0)
+        , checkedFrameCallbacksMutex()
+        , checkedFrameCallbacks()
+    {
+    }
+
+    /**
+     * @brief Returns how many frames whose memory estimate is framePeakMemory may be rendered concurrently
+     * without making the system swap, or INT_MAX if no estimate was reported yet.
+     * currentParallelRenders is the number of frames currently rendering, whose memory is no longer free.
+     **/
+    int getMaxParallelRendersForMemory(int currentParallelRenders) const
     {
+        std::size_t estimate;
+        {
+            QMutexLocker k(&framePeakMemoryMutex);
+            estimate = framePeakMemory;
+        }
+        if (estimate == 0) {
+            return INT_MAX;
+        }
+
+        // The images of the node cache are evicted when the renders need memory: count them as available
+        std::size_t ramToKeepFree = getSystemTotalRAM() * appPTR->getCurrentSettings()->getUnreachableRamPercent();
+        std::size_t available = getAmountFreePhysicalRAM() + appPTR->getCachesTotalMemorySize();
+        available = available > ramToKeepFree ? available - ramToKeepFree : 0;
+
+        // The frames already rendering hold their memory: it is not free anymore but is theirs to use
+        available += (std::size_t)std::max(0, currentParallelRenders) * estimate;
+
+        return (int)std::min( (std::size_t)INT_MAX, available / estimate );
     }
 
     void appendBufferedFrame(double time,
@@ -308,6 +384,16 @@ struct OutputSchedulerThreadPrivate
         buf.insert( std::make_pair(key, value) );
     }
 
+    bool hasBufferedFrame(double time) const
+    {
+        ///Private, shouldn't lock
+        assert( !bufMutex.tryLock() );
+        BufferedFrameKey key;
+        key.time = time;
+
+        return buf.find(key) != buf.end();
+    }
+
     struct ViewUniqueIDPair
     {
         int view;
@@ -385,7 +471,8 @@ struct OutputSchedulerThreadPrivate
         }
     }
 
-    void appendRunnable(RenderThreadTask* runnable)
+    void appendRunnable(RenderThreadTask* runnable,
+                        bool isOutputInteractive)
     {
         assert( !renderThreadsMutex.tryLock() );
         RenderThread r;
@@ -393,9 +480,9 @@ struct OutputSchedulerThreadPrivate
         r.active = true;
         renderThreads.push_back(r);
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
-        runnable->start();
+        runnable->start(isOutputInteractive ? QThread::InheritPriority : QThread::LowPriority);
 #else
-        threadPool->start(runnable);
+        threadPool->start(runnable, isOutputInteractive ? eThreadPoolPriorityDefault : eThreadPoolPriorityBackground);
 #endif
     }
 
@@ -954,7 +1041,7 @@ OutputSchedulerThread::startTasks(int startingFrame)
     PlaybackModeEnum pMode = _imp->engine->getPlaybackMode();
     if (firstFrame == lastFrame) {
         RenderThreadTask* task = createRunnable(startingFrame, useStats, viewsToRender);
-        _imp->appendRunnable(task);
+        _imp->appendRunnable( task, isOutputInteractive() );
 
         QMutexLocker k(&_imp->framesToRenderMutex);
         _imp->lastFramePushedIndex = startingFrame;
@@ -963,7 +1050,7 @@ OutputSchedulerThread::startTasks(int startingFrame)
         RenderDirectionEnum newDirection = direction;
         for (int i = 0; i < nFrames; ++i) {
             RenderThreadTask* task = createRunnable(frame, useStats, viewsToRender);
-            _imp->appendRunnable(task);
+            _imp->appendRunnable( task, isOutputInteractive() );
 
 
             {
@@ -1031,11 +1118,22 @@ OutputSchedulerThread::startRender()
 {
     if ( isFPSRegulationNeeded() ) {
         _imp->timer.playState = ePlayStateRunning;
+        _imp->timer.restart();
     }
 
     // Start measuring
     _imp->renderTimer.reset(new TimeLapse);
 
+    {
+        QMutexLocker k(&_imp->framePeakMemoryMutex);
+        _imp->framePeakMemory = 0;
+    }
+    {
+        // The callbacks may have been edited since the last render
+        QMutexLocker k(&_imp->checkedFrameCallbacksMutex);
+        _imp->checkedFrameCallbacks.clear();
+    }
+
     ///We will push frame to renders starting at startingFrame.
     ///They will be in the range determined by firstFrame-lastFrame
     int startingFrame;
@@ -1195,6 +1293,13 @@ OutputSchedulerThread::stopRender()
 
     ///Notify everyone that the render is finished
     _imp->engine->s_renderFinished(wasAborted ? 1 : 0);
+    std::list<OutputEffectInstancePtr> sharedOutputs = getSharedOutputs();
+    for (std::list<OutputEffectInstancePtr>::const_iterator it = sharedOutputs.begin(); it != sharedOutputs.end(); ++it) {
+        RenderEnginePtr sharedEngine = (*it)->getRenderEngine();
+        if (sharedEngine) {
+            sharedEngine->s_renderFinished(wasAborted ? 1 : 0);
+        }
+    }
 
     onRenderStopped(wasAborted);
 
@@ -1442,8 +1547,17 @@ OutputSchedulerThread::threadLoopOnce(const GenericThreadStartArgsPtr &inArgs)
         if (!renderFinished) {
             assert(state == eThreadStateActive);
             QMutexLocker bufLocker (&_imp->bufMutex);
-            // Wait here for more frames to be rendered, we will be woken up once appendToBuffer(...) is called
-            _imp->bufEmptyCondition.wait(&_imp->bufMutex);
+            // appendToBuffer(...) only wakes us up for the expected frame: it may have been appended since the buffer
+            // was looked-up above, in which case its wake-up was lost and we must not wait for it
+            bool hasExpectedFrame;
+            {
+                QMutexLocker k(&_imp->framesToRenderMutex);
+                hasExpectedFrame = _imp->hasBufferedFrame(_imp->expectFrameToRender);
+            }
+            if (!hasExpectedFrame) {
+                // Wait here for more frames to be rendered, we will be woken up once appendToBuffer(...) is called
+                _imp->bufEmptyCondition.wait(&_imp->bufMutex);
+            }
         } else {
             if ( !_imp->engine->isPlaybackAutoRestartEnabled() ) {
                 //Move the timeline to the last rendered frame to keep it in sync with what is displayed
@@ -1529,13 +1643,49 @@ OutputSchedulerThread::adjustNumberOfThreads(int* newNThreads,
     }
     optimalNThreads = std::max(1, optimalNThreads);
 
+    ///Do not render more frames concurrently than the memory can hold: the system would start swapping
+    ///or kill the process. At least 1 frame is always rendered.
+    int memoryMaxNThreads = std::max( 1, _imp->getMaxParallelRendersForMemory(currentParallelRenders) );
+    if (memoryMaxNThreads < optimalNThreads) {
+        optimalNThreads = memoryMaxNThreads;
+        if (currentParallelRenders > optimalNThreads) {
+            stopRenderThreads(1);
+            *newNThreads = currentParallelRenders - 1;
+
+            return;
+        }
+    }
+
+    ///When the output is regulated at the desired FPS (playback in the viewer), use the measured frame rate
+    ///and the number of frames already rendered ahead of the playhead as a feedback: once playback keeps up,
+    ///more parallel renders would only hold more images in RAM and take cores from interactive renders.
+    if ( isFPSRegulationNeeded() && (currentParallelRenders > 0) ) {
+        double desiredFPS = _imp->timer.getDesiredFrameRate();
+        double actualFPS = _imp->timer.getActualFrameRate();
+        int nbBufferedFrames;
+        {
+            QMutexLocker k(&_imp->bufMutex);
+            nbBufferedFrames = (int)_imp->buf.size();
+        }
+        if ( (actualFPS >= desiredFPS * NATRON_SCHEDULER_PLAYBACK_FPS_TOLERANCE) && (nbBufferedFrames >= currentParallelRenders) ) {
+            if ( (currentParallelRenders > 1) && (nbBufferedFrames >= currentParallelRenders * 2) ) {
+                ///The renders are well ahead of the display, stop 1 thread
+                stopRenderThreads(1);
+                *newNThreads = currentParallelRenders - 1;
+            } else {
+                *newNThreads = currentParallelRenders;
+            }
+
+            return;
+        }
+    }
 
     if ( ( (runningThreads < optimalNThreads) && (currentParallelRenders < optimalNThreads) ) || (currentParallelRenders == 0) ) {
         ////////
         ///Launch 1 thread
         QMutexLocker l(&_imp->renderThreadsMutex);
 
-        _imp->appendRunnable( createRunnable() );
+        _imp->appendRunnable( createRunnable(), isOutputInteractive() );
         *newNThreads = currentParallelRenders +  1;
     } else if ( (runningThreads > optimalNThreads) && (currentParallelRenders > optimalNThreads) ) {
         ////////
@@ -1561,6 +1711,9 @@ OutputSchedulerThread::notifyFrameRendered(int frame,
     assert(viewsToRender.size() > 0);
 
     bool isLastView = viewIndex == viewsToRender[viewsToRender.size() - 1] || viewIndex == -1;
+    if (isLastView) {
+        PerfCounters::increment(ePerfCounterFramesRendered);
+    }
 
     // Report render stats if desired
     OutputEffectInstancePtr effect = _imp->outputEffect.lock();
@@ -1675,42 +1828,71 @@ OutputSchedulerThread::notifyFrameRendered(int frame,
             _imp->lastBufferedOutputSize = longMessage.size();
         }
 
-        appPTR->writeToOutputPipe(longMessage, shortMessage, false);
+        appPTR->writeFrameRenderedToOutputPipe(frame, fractionDone, shortMessage);
     }
 
+    // Writers sharing the render pass of this one have their own progress entry and callbacks
+    std::list<OutputEffectInstancePtr> sharedOutputs = getSharedOutputs();
+
     // Notify we rendered a frame
     if (isLastView) {
         _imp->engine->s_frameRendered(frame, fractionDone);
+        for (std::list<OutputEffectInstancePtr>::const_iterator it = sharedOutputs.begin(); it != sharedOutputs.end(); ++it) {
+            RenderEnginePtr sharedEngine = (*it)->getRenderEngine();
+            if (sharedEngine) {
+                sharedEngine->s_frameRendered(frame, fractionDone);
+            }
+        }
     }
 
     // Call Python after frame ranedered callback
-    if ( isLastView && effect->isWriter() ) {
+    if (isLastView) {
+        if ( !runAfterFrameRenderedCallback(effect, frame) ) {
+            return;
+        }
+        for (std::list<OutputEffectInstancePtr>::const_iterator it = sharedOutputs.begin(); it != sharedOutputs.end(); ++it) {
+            if ( !runAfterFrameRenderedCallback(*it, frame) ) {
+                return;
+            }
+        }
+    }
+} // OutputSchedulerThread::notifyFrameRendered
+
+bool
+OutputSchedulerThread::runAfterFrameRenderedCallback(const OutputEffectInstancePtr& effect,
+                                                     int frame)
+{
+    if ( effect->isWriter() ) {
         std::string cb = effect->getNode()->getAfterFrameRenderCallback();
         if ( !cb.empty() ) {
-            std::vector<std::string> args;
-            std::string error;
-            try {
-                NATRON_PYTHON_NAMESPACE::getFunctionArguments(cb, &error, &args);
-            } catch (const std::exception& e) {
-                effect->getApp()->appendToScriptEditor( std::string("Failed to get signature of onFrameRendered callback: ")
-                                                        + e.what() );
+            // The signature is checked only for the first frame of the render
+            if ( !isFrameCallbackSignatureChecked(cb) ) {
+                std::vector<std::string> args;
+                std::string error;
+                try {
+                    NATRON_PYTHON_NAMESPACE::getFunctionArguments(cb, &error, &args);
+                } catch (const std::exception& e) {
+                    effect->getApp()->appendToScriptEditor( std::string("Failed to get signature of onFrameRendered callback: ")
+                                                            + e.what() );
 
-                return;
-            }
+                    return false;
+                }
 
-            if ( !error.empty() ) {
-                effect->getApp()->appendToScriptEditor("Failed to get signature of onFrameRendered callback: " + error);
+                if ( !error.empty() ) {
+                    effect->getApp()->appendToScriptEditor("Failed to get signature of onFrameRendered callback: " + error);
 
-                return;
-            }
+                    return false;
+                }
 
-            std::string signatureError;
-            signatureError.append("The after frame render callback supports the following signature(s):\n");
-            signatureError.append("- callback(frame, thisNode, app)");
-            if ( (args.size() != 3) || (args[0] != "frame") || (args[1] != "thisNode") || (args[2] != "app") ) {
-                effect->getApp()->appendToScriptEditor("Wrong signature of onFrameRendered callback: " + signatureError);
+                std::string signatureError;
+                signatureError.append("The after frame render callback supports the following signature(s):\n");
+                signatureError.append("- callback(frame, thisNode, app)");
+                if ( (args.size() != 3) || (args[0] != "frame") || (args[1] != "thisNode") || (args[2] != "app") ) {
+                    effect->getApp()->appendToScriptEditor("Wrong signature of onFrameRendered callback: " + signatureError);
 
-                return;
+                    return false;
+                }
+                setFrameCallbackSignatureChecked(cb);
             }
 
             std::stringstream ss;
@@ -1724,11 +1906,13 @@ OutputSchedulerThread::notifyFrameRendered(int frame,
             } catch (const std::exception& e) {
                 notifyRenderFailure( e.what() );
 
-                return;
+                return false;
             }
         }
     }
-} // OutputSchedulerThread::notifyFrameRendered
+
+    return true;
+} // OutputSchedulerThread::runAfterFrameRenderedCallback
 
 void
 OutputSchedulerThread::appendToBuffer_internal(double time,
@@ -1753,6 +1937,13 @@ OutputSchedulerThread::appendToBuffer_internal(double time,
 
         QMutexLocker l(&_imp->bufMutex);
         _imp->appendBufferedFrame(time, view, stats, frame);
+        if (wakeThread && frame) {
+            ///The scheduler thread processes frames in order: it cannot do anything with a frame other than the one it expects,
+            ///so do not wake it up for nothing. It looks again at the buffer after each frame it processes.
+            ///The expected frame must be read after the frame is in the buffer, otherwise the scheduler could miss it.
+            QMutexLocker k(&_imp->framesToRenderMutex);
+            wakeThread = (int)time == _imp->expectFrameToRender;
+        }
         if (wakeThread) {
             ///Wake up the scheduler thread that an image is available if it is asleep so it can process it.
             _imp->bufEmptyCondition.wakeOne();
@@ -1804,6 +1995,12 @@ OutputSchedulerThread::getDesiredFPS() const
     return _imp->timer.getDesiredFrameRate();
 }
 
+int
+OutputSchedulerThread::getDroppedFramesCount() const
+{
+    return _imp->timer.getDroppedFramesCount();
+}
+
 void
 OutputSchedulerThread::getLastRunArgs(RenderDirectionEnum* direction,
                                       std::vector<ViewIdx>* viewsToRender) const
@@ -1866,6 +2063,14 @@ OutputSchedulerThread::renderFromCurrentFrame(bool enableRenderStats,
     startTask(args);
 }
 
+void
+OutputSchedulerThread::notifyFramePeakMemoryEstimate(std::size_t bytes)
+{
+    QMutexLocker k(&_imp->framePeakMemoryMutex);
+
+    _imp->framePeakMemory = std::max(_imp->framePeakMemory, bytes);
+}
+
 void
 OutputSchedulerThread::notifyRenderFailure(const std::string& errorMessage)
 {
@@ -1947,20 +2152,27 @@ OutputSchedulerThread::getEngine() const
     return _imp->engine;
 }
 
+bool
+OutputSchedulerThread::isFrameCallbackSignatureChecked(const std::string& callback) const
+{
+    QMutexLocker k(&_imp->checkedFrameCallbacksMutex);
+
+    return _imp->checkedFrameCallbacks.find(callback) != _imp->checkedFrameCallbacks.end();
+}
+
+void
+OutputSchedulerThread::setFrameCallbackSignatureChecked(const std::string& callback)
+{
+    QMutexLocker k(&_imp->checkedFrameCallbacksMutex);
+
+    _imp->checkedFrameCallbacks.insert(callback);
+}
+
 void
 OutputSchedulerThread::runCallbackWithVariables(const QString& callback)
 {
     if ( !callback.isEmpty() ) {
         OutputEffectInstancePtr effect = _imp->outputEffect.lock();
-        QString script = callback;
-        std::string appID = effect->getApp()->getAppIDString();
-        std::string nodeName = effect->getNode()->getFullyQualifiedName();
-        std::string nodeFullName = appID + "." + nodeName;
-        script.append( QString::fromUtf8( nodeFullName.c_str() ) );
-        script.append( QLatin1Char(',') );
-        script.append( QString::fromUtf8( appID.c_str() ) );
-        script.append( QString::fromUtf8(")\n") );
-
         std::string err, output;
         if ( !NATRON_PYTHON_NAMESPACE::interpretPythonScript(callback.toStdString(), &err, &output) ) {
             effect->getApp()->appendToScriptEditor("Failed to run callback: " + err);
@@ -2143,6 +2355,9 @@ DefaultScheduler::DefaultScheduler(RenderEngine* engine,
     , _effect(effect)
     , _currentTimeMutex()
     , _currentTime(0)
+    , _requestPlans( new FrameRequestPlanCache() )
+    , _sharedOutputsMutex()
+    , _sharedOutputs()
 {
     engine->setPlaybackMode(ePlaybackModeOnce);
 }
@@ -2151,6 +2366,14 @@ DefaultScheduler::~DefaultScheduler()
 {
 }
 
+std::list<OutputEffectInstancePtr>
+DefaultScheduler::getSharedOutputs() const
+{
+    QMutexLocker k(&_sharedOutputsMutex);
+
+    return _sharedOutputs;
+}
+
 class DefaultRenderFrameRunnable
     : public RenderThreadTask
 {
@@ -2159,18 +2382,24 @@ public:
 
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
     DefaultRenderFrameRunnable(const OutputEffectInstancePtr& writer,
-                               OutputSchedulerThread* scheduler)
+                               DefaultScheduler* scheduler,
+                               FrameRequestPlanCache* requestPlans)
         : RenderThreadTask(writer, scheduler)
+        , _scheduler(scheduler)
+        , _requestPlans(requestPlans)
     {
     }
 
 #else
     DefaultRenderFrameRunnable(const OutputEffectInstancePtr& writer,
-                               OutputSchedulerThread* scheduler,
+                               DefaultScheduler* scheduler,
+                               FrameRequestPlanCache* requestPlans,
                                const int time,
                                const bool useRenderStats,
                                const std::vector<int>& viewsToRender)
         : RenderThreadTask(writer, scheduler, time, useRenderStats, viewsToRender)
+        , _scheduler(scheduler)
+        , _requestPlans(requestPlans)
     {
     }
 
@@ -2183,6 +2412,10 @@ public:
 
 private:
 
+    // The DefaultScheduler outlives its render threads
+    DefaultScheduler* _scheduler;
+    FrameRequestPlanCache* _requestPlans;
+
 
     virtual void renderFrame(int time,
                              const std::vector<ViewIdx>& viewsToRender,
@@ -2196,14 +2429,57 @@ private:
             return;
         }
 
-        AbortableThread* isAbortableThread = dynamic_cast<AbortableThread*>( QThread::currentThread() );
-
         ///Even if enableRenderStats is false, we at least profile the time spent rendering the frame when rendering with a Write node.
         ///Though we don't enable render stats for sequential renders (e.g: WriteFFMPEG) since this is 1 file.
         RenderStatsPtr stats = boost::make_shared<RenderStats>(enableRenderStats);
+
+        // The writers sharing the render pass of the output are rendered by this thread right after it, while the images
+        // of the nodes they share upstream are still in the cache
+        std::list<OutputEffectInstancePtr> outputs = _scheduler->getSharedOutputs();
+        outputs.push_front(output);
+
+        for (std::list<OutputEffectInstancePtr>::const_iterator it = outputs.begin(); it != outputs.end(); ++it) {
+            if ( !runBeforeFrameRenderCallback(*it, time) ) {
+                return;
+            }
+        }
+
+        try {
+            for (std::size_t view = 0; view < viewsToRender.size(); ++view) {
+                for (std::list<OutputEffectInstancePtr>::const_iterator it = outputs.begin(); it != outputs.end(); ++it) {
+                    if ( !renderOutputView(*it, time, viewsToRender[view], stats) ) {
+                        return;
+                    }
+                }
+
+                ///If we need sequential rendering, pass the image to the output scheduler that will ensure the sequential ordering
+                /*if (!renderDirectly) {
+                    for (std::map<ImagePlaneDesc,ImagePtr>::iterator it = planes.begin(); it != planes.end(); ++it) {
+                        _imp->scheduler->appendToBuffer(time, viewsToRender[view], stats, boost::dynamic_pointer_cast<BufferableObject>(it->second));
+                    }
+                   } else {*/
+                _imp->scheduler->notifyFrameRendered(time, viewsToRender[view], viewsToRender, stats, eSchedulingPolicyFFA);
+                //}
+            }
+        } catch (const std::exception& e) {
+            _imp->scheduler->notifyRenderFailure( std::string("Error while rendering: ") + e.what() );
+        }
+    } // renderFrame
+
+    /**
+     * @brief Runs the before frame render callback of the given output, returns false if the frame should not be rendered.
+     **/
+    bool runBeforeFrameRenderCallback(const OutputEffectInstancePtr& output,
+                                      int time)
+    {
         NodePtr outputNode = output->getNode();
         std::string cb = outputNode->getBeforeFrameRenderCallback();
-        if ( !cb.empty() ) {
+
+        if ( cb.empty() ) {
+            return true;
+        }
+        // The signature is checked only for the first frame of the render
+        if ( !_imp->scheduler->isFrameCallbackSignatureChecked(cb) ) {
             std::vector<std::string> args;
             std::string error;
             try {
@@ -2212,13 +2488,13 @@ private:
                 output->getApp()->appendToScriptEditor( std::string("Failed to get signature of beforeFrameRendered callback: ")
                                                         + e.what() );
 
-                return;
+                return false;
             }
 
             if ( !error.empty() ) {
                 output->getApp()->appendToScriptEditor("Failed to get signature of beforeFrameRendered callback: " + error);
 
-                return;
+                return false;
             }
 
             std::string signatureError;
@@ -2227,160 +2503,165 @@ private:
             if ( (args.size() != 3) || (args[0] != "frame") || (args[1] != "thisNode") || (args[2] != "app") ) {
                 output->getApp()->appendToScriptEditor("Wrong signature of beforeFrameRendered callback: " + signatureError);
 
-                return;
-            }
-
-            std::stringstream ss;
-            std::string appStr = outputNode->getApp()->getAppIDString();
-            std::string outputNodeName = appStr + "." + outputNode->getFullyQualifiedName();
-            ss << cb << "(" << time << ", " << outputNodeName << ", " << appStr << ")";
-            std::string script = ss.str();
-            try {
-                _imp->scheduler->runCallbackWithVariables( QString::fromUtf8( script.c_str() ) );
-            } catch (const std::exception &e) {
-                _imp->scheduler->notifyRenderFailure( e.what() );
-
-                return;
+                return false;
             }
+            _imp->scheduler->setFrameCallbackSignatureChecked(cb);
         }
 
+        std::stringstream ss;
+        std::string appStr = outputNode->getApp()->getAppIDString();
+        std::string outputNodeName = appStr + "." + outputNode->getFullyQualifiedName();
+        ss << cb << "(" << time << ", " << outputNodeName << ", " << appStr << ")";
+        std::string script = ss.str();
         try {
-            ////Writers always render at scale 1.
-            int mipMapLevel = 0;
-            RenderScale scale(1.);
-            RectD rod;
-            bool isProjectFormat;
-
-            // Do not catch exceptions: if an exception occurs here it is probably fatal, since
-            // it comes from Natron itself. All exceptions from plugins are already caught
-            // by the HostSupport library.
-            EffectInstancePtr activeInputToRender;
-            //if (renderDirectly) {
-            activeInputToRender = output;
-            WriteNode* isWriteNode = dynamic_cast<WriteNode*>( output.get() );
-            if (isWriteNode) {
-                NodePtr embeddedWriter = isWriteNode->getEmbeddedWriter();
-                if (embeddedWriter) {
-                    activeInputToRender = embeddedWriter->getEffectInstance();
-                }
-            }
-            assert(activeInputToRender);
-            NodePtr activeInputNode = activeInputToRender->getNode();
-            U64 activeInputToRenderHash = isWriteNode ? isWriteNode->getHash() : activeInputToRender->getHash();
-            const double par = activeInputToRender->getAspectRatio(-1);
-            const bool isRenderDueToRenderInteraction = false;
-            const bool isSequentialRender = true;
+            _imp->scheduler->runCallbackWithVariables( QString::fromUtf8( script.c_str() ) );
+        } catch (const std::exception &e) {
+            _imp->scheduler->notifyRenderFailure( e.what() );
 
-            for (std::size_t view = 0; view < viewsToRender.size(); ++view) {
-                StatusEnum stat = activeInputToRender->getRegionOfDefinition_public(activeInputToRenderHash, time, scale, viewsToRender[view], &rod, &isProjectFormat);
-                if (stat == eStatusFailed) {
-                    _imp->scheduler->notifyRenderFailure("Error caught while rendering");
+            return false;
+        }
 
-                    return;
-                }
-                std::list<ImagePlaneDesc> components;
-                ImageBitDepthEnum imageDepth;
-
-                //Use needed components to figure out what we need to render
-                EffectInstance::ComponentsNeededMap neededComps;
-                std::list<ImagePlaneDesc> passThroughPlanes;
-                bool processAll;
-                double ptTime;
-                int ptView;
-                std::bitset<4> processChannels;
-                int ptInput;
-                activeInputToRender->getComponentsNeededAndProduced_public(activeInputToRenderHash,time, viewsToRender[view], &neededComps, &passThroughPlanes, &processAll, &ptTime, &ptView, &processChannels, &ptInput);
-
-
-                //Retrieve bitdepth only
-                imageDepth = activeInputToRender->getBitDepth(-1);
-                components.clear();
-
-                EffectInstance::ComponentsNeededMap::iterator foundOutput = neededComps.find(-1);
-                if ( foundOutput != neededComps.end() ) {
-                    for (std::list<ImagePlaneDesc>::const_iterator it2 = foundOutput->second.begin(); it2 != foundOutput->second.end(); ++it2) {
-                        components.push_back(*it2);
-                    }
-                }
-                RectI renderWindow;
-                rod.toPixelEnclosing(scale, par, &renderWindow);
+        return true;
+    } // runBeforeFrameRenderCallback
+
+    /**
+     * @brief Renders a view of the frame for the given output. Returns false and notifies the scheduler if it failed.
+     **/
+    bool renderOutputView(const OutputEffectInstancePtr& output,
+                          int time,
+                          ViewIdx view,
+                          const RenderStatsPtr& stats)
+    {
+        AbortableThread* isAbortableThread = dynamic_cast<AbortableThread*>( QThread::currentThread() );
 
+        ////Writers always render at scale 1.
+        int mipMapLevel = 0;
+        RenderScale scale(1.);
+        RectD rod;
+        bool isProjectFormat;
+
+        // Do not catch exceptions: if an exception occurs here it is probably fatal, since
+        // it comes from Natron itself. All exceptions from plugins are already caught
+        // by the HostSupport library.
+        EffectInstancePtr activeInputToRender;
+        //if (renderDirectly) {
+        activeInputToRender = output;
+        WriteNode* isWriteNode = dynamic_cast<WriteNode*>( output.get() );
+        if (isWriteNode) {
+            NodePtr embeddedWriter = isWriteNode->getEmbeddedWriter();
+            if (embeddedWriter) {
+                activeInputToRender = embeddedWriter->getEffectInstance();
+            }
+        }
+        assert(activeInputToRender);
+        NodePtr activeInputNode = activeInputToRender->getNode();
+        U64 activeInputToRenderHash = isWriteNode ? isWriteNode->getHash() : activeInputToRender->getHash();
+        const double par = activeInputToRender->getAspectRatio(-1);
+        const bool isRenderDueToRenderInteraction = false;
+        const bool isSequentialRender = true;
+
+        StatusEnum stat = activeInputToRender->getRegionOfDefinition_public(activeInputToRenderHash, time, scale, view, &rod, &isProjectFormat);
+        if (stat == eStatusFailed) {
+            _imp->scheduler->notifyRenderFailure("Error caught while rendering");
+
+            return false;
+        }
+        std::list<ImagePlaneDesc> components;
+        ImageBitDepthEnum imageDepth;
+
+        //Use needed components to figure out what we need to render
+        EffectInstance::ComponentsNeededMap neededComps;
+        std::list<ImagePlaneDesc> passThroughPlanes;
+        bool processAll;
+        double ptTime;
+        int ptView;
+        std::bitset<4> processChannels;
+        int ptInput;
+        activeInputToRender->getComponentsNeededAndProduced_public(activeInputToRenderHash,time, view, &neededComps, &passThroughPlanes, &processAll, &ptTime, &ptView, &processChannels, &ptInput);
+
+
+        //Retrieve bitdepth only
+        imageDepth = activeInputToRender->getBitDepth(-1);
+        components.clear();
+
+        EffectInstance::ComponentsNeededMap::iterator foundOutput = neededComps.find(-1);
+        if ( foundOutput != neededComps.end() ) {
+            for (std::list<ImagePlaneDesc>::const_iterator it2 = foundOutput->second.begin(); it2 != foundOutput->second.end(); ++it2) {
+                components.push_back(*it2);
+            }
+        }
+        RectI renderWindow;
+        rod.toPixelEnclosing(scale, par, &renderWindow);
 
-                AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(true, 0);
-                if (isAbortableThread) {
-                    isAbortableThread->setAbortInfo(isRenderDueToRenderInteraction, abortInfo, activeInputToRender);
-                }
 
-                ParallelRenderArgsSetter frameRenderArgs(time,
-                                                         viewsToRender[view],
-                                                         isRenderDueToRenderInteraction,  // is this render due to user interaction ?
-                                                         isSequentialRender,
-                                                         abortInfo, //abortInfo
-                                                         activeInputNode, // viewer requester
-                                                         0, //texture index
-                                                         output->getApp()->getTimeLine().get(),
-                                                         NodePtr(),
-                                                         false,
-                                                         false,
-                                                         stats);
+        AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(true, 0);
+        if (isAbortableThread) {
+            isAbortableThread->setAbortInfo(isRenderDueToRenderInteraction, abortInfo, activeInputToRender);
+        }
 
-                {
-                    FrameRequestMap request;
-                    stat = EffectInstance::computeRequestPass(time, viewsToRender[view], mipMapLevel, rod, activeInputNode, request);
-                    if (stat == eStatusFailed) {
-                        _imp->scheduler->notifyRenderFailure("Error caught while rendering");
+        ParallelRenderArgsSetter frameRenderArgs(time,
+                                                 view,
+                                                 isRenderDueToRenderInteraction,  // is this render due to user interaction ?
+                                                 isSequentialRender,
+                                                 abortInfo, //abortInfo
+                                                 activeInputNode, // viewer requester
+                                                 0, //texture index
+                                                 output->getApp()->getTimeLine().get(),
+                                                 NodePtr(),
+                                                 false,
+                                                 false,
+                                                 stats);
 
-                        return;
-                    }
-                    frameRenderArgs.updateNodesRequest(request);
-                }
-                RenderingFlagSetter flagIsRendering( activeInputToRender->getNode() );
-                std::map<ImagePlaneDesc, ImagePtr> planes;
-                boost::scoped_ptr<EffectInstance::RenderRoIArgs> renderArgs( new EffectInstance::RenderRoIArgs(time, //< the time at which to render
-                                                                                                               scale, //< the scale at which to render
-                                                                                                               mipMapLevel, //< the mipmap level (redundant with the scale)
-                                                                                                               viewsToRender[view], //< the view to render
-                                                                                                               false,
-                                                                                                               renderWindow, //< the region of interest (in pixel coordinates)
-                                                                                                               rod, // < any precomputed rod ? in canonical coordinates
-                                                                                                               components,
-                                                                                                               imageDepth,
-                                                                                                               false,
-                                                                                                               activeInputToRender.get(),
-                                                                                                               eStorageModeRAM,
-                                                                                                               time) );
-                EffectInstance::RenderRoIRetCode retCode;
-                retCode = activeInputToRender->renderRoI(*renderArgs, &planes);
-                if (retCode != EffectInstance::eRenderRoIRetCodeOk) {
-                    if (retCode == EffectInstance::eRenderRoIRetCodeAborted) {
-                        _imp->scheduler->notifyRenderFailure("Render aborted");
-                    } else {
-                        _imp->scheduler->notifyRenderFailure("Error caught while rendering");
-                    }
+        {
+            FrameRequestMap request;
+            if ( !_requestPlans->getShiftedPlan(time, view, mipMapLevel, rod, activeInputNode, &request) ) {
+                stat = EffectInstance::computeRequestPass(time, view, mipMapLevel, rod, activeInputNode, request);
+                if (stat == eStatusFailed) {
+                    _imp->scheduler->notifyRenderFailure("Error caught while rendering");
 
-                    return;
+                    return false;
                 }
-
-                ///If we need sequential rendering, pass the image to the output scheduler that will ensure the sequential ordering
-                /*if (!renderDirectly) {
-                    for (std::map<ImagePlaneDesc,ImagePtr>::iterator it = planes.begin(); it != planes.end(); ++it) {
-                        _imp->scheduler->appendToBuffer(time, viewsToRender[view], stats, boost::dynamic_pointer_cast<BufferableObject>(it->second));
-                    }
-                   } else {*/
-                _imp->scheduler->notifyFrameRendered(time, viewsToRender[view], viewsToRender, stats, eSchedulingPolicyFFA);
-                //}
+                _requestPlans->setPlan(time, view, mipMapLevel, rod, activeInputNode, request);
             }
-        } catch (const std::exception& e) {
-            _imp->scheduler->notifyRenderFailure( std::string("Error while rendering: ") + e.what() );
+            _imp->scheduler->notifyFramePeakMemoryEstimate( estimateRequestPeakMemory( request, mipMapLevel, 4 * getSizeOfForBitDepth(imageDepth) ) );
+            frameRenderArgs.updateNodesRequest(request);
         }
-    } // renderFrame
+        RenderingFlagSetter flagIsRendering( activeInputToRender->getNode() );
+        std::map<ImagePlaneDesc, ImagePtr> planes;
+        boost::scoped_ptr<EffectInstance::RenderRoIArgs> renderArgs( new EffectInstance::RenderRoIArgs(time, //< the time at which to render
+                                                                                                       scale, //< the scale at which to render
+                                                                                                       mipMapLevel, //< the mipmap level (redundant with the scale)
+                                                                                                       view, //< the view to render
+                                                                                                       false,
+                                                                                                       renderWindow, //< the region of interest (in pixel coordinates)
+                                                                                                       rod, // < any precomputed rod ? in canonical coordinates
+                                                                                                       components,
+                                                                                                       imageDepth,
+                                                                                                       false,
+                                                                                                       activeInputToRender.get(),
+                                                                                                       eStorageModeRAM,
+                                                                                                       time) );
+        EffectInstance::RenderRoIRetCode retCode;
+        retCode = activeInputToRender->renderRoI(*renderArgs, &planes);
+        if (retCode != EffectInstance::eRenderRoIRetCodeOk) {
+            if (retCode == EffectInstance::eRenderRoIRetCodeAborted) {
+                _imp->scheduler->notifyRenderFailure("Render aborted");
+            } else {
+                _imp->scheduler->notifyRenderFailure("Error caught while rendering");
+            }
+
+            return false;
+        }
+
+        return true;
+    } // renderOutputView
 };
 
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
 RenderThreadTask*
 DefaultScheduler::createRunnable()
 {
-    return new DefaultRenderFrameRunnable(_effect.lock(), this);
+    return new DefaultRenderFrameRunnable(_effect.lock(), this, _requestPlans.get());
 }
 
 #else
@@ -2389,7 +2670,7 @@ DefaultScheduler::createRunnable(int frame,
                                  bool useRenderStarts,
                                  const std::vector<int>& viewsToRender)
 {
-    return new DefaultRenderFrameRunnable(_effect.lock(), this, frame, useRenderStarts, viewsToRender);
+    return new DefaultRenderFrameRunnable(_effect.lock(), this, _requestPlans.get(), frame, useRenderStarts, viewsToRender);
 }
 
 #endif
@@ -2548,6 +2829,14 @@ DefaultScheduler::aboutToStartRender()
     OutputSchedulerThreadStartArgsPtr args = getCurrentRunArgs();
     OutputEffectInstancePtr effect = _effect.lock();
 
+    _requestPlans->clear();
+
+    std::list<OutputEffectInstancePtr> sharedOutputs = effect->getSharedPassOutputs();
+    {
+        QMutexLocker k(&_sharedOutputsMutex);
+        _sharedOutputs = sharedOutputs;
+    }
+
     {
         QMutexLocker k(&_currentTimeMutex);
         if (args->pushTimelineDirection == eRenderDirectionForward) {
@@ -2571,23 +2860,46 @@ DefaultScheduler::aboutToStartRender()
         isWriter->onSequenceRenderStarted();
     }
 
-    std::string cb = effect->getNode()->getBeforeRenderCallback();
-    if ( !cb.empty() ) {
-        std::vector<std::string> args;
-        std::string error;
-        try {
-            NATRON_PYTHON_NAMESPACE::getFunctionArguments(cb, &error, &args);
-        } catch (const std::exception& e) {
-            effect->getApp()->appendToScriptEditor( std::string("Failed to get signature of beforeRender callback: ")
-                                                    + e.what() );
-
-            return;
+    for (std::list<OutputEffectInstancePtr>::const_iterator it = sharedOutputs.begin(); it != sharedOutputs.end(); ++it) {
+        if (!isBackGround) {
+            (*it)->setKnobsFrozen(true);
         }
-
+        WriteNode* isSharedWriter = dynamic_cast<WriteNode*>( it->get() );
+        if (isSharedWriter) {
+            isSharedWriter->onSequenceRenderStarted();
+        }
+    }
+
+    if ( !runBeforeRenderCallback(effect) ) {
+        return;
+    }
+    for (std::list<OutputEffectInstancePtr>::const_iterator it = sharedOutputs.begin(); it != sharedOutputs.end(); ++it) {
+        if ( !runBeforeRenderCallback(*it) ) {
+            return;
+        }
+    }
+} // DefaultScheduler::aboutToStartRender
+
+bool
+DefaultScheduler::runBeforeRenderCallback(const OutputEffectInstancePtr& effect)
+{
+    std::string cb = effect->getNode()->getBeforeRenderCallback();
+    if ( !cb.empty() ) {
+        std::vector<std::string> args;
+        std::string error;
+        try {
+            NATRON_PYTHON_NAMESPACE::getFunctionArguments(cb, &error, &args);
+        } catch (const std::exception& e) {
+            effect->getApp()->appendToScriptEditor( std::string("Failed to get signature of beforeRender callback: ")
+                                                    + e.what() );
+
+            return false;
+        }
+
         if ( !error.empty() ) {
             effect->getApp()->appendToScriptEditor("Failed to get signature of beforeRender callback: " + error);
 
-            return;
+            return false;
         }
 
         std::string signatureError;
@@ -2596,7 +2908,7 @@ DefaultScheduler::aboutToStartRender()
         if ( (args.size() != 2) || (args[0] != "thisNode") || (args[1] != "app") ) {
             effect->getApp()->appendToScriptEditor("Failed to run beforeRender callback: " + signatureError);
 
-            return;
+            return false;
         }
 
 
@@ -2609,9 +2921,13 @@ DefaultScheduler::aboutToStartRender()
             runCallbackWithVariables( QString::fromUtf8( script.c_str() ) );
         } catch (const std::exception &e) {
             notifyRenderFailure( e.what() );
+
+            return false;
         }
     }
-} // DefaultScheduler::aboutToStartRender
+
+    return true;
+} // DefaultScheduler::runBeforeRenderCallback
 
 void
 DefaultScheduler::onRenderStopped(bool aborted)
@@ -2623,6 +2939,18 @@ DefaultScheduler::onRenderStopped(bool aborted)
         effect->setKnobsFrozen(false);
     }
 
+    std::list<OutputEffectInstancePtr> sharedOutputs;
+    {
+        QMutexLocker k(&_sharedOutputsMutex);
+        sharedOutputs.swap(_sharedOutputs);
+    }
+    for (std::list<OutputEffectInstancePtr>::const_iterator it = sharedOutputs.begin(); it != sharedOutputs.end(); ++it) {
+        if (!isBackGround) {
+            (*it)->setKnobsFrozen(false);
+        }
+        (*it)->notifyRenderFinished();
+    }
+
     {
         QString longText = QString::fromUtf8( effect->getScriptName_mt_safe().c_str() ) + tr(" ==> Rendering finished");
         appPTR->writeToOutputPipe(longText, QString::fromUtf8(kRenderingFinishedStringShort), true);
@@ -2630,6 +2958,16 @@ DefaultScheduler::onRenderStopped(bool aborted)
 
     effect->notifyRenderFinished();
 
+    runAfterRenderCallback(effect, aborted);
+    for (std::list<OutputEffectInstancePtr>::const_iterator it = sharedOutputs.begin(); it != sharedOutputs.end(); ++it) {
+        runAfterRenderCallback(*it, aborted);
+    }
+} // DefaultScheduler::onRenderStopped
+
+void
+DefaultScheduler::runAfterRenderCallback(const OutputEffectInstancePtr& effect,
+                                         bool aborted)
+{
     std::string cb = effect->getNode()->getAfterRenderCallback();
     if ( !cb.empty() ) {
         std::vector<std::string> args;
@@ -2676,7 +3014,7 @@ DefaultScheduler::onRenderStopped(bool aborted)
             //Ignore expcetions in callback since the render is finished anyway
         }
     }
-} // DefaultScheduler::onRenderStopped
+} // DefaultScheduler::runAfterRenderCallback
 
 ////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////
@@ -2687,6 +3025,10 @@ ViewerDisplayScheduler::ViewerDisplayScheduler(RenderEngine* engine,
                                                const ViewerInstancePtr& viewer)
     : OutputSchedulerThread(engine, viewer, eProcessFrameByMainThread) //< OpenGL rendering is done on the main-thread
     , _viewer(viewer)
+    , _playbackQualityMutex()
+    , _averageFrameRenderTime(0.)
+    , _playbackDraftLevel(0)
+    , _framesSinceDraftLevelChange(0)
 {
 }
 
@@ -2694,6 +3036,58 @@ ViewerDisplayScheduler::~ViewerDisplayScheduler()
 {
 }
 
+void
+ViewerDisplayScheduler::aboutToStartRender()
+{
+    {
+        QMutexLocker k(&_playbackQualityMutex);
+        _averageFrameRenderTime = 0.;
+        _playbackDraftLevel = 0;
+        _framesSinceDraftLevelChange = 0;
+    }
+    _viewer.lock()->setPlaybackDraftMipMapLevel(0);
+}
+
+void
+ViewerDisplayScheduler::notifyFrameRenderTime(double renderTime)
+{
+    double fps = getDesiredFPS();
+
+    if ( (fps <= 0.) || !appPTR->getCurrentSettings()->isAdaptivePlaybackQualityEnabled() ) {
+        return;
+    }
+
+    // Frames are rendered concurrently by the render threads
+    int nThreads = std::max( 1, getNRenderThreads() );
+    double targetFramePeriod = 1. / fps;
+    unsigned int newLevel;
+    {
+        QMutexLocker k(&_playbackQualityMutex);
+
+        // Smooth the render times so that a single slow frame does not change the quality
+        _averageFrameRenderTime = _framesSinceDraftLevelChange == 0 ? renderTime : 0.7 * _averageFrameRenderTime + 0.3 * renderTime;
+        ++_framesSinceDraftLevelChange;
+        if (_framesSinceDraftLevelChange < NATRON_PLAYBACK_DRAFT_LEVEL_MIN_FRAMES) {
+            return;
+        }
+
+        double framePeriod = _averageFrameRenderTime / nThreads;
+        newLevel = _playbackDraftLevel;
+        if ( (framePeriod > targetFramePeriod / NATRON_SCHEDULER_PLAYBACK_FPS_TOLERANCE) && (newLevel < NATRON_PLAYBACK_MAX_DRAFT_LEVEL) ) {
+            ++newLevel;
+        } else if ( (newLevel > 0) && (framePeriod * 4. < targetFramePeriod * NATRON_SCHEDULER_PLAYBACK_FPS_TOLERANCE) ) {
+            // Each level up renders 4 times more pixels: only refine if the frame rate would still be held
+            --newLevel;
+        }
+        if (newLevel == _playbackDraftLevel) {
+            return;
+        }
+        _playbackDraftLevel = newLevel;
+        _framesSinceDraftLevelChange = 0;
+    }
+    _viewer.lock()->setPlaybackDraftMipMapLevel(newLevel);
+}
+
 /**
  * @brief Called whenever there are images available to process in the buffer.
  * Once processed, the frame will be removed from the buffer.
@@ -2865,11 +3259,15 @@ private:
 
 
         if ( ( args[0] && (status[0] != ViewerInstance::eViewerRenderRetCodeFail) ) || ( args[1] && (status[1] != ViewerInstance::eViewerRenderRetCodeFail) ) ) {
+            TimeLapse renderTime;
             try {
                 stat = viewer->renderViewer(view, false, true, viewerHash, true, NodePtr(), true,  args, ViewerCurrentFrameRequestSchedulerStartArgsPtr(), stats);
             } catch (...) {
                 stat = ViewerInstance::eViewerRenderRetCodeFail;
             }
+            if (stat != ViewerInstance::eViewerRenderRetCodeFail) {
+                static_cast<ViewerDisplayScheduler*>(_imp->scheduler)->notifyFrameRenderTime( renderTime.getTimeSinceCreation() );
+            }
         }
         if (stat == ViewerInstance::eViewerRenderRetCodeFail) {
             ///Don't report any error message otherwise we will flood the viewer with irrelevant messages such as
@@ -2919,6 +3317,18 @@ ViewerDisplayScheduler::onRenderStopped(bool /*/aborted*/)
     ///Refresh all previews in the tree
     ViewerInstancePtr viewer = _viewer.lock();
 
+    // If the quality was lowered during playback, re-render the displayed frame at full quality
+    bool wasDraft;
+    {
+        QMutexLocker k(&_playbackQualityMutex);
+        wasDraft = _playbackDraftLevel > 0;
+        _playbackDraftLevel = 0;
+    }
+    viewer->setPlaybackDraftMipMapLevel(0);
+    if (wasDraft) {
+        viewer->renderCurrentFrameOnMainThread();
+    }
+
     viewer->getApp()->refreshAllPreviews();
 
     if ( !viewer->getApp() || viewer->getApp()->isGuiFrozen() ) {
@@ -2946,6 +3356,13 @@ struct RenderEnginePrivate
     mutable QMutex pbModeMutex;
     PlaybackModeEnum pbMode;
     ViewerCurrentFrameRequestScheduler* currentFrameScheduler;
+    ViewerCacheAheadScheduler* cacheAheadScheduler;
+
+    // Created on the first prefetch request, protected by schedulerCreationLock
+    ViewerCachePrefetchScheduler* cachePrefetchScheduler;
+
+    // Restarted by each current frame render request, only used on the main-thread
+    QTimer cacheAheadTimer;
 
     // Only used on the main-thread
     boost::scoped_ptr<RenderEngineWatcher> engineWatcher;
@@ -2971,6 +3388,9 @@ struct RenderEnginePrivate
         , pbModeMutex()
         , pbMode(ePlaybackModeLoop)
         , currentFrameScheduler(0)
+        , cacheAheadScheduler(0)
+        , cachePrefetchScheduler(0)
+        , cacheAheadTimer()
         , refreshQueue()
     {
     }
@@ -2980,10 +3400,17 @@ RenderEngine::RenderEngine(const OutputEffectInstancePtr& output)
     : _imp( new RenderEnginePrivate(output) )
 {
     QObject::connect(this, SIGNAL(currentFrameRenderRequestPosted()), this, SLOT(onCurrentFrameRenderRequestPosted()), Qt::QueuedConnection);
+    _imp->cacheAheadTimer.setSingleShot(true);
+    _imp->cacheAheadTimer.setInterval(NATRON_VIEWER_CACHE_AHEAD_IDLE_DELAY_MS);
+    QObject::connect( &_imp->cacheAheadTimer, SIGNAL(timeout()), this, SLOT(onCacheAheadTimerTimeout()) );
 }
 
 RenderEngine::~RenderEngine()
 {
+    delete _imp->cacheAheadScheduler;
+    _imp->cacheAheadScheduler = 0;
+    delete _imp->cachePrefetchScheduler;
+    _imp->cachePrefetchScheduler = 0;
     delete _imp->currentFrameScheduler;
     _imp->currentFrameScheduler = 0;
     delete _imp->scheduler;
@@ -3002,6 +3429,15 @@ RenderEngine::getOutput() const
     return _imp->output.lock();
 }
 
+double
+RenderEngine::getCurrentTimelineFrame() const
+{
+    OutputEffectInstancePtr output = _imp->output.lock();
+    AppInstancePtr app = output ? output->getApp() : AppInstancePtr();
+
+    return app ? app->getTimeLine()->currentFrame() : 0.;
+}
+
 void
 RenderEngine::renderFrameRange(bool isBlocking,
                                bool enableRenderStats,
@@ -3011,6 +3447,9 @@ RenderEngine::renderFrameRange(bool isBlocking,
                                const std::vector<ViewIdx>& viewsToRender,
                                RenderDirectionEnum forward)
 {
+    if (_imp->cacheAheadScheduler) {
+        _imp->cacheAheadScheduler->abortThreadedTask();
+    }
     setPlaybackAutoRestartEnabled(true);
 
     {
@@ -3020,6 +3459,9 @@ RenderEngine::renderFrameRange(bool isBlocking,
         }
     }
 
+    if ( RenderRequestRecorder::isEnabled() ) {
+        RenderRequestRecorder::recordRenderFrameRange(_imp->output.lock().get(), firstFrame, lastFrame, frameStep, viewsToRender, forward == eRenderDirectionForward);
+    }
     _imp->scheduler->renderFrameRange(isBlocking, enableRenderStats, firstFrame, lastFrame, frameStep, viewsToRender, forward);
 }
 
@@ -3028,6 +3470,9 @@ RenderEngine::renderFromCurrentFrame(bool enableRenderStats,
                                      const std::vector<ViewIdx>& viewsToRender,
                                      RenderDirectionEnum forward)
 {
+    if (_imp->cacheAheadScheduler) {
+        _imp->cacheAheadScheduler->abortThreadedTask();
+    }
     setPlaybackAutoRestartEnabled(true);
 
     {
@@ -3037,6 +3482,9 @@ RenderEngine::renderFromCurrentFrame(bool enableRenderStats,
         }
     }
 
+    if ( RenderRequestRecorder::isEnabled() ) {
+        RenderRequestRecorder::recordRenderFromCurrentFrame(_imp->output.lock().get(), getCurrentTimelineFrame(), viewsToRender, forward == eRenderDirectionForward);
+    }
     _imp->scheduler->renderFromCurrentFrame(enableRenderStats, viewsToRender, forward);
 }
 
@@ -3077,6 +3525,12 @@ RenderEngine::renderCurrentFrameInternal(bool enableRenderStats,
         return;
     }
 
+    // The user is interacting: leave the CPU to the current frame and fill the cache again once idle
+    if (_imp->cacheAheadScheduler) {
+        _imp->cacheAheadScheduler->abortThreadedTask();
+    }
+    _imp->cacheAheadTimer.start();
+
 
     ///If the scheduler is already doing playback, continue it
     if (_imp->scheduler) {
@@ -3114,6 +3568,9 @@ RenderEngine::renderCurrentFrame(bool enableRenderStats,
                                  bool canAbort)
 {
     assert( QThread::currentThread() == qApp->thread() );
+    if ( RenderRequestRecorder::isEnabled() ) {
+        RenderRequestRecorder::recordRenderCurrentFrame(_imp->output.lock().get(), getCurrentTimelineFrame(), canAbort);
+    }
     RenderEnginePrivate::RefreshRequest r;
     r.enableStats = enableRenderStats;
     r.enableAbort = canAbort;
@@ -3147,6 +3604,14 @@ RenderEngine::quitEngine(bool allowRestarts)
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->quitThread(allowRestarts);
     }
+
+    if (_imp->cacheAheadScheduler) {
+        _imp->cacheAheadScheduler->quitThread(allowRestarts);
+    }
+
+    if (_imp->cachePrefetchScheduler) {
+        _imp->cachePrefetchScheduler->quitThread(allowRestarts);
+    }
 }
 
 void
@@ -3159,6 +3624,14 @@ RenderEngine::waitForEngineToQuit_not_main_thread()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForThreadToQuit_not_main_thread();
     }
+
+    if (_imp->cacheAheadScheduler) {
+        _imp->cacheAheadScheduler->waitForThreadToQuit_not_main_thread();
+    }
+
+    if (_imp->cachePrefetchScheduler) {
+        _imp->cachePrefetchScheduler->waitForThreadToQuit_not_main_thread();
+    }
 }
 
 void
@@ -3181,6 +3654,14 @@ RenderEngine::waitForEngineToQuit_enforce_blocking()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForThreadToQuit_enforce_blocking();
     }
+
+    if (_imp->cacheAheadScheduler) {
+        _imp->cacheAheadScheduler->waitForThreadToQuit_enforce_blocking();
+    }
+
+    if (_imp->cachePrefetchScheduler) {
+        _imp->cachePrefetchScheduler->waitForThreadToQuit_enforce_blocking();
+    }
 }
 
 bool
@@ -3188,6 +3669,14 @@ RenderEngine::abortRenderingInternal(bool keepOldestRender)
 {
     bool ret = false;
 
+    // Filling the cache ahead is not a render requested by the user: it does not count to restart the playback
+    if (_imp->cacheAheadScheduler) {
+        _imp->cacheAheadScheduler->abortThreadedTask();
+    }
+    if (_imp->cachePrefetchScheduler) {
+        _imp->cachePrefetchScheduler->abortThreadedTask();
+    }
+
     if (_imp->currentFrameScheduler) {
         ret |= _imp->currentFrameScheduler->abortThreadedTask(keepOldestRender);
     }
@@ -3197,12 +3686,19 @@ RenderEngine::abortRenderingInternal(bool keepOldestRender)
         ret |= _imp->scheduler->abortThreadedTask(keepOldestRender);
     }
 
+    if (ret) {
+        PerfCounters::increment(ePerfCounterRendersAborted);
+    }
+
     return ret;
 }
 
 bool
 RenderEngine::abortRenderingNoRestart(bool keepOldestRender)
 {
+    if ( RenderRequestRecorder::isEnabled() ) {
+        RenderRequestRecorder::recordAbort(_imp->output.lock().get(), false);
+    }
     if ( abortRenderingInternal(keepOldestRender) ) {
         setPlaybackAutoRestartEnabled(false);
 
@@ -3215,6 +3711,9 @@ RenderEngine::abortRenderingNoRestart(bool keepOldestRender)
 bool
 RenderEngine::abortRenderingAutoRestart()
 {
+    if ( RenderRequestRecorder::isEnabled() ) {
+        RenderRequestRecorder::recordAbort(_imp->output.lock().get(), true);
+    }
     if ( abortRenderingInternal(true) ) {
         return true;
     }
@@ -3231,6 +3730,12 @@ RenderEngine::waitForAbortToComplete_not_main_thread()
     if (_imp->scheduler) {
         _imp->scheduler->waitForAbortToComplete_not_main_thread();
     }
+    if (_imp->cacheAheadScheduler) {
+        _imp->cacheAheadScheduler->waitForAbortToComplete_not_main_thread();
+    }
+    if (_imp->cachePrefetchScheduler) {
+        _imp->cachePrefetchScheduler->waitForAbortToComplete_not_main_thread();
+    }
 }
 
 void
@@ -3243,6 +3748,14 @@ RenderEngine::waitForAbortToComplete_enforce_blocking()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForAbortToComplete_enforce_blocking();
     }
+
+    if (_imp->cacheAheadScheduler) {
+        _imp->cacheAheadScheduler->waitForAbortToComplete_enforce_blocking();
+    }
+
+    if (_imp->cachePrefetchScheduler) {
+        _imp->cachePrefetchScheduler->waitForAbortToComplete_enforce_blocking();
+    }
 }
 
 void
@@ -3300,7 +3813,20 @@ RenderEngine::hasThreadsAlive() const
         currentFrameSchedulerRunning = _imp->currentFrameScheduler->isRunning();
     }
 
-    return schedulerRunning || currentFrameSchedulerRunning;
+    bool cacheAheadSchedulerRunning = false;
+    if (_imp->cacheAheadScheduler) {
+        cacheAheadSchedulerRunning = _imp->cacheAheadScheduler->isRunning();
+    }
+
+    bool cachePrefetchSchedulerRunning = false;
+    {
+        QMutexLocker k(&_imp->schedulerCreationLock);
+        if (_imp->cachePrefetchScheduler) {
+            cachePrefetchSchedulerRunning = _imp->cachePrefetchScheduler->isRunning();
+        }
+    }
+
+    return schedulerRunning || currentFrameSchedulerRunning || cacheAheadSchedulerRunning || cachePrefetchSchedulerRunning;
 }
 
 bool
@@ -3359,6 +3885,12 @@ RenderEngine::getDesiredFPS() const
     return _imp->scheduler ? _imp->scheduler->getDesiredFPS() : 24;
 }
 
+int
+RenderEngine::getDroppedFramesCount() const
+{
+    return _imp->scheduler ? _imp->scheduler->getDroppedFramesCount() : 0;
+}
+
 void
 RenderEngine::notifyFrameProduced(const BufferableObjectPtrList& frames,
                                   const RenderStatsPtr& stats,
@@ -3367,6 +3899,57 @@ RenderEngine::notifyFrameProduced(const BufferableObjectPtrList& frames,
     _imp->currentFrameScheduler->notifyFrameProduced(frames, stats, request);
 }
 
+RenderDirectionEnum
+RenderEngine::getSequentialRenderDirection() const
+{
+    RenderDirectionEnum direction = eRenderDirectionForward;
+    std::vector<ViewIdx> views;
+
+    if (_imp->scheduler) {
+        _imp->scheduler->getLastRunArgs(&direction, &views);
+    }
+
+    return direction;
+}
+
+void
+RenderEngine::prefetchViewerCache(const std::vector<FrameKey>& keys)
+{
+    ViewerCachePrefetchScheduler* scheduler;
+    {
+        QMutexLocker k(&_imp->schedulerCreationLock);
+        if (!_imp->cachePrefetchScheduler) {
+            _imp->cachePrefetchScheduler = new ViewerCachePrefetchScheduler();
+        }
+        scheduler = _imp->cachePrefetchScheduler;
+    }
+    scheduler->prefetch(keys);
+}
+
+void
+RenderEngine::onCacheAheadTimerTimeout()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    if ( !appPTR->getCurrentSettings()->isViewerCacheAheadEnabled() ) {
+        return;
+    }
+    ViewerInstance* isViewer = dynamic_cast<ViewerInstance*>( _imp->output.lock().get() );
+    if ( !isViewer || !isViewer->isViewerUIVisible() || isViewer->getApp()->isGuiFrozen() ) {
+        return;
+    }
+    if ( hasThreadsWorking() ) {
+        // The current frame or the playback is still rendering, try again later
+        _imp->cacheAheadTimer.start();
+
+        return;
+    }
+    if (!_imp->cacheAheadScheduler) {
+        _imp->cacheAheadScheduler = new ViewerCacheAheadScheduler(isViewer);
+    }
+    _imp->cacheAheadScheduler->fillCache();
+}
+
 OutputSchedulerThread*
 ViewerRenderEngine::createScheduler(const OutputEffectInstancePtr& effect)
 {
@@ -3470,6 +4053,13 @@ struct ViewerCurrentFrameRequestSchedulerPrivate
     // Used to attribute an age to each renderCurrentFrameRequest
     U64 ageCounter;
 
+    // Started after each draft render request, re-renders at full quality when it times out. Only accessed on the main thread.
+    QTimer draftRefinementTimer;
+
+    // True while the full quality render of age draftRefinementAge was not displayed yet. Only accessed on the main thread.
+    bool draftRefinementInProgress;
+    U64 draftRefinementAge;
+
     ViewerCurrentFrameRequestSchedulerPrivate(ViewerInstance* viewer)
         : viewer(viewer)
         , threadPool( QThreadPool::globalInstance() )
@@ -3480,6 +4070,9 @@ struct ViewerCurrentFrameRequestSchedulerPrivate
         , currentFrameRenderTasksCond()
         , currentFrameRenderTasks()
         , ageCounter(0)
+        , draftRefinementTimer()
+        , draftRefinementInProgress(false)
+        , draftRefinementAge(0)
     {
     }
 
@@ -3620,9 +4213,13 @@ public:
 
     RenderStatsPtr stats;
     BufferableObjectPtrList frames;
+    U64 age;
 
     ViewerCurrentFrameRequestSchedulerExecOnMT()
         : GenericThreadExecOnMainThreadArgs()
+        , stats()
+        , frames()
+        , age(0)
     {
     }
 
@@ -3638,6 +4235,10 @@ ViewerCurrentFrameRequestScheduler::ViewerCurrentFrameRequestScheduler(ViewerIns
     , _imp( new ViewerCurrentFrameRequestSchedulerPrivate(viewer) )
 {
     setThreadName("ViewerCurrentFrameRequestScheduler");
+
+    _imp->draftRefinementTimer.setSingleShot(true);
+    _imp->draftRefinementTimer.setInterval(NATRON_VIEWER_DRAFT_REFINEMENT_DELAY_MS);
+    QObject::connect( &_imp->draftRefinementTimer, SIGNAL(timeout()), this, SLOT(onDraftRefinementTimerTimeout()) );
 }
 
 ViewerCurrentFrameRequestScheduler::~ViewerCurrentFrameRequestScheduler()
@@ -3668,6 +4269,7 @@ ViewerCurrentFrameRequestScheduler::threadLoopOnce(const GenericThreadStartArgsP
 
     ///Wait for the work to be done
     ViewerCurrentFrameRequestSchedulerExecOnMTPtr mtArgs = boost::make_shared<ViewerCurrentFrameRequestSchedulerExecOnMT>();
+    mtArgs->age = args->age;
     {
         QMutexLocker k(&_imp->producedFramesMutex);
         ProducedFrameSet::iterator found = _imp->producedFrames.end();
@@ -3744,6 +4346,9 @@ ViewerCurrentFrameRequestScheduler::executeOnMainThread(const GenericThreadExecO
 
     assert(args);
     if (args) {
+        if ( _imp->draftRefinementInProgress && (args->age >= _imp->draftRefinementAge) ) {
+            _imp->draftRefinementInProgress = false;
+        }
         _imp->processProducedFrame(args->stats, args->frames);
     }
 }
@@ -3820,10 +4425,35 @@ ViewerCurrentFrameRequestScheduler::notifyFrameProduced(const BufferableObjectPt
     _imp->notifyFrameProduced(frames, stats,  request->age);
 }
 
+void
+ViewerCurrentFrameRequestScheduler::onDraftRefinementTimerTimeout()
+{
+    // The user is still interacting (e.g: the mouse button is still down) but did not move for a while:
+    // refine the draft render to full quality
+    if ( !_imp->viewer->getApp()->isDraftRenderEnabled() ) {
+        // The interaction ended, a full quality render was already requested
+        return;
+    }
+    renderCurrentFrameInternal(false, true, true);
+}
+
 void
 ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats,
                                                        bool canAbort)
 {
+    renderCurrentFrameInternal(enableRenderStats, canAbort, false);
+}
+
+void
+ViewerCurrentFrameRequestScheduler::renderCurrentFrameInternal(bool enableRenderStats,
+                                                               bool canAbort,
+                                                               bool isDraftRefinement)
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    // Any new request supersedes the pending refinement
+    _imp->draftRefinementTimer.stop();
+
     int frame = _imp->viewer->getTimeline()->currentFrame();
     int viewsCount = _imp->viewer->getRenderViewsCount();
     ViewIdx view = viewsCount > 0 ? _imp->viewer->getViewerCurrentView() : ViewIdx(0);
@@ -3869,6 +4499,7 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats,
 
         for (int i = 0; i < 2; ++i) {
             args[i] = boost::make_shared<ViewerArgs>();
+            args[i]->isDraftRefinement = isDraftRefinement;
             status[i] = _imp->viewer->getRenderViewerArgsAndCheckCache_public( frame, false, view, i, viewerHash, canAbort, rotoPaintNode, stats, args[i].get() );
 
             clearTexture[i] = status[i] == ViewerInstance::eViewerRenderRetCodeFail || status[i] == ViewerInstance::eViewerRenderRetCodeBlack;
@@ -3887,6 +4518,20 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats,
             _imp->viewer->disconnectViewer();
             return;
         }
+
+        // Progressive refinement: the draft render gives a fast feedback during the interaction,
+        // re-render at full quality as soon as no new request comes in
+        if ( args[0]->draftModeEnabled || args[1]->draftModeEnabled ) {
+            if (_imp->draftRefinementInProgress) {
+                // The interaction resumed: do not let the full quality render delay the draft renders
+                _imp->viewer->markAllOnGoingRendersAsAborted(false);
+                _imp->draftRefinementInProgress = false;
+            }
+            if ( appPTR->getCurrentSettings()->isAutoProxyRefinementEnabled() ) {
+                _imp->draftRefinementTimer.start();
+            }
+        }
+
         if (clearTexture[0]) {
             _imp->viewer->disconnectTexture(0, status[0] == ViewerInstance::eViewerRenderRetCodeFail);
         }
@@ -3966,6 +4611,10 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats,
         // Identify this render request with an age
         ViewerCurrentFrameRequestSchedulerStartArgsPtr request = boost::make_shared<ViewerCurrentFrameRequestSchedulerStartArgs>();
         request->age = _imp->ageCounter;
+        if (isDraftRefinement) {
+            _imp->draftRefinementInProgress = true;
+            _imp->draftRefinementAge = request->age;
+        }
 
         // If we reached the max amount of age, reset to 0... should never happen anyway
         if ( _imp->ageCounter >= std::numeric_limits<U64>::max() ) {
@@ -3991,10 +4640,10 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats,
         } else {
             RenderCurrentFrameFunctorRunnable* task = new RenderCurrentFrameFunctorRunnable(functorArgs);
             _imp->appendRunnableTask(task);
-            _imp->threadPool->start(task);
+            _imp->threadPool->start(task, eThreadPoolPriorityViewerCurrentFrame);
         }
     }
-} // ViewerCurrentFrameRequestScheduler::renderCurrentFrame
+} // ViewerCurrentFrameRequestScheduler::renderCurrentFrameInternal
 
 ViewerCurrentFrameRequestRendererBackup::ViewerCurrentFrameRequestRendererBackup()
     : GenericSchedulerThread()
@@ -4018,6 +4667,212 @@ ViewerCurrentFrameRequestRendererBackup::threadLoopOnce(const GenericThreadStart
     return eThreadStateActive;
 }
 
+////////////////////////ViewerCacheAheadScheduler////////////////////////
+class ViewerCacheAheadArgs
+    : public GenericThreadStartArgs
+{
+public:
+
+    int firstFrame, lastFrame;
+    int startFrame;
+    ViewIdx view;
+
+    ViewerCacheAheadArgs()
+        : GenericThreadStartArgs()
+        , firstFrame(0)
+        , lastFrame(0)
+        , startFrame(0)
+        , view(0)
+    {
+    }
+
+    virtual ~ViewerCacheAheadArgs() {}
+};
+
+typedef boost::shared_ptr<ViewerCacheAheadArgs> ViewerCacheAheadArgsPtr;
+
+struct ViewerCacheAheadSchedulerPrivate
+{
+    ViewerInstance* viewer;
+
+    ViewerCacheAheadSchedulerPrivate(ViewerInstance* viewer)
+        : viewer(viewer)
+    {
+    }
+};
+
+ViewerCacheAheadScheduler::ViewerCacheAheadScheduler(ViewerInstance* viewer)
+    : GenericSchedulerThread()
+    , _imp( new ViewerCacheAheadSchedulerPrivate(viewer) )
+{
+    setThreadName("ViewerCacheAheadScheduler");
+}
+
+ViewerCacheAheadScheduler::~ViewerCacheAheadScheduler()
+{
+}
+
+void
+ViewerCacheAheadScheduler::fillCache()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    ViewerCacheAheadArgsPtr args = boost::make_shared<ViewerCacheAheadArgs>();
+    ViewerInstance* leadViewer = _imp->viewer->getApp()->getLastViewerUsingTimeline();
+    ( leadViewer ? leadViewer : _imp->viewer )->getTimelineBounds(&args->firstFrame, &args->lastFrame);
+    if (args->lastFrame < args->firstFrame) {
+        return;
+    }
+    args->startFrame = _imp->viewer->getTimeline()->currentFrame();
+    args->view = _imp->viewer->getRenderViewsCount() > 0 ? _imp->viewer->getViewerCurrentView() : ViewIdx(0);
+    startTask(args);
+}
+
+void
+ViewerCacheAheadScheduler::onAbortRequested(bool /*keepOldestRender*/)
+{
+    // Flag the ongoing render so that it aborts as fast as the playback does
+    bool userInteraction;
+    AbortableRenderInfoPtr abortInfo;
+    EffectInstancePtr treeRoot;
+
+    getAbortInfo(&userInteraction, &abortInfo, &treeRoot);
+    if (abortInfo) {
+        abortInfo->setAborted();
+    }
+}
+
+GenericSchedulerThread::ThreadStateEnum
+ViewerCacheAheadScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
+{
+    ViewerCacheAheadArgsPtr args = boost::dynamic_pointer_cast<ViewerCacheAheadArgs>(inArgs);
+
+    assert(args);
+    ViewerInstance* viewer = _imp->viewer;
+    U64 viewerHash = viewer->getHash();
+    int nFrames = args->lastFrame - args->firstFrame + 1;
+    int startOffset = boost::algorithm::clamp(args->startFrame, args->firstFrame, args->lastFrame) - args->firstFrame;
+
+    // Start after the current frame, which is most likely already cached
+    for (int i = 1; i <= nFrames; ++i) {
+        ThreadStateEnum state = resolveState();
+        if ( (state == eThreadStateAborted) || (state == eThreadStateStopped) ) {
+            return state;
+        }
+
+        // Stop when the cache budget is reached: going on would evict the frames cached first
+        if ( appPTR->isViewerCacheAlmostFull() || appPTR->isNodeCacheAlmostFull() ) {
+            break;
+        }
+
+        // The graph changed: the next render request restarts the fill with the new hash
+        if ( viewer->getRenderEngine()->isDoingSequentialRender() || (viewer->getHash() != viewerHash) ) {
+            break;
+        }
+
+        int frame = args->firstFrame + (startOffset + i) % nFrames;
+        ViewerArgsPtr frameArgs[2];
+        bool mustRender = false;
+        bool canUseCache = true;
+        for (int t = 0; t < 2; ++t) {
+            frameArgs[t] = boost::make_shared<ViewerArgs>();
+            ViewerInstance::ViewerRenderRetCode status = viewer->getRenderViewerArgsAndCheckCache_public( frame, true, args->view, t, viewerHash, true, NodePtr(), RenderStatsPtr(), frameArgs[t].get() );
+            if ( (status != ViewerInstance::eViewerRenderRetCodeRender) || !frameArgs[t]->params || frameArgs[t]->params->isViewerPaused ) {
+                frameArgs[t].reset();
+                continue;
+            }
+            // These textures are never cached: there is nothing to fill
+            if (frameArgs[t]->forceRender || frameArgs[t]->userRoIEnabled || frameArgs[t]->autoContrast || frameArgs[t]->isDoingPartialUpdates) {
+                canUseCache = false;
+                break;
+            }
+            if ( (frameArgs[t]->params->nbCachedTile > 0) && ( frameArgs[t]->params->nbCachedTile == (int)frameArgs[t]->params->tiles.size() ) ) {
+                frameArgs[t].reset();
+                continue;
+            }
+            mustRender = true;
+        }
+        if (!canUseCache) {
+            break;
+        }
+        if (!mustRender) {
+            continue;
+        }
+
+        ViewerInstance::ViewerRenderRetCode stat;
+        try {
+            stat = viewer->renderViewer(args->view, false, true, viewerHash, true, NodePtr(), true, frameArgs, ViewerCurrentFrameRequestSchedulerStartArgsPtr(), RenderStatsPtr());
+        } catch (...) {
+            stat = ViewerInstance::eViewerRenderRetCodeFail;
+        }
+        if (stat == ViewerInstance::eViewerRenderRetCodeFail) {
+            // Errors are reported by the renders the user asked for
+            break;
+        }
+    }
+
+    return eThreadStateActive;
+} // ViewerCacheAheadScheduler::threadLoopOnce
+
+////////////////////////ViewerCachePrefetchScheduler////////////////////////
+class ViewerCachePrefetchArgs
+    : public GenericThreadStartArgs
+{
+public:
+
+    std::vector<FrameKey> keys;
+
+    ViewerCachePrefetchArgs()
+        : GenericThreadStartArgs()
+        , keys()
+    {
+    }
+
+    virtual ~ViewerCachePrefetchArgs() {}
+};
+
+typedef boost::shared_ptr<ViewerCachePrefetchArgs> ViewerCachePrefetchArgsPtr;
+
+ViewerCachePrefetchScheduler::ViewerCachePrefetchScheduler()
+    : GenericSchedulerThread()
+{
+    setThreadName("ViewerCachePrefetchScheduler");
+}
+
+ViewerCachePrefetchScheduler::~ViewerCachePrefetchScheduler()
+{
+}
+
+void
+ViewerCachePrefetchScheduler::prefetch(const std::vector<FrameKey>& keys)
+{
+    ViewerCachePrefetchArgsPtr args = boost::make_shared<ViewerCachePrefetchArgs>();
+
+    args->keys = keys;
+    startTask(args);
+}
+
+GenericSchedulerThread::ThreadStateEnum
+ViewerCachePrefetchScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
+{
+    ViewerCachePrefetchArgsPtr args = boost::dynamic_pointer_cast<ViewerCachePrefetchArgs>(inArgs);
+
+    assert(args);
+    for (std::size_t i = 0; i < args->keys.size(); ++i) {
+        ThreadStateEnum state = resolveState();
+        if ( (state == eThreadStateAborted) || (state == eThreadStateStopped) ) {
+            return state;
+        }
+
+        // Finding an entry on disk maps it back to RAM and reads it ahead, the entry then stays in the memory portion
+        // of the cache. Entries that are already in RAM or not cached cost a hash lookup.
+        std::list<FrameEntryPtr> entries;
+        appPTR->getTexture(args->keys[i], &entries);
+    }
+
+    return eThreadStateActive;
+} // ViewerCachePrefetchScheduler::threadLoopOnce
+
 NATRON_NAMESPACE_EXIT
 
 NATRON_NAMESPACE_USING
@@ -28,6 +28,8 @@
 
 #include "Global/Macros.h"
 
+#include <list>
+#include <string>
 #include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
@@ -49,6 +51,9 @@
 
 //#define NATRON_PLAYBACK_USES_THREAD_POOL
 
+// Number of frames after the one being displayed whose viewer textures are brought back from the disk cache to RAM
+#define NATRON_VIEWER_CACHE_PREFETCH_FRAMES 8
+
 
 NATRON_NAMESPACE_ENTER
 
@@ -278,6 +283,12 @@ public:
      **/
     void notifyRenderFailure(const std::string& errorMessage);
 
+    /**
+     * @brief To be called by the worker threads with the memory, in bytes, that their frame may take at most
+     * (@see estimateRequestPeakMemory). The number of frames rendered concurrently is limited so that they fit in memory.
+     **/
+    void notifyFramePeakMemoryEstimate(std::size_t bytes);
+
 
     /**
      * @brief Returns the thread render arguments as set in the livingRunArgs
@@ -320,8 +331,25 @@ public:
      **/
     double getDesiredFPS() const;
 
+    /**
+     * @brief Returns the number of frames that could not be displayed on time since playback last started
+     **/
+    int getDroppedFramesCount() const;
+
+    /**
+     * @brief The signature of the before/after frame render callbacks is inspected with Python only once per render:
+     * these remember the callbacks that were found valid since the render started.
+     **/
+    bool isFrameCallbackSignatureChecked(const std::string& callback) const;
+    void setFrameCallbackSignatureChecked(const std::string& callback);
+
     void runCallbackWithVariables(const QString& callback);
 
+    /**
+     * @brief The other outputs rendered by this scheduler along with its own output, if any
+     **/
+    virtual std::list<OutputEffectInstancePtr> getSharedOutputs() const { return std::list<OutputEffectInstancePtr>(); }
+
 private Q_SLOTS:
 
     void onThreadSpawnsTimerTriggered();
@@ -360,6 +388,12 @@ protected:
      **/
     virtual bool isFPSRegulationNeeded() const { return false; }
 
+    /**
+     * @brief Are the frames rendered by this scheduler displayed to the user while it renders (i.e: viewer playback) ?
+     * If not, the render threads are given a lower priority so that they do not delay the renders that respond to user interaction.
+     **/
+    virtual bool isOutputInteractive() const { return false; }
+
     /**
      * @brief Must return the frame range to render. For the viewer this is what is indicated on the global timeline,
      * for writers this is its internal timeline.
@@ -432,6 +466,11 @@ private:
 
     void stopRender();
 
+    /**
+     * @brief Runs the after frame render Python callback of the given writer, returns false if the render failed
+     **/
+    bool runAfterFrameRenderedCallback(const OutputEffectInstancePtr& effect, int frame);
+
 
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
     /**
@@ -484,6 +523,11 @@ public:
 
     virtual ~DefaultScheduler();
 
+    /**
+     * @brief The other writers rendered with each frame of the current render, see OutputEffectInstance::setSharedPassOutputs()
+     **/
+    virtual std::list<OutputEffectInstancePtr> getSharedOutputs() const OVERRIDE FINAL;
+
 private:
 
     virtual void processFrame(const BufferedFrames& frames) OVERRIDE FINAL;
@@ -502,9 +546,21 @@ private:
     virtual SchedulingPolicyEnum getSchedulingPolicy() const OVERRIDE FINAL;
     virtual void aboutToStartRender() OVERRIDE FINAL;
     virtual void onRenderStopped(bool aborted) OVERRIDE FINAL;
+
+    // The beforeRender/afterRender Python callbacks, run for the output and each of the shared outputs
+    bool runBeforeRenderCallback(const OutputEffectInstancePtr& effect);
+    void runAfterRenderCallback(const OutputEffectInstancePtr& effect, bool aborted);
+
     OutputEffectInstanceWPtr _effect;
     mutable QMutex _currentTimeMutex;
     int _currentTime;
+
+    // The request pass of the last frame rendered, reused by the next frames if nothing changed
+    boost::scoped_ptr<FrameRequestPlanCache> _requestPlans;
+
+    // Taken from the output when the render starts
+    mutable QMutex _sharedOutputsMutex;
+    std::list<OutputEffectInstancePtr> _sharedOutputs;
 };
 
 
@@ -519,13 +575,21 @@ public:
 
     virtual ~ViewerDisplayScheduler();
 
+    /**
+     * @brief Called by the render threads with the time in seconds spent rendering a frame that was not cached.
+     * If enabled in the preferences, lowers or restores the quality of the playback so that the requested frame rate is held.
+     **/
+    void notifyFrameRenderTime(double renderTime);
+
 private:
 
+    virtual void aboutToStartRender() OVERRIDE FINAL;
     virtual void processFrame(const BufferedFrames& frames) OVERRIDE FINAL;
     virtual void timelineStepOne(RenderDirectionEnum direction) OVERRIDE FINAL;
     virtual void timelineGoTo(int time) OVERRIDE FINAL;
     virtual int timelineGetTime() const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool isFPSRegulationNeeded() const OVERRIDE FINAL WARN_UNUSED_RETURN { return true; }
+    virtual bool isOutputInteractive() const OVERRIDE FINAL WARN_UNUSED_RETURN { return true; }
 
     virtual void getFrameRangeToRender(int& first, int& last) const OVERRIDE FINAL;
 
@@ -541,6 +605,12 @@ private:
     virtual int getLastRenderedTime() const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual void onRenderStopped(bool aborted) OVERRIDE FINAL;
     ViewerInstanceWPtr _viewer;
+
+    // Adaptive playback quality, see notifyFrameRenderTime()
+    QMutex _playbackQualityMutex; // protects the members below
+    double _averageFrameRenderTime; // moving average of the render time of the frames rendered at the current draft level
+    unsigned int _playbackDraftLevel;
+    int _framesSinceDraftLevelChange;
 };
 
 /**
@@ -570,8 +640,17 @@ public:
 
     void notifyFrameProduced(const BufferableObjectPtrList& frames, const RenderStatsPtr& stats, const ViewerCurrentFrameRequestSchedulerStartArgsPtr& request);
 
+private Q_SLOTS:
+
+    /**
+     * @brief Called when no render was requested for a while after a draft render: re-render at full quality.
+     **/
+    void onDraftRefinementTimerTimeout();
+
 private:
 
+    void renderCurrentFrameInternal(bool enableRenderStats, bool canAbort, bool isDraftRefinement);
+
     virtual void onWaitForAbortCompleted() OVERRIDE FINAL;
     virtual void onWaitForThreadToQuit() OVERRIDE FINAL;
     virtual void onAbortRequested(bool keepOldestRender) OVERRIDE FINAL;
@@ -583,6 +662,14 @@ private:
      **/
     virtual TaskQueueBehaviorEnum tasksQueueBehaviour() const OVERRIDE FINAL;
 
+    /**
+     * @brief Current frame renders respond to user interaction: they must not wait behind playback or renders on disk
+     **/
+    virtual QThread::Priority getThreadPriority() const OVERRIDE FINAL
+    {
+        return QThread::HighPriority;
+    }
+
     /**
      * @brief Must be implemented to execute the work of the thread for 1 loop. This function will be called in a infinite loop by the thread
      **/
@@ -617,10 +704,94 @@ private:
         return eTaskQueueBehaviorProcessInOrder;
     }
 
+    virtual QThread::Priority getThreadPriority() const OVERRIDE FINAL
+    {
+        return QThread::HighPriority;
+    }
+
+    /**
+     * @brief Must be implemented to execute the work of the thread for 1 loop. This function will be called in a infinite loop by the thread
+     **/
+    virtual ThreadStateEnum threadLoopOnce(const GenericThreadStartArgsPtr& inArgs) OVERRIDE FINAL WARN_UNUSED_RETURN;
+};
+
+
+/**
+ * @brief Fills the viewer cache with the frames of the playback range while the user is not interacting with the viewer,
+ * so that the first playback of the range is realtime. It runs at idle priority, is aborted by any render request
+ * and stops when the viewer cache or the node cache is almost full.
+ **/
+struct ViewerCacheAheadSchedulerPrivate;
+class ViewerCacheAheadScheduler
+    : public GenericSchedulerThread
+{
+public:
+
+    ViewerCacheAheadScheduler(ViewerInstance* viewer);
+
+    virtual ~ViewerCacheAheadScheduler();
+
+    /**
+     * @brief Starts filling the cache from the frame following the current frame. Only callable on the main-thread.
+     **/
+    void fillCache();
+
+private:
+
+    /**
+     * @brief How to pick the task to process from the consumer thread
+     **/
+    virtual TaskQueueBehaviorEnum tasksQueueBehaviour() const OVERRIDE FINAL
+    {
+        return eTaskQueueBehaviorSkipToMostRecent;
+    }
+
+    virtual QThread::Priority getThreadPriority() const OVERRIDE FINAL
+    {
+        return QThread::IdlePriority;
+    }
+
+    virtual void onAbortRequested(bool keepOldestRender) OVERRIDE FINAL;
+
     /**
      * @brief Must be implemented to execute the work of the thread for 1 loop. This function will be called in a infinite loop by the thread
      **/
     virtual ThreadStateEnum threadLoopOnce(const GenericThreadStartArgsPtr& inArgs) OVERRIDE FINAL WARN_UNUSED_RETURN;
+    boost::scoped_ptr<ViewerCacheAheadSchedulerPrivate> _imp;
+};
+
+
+/**
+ * @brief Looks up the viewer cache for the textures of the frames about to be displayed, so that the ones living in
+ * the disk portion of the cache are mapped back to RAM and read ahead in the background rather than when displayed.
+ **/
+class ViewerCachePrefetchScheduler
+    : public GenericSchedulerThread
+{
+public:
+
+    ViewerCachePrefetchScheduler();
+
+    virtual ~ViewerCachePrefetchScheduler();
+
+    /**
+     * @brief Starts looking up the given keys, replacing the lookups not started yet. Callable from any thread.
+     **/
+    void prefetch(const std::vector<FrameKey>& keys);
+
+private:
+
+    virtual TaskQueueBehaviorEnum tasksQueueBehaviour() const OVERRIDE FINAL
+    {
+        return eTaskQueueBehaviorSkipToMostRecent;
+    }
+
+    virtual QThread::Priority getThreadPriority() const OVERRIDE FINAL
+    {
+        return QThread::LowPriority;
+    }
+
+    virtual ThreadStateEnum threadLoopOnce(const GenericThreadStartArgsPtr& inArgs) OVERRIDE FINAL WARN_UNUSED_RETURN;
 };
 
 
@@ -693,6 +864,22 @@ public:
      **/
     double getDesiredFPS() const;
 
+    /**
+     * @brief Returns the number of frames that could not be displayed on time since playback last started
+     **/
+    int getDroppedFramesCount() const;
+
+    /**
+     * @brief Returns the direction of the playback or of the last render of a frame range
+     **/
+    RenderDirectionEnum getSequentialRenderDirection() const;
+
+    /**
+     * @brief Brings the viewer textures with the given keys back from the disk portion of the viewer cache
+     * in the background, @see ViewerCachePrefetchScheduler. Callable from any thread.
+     **/
+    void prefetchViewerCache(const std::vector<FrameKey>& keys);
+
     /**
      * @brief Quit all processing, making sure all threads are finished, this is not blocking
      **/
@@ -786,6 +973,11 @@ public Q_SLOTS:
 
     void onCurrentFrameRenderRequestPosted();
 
+    /**
+     * @brief Called when the viewer did not receive any render request for a while: fill the cache ahead if the user enabled it
+     **/
+    void onCacheAheadTimerTimeout();
+
     void onWatcherEngineAbortedEmitted();
 
     void onWatcherEngineQuitEmitted();
@@ -840,6 +1032,9 @@ private:
 
     void renderCurrentFrameInternal(bool enableRenderStats, bool canAbort);
 
+    // The frame of the timeline of the application of the output, for RenderRequestRecorder
+    double getCurrentTimelineFrame() const;
+
 
     /**
      * The following functions are called by the OutputThreadScheduler to Q_EMIT the corresponding signals
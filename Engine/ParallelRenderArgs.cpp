@@ -25,12 +25,22 @@
 
 #include "ParallelRenderArgs.h"
 
+#include <algorithm> // min
 #include <cassert>
+#include <set>
 #include <stdexcept>
+#include <vector>
 
 #include <boost/scoped_ptr.hpp>
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
 #include "Engine/AbortableRenderInfo.h"
+#include "Engine/AppInstance.h"
 #include "Engine/AppManager.h"
 #include "Engine/Settings.h"
 #include "Engine/EffectInstance.h"
@@ -39,12 +49,395 @@
 #include "Engine/NodeGroup.h"
 #include "Engine/GPUContextPool.h"
 #include "Engine/OSGLContext.h"
+#include "Engine/Project.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
+#include "Engine/ThreadPool.h"
 #include "Engine/ViewIdx.h"
 
+// Past this number of disjoint windows requested on a frame/view, the request pass only keeps their bounding box
+#define NATRON_REQUEST_PASS_MAX_ROI_RECTS 64
+
 NATRON_NAMESPACE_ENTER
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// The frames of an input that the render functor of treeRecurseFunctor pre-renders
+struct InputPreRender
+{
+    EffectInstancePtr inputEffect;
+    int inputNb;
+    FrameRangesMap frames;
+    ImageList* inputImagesList;
+    RectD roi;
+    ParallelRenderArgsPtr frameArgs; // set if the RoI is in the request pass
+    const std::list<ImagePlaneDesc>* compsNeeded;
+    EffectInstance::RenderRoIRetCode ret;
+};
+
+struct InputPreRenderCommonArgs
+{
+    NodePtr node;
+    EffectInstancePtr effect;
+    StorageModeEnum renderStorageMode;
+    unsigned int originalMipMapLevel;
+    double time;
+    bool useScaleOneInputs;
+    bool byPassCache;
+};
+
+EffectInstance::RenderRoIRetCode
+preRenderInputFrames(const InputPreRenderCommonArgs& args,
+                     InputPreRender& input)
+{
+    ///Notify the node that we're going to render something with the input
+    EffectInstance::NotifyInputNRenderingStarted_RAII inputNIsRendering_RAII(args.node.get(), input.inputNb);
+    const double inputPar = input.inputEffect->getAspectRatio(-1);
+    RectD roi = input.roi;
+
+    ///For all views requested in input
+    for (FrameRangesMap::const_iterator viewIt = input.frames.begin(); viewIt != input.frames.end(); ++viewIt) {
+        ///For all frames in this view
+        for (U32 range = 0; range < viewIt->second.size(); ++range) {
+            int nbFramesPreFetched = 0;
+
+            // if the range bounds are not ints, the fetched images will probably anywhere within this range - no need to pre-render
+            if ( (viewIt->second[range].min != (int)viewIt->second[range].min) ||
+                 ( viewIt->second[range].max != (int)viewIt->second[range].max) ) {
+                continue;
+            }
+            for (double f = viewIt->second[range].min;
+                 f <= viewIt->second[range].max  && nbFramesPreFetched < NATRON_MAX_FRAMES_NEEDED_PRE_FETCHING;
+                 f += 1.) {
+                RenderScale scaleOne(1.);
+                RenderScale scale( Image::getScaleFromMipMapLevel(args.originalMipMapLevel) );
+
+                ///Render the input image with the bit depth of its preference
+                ImageBitDepthEnum inputPrefDepth = input.inputEffect->getBitDepth(-1);
+
+                if ( !input.compsNeeded || input.compsNeeded->empty() ) {
+                    continue;
+                }
+
+                if (input.frameArgs) {
+                    input.frameArgs->request->getFrameViewCanonicalRoI(f, viewIt->first, &roi);
+                }
+
+                RectI inputRoIPixelCoords;
+                const unsigned int upstreamMipMapLevel = args.useScaleOneInputs ? 0 : args.originalMipMapLevel;
+                const RenderScale & upstreamScale = args.useScaleOneInputs ? scaleOne : scale;
+                roi.toPixelEnclosing(upstreamMipMapLevel, inputPar, &inputRoIPixelCoords);
+
+                std::map<ImagePlaneDesc, ImagePtr> inputImgs;
+                {
+                    boost::scoped_ptr<EffectInstance::RenderRoIArgs> renderArgs;
+                    renderArgs.reset( new EffectInstance::RenderRoIArgs( f, //< time
+                                                                         upstreamScale, //< scale
+                                                                         upstreamMipMapLevel, //< mipmapLevel (redundant with the scale)
+                                                                         viewIt->first, //< view
+                                                                         args.byPassCache,
+                                                                         inputRoIPixelCoords, //< roi in pixel coordinates
+                                                                         RectD(), // < did we precompute any RoD to speed-up the call ?
+                                                                         *input.compsNeeded, //< requested comps
+                                                                         inputPrefDepth,
+                                                                         false,
+                                                                         args.effect.get(),
+                                                                         args.renderStorageMode /*returnStorage*/,
+                                                                         args.time /*callerRenderTime*/) );
+
+                    EffectInstance::RenderRoIRetCode ret;
+                    ret = input.inputEffect->renderRoI(*renderArgs, &inputImgs); //< requested bitdepth
+                    if (ret != EffectInstance::eRenderRoIRetCodeOk) {
+                        return ret;
+                    }
+                }
+                for (std::map<ImagePlaneDesc, ImagePtr>::iterator it3 = inputImgs.begin(); it3 != inputImgs.end(); ++it3) {
+                    if (input.inputImagesList && it3->second) {
+                        input.inputImagesList->push_back(it3->second);
+                    }
+                }
+
+                if ( args.effect->aborted() ) {
+                    return EffectInstance::eRenderRoIRetCodeAborted;
+                }
+
+                if ( !inputImgs.empty() ) {
+                    ++nbFramesPreFetched;
+                }
+            } // for all frames
+        } // for all ranges
+    } // for all views
+
+    return EffectInstance::eRenderRoIRetCodeOk;
+} // preRenderInputFrames
+
+/**
+ * @brief Pre-renders an input on a thread of the pool, in parallel of the other inputs (e.g: the branches of a Merge)
+ **/
+class InputPreRenderRunnable
+    : public QRunnable
+{
+    const InputPreRenderCommonArgs& _args;
+    InputPreRender& _input;
+    QThread* _spawnerThread;
+    QSemaphore* _tlsCopied;
+    QSemaphore* _done;
+
+public:
+
+    InputPreRenderRunnable(const InputPreRenderCommonArgs& args,
+                           InputPreRender& input,
+                           QThread* spawnerThread,
+                           QSemaphore* tlsCopied,
+                           QSemaphore* done)
+        : QRunnable()
+        , _args(args)
+        , _input(input)
+        , _spawnerThread(spawnerThread)
+        , _tlsCopied(tlsCopied)
+        , _done(done)
+    {
+    }
+
+    virtual ~InputPreRenderRunnable()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        // The spawner thread waits until the copy is done before it modifies its own TLS
+        appPTR->getAppTLS()->copyTLS( _spawnerThread, QThread::currentThread() );
+        _tlsCopied->release();
+        try {
+            _input.ret = preRenderInputFrames(_args, _input);
+        } catch (...) {
+            _input.ret = EffectInstance::eRenderRoIRetCodeFailed;
+        }
+        appPTR->getAppTLS()->cleanupTLSForThread();
+        _done->release();
+    }
+};
+
+// A (node, time, view) visited by the request pass, whose RoD and frames needed can be computed ahead of it
+struct RequestPassActions
+{
+    EffectInstancePtr effect;
+    double time;
+    ViewIdx view;
+    FramesNeededMap framesNeeded;
+    bool valid;
+};
+
+struct RequestPassActionsKey
+{
+    EffectInstance* effect;
+    double time;
+    int view;
+
+    bool operator<(const RequestPassActionsKey& other) const
+    {
+        if (effect != other.effect) {
+            return effect < other.effect;
+        }
+        if (time != other.time) {
+            return time < other.time;
+        }
+
+        return view < other.view;
+    }
+};
+
+void
+computeRequestPassActions(unsigned int originalMipMapLevel,
+                          RequestPassActions& item)
+{
+    item.valid = false;
+
+    // Same scale as getInputsRoIsFunctor so that it finds the results in the actions cache
+    unsigned int mappedLevel = item.effect->supportsRenderScale() ? originalMipMapLevel : 0;
+    RenderScale scale( Image::getScaleFromMipMapLevel(mappedLevel) );
+    U64 hash = item.effect->getRenderHash();
+    try {
+        RectD rod;
+        bool isProjectFormat;
+        StatusEnum stat = item.effect->getRegionOfDefinition_public(hash, item.time, scale, item.view, &rod, &isProjectFormat);
+        if (stat == eStatusFailed) {
+            return;
+        }
+        item.framesNeeded = item.effect->getFramesNeeded_public(hash, item.time, item.view, mappedLevel);
+    } catch (...) {
+        // The request pass will call the actions again and report the error
+        return;
+    }
+    item.valid = true;
+}
+
+void
+computeRequestPassActionsForItems(unsigned int originalMipMapLevel,
+                                  std::vector<RequestPassActions>& items,
+                                  QAtomicInt* nextItem)
+{
+    for (;;) {
+        int i = nextItem->fetchAndAddRelaxed(1);
+        if ( i >= (int)items.size() ) {
+            return;
+        }
+        computeRequestPassActions(originalMipMapLevel, items[i]);
+    }
+}
+
+/**
+ * @brief Computes the actions of the items of a request pass wave on a thread of the pool, in parallel of the spawner thread
+ **/
+class RequestPassActionsRunnable
+    : public QRunnable
+{
+    unsigned int _originalMipMapLevel;
+    std::vector<RequestPassActions>& _items;
+    QAtomicInt* _nextItem;
+    QThread* _spawnerThread;
+    QSemaphore* _tlsCopied;
+    QSemaphore* _done;
+
+public:
+
+    RequestPassActionsRunnable(unsigned int originalMipMapLevel,
+                               std::vector<RequestPassActions>& items,
+                               QAtomicInt* nextItem,
+                               QThread* spawnerThread,
+                               QSemaphore* tlsCopied,
+                               QSemaphore* done)
+        : QRunnable()
+        , _originalMipMapLevel(originalMipMapLevel)
+        , _items(items)
+        , _nextItem(nextItem)
+        , _spawnerThread(spawnerThread)
+        , _tlsCopied(tlsCopied)
+        , _done(done)
+    {
+    }
+
+    virtual ~RequestPassActionsRunnable()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        appPTR->getAppTLS()->copyTLS( _spawnerThread, QThread::currentThread() );
+        _tlsCopied->release();
+        computeRequestPassActionsForItems(_originalMipMapLevel, _items, _nextItem);
+        appPTR->getAppTLS()->cleanupTLSForThread();
+        _done->release();
+    }
+};
+
+/*
+   The request pass is a serial recursion, and for time-offset-heavy graphs most of its time is spent in the
+   getRegionOfDefinition and getFramesNeeded actions of the frames needed upstream. Walk the graph ahead of it,
+   one wave of (node, time, view) at a time, computing the actions of each wave on the idle threads of the pool:
+   the request pass then finds them in the actions cache. This cache is per hash, hence also shared by the request
+   passes of the other frames of a sequence render.
+   This only follows the frames needed: isIdentity depends on the RoI and is left to the request pass, which may
+   also skip nodes visited here (masks, identities...) at no other cost than the actions computed for them.
+ */
+void
+prefetchRequestPassActions(double time,
+                           ViewIdx view,
+                           unsigned int mipMapLevel,
+                           const NodePtr& treeRoot)
+{
+    int nThreadsToRender, nThreadsPerEffect;
+    appPTR->getNThreadsSettings(&nThreadsToRender, &nThreadsPerEffect);
+    if ( (nThreadsToRender == -1) || !appPTR->getUseThreadPool() || (QThreadPool::globalInstance()->maxThreadCount() <= 1) ) {
+        return;
+    }
+
+    std::set<RequestPassActionsKey> visited;
+    std::vector<RequestPassActions> wave;
+    {
+        RequestPassActions root;
+        root.effect = treeRoot->getEffectInstance();
+        root.time = time;
+        root.view = view;
+        root.valid = false;
+        if (!root.effect) {
+            return;
+        }
+        RequestPassActionsKey key = {root.effect.get(), time, view};
+        visited.insert(key);
+        wave.push_back(root);
+    }
+
+    QThread* currentThread = QThread::currentThread();
+    while ( !wave.empty() ) {
+        if ( wave.front().effect->aborted() ) {
+            return;
+        }
+
+        QAtomicInt nextItem(0);
+        QSemaphore tlsCopied, done;
+        int nStarted = 0;
+        int nRunnables = std::min( (int)wave.size() - 1, QThreadPool::globalInstance()->maxThreadCount() - 1 );
+        for (int i = 0; i < nRunnables; ++i) {
+            RequestPassActionsRunnable* runnable = new RequestPassActionsRunnable(mipMapLevel, wave, &nextItem, currentThread, &tlsCopied, &done);
+            if ( QThreadPool::globalInstance()->tryStart(runnable) ) {
+                ++nStarted;
+            } else {
+                delete runnable;
+                break;
+            }
+        }
+        tlsCopied.acquire(nStarted);
+        computeRequestPassActionsForItems(mipMapLevel, wave, &nextItem);
+        if (nStarted > 0) {
+            ThreadPoolWaitScope waitScope(currentThread);
+            done.acquire(nStarted);
+        }
+
+        // The next wave is made of the frames needed by this one that were not visited yet
+        std::vector<RequestPassActions> nextWave;
+        for (std::vector<RequestPassActions>::const_iterator it = wave.begin(); it != wave.end(); ++it) {
+            if (!it->valid) {
+                continue;
+            }
+            for (FramesNeededMap::const_iterator it2 = it->framesNeeded.begin(); it2 != it->framesNeeded.end(); ++it2) {
+                EffectInstancePtr inputEffect = it->effect->getInput(it2->first);
+                // Like getInputsRoIsFunctor, do not go through effects whose RoD never succeeded
+                if ( !inputEffect || (inputEffect->supportsRenderScaleMaybe() == EffectInstance::eSupportsMaybe) ) {
+                    continue;
+                }
+                for (FrameRangesMap::const_iterator viewIt = it2->second.begin(); viewIt != it2->second.end(); ++viewIt) {
+                    for (U32 range = 0; range < viewIt->second.size(); ++range) {
+                        if ( (viewIt->second[range].min != (int)viewIt->second[range].min) ||
+                             ( viewIt->second[range].max != (int)viewIt->second[range].max) ) {
+                            continue;
+                        }
+                        for (double f = viewIt->second[range].min; f <= viewIt->second[range].max; f += 1.) {
+                            RequestPassActionsKey key = {inputEffect.get(), f, viewIt->first};
+                            if ( !visited.insert(key).second ) {
+                                continue;
+                            }
+                            RequestPassActions input;
+                            input.effect = inputEffect;
+                            input.time = f;
+                            input.view = viewIt->first;
+                            input.valid = false;
+                            nextWave.push_back(input);
+                        }
+                    }
+                }
+            }
+        }
+        wave.swap(nextWave);
+    }
+} // prefetchRequestPassActions
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 EffectInstance::RenderRoIRetCode
 EffectInstance::treeRecurseFunctor(bool isRenderFunctor,
                                    const NodePtr& node,
@@ -72,6 +465,7 @@ EffectInstance::treeRecurseFunctor(bool isRenderFunctor,
     typedef std::map<EffectInstancePtr, std::pair</*inputNb*/ int, FrameRangesMap> > PreRenderFrames;
 
     PreRenderFrames framesToRender;
+    std::vector<InputPreRender> inputsToRender;
     //Add frames needed to the frames to render
     for (FramesNeededMap::const_iterator it = framesNeeded.begin(); it != framesNeeded.end(); ++it) {
         int inputNb = it->first;
@@ -198,17 +592,24 @@ EffectInstance::treeRecurseFunctor(bool isRenderFunctor,
         }
 
 
-        const double inputPar = inputEffect->getAspectRatio(-1);
-
-
-        {
-            ///Notify the node that we're going to render something with the input
-            EffectInstance::NotifyInputNRenderingStarted_RAIIPtr inputNIsRendering_RAII;
-            if (isRenderFunctor) {
-                assert(it->second.first != -1); //< see getInputNumber
-                inputNIsRendering_RAII.reset( new EffectInstance::NotifyInputNRenderingStarted_RAII(node.get(), inputNb) );
+        if (isRenderFunctor) {
+            assert(it->second.first != -1); //< see getInputNumber
+            InputPreRender input;
+            input.inputEffect = inputEffect;
+            input.inputNb = inputNb;
+            input.frames = it->second.second;
+            input.inputImagesList = inputImagesList;
+            input.roi = roi;
+            if (roiIsInRequestPass) {
+                input.frameArgs = frameArgs;
             }
+            input.compsNeeded = compsNeeded;
+            input.ret = EffectInstance::eRenderRoIRetCodeOk;
+            inputsToRender.push_back(input);
+            continue;
+        }
 
+        {
             ///For all views requested in input
             for (FrameRangesMap::const_iterator viewIt = it->second.second.begin(); viewIt != it->second.second.end(); ++viewIt) {
                 ///For all frames in this view
@@ -221,87 +622,99 @@ EffectInstance::treeRecurseFunctor(bool isRenderFunctor,
                         for (double f = viewIt->second[range].min;
                              f <= viewIt->second[range].max  && nbFramesPreFetched < NATRON_MAX_FRAMES_NEEDED_PRE_FETCHING;
                              f += 1.) {
-                            if (!isRenderFunctor) {
-                                StatusEnum stat = EffectInstance::getInputsRoIsFunctor(useTransforms,
-                                                                                       f,
-                                                                                       viewIt->first,
-                                                                                       originalMipMapLevel,
-                                                                                       inputNode,
-                                                                                       node,
-                                                                                       treeRoot,
-                                                                                       roi,
-                                                                                       *requests);
-
-                                if (stat == eStatusFailed) {
-                                    return EffectInstance::eRenderRoIRetCodeFailed;
-                                }
-
-                                ///Do not count frames pre-fetched in RoI functor mode, it is harmless and may
-                                ///limit calculations that will be done later on anyway.
-                            } else {
-                                RenderScale scaleOne(1.);
-                                RenderScale scale( Image::getScaleFromMipMapLevel(originalMipMapLevel) );
-
-                                ///Render the input image with the bit depth of its preference
-                                ImageBitDepthEnum inputPrefDepth = inputEffect->getBitDepth(-1);
-
-                                if ( !compsNeeded || compsNeeded->empty() ) {
-                                    continue;
-                                }
-
-                                if (roiIsInRequestPass) {
-                                    frameArgs->request->getFrameViewCanonicalRoI(f, viewIt->first, &roi);
-                                }
-
-                                RectI inputRoIPixelCoords;
-                                const unsigned int upstreamMipMapLevel = useScaleOneInputs ? 0 : originalMipMapLevel;
-                                const RenderScale & upstreamScale = useScaleOneInputs ? scaleOne : scale;
-                                roi.toPixelEnclosing(upstreamMipMapLevel, inputPar, &inputRoIPixelCoords);
-
-                                std::map<ImagePlaneDesc, ImagePtr> inputImgs;
-                                {
-                                    boost::scoped_ptr<EffectInstance::RenderRoIArgs> renderArgs;
-                                    renderArgs.reset( new EffectInstance::RenderRoIArgs( f, //< time
-                                                                                         upstreamScale, //< scale
-                                                                                         upstreamMipMapLevel, //< mipmapLevel (redundant with the scale)
-                                                                                         viewIt->first, //< view
-                                                                                         byPassCache,
-                                                                                         inputRoIPixelCoords, //< roi in pixel coordinates
-                                                                                         RectD(), // < did we precompute any RoD to speed-up the call ?
-                                                                                         *compsNeeded, //< requested comps
-                                                                                         inputPrefDepth,
-                                                                                         false,
-                                                                                         effect.get(),
-                                                                                         renderStorageMode /*returnStorage*/,
-                                                                                         time /*callerRenderTime*/) );
-
-                                    EffectInstance::RenderRoIRetCode ret;
-                                    ret = inputEffect->renderRoI(*renderArgs, &inputImgs); //< requested bitdepth
-                                    if (ret != EffectInstance::eRenderRoIRetCodeOk) {
-                                        return ret;
-                                    }
-                                }
-                                for (std::map<ImagePlaneDesc, ImagePtr>::iterator it3 = inputImgs.begin(); it3 != inputImgs.end(); ++it3) {
-                                    if (inputImagesList && it3->second) {
-                                        inputImagesList->push_back(it3->second);
-                                    }
-                                }
-
-                                if ( effect->aborted() ) {
-                                    return EffectInstance::eRenderRoIRetCodeAborted;
-                                }
-
-                                if ( !inputImgs.empty() ) {
-                                    ++nbFramesPreFetched;
-                                }
-                            } // if (!isRenderFunctor) {
+                            StatusEnum stat = EffectInstance::getInputsRoIsFunctor(useTransforms,
+                                                                                   f,
+                                                                                   viewIt->first,
+                                                                                   originalMipMapLevel,
+                                                                                   inputNode,
+                                                                                   node,
+                                                                                   treeRoot,
+                                                                                   roi,
+                                                                                   *requests);
+
+                            if (stat == eStatusFailed) {
+                                return EffectInstance::eRenderRoIRetCodeFailed;
+                            }
+
+                            ///Do not count frames pre-fetched in RoI functor mode, it is harmless and may
+                            ///limit calculations that will be done later on anyway.
                         } // for all frames
                     }
                 } // for all ranges
             } // for all views
-        } // EffectInstance::NotifyInputNRenderingStarted_RAII
+        }
     } // for all inputs
-    return EffectInstance::eRenderRoIRetCodeOk;
+
+    if ( inputsToRender.empty() ) {
+        return EffectInstance::eRenderRoIRetCodeOk;
+    }
+
+    InputPreRenderCommonArgs args;
+    args.node = node;
+    args.effect = effect;
+    args.renderStorageMode = renderStorageMode;
+    args.originalMipMapLevel = originalMipMapLevel;
+    args.time = time;
+    args.useScaleOneInputs = useScaleOneInputs;
+    args.byPassCache = byPassCache;
+
+    /*
+       Each input is pre-rendered by its own calls to renderRoI (e.g: the branches of a Merge): hand all of them but the first
+       to idle threads of the pool while this thread renders the others. An input is only handed to the pool if a thread can
+       start it right away, otherwise it is rendered here. Upstream nodes shared by several inputs are synchronized by the cache.
+       OpenGL renders are bound to the context of this thread.
+     */
+    int nThreadsToRender, nThreadsPerEffect;
+    appPTR->getNThreadsSettings(&nThreadsToRender, &nThreadsPerEffect);
+    const bool renderInParallel = (inputsToRender.size() > 1) && (renderStorageMode == eStorageModeRAM) && (nThreadsToRender != -1) && appPTR->getUseThreadPool();
+    std::vector<bool> startedOnPool(inputsToRender.size(), false);
+    QSemaphore tlsCopied, done;
+    int nStarted = 0;
+    if (renderInParallel) {
+        QThread* currentThread = QThread::currentThread();
+        for (std::size_t i = 1; i < inputsToRender.size(); ++i) {
+            InputPreRenderRunnable* runnable = new InputPreRenderRunnable(args, inputsToRender[i], currentThread, &tlsCopied, &done);
+            if ( QThreadPool::globalInstance()->tryStart(runnable) ) {
+                startedOnPool[i] = true;
+                ++nStarted;
+            } else {
+                delete runnable;
+                break;
+            }
+        }
+        tlsCopied.acquire(nStarted);
+    }
+
+    EffectInstance::RenderRoIRetCode ret = EffectInstance::eRenderRoIRetCodeOk;
+    try {
+        for (std::size_t i = 0; i < inputsToRender.size(); ++i) {
+            if (startedOnPool[i]) {
+                continue;
+            }
+            ret = preRenderInputFrames(args, inputsToRender[i]);
+            if (ret != EffectInstance::eRenderRoIRetCodeOk) {
+                break;
+            }
+        }
+    } catch (...) {
+        // The runnables reference inputsToRender
+        done.acquire(nStarted);
+        throw;
+    }
+
+    if (nStarted > 0) {
+        {
+            ThreadPoolWaitScope waitScope( QThread::currentThread() );
+            done.acquire(nStarted);
+        }
+        for (std::size_t i = 0; i < inputsToRender.size() && ret == EffectInstance::eRenderRoIRetCodeOk; ++i) {
+            if (startedOnPool[i]) {
+                ret = inputsToRender[i].ret;
+            }
+        }
+    }
+
+    return ret;
 } // EffectInstance::treeRecurseFunctor
 
 StatusEnum
@@ -356,7 +769,7 @@ EffectInstance::getInputsRoIsFunctor(bool useTransforms,
     FrameViewRequest* fvRequest = 0;
     NodeFrameViewRequestData::iterator foundFrameView = nodeRequest->frames.find(frameView);
     double par = effect->getAspectRatio(-1);
-    ViewInvarianceLevel viewInvariance = effect->isViewInvariant();
+    ViewInvarianceLevel viewInvariance = effect->getCurrentRenderViewInvariance();
 
 
     if ( foundFrameView != nodeRequest->frames.end() ) {
@@ -419,7 +832,7 @@ EffectInstance::getInputsRoIsFunctor(bool useTransforms,
 
 
     bool finalRoIEmpty = fvRequest->finalData.finalRoi.isNull();
-    if (!finalRoIEmpty && fvRequest->finalData.finalRoi.contains(canonicalRenderWindow)) {
+    if ( !finalRoIEmpty && fvRequest->finalData.finalRoiRegion.contains(canonicalRenderWindow) ) {
         // Do not recurse if the roi did not add anything new to render
         return eStatusOK;
     }
@@ -428,6 +841,11 @@ EffectInstance::getInputsRoIsFunctor(bool useTransforms,
     } else {
         fvRequest->finalData.finalRoi.merge(canonicalRenderWindow);
     }
+    fvRequest->finalData.finalRoiRegion.unite(canonicalRenderWindow);
+    if (fvRequest->finalData.finalRoiRegion.getRectsCount() > NATRON_REQUEST_PASS_MAX_ROI_RECTS) {
+        // Too fragmented to be worth it, fallback to the bounding box
+        fvRequest->finalData.finalRoiRegion = RegionD(fvRequest->finalData.finalRoi);
+    }
 
     if (fvRequest->globalData.identityInputNb == -2) {
         assert(fvRequest->globalData.inputIdentityTime != time || viewInvariance == eViewInvarianceAllViewsInvariant);
@@ -542,6 +960,8 @@ EffectInstance::computeRequestPass(double time,
                                    const NodePtr& treeRoot,
                                    FrameRequestMap& request)
 {
+    prefetchRequestPassActions(time, view, mipMapLevel, treeRoot);
+
     bool doTransforms = appPTR->getCurrentSettings()->isTransformConcatenationEnabled();
     StatusEnum stat = getInputsRoIsFunctor(doTransforms,
                                            time,
@@ -610,6 +1030,211 @@ NodeFrameRequest::getFrameViewCanonicalRoI(double time,
     return true;
 }
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// Returns true if the plan only involves the rendered time and nodes that are not animated
+bool
+isRequestPlanShiftable(double time,
+                       const FrameRequestMap& request)
+{
+    for (FrameRequestMap::const_iterator it = request.begin(); it != request.end(); ++it) {
+        EffectInstancePtr effect = it->first->getEffectInstance();
+        if ( !effect || effect->getHasAnimation() || it->first->getRotoContext() || it->first->getAttachedRotoItem() ) {
+            return false;
+        }
+        for (NodeFrameViewRequestData::const_iterator it2 = it->second->frames.begin(); it2 != it->second->frames.end(); ++it2) {
+            const FrameViewRequestGlobalData& data = it2->second.globalData;
+            if ( (it2->first.time != time) || ( data.isIdentity && (data.inputIdentityTime != time) ) ) {
+                return false;
+            }
+            for (FramesNeededMap::const_iterator it3 = data.frameViewsNeeded.begin(); it3 != data.frameViewsNeeded.end(); ++it3) {
+                for (FrameRangesMap::const_iterator it4 = it3->second.begin(); it4 != it3->second.end(); ++it4) {
+                    for (std::size_t i = 0; i < it4->second.size(); ++i) {
+                        if ( (it4->second[i].min != time) || (it4->second[i].max != time) ) {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+FrameRequestPlanCache::FrameRequestPlanCache()
+    : _plansMutex()
+    , _plans()
+{
+}
+
+FrameRequestPlanCache::~FrameRequestPlanCache()
+{
+}
+
+void
+FrameRequestPlanCache::clear()
+{
+    QMutexLocker k(&_plansMutex);
+
+    _plans.clear();
+}
+
+bool
+FrameRequestPlanCache::getShiftedPlan(double time,
+                                      ViewIdx view,
+                                      unsigned int mipMapLevel,
+                                      const RectD& renderWindow,
+                                      const NodePtr& treeRoot,
+                                      FrameRequestMap* request)
+{
+    Plan plan;
+    {
+        QMutexLocker k(&_plansMutex);
+        std::map<PlanKey, Plan>::const_iterator found = _plans.find( std::make_pair(treeRoot.get(), view) );
+        if ( found == _plans.end() ) {
+            return false;
+        }
+        plan = found->second;
+    }
+    if ( (plan.mipMapLevel != mipMapLevel) || (plan.renderWindow != renderWindow) || (plan.treeRoot.lock() != treeRoot) ) {
+        return false;
+    }
+    if (plan.time == time) {
+        *request = plan.request;
+
+        return true;
+    }
+
+    FrameRequestMap shifted;
+    for (FrameRequestMap::const_iterator it = plan.request.begin(); it != plan.request.end(); ++it) {
+        EffectInstancePtr effect = it->first->getEffectInstance();
+        if ( !effect || effect->getHasAnimation() ) {
+            return false;
+        }
+        U64 hash = effect->getRenderHash();
+        if (hash != it->second->nodeHash) {
+            return false;
+        }
+
+        NodeFrameRequestPtr nodeRequest = boost::make_shared<NodeFrameRequest>();
+        nodeRequest->nodeHash = hash;
+        nodeRequest->mappedScale = it->second->mappedScale;
+        unsigned int mappedLevel = effect->supportsRenderScale() ? mipMapLevel : 0;
+        double par = effect->getAspectRatio(-1);
+        ViewInvarianceLevel viewInvariance = effect->getCurrentRenderViewInvariance();
+
+        for (NodeFrameViewRequestData::const_iterator it2 = it->second->frames.begin(); it2 != it->second->frames.end(); ++it2) {
+            const FrameViewRequestGlobalData& data = it2->second.globalData;
+
+            // The RoD and identity may change over time even if nothing is animated (e.g: a Reader, a frame range), check them
+            RectD rod;
+            bool isProjectFormat;
+            StatusEnum stat = effect->getRegionOfDefinition_public(hash, time, nodeRequest->mappedScale, it2->first.view, &rod, &isProjectFormat);
+            if ( (stat == eStatusFailed) || (rod != data.rod) ) {
+                return false;
+            }
+            if ( (it2->first.view == 0) || (viewInvariance != eViewInvarianceAllViewsInvariant) ) {
+                RectI identityRegionPixel;
+                it2->second.finalData.finalRoi.toPixelEnclosing(mappedLevel, par, &identityRegionPixel);
+                double inputIdentityTime = 0.;
+                ViewIdx identityView = it2->first.view;
+                int identityInputNb = -1;
+                bool isIdentity;
+                try {
+                    isIdentity = effect->isIdentity_public(true, hash, time, nodeRequest->mappedScale, identityRegionPixel, it2->first.view, &inputIdentityTime, &identityView, &identityInputNb);
+                } catch (...) {
+                    return false;
+                }
+                if ( (isIdentity != data.isIdentity) ||
+                     ( isIdentity && ( (identityInputNb != data.identityInputNb) || (identityView != data.identityView) || (inputIdentityTime != time) ) ) ) {
+                    return false;
+                }
+            }
+
+            FrameViewPair frameView;
+            frameView.time = time;
+            frameView.view = it2->first.view;
+            FrameViewRequest& fvRequest = nodeRequest->frames[frameView];
+            fvRequest = it2->second;
+            fvRequest.globalData.isProjectFormat = isProjectFormat;
+            if (fvRequest.globalData.isIdentity) {
+                fvRequest.globalData.inputIdentityTime = time;
+            }
+            for (FramesNeededMap::iterator it3 = fvRequest.globalData.frameViewsNeeded.begin(); it3 != fvRequest.globalData.frameViewsNeeded.end(); ++it3) {
+                for (FrameRangesMap::iterator it4 = it3->second.begin(); it4 != it3->second.end(); ++it4) {
+                    for (std::size_t i = 0; i < it4->second.size(); ++i) {
+                        it4->second[i].min = it4->second[i].max = time;
+                    }
+                }
+            }
+        }
+        shifted.insert( std::make_pair(it->first, nodeRequest) );
+    }
+    request->swap(shifted);
+
+    return true;
+} // FrameRequestPlanCache::getShiftedPlan
+
+void
+FrameRequestPlanCache::setPlan(double time,
+                               ViewIdx view,
+                               unsigned int mipMapLevel,
+                               const RectD& renderWindow,
+                               const NodePtr& treeRoot,
+                               const FrameRequestMap& request)
+{
+    bool shiftable = isRequestPlanShiftable(time, request);
+    QMutexLocker k(&_plansMutex);
+
+    if (!shiftable) {
+        _plans.erase( std::make_pair(treeRoot.get(), view) );
+
+        return;
+    }
+    Plan& plan = _plans[std::make_pair(treeRoot.get(), view)];
+    plan.time = time;
+    plan.mipMapLevel = mipMapLevel;
+    plan.renderWindow = renderWindow;
+    plan.treeRoot = treeRoot;
+    plan.request = request;
+}
+
+std::size_t
+estimateRequestPeakMemory(const FrameRequestMap& request,
+                          unsigned int mipMapLevel,
+                          std::size_t bytesPerPixel)
+{
+    std::size_t ret = 0;
+
+    for (FrameRequestMap::const_iterator it = request.begin(); it != request.end(); ++it) {
+        EffectInstancePtr effect = it->first->getEffectInstance();
+        if (!effect) {
+            continue;
+        }
+        unsigned int mappedLevel = effect->supportsRenderScale() ? mipMapLevel : 0;
+        double par = effect->getAspectRatio(-1);
+        for (NodeFrameViewRequestData::const_iterator it2 = it->second->frames.begin(); it2 != it->second->frames.end(); ++it2) {
+            if (it2->second.globalData.isIdentity) {
+                continue;
+            }
+            const std::vector<RectD>& rects = it2->second.finalData.finalRoiRegion.getRects();
+            for (std::size_t i = 0; i < rects.size(); ++i) {
+                RectI roiPixel;
+                rects[i].toPixelEnclosing(mappedLevel, par, &roiPixel);
+                if ( roiPixel.isNull() ) {
+                    continue;
+                }
+                ret += (std::size_t)roiPixel.area() * bytesPerPixel;
+            }
+        }
+    }
+
+    return ret;
+}
+
 struct FindDependenciesNode
 {
     bool recursed;
@@ -687,6 +1312,58 @@ getAllUpstreamNodesRecursiveWithDependencies_internal(const NodePtr& node,
 } // getAllUpstreamNodesRecursiveWithDependencies_internal
 
 
+/**
+ * @brief Returns true if the node renders the same image for all views: either its plug-in says so, or it does not know about
+ * views, none of its parameters has an expression (which may read the view) and all its inputs are view invariant too.
+ * Readers and outputs never are: the files they read or write depend on the view.
+ **/
+static bool
+isViewInvariantRecursive(const NodePtr& node,
+                         std::map<NodePtr, bool>* visited)
+{
+    std::map<NodePtr, bool>::const_iterator found = visited->find(node);
+
+    if ( found != visited->end() ) {
+        return found->second;
+    }
+    // Mark it first so that an unexpected cycle does not recurse forever
+    (*visited)[node] = false;
+
+    EffectInstancePtr effect = node->getEffectInstance();
+    if (!effect) {
+        return false;
+    }
+    if (effect->isViewInvariant() == EffectInstance::eViewInvarianceAllViewsInvariant) {
+        (*visited)[node] = true;
+
+        return true;
+    }
+    if ( effect->isViewAware() || effect->isReader() || effect->isWriter() || effect->isOutput() ) {
+        return false;
+    }
+
+    const KnobsVec& knobs = effect->getKnobs();
+    for (KnobsVec::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+        int nDims = (*it)->getDimension();
+        for (int i = 0; i < nDims; ++i) {
+            if ( !(*it)->getExpression(i).empty() ) {
+                return false;
+            }
+        }
+    }
+
+    int maxInputs = node->getNInputs();
+    for (int i = 0; i < maxInputs; ++i) {
+        NodePtr inputNode = node->getInput(i);
+        if ( inputNode && !isViewInvariantRecursive(inputNode, visited) ) {
+            return false;
+        }
+    }
+    (*visited)[node] = true;
+
+    return true;
+} // isViewInvariantRecursive
+
 ParallelRenderArgsSetter::ParallelRenderArgsSetter(double time,
                                                    ViewIdx view,
                                                    bool isRenderUserInteraction,
@@ -719,6 +1396,10 @@ ParallelRenderArgsSetter::ParallelRenderArgsSetter(double time,
     FindDependenciesMap dependenciesMap;
     getAllUpstreamNodesRecursiveWithDependencies_internal(treeRoot, dependenciesMap);
 
+    // Only views other than the main view may be rendered by rendering the main view instead
+    const bool detectViewInvariance = (view != 0) && treeRoot->getApp() && (treeRoot->getApp()->getProject()->getProjectViewsCount() > 1);
+    std::map<NodePtr, bool> viewInvariantNodes;
+
 
     for (FindDependenciesMap::iterator it = dependenciesMap.begin(); it != dependenciesMap.end(); ++it) {
 
@@ -741,6 +1422,12 @@ ParallelRenderArgsSetter::ParallelRenderArgsSetter(double time,
             liveInstance->setParallelRenderArgsTLS(time, view, isRenderUserInteraction, isSequential, nodeHash,
                                                    abortInfo, treeRoot, it->second.visitCounter, NodeFrameRequestPtr(), glContext,  textureIndex, timeline, isAnalysis, duringPaintStrokeCreation, rotoPaintNodes, safety, glSupport, doNanHandling, draftMode, stats);
         }
+        if ( detectViewInvariance && (node != treeRoot) && rotoPaintNodes.empty() ) {
+            ParallelRenderArgsPtr frameArgs = liveInstance->getParallelRenderArgsTLS();
+            if (frameArgs) {
+                frameArgs->viewInvariant = isViewInvariantRecursive(node, &viewInvariantNodes);
+            }
+        }
         for (NodesList::iterator it2 = rotoPaintNodes.begin(); it2 != rotoPaintNodes.end(); ++it2) {
             U64 nodeHash = (*it2)->getHashValue();
 
@@ -884,8 +1571,10 @@ ParallelRenderArgs::ParallelRenderArgs()
     , visitsCount(0)
     , rotoPaintNodes()
     , stats()
+    , knobsValues()
     , openGLContext()
     , textureIndex(0)
+    , requestedChannels()
     , currentThreadSafety(eRenderSafetyInstanceSafe)
     , currentOpenglSupport(ePluginOpenGLRenderSupportNone)
     , isRenderResponseToUserInteraction(false)
@@ -895,7 +1584,9 @@ ParallelRenderArgs::ParallelRenderArgs()
     , doNansHandling(true)
     , draftMode(false)
     , tilesSupported(false)
+    , viewInvariant(false)
 {
+    requestedChannels.set();
 }
 
 bool
@@ -906,4 +1597,30 @@ ParallelRenderArgs::isCurrentFrameRenderNotAbortable() const
     return isRenderResponseToUserInteraction && ( !info || !info->canAbort() );
 }
 
+KnobsValuesSnapshot::KnobsValuesSnapshot()
+    : time(0)
+    , view(0)
+    , values()
+{
+}
+
+bool
+KnobsValuesSnapshot::getValue(const KnobI* knob,
+                              double time,
+                              ViewSpec view,
+                              int dimension,
+                              double* value) const
+{
+    if ( (time != this->time) || ( !view.isCurrent() && ( !view.isViewIdx() || ( view.value() != this->view.value() ) ) ) ) {
+        return false;
+    }
+    std::map<const KnobI*, std::vector<double> >::const_iterator found = values.find(knob);
+    if ( ( found == values.end() ) || (dimension < 0) || ( dimension >= (int)found->second.size() ) ) {
+        return false;
+    }
+    *value = found->second[dimension];
+
+    return true;
+}
+
 NATRON_NAMESPACE_EXIT
@@ -29,17 +29,22 @@
 #include "Global/Macros.h"
 
 #include <set>
+#include <bitset>
 #include <map>
 #include <list>
+#include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 #endif
 
+#include <QtCore/QMutex>
+
 #include "Global/GlobalDefines.h"
 
 #include "Engine/RectD.h"
+#include "Engine/Region.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
 
@@ -69,6 +74,32 @@ typedef boost::shared_ptr<InputMatrixMap> InputMatrixMapPtr;
 
 class NodeFrameRequest;
 
+/**
+ * @brief The values of the numeric parameters of a node at the time and view of a frame render, taken once when the render
+ * of the frame is set up so that the render threads can read them without taking the locks of the knobs and curves.
+ * Knobs with an expression are not in the snapshot and are always evaluated.
+ * This is immutable once created, hence MT-safe.
+ **/
+class KnobsValuesSnapshot
+{
+public:
+
+    double time;
+    ViewIdx view;
+
+    // Clamped values of each dimension
+    std::map<const KnobI*, std::vector<double> > values;
+
+    KnobsValuesSnapshot();
+
+    /**
+     * @brief Returns true and sets value if the knob is in the snapshot and the time and view are the ones of the snapshot
+     **/
+    bool getValue(const KnobI* knob, double time, ViewSpec view, int dimension, double* value) const WARN_UNUSED_RETURN;
+};
+
+typedef boost::shared_ptr<const KnobsValuesSnapshot> KnobsValuesSnapshotConstPtr;
+
 /**
  * @brief Thread-local arguments given to render a frame by the tree.
  * This is different than the RenderArgs because it is not local to a
@@ -118,12 +149,19 @@ public:
     ///Various stats local to the render of a frame
     RenderStatsPtr stats;
 
+    ///The values of the node parameters at time/view, NULL if the parameters may change during the render
+    KnobsValuesSnapshotConstPtr knobsValues;
+
     ///The OpenGL context to use for the render of this frame
     OSGLContextWPtr openGLContext;
 
     ///The texture index of the viewer being rendered, only useful for abortable renders
     int textureIndex;
 
+    ///The channels (R,G,B,A) of the output of this node needed by the tree root, e.g the channel displayed by the viewer.
+    ///When not all set, a node using the host channel selector only processes these channels.
+    std::bitset<4> requestedChannels;
+
     ///Current thread safety: it might change in the case of the rotopaint: while drawing, the safety is instance safe,
     ///whereas afterwards we revert back to the plug-in thread safety
     RenderSafetyEnum currentThreadSafety;
@@ -153,6 +191,10 @@ public:
     ///The support for tiles is local to a render and may change depending on GPU usage or other parameters
     bool tilesSupported : 1;
 
+    ///When true, this node and all nodes upstream render the same image for all views: views other than
+    ///the main view are rendered by rendering the main view, so that the images are shared in the cache
+    bool viewInvariant : 1;
+
     ParallelRenderArgs();
 
     bool isCurrentFrameRenderNotAbortable() const;
@@ -186,7 +228,11 @@ struct FrameViewRequestGlobalData
 
 struct FrameViewRequestFinalData
 {
+    ///Bounding box of all the windows requested on this frame/view
     RectD finalRoi;
+
+    ///The requested windows themselves, so that disjoint requests do not render the area in-between
+    RegionD finalRoiRegion;
 };
 
 struct FrameViewPerRequestData
@@ -245,6 +291,69 @@ public:
 
 typedef std::map<NodePtr, NodeFrameRequestPtr> FrameRequestMap;
 
+/**
+ * @brief Returns an upper bound of the memory, in bytes, taken by the images rendered for the given request pass at the given
+ * mipmap level if all of them were alive at the same time. Identity frames are not counted since they do not render any image.
+ **/
+std::size_t estimateRequestPeakMemory(const FrameRequestMap& request, unsigned int mipMapLevel, std::size_t bytesPerPixel);
+
+/**
+ * @brief Keeps the request pass of the last frame rendered by a sequence render, per tree and view, so that the next frames
+ * can reuse it shifted in time instead of running computeRequestPass again.
+ * A plan is only reused if it never leaves the frame being rendered (no time offset, no identity at another time),
+ * none of its nodes is animated and, at the new time, all of them still have the same hash, RoD and identity.
+ * The frames needed, transforms and regions of interest are then carried over from the previous frame.
+ * This class is MT-safe: the frames of a sequence are rendered concurrently.
+ **/
+class FrameRequestPlanCache
+{
+public:
+
+    FrameRequestPlanCache();
+
+    ~FrameRequestPlanCache();
+
+    void clear();
+
+    /**
+     * @brief Returns true and fills request with the last plan of this view shifted to the given time
+     * if it can be reused. This must be called within the ParallelRenderArgsSetter of the frame.
+     **/
+    bool getShiftedPlan(double time,
+                        ViewIdx view,
+                        unsigned int mipMapLevel,
+                        const RectD& renderWindow,
+                        const NodePtr& treeRoot,
+                        FrameRequestMap* request) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Records the request pass computed for the given frame
+     **/
+    void setPlan(double time,
+                 ViewIdx view,
+                 unsigned int mipMapLevel,
+                 const RectD& renderWindow,
+                 const NodePtr& treeRoot,
+                 const FrameRequestMap& request);
+
+private:
+
+    struct Plan
+    {
+        double time;
+        unsigned int mipMapLevel;
+        RectD renderWindow;
+        NodeWPtr treeRoot;
+        FrameRequestMap request;
+    };
+
+    // Keyed by tree root, a sequence render may render several outputs per frame
+    typedef std::pair<const Node*, ViewIdx> PlanKey;
+
+    mutable QMutex _plansMutex;
+    std::map<PlanKey, Plan> _plans;
+};
+
 
 class ParallelRenderArgsSetter
 {
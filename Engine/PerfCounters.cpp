@@ -0,0 +1,117 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "PerfCounters.h"
+
+#include <cassert>
+
+#include <boost/atomic.hpp>
+
+#include <QtCore/QThread>
+
+// Number of copies of each counter, picked from the calling thread
+#define NATRON_PERF_COUNTERS_SHARDS_COUNT 16
+
+// Size of a cache line: each shard is aligned on it so that threads incrementing different shards do not contend
+#define NATRON_PERF_COUNTERS_CACHE_LINE_SIZE 64
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct CountersShard
+{
+    boost::atomic<U64> counters[ePerfCounterCount];
+    char padding[NATRON_PERF_COUNTERS_CACHE_LINE_SIZE];
+
+    CountersShard()
+    {
+        for (int i = 0; i < ePerfCounterCount; ++i) {
+            counters[i].store(0, boost::memory_order_relaxed);
+        }
+    }
+};
+
+// Statically initialized before main(): no thread can race on its construction
+CountersShard countersShards[NATRON_PERF_COUNTERS_SHARDS_COUNT];
+
+const char* countersNames[ePerfCounterCount] = {
+    "cacheHits",
+    "cacheMisses",
+    "cacheEvictions",
+    "renderRoICalls",
+    "framesRendered",
+    "rendersAborted",
+    "bytesUploadedToGPU",
+};
+
+CountersShard&
+getCurrentThreadShard()
+{
+    // Thread ids are aligned pointers on most systems: drop the low bits
+    quintptr threadId = (quintptr)QThread::currentThreadId();
+
+    return countersShards[(threadId >> 4) % NATRON_PERF_COUNTERS_SHARDS_COUNT];
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+PerfCounters::increment(PerfCounterEnum counter,
+                        U64 amount)
+{
+    assert(counter >= 0 && counter < ePerfCounterCount);
+    getCurrentThreadShard().counters[counter].fetch_add(amount, boost::memory_order_relaxed);
+}
+
+U64
+PerfCounters::getValue(PerfCounterEnum counter)
+{
+    assert(counter >= 0 && counter < ePerfCounterCount);
+    U64 ret = 0;
+    for (int i = 0; i < NATRON_PERF_COUNTERS_SHARDS_COUNT; ++i) {
+        ret += countersShards[i].counters[counter].load(boost::memory_order_relaxed);
+    }
+
+    return ret;
+}
+
+const char*
+PerfCounters::getName(PerfCounterEnum counter)
+{
+    assert(counter >= 0 && counter < ePerfCounterCount);
+
+    return countersNames[counter];
+}
+
+void
+PerfCounters::getValues(std::map<std::string, U64>* values)
+{
+    for (int i = 0; i < ePerfCounterCount; ++i) {
+        (*values)[countersNames[i]] = getValue( (PerfCounterEnum)i );
+    }
+}
+
+NATRON_NAMESPACE_EXIT
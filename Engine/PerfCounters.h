@@ -0,0 +1,78 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_PERFCOUNTERS_H
+#define NATRON_ENGINE_PERFCOUNTERS_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <map>
+#include <string>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+enum PerfCounterEnum
+{
+    ePerfCounterCacheHits = 0,
+    ePerfCounterCacheMisses,
+    ePerfCounterCacheEvictions,
+    ePerfCounterRenderRoICalls,
+    ePerfCounterFramesRendered,
+    ePerfCounterRendersAborted,
+    ePerfCounterBytesUploadedToGPU,
+    ePerfCounterCount
+};
+
+/**
+ * @brief Process-wide counters of the engine activity, always enabled. Incrementing a counter is a relaxed atomic
+ * add on a shard picked from the calling thread, so that threads incrementing the same counter do not share a cache line.
+ * Reading a counter sums its shards. All functions are MT-safe.
+ **/
+class PerfCounters
+{
+public:
+
+    static void increment(PerfCounterEnum counter, U64 amount = 1);
+
+    static U64 getValue(PerfCounterEnum counter);
+
+    /**
+     * @brief The name of the counter as exposed to Python, e.g: "cacheHits"
+     **/
+    static const char* getName(PerfCounterEnum counter);
+
+    /**
+     * @brief Returns all the counters by name
+     **/
+    static void getValues(std::map<std::string, U64>* values);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_PERFCOUNTERS_H
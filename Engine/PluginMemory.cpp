@@ -86,10 +86,17 @@ PluginMemory::alloc(size_t nBytes)
     if (_imp->locked) {
         return false;
     } else {
+        U64 oldSize = _imp->data.size();
         _imp->data.resize(nBytes);
+        // Only account the difference, so that re-allocating the same amount does not notify the node
+        U64 newSize = _imp->data.size();
         EffectInstancePtr e = _imp->effect.lock();
         if (e) {
-            e->registerPluginMemory( _imp->data.size() );
+            if (newSize > oldSize) {
+                e->registerPluginMemory(newSize - oldSize);
+            } else if (newSize < oldSize) {
+                e->unregisterPluginMemory(oldSize - newSize);
+            }
         }
 
         return true;
@@ -242,8 +242,10 @@ PrecompNode::initializeKnobs()
                                         "by the node indicated by \"Write Node\". If no Write is selected, or if the rendered images do not exist "
                                         "this node will have the behavior determined by the \"On Error\" parameter. "
                                         "To pre-render images, select a write node, a frame-range and hit \"Render\".\n\n"
-                                        "When unchecked, this node will output the image rendered by the node indicated in the \"Output Node\" parameter "
-                                        "by rendering the full-tree of the sub-project. In that case no writing on disk will occur and the images will be "
+                                        "When unchecked, this node will output the image rendered by the node indicated in the \"Output Node\" parameter, "
+                                        "or by the input of the node indicated by \"Write Node\" if it is empty, "
+                                        "by rendering the full-tree of the sub-project. In that case no writing on disk will occur, only the region "
+                                        "needed downstream is rendered and the images will be "
                                         "cached with the same policy as if the nodes were used in the active project in the first place.").toStdString() );
     mainPage->addKnob(enablePreRender);
     _imp->enablePreRenderKnob = enablePreRender;
@@ -311,7 +313,8 @@ PrecompNode::initializeKnobs()
 
     KnobStringPtr outputNode = AppManager::createKnob<KnobString>( this, tr("Output Node") );
     outputNode->setName("outputNode");
-    outputNode->setHintToolTip( tr("The script-name of the node to use as output node in the tree of the pre-comp. This can be any node.").toStdString() );
+    outputNode->setHintToolTip( tr("The script-name of the node to use as output node in the tree of the pre-comp. This can be any node. "
+                                   "If empty, the input of the node indicated by \"Write Node\" is used.").toStdString() );
     outputNode->setAnimationEnabled(false);
     outputNode->setSecretByDefault(true);
     mainPage->addKnob(outputNode);
@@ -353,6 +356,9 @@ PrecompNode::knobChanged(KnobI* k,
     } else if ( k == _imp->writeNodesKnob.lock().get() ) {
         _imp->createReadNode();
         _imp->setFirstAndLastFrame();
+        if ( !_imp->enablePreRenderKnob.lock()->getValue() ) {
+            _imp->refreshOutputNode();
+        }
     } else if ( k == _imp->errorBehaviourKnbo.lock().get() ) {
         _imp->setReadNodeErrorChoice();
     } else if ( k == _imp->enablePreRenderKnob.lock().get() ) {
@@ -608,7 +614,16 @@ PrecompNodePrivate::refreshOutputNode()
         KnobStringPtr outputNodeKnob = outputNodeNameKnob.lock();
         std::string outputNodeName = outputNodeKnob->getValue();
 
-        outputnode = app.lock()->getProject()->getNodeByFullySpecifiedName(outputNodeName);
+        if ( !outputNodeName.empty() ) {
+            outputnode = app.lock()->getProject()->getNodeByFullySpecifiedName(outputNodeName);
+        }
+        if (!outputnode) {
+            // Render in memory the tree that the selected Write node would have written to disk
+            NodePtr writeNode = getWriteNodeFromPreComp();
+            if (writeNode) {
+                outputnode = writeNode->getInput(0);
+            }
+        }
     }
 
     //Clear any persistent message set
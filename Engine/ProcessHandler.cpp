@@ -27,9 +27,12 @@
 
 #include <cassert>
 #include <stdexcept>
+#include <vector>
 
 #include <QtCore/QtGlobal> // for Q_OS_*
 #include <QtCore/QProcess>
+#include <QtCore/QSharedMemory>
+#include <QtCore/QTimer>
 #include <QtNetwork/QLocalServer>
 #include <QtNetwork/QLocalSocket>
 #include <QtCore/QCoreApplication>
@@ -49,6 +52,46 @@
 
 NATRON_NAMESPACE_ENTER
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// Layout of the progress ring buffer shared between the main process and a background process: a header followed by
+// NATRON_PROCESS_PROGRESS_RING_SIZE entries. Both are only accessed with the shared memory locked.
+struct ProgressRingHeader
+{
+    quint32 capacity;
+    quint32 unused;
+    quint64 writeCount; //< the number of reports written since the process started, the next one goes to writeCount % capacity
+};
+
+struct ProgressRingEntry
+{
+    qint32 frame;
+    qint32 unused;
+    double progress;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+// The key of the shared memory is derived from the name of the server of the main process, which is passed to the
+// background process with --IPCpipe
+static QString
+progressMemoryKey(const QString & mainProcessServerName)
+{
+    return mainProcessServerName + QString::fromUtf8("_PROGRESS");
+}
+
+static ProgressRingHeader*
+progressRingHeader(QSharedMemory* memory)
+{
+    return static_cast<ProgressRingHeader*>( memory->data() );
+}
+
+static ProgressRingEntry*
+progressRingEntries(QSharedMemory* memory)
+{
+    return reinterpret_cast<ProgressRingEntry*>( progressRingHeader(memory) + 1 );
+}
+
 ProcessHandler::ProcessHandler(const QString & projectPath,
                                OutputEffectInstance* writer)
     : _process(new QProcess)
@@ -56,9 +99,39 @@ ProcessHandler::ProcessHandler(const QString & projectPath,
     , _ipcServer(0)
     , _bgProcessOutputSocket(0)
     , _bgProcessInputSocket(0)
+    , _progressMemory(0)
+    , _progressPollTimer(0)
+    , _progressReadCount(0)
     , _earlyCancel(false)
     , _processLog()
     , _processArgs()
+{
+    initialize( projectPath, QString() );
+}
+
+ProcessHandler::ProcessHandler(const QString & projectPath,
+                               OutputEffectInstance* writer,
+                               int firstFrame,
+                               int lastFrame,
+                               int frameStep)
+    : _process(new QProcess)
+    , _writer(writer)
+    , _ipcServer(0)
+    , _bgProcessOutputSocket(0)
+    , _bgProcessInputSocket(0)
+    , _progressMemory(0)
+    , _progressPollTimer(0)
+    , _progressReadCount(0)
+    , _earlyCancel(false)
+    , _processLog()
+    , _processArgs()
+{
+    initialize( projectPath, QString::fromUtf8("%1-%2:%3").arg(firstFrame).arg(lastFrame).arg(frameStep) );
+}
+
+void
+ProcessHandler::initialize(const QString & projectPath,
+                           const QString & frameRange)
 {
     ///setup the server used to listen the output of the background process
     _ipcServer = new QLocalServer();
@@ -94,8 +167,31 @@ ProcessHandler::ProcessHandler(const QString & projectPath,
     }
     _ipcServer->listen(tmpFileName);
 
+    ///create the ring buffer where the background process will report the rendered frames
+    _progressMemory = new QSharedMemory( progressMemoryKey(tmpFileName) );
+    if ( _progressMemory->create( sizeof(ProgressRingHeader) + NATRON_PROCESS_PROGRESS_RING_SIZE * sizeof(ProgressRingEntry) ) ) {
+        _progressMemory->lock();
+        ProgressRingHeader* header = progressRingHeader(_progressMemory);
+        header->capacity = NATRON_PROCESS_PROGRESS_RING_SIZE;
+        header->unused = 0;
+        header->writeCount = 0;
+        _progressMemory->unlock();
+
+        _progressPollTimer = new QTimer();
+        _progressPollTimer->setInterval(NATRON_PROCESS_PROGRESS_POLL_MS);
+        QObject::connect( _progressPollTimer, SIGNAL(timeout()), this, SLOT(onProgressPollTimerTriggered()) );
+    } else {
+        ///the background process will report the rendered frames through the pipe
+        _processLog.push_back( tr("Could not create the progress shared memory: %1").arg( _progressMemory->errorString() ) );
+        delete _progressMemory;
+        _progressMemory = 0;
+    }
 
-    _processArgs << QString::fromUtf8("-b") << QString::fromUtf8("-w") << QString::fromUtf8( writer->getScriptName_mt_safe().c_str() );
+
+    _processArgs << QString::fromUtf8("-b") << QString::fromUtf8("-w") << QString::fromUtf8( _writer->getScriptName_mt_safe().c_str() );
+    if ( !frameRange.isEmpty() ) {
+        _processArgs << frameRange;
+    }
     _processArgs << QString::fromUtf8("--IPCpipe") <<  tmpFileName;
     _processArgs << projectPath;
 
@@ -124,6 +220,8 @@ ProcessHandler::~ProcessHandler()
         _bgProcessInputSocket->close();
         delete _bgProcessInputSocket;
     }
+    delete _progressPollTimer;
+    delete _progressMemory;
     if (_process) {
         _process->close();
         delete _process;
@@ -134,6 +232,38 @@ void
 ProcessHandler::startProcess()
 {
     _process->start(QCoreApplication::applicationFilePath(), _processArgs);
+    if (_progressPollTimer) {
+        _progressPollTimer->start();
+    }
+}
+
+void
+ProcessHandler::onProgressPollTimerTriggered()
+{
+    ///always running in the main thread
+    assert( QThread::currentThread() == qApp->thread() );
+
+    if ( !_progressMemory || !_progressMemory->lock() ) {
+        return;
+    }
+    std::vector<ProgressRingEntry> reports;
+    {
+        const ProgressRingHeader* header = progressRingHeader(_progressMemory);
+        const ProgressRingEntry* entries = progressRingEntries(_progressMemory);
+        quint64 writeCount = header->writeCount;
+        ///the reports that were overwritten are lost, which is fine: only the most recent ones matter for the progress
+        if (writeCount - _progressReadCount > NATRON_PROCESS_PROGRESS_RING_SIZE) {
+            _progressReadCount = writeCount - NATRON_PROCESS_PROGRESS_RING_SIZE;
+        }
+        for (; _progressReadCount < writeCount; ++_progressReadCount) {
+            reports.push_back(entries[_progressReadCount % NATRON_PROCESS_PROGRESS_RING_SIZE]);
+        }
+    }
+    _progressMemory->unlock();
+
+    for (std::vector<ProgressRingEntry>::const_iterator it = reports.begin(); it != reports.end(); ++it) {
+        Q_EMIT frameRendered(it->frame, it->progress);
+    }
 }
 
 const QString &
@@ -254,6 +384,8 @@ ProcessHandler::onProcessError(QProcess::ProcessError err)
 {
     if (err == QProcess::FailedToStart) {
         Dialogs::errorDialog( _writer->getScriptName(), tr("The render process failed to start.").toStdString() );
+        // finished() is not emitted by QProcess in that case
+        Q_EMIT processFinished(1);
     } else if (err == QProcess::Crashed) {
         //@TODO: find out a way to get the backtrace
     }
@@ -270,6 +402,11 @@ ProcessHandler::onProcessEnd(int exitCode,
     } else if (exitCode == 1) {
         returnCode = 1;
     }
+    if (_progressPollTimer) {
+        _progressPollTimer->stop();
+        ///report the frames rendered since the last poll
+        onProgressPollTimerTriggered();
+    }
     Q_EMIT processFinished(returnCode);
 }
 
@@ -280,6 +417,7 @@ ProcessInputChannel::ProcessInputChannel(const QString & mainProcessServerName)
     , _backgroundOutputPipe(0)
     , _backgroundIPCServer(0)
     , _backgroundInputPipe(0)
+    , _progressMemory(0)
     , _mustQuitMutex()
     , _mustQuitCond()
     , _mustQuit(false)
@@ -301,6 +439,7 @@ ProcessInputChannel::~ProcessInputChannel()
 
     delete _backgroundIPCServer;
     delete _backgroundOutputPipe;
+    delete _progressMemory;
 }
 
 void
@@ -313,6 +452,28 @@ ProcessInputChannel::writeToOutputChannel(const QString & message)
     }
 }
 
+void
+ProcessInputChannel::writeFrameRenderedToOutputChannel(int frame,
+                                                       double progress,
+                                                       const QString & shortMessage)
+{
+    {
+        QMutexLocker l(&_backgroundOutputPipeMutex);
+        if ( _progressMemory && _progressMemory->lock() ) {
+            ProgressRingHeader* header = progressRingHeader(_progressMemory);
+            ProgressRingEntry& entry = progressRingEntries(_progressMemory)[header->writeCount % NATRON_PROCESS_PROGRESS_RING_SIZE];
+            entry.frame = frame;
+            entry.unused = 0;
+            entry.progress = progress;
+            ++header->writeCount;
+            _progressMemory->unlock();
+
+            return;
+        }
+    }
+    writeToOutputChannel(shortMessage);
+}
+
 void
 ProcessInputChannel::onNewConnectionPending()
 {
@@ -380,6 +541,19 @@ ProcessInputChannel::initialize()
     _backgroundOutputPipe->connectToServer(_mainProcessServerName, QLocalSocket::ReadWrite);
     std::cout << "Attempting connection to " << _mainProcessServerName.toStdString() << std::endl;
 
+    ///attach to the ring buffer created by the main process for the frame reports, if any
+    _progressMemory = new QSharedMemory( progressMemoryKey(_mainProcessServerName) );
+    bool progressMemoryValid = false;
+    if ( _progressMemory->attach() && ( _progressMemory->size() >= (int)sizeof(ProgressRingHeader) ) && _progressMemory->lock() ) {
+        progressMemoryValid = progressRingHeader(_progressMemory)->capacity == NATRON_PROCESS_PROGRESS_RING_SIZE &&
+                              _progressMemory->size() >= (int)( sizeof(ProgressRingHeader) + NATRON_PROCESS_PROGRESS_RING_SIZE * sizeof(ProgressRingEntry) );
+        _progressMemory->unlock();
+    }
+    if (!progressMemoryValid) {
+        delete _progressMemory;
+        _progressMemory = 0;
+    }
+
     _backgroundIPCServer = new QLocalServer();
     QObject::connect( _backgroundIPCServer, SIGNAL(newConnection()), this, SLOT(onNewConnectionPending()) );
     QString tmpFileName;
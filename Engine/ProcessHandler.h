@@ -41,6 +41,12 @@ CLANG_DIAG_ON(deprecated)
 
 #include "Engine/EngineFwd.h"
 
+// Number of frame reports the progress ring buffer shared with a background process can hold before the oldest are overwritten
+#define NATRON_PROCESS_PROGRESS_RING_SIZE 256
+
+// Interval at which the main process reads the progress ring buffer of a background process
+#define NATRON_PROCESS_PROGRESS_POLL_MS 100
+
 NATRON_NAMESPACE_ENTER
 
 /**
@@ -79,6 +85,12 @@ NATRON_NAMESPACE_ENTER
  *
  * NB: Message that are exchanged via this channel consists of exactly 1 line, i.e a
  * string terminated with the \n character.
+ *
+ * The progress of the render (one report per rendered frame) does not go through the pipe: the main process also
+ * creates a shared memory segment holding a ring buffer, which the background process attaches to in step 2 and writes
+ * the frame reports to. The main process reads it periodically (every NATRON_PROCESS_PROGRESS_POLL_MS) so that
+ * a fast render does not flood the main thread with one message per frame. If the segment cannot be created or
+ * attached to, the reports go through the pipe as before.
  **/
 class ProcessHandler
     : public QObject
@@ -94,6 +106,9 @@ class ProcessHandler
     //note that this socket is initialized only when the background process sends the message
     //kBgProcessServerCreatedShort, meaning it created its server for the input pipe and we can actually open it.
     QLocalSocket* _bgProcessInputSocket;
+    QSharedMemory* _progressMemory; //< the ring buffer where the background process writes its frame reports
+    QTimer* _progressPollTimer; //< reads _progressMemory periodically while the process runs
+    quint64 _progressReadCount; //< the number of frame reports read so far from _progressMemory
     bool _earlyCancel; //< true if the user pressed cancel but the _bgProcessInput socket was not created yet
     QString _processLog; //< used to record the log of the process
     QStringList _processArgs;
@@ -107,6 +122,15 @@ public:
     ProcessHandler(const QString & projectPath,
                    OutputEffectInstance* writer);
 
+    /**
+     * @brief Same as above, but the process only renders the given frame range of the writer.
+     **/
+    ProcessHandler(const QString & projectPath,
+                   OutputEffectInstance* writer,
+                   int firstFrame,
+                   int lastFrame,
+                   int frameStep);
+
     virtual ~ProcessHandler();
 
     const QString & getProcessLog() const;
@@ -166,6 +190,16 @@ public Q_SLOTS:
      **/
     void startProcess();
 
+    /**
+     * @brief Reads the frame reports written by the background process to the progress ring buffer since the last call
+     * and emits frameRendered() for each of them.
+     **/
+    void onProgressPollTimerTriggered();
+
+private:
+
+    void initialize(const QString & projectPath, const QString & frameRange);
+
 Q_SIGNALS:
 
     void deleted();
@@ -212,6 +246,12 @@ public:
      **/
     void writeToOutputChannel(const QString & message);
 
+    /**
+     * @brief Reports to the main process that a frame was rendered, through the progress ring buffer if it is available,
+     * otherwise by writing shortMessage to the output channel.
+     **/
+    void writeFrameRenderedToOutputChannel(int frame, double progress, const QString & shortMessage);
+
 public Q_SLOTS:
 
     /**
@@ -252,6 +292,7 @@ private:
     QLocalServer* _backgroundIPCServer; //< for a background app used to manage input IPC  with the gui app
     QLocalSocket* _backgroundInputPipe; //<if the process is bg but managed by a gui process then the pipe is used
                                         //to read input messages
+    QSharedMemory* _progressMemory; //< the ring buffer created by the main process for the frame reports, protected by _backgroundOutputPipeMutex
     mutable QMutex _mustQuitMutex;
     QWaitCondition _mustQuitCond;
     bool _mustQuit;
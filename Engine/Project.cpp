@@ -81,6 +81,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/ProjectPrivate.h"
 #include "Engine/ProjectSerialization.h"
 #include "Engine/RectDSerialization.h"
+#include "Engine/RenderRequestRecorder.h"
 #include "Engine/RectISerialization.h"
 #include "Engine/RotoLayer.h"
 #include "Engine/Settings.h"
@@ -245,8 +246,13 @@ Project::loadProject(const QString & path,
         bool mustSave = false;
         if ( !loadProjectInternal(realPath, realName, isAutoSave, isUntitledAutosave, &mustSave) ) {
             appPTR->showErrorLog();
-        } else if (mustSave) {
-            saveProject(realPath, realName, 0);
+        } else {
+            if (mustSave) {
+                saveProject(realPath, realName, 0);
+            }
+            if ( RenderRequestRecorder::isEnabled() ) {
+                RenderRequestRecorder::setProjectFile( (realPath + realName).toStdString() );
+            }
         }
     } catch (const std::exception & e) {
         Dialogs::errorDialog( tr("Project loader").toStdString(), tr("Error while loading project: %1").arg( QString::fromUtf8( e.what() ) ).toStdString() );
@@ -589,17 +595,20 @@ Project::saveProjectInternal(const QString & path,
     if ( QFile::exists(filePath) ) {
         QFile::remove(filePath);
     }
-    int nAttemps = 0;
+    // Moving the temporary file avoids writing the whole project a second time, copy it if it cannot be moved
+    if ( !QFile::rename(tmpFilename, filePath) ) {
+        int nAttemps = 0;
 
-    while ( nAttemps < 10 && !fileCopy(tmpFilename, filePath) ) {
-        ++nAttemps;
-    }
+        while ( nAttemps < 10 && !fileCopy(tmpFilename, filePath) ) {
+            ++nAttemps;
+        }
 
-    if (nAttemps >= 10) {
-        throw std::runtime_error( "Failed to save to " + filePath.toStdString() );
-    }
+        if (nAttemps >= 10) {
+            throw std::runtime_error( "Failed to save to " + filePath.toStdString() );
+        }
 
-    QFile::remove(tmpFilename);
+        QFile::remove(tmpFilename);
+    }
 
     if (!autoSave && updateProjectProperties) {
         QString lockFilePath = getLockAbsoluteFilePath();
@@ -682,13 +691,22 @@ Project::onAutoSaveTimerTriggered()
     ///If so launch an auto-save, otherwise, restart the timer.
     bool canAutoSave = !hasNodeRendering() && !getApp()->isShowingDialog();
 
+    ///Do not start an auto-save while the previous one is still writing: on large projects they would pile up
+    ///and compete with the interaction for the knobs locks.
+    for (std::list<boost::shared_ptr<QFutureWatcher<void> > >::const_iterator it = _imp->autoSaveFutures.begin(); it != _imp->autoSaveFutures.end(); ++it) {
+        if ( (*it)->isRunning() ) {
+            canAutoSave = false;
+            break;
+        }
+    }
+
     if (canAutoSave) {
         boost::shared_ptr<QFutureWatcher<void> > watcher = boost::make_shared<QFutureWatcher<void> >();
         QObject::connect( watcher.get(), SIGNAL(finished()), this, SLOT(onAutoSaveFutureFinished()) );
         watcher->setFuture( QtConcurrent::run(this, &Project::autoSave) );
         _imp->autoSaveFutures.push_back(watcher);
     } else {
-        ///If the auto-save failed because a render is in progress, try every 2 seconds to auto-save.
+        ///If the auto-save failed because a render or another auto-save is in progress, try every 2 seconds to auto-save.
         ///We don't use the user-provided timeout interval here because it could be an inapropriate value.
         _imp->autoSaveTimer->start(2000);
     }
@@ -32,10 +32,12 @@
 #include <QtCore/QDebug>
 
 #include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/Project.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
+#include "Engine/PerfCounters.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Settings.h"
 
@@ -334,6 +336,9 @@ App::renderInternal(bool forceBlocking,
 
     std::list<AppInstance::RenderWork> l;
     l.push_back(w);
+
+    // The render threads need the GIL to evaluate expressions
+    PythonGILUnlocker pgu;
     getInternalApp()->startWritersRendering(forceBlocking, l);
 }
 
@@ -378,6 +383,9 @@ App::renderInternal(bool forceBlocking,
 
         l.push_back(w);
     }
+
+    // The render threads need the GIL to evaluate expressions
+    PythonGILUnlocker pgu;
     getInternalApp()->startWritersRendering(forceBlocking, l);
 }
 
@@ -410,25 +418,40 @@ App::addFormat(const QString& formatSpec)
 bool
 App::saveTempProject(const QString& filename)
 {
-    return getInternalApp()->saveTemp( filename.toStdString() );
+    std::string filenameStd = filename.toStdString();
+    PythonGILUnlocker pgu;
+
+    return getInternalApp()->saveTemp(filenameStd);
 }
 
 bool
 App::saveProject(const QString& filename)
 {
-    return getInternalApp()->save( filename.toStdString() );
+    std::string filenameStd = filename.toStdString();
+    PythonGILUnlocker pgu;
+
+    return getInternalApp()->save(filenameStd);
 }
 
 bool
 App::saveProjectAs(const QString& filename)
 {
-    return getInternalApp()->saveAs( filename.toStdString() );
+    std::string filenameStd = filename.toStdString();
+    PythonGILUnlocker pgu;
+
+    return getInternalApp()->saveAs(filenameStd);
 }
 
 App*
 App::loadProject(const QString& filename)
 {
-    AppInstancePtr app  = getInternalApp()->loadProject( filename.toStdString() );
+    std::string filenameStd = filename.toStdString();
+    AppInstancePtr app;
+    {
+        // The callbacks run while loading take the GIL again
+        PythonGILUnlocker pgu;
+        app = getInternalApp()->loadProject(filenameStd);
+    }
 
     if (!app) {
         return 0;
@@ -477,6 +500,52 @@ App::getViewNames() const
     return ret;
 }
 
+void
+App::beginBatchEdit()
+{
+    getInternalApp()->beginBatchEdit();
+}
+
+void
+App::endBatchEdit()
+{
+    getInternalApp()->endBatchEdit();
+}
+
+QMap<QString, QVariant>
+App::getPerfCounters() const
+{
+    QMap<QString, QVariant> ret;
+    std::map<std::string, U64> values;
+
+    PerfCounters::getValues(&values);
+    for (std::map<std::string, U64>::const_iterator it = values.begin(); it != values.end(); ++it) {
+        ret.insert( QString::fromUtf8( it->first.c_str() ), QVariant( (qulonglong)it->second ) );
+    }
+
+    return ret;
+}
+
+int
+App::exportCacheBundle(const std::list<Effect*>& effects,
+                       int firstFrame,
+                       int lastFrame,
+                       const QString& bundlePath) const
+{
+    NodesList nodes;
+
+    for (std::list<Effect*>::const_iterator it = effects.begin(); it != effects.end(); ++it) {
+        if ( *it && (*it)->getInternalNode() ) {
+            nodes.push_back( (*it)->getInternalNode() );
+        }
+    }
+
+    std::string bundlePathStd = bundlePath.toStdString();
+    PythonGILUnlocker pgu;
+
+    return appPTR->exportCacheBundle(bundlePathStd, nodes, firstFrame, lastFrame);
+}
+
 void
 App::addProjectLayer(const ImageLayer& layer)
 {
@@ -38,7 +38,9 @@
 CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QCoreApplication>
+#include <QtCore/QMap>
 #include <QtCore/QString>
+#include <QtCore/QVariant>
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
@@ -322,8 +324,29 @@ public:
     App* newProject();
     std::list<QString> getViewNames() const;
 
+    /**
+     * @brief Returns the values of the engine performance counters (cache hits and misses, renders, GPU uploads...)
+     * accumulated since the application started, by name.
+     **/
+    QMap<QString, QVariant> getPerfCounters() const;
+
+    /**
+     * @brief Writes to bundlePath the images cached on disk for the given effects and all their inputs
+     * in the frame range [firstFrame, lastFrame], so that they can be imported on another computer.
+     * Returns the number of exported images.
+     **/
+    int exportCacheBundle(const std::list<Effect*>& effects, int firstFrame, int lastFrame, const QString& bundlePath) const;
+
     void addProjectLayer(const ImageLayer& layer);
 
+    /**
+     * @brief Brackets the creation and connection of many nodes from a script so that the graph is
+     * refreshed and the viewers re-rendered only once, by endBatchEdit(). In Python, prefer
+     * the context manager: with app.batchEdit(): ...
+     **/
+    void beginBatchEdit();
+    void endBatchEdit();
+
 protected:
 
     void renderInternal(bool forceBlocking, Effect* writeNode, int firstFrame, int lastFrame, int frameStep);
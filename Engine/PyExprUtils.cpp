@@ -379,5 +379,46 @@ ExprUtils::pnoise(const Double3DTuple& p, const Double3DTuple& period)
 
 }
 
+std::vector<double>
+ExprUtils::noiseArray(const std::vector<double>& points)
+{
+    int count = (int)points.size() / 3;
+    std::vector<double> result(count);
+    if (count > 0) {
+        NoiseN<3, 1>(&points[0], &result[0], count);
+    }
+    return result;
+}
+
+std::vector<double>
+ExprUtils::fbmArray(const std::vector<double>& points, int octaves, double lacunarity, double gain)
+{
+    octaves = std::min(std::max(octaves, 1), 8);
+    int count = (int)points.size() / 3;
+    std::vector<double> result(count);
+    if (count > 0) {
+        FBMN<3, 1, false>(&points[0], &result[0], count, octaves, lacunarity, gain);
+    }
+    for (int i = 0; i < count; ++i) {
+        result[i] = .5 * result[i] + .5;
+    }
+    return result;
+}
+
+std::vector<double>
+ExprUtils::turbulenceArray(const std::vector<double>& points, int octaves, double lacunarity, double gain)
+{
+    octaves = std::min(std::max(octaves, 1), 8);
+    int count = (int)points.size() / 3;
+    std::vector<double> result(count);
+    if (count > 0) {
+        FBMN<3, 1, true>(&points[0], &result[0], count, octaves, lacunarity, gain);
+    }
+    for (int i = 0; i < count; ++i) {
+        result[i] = .5 * result[i] + .5;
+    }
+    return result;
+}
+
 NATRON_PYTHON_NAMESPACE_EXIT
 NATRON_NAMESPACE_EXIT
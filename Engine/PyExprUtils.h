@@ -120,6 +120,12 @@ public:
 
     // periodic noise
     static double pnoise(const Double3DTuple& p, const Double3DTuple& period);
+
+    // Batched versions of noise, fbm and turbulence for 3D points: points holds x,y,z for each point one after the other
+    // and the result holds one value per point. This is much faster than calling the scalar function for each point.
+    static std::vector<double> noiseArray(const std::vector<double>& points);
+    static std::vector<double> fbmArray(const std::vector<double>& points, int octaves = 6, double lacunarity = 2., double gain = 0.5);
+    static std::vector<double> turbulenceArray(const std::vector<double>& points, int octaves = 6, double lacunarity = 2., double gain = 0.5);
 };
 
 NATRON_PYTHON_NAMESPACE_EXIT;
@@ -190,6 +190,11 @@ public:
         return appPTR->getHardwareIdealThreadCount();
     }
 
+    inline int importCacheBundle(const QString& bundlePath)
+    {
+        return appPTR->importCacheBundle( bundlePath.toStdString() );
+    }
+
     inline App* getInstance(int idx) const
     {
         AppInstancePtr app = appPTR->getAppInstance(idx);
@@ -25,15 +25,24 @@
 
 #include "PyNode.h"
 
+#include <algorithm> // max
 #include <cassert>
+#include <cstring> // memset, memcpy
 #include <stdexcept>
+#include <vector>
 
+#include <boost/scoped_ptr.hpp>
+
+#include "Engine/AbortableRenderInfo.h"
+#include "Engine/AppManager.h"
+#include "Engine/Image.h"
 #include "Engine/Node.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
 #include "Engine/AppInstance.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/NodeGroup.h"
+#include "Engine/ParallelRenderArgs.h"
 #include "Engine/PyRoto.h"
 #include "Engine/PyTracker.h"
 #include "Engine/TimeLine.h"
@@ -258,7 +267,11 @@ Effect::isOutputNode()
 void
 Effect::destroy(bool autoReconnect)
 {
-    getInternalNode()->destroyNode(false, autoReconnect);
+    NodePtr node = getInternalNode();
+    // Destroying the node waits for its renders to abort, which may need the GIL to evaluate expressions
+    PythonGILUnlocker pgu;
+
+    node->destroyNode(false, autoReconnect);
 }
 
 int
@@ -977,6 +990,257 @@ Effect::getRegionOfDefinition(double time,
     return rod;
 }
 
+/**
+ * @brief The Python object exposing the pixels of a rendered image through the buffer protocol.
+ * It owns a copy of the pixels: holding the image itself would lock its cache entry for as long as Python
+ * keeps a reference on the buffer, blocking the renders that need to write to it.
+ **/
+struct PyImageBufferObject
+{
+    PyObject_HEAD
+    std::vector<unsigned char>* pixels;
+    void* data;
+    Py_ssize_t itemSize;
+    Py_ssize_t shape[3];
+    Py_ssize_t strides[3];
+    char format[2];
+};
+
+static void
+PyImageBuffer_dealloc(PyObject* obj)
+{
+    PyImageBufferObject* self = (PyImageBufferObject*)obj;
+
+    delete self->pixels;
+    PyObject_Del(obj);
+}
+
+static int
+PyImageBuffer_getbuffer(PyObject* obj,
+                        Py_buffer* view,
+                        int flags)
+{
+    PyImageBufferObject* self = (PyImageBufferObject*)obj;
+
+    view->obj = 0;
+    if ( (flags & PyBUF_WRITABLE) == PyBUF_WRITABLE ) {
+        PyErr_SetString(PyExc_BufferError, "Rendered images are read-only");
+
+        return -1;
+    }
+    view->buf = self->data;
+    view->obj = obj;
+    Py_INCREF(obj);
+    view->len = self->shape[0] * self->shape[1] * self->shape[2] * self->itemSize;
+    view->readonly = 1;
+    view->itemsize = self->itemSize;
+    view->format = ( (flags & PyBUF_FORMAT) == PyBUF_FORMAT ) ? self->format : 0;
+    view->ndim = 3;
+    view->shape = ( (flags & PyBUF_ND) == PyBUF_ND ) ? self->shape : 0;
+    view->strides = ( (flags & PyBUF_STRIDES) == PyBUF_STRIDES ) ? self->strides : 0;
+    view->suboffsets = 0;
+    view->internal = 0;
+
+    return 0;
+}
+
+static PyTypeObject*
+getImageBufferType()
+{
+    static PyBufferProcs bufferProcs;
+    static PyTypeObject type;
+    static bool initialized = false;
+
+    if (!initialized) {
+        memset( &bufferProcs, 0, sizeof(bufferProcs) );
+        bufferProcs.bf_getbuffer = PyImageBuffer_getbuffer;
+        memset( &type, 0, sizeof(type) );
+        ( (PyObject*)&type )->ob_refcnt = 1;
+        type.tp_name = "NatronEngine.ImageBuffer";
+        type.tp_basicsize = sizeof(PyImageBufferObject);
+        type.tp_dealloc = PyImageBuffer_dealloc;
+        type.tp_as_buffer = &bufferProcs;
+#if PY_MAJOR_VERSION < 3
+        type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER;
+#else
+        type.tp_flags = Py_TPFLAGS_DEFAULT;
+#endif
+        type.tp_doc = "Pixels of an image rendered by Effect.renderImage()";
+        if (PyType_Ready(&type) < 0) {
+            return 0;
+        }
+        initialized = true;
+    }
+
+    return &type;
+}
+
+PyObject*
+Effect::renderImage(double time,
+                    int view,
+                    const RectD& roi,
+                    int mipMapLevel) const
+{
+    NodePtr node = getInternalNode();
+
+    if ( !node || !node->getEffectInstance() ) {
+        Py_RETURN_NONE;
+    }
+    EffectInstancePtr effect = node->getEffectInstance();
+    NodeGroup* isGroup = node->isEffectGroup();
+    if (isGroup) {
+        NodePtr outputNode = isGroup->getOutputNode(false);
+        if ( !outputNode || !outputNode->getEffectInstance() ) {
+            Py_RETURN_NONE;
+        }
+        effect = outputNode->getEffectInstance();
+    }
+    mipMapLevel = std::max(0, mipMapLevel);
+
+    PyTypeObject* bufferType = getImageBufferType();
+    if (!bufferType) {
+        return 0;
+    }
+
+    RenderScale scale( Image::getScaleFromMipMapLevel(mipMapLevel) );
+    RectI renderWindow;
+    std::map<ImagePlaneDesc, ImagePtr> planes;
+    std::string error;
+    {
+        // The render may run parts of the tree in other threads that need the GIL to evaluate expressions:
+        // it must not be held while waiting for them
+        PythonGILUnlocker pgu;
+
+        RectD rod;
+        bool isProjectFormat;
+        U64 nodeHash = effect->getHash();
+        StatusEnum stat = effect->getRegionOfDefinition_public(nodeHash, time, RenderScale(1.), ViewIdx(view), &rod, &isProjectFormat);
+        RectD canonicalRoi;
+        if ( (stat != eStatusFailed) && roi.intersect(rod, &canonicalRoi) ) {
+            canonicalRoi.toPixelEnclosing(mipMapLevel, effect->getAspectRatio(-1), &renderWindow);
+
+            NodePtr treeRoot = effect->getNode();
+            AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(false, 0);
+            ParallelRenderArgsSetter frameRenderArgs( time,
+                                                      ViewIdx(view),
+                                                      false, // isRenderUserInteraction
+                                                      false, // isSequential
+                                                      abortInfo,
+                                                      treeRoot,
+                                                      0, //texture index
+                                                      node->getApp()->getTimeLine().get(),
+                                                      NodePtr(), // rotoPaint node
+                                                      false, // isAnalysis
+                                                      false, // draftMode
+                                                      RenderStatsPtr() );
+            FrameRequestMap request;
+            stat = EffectInstance::computeRequestPass(time, ViewIdx(view), mipMapLevel, canonicalRoi, treeRoot, request);
+            if (stat != eStatusFailed) {
+                frameRenderArgs.updateNodesRequest(request);
+
+                std::list<ImagePlaneDesc> requestedComps;
+                {
+                    ImagePlaneDesc plane, pairedPlane;
+                    effect->getMetadataComponents(-1, &plane, &pairedPlane);
+                    requestedComps.push_back(plane);
+                }
+
+                try {
+                    boost::scoped_ptr<EffectInstance::RenderRoIArgs> renderArgs( new EffectInstance::RenderRoIArgs(time,
+                                                                                                                   scale,
+                                                                                                                   mipMapLevel,
+                                                                                                                   ViewIdx(view),
+                                                                                                                   false,
+                                                                                                                   renderWindow,
+                                                                                                                   rod,
+                                                                                                                   requestedComps,
+                                                                                                                   effect->getBitDepth(-1),
+                                                                                                                   false,
+                                                                                                                   effect.get(),
+                                                                                                                   eStorageModeRAM /*returnStorage*/,
+                                                                                                                   time /*callerRenderTime*/) );
+                    if (effect->renderRoI(*renderArgs, &planes) != EffectInstance::eRenderRoIRetCodeOk) {
+                        planes.clear();
+                    }
+                } catch (const std::exception& e) {
+                    planes.clear();
+                    error = e.what();
+                }
+            }
+        }
+    }
+
+    if ( !error.empty() ) {
+        PyErr_SetString( PyExc_RuntimeError, error.c_str() );
+
+        return 0;
+    }
+    if ( planes.empty() || !planes.begin()->second ) {
+        Py_RETURN_NONE;
+    }
+    const ImagePtr& img = planes.begin()->second;
+
+    char format;
+    switch ( img->getBitDepth() ) {
+    case eImageBitDepthByte:
+        format = 'B';
+        break;
+    case eImageBitDepthShort:
+        format = 'H';
+        break;
+    case eImageBitDepthFloat:
+        format = 'f';
+        break;
+    default:
+        PyErr_SetString(PyExc_TypeError, "Effect.renderImage(): unsupported image bit depth");
+
+        return 0;
+    }
+
+    RectI bufferWindow;
+    if ( !renderWindow.intersect(img->getBounds(), &bufferWindow) ) {
+        Py_RETURN_NONE;
+    }
+
+    PyImageBufferObject* buffer = PyObject_New(PyImageBufferObject, bufferType);
+    if (!buffer) {
+        return 0;
+    }
+    buffer->itemSize = getSizeOfForBitDepth( img->getBitDepth() );
+    buffer->shape[0] = bufferWindow.height();
+    buffer->shape[1] = bufferWindow.width();
+    buffer->shape[2] = img->getComponentsCount();
+    buffer->strides[2] = buffer->itemSize;
+    buffer->strides[1] = buffer->shape[2] * buffer->itemSize;
+    buffer->strides[0] = buffer->shape[1] * buffer->strides[1];
+    try {
+        buffer->pixels = new std::vector<unsigned char>(buffer->shape[0] * buffer->strides[0]);
+    } catch (const std::bad_alloc&) {
+        buffer->pixels = 0;
+        Py_DECREF( (PyObject*)buffer );
+
+        return PyErr_NoMemory();
+    }
+    buffer->data = &buffer->pixels->front();
+    {
+        // Copy the window so that the image is only locked for the duration of the copy
+        Image::ReadAccess access( img.get() );
+        std::size_t srcRowBytes = img->getRowElements() * buffer->itemSize;
+        const unsigned char* src = (const unsigned char*)access.pixelAt(bufferWindow.x1, bufferWindow.y1);
+        unsigned char* dst = &buffer->pixels->front();
+        for (Py_ssize_t y = 0; y < buffer->shape[0]; ++y, src += srcRowBytes, dst += buffer->strides[0]) {
+            std::memcpy(dst, src, buffer->strides[0]);
+        }
+    }
+    buffer->format[0] = format;
+    buffer->format[1] = '\0';
+
+    PyObject* ret = PyMemoryView_FromObject( (PyObject*)buffer );
+    Py_DECREF( (PyObject*)buffer );
+
+    return ret;
+} // Effect::renderImage
+
 void
 Effect::setSubGraphEditable(bool editable)
 {
@@ -372,6 +372,14 @@ public:
 
     RectD getRegionOfDefinition(double time, int /* Python API: do not use ViewIdx */ view) const;
 
+    /**
+     * @brief Renders the given region (in canonical coordinates) of the node at the given time, view and mipmap level
+     * and returns a read-only memoryview on a copy of the rendered pixels.
+     * The view has the shape (height, width, components) and its first row is the bottom of the region.
+     * Returns None if the render failed.
+     **/
+    PyObject* renderImage(double time, int /* Python API: do not use ViewIdx */ view, const RectD& roi, int mipMapLevel = 0) const;
+
     static Param* createParamWrapperForKnob(const KnobIPtr& knob);
 
     void setSubGraphEditable(bool editable);
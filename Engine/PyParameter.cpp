@@ -507,6 +507,28 @@ AnimatedParam::getKeyTime(int index,
     return knob->getKeyFrameTime(ViewSpec::current(), index, dimension, time);
 }
 
+std::vector<double>
+AnimatedParam::getKeyFrames(int dimension) const
+{
+    std::vector<double> ret;
+    KnobIPtr knob = getInternalKnob();
+
+    if ( !knob || (dimension < 0) || ( dimension >= knob->getDimension() ) ) {
+        return ret;
+    }
+    CurvePtr curve = knob->getCurve(ViewSpec::current(), dimension);
+    if (!curve) {
+        return ret;
+    }
+    KeyFrameSet keys = curve->getKeyFrames_mt_safe();
+    ret.reserve( keys.size() );
+    for (KeyFrameSet::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        ret.push_back( it->getTime() );
+    }
+
+    return ret;
+}
+
 void
 AnimatedParam::deleteValueAtTime(double time,
                                  int dimension)
@@ -1217,6 +1239,34 @@ DoubleParam::setValueAtTime(double value,
     return knob->setValueAtTime(time, value, ViewSpec::current(), dimension);
 }
 
+std::vector<double>
+DoubleParam::getValuesAtTimes(const std::vector<double>& times,
+                              int dimension) const
+{
+    std::vector<double> ret( times.size(), 0. );
+    KnobDoublePtr knob = _doubleKnob.lock();
+    if (!knob) {
+        return ret;
+    }
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        ret[i] = knob->getValueAtTime(times[i], dimension);
+    }
+
+    return ret;
+}
+
+void
+DoubleParam::setValuesAtTimes(const std::vector<double>& values,
+                              const std::vector<double>& times,
+                              int dimension)
+{
+    KnobDoublePtr knob = _doubleKnob.lock();
+    if ( !knob || ( values.size() != times.size() ) ) {
+        return;
+    }
+    knob->setValuesAtTimes(times, values, ViewSpec::current(), dimension, eValueChangedReasonNatronInternalEdited);
+}
+
 void
 DoubleParam::setDefaultValue(double value,
                              int dimension)
@@ -1476,6 +1526,34 @@ ColorParam::setValueAtTime(double value,
     knob->setValueAtTime(time, value, ViewSpec::current(), dimension);
 }
 
+std::vector<double>
+ColorParam::getValuesAtTimes(const std::vector<double>& times,
+                             int dimension) const
+{
+    std::vector<double> ret( times.size(), 0. );
+    KnobColorPtr knob = _colorKnob.lock();
+    if (!knob) {
+        return ret;
+    }
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        ret[i] = knob->getValueAtTime(times[i], dimension);
+    }
+
+    return ret;
+}
+
+void
+ColorParam::setValuesAtTimes(const std::vector<double>& values,
+                             const std::vector<double>& times,
+                             int dimension)
+{
+    KnobColorPtr knob = _colorKnob.lock();
+    if ( !knob || ( values.size() != times.size() ) ) {
+        return;
+    }
+    knob->setValuesAtTimes(times, values, ViewSpec::current(), dimension, eValueChangedReasonNatronInternalEdited);
+}
+
 void
 ColorParam::setDefaultValue(double value,
                             int dimension)
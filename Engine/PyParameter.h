@@ -28,6 +28,8 @@
 
 #include "Global/Macros.h"
 
+#include <vector>
+
 /**
  * @brief Simple wrap for the Knob class that is the API we want to expose to the Python
  * Engine module.
@@ -236,6 +238,11 @@ public:
      **/
     bool getKeyTime(int index, int dimension, double* time) const;
 
+    /**
+     * @brief Returns the time of all the keyframes of the given dimension, in increasing order.
+     **/
+    std::vector<double> getKeyFrames(int dimension = 0) const;
+
     /**
      * @brief Removes the keyframe at the given time and dimension if it matches any.
      **/
@@ -497,6 +504,17 @@ public:
      **/
     void setValueAtTime(double value, double time, int dimension = 0);
 
+    /**
+     * @brief Same as getValueAtTime for each of the given times.
+     **/
+    std::vector<double> getValuesAtTimes(const std::vector<double>& times, int dimension = 0) const;
+
+    /**
+     * @brief Same as setValueAtTime for each value and time of the given lists, which must have the same size,
+     * but the keyframes are all added at once and the change is notified only once.
+     **/
+    void setValuesAtTimes(const std::vector<double>& values, const std::vector<double>& times, int dimension = 0);
+
     /**
      * @brief Set the default value for the given dimension
      **/
@@ -649,6 +667,17 @@ public:
      **/
     void setValueAtTime(double value, double time, int dimension = 0);
 
+    /**
+     * @brief Same as getValueAtTime for each of the given times.
+     **/
+    std::vector<double> getValuesAtTimes(const std::vector<double>& times, int dimension = 0) const;
+
+    /**
+     * @brief Same as setValueAtTime for each value and time of the given lists, which must have the same size,
+     * but the keyframes are all added at once and the change is notified only once.
+     **/
+    void setValuesAtTimes(const std::vector<double>& values, const std::vector<double>& times, int dimension = 0);
+
     /**
      * @brief Set the default value for the given dimension
      **/
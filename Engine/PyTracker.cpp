@@ -25,6 +25,7 @@
 
 #include "PyTracker.h"
 
+#include "Engine/AppManager.h"
 #include "Engine/PyNode.h"
 #include "Engine/TrackMarker.h"
 #include "Engine/TrackerContext.h"
@@ -150,6 +151,9 @@ Tracker::startTracking(const std::list<Track*>& marks,
     for (std::list<Track*>::const_iterator it = marks.begin(); it != marks.end(); ++it) {
         markers.push_back( (*it)->getInternalMarker() );
     }
+
+    // The tracking threads render the tracked node, which may need the GIL to evaluate expressions
+    PythonGILUnlocker pgu;
     ctx->trackMarkers(markers, start, end, forward, 0);
 }
 
@@ -160,6 +164,9 @@ Tracker::stopTracking()
     if (!ctx) {
         return;
     }
+
+    // Aborting waits for the tracking threads
+    PythonGILUnlocker pgu;
     ctx->abortTracking();
 }
 
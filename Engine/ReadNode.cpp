@@ -25,7 +25,11 @@
 
 #include "ReadNode.h"
 
+#include <algorithm> // min
+#include <climits> // INT_MIN
+#include <cmath> // floor
 #include <sstream> // stringstream
+#include <vector>
 
 #include "Global/QtCompat.h"
 
@@ -54,6 +58,13 @@ CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QCoreApplication>
 #include <QtCore/QProcess>
+#include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
+
+#if defined(__NATRON_UNIX__)
+#include <fcntl.h> // posix_fadvise, F_RDADVISE
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
@@ -66,13 +77,21 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/Project.h"
 #include "Engine/NodeSerialization.h"
 #include "Engine/KnobSerialization.h" // createDefaultValueForParam
+#include "Engine/Format.h"
+#include "Engine/Hash64.h"
+#include "Engine/NodeMetadata.h"
 #include "Engine/Plugin.h"
+#include "Engine/ReaderProbeCache.h"
 #include "Engine/Settings.h"
 
 //The plug-in that is instantiated whenever this node is created and doesn't point to any valid or known extension
 #define READ_NODE_DEFAULT_READER PLUGINID_OFX_READOIIO
 #define kPluginSelectorParamEntryDefault "Default"
 
+// During sequential renders (playback, Write renders), number of frames ahead of the rendered one whose file
+// is read ahead so that the decoder does not wait on the storage
+#define NATRON_READ_NODE_PREFETCH_FRAMES 4
+
 NATRON_NAMESPACE_ENTER
 
 //Generic Reader
@@ -246,6 +265,30 @@ public:
 
     bool wasCreatedAsHiddenNode;
 
+    // Serializes renders of the main reader instance, see ReadNode::render()
+    QMutex mainReaderRenderMutex;
+
+    // Protects the members below
+    QMutex prefetchMutex;
+
+    // Number of sequential renders currently running (between beginSequenceRender and endSequenceRender)
+    int sequentialRendersCount;
+
+    // Last rendered file frame and farthest file frame read ahead, in the direction of the render
+    int lastRenderedFrame;
+    int lastPrefetchedFrame;
+    int prefetchDirection;
+
+    // Protects the members below
+    QMutex probeParamsMutex;
+
+    // The hash of the parameters of the reader used to identify its results in the ReaderProbeCache,
+    // valid as long as the hashes of the nodes do not change
+    U64 probeParamsReadNodeHash;
+    U64 probeParamsReaderHash;
+    U64 probeParamsKnobValuesHash;
+    bool probeParamsHashable;
+
 
     ReadNodePrivate(ReadNode* publicInterface)
     : _publicInterface(publicInterface)
@@ -261,6 +304,17 @@ public:
     , creatingReadNode(0)
     , lastPluginIDCreated()
     , wasCreatedAsHiddenNode(false)
+    , mainReaderRenderMutex()
+    , prefetchMutex()
+    , sequentialRendersCount(0)
+    , lastRenderedFrame(INT_MIN)
+    , lastPrefetchedFrame(INT_MIN)
+    , prefetchDirection(0)
+    , probeParamsMutex()
+    , probeParamsReadNodeHash(0)
+    , probeParamsReaderHash(0)
+    , probeParamsKnobValuesHash(0)
+    , probeParamsHashable(false)
     {
     }
 
@@ -282,6 +336,14 @@ public:
 
     bool checkDecoderCreated(double time, ViewIdx view);
 
+    void prefetchNextFiles(double time, ViewIdx view);
+
+    std::string getFileNameAtTime(double time, ViewIdx view) const;
+
+    bool getProbeParamsHash(U64* hash);
+
+    void checkProbedFile(const std::string& filename);
+
     static QString getFFProbeBinaryPath()
     {
         QString appPath = QCoreApplication::applicationDirPath();
@@ -625,6 +687,196 @@ ReadNodePrivate::checkDecoderCreated(double time,
     return true;
 }
 
+static void
+prefetchFiles(const std::vector<std::string>& filenames)
+{
+    for (std::vector<std::string>::const_iterator it = filenames.begin(); it != filenames.end(); ++it) {
+#if defined(__NATRON_UNIX__)
+        int fd = ::open(it->c_str(), O_RDONLY);
+        if (fd == -1) {
+            continue;
+        }
+#  if defined(__NATRON_OSX__)
+        struct stat st;
+        if (::fstat(fd, &st) == 0) {
+            struct radvisory ra;
+            ra.ra_offset = 0;
+            ra.ra_count = (int)std::min( (off_t)INT_MAX, st.st_size );
+            ::fcntl(fd, F_RDADVISE, &ra);
+        }
+#  else
+        // Starts reading the file in the page cache without blocking
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#  endif
+        ::close(fd);
+#else
+        Q_UNUSED(it);
+#endif
+    }
+}
+
+/**
+ * @brief Reads ahead, on a separate thread, the files of the next frames in the direction of the sequential render
+ * so that they are in the system cache when the reader opens them. This is mostly useful for image sequences on
+ * network storage. Frames that were already read ahead are not requested again.
+ **/
+void
+ReadNodePrivate::prefetchNextFiles(double time,
+                                   ViewIdx view)
+{
+    KnobFilePtr fileKnob = inputFileKnob.lock();
+    if (!fileKnob) {
+        return;
+    }
+
+    // The reader maps the time to the file frame with its time offset
+    int frame = (int)std::floor(time + 0.5);
+    KnobIntPtr timeOffsetKnob = boost::dynamic_pointer_cast<KnobInt>( _publicInterface->getKnobByName(kParamTimeOffset) );
+    if (timeOffsetKnob) {
+        frame -= timeOffsetKnob->getValue();
+    }
+
+    int firstFrame, lastFrame, direction;
+    {
+        QMutexLocker k(&prefetchMutex);
+        if (sequentialRendersCount == 0) {
+            return;
+        }
+        if ( (lastRenderedFrame == INT_MIN) || (frame == lastRenderedFrame) ) {
+            lastRenderedFrame = frame;
+
+            return;
+        }
+        direction = frame > lastRenderedFrame ? 1 : -1;
+        lastRenderedFrame = frame;
+        if ( (direction != prefetchDirection) || (lastPrefetchedFrame == INT_MIN) ||
+             ( (lastPrefetchedFrame - frame) * direction <= 0 ) || ( (lastPrefetchedFrame - frame) * direction > NATRON_READ_NODE_PREFETCH_FRAMES ) ) {
+            // Changed direction or seeked: restart from the rendered frame
+            lastPrefetchedFrame = frame;
+        }
+        prefetchDirection = direction;
+        firstFrame = lastPrefetchedFrame + direction;
+        lastFrame = frame + direction * NATRON_READ_NODE_PREFETCH_FRAMES;
+        if ( (lastFrame - firstFrame) * direction < 0 ) {
+            return;
+        }
+        lastPrefetchedFrame = lastFrame;
+    }
+
+    std::string currentFile = fileKnob->getFileName(frame, view);
+    std::vector<std::string> filenames;
+    for (int f = firstFrame; ; f += direction) {
+        std::string filename = fileKnob->getFileName(f, view);
+        // Movie files or a single image: nothing to read ahead
+        if ( filename.empty() || (filename == currentFile) ) {
+            break;
+        }
+        filenames.push_back(filename);
+        if (f == lastFrame) {
+            break;
+        }
+    }
+    if ( !filenames.empty() ) {
+        QtConcurrent::run(prefetchFiles, filenames);
+    }
+}
+
+/**
+ * @brief Returns the file that the reader reads at the given time, the reader maps the time to the file frame with its time offset.
+ **/
+std::string
+ReadNodePrivate::getFileNameAtTime(double time,
+                                   ViewIdx view) const
+{
+    KnobFilePtr fileKnob = inputFileKnob.lock();
+    if (!fileKnob) {
+        return std::string();
+    }
+    int frame = (int)std::floor(time + 0.5);
+    KnobIntPtr timeOffsetKnob = boost::dynamic_pointer_cast<KnobInt>( _publicInterface->getKnobByName(kParamTimeOffset) );
+    if (timeOffsetKnob) {
+        frame -= timeOffsetKnob->getValue();
+    }
+
+    return fileKnob->getFileName(frame, view);
+}
+
+/**
+ * @brief Computes the hash identifying the results of the reader in the ReaderProbeCache: what they depend on besides the file.
+ * @returns False if the results of the reader cannot be remembered, e.g: its parameters have expressions or it has an input.
+ **/
+bool
+ReadNodePrivate::getProbeParamsHash(U64* hash)
+{
+    NodePtr reader = _publicInterface->getEmbeddedReader();
+    if ( !reader || _publicInterface->getInput(0) ) {
+        return false;
+    }
+
+    U64 readNodeHash = _publicInterface->getNode()->getHashValue();
+    U64 readerHash = reader->getHashValue();
+    U64 knobValuesHash;
+    {
+        QMutexLocker k(&probeParamsMutex);
+        if ( (readNodeHash == 0) || (readerHash == 0) || (readNodeHash != probeParamsReadNodeHash) || (readerHash != probeParamsReaderHash) ) {
+            // The parameters changed, hash them again
+            bool readNodeHasUnhashedState, readerHasUnhashedState;
+            Hash64 knobValues;
+            knobValues.append( _publicInterface->getNode()->computeKnobValuesHash(&readNodeHasUnhashedState) );
+            knobValues.append( reader->computeKnobValuesHash(&readerHasUnhashedState) );
+            Hash64_appendQString( &knobValues, QString::fromUtf8( reader->getPluginID().c_str() ) );
+            knobValues.computeHash();
+            probeParamsReadNodeHash = readNodeHash;
+            probeParamsReaderHash = readerHash;
+            probeParamsKnobValuesHash = knobValues.value();
+            probeParamsHashable = !readNodeHasUnhashedState && !readerHasUnhashedState;
+        }
+        if (!probeParamsHashable) {
+            return false;
+        }
+        knobValuesHash = probeParamsKnobValuesHash;
+    }
+
+    // The reader may fall back on the project format and frame rate
+    Format projectFormat;
+    ProjectPtr project = _publicInterface->getApp()->getProject();
+    project->getProjectDefaultFormat(&projectFormat);
+    Hash64 h;
+    h.append(knobValuesHash);
+    h.append(projectFormat.x1);
+    h.append(projectFormat.y1);
+    h.append(projectFormat.x2);
+    h.append(projectFormat.y2);
+    h.append( projectFormat.getPixelAspectRatio() );
+    h.append( project->getProjectFrameRate() );
+    h.computeHash();
+    *hash = h.value();
+
+    return true;
+}
+
+static void
+checkProbedFileInBackground(const EffectInstanceWPtr& effect,
+                            const std::string& filename)
+{
+    if ( ReaderProbeCache::checkFile(filename) ) {
+        return;
+    }
+    EffectInstancePtr e = effect.lock();
+    if (e) {
+        QMetaObject::invokeMethod(e.get(), "onProbedFileChanged", Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief The results of the file were remembered from a previous session: check in the background that it did not change since.
+ **/
+void
+ReadNodePrivate::checkProbedFile(const std::string& filename)
+{
+    QtConcurrent::run( checkProbedFileInBackground, EffectInstanceWPtr( _publicInterface->shared_from_this() ), filename );
+}
+
 static std::string
 getFileNameFromSerialization(const std::list<KnobSerializationPtr>& serializations)
 {
@@ -946,7 +1198,14 @@ RenderSafetyEnum
 ReadNode::renderThreadSafety() const
 {
     NodePtr p = getEmbeddedReader();
-    return p ? p->getEffectInstance()->renderThreadSafety() : eRenderSafetyFullySafe;
+    if (!p) {
+        return eRenderSafetyFullySafe;
+    }
+    RenderSafetyEnum safety = p->getEffectInstance()->renderThreadSafety();
+
+    // An instance-safe reader would decode one frame at a time: render() instead dispatches each frame to a
+    // render clone of the reader, each one being a separate decoder
+    return safety == eRenderSafetyInstanceSafe ? eRenderSafetyFullySafe : safety;
 }
 
 bool
@@ -1089,7 +1348,37 @@ StatusEnum
 ReadNode::getPreferredMetadata(NodeMetadata& metadata)
 {
     NodePtr p = getEmbeddedReader();
-    return p ? p->getEffectInstance()->getPreferredMetadata(metadata) : EffectInstance::getPreferredMetadata(metadata);
+    if (!p) {
+        return EffectInstance::getPreferredMetadata(metadata);
+    }
+
+    // The metadata comes from the first file: reuse what the reader found out when it opened it in a previous session
+    U64 paramsHash = 0;
+    std::string filename;
+    bool useProbeCache = _imp->getProbeParamsHash(&paramsHash);
+    if (useProbeCache) {
+        double first, last;
+        getFrameRange(&first, &last);
+        filename = _imp->getFileNameAtTime( first, ViewIdx(0) );
+        useProbeCache = !filename.empty();
+    }
+    if (useProbeCache) {
+        bool mustCheckFile;
+        bool found = ReaderProbeCache::getMetadata(filename, paramsHash, getNInputs(), &metadata, &mustCheckFile);
+        if (mustCheckFile) {
+            _imp->checkProbedFile(filename);
+        }
+        if (found) {
+            return eStatusOK;
+        }
+    }
+
+    StatusEnum stat = p->getEffectInstance()->getPreferredMetadata(metadata);
+    if ( useProbeCache && (stat == eStatusOK) ) {
+        ReaderProbeCache::setMetadata(filename, paramsHash, getNInputs(), metadata);
+    }
+
+    return stat;
 }
 
 void
@@ -1332,11 +1621,46 @@ ReadNode::getRegionOfDefinition(U64 hash,
         return eStatusFailed;
     }
     NodePtr p = getEmbeddedReader();
-    if (p) {
-        return p->getEffectInstance()->getRegionOfDefinition(hash, time, scale, view, rod);
-    } else {
+    if (!p) {
         return eStatusFailed;
     }
+
+    // Reuse what the reader found out when it opened the file in a previous session
+    int frame = (int)std::floor(time + 0.5);
+    U64 paramsHash = 0;
+    std::string filename;
+    bool useProbeCache = _imp->getProbeParamsHash(&paramsHash);
+    if (useProbeCache) {
+        filename = _imp->getFileNameAtTime(time, view);
+        useProbeCache = !filename.empty();
+    }
+    if (useProbeCache) {
+        bool mustCheckFile;
+        bool found = ReaderProbeCache::getRegionOfDefinition(filename, paramsHash, frame, view, rod, &mustCheckFile);
+        if (mustCheckFile) {
+            _imp->checkProbedFile(filename);
+        }
+        if (found) {
+            return eStatusOK;
+        }
+    }
+
+    StatusEnum stat = p->getEffectInstance()->getRegionOfDefinition(hash, time, scale, view, rod);
+    if ( useProbeCache && (stat == eStatusOK) ) {
+        ReaderProbeCache::setRegionOfDefinition(filename, paramsHash, frame, view, *rod);
+    }
+
+    return stat;
+}
+
+void
+ReadNode::onProbedFileChanged()
+{
+    // The results remembered from a previous session were used but the file changed since: read it again
+    purgeCaches();
+    getNode()->incrementKnobsAge();
+    refreshMetadata_public(true);
+    getApp()->renderAllViewers(true);
 }
 
 void
@@ -1378,6 +1702,10 @@ ReadNode::beginSequenceRender(double first,
                               bool isOpenGLRender,
                               const EffectInstance::OpenGLContextEffectDataPtr& glContextData)
 {
+    if (isSequentialRender) {
+        QMutexLocker k(&_imp->prefetchMutex);
+        ++_imp->sequentialRendersCount;
+    }
     NodePtr p = getEmbeddedReader();
     if (p) {
         return p->getEffectInstance()->beginSequenceRender(first, last, step, interactive, scale, isSequentialRender, isRenderResponseToUserInteraction, draftMode, view, isOpenGLRender, glContextData);
@@ -1399,6 +1727,17 @@ ReadNode::endSequenceRender(double first,
                             bool isOpenGLRender,
                             const EffectInstance::OpenGLContextEffectDataPtr& glContextData)
 {
+    if (isSequentialRender) {
+        QMutexLocker k(&_imp->prefetchMutex);
+        if (_imp->sequentialRendersCount > 0) {
+            --_imp->sequentialRendersCount;
+        }
+        if (_imp->sequentialRendersCount == 0) {
+            _imp->lastRenderedFrame = INT_MIN;
+            _imp->lastPrefetchedFrame = INT_MIN;
+            _imp->prefetchDirection = 0;
+        }
+    }
     NodePtr p = getEmbeddedReader();
     if (p) {
         return p->getEffectInstance()->endSequenceRender(first, last, step, interactive, scale, isSequentialRender, isRenderResponseToUserInteraction, draftMode, view, isOpenGLRender, glContextData);
@@ -1413,13 +1752,31 @@ ReadNode::render(const RenderActionArgs& args)
     if ( !_imp->checkDecoderCreated(args.time, args.view) ) {
         return eStatusFailed;
     }
+    _imp->prefetchNextFiles(args.time, args.view);
 
     NodePtr p = getEmbeddedReader();
-    if (p) {
-        return p->getEffectInstance()->render(args);
-    } else {
+    if (!p) {
         return eStatusFailed;
     }
+    EffectInstancePtr reader = p->getEffectInstance();
+    if (reader->renderThreadSafety() != eRenderSafetyInstanceSafe) {
+        return reader->render(args);
+    }
+
+    // See renderThreadSafety(): decode with a render clone of the reader so that several frames can be
+    // decoded concurrently. The main instance is returned when it is not rendering or if the reader cannot be
+    // cloned, in which case renders go through it one at a time.
+    EffectInstancePtr renderInstance = reader->getOrCreateRenderInstance();
+    StatusEnum stat;
+    if (renderInstance == reader) {
+        QMutexLocker k(&_imp->mainReaderRenderMutex);
+        stat = renderInstance->render(args);
+    } else {
+        stat = renderInstance->render(args);
+    }
+    reader->releaseRenderInstance(renderInstance);
+
+    return stat;
 }
 
 void
@@ -113,6 +113,10 @@ public:
     virtual void onEffectCreated(bool mayCreateFileDialog,
                                  const CreateNodeArgs& defaultParamValues) OVERRIDE FINAL;
 
+public Q_SLOTS:
+
+    void onProbedFileChanged();
+
 private:
 
     virtual StatusEnum getPreferredMetadata(NodeMetadata& metadata) OVERRIDE FINAL;
@@ -0,0 +1,467 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ReaderProbeCache.h"
+
+#include <algorithm> // sort
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+
+#include "Engine/AppManager.h"
+#include "Engine/NodeMetadata.h"
+#include "Engine/RectD.h"
+#include "Engine/RectI.h"
+
+// Bump whenever the layout of the file changes
+#define NATRON_READER_PROBE_CACHE_FORMAT_VERSION 1
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// The metadata of a reader: the output and the inputs data
+struct ProbedMetadata
+{
+    qint32 premult, fielding;
+    double frameRate;
+    bool continuous, frameVarying;
+    qint32 formatX1, formatY1, formatX2, formatY2;
+
+    // Index 0 is the output, then the inputs
+    std::vector<double> pixelAspectRatio;
+    std::vector<qint32> bitDepth, nComps;
+    std::vector<QString> componentsType;
+};
+
+// What is remembered for a file
+struct ProbedFile
+{
+    qint64 size;
+    qint64 lastModified;
+
+    // When the results were last used, to forget the oldest files first
+    qint64 lastUsed;
+
+    // Whether the file was checked or is being checked in this session, not saved
+    bool checked;
+
+    // By parameters hash
+    std::map<U64, ProbedMetadata> metadata;
+
+    // By parameters hash, frame and view
+    std::map<std::pair<U64, std::pair<qint32, qint32> >, RectD> rods;
+
+    ProbedFile()
+        : size(0)
+        , lastModified(0)
+        , lastUsed(0)
+        , checked(false)
+        , metadata()
+        , rods()
+    {
+    }
+};
+
+typedef std::map<QString, ProbedFile> ProbedFilesMap;
+
+struct ProbeCacheData
+{
+    QMutex lock;
+    ProbedFilesMap files;
+    bool loaded;
+    bool dirty;
+
+    ProbeCacheData()
+        : lock()
+        , files()
+        , loaded(false)
+        , dirty(false)
+    {
+    }
+};
+
+ProbeCacheData probeCache;
+
+QString
+getProbeCacheFilePath()
+{
+    return appPTR->getDiskCacheLocation() + QString::fromUtf8("/ReaderProbeCache_") +
+           QString::fromUtf8(NATRON_VERSION_STRING) + QString::fromUtf8("_") +
+           QString::fromUtf8(NATRON_DEVELOPMENT_STATUS) + QString::fromUtf8("_") +
+           QString::number(NATRON_BUILD_NUMBER) + QString::fromUtf8(".bin");
+}
+
+QDataStream&
+operator<<(QDataStream& ds,
+           const ProbedMetadata& m)
+{
+    ds << m.premult << m.fielding << m.frameRate << m.continuous << m.frameVarying
+       << m.formatX1 << m.formatY1 << m.formatX2 << m.formatY2 << (quint32)m.pixelAspectRatio.size();
+    for (std::size_t i = 0; i < m.pixelAspectRatio.size(); ++i) {
+        ds << m.pixelAspectRatio[i] << m.bitDepth[i] << m.nComps[i] << m.componentsType[i];
+    }
+
+    return ds;
+}
+
+QDataStream&
+operator>>(QDataStream& ds,
+           ProbedMetadata& m)
+{
+    quint32 nData = 0;
+
+    ds >> m.premult >> m.fielding >> m.frameRate >> m.continuous >> m.frameVarying
+       >> m.formatX1 >> m.formatY1 >> m.formatX2 >> m.formatY2 >> nData;
+    if ( (ds.status() != QDataStream::Ok) || (nData > 1024) ) {
+        ds.setStatus(QDataStream::ReadCorruptData);
+
+        return ds;
+    }
+    m.pixelAspectRatio.resize(nData);
+    m.bitDepth.resize(nData);
+    m.nComps.resize(nData);
+    m.componentsType.resize(nData);
+    for (quint32 i = 0; i < nData; ++i) {
+        ds >> m.pixelAspectRatio[i] >> m.bitDepth[i] >> m.nComps[i] >> m.componentsType[i];
+    }
+
+    return ds;
+}
+
+void
+loadProbeCacheLocked()
+{
+    if (probeCache.loaded) {
+        return;
+    }
+    probeCache.loaded = true;
+
+    QFile file( getProbeCacheFilePath() );
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return;
+    }
+    QDataStream ds(&file);
+    qint32 formatVersion = 0;
+    quint32 nFiles = 0;
+    ds >> formatVersion >> nFiles;
+    if ( (ds.status() != QDataStream::Ok) || (formatVersion != NATRON_READER_PROBE_CACHE_FORMAT_VERSION) ) {
+        return;
+    }
+    for (quint32 i = 0; i < nFiles; ++i) {
+        QString filename;
+        ProbedFile f;
+        quint32 nMetadata = 0, nRoDs = 0;
+        ds >> filename >> f.size >> f.lastModified >> f.lastUsed >> nMetadata;
+        for (quint32 j = 0; j < nMetadata && ds.status() == QDataStream::Ok; ++j) {
+            quint64 paramsHash;
+            ProbedMetadata m;
+            ds >> paramsHash >> m;
+            f.metadata[paramsHash] = m;
+        }
+        ds >> nRoDs;
+        for (quint32 j = 0; j < nRoDs && ds.status() == QDataStream::Ok; ++j) {
+            quint64 paramsHash;
+            qint32 frame, view;
+            RectD rod;
+            ds >> paramsHash >> frame >> view >> rod.x1 >> rod.y1 >> rod.x2 >> rod.y2;
+            f.rods[std::make_pair( (U64)paramsHash, std::make_pair(frame, view) )] = rod;
+        }
+        if (ds.status() != QDataStream::Ok) {
+            // Truncated or corrupted file: do not trust anything in it
+            probeCache.files.clear();
+
+            return;
+        }
+        probeCache.files[filename] = f;
+    }
+}
+
+/**
+ * @brief Returns the results of the file if they can be used, and whether it must be checked.
+ **/
+ProbedFile*
+findProbedFileLocked(const std::string& filename,
+                     bool* mustCheckFile)
+{
+    *mustCheckFile = false;
+    loadProbeCacheLocked();
+
+    ProbedFilesMap::iterator found = probeCache.files.find( QString::fromUtf8( filename.c_str() ) );
+    if ( found == probeCache.files.end() ) {
+        return 0;
+    }
+    if (!found->second.checked) {
+        found->second.checked = true;
+        *mustCheckFile = true;
+    }
+    found->second.lastUsed = QDateTime::currentMSecsSinceEpoch();
+
+    return &found->second;
+}
+
+/**
+ * @brief Reads the size and modification date of the file, this accesses the file system.
+ **/
+bool
+statFile(const QString& path,
+         qint64* size,
+         qint64* lastModified)
+{
+    QFileInfo info(path);
+
+    if ( !info.exists() ) {
+        return false;
+    }
+    *size = info.size();
+    *lastModified = info.lastModified().toMSecsSinceEpoch();
+
+    return true;
+}
+
+/**
+ * @brief Returns the entry of the file to store new results, its previous results are forgotten if the file changed.
+ **/
+ProbedFile*
+getProbedFileForWritingLocked(const QString& path,
+                              qint64 size,
+                              qint64 lastModified)
+{
+    loadProbeCacheLocked();
+
+    ProbedFile& f = probeCache.files[path];
+    if ( (f.size != size) || (f.lastModified != lastModified) ) {
+        f.metadata.clear();
+        f.rods.clear();
+        f.size = size;
+        f.lastModified = lastModified;
+    }
+    f.checked = true;
+    f.lastUsed = QDateTime::currentMSecsSinceEpoch();
+    probeCache.dirty = true;
+
+    return &f;
+}
+
+bool
+compareLastUsed(const ProbedFilesMap::iterator& a,
+                const ProbedFilesMap::iterator& b)
+{
+    return a->second.lastUsed > b->second.lastUsed;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+namespace ReaderProbeCache {
+
+bool
+getMetadata(const std::string& filename,
+            U64 paramsHash,
+            int nInputs,
+            NodeMetadata* metadata,
+            bool* mustCheckFile)
+{
+    QMutexLocker k(&probeCache.lock);
+    ProbedFile* f = findProbedFileLocked(filename, mustCheckFile);
+
+    if (!f) {
+        return false;
+    }
+    std::map<U64, ProbedMetadata>::const_iterator found = f->metadata.find(paramsHash);
+    if ( ( found == f->metadata.end() ) || ( (int)found->second.pixelAspectRatio.size() != nInputs + 1 ) ) {
+        return false;
+    }
+    const ProbedMetadata& m = found->second;
+    metadata->clearAndResize(nInputs);
+    metadata->setOutputPremult( (ImagePremultiplicationEnum)m.premult );
+    metadata->setOutputFielding( (ImageFieldingOrderEnum)m.fielding );
+    metadata->setOutputFrameRate(m.frameRate);
+    metadata->setIsContinuous(m.continuous);
+    metadata->setIsFrameVarying(m.frameVarying);
+    metadata->setOutputFormat( RectI(m.formatX1, m.formatY1, m.formatX2, m.formatY2) );
+    for (int i = -1; i < nInputs; ++i) {
+        metadata->setPixelAspectRatio(i, m.pixelAspectRatio[i + 1]);
+        metadata->setBitDepth( i, (ImageBitDepthEnum)m.bitDepth[i + 1] );
+        metadata->setNComps(i, m.nComps[i + 1]);
+        metadata->setComponentsType( i, m.componentsType[i + 1].toStdString() );
+    }
+
+    return true;
+}
+
+void
+setMetadata(const std::string& filename,
+            U64 paramsHash,
+            int nInputs,
+            const NodeMetadata& metadata)
+{
+    ProbedMetadata m;
+
+    m.premult = (qint32)metadata.getOutputPremult();
+    m.fielding = (qint32)metadata.getOutputFielding();
+    m.frameRate = metadata.getOutputFrameRate();
+    m.continuous = metadata.getIsContinuous();
+    m.frameVarying = metadata.getIsFrameVarying();
+    const RectI& format = metadata.getOutputFormat();
+    m.formatX1 = format.x1;
+    m.formatY1 = format.y1;
+    m.formatX2 = format.x2;
+    m.formatY2 = format.y2;
+    for (int i = -1; i < nInputs; ++i) {
+        m.pixelAspectRatio.push_back( metadata.getPixelAspectRatio(i) );
+        m.bitDepth.push_back( (qint32)metadata.getBitDepth(i) );
+        m.nComps.push_back( metadata.getNComps(i) );
+        m.componentsType.push_back( QString::fromUtf8( metadata.getComponentsType(i).c_str() ) );
+    }
+
+    QString path = QString::fromUtf8( filename.c_str() );
+    qint64 size, lastModified;
+    if ( !statFile(path, &size, &lastModified) ) {
+        return;
+    }
+
+    QMutexLocker k(&probeCache.lock);
+    ProbedFile* f = getProbedFileForWritingLocked(path, size, lastModified);
+    f->metadata[paramsHash] = m;
+}
+
+bool
+getRegionOfDefinition(const std::string& filename,
+                      U64 paramsHash,
+                      int frame,
+                      ViewIdx view,
+                      RectD* rod,
+                      bool* mustCheckFile)
+{
+    QMutexLocker k(&probeCache.lock);
+    ProbedFile* f = findProbedFileLocked(filename, mustCheckFile);
+
+    if (!f) {
+        return false;
+    }
+    std::map<std::pair<U64, std::pair<qint32, qint32> >, RectD>::const_iterator found =
+        f->rods.find( std::make_pair( paramsHash, std::make_pair( (qint32)frame, (qint32)view.value() ) ) );
+    if ( found == f->rods.end() ) {
+        return false;
+    }
+    *rod = found->second;
+
+    return true;
+}
+
+void
+setRegionOfDefinition(const std::string& filename,
+                      U64 paramsHash,
+                      int frame,
+                      ViewIdx view,
+                      const RectD& rod)
+{
+    QString path = QString::fromUtf8( filename.c_str() );
+    qint64 size, lastModified;
+
+    if ( !statFile(path, &size, &lastModified) ) {
+        return;
+    }
+
+    QMutexLocker k(&probeCache.lock);
+    ProbedFile* f = getProbedFileForWritingLocked(path, size, lastModified);
+    if (f->rods.size() >= NATRON_READER_PROBE_CACHE_MAX_ROD_PER_FILE) {
+        f->rods.clear();
+    }
+    f->rods[std::make_pair( paramsHash, std::make_pair( (qint32)frame, (qint32)view.value() ) )] = rod;
+}
+
+bool
+checkFile(const std::string& filename)
+{
+    QString path = QString::fromUtf8( filename.c_str() );
+    qint64 size = 0, lastModified = 0;
+    bool exists = statFile(path, &size, &lastModified);
+
+    QMutexLocker k(&probeCache.lock);
+    ProbedFilesMap::iterator found = probeCache.files.find(path);
+    if ( found == probeCache.files.end() ) {
+        return false;
+    }
+    if ( exists && (found->second.size == size) && (found->second.lastModified == lastModified) ) {
+        return true;
+    }
+    probeCache.files.erase(found);
+    probeCache.dirty = true;
+
+    return false;
+}
+
+void
+save()
+{
+    QMutexLocker k(&probeCache.lock);
+
+    if (!probeCache.dirty) {
+        return;
+    }
+    probeCache.dirty = false;
+
+    std::vector<ProbedFilesMap::iterator> files;
+    files.reserve( probeCache.files.size() );
+    for (ProbedFilesMap::iterator it = probeCache.files.begin(); it != probeCache.files.end(); ++it) {
+        files.push_back(it);
+    }
+    if (files.size() > NATRON_READER_PROBE_CACHE_MAX_FILES) {
+        // Keep the most recently used files
+        std::sort(files.begin(), files.end(), compareLastUsed);
+        files.resize(NATRON_READER_PROBE_CACHE_MAX_FILES);
+    }
+
+    QFile file( getProbeCacheFilePath() );
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        return;
+    }
+    QDataStream ds(&file);
+    ds << (qint32)NATRON_READER_PROBE_CACHE_FORMAT_VERSION << (quint32)files.size();
+    for (std::vector<ProbedFilesMap::iterator>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        const ProbedFile& f = (*it)->second;
+        ds << (*it)->first << f.size << f.lastModified << f.lastUsed << (quint32)f.metadata.size();
+        for (std::map<U64, ProbedMetadata>::const_iterator itm = f.metadata.begin(); itm != f.metadata.end(); ++itm) {
+            ds << (quint64)itm->first << itm->second;
+        }
+        ds << (quint32)f.rods.size();
+        for (std::map<std::pair<U64, std::pair<qint32, qint32> >, RectD>::const_iterator itr = f.rods.begin(); itr != f.rods.end(); ++itr) {
+            ds << (quint64)itr->first.first << itr->first.second.first << itr->first.second.second
+               << itr->second.x1 << itr->second.y1 << itr->second.x2 << itr->second.y2;
+        }
+    }
+}
+
+} // namespace ReaderProbeCache
+
+NATRON_NAMESPACE_EXIT
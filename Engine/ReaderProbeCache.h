@@ -0,0 +1,89 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_ReaderProbeCache_h
+#define Engine_ReaderProbeCache_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/ViewIdx.h"
+#include "Engine/EngineFwd.h"
+
+// Maximum number of files remembered across sessions, the least recently used are forgotten first
+#define NATRON_READER_PROBE_CACHE_MAX_FILES 20000
+
+// Maximum number of regions of definition remembered for a single file (e.g: the frames of a movie file)
+#define NATRON_READER_PROBE_CACHE_MAX_ROD_PER_FILE 1000
+
+NATRON_NAMESPACE_ENTER
+
+// Remembers across sessions what the readers found out when opening a file: the metadata and the region of definition.
+// Opening a project makes every Read node open its files again to get them, which is slow on network storage
+// when a project has many Read nodes.
+// The results are identified by the file path and a hash of the parameters of the reader (see ReadNode), and are
+// valid as long as the file keeps the same size and modification date. To keep lookups free of file system accesses,
+// the results of a file are used right away and the file is only checked once per session, in the background
+// (see checkFile()).
+
+namespace ReaderProbeCache {
+
+/**
+ * @brief Returns true if the metadata of the reader was remembered for the given file and parameters.
+ * nInputs is the number of inputs of the reader.
+ * *mustCheckFile is set to true if the results of the file are used for the first time in this session: the caller
+ * must then call checkFile().
+ **/
+bool getMetadata(const std::string& filename, U64 paramsHash, int nInputs, NodeMetadata* metadata, bool* mustCheckFile);
+
+void setMetadata(const std::string& filename, U64 paramsHash, int nInputs, const NodeMetadata& metadata);
+
+/**
+ * @brief Same as getMetadata() for the region of definition at the given frame and view.
+ **/
+bool getRegionOfDefinition(const std::string& filename, U64 paramsHash, int frame, ViewIdx view, RectD* rod, bool* mustCheckFile);
+
+void setRegionOfDefinition(const std::string& filename, U64 paramsHash, int frame, ViewIdx view, const RectD& rod);
+
+/**
+ * @brief Checks that the file did not change since its results were remembered, otherwise forgets them.
+ * This accesses the file system and should be called from a background thread.
+ * @returns False if the results of the file were forgotten.
+ **/
+bool checkFile(const std::string& filename);
+
+/**
+ * @brief Writes the results to disk for the next sessions, if they changed.
+ **/
+void save();
+
+} // namespace ReaderProbeCache
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_ReaderProbeCache_h
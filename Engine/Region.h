@@ -0,0 +1,372 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_Region_h
+#define Engine_Region_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "Engine/RectI.h"
+#include "Engine/RectD.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief A set of pixels described by non-overlapping rectangles, so that the union of disjoint
+ * rectangles does not collapse to their bounding box.
+ * The rectangles are stored in y-x banded form: the region is split in horizontal bands in which
+ * every rectangle has the same y1/y2, sorted by y then x, and vertically adjacent bands with the
+ * same horizontal spans are coalesced.
+ * RectType must have public x1,y1,x2,y2 members of type CoordType and an isNull() function (RectI, RectD).
+ **/
+template <class RectType, typename CoordType>
+class Region
+{
+public:
+
+    Region()
+        : _rects()
+    {
+    }
+
+    explicit Region(const RectType & rect)
+        : _rects()
+    {
+        if ( !rect.isNull() ) {
+            _rects.push_back(rect);
+        }
+    }
+
+    bool isEmpty() const
+    {
+        return _rects.empty();
+    }
+
+    void clear()
+    {
+        _rects.clear();
+    }
+
+    /**
+     * @brief The banded rectangles of the region, they do not overlap each other.
+     **/
+    const std::vector<RectType>& getRects() const
+    {
+        return _rects;
+    }
+
+    std::size_t getRectsCount() const
+    {
+        return _rects.size();
+    }
+
+    /**
+     * @brief Returns the smallest rectangle enclosing the region, or a null rectangle if it is empty.
+     **/
+    RectType getBoundingBox() const
+    {
+        RectType ret;
+
+        ret.clear();
+        if ( _rects.empty() ) {
+            return ret;
+        }
+        ret = _rects.front();
+        for (std::size_t i = 1; i < _rects.size(); ++i) {
+            ret.merge(_rects[i]);
+        }
+
+        return ret;
+    }
+
+    bool intersects(const RectType & rect) const
+    {
+        for (std::size_t i = 0; i < _rects.size(); ++i) {
+            if ( _rects[i].intersects(rect) ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Returns true if all pixels of rect are in the region.
+     **/
+    bool contains(const RectType & rect) const
+    {
+        if ( rect.isNull() ) {
+            return true;
+        }
+        Region remain(rect);
+        remain.subtract(*this);
+
+        return remain.isEmpty();
+    }
+
+    void unite(const RectType & rect)
+    {
+        if ( rect.isNull() ) {
+            return;
+        }
+        if ( _rects.empty() ) {
+            _rects.push_back(rect);
+
+            return;
+        }
+        unite( Region(rect) );
+    }
+
+    void unite(const Region & other)
+    {
+        if ( other.isEmpty() ) {
+            return;
+        }
+        if ( isEmpty() ) {
+            _rects = other._rects;
+
+            return;
+        }
+        combine(other, eRegionOpUnion);
+    }
+
+    void intersect(const RectType & rect)
+    {
+        intersect( Region(rect) );
+    }
+
+    void intersect(const Region & other)
+    {
+        if ( isEmpty() || other.isEmpty() ) {
+            _rects.clear();
+
+            return;
+        }
+        combine(other, eRegionOpIntersect);
+    }
+
+    void subtract(const RectType & rect)
+    {
+        if ( rect.isNull() ) {
+            return;
+        }
+        subtract( Region(rect) );
+    }
+
+    void subtract(const Region & other)
+    {
+        if ( isEmpty() || other.isEmpty() ) {
+            return;
+        }
+        combine(other, eRegionOpSubtract);
+    }
+
+    bool operator==(const Region & other) const
+    {
+        if ( _rects.size() != other._rects.size() ) {
+            return false;
+        }
+        for (std::size_t i = 0; i < _rects.size(); ++i) {
+            const RectType & a = _rects[i];
+            const RectType & b = other._rects[i];
+            if ( (a.x1 != b.x1) || (a.y1 != b.y1) || (a.x2 != b.x2) || (a.y2 != b.y2) ) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool operator!=(const Region & other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+
+    enum RegionOpEnum
+    {
+        eRegionOpUnion = 0,
+        eRegionOpIntersect,
+        eRegionOpSubtract
+    };
+
+    typedef std::pair<CoordType, CoordType> Span;
+    typedef std::vector<Span> SpanList;
+
+    /**
+     * @brief Appends to spans the merged horizontal spans of the rectangles covering the band [y1,y2].
+     * Since the bands are built from all the rectangles edges, a rectangle either covers a band entirely or not at all.
+     **/
+    static void getBandSpans(const std::vector<RectType> & rects,
+                             CoordType y1,
+                             CoordType y2,
+                             SpanList* spans)
+    {
+        spans->clear();
+        for (std::size_t i = 0; i < rects.size(); ++i) {
+            if ( (rects[i].y1 <= y1) && (rects[i].y2 >= y2) ) {
+                spans->push_back( Span(rects[i].x1, rects[i].x2) );
+            }
+        }
+        if ( spans->empty() ) {
+            return;
+        }
+        std::sort( spans->begin(), spans->end() );
+        std::size_t n = 0;
+        for (std::size_t i = 1; i < spans->size(); ++i) {
+            if ( (*spans)[i].first <= (*spans)[n].second ) {
+                (*spans)[n].second = std::max( (*spans)[n].second, (*spans)[i].second );
+            } else {
+                (*spans)[++n] = (*spans)[i];
+            }
+        }
+        spans->resize(n + 1);
+    }
+
+    static void combineSpans(const SpanList & a,
+                             const SpanList & b,
+                             RegionOpEnum op,
+                             SpanList* result)
+    {
+        result->clear();
+
+        std::vector<CoordType> xs;
+        xs.reserve( 2 * ( a.size() + b.size() ) );
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            xs.push_back(a[i].first);
+            xs.push_back(a[i].second);
+        }
+        for (std::size_t i = 0; i < b.size(); ++i) {
+            xs.push_back(b[i].first);
+            xs.push_back(b[i].second);
+        }
+        std::sort( xs.begin(), xs.end() );
+        xs.erase( std::unique( xs.begin(), xs.end() ), xs.end() );
+
+        std::size_t ia = 0, ib = 0;
+        for (std::size_t j = 0; j + 1 < xs.size(); ++j) {
+            while ( ia < a.size() && a[ia].second <= xs[j] ) {
+                ++ia;
+            }
+            while ( ib < b.size() && b[ib].second <= xs[j] ) {
+                ++ib;
+            }
+            bool inA = ia < a.size() && a[ia].first <= xs[j];
+            bool inB = ib < b.size() && b[ib].first <= xs[j];
+            bool keep;
+            switch (op) {
+            case eRegionOpUnion:
+                keep = inA || inB;
+                break;
+            case eRegionOpIntersect:
+                keep = inA && inB;
+                break;
+            case eRegionOpSubtract:
+            default:
+                keep = inA && !inB;
+                break;
+            }
+            if (!keep) {
+                continue;
+            }
+            if ( !result->empty() && (result->back().second == xs[j]) ) {
+                result->back().second = xs[j + 1];
+            } else {
+                result->push_back( Span(xs[j], xs[j + 1]) );
+            }
+        }
+    }
+
+    void combine(const Region & other,
+                 RegionOpEnum op)
+    {
+        std::vector<CoordType> ys;
+        ys.reserve( 2 * ( _rects.size() + other._rects.size() ) );
+        for (std::size_t i = 0; i < _rects.size(); ++i) {
+            ys.push_back(_rects[i].y1);
+            ys.push_back(_rects[i].y2);
+        }
+        for (std::size_t i = 0; i < other._rects.size(); ++i) {
+            ys.push_back(other._rects[i].y1);
+            ys.push_back(other._rects[i].y2);
+        }
+        std::sort( ys.begin(), ys.end() );
+        ys.erase( std::unique( ys.begin(), ys.end() ), ys.end() );
+
+        std::vector<RectType> result;
+        SpanList spansA, spansB, bandSpans, prevSpans;
+        std::size_t prevBandStart = 0;
+        bool hasPrevBand = false;
+        CoordType prevY2 = CoordType();
+
+        for (std::size_t i = 0; i + 1 < ys.size(); ++i) {
+            CoordType y1 = ys[i];
+            CoordType y2 = ys[i + 1];
+            getBandSpans(_rects, y1, y2, &spansA);
+            getBandSpans(other._rects, y1, y2, &spansB);
+            combineSpans(spansA, spansB, op, &bandSpans);
+            if ( bandSpans.empty() ) {
+                hasPrevBand = false;
+                continue;
+            }
+            if ( hasPrevBand && (prevY2 == y1) && (bandSpans == prevSpans) ) {
+                // Same spans as the band right below: grow it instead of adding new rectangles
+                for (std::size_t k = prevBandStart; k < result.size(); ++k) {
+                    result[k].y2 = y2;
+                }
+            } else {
+                prevBandStart = result.size();
+                for (std::size_t k = 0; k < bandSpans.size(); ++k) {
+                    RectType r;
+                    r.x1 = bandSpans[k].first;
+                    r.y1 = y1;
+                    r.x2 = bandSpans[k].second;
+                    r.y2 = y2;
+                    result.push_back(r);
+                }
+                prevSpans.swap(bandSpans);
+                hasPrevBand = true;
+            }
+            prevY2 = y2;
+        }
+        _rects.swap(result);
+    }
+
+    std::vector<RectType> _rects;
+};
+
+typedef Region<RectI, int> RegionI;
+typedef Region<RectD, double> RegionD;
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Engine_Region_h
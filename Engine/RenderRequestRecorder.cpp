@@ -0,0 +1,727 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderRequestRecorder.h"
+
+#include <cassert>
+#include <cstdio> // snprintf
+#include <list>
+#include <sstream>
+
+#include <boost/atomic.hpp>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+
+#include "Global/FStreamsSupport.h"
+
+#include "Engine/AppInstance.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Knob.h"
+#include "Engine/Node.h"
+#include "Engine/OutputEffectInstance.h"
+#include "Engine/OutputSchedulerThread.h"
+#include "Engine/TimeLine.h"
+#include "Engine/ViewIdx.h"
+
+#define NATRON_RENDER_REQUEST_LOG_HEADER "NatronRenderRequestLog 1"
+
+// Beyond this many events the recording stops, so that a forgotten recording does not eat all the memory
+#define NATRON_RENDER_REQUEST_LOG_MAX_EVENTS 1000000
+
+// After the last event, replay() waits at most this long for the renders to finish
+#define NATRON_RENDER_REQUEST_REPLAY_TIMEOUT_SECONDS 600
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct RequestRecorder
+{
+    boost::atomic<bool> enabled;
+    QMutex mutex; // protects all the following
+    QElapsedTimer clock;
+    std::vector<RenderRequestEvent> events;
+    QByteArray projectContent;
+
+    RequestRecorder()
+        : enabled(false)
+        , mutex()
+        , clock()
+        , events()
+        , projectContent()
+    {
+        clock.start();
+    }
+};
+
+RequestRecorder&
+getRecorder()
+{
+    static RequestRecorder recorder;
+
+    return recorder;
+}
+
+void
+addEvent(RenderRequestEvent& e)
+{
+    RequestRecorder& recorder = getRecorder();
+    QMutexLocker k(&recorder.mutex);
+
+    if (recorder.events.size() >= NATRON_RENDER_REQUEST_LOG_MAX_EVENTS) {
+        return;
+    }
+    e.timestamp = (U64)(recorder.clock.nsecsElapsed() / 1000);
+    recorder.events.push_back(e);
+}
+
+std::string
+getNodeName(const EffectInstance* effect)
+{
+    NodePtr node = effect ? effect->getNode() : NodePtr();
+
+    return node ? node->getFullyQualifiedName() : std::string();
+}
+
+std::string
+doubleToString(double v)
+{
+    char buf[64];
+
+    snprintf(buf, sizeof(buf), "%.17g", v);
+
+    return buf;
+}
+
+double
+stringToDouble(const std::string& str)
+{
+    // QString::toDouble() always uses the C locale
+    return QString::fromUtf8( str.c_str() ).toDouble();
+}
+
+// Fields are separated by tabs and events by new lines: escape them in the strings
+std::string
+escapeString(const std::string& str)
+{
+    std::string ret;
+
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        switch (str[i]) {
+        case '\\':
+            ret.append("\\\\");
+            break;
+        case '\t':
+            ret.append("\\t");
+            break;
+        case '\n':
+            ret.append("\\n");
+            break;
+        case '\r':
+            ret.append("\\r");
+            break;
+        default:
+            ret.push_back(str[i]);
+            break;
+        }
+    }
+
+    return ret;
+}
+
+std::string
+unescapeString(const std::string& str)
+{
+    std::string ret;
+
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        if ( (str[i] == '\\') && (i + 1 < str.size()) ) {
+            ++i;
+            switch (str[i]) {
+            case 't':
+                ret.push_back('\t');
+                break;
+            case 'n':
+                ret.push_back('\n');
+                break;
+            case 'r':
+                ret.push_back('\r');
+                break;
+            default:
+                ret.push_back(str[i]);
+                break;
+            }
+        } else {
+            ret.push_back(str[i]);
+        }
+    }
+
+    return ret;
+}
+
+std::vector<int>
+viewsToInts(const std::vector<ViewIdx>& views)
+{
+    std::vector<int> ret;
+
+    for (std::size_t i = 0; i < views.size(); ++i) {
+        ret.push_back(views[i]);
+    }
+
+    return ret;
+}
+
+std::string
+viewsToString(const std::vector<int>& views)
+{
+    std::stringstream ss;
+
+    for (std::size_t i = 0; i < views.size(); ++i) {
+        if (i > 0) {
+            ss << ',';
+        }
+        ss << views[i];
+    }
+
+    return ss.str();
+}
+
+std::vector<int>
+viewsFromString(const std::string& str)
+{
+    std::vector<int> ret;
+    std::stringstream ss(str);
+    std::string view;
+
+    while ( std::getline(ss, view, ',') ) {
+        if ( !view.empty() ) {
+            ret.push_back( QString::fromUtf8( view.c_str() ).toInt() );
+        }
+    }
+
+    return ret;
+}
+
+const char*
+getTypeName(RenderRequestEvent::TypeEnum type)
+{
+    switch (type) {
+    case RenderRequestEvent::eTypeRenderCurrentFrame:
+        return "render";
+    case RenderRequestEvent::eTypeRenderFrameRange:
+        return "range";
+    case RenderRequestEvent::eTypeRenderFromCurrentFrame:
+        return "playback";
+    case RenderRequestEvent::eTypeAbort:
+        return "abort";
+    case RenderRequestEvent::eTypeKnobChanged:
+        return "knob";
+    }
+
+    return "";
+}
+
+bool
+getTypeFromName(const std::string& name,
+                RenderRequestEvent::TypeEnum* type)
+{
+    for (int i = 0; i <= (int)RenderRequestEvent::eTypeKnobChanged; ++i) {
+        if ( name == getTypeName( (RenderRequestEvent::TypeEnum)i ) ) {
+            *type = (RenderRequestEvent::TypeEnum)i;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// The knob types that hold a value that can be replayed
+bool
+getKnobValue(KnobI* knob,
+             int dimension,
+             double time,
+             std::string* value)
+{
+    if ( Knob<double>* isDouble = dynamic_cast<Knob<double>*>(knob) ) {
+        *value = doubleToString( isDouble->getValueAtTime(time, dimension) );
+    } else if ( Knob<int>* isInt = dynamic_cast<Knob<int>*>(knob) ) {
+        *value = doubleToString( isInt->getValueAtTime(time, dimension) );
+    } else if ( Knob<bool>* isBool = dynamic_cast<Knob<bool>*>(knob) ) {
+        *value = isBool->getValueAtTime(time, dimension) ? "1" : "0";
+    } else if ( Knob<std::string>* isString = dynamic_cast<Knob<std::string>*>(knob) ) {
+        *value = isString->getValueAtTime(time, dimension);
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+template <typename T>
+void
+setKnobValueInternal(Knob<T>* knob,
+                     const RenderRequestEvent& e,
+                     const T& value)
+{
+    if (e.animated) {
+        knob->setValueAtTime(e.time, value, ViewSpec::all(), e.dimension, eValueChangedReasonUserEdited, 0);
+    } else {
+        knob->setValue(value, ViewSpec::all(), e.dimension, eValueChangedReasonUserEdited, 0);
+    }
+}
+
+void
+setKnobValue(KnobI* knob,
+             const RenderRequestEvent& e)
+{
+    if ( Knob<double>* isDouble = dynamic_cast<Knob<double>*>(knob) ) {
+        setKnobValueInternal( isDouble, e, stringToDouble(e.value) );
+    } else if ( Knob<int>* isInt = dynamic_cast<Knob<int>*>(knob) ) {
+        setKnobValueInternal( isInt, e, (int)stringToDouble(e.value) );
+    } else if ( Knob<bool>* isBool = dynamic_cast<Knob<bool>*>(knob) ) {
+        setKnobValueInternal(isBool, e, e.value == "1");
+    } else if ( Knob<std::string>* isString = dynamic_cast<Knob<std::string>*>(knob) ) {
+        setKnobValueInternal(isString, e, e.value);
+    }
+}
+
+// Runs the Qt event loop for the given time, so that the queued requests of the render engines are processed
+void
+processEventsFor(int milliseconds)
+{
+    QEventLoop loop;
+
+    QTimer::singleShot( milliseconds, &loop, SLOT(quit()) );
+    loop.exec();
+}
+
+struct PendingRender
+{
+    RenderEnginePtr engine;
+    std::size_t resultIndex;
+    double startTime;
+};
+
+double
+getSeconds(const QElapsedTimer& clock)
+{
+    return clock.nsecsElapsed() * 1e-9;
+}
+
+// Fills the latency of the renders whose engine stopped working
+void
+updatePendingRenders(const QElapsedTimer& clock,
+                     std::list<PendingRender>* pending,
+                     std::vector<RenderRequestReplayResult>* results)
+{
+    for (std::list<PendingRender>::iterator it = pending->begin(); it != pending->end();) {
+        if ( !it->engine->hasThreadsWorking() ) {
+            (*results)[it->resultIndex].latency = getSeconds(clock) - it->startTime;
+            it = pending->erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+RenderRequestRecorder::setEnabled(bool enabled)
+{
+    getRecorder().enabled.store(enabled);
+}
+
+bool
+RenderRequestRecorder::isEnabled()
+{
+    return getRecorder().enabled.load(boost::memory_order_relaxed);
+}
+
+void
+RenderRequestRecorder::setProjectFile(const std::string& filePath)
+{
+    QByteArray content;
+    {
+        QFile file( QString::fromUtf8( filePath.c_str() ) );
+        if ( file.open(QIODevice::ReadOnly) ) {
+            content = file.readAll();
+        }
+    }
+
+    RequestRecorder& recorder = getRecorder();
+    QMutexLocker k(&recorder.mutex);
+    recorder.projectContent = content;
+    recorder.events.clear();
+    recorder.clock.restart();
+}
+
+void
+RenderRequestRecorder::recordRenderCurrentFrame(const OutputEffectInstance* output,
+                                                double time,
+                                                bool canAbort)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    RenderRequestEvent e;
+    e.type = RenderRequestEvent::eTypeRenderCurrentFrame;
+    e.node = getNodeName(output);
+    e.time = time;
+    e.flag = canAbort;
+    addEvent(e);
+}
+
+void
+RenderRequestRecorder::recordRenderFrameRange(const OutputEffectInstance* output,
+                                              int firstFrame,
+                                              int lastFrame,
+                                              int frameStep,
+                                              const std::vector<ViewIdx>& views,
+                                              bool forward)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    RenderRequestEvent e;
+    e.type = RenderRequestEvent::eTypeRenderFrameRange;
+    e.node = getNodeName(output);
+    e.firstFrame = firstFrame;
+    e.lastFrame = lastFrame;
+    e.frameStep = frameStep;
+    e.views = viewsToInts(views);
+    e.forward = forward;
+    addEvent(e);
+}
+
+void
+RenderRequestRecorder::recordRenderFromCurrentFrame(const OutputEffectInstance* output,
+                                                    double time,
+                                                    const std::vector<ViewIdx>& views,
+                                                    bool forward)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    RenderRequestEvent e;
+    e.type = RenderRequestEvent::eTypeRenderFromCurrentFrame;
+    e.node = getNodeName(output);
+    e.time = time;
+    e.views = viewsToInts(views);
+    e.forward = forward;
+    addEvent(e);
+}
+
+void
+RenderRequestRecorder::recordAbort(const OutputEffectInstance* output,
+                                   bool autoRestart)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    RenderRequestEvent e;
+    e.type = RenderRequestEvent::eTypeAbort;
+    e.node = getNodeName(output);
+    e.flag = autoRestart;
+    addEvent(e);
+}
+
+void
+RenderRequestRecorder::recordKnobChanged(KnobI* knob,
+                                         int dimension,
+                                         double time)
+{
+    if ( !isEnabled() || !knob ) {
+        return;
+    }
+    EffectInstance* effect = dynamic_cast<EffectInstance*>( knob->getHolder() );
+    if (!effect) {
+        return;
+    }
+    RenderRequestEvent e;
+    if ( !getKnobValue(knob, dimension, time, &e.value) ) {
+        return;
+    }
+    e.type = RenderRequestEvent::eTypeKnobChanged;
+    e.node = getNodeName(effect);
+    e.knob = knob->getName();
+    e.dimension = dimension;
+    e.time = time;
+    e.animated = knob->isAnimated(dimension);
+    addEvent(e);
+}
+
+bool
+RenderRequestRecorder::write(const std::string& filePath)
+{
+    RequestRecorder& recorder = getRecorder();
+    QMutexLocker k(&recorder.mutex);
+
+    std::string projectFilePath = filePath + ".ntp";
+    {
+        QFile file( QString::fromUtf8( projectFilePath.c_str() ) );
+        if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) || (file.write(recorder.projectContent) != recorder.projectContent.size()) ) {
+            return false;
+        }
+    }
+
+    FStreamsSupport::ofstream ofile;
+    FStreamsSupport::open(&ofile, filePath);
+    if (!ofile) {
+        return false;
+    }
+    ofile << NATRON_RENDER_REQUEST_LOG_HEADER << '\n';
+    ofile << escapeString(projectFilePath) << '\n';
+    for (std::size_t i = 0; i < recorder.events.size(); ++i) {
+        const RenderRequestEvent& e = recorder.events[i];
+        ofile << e.timestamp << '\t' << getTypeName(e.type) << '\t' << escapeString(e.node);
+        switch (e.type) {
+        case RenderRequestEvent::eTypeRenderCurrentFrame:
+            ofile << '\t' << doubleToString(e.time) << '\t' << (int)e.flag;
+            break;
+        case RenderRequestEvent::eTypeRenderFrameRange:
+            ofile << '\t' << e.firstFrame << '\t' << e.lastFrame << '\t' << e.frameStep << '\t' << viewsToString(e.views) << '\t' << (int)e.forward;
+            break;
+        case RenderRequestEvent::eTypeRenderFromCurrentFrame:
+            ofile << '\t' << doubleToString(e.time) << '\t' << viewsToString(e.views) << '\t' << (int)e.forward;
+            break;
+        case RenderRequestEvent::eTypeAbort:
+            ofile << '\t' << (int)e.flag;
+            break;
+        case RenderRequestEvent::eTypeKnobChanged:
+            ofile << '\t' << escapeString(e.knob) << '\t' << e.dimension << '\t' << doubleToString(e.time) << '\t' << (int)e.animated << '\t' << escapeString(e.value);
+            break;
+        }
+        ofile << '\n';
+    }
+
+    return !ofile.fail();
+} // RenderRequestRecorder::write
+
+bool
+RenderRequestRecorder::read(const std::string& filePath,
+                            std::string* projectFilePath,
+                            std::vector<RenderRequestEvent>* events)
+{
+    FStreamsSupport::ifstream ifile;
+
+    FStreamsSupport::open(&ifile, filePath);
+    if (!ifile) {
+        return false;
+    }
+    std::string line;
+    if ( !std::getline(ifile, line) || (line != NATRON_RENDER_REQUEST_LOG_HEADER) ) {
+        return false;
+    }
+    if ( !std::getline(ifile, line) ) {
+        return false;
+    }
+    *projectFilePath = unescapeString(line);
+
+    events->clear();
+    while ( std::getline(ifile, line) ) {
+        if ( line.empty() ) {
+            continue;
+        }
+        std::vector<std::string> fields;
+        {
+            std::stringstream ss(line);
+            std::string field;
+            while ( std::getline(ss, field, '\t') ) {
+                fields.push_back(field);
+            }
+        }
+        if (fields.size() < 3) {
+            return false;
+        }
+        RenderRequestEvent e;
+        if ( !getTypeFromName(fields[1], &e.type) ) {
+            return false;
+        }
+        e.timestamp = (U64)QString::fromUtf8( fields[0].c_str() ).toULongLong();
+        e.node = unescapeString(fields[2]);
+        switch (e.type) {
+        case RenderRequestEvent::eTypeRenderCurrentFrame:
+            if (fields.size() < 5) {
+                return false;
+            }
+            e.time = stringToDouble(fields[3]);
+            e.flag = fields[4] == "1";
+            break;
+        case RenderRequestEvent::eTypeRenderFrameRange:
+            if (fields.size() < 8) {
+                return false;
+            }
+            e.firstFrame = (int)stringToDouble(fields[3]);
+            e.lastFrame = (int)stringToDouble(fields[4]);
+            e.frameStep = (int)stringToDouble(fields[5]);
+            e.views = viewsFromString(fields[6]);
+            e.forward = fields[7] == "1";
+            break;
+        case RenderRequestEvent::eTypeRenderFromCurrentFrame:
+            if (fields.size() < 6) {
+                return false;
+            }
+            e.time = stringToDouble(fields[3]);
+            e.views = viewsFromString(fields[4]);
+            e.forward = fields[5] == "1";
+            break;
+        case RenderRequestEvent::eTypeAbort:
+            if (fields.size() < 4) {
+                return false;
+            }
+            e.flag = fields[3] == "1";
+            break;
+        case RenderRequestEvent::eTypeKnobChanged:
+            // the value is the last field and may be empty
+            if (fields.size() < 7) {
+                return false;
+            }
+            e.knob = unescapeString(fields[3]);
+            e.dimension = (int)stringToDouble(fields[4]);
+            e.time = stringToDouble(fields[5]);
+            e.animated = fields[6] == "1";
+            e.value = fields.size() > 7 ? unescapeString(fields[7]) : std::string();
+            break;
+        }
+        events->push_back(e);
+    }
+
+    return true;
+} // RenderRequestRecorder::read
+
+void
+RenderRequestRecorder::replay(const AppInstancePtr& app,
+                              const std::vector<RenderRequestEvent>& events,
+                              std::vector<RenderRequestReplayResult>* results)
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    results->clear();
+    std::list<PendingRender> pending;
+    QElapsedTimer clock;
+    clock.start();
+
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        const RenderRequestEvent& e = events[i];
+
+        // Wait for the time of the event, letting the render engines work as they would in the application
+        while ( (U64)(clock.nsecsElapsed() / 1000) < e.timestamp ) {
+            processEventsFor(1);
+            updatePendingRenders(clock, &pending, results);
+        }
+
+        RenderRequestReplayResult result;
+        result.event = e;
+        result.latency = -1.;
+        results->push_back(result);
+
+        NodePtr node = app->getNodeByFullySpecifiedName(e.node);
+        if (!node) {
+            continue;
+        }
+        if (e.type == RenderRequestEvent::eTypeKnobChanged) {
+            KnobIPtr knob = node->getKnobByName(e.knob);
+            if (knob) {
+                setKnobValue(knob.get(), e);
+            }
+            continue;
+        }
+
+        OutputEffectInstance* output = dynamic_cast<OutputEffectInstance*>( node->getEffectInstance().get() );
+        RenderEnginePtr engine = output ? output->getRenderEngine() : RenderEnginePtr();
+        if (!engine) {
+            continue;
+        }
+
+        // A new request to the same engine supersedes the one still running: its latency is left to -1
+        for (std::list<PendingRender>::iterator it = pending.begin(); it != pending.end(); ++it) {
+            if (it->engine == engine) {
+                pending.erase(it);
+                break;
+            }
+        }
+
+        if ( (e.type == RenderRequestEvent::eTypeRenderCurrentFrame) || (e.type == RenderRequestEvent::eTypeRenderFromCurrentFrame) ) {
+            // Move the timeline without notifying it: the renders triggered by the seek were recorded as well
+            TimeLinePtr timeline = app->getTimeLine();
+            timeline->blockSignals(true);
+            timeline->seekFrame( (SequenceTime)e.time, false, 0, eTimelineChangeReasonOtherSeek );
+            timeline->blockSignals(false);
+        }
+
+        std::vector<ViewIdx> views;
+        for (std::size_t v = 0; v < e.views.size(); ++v) {
+            views.push_back( ViewIdx(e.views[v]) );
+        }
+        switch (e.type) {
+        case RenderRequestEvent::eTypeRenderCurrentFrame:
+            engine->renderCurrentFrame(false, e.flag);
+            break;
+        case RenderRequestEvent::eTypeRenderFrameRange:
+            engine->renderFrameRange(false, false, e.firstFrame, e.lastFrame, e.frameStep, views, e.forward ? eRenderDirectionForward : eRenderDirectionBackward);
+            break;
+        case RenderRequestEvent::eTypeRenderFromCurrentFrame:
+            engine->renderFromCurrentFrame(false, views, e.forward ? eRenderDirectionForward : eRenderDirectionBackward);
+            break;
+        case RenderRequestEvent::eTypeAbort:
+            if (e.flag) {
+                engine->abortRenderingAutoRestart();
+            } else {
+                engine->abortRenderingNoRestart();
+            }
+            break;
+        case RenderRequestEvent::eTypeKnobChanged:
+            break;
+        }
+
+        if (e.type != RenderRequestEvent::eTypeAbort) {
+            PendingRender p;
+            p.engine = engine;
+            p.resultIndex = results->size() - 1;
+            p.startTime = getSeconds(clock);
+            // Let the engine pick up the request before checking whether it is working
+            QCoreApplication::processEvents();
+            pending.push_back(p);
+        }
+    }
+
+    double lastEventTime = getSeconds(clock);
+    while ( !pending.empty() && (getSeconds(clock) - lastEventTime < NATRON_RENDER_REQUEST_REPLAY_TIMEOUT_SECONDS) ) {
+        processEventsFor(1);
+        updatePendingRenders(clock, &pending, results);
+    }
+} // RenderRequestRecorder::replay
+
+NATRON_NAMESPACE_EXIT
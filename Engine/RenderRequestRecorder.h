@@ -0,0 +1,153 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_RENDERREQUESTRECORDER_H
+#define NATRON_ENGINE_RENDERREQUESTRECORDER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A request made to the render engines, or a change made by the user to a parameter, as recorded by RenderRequestRecorder.
+ **/
+struct RenderRequestEvent
+{
+    enum TypeEnum
+    {
+        eTypeRenderCurrentFrame = 0, // RenderEngine::renderCurrentFrame
+        eTypeRenderFrameRange, // RenderEngine::renderFrameRange
+        eTypeRenderFromCurrentFrame, // RenderEngine::renderFromCurrentFrame (playback)
+        eTypeAbort, // RenderEngine::abortRenderingNoRestart and abortRenderingAutoRestart
+        eTypeKnobChanged // a parameter edited by the user
+    };
+
+    TypeEnum type;
+    U64 timestamp; // microseconds since the recording started
+    std::string node; // fully qualified name of the output node, or of the node holding the parameter
+    std::string knob; // eTypeKnobChanged: name of the parameter
+    int dimension; // eTypeKnobChanged
+    double time; // the timeline frame for renders, the time of the change for eTypeKnobChanged
+    bool animated; // eTypeKnobChanged: whether the change set a keyframe
+    std::string value; // eTypeKnobChanged: the new value
+    int firstFrame, lastFrame, frameStep; // eTypeRenderFrameRange
+    bool forward; // eTypeRenderFrameRange and eTypeRenderFromCurrentFrame
+    bool flag; // eTypeRenderCurrentFrame: canAbort, eTypeAbort: whether the playback may restart
+    std::vector<int> views; // eTypeRenderFrameRange and eTypeRenderFromCurrentFrame
+
+    RenderRequestEvent()
+        : type(eTypeRenderCurrentFrame)
+        , timestamp(0)
+        , node()
+        , knob()
+        , dimension(0)
+        , time(0.)
+        , animated(false)
+        , value()
+        , firstFrame(0)
+        , lastFrame(0)
+        , frameStep(1)
+        , forward(true)
+        , flag(false)
+        , views()
+    {
+    }
+};
+
+struct RenderRequestReplayResult
+{
+    RenderRequestEvent event;
+
+    // For renders: seconds between the request and the moment its render engine stopped working, measured while
+    // replaying the next events. -1 for other events, or if the node could not be found.
+    double latency;
+};
+
+/**
+ * @brief Records the requests made to the render engines (current frame renders, frame range renders, aborts) and
+ * the parameter changes made by the user, with their timestamps, so that a performance problem that depends on an
+ * interactive sequence can be replayed offline (see replay(), or NatronBenchmarks --replay-render-requests).
+ * Recording is disabled by default. It is enabled at startup if the environment variable NATRON_RENDER_REQUEST_LOG_FILE
+ * is set: the recording restarts every time a project is loaded, and the log is written to that file on exit, along
+ * with a copy of the project as it was loaded. A recording made after nodes were created or connected interactively
+ * cannot be replayed faithfully: save and load the project first.
+ * All functions are MT-safe.
+ **/
+class RenderRequestRecorder
+{
+public:
+
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled();
+
+    /**
+     * @brief Restarts the recording from the given project file, which is copied so that later saves do not affect the log.
+     **/
+    static void setProjectFile(const std::string& filePath);
+
+    static void recordRenderCurrentFrame(const OutputEffectInstance* output, double time, bool canAbort);
+
+    static void recordRenderFrameRange(const OutputEffectInstance* output, int firstFrame, int lastFrame, int frameStep,
+                                       const std::vector<ViewIdx>& views, bool forward);
+
+    static void recordRenderFromCurrentFrame(const OutputEffectInstance* output, double time, const std::vector<ViewIdx>& views, bool forward);
+
+    static void recordAbort(const OutputEffectInstance* output, bool autoRestart);
+
+    /**
+     * @brief Records the value of the knob at the given time, if it belongs to a node.
+     **/
+    static void recordKnobChanged(KnobI* knob, int dimension, double time);
+
+    /**
+     * @brief Writes the events recorded so far to the given file and the project next to it, with the .ntp extension.
+     * Returns false if the files could not be written.
+     **/
+    static bool write(const std::string& filePath);
+
+    /**
+     * @brief Reads a log written by write(). Returns false if the file could not be read or is not a log.
+     **/
+    static bool read(const std::string& filePath, std::string* projectFilePath, std::vector<RenderRequestEvent>* events);
+
+    /**
+     * @brief Applies the events to the given application, which must have loaded the project of the log, each one at
+     * its recorded time relative to the start of the replay. The Qt events are processed while waiting so that the
+     * render engines work as in the application. Must be called on the main thread.
+     **/
+    static void replay(const AppInstancePtr& app, const std::vector<RenderRequestEvent>& events, std::vector<RenderRequestReplayResult>* results);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_RENDERREQUESTRECORDER_H
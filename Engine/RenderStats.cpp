@@ -25,8 +25,10 @@
 
 #include "RenderStats.h"
 
+#include <algorithm> // min, max
 #include <bitset>
 #include <cassert>
+#include <sstream>
 #include <stdexcept>
 
 #include <QtCore/QMutex>
@@ -36,6 +38,15 @@
 #include "Engine/RectI.h"
 #include "Engine/RectD.h"
 
+// A thread count is measured on that many multi-thread suite calls before ThreadScalingHistory relies on it
+#define NATRON_THREAD_SCALING_MIN_CALLS 8
+
+// Beyond that many calls, the older ones weigh less in the average time per pixel so that it follows the changes of the graphs rendered
+#define NATRON_THREAD_SCALING_MAX_WEIGHT 64
+
+// A thread count is as fast as the fastest one if its time per pixel is at most that much higher
+#define NATRON_THREAD_SCALING_TOLERANCE 0.1
+
 NATRON_NAMESPACE_ENTER
 
 struct NodeRenderStatsPrivate
@@ -66,6 +77,11 @@ struct NodeRenderStatsPrivate
     int nbCacheHit;
     int nbCacheHitButDownscaledImages;
 
+    //Multi-thread suite infos
+    int nbMultiThreadCalls;
+    U64 nbThreadsUsedTotal;
+    double timeSpentMultiThreading;
+
     //Is tile support enabled for this render
     bool tileSupportEnabled;
 
@@ -78,6 +94,24 @@ struct NodeRenderStatsPrivate
     //Premultiplication of the output imge
     ImagePremultiplicationEnum outputPremult;
 
+    //Thread-safety of the render action
+    RenderSafetyEnum renderSafety;
+
+    //First render start and last render end, in seconds since the frame render started. Set if hasRenderTimeInterval
+    bool hasRenderTimeInterval;
+    double renderStartTime;
+    double renderEndTime;
+
+    //The nodes requested by this node
+    std::list<NodeWPtr> inputs;
+
+    //Images allocated by the renders
+    std::size_t cachedImagesBytes;
+    std::size_t temporaryImagesBytes;
+
+    //Highest OpenFX memory suite usage seen while rendering
+    std::size_t pluginMemoryHighWaterMark;
+
     NodeRenderStatsPrivate()
         : totalTimeSpentRendering(0)
         , rod()
@@ -89,10 +123,21 @@ struct NodeRenderStatsPrivate
         , nbCacheMisses(0)
         , nbCacheHit(0)
         , nbCacheHitButDownscaledImages(0)
+        , nbMultiThreadCalls(0)
+        , nbThreadsUsedTotal(0)
+        , timeSpentMultiThreading(0)
         , tileSupportEnabled(false)
         , renderScaleSupportEnabled(false)
         , channelsEnabled()
         , outputPremult(eImagePremultiplicationOpaque)
+        , renderSafety(eRenderSafetyFullySafe)
+        , hasRenderTimeInterval(false)
+        , renderStartTime(0)
+        , renderEndTime(0)
+        , inputs()
+        , cachedImagesBytes(0)
+        , temporaryImagesBytes(0)
+        , pluginMemoryHighWaterMark(0)
     {
         for (int i = 0; i < 4; ++i) {
             channelsEnabled[i] = false;
@@ -128,12 +173,23 @@ NodeRenderStats::operator=(const NodeRenderStats& other)
     _imp->nbCacheMisses = other._imp->nbCacheMisses;
     _imp->nbCacheHit = other._imp->nbCacheHit;
     _imp->nbCacheHitButDownscaledImages = other._imp->nbCacheHitButDownscaledImages;
+    _imp->nbMultiThreadCalls = other._imp->nbMultiThreadCalls;
+    _imp->nbThreadsUsedTotal = other._imp->nbThreadsUsedTotal;
+    _imp->timeSpentMultiThreading = other._imp->timeSpentMultiThreading;
     _imp->tileSupportEnabled = other._imp->tileSupportEnabled;
     _imp->renderScaleSupportEnabled = other._imp->renderScaleSupportEnabled;
     for (int i = 0; i < 4; ++i) {
         _imp->channelsEnabled[i] = other._imp->channelsEnabled[i];
     }
     _imp->outputPremult = other._imp->outputPremult;
+    _imp->renderSafety = other._imp->renderSafety;
+    _imp->hasRenderTimeInterval = other._imp->hasRenderTimeInterval;
+    _imp->renderStartTime = other._imp->renderStartTime;
+    _imp->renderEndTime = other._imp->renderEndTime;
+    _imp->inputs = other._imp->inputs;
+    _imp->cachedImagesBytes = other._imp->cachedImagesBytes;
+    _imp->temporaryImagesBytes = other._imp->temporaryImagesBytes;
+    _imp->pluginMemoryHighWaterMark = other._imp->pluginMemoryHighWaterMark;
 }
 
 void
@@ -254,6 +310,25 @@ NodeRenderStats::getCacheAccessInfos(int* nbCacheMisses,
     *nbCacheHitButDownscaledImages = _imp->nbCacheHitButDownscaledImages;
 }
 
+void
+NodeRenderStats::addMultiThreadInfo(unsigned int nThreadsUsed,
+                                    double timeSpent)
+{
+    ++_imp->nbMultiThreadCalls;
+    _imp->nbThreadsUsedTotal += nThreadsUsed;
+    _imp->timeSpentMultiThreading += timeSpent;
+}
+
+void
+NodeRenderStats::getMultiThreadInfos(int* nbMultiThreadCalls,
+                                     double* averageThreadsUsed,
+                                     double* timeSpentMultiThreading) const
+{
+    *nbMultiThreadCalls = _imp->nbMultiThreadCalls;
+    *averageThreadsUsed = _imp->nbMultiThreadCalls > 0 ? (double)_imp->nbThreadsUsedTotal / _imp->nbMultiThreadCalls : 0.;
+    *timeSpentMultiThreading = _imp->timeSpentMultiThreading;
+}
+
 void
 NodeRenderStats::setTilesSupported(bool tilesSupported)
 {
@@ -302,6 +377,121 @@ NodeRenderStats::getOutputPremult() const
     return _imp->outputPremult;
 }
 
+void
+NodeRenderStats::setRenderThreadSafety(RenderSafetyEnum safety)
+{
+    _imp->renderSafety = safety;
+}
+
+RenderSafetyEnum
+NodeRenderStats::getRenderThreadSafety() const
+{
+    return _imp->renderSafety;
+}
+
+void
+NodeRenderStats::addRenderTimeInterval(double start,
+                                       double end)
+{
+    if (!_imp->hasRenderTimeInterval) {
+        _imp->hasRenderTimeInterval = true;
+        _imp->renderStartTime = start;
+        _imp->renderEndTime = end;
+    } else {
+        _imp->renderStartTime = std::min(_imp->renderStartTime, start);
+        _imp->renderEndTime = std::max(_imp->renderEndTime, end);
+    }
+}
+
+bool
+NodeRenderStats::getRenderTimeInterval(double* start,
+                                       double* end) const
+{
+    *start = _imp->renderStartTime;
+    *end = _imp->renderEndTime;
+
+    return _imp->hasRenderTimeInterval;
+}
+
+void
+NodeRenderStats::addInputNode(const NodePtr& input)
+{
+    for (std::list<NodeWPtr>::const_iterator it = _imp->inputs.begin(); it != _imp->inputs.end(); ++it) {
+        if (it->lock() == input) {
+            return;
+        }
+    }
+    _imp->inputs.push_back(input);
+}
+
+std::list<NodePtr>
+NodeRenderStats::getInputNodes() const
+{
+    std::list<NodePtr> ret;
+
+    for (std::list<NodeWPtr>::const_iterator it = _imp->inputs.begin(); it != _imp->inputs.end(); ++it) {
+        NodePtr n = it->lock();
+        if (n) {
+            ret.push_back(n);
+        }
+    }
+
+    return ret;
+}
+
+bool
+NodeRenderStats::isSerialBottleneck(std::string* reasons) const
+{
+    std::list<std::string> causes;
+
+    if (_imp->renderSafety == eRenderSafetyUnsafe) {
+        causes.push_back("render is not thread-safe");
+    }
+    if (!_imp->tileSupportEnabled) {
+        causes.push_back("no tiles support");
+    }
+    if (!_imp->renderScaleSupportEnabled) {
+        causes.push_back("no render scale support");
+    }
+    reasons->clear();
+    for (std::list<std::string>::const_iterator it = causes.begin(); it != causes.end(); ++it) {
+        if ( !reasons->empty() ) {
+            reasons->append(", ");
+        }
+        reasons->append(*it);
+    }
+
+    return !causes.empty();
+}
+
+void
+NodeRenderStats::addImagesMemoryAllocated(std::size_t cachedBytes,
+                                          std::size_t temporaryBytes)
+{
+    _imp->cachedImagesBytes += cachedBytes;
+    _imp->temporaryImagesBytes += temporaryBytes;
+}
+
+void
+NodeRenderStats::getImagesMemoryAllocated(std::size_t* cachedBytes,
+                                          std::size_t* temporaryBytes) const
+{
+    *cachedBytes = _imp->cachedImagesBytes;
+    *temporaryBytes = _imp->temporaryImagesBytes;
+}
+
+void
+NodeRenderStats::notifyPluginMemoryUsed(std::size_t bytes)
+{
+    _imp->pluginMemoryHighWaterMark = std::max(_imp->pluginMemoryHighWaterMark, bytes);
+}
+
+std::size_t
+NodeRenderStats::getPluginMemoryHighWaterMark() const
+{
+    return _imp->pluginMemoryHighWaterMark;
+}
+
 struct RenderStatsPrivate
 {
     mutable QMutex lock;
@@ -387,7 +577,8 @@ RenderStats::setGlobalRenderInfosForNode(const NodePtr& node,
                                          std::bitset<4> channelsRendered,
                                          bool tilesSupported,
                                          bool renderScaleSupported,
-                                         unsigned int mipmapLevel)
+                                         unsigned int mipmapLevel,
+                                         RenderSafetyEnum safety)
 {
     QMutexLocker k(&_imp->lock);
 
@@ -400,6 +591,32 @@ RenderStats::setGlobalRenderInfosForNode(const NodePtr& node,
     stats.addMipMapLevelRendered(mipmapLevel);
     stats.setChannelsRendered(channelsRendered);
     stats.setRoD(rod);
+    stats.setRenderThreadSafety(safety);
+}
+
+void
+RenderStats::addInputDependencyForNode(const NodePtr& node,
+                                       const NodePtr& input)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addInputNode(input);
+}
+
+void
+RenderStats::addMemoryInfosForNode(const NodePtr& node,
+                                   std::size_t cachedImagesBytes,
+                                   std::size_t temporaryImagesBytes)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addImagesMemoryAllocated(cachedImagesBytes, temporaryImagesBytes);
 }
 
 void
@@ -415,6 +632,19 @@ RenderStats::addCacheInfosForNode(const NodePtr& node,
     stats.addCacheAccessInfo(isCacheMiss, hasDownscaled);
 }
 
+void
+RenderStats::addMultiThreadInfosForNode(const NodePtr& node,
+                                        unsigned int nThreadsUsed,
+                                        double timeSpent)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addMultiThreadInfo(nThreadsUsed, timeSpent);
+}
+
 void
 RenderStats::addRenderInfosForNode(const NodePtr& node,
                                    const NodePtr& identity,
@@ -434,6 +664,11 @@ RenderStats::addRenderInfosForNode(const NodePtr& node,
     }
     stats.addTimeSpentRendering(timeSpent);
     stats.addPlaneRendered(plane);
+    stats.notifyPluginMemoryUsed( node->getPluginMemoryUsed() );
+
+    // The render just completed: it started timeSpent seconds ago
+    double endTime = _imp->totalTimeSpentForFrameTimer.getTimeSinceCreation();
+    stats.addRenderTimeInterval(std::max(0., endTime - timeSpent), endTime);
 }
 
 std::map<NodePtr, NodeRenderStats >
@@ -454,4 +689,160 @@ RenderStats::getStats(double *totalTimeSpent) const
     return ret;
 }
 
+void
+RenderStats::computeCriticalPath(const std::map<NodePtr, NodeRenderStats >& stats,
+                                 std::list<NodePtr>* path)
+{
+    path->clear();
+
+    // The path ends with the node that finished last
+    NodePtr current;
+    double currentEnd = 0.;
+    for (std::map<NodePtr, NodeRenderStats >::const_iterator it = stats.begin(); it != stats.end(); ++it) {
+        double start, end;
+        if ( it->second.getRenderTimeInterval(&start, &end) && (!current || end > currentEnd) ) {
+            current = it->first;
+            currentEnd = end;
+        }
+    }
+
+    std::set<NodePtr> visited;
+    while ( current && visited.insert(current).second ) {
+        path->push_front(current);
+
+        std::map<NodePtr, NodeRenderStats >::const_iterator found = stats.find(current);
+        assert( found != stats.end() );
+        std::list<NodePtr> inputs = found->second.getInputNodes();
+
+        NodePtr latestInput;
+        double latestInputEnd = 0.;
+        for (std::list<NodePtr>::const_iterator it = inputs.begin(); it != inputs.end(); ++it) {
+            std::map<NodePtr, NodeRenderStats >::const_iterator foundInput = stats.find(*it);
+            double start, end;
+            if ( ( foundInput != stats.end() ) && foundInput->second.getRenderTimeInterval(&start, &end) && (!latestInput || end > latestInputEnd) ) {
+                latestInput = *it;
+                latestInputEnd = end;
+            }
+        }
+        current = latestInput;
+    }
+} // RenderStats::computeCriticalPath
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+unsigned int
+floorPowerOfTwo(unsigned int n)
+{
+    unsigned int p = 1;
+
+    while (p <= n / 2) {
+        p *= 2;
+    }
+
+    return p;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+ThreadScalingHistory::ThreadScalingHistory()
+    : _samples()
+{
+}
+
+void
+ThreadScalingHistory::addCall(unsigned int nThreadsUsed,
+                              double timeSpent,
+                              U64 nPixels)
+{
+    if ( (nThreadsUsed == 0) || (nPixels == 0) || (timeSpent <= 0.) ) {
+        return;
+    }
+
+    unsigned int nThreads = floorPowerOfTwo(nThreadsUsed);
+    std::map<unsigned int, Sample>::iterator found = _samples.find(nThreads);
+    if ( found == _samples.end() ) {
+        Sample sample;
+        sample.nCalls = 0;
+        sample.timePerPixel = 0.;
+        found = _samples.insert( std::make_pair(nThreads, sample) ).first;
+    }
+
+    double weight = (double)std::min( found->second.nCalls, (U64)NATRON_THREAD_SCALING_MAX_WEIGHT );
+    found->second.timePerPixel = (found->second.timePerPixel * weight + timeSpent / nPixels) / (weight + 1.);
+    ++found->second.nCalls;
+}
+
+unsigned int
+ThreadScalingHistory::getBestThreadCount(unsigned int maxThreads) const
+{
+    if (maxThreads <= 1) {
+        return maxThreads;
+    }
+
+    unsigned int largest = floorPowerOfTwo(maxThreads);
+    U64 nCandidates = 0;
+    for (unsigned int n = 1; n <= largest; n *= 2) {
+        ++nCandidates;
+    }
+    U64 nCalls = 0;
+    for (std::map<unsigned int, Sample>::const_iterator it = _samples.begin(); it != _samples.end() && it->first <= largest; ++it) {
+        nCalls += it->second.nCalls;
+    }
+
+    // Try the thread counts that were not measured enough. The plug-in may never use some of them, e.g: if it asks
+    // for fewer threads, so stop once there were as many calls as needed to measure all of them.
+    if (nCalls < nCandidates * NATRON_THREAD_SCALING_MIN_CALLS) {
+        for (unsigned int n = 1; n <= largest; n *= 2) {
+            std::map<unsigned int, Sample>::const_iterator found = _samples.find(n);
+            if ( ( found == _samples.end() ) || (found->second.nCalls < NATRON_THREAD_SCALING_MIN_CALLS) ) {
+                return n == largest ? maxThreads : n;
+            }
+        }
+    }
+
+    double fastest = -1.;
+    for (std::map<unsigned int, Sample>::const_iterator it = _samples.begin(); it != _samples.end() && it->first <= largest; ++it) {
+        if ( (it->second.nCalls >= NATRON_THREAD_SCALING_MIN_CALLS) && ( (fastest < 0.) || (it->second.timePerPixel < fastest) ) ) {
+            fastest = it->second.timePerPixel;
+        }
+    }
+    if (fastest < 0.) {
+        return maxThreads;
+    }
+    for (std::map<unsigned int, Sample>::const_iterator it = _samples.begin(); it != _samples.end() && it->first <= largest; ++it) {
+        if ( (it->second.nCalls >= NATRON_THREAD_SCALING_MIN_CALLS) && (it->second.timePerPixel <= fastest * (1. + NATRON_THREAD_SCALING_TOLERANCE) ) ) {
+            return it->first == largest ? maxThreads : it->first;
+        }
+    }
+
+    return maxThreads;
+} // ThreadScalingHistory::getBestThreadCount
+
+std::string
+ThreadScalingHistory::toString() const
+{
+    std::stringstream ss;
+
+    for (std::map<unsigned int, Sample>::const_iterator it = _samples.begin(); it != _samples.end(); ++it) {
+        ss << it->first << ' ' << it->second.nCalls << ' ' << it->second.timePerPixel << ' ';
+    }
+
+    return ss.str();
+}
+
+void
+ThreadScalingHistory::fromString(const std::string& str)
+{
+    _samples.clear();
+
+    std::stringstream ss(str);
+    unsigned int nThreads;
+    Sample sample;
+    while (ss >> nThreads >> sample.nCalls >> sample.timePerPixel) {
+        if ( (nThreads > 0) && (sample.timePerPixel > 0.) ) {
+            _samples[floorPowerOfTwo(nThreads)] = sample;
+        }
+    }
+}
+
 NATRON_NAMESPACE_EXIT
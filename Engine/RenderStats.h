@@ -88,6 +88,9 @@ public:
     void addCacheAccessInfo(bool isCacheMiss, bool hasDownscaled);
     void getCacheAccessInfos(int* nbCacheMisses, int* nbCacheHits, int* nbCacheHitButDownscaledImages) const;
 
+    void addMultiThreadInfo(unsigned int nThreadsUsed, double timeSpent);
+    void getMultiThreadInfos(int* nbMultiThreadCalls, double* averageThreadsUsed, double* timeSpentMultiThreading) const;
+
     void setTilesSupported(bool tilesSupported);
     bool isTilesSupportEnabled() const;
 
@@ -100,6 +103,45 @@ public:
     void setOutputPremult(ImagePremultiplicationEnum premult);
     ImagePremultiplicationEnum getOutputPremult() const;
 
+    void setRenderThreadSafety(RenderSafetyEnum safety);
+    RenderSafetyEnum getRenderThreadSafety() const;
+
+    /**
+     * @brief Extends the time interval during which the node rendered to include [start, end]. Times are in seconds
+     * since the frame render started.
+     **/
+    void addRenderTimeInterval(double start, double end);
+
+    /**
+     * @brief Returns false if the node did not render anything for this frame.
+     **/
+    bool getRenderTimeInterval(double* start, double* end) const;
+
+    /**
+     * @brief The nodes whose images were requested by this node to render
+     **/
+    void addInputNode(const NodePtr& input);
+    std::list<NodePtr> getInputNodes() const;
+
+    /**
+     * @brief Returns true if the node cannot exploit the threads available to render a frame: its render action
+     * is not thread-safe, or it does not support tiles or render scale. Reasons are then set to a readable explanation.
+     **/
+    bool isSerialBottleneck(std::string* reasons) const;
+
+    /**
+     * @brief Accounts images allocated by the renders of the node: cachedBytes went to the cache,
+     * temporaryBytes are freed once the render is done (e.g: downscaled images, images not cached).
+     **/
+    void addImagesMemoryAllocated(std::size_t cachedBytes, std::size_t temporaryBytes);
+    void getImagesMemoryAllocated(std::size_t* cachedBytes, std::size_t* temporaryBytes) const;
+
+    /**
+     * @brief The highest memory held by the plug-in through the OpenFX memory suite while rendering the frame
+     **/
+    void notifyPluginMemoryUsed(std::size_t bytes);
+    std::size_t getPluginMemoryHighWaterMark() const;
+
 private:
 
     boost::scoped_ptr<NodeRenderStatsPrivate> _imp;
@@ -131,12 +173,37 @@ public:
                                      std::bitset<4> channelsRendered,
                                      bool tilesSupported,
                                      bool renderScaleSupported,
-                                     unsigned int mipmapLevel);
+                                     unsigned int mipmapLevel,
+                                     RenderSafetyEnum safety);
+
+    /**
+     * @brief Records that node requested the image of input to render: these are the edges of the graph of the frame.
+     **/
+    void addInputDependencyForNode(const NodePtr& node,
+                                   const NodePtr& input);
+
+    /**
+     * @brief Records the images allocated by a render of the node.
+     **/
+    void addMemoryInfosForNode(const NodePtr& node,
+                               std::size_t cachedImagesBytes,
+                               std::size_t temporaryImagesBytes);
 
     void addCacheInfosForNode(const NodePtr& node,
                               bool isCacheMiss,
                               bool hasDownscaled);
 
+    /**
+     * @brief Records a call to the OpenFX multi-thread suite made by the node: how many threads ran its
+     * function at the same time and the wall time of the call.
+     **/
+    void addMultiThreadInfosForNode(const NodePtr& node,
+                                    unsigned int nThreadsUsed,
+                                    double timeSpent);
+
+    /**
+     * @brief Records a render of the node that just completed. The memory its plug-in holds is also sampled.
+     **/
     void addRenderInfosForNode(const NodePtr& node,
                                const NodePtr& identity,
                                const std::string& plane,
@@ -145,11 +212,58 @@ public:
 
     std::map<NodePtr, NodeRenderStats > getStats(double *totalTimeSpent) const;
 
+    /**
+     * @brief Computes the critical path of a frame: the chain of nodes, from a source to the output, which limited
+     * the wall time of the frame. Starting from the node that finished last, the path goes each time to the
+     * input that finished last, since the node could not complete before it.
+     * Nodes for which there is no render time interval (they rendered nothing) are ignored.
+     * @param path [out] The nodes of the path, from the source to the output
+     **/
+    static void computeCriticalPath(const std::map<NodePtr, NodeRenderStats >& stats,
+                                    std::list<NodePtr>* path);
+
 private:
 
     boost::scoped_ptr<RenderStatsPrivate> _imp;
 };
 
+/**
+ * @brief How the OpenFX multi-thread suite calls of a plug-in scale with the number of threads: for each thread count,
+ * rounded down to a power of 2, the number of calls and their average wall time per pixel of the render window.
+ * It is used to choose how many threads a call of the plug-in should use at most. Not MT-safe.
+ **/
+class ThreadScalingHistory
+{
+public:
+
+    ThreadScalingHistory();
+
+    void addCall(unsigned int nThreadsUsed, double timeSpent, U64 nPixels);
+
+    /**
+     * @brief Returns how many threads, out of maxThreads, the next call should use at most: first each power of 2
+     * is tried in turn until it has been measured enough, then the smallest thread count whose time per pixel is close
+     * to the fastest one is returned, so that the threads which would not speed up the plug-in are left to the other renders.
+     **/
+    unsigned int getBestThreadCount(unsigned int maxThreads) const;
+
+    /**
+     * @brief Serialization to the settings
+     **/
+    std::string toString() const;
+    void fromString(const std::string& str);
+
+private:
+
+    struct Sample
+    {
+        U64 nCalls;
+        double timePerPixel;
+    };
+
+    std::map<unsigned int, Sample> _samples;
+};
+
 NATRON_NAMESPACE_EXIT
 
 
@@ -0,0 +1,250 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderTrace.h"
+
+#include <cstdio> // snprintf
+#include <vector>
+
+#include <boost/atomic.hpp>
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#include "Global/FStreamsSupport.h"
+
+#include "Engine/EffectInstance.h"
+#include "Engine/Node.h"
+
+// Events are stored in this many lists, picked from the thread, so that the render threads do not contend on a single lock
+#define NATRON_RENDER_TRACE_SHARDS_COUNT 16
+
+// Beyond this many events the recording stops, so that a forgotten trace does not eat all the memory
+#define NATRON_RENDER_TRACE_MAX_EVENTS_PER_SHARD 500000
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct TraceEvent
+{
+    const char* category;
+    const char* name;
+    std::string detail;
+    U64 threadId;
+    U64 begin;
+    U64 duration;
+};
+
+struct TraceShard
+{
+    QMutex mutex;
+    std::vector<TraceEvent> events;
+};
+
+struct TraceRecorder
+{
+    boost::atomic<bool> enabled;
+    QElapsedTimer clock; // only read after construction: MT-safe
+    TraceShard shards[NATRON_RENDER_TRACE_SHARDS_COUNT];
+
+    TraceRecorder()
+        : enabled(false)
+        , clock()
+    {
+        clock.start();
+    }
+};
+
+TraceRecorder&
+getRecorder()
+{
+    static TraceRecorder recorder;
+
+    return recorder;
+}
+
+U64
+getCurrentThreadId()
+{
+    return (U64)(quintptr)QThread::currentThreadId();
+}
+
+void
+appendJsonString(const std::string& str,
+                 std::string* out)
+{
+    out->push_back('"');
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        char c = str[i];
+        switch (c) {
+        case '"':
+            out->append("\\\"");
+            break;
+        case '\\':
+            out->append("\\\\");
+            break;
+        case '\n':
+            out->append("\\n");
+            break;
+        case '\t':
+            out->append("\\t");
+            break;
+        default:
+            if ( (unsigned char)c < 0x20 ) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", (unsigned int)(unsigned char)c);
+                out->append(buf);
+            } else {
+                out->push_back(c);
+            }
+            break;
+        }
+    }
+    out->push_back('"');
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+RenderTrace::setEnabled(bool enabled)
+{
+    TraceRecorder& recorder = getRecorder();
+
+    recorder.enabled.store(enabled);
+}
+
+bool
+RenderTrace::isEnabled()
+{
+    return getRecorder().enabled.load(boost::memory_order_relaxed);
+}
+
+void
+RenderTrace::clear()
+{
+    TraceRecorder& recorder = getRecorder();
+
+    for (int i = 0; i < NATRON_RENDER_TRACE_SHARDS_COUNT; ++i) {
+        QMutexLocker k(&recorder.shards[i].mutex);
+        recorder.shards[i].events.clear();
+    }
+}
+
+U64
+RenderTrace::getTimestamp()
+{
+    return (U64)(getRecorder().clock.nsecsElapsed() / 1000);
+}
+
+void
+RenderTrace::addEvent(const char* category,
+                      const char* name,
+                      const std::string& detail,
+                      U64 beginTimestamp)
+{
+    U64 end = getTimestamp();
+    U64 threadId = getCurrentThreadId();
+    TraceRecorder& recorder = getRecorder();
+    TraceShard& shard = recorder.shards[(threadId >> 4) % NATRON_RENDER_TRACE_SHARDS_COUNT];
+    QMutexLocker k(&shard.mutex);
+
+    if (shard.events.size() >= NATRON_RENDER_TRACE_MAX_EVENTS_PER_SHARD) {
+        return;
+    }
+    TraceEvent e;
+    e.category = category;
+    e.name = name;
+    e.detail = detail;
+    e.threadId = threadId;
+    e.begin = beginTimestamp;
+    e.duration = end > beginTimestamp ? end - beginTimestamp : 0;
+    shard.events.push_back(e);
+}
+
+bool
+RenderTrace::writeChromeTrace(const std::string& filePath)
+{
+    FStreamsSupport::ofstream ofile;
+
+    FStreamsSupport::open(&ofile, filePath);
+    if (!ofile) {
+        return false;
+    }
+
+    TraceRecorder& recorder = getRecorder();
+    ofile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    std::string line;
+    for (int i = 0; i < NATRON_RENDER_TRACE_SHARDS_COUNT; ++i) {
+        QMutexLocker k(&recorder.shards[i].mutex);
+        const std::vector<TraceEvent>& events = recorder.shards[i].events;
+        for (std::size_t j = 0; j < events.size(); ++j) {
+            const TraceEvent& e = events[j];
+            // Complete events ("X") carry both the begin and the duration
+            line.clear();
+            line.append(first ? "\n" : ",\n");
+            line.append("{\"ph\":\"X\",\"pid\":1,\"tid\":");
+            char buf[64];
+            snprintf(buf, sizeof(buf), "%llu,\"ts\":%llu,\"dur\":%llu,\"cat\":", (unsigned long long)e.threadId, (unsigned long long)e.begin, (unsigned long long)e.duration);
+            line.append(buf);
+            appendJsonString(e.category, &line);
+            line.append(",\"name\":");
+            appendJsonString(e.name, &line);
+            if ( !e.detail.empty() ) {
+                line.append(",\"args\":{\"node\":");
+                appendJsonString(e.detail, &line);
+                line.push_back('}');
+            }
+            line.push_back('}');
+            ofile << line;
+            first = false;
+        }
+    }
+    ofile << "\n]}\n";
+
+    return !ofile.fail();
+}
+
+RenderTraceScope::RenderTraceScope(const char* category,
+                                   const char* name,
+                                   const EffectInstance* effect)
+    : _category(category)
+    , _name(name)
+    , _detail()
+    , _enabled( RenderTrace::isEnabled() )
+    , _begin(0)
+{
+    if (_enabled) {
+        NodePtr node = effect ? effect->getNode() : NodePtr();
+        if (node) {
+            _detail = node->getFullyQualifiedName();
+        }
+        _begin = RenderTrace::getTimestamp();
+    }
+}
+
+NATRON_NAMESPACE_EXIT
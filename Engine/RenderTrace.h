@@ -0,0 +1,120 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_RENDERTRACE_H
+#define NATRON_ENGINE_RENDERTRACE_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Records timestamped begin/end events, per thread, of the work done by the renders (renderRoI, plug-in actions,
+ * cache look-ups, expressions, image conversions, OpenGL uploads...) and writes them in the Chrome trace event format,
+ * which chrome://tracing and Perfetto can display as a timeline.
+ * Tracing is disabled by default: a disabled scope only costs an atomic read. It is enabled at startup
+ * if the environment variable NATRON_RENDER_TRACE_FILE is set, the trace is then written to that file on exit.
+ * All functions are MT-safe.
+ **/
+class RenderTrace
+{
+public:
+
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled();
+
+    /**
+     * @brief Removes all the events recorded so far.
+     **/
+    static void clear();
+
+    /**
+     * @brief Writes the events recorded so far to the given file. Returns false if the file could not be written.
+     **/
+    static bool writeChromeTrace(const std::string& filePath);
+
+    /**
+     * @brief Records an event that began at the given time (as returned by getTimestamp()) and ends now on the current thread.
+     * category and name must be string literals: they are not copied.
+     **/
+    static void addEvent(const char* category, const char* name, const std::string& detail, U64 beginTimestamp);
+
+    /**
+     * @brief Returns the time elapsed since the tracing was enabled, in microseconds.
+     **/
+    static U64 getTimestamp();
+};
+
+/**
+ * @brief Records an event on the current thread spanning the lifetime of this object, if tracing is enabled when it is created.
+ * category and name must be string literals: they are not copied.
+ **/
+class RenderTraceScope
+{
+public:
+
+    RenderTraceScope(const char* category,
+                     const char* name)
+        : _category(category)
+        , _name(name)
+        , _detail()
+        , _enabled( RenderTrace::isEnabled() )
+        , _begin(_enabled ? RenderTrace::getTimestamp() : 0)
+    {
+    }
+
+    /**
+     * @param effect The name of its node is displayed with the event. It is only looked up if tracing is enabled.
+     **/
+    RenderTraceScope(const char* category,
+                     const char* name,
+                     const EffectInstance* effect);
+
+    ~RenderTraceScope()
+    {
+        if (_enabled) {
+            RenderTrace::addEvent(_category, _name, _detail, _begin);
+        }
+    }
+
+private:
+
+    const char* _category;
+    const char* _name;
+    std::string _detail;
+    bool _enabled;
+    U64 _begin;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_RENDERTRACE_H
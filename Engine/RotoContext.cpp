@@ -30,6 +30,7 @@
 #include <locale>
 #include <limits>
 #include <cassert>
+#include <cmath> // floor, ceil, pow
 #include <stdexcept>
 #include <cstring> // for std::memcpy, std::memset
 #include <sstream> // stringstream
@@ -44,32 +45,51 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #include <QtCore/QLineF>
 #include <QtCore/QDebug>
+#include <QtCore/QThreadPool>
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 
 //#define ROTO_RENDER_TRIANGLES_ONLY
 
+// Rasterize closed shapes on the CPU from their triangulation, with tiles rendered in parallel, instead of cairo
+#define ROTO_RENDER_TILED_CPU
+
+///Minimum number of pixels of the mask for it to be rasterized in parallel tiles
+#define NATRON_ROTO_RASTER_MIN_PIXELS_PER_THREAD (128 * 128)
+// Minimum number of pixels by which the image of the stroke being painted grows, see RotoStrokeItem::renderSingleStroke
+#define NATRON_ROTO_STROKE_IMAGE_MIN_GROWTH 256
+// Minimum number of shapes for their bounding boxes to be computed in parallel by RotoContext::getItemsRegionOfDefinition
+#define NATRON_ROTO_PARALLEL_BBOX_MIN_ITEMS 32
+// Number of bezier triangulations kept by RotoContextPrivate::computeTriangles
+#define NATRON_ROTO_TRIANGULATION_CACHE_SIZE 64
+
 #include "libtess.h"
 
 #include "Engine/RotoContextPrivate.h"
 
 #include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
 #include "Engine/Bezier.h"
 #include "Engine/BezierCP.h"
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/CoonsRegularization.h"
 #include "Engine/FeatherPoint.h"
 #include "Engine/Format.h"
+#include "Engine/GLShader.h"
+#include "Engine/GPUContextPool.h"
 #include "Engine/Hash64.h"
 #include "Engine/Image.h"
 #include "Engine/ImageParams.h"
 #include "Engine/MemoryInfo.h" // printAsRAM
 #include "Engine/NodeSerialization.h"
 #include "Engine/Interpolation.h"
+#include "Engine/OSGLContext.h"
 #include "Engine/RenderStats.h"
 #include "Engine/RotoContextSerialization.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/RotoLayer.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/Settings.h"
+#include "Engine/ThreadPool.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Transform.h"
 #include "Engine/ViewerInstance.h"
@@ -828,6 +848,48 @@ RotoContext::getGlobalMotionBlurSettings(const double time,
 #endif
 }
 
+namespace {
+
+RectD
+getBezierBoundingBox(const Bezier* bezier,
+                     double time)
+{
+    return bezier->getBoundingBox(time);
+}
+
+/**
+ * @brief Computes the bounding box of each bezier at the given time. Render threads evaluate them in parallel when there
+ * are many shapes. The main thread evaluates them itself since it reads the GUI values of the curves.
+ **/
+void
+getBeziersBoundingBoxes(const std::vector<const Bezier*>& beziers,
+                        double time,
+                        std::vector<RectD>* bboxes)
+{
+    bool runInCurrentThread = beziers.size() < NATRON_ROTO_PARALLEL_BBOX_MIN_ITEMS ||
+                              QThread::currentThread() == qApp->thread() ||
+                              QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
+    if (runInCurrentThread) {
+        bboxes->resize( beziers.size() );
+        for (std::size_t i = 0; i < beziers.size(); ++i) {
+            (*bboxes)[i] = beziers[i]->getBoundingBox(time);
+        }
+
+        return;
+    }
+
+    QFuture<RectD> future = QtConcurrent::mapped( beziers, boost::bind(&getBezierBoundingBox, _1, time) );
+    {
+        // This is a render thread of the pool: let the pool use its slot while the shapes are evaluated
+        ThreadPoolWaitScope waitScope( QThread::currentThread() );
+        future.waitForFinished();
+    }
+    QList<RectD> results = future.results();
+    bboxes->assign( results.begin(), results.end() );
+}
+
+} // anon namespace
+
 void
 RotoContext::getItemsRegionOfDefinition(const std::list<RotoItemPtr>& items,
                                         double time,
@@ -858,22 +920,13 @@ RotoContext::getItemsRegionOfDefinition(const std::list<RotoItemPtr>& items,
     for (double t = startTime; t <= endTime; t += mbFrameStep) {
         bool first = true;
         RectD bbox;
+        std::vector<const Bezier*> beziers;
         for (std::list<RotoItemPtr>::const_iterator it2 = items.begin(); it2 != items.end(); ++it2) {
             Bezier* isBezier = dynamic_cast<Bezier*>( it2->get() );
             RotoStrokeItem* isStroke = dynamic_cast<RotoStrokeItem*>( it2->get() );
             if (isBezier && !isStroke) {
                 if ( isBezier->isActivated(time)  && (isBezier->getControlPointsCount() > 1) ) {
-                    RectD splineRoD = isBezier->getBoundingBox(t);
-                    if ( splineRoD.isNull() ) {
-                        continue;
-                    }
-
-                    if (first) {
-                        first = false;
-                        bbox = splineRoD;
-                    } else {
-                        bbox.merge(splineRoD);
-                    }
+                    beziers.push_back(isBezier);
                 }
             } else if (isStroke) {
                 RectD strokeRod;
@@ -892,6 +945,22 @@ RotoContext::getItemsRegionOfDefinition(const std::list<RotoItemPtr>& items,
                 }
             }
         }
+
+        std::vector<RectD> bezierBboxes;
+        getBeziersBoundingBoxes(beziers, t, &bezierBboxes);
+        for (std::vector<RectD>::const_iterator it2 = bezierBboxes.begin(); it2 != bezierBboxes.end(); ++it2) {
+            if ( it2->isNull() ) {
+                continue;
+            }
+
+            if (first) {
+                first = false;
+                bbox = *it2;
+            } else {
+                bbox.merge(*it2);
+            }
+        }
+
         if (!rodSet) {
             *rod = bbox;
             rodSet = true;
@@ -1936,6 +2005,22 @@ RotoContext::evaluateChange()
     getNode()->getEffectInstance()->incrHashAndEvaluate(true, false);
 }
 
+void
+RotoContext::evaluateChange(double time,
+                            const RectD& region)
+{
+#ifdef NATRON_ROTO_ENABLE_MOTION_BLUR
+    //With the global motion blur, the shapes at other times are rendered too
+    if (getMotionBlurTypeKnob()->getValue() == 1) {
+        evaluateChange();
+
+        return;
+    }
+#endif
+    _imp->incrementRotoAge();
+    getNode()->getEffectInstance()->incrHashInRegionAndEvaluate(time, region);
+}
+
 void
 RotoContext::evaluateChange_noIncrement()
 {
@@ -2609,8 +2694,35 @@ RotoStrokeItem::renderSingleStroke(const RectD& pointsBbox,
             RectI oldBounds = (*image)->getBounds();
             RectD mergeRoD = pointsBbox;
             mergeRoD.merge(otherRoD);
-            source->setRoD(mergeRoD);
-            source->ensureBounds(pixelPointsBbox, true);
+            if ( !oldBounds.contains(pixelPointsBbox) ) {
+                // Each movement of the pen only extends the stroke by a few pixels: grow the image by a fraction of its
+                // size in the directions where the stroke goes so that long strokes are reallocated (and copied) a
+                // logarithmic number of times instead of at every movement. The extra pixels are transparent black.
+                const int padX = std::max(NATRON_ROTO_STROKE_IMAGE_MIN_GROWTH, oldBounds.width() / 2);
+                const int padY = std::max(NATRON_ROTO_STROKE_IMAGE_MIN_GROWTH, oldBounds.height() / 2);
+                RectI grownBounds = oldBounds;
+                grownBounds.merge(pixelPointsBbox);
+                if (pixelPointsBbox.x1 < oldBounds.x1) {
+                    grownBounds.x1 -= padX;
+                }
+                if (pixelPointsBbox.x2 > oldBounds.x2) {
+                    grownBounds.x2 += padX;
+                }
+                if (pixelPointsBbox.y1 < oldBounds.y1) {
+                    grownBounds.y1 -= padY;
+                }
+                if (pixelPointsBbox.y2 > oldBounds.y2) {
+                    grownBounds.y2 += padY;
+                }
+                // The bounds of an image must be within its RoD
+                RectD grownRoD;
+                grownBounds.toCanonical_noClipping(mipmapLevel, par, &grownRoD);
+                mergeRoD.merge(grownRoD);
+                source->setRoD(mergeRoD);
+                source->ensureBounds(grownBounds, true);
+            } else {
+                source->setRoD(mergeRoD);
+            }
         }
         copyFromImage = true;
     }
@@ -2716,7 +2828,8 @@ RotoDrawableItem::renderMaskFromStroke(const ImagePlaneDesc& components,
                                        const ViewIdx view,
                                        const ImageBitDepthEnum depth,
                                        const unsigned int mipmapLevel,
-                                       const RectD& rotoNodeSrcRod)
+                                       const RectD& rotoNodeSrcRod,
+                                       const OSGLContextPtr& glContext)
 {
     NodePtr node = getContext()->getNode();
     ImagePtr image; // = stroke->getStrokeTimePreview();
@@ -2843,7 +2956,7 @@ RotoDrawableItem::renderMaskFromStroke(const ImagePlaneDesc& components,
     image->allocateMemory();
 
 
-    image = renderMaskInternal(pixelRod, components, startTime, endTime, mbFrameStep, time, inverted, depth, mipmapLevel, strokes, image);
+    image = renderMaskInternal(pixelRod, components, startTime, endTime, mbFrameStep, time, inverted, depth, mipmapLevel, strokes, glContext, image);
 
     return image;
 } // RotoDrawableItem::renderMaskFromStroke
@@ -2859,6 +2972,7 @@ RotoDrawableItem::renderMaskInternal(const RectI & roi,
                                      const ImageBitDepthEnum depth,
                                      const unsigned int mipmapLevel,
                                      const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                     const OSGLContextPtr& glContext,
                                      const ImagePtr &image)
 {
     Q_UNUSED(startTime);
@@ -2930,8 +3044,12 @@ RotoDrawableItem::renderMaskInternal(const RectI & roi,
                 dotPatterns[i] = 0;
             }
         }
-    } else {
+    } else if ( !glContext || !RotoContextPrivate::renderBezier_gl(glContext, isBezier, time, startTime, endTime, timeStep, mipmapLevel, roi, imgWrapper.cairoImg) ) {
+#ifdef ROTO_RENDER_TILED_CPU
+        RotoContextPrivate::renderBezier_tiled(isBezier, time, startTime, endTime, timeStep, mipmapLevel, roi, imgWrapper.cairoImg);
+#else
         RotoContextPrivate::renderBezier(imgWrapper.ctx, isBezier, opacity, time, startTime, endTime, timeStep, mipmapLevel);
+#endif
     }
 
     bool useOpacityToConvert = (isBezier != 0);
@@ -3308,6 +3426,441 @@ RotoContextPrivate::renderBezier(cairo_t* cr,
     }
 } // RotoContextPrivate::renderBezier
 
+bool
+RotoContextPrivate::renderBezier_gl(const OSGLContextPtr& glContext,
+                                    const Bezier* bezier,
+                                    double time,
+                                    double startTime, double endTime, double mbFrameStep,
+                                    unsigned int mipmapLevel,
+                                    const RectI& roi,
+                                    cairo_surface_t* dstImg)
+{
+    assert(glContext && dstImg);
+    assert(cairo_image_surface_get_format(dstImg) == CAIRO_FORMAT_A8);
+
+    ///render the bezier only if finished (closed) and activated
+    if ( !bezier->isCurveFinished() || !bezier->isActivated(time) || ( bezier->getControlPointsCount() <= 1 ) ) {
+        // Nothing to draw, the surface is already transparent
+        return true;
+    }
+
+    const int maxTexSize = appPTR->getGPUContextPool()->getCurrentOpenGLRendererMaxTextureSize();
+    if ( roi.isNull() || (roi.width() > maxTexSize) || (roi.height() > maxTexSize) ) {
+        return false;
+    }
+
+    GLint prevFBO = 0, prevTexture = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFBO);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &prevTexture);
+
+    // Rasterize in a temporary 8-bit texture: this is the precision of the A8 cairo surface it is read back into,
+    // which is converted to the Natron image exactly as with the cairo rasterization.
+    GLuint texID = 0, fboID = 0;
+    glGenTextures(1, &texID);
+    glBindTexture(GL_TEXTURE_2D, texID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, roi.width(), roi.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+    glGenFramebuffers(1, &fboID);
+    glBindFramebuffer(GL_FRAMEBUFFER, fboID);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texID, 0 /*LoD*/);
+
+    bool ok = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (ok) {
+        GLProtectAttrib a(GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT | GL_VIEWPORT_BIT | GL_CURRENT_BIT | GL_TRANSFORM_BIT);
+        GLProtectMatrix p(GL_PROJECTION);
+        GLProtectMatrix m(GL_MODELVIEW);
+
+        // The triangles are in pixel coordinates at the mipmap level: map the roi onto the texture.
+        // The bottom row of the texture is roi.y1, which is also the first row of the cairo surface.
+        glViewport( 0, 0, roi.width(), roi.height() );
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glOrtho(roi.x1, roi.x2, roi.y1, roi.y2, -1., 1.);
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_SCISSOR_TEST);
+        glClearColor(0., 0., 0., 0.);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        // Shapes of successive motion-blur steps are composited with OVER, like the cairo mask
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+        GLShaderPtr shader = glContext->getOrCreateRotoShapeShader();
+        assert(shader);
+        shader->bind();
+
+        for (double t = startTime; t <= endTime; t += mbFrameStep) {
+            double fallOff = bezier->getFeatherFallOff(t);
+            double featherDist = bezier->getFeatherDistance(t);
+
+            ///Adjust the feather distance so it takes the mipmap level into account
+            if (mipmapLevel != 0) {
+                featherDist /= (1 << mipmapLevel);
+            }
+
+            std::list<RotoFeatherVertex> featherMesh;
+            std::list<RotoTriangleFans> internalFans;
+            std::list<RotoTriangles> internalTriangles;
+            std::list<RotoTriangleStrips> internalStrips;
+            computeTriangles(bezier, t, mipmapLevel, featherDist, &featherMesh, &internalFans, &internalTriangles, &internalStrips);
+
+            shader->setUniform("fallOff", (float)fallOff);
+
+            // The feather ramp: full opacity on the inner vertices, transparent on the outer ones
+            glBegin(GL_TRIANGLES);
+            for (std::list<RotoFeatherVertex>::const_iterator it = featherMesh.begin(); it != featherMesh.end(); ++it) {
+                glColor4f(1.f, 1.f, 1.f, it->isInner ? 1.f : 0.f);
+                glVertex2d(it->x, it->y);
+            }
+            glEnd();
+
+            // The inside of the shape is fully opaque
+            glColor4f(1.f, 1.f, 1.f, 1.f);
+            for (std::list<RotoTriangles>::const_iterator it = internalTriangles.begin(); it != internalTriangles.end(); ++it) {
+                glBegin(GL_TRIANGLES);
+                for (std::list<Point>::const_iterator it2 = it->vertices.begin(); it2 != it->vertices.end(); ++it2) {
+                    glVertex2d(it2->x, it2->y);
+                }
+                glEnd();
+            }
+            for (std::list<RotoTriangleFans>::const_iterator it = internalFans.begin(); it != internalFans.end(); ++it) {
+                glBegin(GL_TRIANGLE_FAN);
+                for (std::list<Point>::const_iterator it2 = it->vertices.begin(); it2 != it->vertices.end(); ++it2) {
+                    glVertex2d(it2->x, it2->y);
+                }
+                glEnd();
+            }
+            for (std::list<RotoTriangleStrips>::const_iterator it = internalStrips.begin(); it != internalStrips.end(); ++it) {
+                glBegin(GL_TRIANGLE_STRIP);
+                for (std::list<Point>::const_iterator it2 = it->vertices.begin(); it2 != it->vertices.end(); ++it2) {
+                    glVertex2d(it2->x, it2->y);
+                }
+                glEnd();
+            }
+        }
+
+        shader->unbind();
+
+        // Read the alpha back into the cairo surface
+        cairo_surface_flush(dstImg);
+        glPixelStorei( GL_PACK_ROW_LENGTH, cairo_image_surface_get_stride(dstImg) );
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, roi.width(), roi.height(), GL_ALPHA, GL_UNSIGNED_BYTE, cairo_image_surface_get_data(dstImg));
+        glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        ok = glGetError() == GL_NO_ERROR;
+        if (!ok) {
+            // Leave the surface transparent for the cairo fallback
+            std::memset( cairo_image_surface_get_data(dstImg), 0, cairo_image_surface_get_stride(dstImg) * roi.height() );
+        }
+        cairo_surface_mark_dirty(dstImg);
+    }
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0 /*LoD*/);
+    glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+    glDeleteFramebuffers(1, &fboID);
+    glBindTexture(GL_TEXTURE_2D, prevTexture);
+    glDeleteTextures(1, &texID);
+    glCheckError();
+
+    return ok;
+} // RotoContextPrivate::renderBezier_gl
+
+namespace {
+
+struct RotoRasterTriangle
+{
+    double x[3], y[3];
+    float alpha[3]; // before the falloff is applied
+    RectI bbox; // pixels whose center may be covered
+};
+
+struct RotoRasterPass
+{
+    float fallOff;
+    std::vector<RotoRasterTriangle> triangles;
+    RectI bbox; // union of the bboxes of the triangles
+
+    RotoRasterPass()
+        : fallOff(1.f)
+        , triangles()
+        , bbox()
+    {
+    }
+};
+
+void
+appendRasterTriangle(const Point& p0, float a0,
+                     const Point& p1, float a1,
+                     const Point& p2, float a2,
+                     RotoRasterPass* pass)
+{
+    RotoRasterTriangle tri;
+    double area = (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
+    if (area == 0.) {
+        return;
+    }
+    tri.x[0] = p0.x; tri.y[0] = p0.y; tri.alpha[0] = a0;
+    // Make all triangles counter-clockwise so that the edge functions are positive inside
+    if (area > 0.) {
+        tri.x[1] = p1.x; tri.y[1] = p1.y; tri.alpha[1] = a1;
+        tri.x[2] = p2.x; tri.y[2] = p2.y; tri.alpha[2] = a2;
+    } else {
+        tri.x[1] = p2.x; tri.y[1] = p2.y; tri.alpha[1] = a2;
+        tri.x[2] = p1.x; tri.y[2] = p1.y; tri.alpha[2] = a1;
+    }
+    double xmin = std::min( p0.x, std::min(p1.x, p2.x) );
+    double xmax = std::max( p0.x, std::max(p1.x, p2.x) );
+    double ymin = std::min( p0.y, std::min(p1.y, p2.y) );
+    double ymax = std::max( p0.y, std::max(p1.y, p2.y) );
+    // Pixel (x,y) is sampled at its center (x + 0.5, y + 0.5)
+    tri.bbox.x1 = (int)std::floor(xmin - 0.5);
+    tri.bbox.y1 = (int)std::floor(ymin - 0.5);
+    tri.bbox.x2 = (int)std::ceil(xmax - 0.5) + 1;
+    tri.bbox.y2 = (int)std::ceil(ymax - 0.5) + 1;
+    if ( pass->triangles.empty() ) {
+        pass->bbox = tri.bbox;
+    } else {
+        pass->bbox.merge(tri.bbox);
+    }
+    pass->triangles.push_back(tri);
+}
+
+// Top-left rule: a pixel center exactly on an edge shared by 2 triangles belongs to only one of them,
+// so that composing adjacent triangles does not create seams
+inline bool
+isTopLeftEdge(double dx,
+              double dy)
+{
+    return dy > 0. || (dy == 0. && dx < 0.);
+}
+
+void
+rasterizeTriangle(const RotoRasterTriangle& tri,
+                  float fallOff,
+                  const RectI& tile,
+                  float* coverage)
+{
+    RectI rect;
+    if ( !tri.bbox.intersect(tile, &rect) ) {
+        return;
+    }
+
+    // Edge i is opposite to vertex i
+    double ex[3], ey[3];
+    bool topLeft[3];
+    for (int i = 0; i < 3; ++i) {
+        int a = (i + 1) % 3;
+        int b = (i + 2) % 3;
+        ex[i] = tri.x[b] - tri.x[a];
+        ey[i] = tri.y[b] - tri.y[a];
+        topLeft[i] = isTopLeftEdge(ex[i], ey[i]);
+    }
+    const double area = ex[2] * (tri.y[2] - tri.y[0]) - ey[2] * (tri.x[2] - tri.x[0]);
+    assert(area > 0.);
+    const double invArea = 1. / area;
+    const bool constantAlpha = tri.alpha[0] == tri.alpha[1] && tri.alpha[1] == tri.alpha[2];
+    const bool linearFallOff = fallOff == 1.f;
+    const int tileWidth = tile.width();
+
+    for (int y = rect.y1; y < rect.y2; ++y) {
+        const double py = y + 0.5;
+        // Edge functions at the first pixel center of the row, they increase by -ey[i] at each pixel
+        double e[3];
+        for (int i = 0; i < 3; ++i) {
+            int a = (i + 1) % 3;
+            e[i] = ex[i] * (py - tri.y[a]) - ey[i] * (rect.x1 + 0.5 - tri.x[a]);
+        }
+        float* dst = coverage + (y - tile.y1) * tileWidth + (rect.x1 - tile.x1);
+        for (int x = rect.x1; x < rect.x2; ++x, ++dst) {
+            bool inside = true;
+            for (int i = 0; i < 3; ++i) {
+                if ( (e[i] < 0.) || ( (e[i] == 0.) && !topLeft[i] ) ) {
+                    inside = false;
+                    break;
+                }
+            }
+            if (inside) {
+                float alpha;
+                if (constantAlpha) {
+                    alpha = tri.alpha[0];
+                } else {
+                    alpha = (float)( (e[0] * tri.alpha[0] + e[1] * tri.alpha[1] + e[2] * tri.alpha[2]) * invArea );
+                    alpha = std::max( 0.f, std::min(alpha, 1.f) );
+                }
+                if (!linearFallOff) {
+                    alpha = std::pow(alpha, fallOff);
+                }
+                // OVER
+                *dst = alpha + *dst * (1.f - alpha);
+            }
+            for (int i = 0; i < 3; ++i) {
+                e[i] -= ey[i];
+            }
+        }
+    }
+} // rasterizeTriangle
+
+int
+rasterizeRotoTile(const std::vector<RotoRasterPass>& passes,
+                  const RectI& roi,
+                  unsigned char* dstData,
+                  int dstStride,
+                  const RectI& tile)
+{
+    std::vector<float> coverage(tile.area(), 0.f);
+    for (std::vector<RotoRasterPass>::const_iterator it = passes.begin(); it != passes.end(); ++it) {
+        // With motion blur each sample of the shape only covers part of the roi: skip the whole pass when it
+        // does not touch this tile
+        if ( it->triangles.empty() || !it->bbox.intersects(tile) ) {
+            continue;
+        }
+        for (std::vector<RotoRasterTriangle>::const_iterator it2 = it->triangles.begin(); it2 != it->triangles.end(); ++it2) {
+            rasterizeTriangle(*it2, it->fallOff, tile, &coverage[0]);
+        }
+    }
+
+    // Each tile writes its own pixels of the surface
+    const float* src = coverage.empty() ? 0 : &coverage[0];
+    for (int y = tile.y1; y < tile.y2; ++y) {
+        unsigned char* dst = dstData + (y - roi.y1) * dstStride + (tile.x1 - roi.x1);
+        for (int x = tile.x1; x < tile.x2; ++x, ++src, ++dst) {
+            *dst = (unsigned char)(std::min(*src, 1.f) * 255.f + 0.5f);
+        }
+    }
+
+    return 0;
+}
+
+} // anon namespace
+
+void
+RotoContextPrivate::renderBezier_tiled(const Bezier* bezier,
+                                       double time,
+                                       double startTime, double endTime, double mbFrameStep,
+                                       unsigned int mipmapLevel,
+                                       const RectI& roi,
+                                       cairo_surface_t* dstImg)
+{
+    assert(cairo_image_surface_get_format(dstImg) == CAIRO_FORMAT_A8);
+
+    ///render the bezier only if finished (closed) and activated
+    if ( !bezier->isCurveFinished() || !bezier->isActivated(time) || ( bezier->getControlPointsCount() <= 1 ) || roi.isNull() ) {
+        return;
+    }
+
+    // Triangulate all motion-blur steps first, the tiles then only read them
+    std::vector<RotoRasterPass> passes;
+    for (double t = startTime; t <= endTime; t += mbFrameStep) {
+        double featherDist = bezier->getFeatherDistance(t);
+
+        ///Adjust the feather distance so it takes the mipmap level into account
+        if (mipmapLevel != 0) {
+            featherDist /= (1 << mipmapLevel);
+        }
+
+        std::list<RotoFeatherVertex> featherMesh;
+        std::list<RotoTriangleFans> internalFans;
+        std::list<RotoTriangles> internalTriangles;
+        std::list<RotoTriangleStrips> internalStrips;
+        computeTriangles(bezier, t, mipmapLevel, featherDist, &featherMesh, &internalFans, &internalTriangles, &internalStrips);
+
+        passes.push_back( RotoRasterPass() );
+        RotoRasterPass& pass = passes.back();
+        pass.fallOff = (float)bezier->getFeatherFallOff(t);
+
+        // The feather ramp: full opacity on the inner vertices, transparent on the outer ones
+        for (std::list<RotoFeatherVertex>::const_iterator it = featherMesh.begin(); it != featherMesh.end(); ) {
+            Point p[3];
+            float a[3];
+            int i = 0;
+            for (; i < 3 && it != featherMesh.end(); ++i, ++it) {
+                p[i].x = it->x;
+                p[i].y = it->y;
+                a[i] = it->isInner ? 1.f : 0.f;
+            }
+            if (i == 3) {
+                appendRasterTriangle(p[0], a[0], p[1], a[1], p[2], a[2], &pass);
+            }
+        }
+
+        // The inside of the shape is fully opaque
+        for (std::list<RotoTriangles>::const_iterator it = internalTriangles.begin(); it != internalTriangles.end(); ++it) {
+            for (std::list<Point>::const_iterator it2 = it->vertices.begin(); it2 != it->vertices.end(); ) {
+                Point p[3];
+                int i = 0;
+                for (; i < 3 && it2 != it->vertices.end(); ++i, ++it2) {
+                    p[i] = *it2;
+                }
+                if (i == 3) {
+                    appendRasterTriangle(p[0], 1.f, p[1], 1.f, p[2], 1.f, &pass);
+                }
+            }
+        }
+        for (std::list<RotoTriangleFans>::const_iterator it = internalFans.begin(); it != internalFans.end(); ++it) {
+            if (it->vertices.size() < 3) {
+                continue;
+            }
+            std::list<Point>::const_iterator center = it->vertices.begin();
+            std::list<Point>::const_iterator prev = center;
+            ++prev;
+            std::list<Point>::const_iterator cur = prev;
+            for (++cur; cur != it->vertices.end(); ++prev, ++cur) {
+                appendRasterTriangle(*center, 1.f, *prev, 1.f, *cur, 1.f, &pass);
+            }
+        }
+        for (std::list<RotoTriangleStrips>::const_iterator it = internalStrips.begin(); it != internalStrips.end(); ++it) {
+            if (it->vertices.size() < 3) {
+                continue;
+            }
+            std::list<Point>::const_iterator prevPrev = it->vertices.begin();
+            std::list<Point>::const_iterator prev = prevPrev;
+            ++prev;
+            std::list<Point>::const_iterator cur = prev;
+            for (++cur; cur != it->vertices.end(); ++prevPrev, ++prev, ++cur) {
+                appendRasterTriangle(*prevPrev, 1.f, *prev, 1.f, *cur, 1.f, &pass);
+            }
+        }
+
+        // Motion-blur samples outside of the roi do not contribute
+        if ( pass.triangles.empty() || !pass.bbox.intersects(roi) ) {
+            passes.pop_back();
+        }
+    }
+
+    cairo_surface_flush(dstImg);
+    unsigned char* data = cairo_image_surface_get_data(dstImg);
+    const int stride = cairo_image_surface_get_stride(dstImg);
+
+    int nThreads = std::min( appPTR->getMaxThreadCount(), (int)( roi.area() / NATRON_ROTO_RASTER_MIN_PIXELS_PER_THREAD ) );
+    bool runInCurrentThread = nThreads <= 1 ||
+                              QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
+    if (runInCurrentThread) {
+        rasterizeRotoTile(passes, roi, data, stride, roi);
+    } else {
+        std::vector<RectI> tiles = roi.splitIntoSmallerRects(nThreads);
+        QFuture<int> future = QtConcurrent::mapped( tiles,
+                                                    boost::bind(&rasterizeRotoTile,
+                                                                boost::cref(passes),
+                                                                boost::cref(roi),
+                                                                data,
+                                                                stride,
+                                                                _1) );
+        {
+            // This is a render thread of the pool: let the pool use its slot while the tiles are rasterized
+            ThreadPoolWaitScope waitScope( QThread::currentThread() );
+            future.waitForFinished();
+        }
+    }
+
+    cairo_surface_mark_dirty(dstImg);
+} // RotoContextPrivate::renderBezier_tiled
+
 void
 RotoContextPrivate::renderFeather(const Bezier* bezier,
                                   double time,
@@ -3338,14 +3891,14 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
 
     bezier->evaluateFeatherPointsAtTime_DeCasteljau(false, time, mipmapLevel,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                                                    50,
+                                                    -1,
 #else
                                                     1,
 #endif
                                                     true, &featherPolygon, &featherPolyBBox);
     bezier->evaluateAtTime_DeCasteljau(false, time, mipmapLevel,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                                       50,
+                                       -1,
 #else
                                        1,
 #endif
@@ -3812,12 +4365,121 @@ static void tess_intersection_combine_callback(double coords[3], void */*data*/[
     myData->allocatedIntersections.push_back(ret);
 }
 
+namespace {
+
+struct RotoShapeTriangulation
+{
+    std::list<RotoFeatherVertex> featherMesh;
+    std::list<RotoTriangleFans> internalFans;
+    std::list<RotoTriangles> internalTriangles;
+    std::list<RotoTriangleStrips> internalStrips;
+};
+
+typedef boost::shared_ptr<const RotoShapeTriangulation> RotoShapeTriangulationConstPtr;
+typedef std::list<std::pair<U64, RotoShapeTriangulationConstPtr> > RotoShapeTriangulationCache;
+
+// The last triangulations computed, most recently used first. They are keyed by the shape itself
+// (not by the Bezier item) since two identical shapes have the same triangulation.
+QMutex rotoShapeTriangulationCacheMutex;
+RotoShapeTriangulationCache rotoShapeTriangulationCache;
+
+void
+appendBezierCPsToHash(bool isFeather,
+                      const std::list<BezierCPPtr>& cps,
+                      double time,
+                      Hash64* hash)
+{
+    hash->append(isFeather);
+    hash->append( (U64)cps.size() );
+    for (std::list<BezierCPPtr>::const_iterator it = cps.begin(); it != cps.end(); ++it) {
+        double x, y, lx, ly, rx, ry;
+        (*it)->getPositionAtTime(false, time, ViewIdx(0), &x, &y);
+        (*it)->getLeftBezierPointAtTime(false, time, ViewIdx(0), &lx, &ly);
+        (*it)->getRightBezierPointAtTime(false, time, ViewIdx(0), &rx, &ry);
+        hash->append(x);
+        hash->append(y);
+        hash->append(lx);
+        hash->append(ly);
+        hash->append(rx);
+        hash->append(ry);
+    }
+}
+
+U64
+getRotoShapeTriangulationHash(const Bezier* bezier,
+                              double time,
+                              unsigned int mipmapLevel,
+                              double featherDist)
+{
+    Hash64 hash;
+
+    hash.append(mipmapLevel);
+    hash.append(featherDist);
+    hash.append( bezier->isOpenBezier() );
+    hash.append( bezier->isCurveFinished() );
+    hash.append( bezier->isFeatherPolygonClockwiseOriented(false, time) );
+
+    Transform::Matrix3x3 transform;
+    bezier->getTransformAtTime(time, &transform);
+    const double m[9] = {transform.a, transform.b, transform.c, transform.d, transform.e, transform.f, transform.g, transform.h, transform.i};
+    for (int i = 0; i < 9; ++i) {
+        hash.append(m[i]);
+    }
+
+    appendBezierCPsToHash( false, bezier->getControlPoints_mt_safe(), time, &hash );
+    appendBezierCPsToHash( true, bezier->getFeatherPoints_mt_safe(), time, &hash );
+    hash.computeHash();
+
+    return hash.value();
+}
+
+} // anon namespace
+
 void
 RotoContextPrivate::computeTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel, double featherDist,
                                      std::list<RotoFeatherVertex>* featherMesh,
                                      std::list<RotoTriangleFans>* internalFans,
                                      std::list<RotoTriangles>* internalTriangles,
                                      std::list<RotoTriangleStrips>* internalStrips)
+{
+    const U64 key = getRotoShapeTriangulationHash(bezier, time, mipmapLevel, featherDist);
+    RotoShapeTriangulationConstPtr triangulation;
+    {
+        QMutexLocker k(&rotoShapeTriangulationCacheMutex);
+        for (RotoShapeTriangulationCache::iterator it = rotoShapeTriangulationCache.begin(); it != rotoShapeTriangulationCache.end(); ++it) {
+            if (it->first == key) {
+                triangulation = it->second;
+                rotoShapeTriangulationCache.splice(rotoShapeTriangulationCache.begin(), rotoShapeTriangulationCache, it);
+                break;
+            }
+        }
+    }
+
+    if (!triangulation) {
+        // Compute outside of the lock: concurrent renders of the same shape may compute it twice, which is harmless
+        boost::shared_ptr<RotoShapeTriangulation> computed = boost::make_shared<RotoShapeTriangulation>();
+        computeTriangles_uncached(bezier, time, mipmapLevel, featherDist, &computed->featherMesh, &computed->internalFans, &computed->internalTriangles, &computed->internalStrips);
+        triangulation = computed;
+
+        QMutexLocker k(&rotoShapeTriangulationCacheMutex);
+        rotoShapeTriangulationCache.push_front( std::make_pair(key, triangulation) );
+        while (rotoShapeTriangulationCache.size() > NATRON_ROTO_TRIANGULATION_CACHE_SIZE) {
+            rotoShapeTriangulationCache.pop_back();
+        }
+    }
+
+    featherMesh->insert( featherMesh->end(), triangulation->featherMesh.begin(), triangulation->featherMesh.end() );
+    internalFans->insert( internalFans->end(), triangulation->internalFans.begin(), triangulation->internalFans.end() );
+    internalTriangles->insert( internalTriangles->end(), triangulation->internalTriangles.begin(), triangulation->internalTriangles.end() );
+    internalStrips->insert( internalStrips->end(), triangulation->internalStrips.begin(), triangulation->internalStrips.end() );
+} // RotoContextPrivate::computeTriangles
+
+void
+RotoContextPrivate::computeTriangles_uncached(const Bezier * bezier, double time, unsigned int mipmapLevel, double featherDist,
+                                              std::list<RotoFeatherVertex>* featherMesh,
+                                              std::list<RotoTriangleFans>* internalFans,
+                                              std::list<RotoTriangles>* internalTriangles,
+                                              std::list<RotoTriangleStrips>* internalStrips)
 {
     ///Note that we do not use the opacity when rendering the bezier, it is rendered with correct floating point opacity/color when converting
     ///to the Natron image.
@@ -229,6 +229,12 @@ public:
      * @brief To be called when a change was made to trigger a new render.
      **/
     void evaluateChange();
+
+    /**
+     * @brief Same as evaluateChange() when the change only affects the given region (in canonical coordinates) at the given time:
+     * the rest of the cached images remains valid and only this region is rendered again.
+     **/
+    void evaluateChange(double time, const RectD& region);
     void evaluateChange_noIncrement();
 
     void incrementAge();
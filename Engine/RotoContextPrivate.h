@@ -2229,13 +2229,31 @@ public:
                                double time,
                                unsigned int mipmapLevel);
     static void renderBezier(cairo_t* cr, const Bezier* bezier, double opacity, double time, double startTime, double endTime, double mbFrameStep, unsigned int mipmapLevel);
+
+    /**
+     * @brief Rasterizes the triangles of the shape and its feather with OpenGL and reads the coverage back into the
+     * given A8 surface, whose origin is the bottom-left corner of roi. The given context must be current.
+     * Returns false if it could not be done, in which case the cairo rasterization must be used.
+     **/
+    static bool renderBezier_gl(const OSGLContextPtr& glContext, const Bezier* bezier, double time, double startTime, double endTime, double mbFrameStep, unsigned int mipmapLevel, const RectI& roi, cairo_surface_t* dstImg);
+
+    /**
+     * @brief Same as renderBezier_gl but on the CPU: the triangles are rasterized in tiles of roi processed in parallel.
+     **/
+    static void renderBezier_tiled(const Bezier* bezier, double time, double startTime, double endTime, double mbFrameStep, unsigned int mipmapLevel, const RectI& roi, cairo_surface_t* dstImg);
     static void renderFeather(const Bezier * bezier, double time, unsigned int mipmapLevel, double shapeColor[3], double opacity, double featherDist, double fallOff, cairo_pattern_t * mesh);
     static void renderFeather_cairo(const std::list<RotoFeatherVertex>& vertices, double shapeColor[3],  double fallOff, cairo_pattern_t * mesh);
     static void renderInternalShape_cairo(const std::list<RotoTriangles>& triangles,
                                           const std::list<RotoTriangleFans>& fans,
                                           const std::list<RotoTriangleStrips>& strips,
                                           double shapeColor[3],  cairo_pattern_t * mesh);
+    /**
+     * @brief Returns the feather mesh and the tessellation of the internal shape of the bezier.
+     * The result only depends on the shape of the bezier at the given time, so the last results are cached
+     * by a hash of the shape: tiles, re-renders and motion-blur samples where the shape did not move re-use them.
+     **/
     static void computeTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel,  double featherDist, std::list<RotoFeatherVertex>* featherMesh, std::list<RotoTriangleFans>* internalFans, std::list<RotoTriangles>* internalTriangles,std::list<RotoTriangleStrips>* internalStrips);
+    static void computeTriangles_uncached(const Bezier * bezier, double time, unsigned int mipmapLevel,  double featherDist, std::list<RotoFeatherVertex>* featherMesh, std::list<RotoTriangleFans>* internalFans, std::list<RotoTriangles>* internalTriangles,std::list<RotoTriangleStrips>* internalStrips);
     static void renderInternalShape(double time, unsigned int mipmapLevel, double shapeColor[3], double opacity, const Transform::Matrix3x3 & transform, cairo_t * cr, cairo_pattern_t * mesh, const BezierCPs &cps);
     static void bezulate(double time, const BezierCPs& cps, std::list<BezierCPs>* patches);
     static void applyAndDestroyMask(cairo_t* cr, cairo_pattern_t* mesh);
@@ -202,12 +202,17 @@ public:
 
     void resetTransformCenter();
 
+    /**
+     * @brief Renders the mask of the item. If glContext is set, it must be current on this thread:
+     * shapes are then rasterized with OpenGL, falling back to cairo if this fails.
+     **/
     ImagePtr renderMaskFromStroke(const ImagePlaneDesc& components,
                                                   const double time,
                                                   const ViewIdx view,
                                                   const ImageBitDepthEnum depth,
                                                   const unsigned int mipmapLevel,
-                                                  const RectD& rotoNodeSrcRod);
+                                                  const RectD& rotoNodeSrcRod,
+                                                  const OSGLContextPtr& glContext = OSGLContextPtr());
 
 private:
 
@@ -221,6 +226,7 @@ private:
                                                 const ImageBitDepthEnum depth,
                                                 const unsigned int mipmapLevel,
                                                 const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                                const OSGLContextPtr& glContext,
                                                 const ImagePtr &image);
 
 Q_SIGNALS:
@@ -1749,7 +1749,7 @@ RotoPaint::drawOverlay(double time,
                 std::list<ParametricPoint > points;
                 isBezier->evaluateAtTime_DeCasteljau(true, time, 0,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                                                     100,
+                                                     -1,
 #else
                                                      1,
 #endif
@@ -1783,7 +1783,7 @@ RotoPaint::drawOverlay(double time,
                     ///Draw feather only if visible (button is toggled in the user interface)
                     isBezier->evaluateFeatherPointsAtTime_DeCasteljau(true, time, 0,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                                                                      100,
+                                                                      -1,
 #else
                                                                       1,
 #endif
@@ -2243,6 +2243,7 @@ RotoPaint::onOverlayPenDown(double time,
     double cpSelectionTolerance = kControlPointSelectionTolerance * pixelScale.first;
 
     _imp->ui->lastTabletDownTriggeredEraser = false;
+    _imp->ui->penUpDirtyRegionSet = false;
     if ( _imp->isPaintByDefault && ( (pen == ePenTypeEraser) || (pen == ePenTypePen) || (pen == ePenTypeCursor) ) ) {
         if ( (pen == ePenTypeEraser) && (_imp->ui->selectedTool != eRotoToolEraserBrush) ) {
             _imp->ui->setCurrentTool( _imp->ui->eraserAction.lock() );
@@ -3085,13 +3086,18 @@ RotoPaint::onOverlayPenUp(double /*time*/,
     }
 
     if (_imp->ui->evaluateOnPenUp) {
-        context->evaluateChange();
+        if (_imp->ui->penUpDirtyRegionSet) {
+            context->evaluateChange(_imp->ui->penUpDirtyTime, _imp->ui->penUpDirtyRegion);
+        } else {
+            context->evaluateChange();
+        }
         getApp()->triggerAutoSave();
 
         //sync other viewers linked to this roto
         redrawOverlayInteract();
         _imp->ui->evaluateOnPenUp = false;
     }
+    _imp->ui->penUpDirtyRegionSet = false;
 
     bool ret = false;
     _imp->ui->tangentBeingDragged.reset();
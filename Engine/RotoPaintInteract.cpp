@@ -79,6 +79,9 @@ RotoPaintInteract::RotoPaintInteract(RotoPaintPrivate* p)
     , lastClickPos()
     , lastMousePos()
     , evaluateOnPenUp(false)
+    , penUpDirtyRegionSet(false)
+    , penUpDirtyTime(0)
+    , penUpDirtyRegion()
     , evaluateOnKeyUp(false)
     , iSelectingwithCtrlA(false)
     , shiftDown(0)
@@ -117,6 +120,39 @@ RotoPaintInteract::evaluate(bool redraw)
     p->publicInterface->getApp()->triggerAutoSave();
 }
 
+void
+RotoPaintInteract::evaluate(bool redraw,
+                            double time,
+                            const RectD& region)
+{
+    if (redraw) {
+        p->publicInterface->redrawOverlayInteract();
+    }
+    p->publicInterface->getNode()->getRotoContext()->evaluateChange(time, region);
+    p->publicInterface->getApp()->triggerAutoSave();
+}
+
+void
+RotoPaintInteract::addPenUpDirtyRegion(double time,
+                                       const RectD& region)
+{
+    if ( evaluateOnPenUp && ( !penUpDirtyRegionSet || (time != penUpDirtyTime) ) ) {
+        //Another change is already waiting for the pen up: everything is rendered again
+        penUpDirtyRegionSet = false;
+
+        return;
+    }
+    if (!penUpDirtyRegionSet) {
+        penUpDirtyRegionSet = true;
+        penUpDirtyTime = time;
+        penUpDirtyRegion = region;
+    } else if ( penUpDirtyRegion.isNull() ) {
+        penUpDirtyRegion = region;
+    } else if ( !region.isNull() ) {
+        penUpDirtyRegion.merge(region);
+    }
+}
+
 void
 RotoPaintInteract::autoSaveAndRedraw()
 {
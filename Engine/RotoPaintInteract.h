@@ -531,6 +531,9 @@ public:
     QPointF lastClickPos;
     QPointF lastMousePos;
     bool evaluateOnPenUp; //< if true the next pen up will call context->evaluateChange()
+    bool penUpDirtyRegionSet; //< if true evaluateOnPenUp only waits for the changes in penUpDirtyRegion at penUpDirtyTime
+    double penUpDirtyTime;
+    RectD penUpDirtyRegion;
     bool evaluateOnKeyUp;  //< if true the next key up will call context->evaluateChange()
     bool iSelectingwithCtrlA;
     int shiftDown;
@@ -756,6 +759,17 @@ public:
 
 
     void evaluate(bool redraw);
+
+    /**
+     * @brief Same as evaluate() for a change that only affects the given region at the given time, see RotoContext::evaluateChange()
+     **/
+    void evaluate(bool redraw, double time, const RectD& region);
+
+    /**
+     * @brief To be called before setting evaluateOnPenUp for a change that only affects the given region at the given time,
+     * so that the pen up only renders the union of these regions.
+     **/
+    void addPenUpDirtyRegion(double time, const RectD& region);
     void autoSaveAndRedraw();
 
     void redrawOverlays();
@@ -27,7 +27,9 @@
 
 #include <algorithm> // min, max
 #include <cassert>
+#include <cstring> // memcpy
 #include <stdexcept>
+#include <vector>
 
 #include <boost/algorithm/clamp.hpp>
 
@@ -146,62 +148,81 @@ renderSmearDot(const unsigned char* maskData,
                const int maskStride,
                const int maskWidth,
                const int maskHeight,
+               const float* maskValues,
                const Point& prev,
                const Point& next,
                const double brushSizePixels,
                int nComps,
+               std::vector<float>* prevDotPixels,
                const ImagePtr& outputImage)
 {
-    /// First copy the portion of the image around the previous dot into tmpBuf
+    /// First copy the portion of the image around the previous dot into prevDotPixels (a buffer re-used across dots)
     RectD prevDotRoD(prev.x - brushSizePixels / 2., prev.y - brushSizePixels / 2., prev.x + brushSizePixels / 2., prev.y + brushSizePixels / 2.);
     RectI prevDotBounds;
 
     prevDotRoD.toPixelEnclosing(0, outputImage->getPixelAspectRatio(), &prevDotBounds);
-    ImagePtr tmpBuf( new Image(outputImage->getComponents(),
-                               prevDotRoD,
-                               prevDotBounds,
-                               0,
-                               outputImage->getPixelAspectRatio(),
-                               outputImage->getBitDepth(),
-                               outputImage->getPremultiplication(),
-                               outputImage->getFieldingOrder(),
-                               false) );
-    tmpBuf->pasteFrom(*outputImage, prevDotBounds, false);
-
-    Image::ReadAccess tmpAcc( tmpBuf.get() );
+    if ( prevDotBounds.isNull() ) {
+        return;
+    }
+
+    const RectI outputBounds = outputImage->getBounds();
+    const int prevDotRowElements = prevDotBounds.width() * nComps;
+    prevDotPixels->assign(prevDotBounds.area() * nComps, 0.f);
+
     Image::WriteAccess wacc( outputImage.get() );
+    RectI copyRect;
+    if ( prevDotBounds.intersect(outputBounds, &copyRect) ) {
+        for (int y = copyRect.y1; y < copyRect.y2; ++y) {
+            const float* srcPixels = (const float*)wacc.pixelAt(copyRect.x1, y);
+            assert(srcPixels);
+            std::memcpy( &(*prevDotPixels)[(y - prevDotBounds.y1) * prevDotRowElements + (copyRect.x1 - prevDotBounds.x1) * nComps],
+                         srcPixels, copyRect.width() * nComps * sizeof(float) );
+        }
+    }
+
     RectI nextDotBounds;
     nextDotBounds.x1 = next.x - maskWidth / 2;
     nextDotBounds.x2 = next.x + maskWidth / 2;
     nextDotBounds.y1 = next.y - maskHeight / 2;
     nextDotBounds.y2 = next.y + maskHeight / 2;
 
+    // Only write the pixels of the dot that are within the output image and whose source is within the previous dot
+    const int x1 = std::max(nextDotBounds.x1, outputBounds.x1);
+    const int x2 = std::min( std::min(nextDotBounds.x2, outputBounds.x2), nextDotBounds.x1 + prevDotBounds.width() );
+    if (x1 >= x2) {
+        return;
+    }
+
     const unsigned char* mask_pixels = maskData;
     int yPrev = prevDotBounds.y1;
-    for (int y = nextDotBounds.y1; y < nextDotBounds.y2;
+    for (int y = nextDotBounds.y1; y < nextDotBounds.y2 && yPrev < prevDotBounds.y2;
          ++y,
          ++yPrev,
          mask_pixels += maskStride) {
-        float* dstPixels = (float*)wacc.pixelAt(nextDotBounds.x1, y);
-        assert(dstPixels);
-        if (!dstPixels) {
+        if ( (y < outputBounds.y1) || (y >= outputBounds.y2) ) {
             continue;
         }
+        float* dstPixels = (float*)wacc.pixelAt(x1, y);
+        assert(dstPixels);
+        const float* srcPixels = &(*prevDotPixels)[(yPrev - prevDotBounds.y1) * prevDotRowElements + (x1 - nextDotBounds.x1) * nComps];
+        const unsigned char* mask = mask_pixels + (x1 - nextDotBounds.x1);
 
-        int xPrev = prevDotBounds.x1;
-        for (int x = nextDotBounds.x1; x < nextDotBounds.x2;
-             ++x, ++xPrev,
-             dstPixels += nComps) {
-            const float* srcPixels = (const float*)tmpAcc.pixelAt(xPrev, yPrev);
-
-            if (srcPixels) {
-                float mask_scale = Image::convertPixelDepth<unsigned char, float>(mask_pixels[x - nextDotBounds.x1]);
-                float one_minus_mask_scale = 1. - mask_scale;
-
+        for (int x = x1; x < x2; ++x, ++mask, dstPixels += nComps, srcPixels += nComps) {
+            if (*mask == 0) {
+                // transparent part of the brush
+                continue;
+            }
+            if (*mask == 255) {
                 for (int k = 0; k < nComps; ++k) {
-                    dstPixels[k] = srcPixels[k] * mask_scale + dstPixels[k] * one_minus_mask_scale;
+                    dstPixels[k] = srcPixels[k];
                 }
-            } else {
+                continue;
+            }
+            const float mask_scale = maskValues[*mask];
+            const float one_minus_mask_scale = 1.f - mask_scale;
+
+            for (int k = 0; k < nComps; ++k) {
+                dstPixels[k] = srcPixels[k] * mask_scale + dstPixels[k] * one_minus_mask_scale;
             }
         }
     }
@@ -286,6 +307,13 @@ RotoSmear::render(const RenderActionArgs& args)
     int maskStride = cairo_image_surface_get_stride(imgWrapper.cairoImg);
     unsigned char* maskData = cairo_image_surface_get_data(imgWrapper.cairoImg);
 
+    // The dot is the same for the whole stroke: convert its 8-bit values once
+    float maskValues[256];
+    for (int i = 0; i < 256; ++i) {
+        maskValues[i] = Image::convertPixelDepth<unsigned char, float>( (unsigned char)i );
+    }
+    std::vector<float> prevDotPixels;
+
     for (std::list<std::list<std::pair<Point, double> > >::const_iterator itStroke = strokes.begin(); itStroke != strokes.end(); ++itStroke) {
         int firstPoint = (int)std::floor( (itStroke->size() * writeOnStart) );
         int endPoint = (int)std::ceil( (itStroke->size() * writeOnEnd) );
@@ -347,7 +375,7 @@ RotoSmear::render(const RenderActionArgs& args)
                 // This is the very first dot we render
                 prev = *it;
                 ++it;
-                renderSmearDot(maskData, maskStride, maskWidth, maskHeight, prev.first, it->first, brushSizePixel, nComps, plane->second);
+                renderSmearDot(maskData, maskStride, maskWidth, maskHeight, maskValues, prev.first, it->first, brushSizePixel, nComps, &prevDotPixels, plane->second);
                 didPaint = true;
                 renderPoint = *it;
                 prev = renderPoint;
@@ -410,7 +438,7 @@ RotoSmear::render(const RenderActionArgs& args)
 
                 prevPoint.x = prev.first.x + vx * v.x;
                 prevPoint.y = prev.first.y + vy * v.y;
-                renderSmearDot(maskData, maskStride, maskWidth, maskHeight, prevPoint, renderPoint.first, brushSizePixel, nComps, plane->second);
+                renderSmearDot(maskData, maskStride, maskWidth, maskHeight, maskValues, prevPoint, renderPoint.first, brushSizePixel, nComps, &prevDotPixels, plane->second);
                 didPaint = true;
                 prev = renderPoint;
                 cur = renderPoint;
@@ -58,6 +58,34 @@ typedef std::list<SelectedCp> SelectedCpList;
 typedef BezierPtr BezierPtr;
 typedef std::list<BezierPtr> BezierList;
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+///Merges the bounding box at the given time of the beziers owning the given points into region
+void
+mergeBeziersBoundingBox(const SelectedCpList& points,
+                        double time,
+                        RectD* region)
+{
+    std::set<Bezier*> beziers;
+
+    for (SelectedCpList::const_iterator it = points.begin(); it != points.end(); ++it) {
+        beziers.insert( it->first->getBezier().get() );
+    }
+    for (std::set<Bezier*>::iterator it = beziers.begin(); it != beziers.end(); ++it) {
+        RectD bbox = (*it)->getBoundingBox(time);
+        if ( bbox.isNull() ) {
+            continue;
+        }
+        if ( region->isNull() ) {
+            *region = bbox;
+        } else {
+            region->merge(bbox);
+        }
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 MoveControlPointsUndoCommand::MoveControlPointsUndoCommand(const RotoPaintInteractPtr& roto,
                                                            const std::list<std::pair<BezierCPPtr, BezierCPPtr> > & toDrag
                                                            ,
@@ -81,25 +109,19 @@ MoveControlPointsUndoCommand::MoveControlPointsUndoCommand(const RotoPaintIntera
 
     roto->getSelection(&_selectedCurves, &_selectedPoints);
 
-    ///we make a copy of the points
+    ///we save the keyframes the move can change: the one at the current time, or all of them with ripple edit
     for (SelectedCpList::iterator it = _pointsToDrag.begin(); it != _pointsToDrag.end(); ++it) {
-        CpPtr first, second;
-        if ( it->first->isFeatherPoint() ) {
-            first.reset( new FeatherPoint( it->first->getBezier() ) );
-            first->clone( *(it->first) );
-        } else {
-            first.reset( new BezierCP( *(it->first) ) );
+        std::set<double> times;
+        if (_rippleEditEnabled) {
+            it->first->getBezier()->getKeyframeTimes(&times);
         }
+        times.insert(time);
 
+        _originalPoints.push_back( std::make_pair( BezierCPKeyFramesSnapshot(), BezierCPKeyFramesSnapshot() ) );
+        it->first->saveKeyFrames(times, &_originalPoints.back().first);
         if (it->second) {
-            if ( it->second->isFeatherPoint() ) {
-                second.reset( new FeatherPoint( it->second->getBezier() ) );
-                second->clone( *(it->second) );
-            } else {
-                second.reset( new BezierCP( *(it->second) ) );
-            }
+            it->second->saveKeyFrames(times, &_originalPoints.back().second);
         }
-        _originalPoints.push_back( std::make_pair(first, second) );
     }
 
     for (SelectedCpList::iterator it = _pointsToDrag.begin(); it != _pointsToDrag.end(); ++it) {
@@ -118,17 +140,21 @@ MoveControlPointsUndoCommand::~MoveControlPointsUndoCommand()
 void
 MoveControlPointsUndoCommand::undo()
 {
-    SelectedCpList::iterator cpIt = _originalPoints.begin();
+    std::list<std::pair<BezierCPKeyFramesSnapshot, BezierCPKeyFramesSnapshot> >::iterator cpIt = _originalPoints.begin();
     std::set<Bezier*> beziers;
 
     for (SelectedCpList::iterator it = _pointsToDrag.begin(); it != _pointsToDrag.end(); ++it) {
         beziers.insert( it->first->getBezier().get() );
     }
 
+    ///Only the pixels covered by the shapes before or after the change have to be rendered again
+    RectD dirtyRegion;
+    mergeBeziersBoundingBox(_pointsToDrag, _time, &dirtyRegion);
+
     for (SelectedCpList::iterator it = _pointsToDrag.begin(); it != _pointsToDrag.end(); ++it, ++cpIt) {
-        it->first->clone(*cpIt->first);
+        it->first->restoreKeyFrames(cpIt->first);
         if (it->second) {
-            it->second->clone(*cpIt->second);
+            it->second->restoreKeyFrames(cpIt->second);
         }
     }
 
@@ -136,8 +162,10 @@ MoveControlPointsUndoCommand::undo()
         (*it)->incrementNodesAge();
     }
 
+    mergeBeziersBoundingBox(_pointsToDrag, _time, &dirtyRegion);
+
     RotoPaintInteractPtr roto = _roto.lock();
-    roto->evaluate(true);
+    roto->evaluate(true, _time, dirtyRegion);
     roto->setCurrentTool( _selectedTool.lock() );
     roto->setSelection(_selectedCurves, _selectedPoints);
 }
@@ -156,6 +184,9 @@ MoveControlPointsUndoCommand::redo()
     RotoToolEnum selectedTool;
     bool ok = roto->getToolForAction(_selectedTool.lock(), &selectedTool);
 
+    RectD dirtyRegion;
+    mergeBeziersBoundingBox(_pointsToDrag, _time, &dirtyRegion);
+
     try {
         for (std::list<int>::iterator it = _indexesToMove.begin(); it != _indexesToMove.end(); ++it, ++itPoints) {
             if ( itPoints->first->isFeatherPoint() ) {
@@ -176,9 +207,13 @@ MoveControlPointsUndoCommand::redo()
         qDebug() << "Exception while operating MoveControlPointsUndoCommand::redo(): " << e.what();
     }
 
+    mergeBeziersBoundingBox(_pointsToDrag, _time, &dirtyRegion);
+
     if (_firstRedoCalled) {
         roto->setSelection(_selectedCurves, _selectedPoints);
-        roto->evaluate(true);
+        roto->evaluate(true, _time, dirtyRegion);
+    } else {
+        roto->addPenUpDirtyRegion(_time, dirtyRegion);
     }
 
     _firstRedoCalled = true;
@@ -246,14 +281,15 @@ TransformUndoCommand::TransformUndoCommand(const RotoPaintInteractPtr& roto,
 
 
     *_matrix = Transform::matTransformCanonical(tx, ty, sx, sy, skewX, skewY, true, (rot), centerX, centerY);
-    ///we make a copy of the points
+    ///we save the keyframes the transform can change, that is only the ones at the current time
+    std::set<double> times;
+    times.insert(time);
     for (SelectedCpList::iterator it = _selectedPoints.begin(); it != _selectedPoints.end(); ++it) {
-        CpPtr first( new BezierCP( *(it->first) ) );
-        CpPtr second;
+        _originalPoints.push_back( std::make_pair( BezierCPKeyFramesSnapshot(), BezierCPKeyFramesSnapshot() ) );
+        it->first->saveKeyFrames(times, &_originalPoints.back().first);
         if (it->second) {
-            second.reset( new BezierCP( *(it->second) ) );
+            it->second->saveKeyFrames(times, &_originalPoints.back().second);
         }
-        _originalPoints.push_back( std::make_pair(first, second) );
     }
 
     setText( tr("Transform control points").toStdString() );
@@ -266,7 +302,7 @@ TransformUndoCommand::~TransformUndoCommand()
 void
 TransformUndoCommand::undo()
 {
-    SelectedCpList::iterator cpIt = _originalPoints.begin();
+    std::list<std::pair<BezierCPKeyFramesSnapshot, BezierCPKeyFramesSnapshot> >::iterator cpIt = _originalPoints.begin();
     std::set<Bezier*> beziers;
 
     for (SelectedCpList::iterator it = _selectedPoints.begin(); it != _selectedPoints.end(); ++it) {
@@ -277,20 +313,24 @@ TransformUndoCommand::undo()
         (*it)->incrementNodesAge();
     }
 
+    RectD dirtyRegion;
+    mergeBeziersBoundingBox(_selectedPoints, _time, &dirtyRegion);
 
     for (SelectedCpList::iterator it = _selectedPoints.begin(); it != _selectedPoints.end(); ++it, ++cpIt) {
-        it->first->clone(*cpIt->first);
+        it->first->restoreKeyFrames(cpIt->first);
         if (it->second) {
-            it->second->clone(*cpIt->second);
+            it->second->restoreKeyFrames(cpIt->second);
         }
     }
 
+    mergeBeziersBoundingBox(_selectedPoints, _time, &dirtyRegion);
+
     RotoPaintInteractPtr roto = _roto.lock();
     if (!roto) {
         return;
     }
 
-    roto->evaluate(true);
+    roto->evaluate(true, _time, dirtyRegion);
     roto->setCurrentTool( _selectedTool.lock() );
     roto->setSelection(_selectedCurves, _selectedPoints);
 }
@@ -304,6 +344,9 @@ TransformUndoCommand::transformPoint(const BezierCPPtr & point)
 void
 TransformUndoCommand::redo()
 {
+    RectD dirtyRegion;
+    mergeBeziersBoundingBox(_selectedPoints, _time, &dirtyRegion);
+
     for (SelectedCpList::iterator it = _selectedPoints.begin(); it != _selectedPoints.end(); ++it) {
         transformPoint(it->first);
         if (it->second) {
@@ -311,14 +354,17 @@ TransformUndoCommand::redo()
         }
     }
 
+    mergeBeziersBoundingBox(_selectedPoints, _time, &dirtyRegion);
+
     RotoPaintInteractPtr roto = _roto.lock();
     if (!roto) {
         return;
     }
     if (_firstRedoCalled) {
         roto->setSelection(_selectedCurves, _selectedPoints);
-        roto->evaluate(true);
+        roto->evaluate(true, _time, dirtyRegion);
     } else {
+        roto->addPenUpDirtyRegion(_time, dirtyRegion);
         roto->computeSelectedCpsBBOX();
         roto->redrawOverlays();
     }
@@ -42,6 +42,7 @@ CLANG_DIAG_OFF(uninitialized)
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
+#include "Engine/BezierCP.h"
 #include "Engine/EngineFwd.h"
 #include "Engine/UndoCommand.h"
 
@@ -82,7 +83,8 @@ private:
     double _time; //< the time at which the change was made
     std::list<RotoDrawableItemPtr> _selectedCurves;
     std::list<int> _indexesToMove; //< indexes of the control points
-    std::list<std::pair<BezierCPPtr, BezierCPPtr> > _originalPoints, _selectedPoints, _pointsToDrag;
+    std::list<std::pair<BezierCPPtr, BezierCPPtr> > _selectedPoints, _pointsToDrag;
+    std::list<std::pair<BezierCPKeyFramesSnapshot, BezierCPKeyFramesSnapshot> > _originalPoints; //< only what the move can change
 };
 
 
@@ -131,7 +133,8 @@ private:
     Transform::Matrix3x3Ptr _matrix;
     double _time; //< the time at which the change was made
     std::list<RotoDrawableItemPtr> _selectedCurves;
-    std::list<std::pair<BezierCPPtr, BezierCPPtr> > _originalPoints, _selectedPoints;
+    std::list<std::pair<BezierCPPtr, BezierCPPtr> > _selectedPoints;
+    std::list<std::pair<BezierCPKeyFramesSnapshot, BezierCPKeyFramesSnapshot> > _originalPoints; //< only what the transform can change
 };
 
 class AddPointUndoCommand
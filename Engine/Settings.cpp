@@ -49,6 +49,7 @@
 #include "Engine/LibraryBinary.h"
 #include "Engine/MemoryInfo.h" // getSystemTotalRAM, isApplication32Bits, printAsRAM
 #include "Engine/Node.h"
+#include "Engine/NumaInfo.h" // getNumaNodesCount, setNumaAwareRenderingEnabled
 #include "Engine/OSGLContext.h"
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/Plugin.h"
@@ -327,6 +328,23 @@ Settings::initializeKnobsThreading()
     _nThreadsPerEffect->disableSlider();
     _threadingPage->addKnob(_nThreadsPerEffect);
 
+    _autotuneThreadsPerEffect = AppManager::createKnob<KnobBool>( this, tr("Autotune threads per effect") );
+    _autotuneThreadsPerEffect->setName("autotuneThreadsPerEffect");
+    _autotuneThreadsPerEffect->setHintToolTip( tr("When checked and the max threads usable per effect is 0, the number of threads "
+                                                  "each plug-in uses is chosen from how its processing scaled with the number of threads "
+                                                  "in the previous renders: the threads which would not make it faster are left to the "
+                                                  "other renders. This history is kept across sessions.") );
+    _threadingPage->addKnob(_autotuneThreadsPerEffect);
+
+    _numaAwareRendering = AppManager::createKnob<KnobBool>( this, tr("NUMA-aware rendering") );
+    _numaAwareRendering->setName("numaAwareRendering");
+    _numaAwareRendering->setHintToolTip( tr("When checked, on systems with several NUMA nodes (e.g: multi-socket workstations), each render "
+                                            "thread is bound to the CPUs of one node and the images it renders are allocated in the memory "
+                                            "of that node, which is faster to access than the memory of the other nodes. "
+                                            "This system has %1 NUMA node(s). \n"
+                                            "Changing this parameter requires a restart of the application to be fully effective.").arg( getNumaNodesCount() ) );
+    _threadingPage->addKnob(_numaAwareRendering);
+
     _renderInSeparateProcess = AppManager::createKnob<KnobBool>( this, tr("Render in a separate process") );
     _renderInSeparateProcess->setName("renderNewProcess");
     _renderInSeparateProcess->setHintToolTip( tr("If true, %1 will render frames to disk in "
@@ -338,6 +356,15 @@ Settings::initializeKnobsThreading()
                                       "other prior tasks are done.") );
     _queueRenders->setName("queueRenders");
     _threadingPage->addKnob(_queueRenders);
+
+    _shareRenderPasses = AppManager::createKnob<KnobBool>( this, tr("Render writers with the same inputs together") );
+    _shareRenderPasses->setHintToolTip( tr("When checked, Write nodes that are started together with the same frame range and that "
+                                           "share nodes upstream are rendered by a single render: each frame is requested once and "
+                                           "written by all of them in turn, so that the shared part of the graph is rendered once "
+                                           "per frame instead of once per writer. Writers producing movie files and renders in a "
+                                           "separate process are not grouped.") );
+    _shareRenderPasses->setName("shareRenderPasses");
+    _threadingPage->addKnob(_shareRenderPasses);
 } // Settings::initializeKnobsThreading
 
 void
@@ -379,6 +406,34 @@ Settings::initializeKnobsRendering()
                                                                "transformations.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
     _activateTransformConcatenationSupport->setName("transformCatSupport");
     _renderingPage->addKnob(_activateTransformConcatenationSupport);
+
+    _hostTransformFilter = AppManager::createKnob<KnobChoice>( this, tr("Concatenated transforms filter") );
+    _hostTransformFilter->setName("hostTransformFilter");
+    {
+        std::vector<ChoiceOption> entries;
+        assert(entries.size() == (int)Settings::eHostTransformFilterPlugin);
+        entries.push_back(ChoiceOption("plugin",
+                                       tr("Plug-in").toStdString(),
+                                       tr("The transform plug-in renders with its own filter.").toStdString()));
+        assert(entries.size() == (int)Settings::eHostTransformFilterBilinear);
+        entries.push_back(ChoiceOption("bilinear",
+                                       tr("Bilinear").toStdString(),
+                                       tr("%1 resamples the image with a bilinear filter.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ).toStdString()));
+        assert(entries.size() == (int)Settings::eHostTransformFilterCubic);
+        entries.push_back(ChoiceOption("cubic",
+                                       tr("Cubic").toStdString(),
+                                       tr("%1 resamples the image with a Catmull-Rom cubic filter.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ).toStdString()));
+        assert(entries.size() == (int)Settings::eHostTransformFilterLanczos);
+        entries.push_back(ChoiceOption("lanczos",
+                                       tr("Lanczos").toStdString(),
+                                       tr("%1 resamples the image with a 3-lobes Lanczos filter.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ).toStdString()));
+        _hostTransformFilter->populateChoices(entries);
+    }
+    _hostTransformFilter->setHintToolTip( tr("Select whether transform effects render their transform, concatenated with the transforms upstream, "
+                                             "or %1 resamples the image itself on the CPU with the selected filter, "
+                                             "in which case the filter parameters of the plug-ins are ignored. "
+                                             "Large downscales sample a pre-filtered mipmap of the image.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
+    _renderingPage->addKnob(_hostTransformFilter);
 }
 
 void
@@ -386,6 +441,7 @@ Settings::populateOpenGLRenderers(const std::list<OpenGLRendererInfo>& renderers
 {
     if ( renderers.empty() ) {
         _availableOpenGLRenderers->setSecret(true);
+        _useAllOpenGLRenderers->setSecret(true);
         _nOpenGLContexts->setSecret(true);
         _enableOpenGL->setSecret(true);
         return;
@@ -402,6 +458,7 @@ Settings::populateOpenGLRenderers(const std::list<OpenGLRendererInfo>& renderers
     }
     _availableOpenGLRenderers->populateChoices(entries);
     _availableOpenGLRenderers->setSecret(renderers.size() == 1);
+    _useAllOpenGLRenderers->setSecret(renderers.size() == 1);
 }
 
 bool
@@ -420,6 +477,17 @@ Settings::getMaxOpenGLContexts() const
     return _nOpenGLContexts->getValue();
 }
 
+bool
+Settings::isMultiGPURenderingEnabled() const
+{
+    if ( _useAllOpenGLRenderers->getIsSecret() ) {
+        // There is a single renderer
+        return false;
+    }
+
+    return _useAllOpenGLRenderers->getValue();
+}
+
 GLRendererID
 Settings::getActiveOpenGLRendererID() const
 {
@@ -458,6 +526,14 @@ Settings::initializeKnobsGPU()
     _availableOpenGLRenderers->setHintToolTip( tr("The renderer used to perform OpenGL rendering. Changing the OpenGL renderer requires a restart of the application.") );
     _gpuPage->addKnob(_availableOpenGLRenderers);
 
+    _useAllOpenGLRenderers = AppManager::createKnob<KnobBool>( this, tr("Render on all GPUs") );
+    _useAllOpenGLRenderers->setName("useAllOpenGLRenderers");
+    _useAllOpenGLRenderers->setHintToolTip( tr("When checked, the OpenGL contexts are created in turn on every available renderer instead of only the one "
+                                               "selected above, so that frames rendered in parallel are spread across all GPUs. At least one context is "
+                                               "created per renderer, regardless of the number of OpenGL contexts. "
+                                               "Changing this setting requires a restart of the application.") );
+    _gpuPage->addKnob(_useAllOpenGLRenderers);
+
     _nOpenGLContexts = AppManager::createKnob<KnobInt>( this, tr("No. of OpenGL Contexts") );
     _nOpenGLContexts->setName("maxOpenGLContexts");
     _nOpenGLContexts->setMinimum(1);
@@ -1052,8 +1128,11 @@ Settings::initializeKnobsViewers()
                                         tr("Post-processing done by the viewer (such as colorspace conversion) is done "
                                            "by the CPU. The size of cached textures is thus smaller.").toStdString() ));
 
-    //textureModes.push_back("16bits half-float");
-    //helpStringsTextureModes.push_back("Not available yet. Similar to 32bits fp.");
+    textureModes.push_back(ChoiceOption("16f",
+                                        tr("16-bit half-float").toStdString(),
+                                        tr("Same as 32-bit floating-point, with half the size of cached textures and "
+                                           "of the texture uploads. Half-floats keep about 3 significant digits "
+                                           "and values up to 65504.").toStdString()));
     textureModes.push_back(ChoiceOption("32f",
                                         tr("32-bit floating-point").toStdString(),
                                         tr("Post-processing done by the viewer (such as colorspace conversion) is done "
@@ -1121,6 +1200,21 @@ Settings::initializeKnobsViewers()
 
     _viewersTab->addKnob(_autoProxyLevel);
 
+    _autoProxyRefinement = AppManager::createKnob<KnobBool>( this, tr("Refine draft renders when idle") );
+    _autoProxyRefinement->setName("autoProxyRefinement");
+    _autoProxyRefinement->setHintToolTip( tr("While interacting (scrubbing the timeline, dragging a slider...) the viewer renders in draft mode, "
+                                             "at the auto-proxy level if enabled. When checked, the frame is re-rendered at full quality "
+                                             "as soon as the interaction pauses, without waiting for the mouse to be released.") );
+    _viewersTab->addKnob(_autoProxyRefinement);
+
+    _adaptivePlaybackQuality = AppManager::createKnob<KnobBool>( this, tr("Lower the quality to hold the playback frame rate") );
+    _adaptivePlaybackQuality->setName("adaptivePlaybackQuality");
+    _adaptivePlaybackQuality->setHintToolTip( tr("When checked, frames that are not cached are rendered in draft mode and at a lower "
+                                                 "resolution during playback when rendering cannot keep up with the requested frame rate. "
+                                                 "Frames cached at full quality are always displayed at full quality, and the frame "
+                                                 "displayed when the playback stops is re-rendered at full quality.") );
+    _viewersTab->addKnob(_adaptivePlaybackQuality);
+
     _maximumNodeViewerUIOpened = AppManager::createKnob<KnobInt>( this, tr("Max. opened node viewer interface") );
     _maximumNodeViewerUIOpened->setName("maxNodeUiOpened");
     _maximumNodeViewerUIOpened->setMinimum(1);
@@ -1173,6 +1267,17 @@ Settings::initializeKnobsNodeGraph()
                                               "Changing this value will clear the undo/redo stack.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
     _nodegraphTab->addKnob(_maxUndoRedoNodeGraph);
 
+    _maxUndoRedoNodes = AppManager::createKnob<KnobInt>( this, tr("Maximum undo/redo for each node") );
+    _maxUndoRedoNodes->setName("maxUndoRedoNodes");
+    _maxUndoRedoNodes->disableSlider();
+    _maxUndoRedoNodes->setMinimum(0);
+    _maxUndoRedoNodes->setHintToolTip( tr("Set the maximum of events related to the parameters and the viewer interaction "
+                                          "of a node (such as Roto shapes edits) %1 remembers. Past this limit, older "
+                                          "events will be deleted forever, allowing to re-use the RAM for other purposes. "
+                                          "0 means no limit.\n"
+                                          "Changing this value only affects the nodes created afterwards.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
+    _nodegraphTab->addKnob(_maxUndoRedoNodes);
+
 
     _disconnectedArrowLength = AppManager::createKnob<KnobInt>( this, tr("Disconnected arrow length") );
     _disconnectedArrowLength->setName("disconnectedArrowLength");
@@ -1212,6 +1317,60 @@ Settings::initializeKnobsCaching()
                                            "output has its settings panel opened.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
     _cachingTab->addKnob(_aggressiveCaching);
 
+    _compressCache = AppManager::createKnob<KnobBool>( this, tr("Compress images before evicting them from RAM") );
+    _compressCache->setName("compressColdCacheEntries");
+    _compressCache->setHintToolTip( tr("When checked, the least recently used images of the RAM cache are compressed "
+                                       "instead of being destroyed right away when the cache is full. A compressed image takes "
+                                       "less memory and can be used again without being rendered again, at the cost of "
+                                       "decompressing it.") );
+    _cachingTab->addKnob(_compressCache);
+
+    _contentBasedNodeHash = AppManager::createKnob<KnobBool>( this, tr("Identify cached images by parameter values") );
+    _contentBasedNodeHash->setName("contentBasedNodeHash");
+    _contentBasedNodeHash->setHintToolTip( tr("When checked, the images of a node are identified in the cache by the values, animation curves "
+                                              "and expressions of its parameters and by its inputs, instead of by the number of changes made to "
+                                              "the node. Undoing a change or opening a project again in a later session then finds the images "
+                                              "rendered before in the cache, including the disk cache. Images of previous states of a node are "
+                                              "kept in the cache until they are evicted, instead of being discarded when the node changes. "
+                                              "Nodes with expressions are still identified by their changes.") );
+    _cachingTab->addKnob(_contentBasedNodeHash);
+
+    _viewerCacheAhead = AppManager::createKnob<KnobBool>( this, tr("Fill the playback cache when idle") );
+    _viewerCacheAhead->setName("viewerCacheAhead");
+    _viewerCacheAhead->setHintToolTip( tr("When checked, the frames of the playback range are rendered in the background "
+                                          "to the viewer cache a few seconds after the last change made to the viewer or the project, "
+                                          "so that the playback is realtime from its first pass. The background renders stop as soon as "
+                                          "anything is changed and do not evict images from the cache when it is full.") );
+    _cachingTab->addKnob(_viewerCacheAhead);
+
+    _hugePagesMode = AppManager::createKnob<KnobChoice>( this, tr("Huge pages for images") );
+    _hugePagesMode->setName("imagesHugePages");
+    {
+        std::vector<ChoiceOption> modes;
+        modes.push_back(ChoiceOption("none",
+                                     tr("None").toStdString(),
+                                     tr("Images use regular memory pages.").toStdString() ));
+        modes.push_back(ChoiceOption("transparent",
+                                     tr("Transparent").toStdString(),
+                                     tr("Large images ask the system to use transparent huge pages, if the system supports them.").toStdString() ));
+        modes.push_back(ChoiceOption("explicit",
+                                     tr("Explicit").toStdString(),
+                                     tr("Large images use the huge pages reserved by the system administrator, "
+                                        "or transparent huge pages when none is left.").toStdString() ));
+        _hugePagesMode->populateChoices(modes);
+    }
+    _hugePagesMode->setHintToolTip( tr("Huge memory pages reduce the cost of accessing large images and of allocating them. "
+                                       "This only applies to the images allocated after changing this parameter. "
+                                       "Hover each option with the mouse for a detailed description.") );
+    _cachingTab->addKnob(_hugePagesMode);
+
+    _prefaultImagesMemory = AppManager::createKnob<KnobBool>( this, tr("Pre-fault images memory") );
+    _prefaultImagesMemory->setName("prefaultImagesMemory");
+    _prefaultImagesMemory->setHintToolTip( tr("When checked, the memory of new large images is committed by the system as soon as "
+                                              "it is allocated instead of page by page while the image is rendered. The memory of the "
+                                              "images that are destroyed is kept for reuse by the next images.") );
+    _cachingTab->addKnob(_prefaultImagesMemory);
+
     _maxRAMPercent = AppManager::createKnob<KnobInt>( this, tr("Maximum amount of RAM memory used for caching (% of total RAM)") );
     _maxRAMPercent->setName("maxRAMPercent");
     _maxRAMPercent->disableSlider();
@@ -1291,6 +1450,17 @@ Settings::initializeKnobsCaching()
     _diskCachePath->setHintToolTip( diskCacheTt + QLatin1Char('\n') + diskCacheTt2 );
     _cachingTab->addKnob(_diskCachePath);
 
+    _sharedDiskCachePath = AppManager::createKnob<KnobPath>( this, tr("Shared disk cache path") );
+    _sharedDiskCachePath->setName("sharedDiskCachePath");
+    _sharedDiskCachePath->setMultiPath(false);
+    _sharedDiskCachePath->setHintToolTip( tr("Location of a second, larger tier of the on-disk caches, shared by several "
+                                             "computers, e.g on a network file system. Entries evicted from the disk cache are moved there, "
+                                             "and entries missing from the disk cache are looked up there, so that computers rendering the same "
+                                             "graph reuse each other's results. The viewer cache does not use it.\n"
+                                             "If the parameter is left empty, the shared disk cache is disabled. This parameter can be "
+                                             "overriden by the value of the environment variable %1.").arg( QString::fromUtf8(NATRON_SHARED_DISK_CACHE_PATH_ENV_VAR) ) );
+    _cachingTab->addKnob(_sharedDiskCachePath);
+
     _wipeDiskCache = AppManager::createKnob<KnobButton>( this, tr("Wipe Disk Cache") );
     _wipeDiskCache->setHintToolTip( tr("Cleans-up all caches, deleting all folders that may contain cached data. "
                                        "This is provided in case %1 lost track of cached images "
@@ -1457,17 +1627,22 @@ Settings::setDefaultValues()
 #endif
     _useThreadPool->setDefaultValue(true);
     _nThreadsPerEffect->setDefaultValue(0);
+    _autotuneThreadsPerEffect->setDefaultValue(true);
+    _numaAwareRendering->setDefaultValue(false);
     _renderInSeparateProcess->setDefaultValue(false, 0);
     _queueRenders->setDefaultValue(false);
+    _shareRenderPasses->setDefaultValue(true);
 
     // General/Rendering
     _convertNaNValues->setDefaultValue(true);
     _pluginUseImageCopyForSource->setDefaultValue(false);
     _activateRGBSupport->setDefaultValue(true);
     _activateTransformConcatenationSupport->setDefaultValue(true);
+    _hostTransformFilter->setDefaultValue( (int)eHostTransformFilterPlugin );
 
     // General/GPU rendering
     //_openglRendererString
+    _useAllOpenGLRenderers->setDefaultValue(false);
     _nOpenGLContexts->setDefaultValue(2);
 #if NATRON_VERSION_MAJOR < 2 || (NATRON_VERSION_MAJOR == 2 && NATRON_VERSION_MINOR < 2)
     _enableOpenGL->setDefaultValue((int)eEnableOpenGLDisabled);
@@ -1510,6 +1685,11 @@ Settings::setDefaultValues()
 
     // Caching
     _aggressiveCaching->setDefaultValue(false);
+    _compressCache->setDefaultValue(true);
+    _contentBasedNodeHash->setDefaultValue(false);
+    _viewerCacheAhead->setDefaultValue(false);
+    _hugePagesMode->setDefaultValue(0);
+    _prefaultImagesMemory->setDefaultValue(false);
     _maxRAMPercent->setDefaultValue(50, 0);
     _unreachableRAMPercent->setDefaultValue(5);
     _maxViewerDiskCacheGB->setDefaultValue(5, 0);
@@ -1532,6 +1712,8 @@ Settings::setDefaultValues()
     _autoWipe->setDefaultValue(true);
     _autoProxyWhenScrubbingTimeline->setDefaultValue(true);
     _autoProxyLevel->setDefaultValue(1);
+    _autoProxyRefinement->setDefaultValue(true);
+    _adaptivePlaybackQuality->setDefaultValue(true);
     _maximumNodeViewerUIOpened->setDefaultValue(2);
     _viewerKeys->setDefaultValue(true);
 
@@ -1541,6 +1723,7 @@ Settings::setDefaultValues()
     _snapNodesToConnections->setDefaultValue(true);
     _useBWIcons->setDefaultValue(false);
     _maxUndoRedoNodeGraph->setDefaultValue(20, 0);
+    _maxUndoRedoNodes->setDefaultValue(200, 0);
     _disconnectedArrowLength->setDefaultValue(30);
     _hideOptionalInputsAutomatically->setDefaultValue(true);
     _useInputAForMergeAutoConnect->setDefaultValue(true);
@@ -2134,6 +2317,9 @@ Settings::restoreSettings(bool useDefault)
         appPTR->setNThreadsPerEffect( getNumberOfThreadsPerEffect() );
         appPTR->setNThreadsToRender( getNumberOfThreads() );
         appPTR->setUseThreadPool( _useThreadPool->getValue() );
+        setNumaAwareRenderingEnabled( _numaAwareRendering->getValue() );
+        ImageBufferPool::setHugePagesMode( getImagesHugePagesMode() );
+        ImageBufferPool::setPrefaultEnabled( _prefaultImagesMemory->getValue() );
         appPTR->setPluginsUseInputImageCopyToRender( _pluginUseImageCopyForSource->getValue() );
     } catch (std::logic_error&) {
         // ignore
@@ -2261,6 +2447,14 @@ Settings::onKnobValueChanged(KnobI* k,
         if (!_restoringSettings) {
             appPTR->setApplicationsCachesMaximumDiskSpace( getMaximumDiskCacheNodeSize() );
         }
+    } else if ( k == _compressCache.get() ) {
+        if (!_restoringSettings) {
+            appPTR->setApplicationsCachesCompressionEnabled( isCacheCompressionEnabled() );
+        }
+    } else if ( k == _hugePagesMode.get() ) {
+        ImageBufferPool::setHugePagesMode( getImagesHugePagesMode() );
+    } else if ( k == _prefaultImagesMemory.get() ) {
+        ImageBufferPool::setPrefaultEnabled( _prefaultImagesMemory->getValue() );
     } else if ( k == _maxRAMPercent.get() ) {
         if (!_restoringSettings) {
             appPTR->setApplicationsCachesMaximumMemoryPercent( getRamMaximumPercent() );
@@ -2270,6 +2464,10 @@ Settings::onKnobValueChanged(KnobI* k,
         QString path = QString::fromUtf8(_diskCachePath->getValue().c_str());
         qputenv(NATRON_DISK_CACHE_PATH_ENV_VAR, path.toUtf8());
         appPTR->refreshDiskCacheLocation();
+    } else if ( k == _sharedDiskCachePath.get() ) {
+        QString path = QString::fromUtf8(_sharedDiskCachePath->getValue().c_str());
+        qputenv(NATRON_SHARED_DISK_CACHE_PATH_ENV_VAR, path.toUtf8());
+        appPTR->refreshSharedDiskCacheLocation();
     } else if ( k == _wipeDiskCache.get() ) {
         appPTR->wipeAndCreateDiskCacheStructure();
     } else if ( k == _numberOfThreads.get() ) {
@@ -2295,6 +2493,8 @@ Settings::onKnobValueChanged(KnobI* k,
     } else if ( k == _useThreadPool.get() ) {
         bool useTP = _useThreadPool->getValue();
         appPTR->setUseThreadPool(useTP);
+    } else if ( k == _numaAwareRendering.get() ) {
+        setNumaAwareRenderingEnabled( _numaAwareRendering->getValue() );
     } else if ( k == _customOcioConfigFile.get() ) {
         if ( _customOcioConfigFile->isEnabled(0) ) {
             tryLoadOpenColorIOConfig();
@@ -2409,6 +2609,8 @@ Settings::getViewersBitDepth() const
     if (v == 0) {
         return eImageBitDepthByte;
     } else if (v == 1) {
+        return eImageBitDepthHalf;
+    } else if (v == 2) {
         return eImageBitDepthFloat;
     } else {
         return eImageBitDepthByte;
@@ -2469,6 +2671,18 @@ Settings::getAutoProxyMipMapLevel() const
     return (unsigned int)_autoProxyLevel->getValue() + 1;
 }
 
+bool
+Settings::isAutoProxyRefinementEnabled() const
+{
+    return _autoProxyRefinement->getValue();
+}
+
+bool
+Settings::isAdaptivePlaybackQualityEnabled() const
+{
+    return _adaptivePlaybackQuality->getValue();
+}
+
 int
 Settings::getMaxOpenedNodesViewerContext() const
 {
@@ -2490,6 +2704,38 @@ Settings::isAggressiveCachingEnabled() const
     return _aggressiveCaching->getValue();
 }
 
+bool
+Settings::isCacheCompressionEnabled() const
+{
+    return _compressCache->getValue();
+}
+
+bool
+Settings::isContentBasedNodeHashEnabled() const
+{
+    return _contentBasedNodeHash->getValue();
+}
+
+bool
+Settings::isViewerCacheAheadEnabled() const
+{
+    return _viewerCacheAhead->getValue();
+}
+
+ImageBufferPool::HugePagesModeEnum
+Settings::getImagesHugePagesMode() const
+{
+    int v = _hugePagesMode->getValue();
+
+    if (v == 1) {
+        return ImageBufferPool::eHugePagesModeTransparent;
+    } else if (v == 2) {
+        return ImageBufferPool::eHugePagesModeExplicit;
+    } else {
+        return ImageBufferPool::eHugePagesModeNone;
+    }
+}
+
 double
 Settings::getRamMaximumPercent() const
 {
@@ -2528,6 +2774,40 @@ Settings::getNumberOfThreadsPerEffect() const
     return _nThreadsPerEffect->getValue();
 }
 
+bool
+Settings::isThreadsPerEffectAutotuned() const
+{
+    return _autotuneThreadsPerEffect->getValue();
+}
+
+void
+Settings::getThreadScalingHistories(std::map<std::string, std::string>* histories) const
+{
+    QSettings settings( QString::fromUtf8(NATRON_ORGANIZATION_NAME), QString::fromUtf8(NATRON_APPLICATION_NAME) );
+
+    settings.beginGroup( QString::fromUtf8(kQSettingsThreadScalingGroupName) );
+    QStringList pluginIDs = settings.childKeys();
+    for (QStringList::iterator it = pluginIDs.begin(); it != pluginIDs.end(); ++it) {
+        (*histories)[it->toStdString()] = settings.value(*it).toString().toStdString();
+    }
+    settings.endGroup();
+}
+
+void
+Settings::saveThreadScalingHistories(const std::map<std::string, std::string>& histories)
+{
+    if ( !_saveSettings->getValue() ) {
+        return;
+    }
+    QSettings settings( QString::fromUtf8(NATRON_ORGANIZATION_NAME), QString::fromUtf8(NATRON_APPLICATION_NAME) );
+
+    settings.beginGroup( QString::fromUtf8(kQSettingsThreadScalingGroupName) );
+    for (std::map<std::string, std::string>::const_iterator it = histories.begin(); it != histories.end(); ++it) {
+        settings.setValue( QString::fromUtf8( it->first.c_str() ), QString::fromUtf8( it->second.c_str() ) );
+    }
+    settings.endGroup();
+}
+
 int
 Settings::getNumberOfThreads() const
 {
@@ -2861,6 +3141,12 @@ Settings::getMaximumUndoRedoNodeGraph() const
     return _maxUndoRedoNodeGraph->getValue();
 }
 
+int
+Settings::getMaximumUndoRedoNodes() const
+{
+    return _maxUndoRedoNodes->getValue();
+}
+
 int
 Settings::getAutoSaveDelayMS() const
 {
@@ -3186,6 +3472,12 @@ Settings::isTransformConcatenationEnabled() const
     return _activateTransformConcatenationSupport->getValue();
 }
 
+Settings::HostTransformFilterEnum
+Settings::getHostTransformFilter() const
+{
+    return (HostTransformFilterEnum)_hostTransformFilter->getValue();
+}
+
 bool
 Settings::useGlobalThreadPool() const
 {
@@ -3805,6 +4097,12 @@ Settings::isRenderQueuingEnabled() const
     return _queueRenders->getValue();
 }
 
+bool
+Settings::isRenderPassSharingEnabled() const
+{
+    return _shareRenderPasses->getValue();
+}
+
 bool
 Settings::isFileDialogEnabledForNewWriters() const
 {
@@ -36,11 +36,13 @@
 
 #include "Engine/Knob.h"
 #include "Engine/ChoiceOption.h"
+#include "Engine/ImageBufferPool.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
 
 
 #define kQSettingsSoftwareMajorVersionSettingName "SoftwareVersionMajor"
+#define kQSettingsThreadScalingGroupName "ThreadScaling"
 
 NATRON_NAMESPACE_ENTER
 
@@ -88,6 +90,14 @@ public:
         eEnableOpenGLDisabledIfBackground,
     };
 
+    enum HostTransformFilterEnum
+    {
+        eHostTransformFilterPlugin = 0,
+        eHostTransformFilterBilinear,
+        eHostTransformFilterCubic,
+        eHostTransformFilterLanczos,
+    };
+
     Settings();
 
     virtual ~Settings()
@@ -125,6 +135,18 @@ public:
 
     int getNumberOfThreadsPerEffect() const;
 
+    /**
+     * @brief When the number of threads per effect is guessed, whether it is chosen for each plug-in from how its
+     * multi-thread suite calls scaled in the previous renders (see ThreadScalingHistory).
+     **/
+    bool isThreadsPerEffectAutotuned() const;
+
+    /**
+     * @brief The scaling history of each plug-in ID, serialized by ThreadScalingHistory::toString(). It is kept across sessions.
+     **/
+    void getThreadScalingHistories(std::map<std::string, std::string>* histories) const;
+    void saveThreadScalingHistories(const std::map<std::string, std::string>& histories);
+
     bool useGlobalThreadPool() const;
 
     void setUseGlobalThreadPool(bool use);
@@ -171,10 +193,14 @@ public:
 
     void setRenderQueuingEnabled(bool enabled);
 
+    bool isRenderPassSharingEnabled() const;
+
     void restoreDefault();
 
     int getMaximumUndoRedoNodeGraph() const;
 
+    int getMaximumUndoRedoNodes() const;
+
     int getAutoSaveDelayMS() const;
 
     bool isAutoSaveEnabledForUnsavedProjects() const;
@@ -251,6 +277,8 @@ public:
     bool isAutoWipeEnabled() const;
     bool isAutoProxyEnabled() const;
     unsigned int getAutoProxyMipMapLevel() const;
+    bool isAutoProxyRefinementEnabled() const;
+    bool isAdaptivePlaybackQualityEnabled() const;
     int getMaxOpenedNodesViewerContext() const;
     bool isViewerKeysEnabled() const;
     ///////////////////////////////////////////////////////
@@ -259,6 +287,12 @@ public:
 
     bool isTransformConcatenationEnabled() const;
 
+    /**
+     * @brief Returns the filter with which the host applies the concatenated transforms instead of the transform plug-in
+     * at the end of the chain, or eHostTransformFilterPlugin if the plug-in renders.
+     **/
+    HostTransformFilterEnum getHostTransformFilter() const;
+
     bool useInputAForMergeAutoConnect() const;
 
     /**
@@ -277,6 +311,14 @@ public:
 
     bool isAggressiveCachingEnabled() const;
 
+    bool isCacheCompressionEnabled() const;
+
+    bool isContentBasedNodeHashEnabled() const;
+
+    bool isViewerCacheAheadEnabled() const;
+
+    ImageBufferPool::HugePagesModeEnum getImagesHugePagesMode() const;
+
     bool isAutoTurboEnabled() const;
 
     void setAutoTurboModeEnabled(bool e);
@@ -378,6 +420,8 @@ public:
 
     int getMaxOpenGLContexts() const;
 
+    bool isMultiGPURenderingEnabled() const;
+
     bool isDriveLetterToUNCPathConversionEnabled() const;
 
 Q_SIGNALS:
@@ -438,9 +482,12 @@ private:
     KnobIntPtr _numberOfThreads;
     KnobIntPtr _numberOfParallelRenders;
     KnobBoolPtr _useThreadPool;
+    KnobBoolPtr _numaAwareRendering;
     KnobIntPtr _nThreadsPerEffect;
+    KnobBoolPtr _autotuneThreadsPerEffect;
     KnobBoolPtr _renderInSeparateProcess;
     KnobBoolPtr _queueRenders;
+    KnobBoolPtr _shareRenderPasses;
 
     // General/Rendering
     KnobPagePtr _renderingPage;
@@ -448,11 +495,13 @@ private:
     KnobBoolPtr _pluginUseImageCopyForSource;
     KnobBoolPtr _activateRGBSupport;
     KnobBoolPtr _activateTransformConcatenationSupport;
+    KnobChoicePtr _hostTransformFilter;
 
     // General/GPU rendering
     KnobPagePtr _gpuPage;
     KnobStringPtr _openglRendererString;
     KnobChoicePtr _availableOpenGLRenderers;
+    KnobBoolPtr _useAllOpenGLRenderers;
     KnobIntPtr _nOpenGLContexts;
     KnobChoicePtr _enableOpenGL;
 
@@ -499,6 +548,11 @@ private:
     // Caching
     KnobPagePtr _cachingTab;
     KnobBoolPtr _aggressiveCaching;
+    KnobBoolPtr _compressCache;
+    KnobBoolPtr _contentBasedNodeHash;
+    KnobBoolPtr _viewerCacheAhead;
+    KnobChoicePtr _hugePagesMode;
+    KnobBoolPtr _prefaultImagesMemory;
     ///The percentage of the value held by _maxRAMPercent to dedicate to playback cache (viewer cache's in-RAM portion) only
     KnobStringPtr _maxPlaybackLabel;
 
@@ -520,6 +574,7 @@ private:
     KnobIntPtr _maxViewerDiskCacheGB;
     KnobIntPtr _maxDiskCacheNodeGB;
     KnobPathPtr _diskCachePath;
+    KnobPathPtr _sharedDiskCachePath;
     KnobButtonPtr _wipeDiskCache;
 
     // Viewer
@@ -532,6 +587,8 @@ private:
     KnobBoolPtr _autoWipe;
     KnobBoolPtr _autoProxyWhenScrubbingTimeline;
     KnobChoicePtr _autoProxyLevel;
+    KnobBoolPtr _autoProxyRefinement;
+    KnobBoolPtr _adaptivePlaybackQuality;
     KnobIntPtr _maximumNodeViewerUIOpened;
     KnobBoolPtr _viewerKeys;
 
@@ -542,6 +599,7 @@ private:
     KnobBoolPtr _snapNodesToConnections;
     KnobBoolPtr _useBWIcons;
     KnobIntPtr _maxUndoRedoNodeGraph;
+    KnobIntPtr _maxUndoRedoNodes;
     KnobIntPtr _disconnectedArrowLength;
     KnobBoolPtr _hideOptionalInputsAutomatically;
     KnobBoolPtr _useInputAForMergeAutoConnect;
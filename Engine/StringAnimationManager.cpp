@@ -26,6 +26,7 @@
 #include "StringAnimationManager.h"
 
 #include <set>
+#include <map>
 #include <cmath>
 #include <cassert>
 #include <stdexcept>
@@ -59,6 +60,12 @@ struct StringKeyFrame_compare_time
 
 typedef std::set<StringKeyFrame, StringKeyFrame_compare_time> Keyframes;
 
+// Results of the plugin interpolation callback, indexed by time
+typedef std::map<double, std::string> InterpolationCache;
+
+// Above this many entries the cache is flushed rather than grown
+#define NATRON_STRING_INTERPOLATION_CACHE_MAX_SIZE 1024
+
 NATRON_NAMESPACE_ANONYMOUS_EXIT
 
 
@@ -68,6 +75,12 @@ struct StringAnimationManagerPrivate
     void* ofxParamHandle;
     mutable QMutex keyframesMutex;
     Keyframes keyframes;
+
+    // Protected by keyframesMutex. The age is incremented whenever the keyframes or the
+    // interpolation function change, so that a result computed while the mutex was released
+    // is not stored in the cache if it became stale in the meantime.
+    mutable InterpolationCache interpolationCache;
+    U64 keyframesAge;
     const KnobI* knob;
 
     StringAnimationManagerPrivate(const KnobI* knob)
@@ -75,9 +88,18 @@ struct StringAnimationManagerPrivate
         , ofxParamHandle(NULL)
         , keyframesMutex()
         , keyframes()
+        , interpolationCache()
+        , keyframesAge(0)
         , knob(knob)
     {
     }
+
+    // Must be called with keyframesMutex locked
+    void invalidateInterpolationCache()
+    {
+        interpolationCache.clear();
+        ++keyframesAge;
+    }
 };
 
 StringAnimationManager::StringAnimationManager(const KnobI* knob)
@@ -99,8 +121,11 @@ void
 StringAnimationManager::setCustomInterpolation(customParamInterpolationV1Entry_t func,
                                                void* ofxParamHandle)
 {
+    QMutexLocker l(&_imp->keyframesMutex);
+
     _imp->customInterpolation = func;
     _imp->ofxParamHandle = ofxParamHandle;
+    _imp->invalidateInterpolationCache();
 }
 
 bool
@@ -155,6 +180,15 @@ StringAnimationManager::customInterpolation(double time,
         --lower;
     }
 
+    ///the plug-in callback is expensive, return the value it gave the last time if nothing changed since
+    InterpolationCache::const_iterator cached = _imp->interpolationCache.find(time);
+    if ( cached != _imp->interpolationCache.end() ) {
+        *ret = cached->second;
+
+        return true;
+    }
+    U64 age = _imp->keyframesAge;
+
     OFX::Host::Property::PropSpec inArgsSpec[] = {
         { kOfxPropName,    OFX::Host::Property::eString, 1, true, "" },
         { kOfxPropTime,    OFX::Host::Property::eDouble, 1, true, "" },
@@ -185,6 +219,14 @@ StringAnimationManager::customInterpolation(double time,
 
     *ret = outArgs.getStringProperty(kOfxParamPropCustomValue, 0).c_str();
 
+    l.relock();
+    if (_imp->keyframesAge == age) {
+        if (_imp->interpolationCache.size() >= NATRON_STRING_INTERPOLATION_CACHE_MAX_SIZE) {
+            _imp->interpolationCache.clear();
+        }
+        _imp->interpolationCache.insert( std::make_pair(time, *ret) );
+    }
+
     return true;
 } // customInterpolation
 
@@ -205,6 +247,7 @@ StringAnimationManager::insertKeyFrame(double time,
         assert(ret.second);
     }
     *index = std::distance(_imp->keyframes.begin(), ret.first);
+    _imp->invalidateInterpolationCache();
 }
 
 void
@@ -215,6 +258,7 @@ StringAnimationManager::removeKeyFrame(double time)
     for (Keyframes::iterator it = _imp->keyframes.begin(); it != _imp->keyframes.end(); ++it) {
         if (it->time == time) {
             _imp->keyframes.erase(it);
+            _imp->invalidateInterpolationCache();
 
             return;
         }
@@ -227,6 +271,7 @@ StringAnimationManager::clearKeyFrames()
     QMutexLocker l(&_imp->keyframesMutex);
 
     _imp->keyframes.clear();
+    _imp->invalidateInterpolationCache();
 }
 
 void
@@ -267,6 +312,7 @@ StringAnimationManager::clone(const StringAnimationManager & other)
     QMutexLocker l2(&other._imp->keyframesMutex);
 
     _imp->keyframes = other._imp->keyframes;
+    _imp->invalidateInterpolationCache();
 }
 
 bool
@@ -290,6 +336,7 @@ StringAnimationManager::cloneAndCheckIfChanged(const StringAnimationManager & ot
     }
     if (hasChanged) {
         _imp->keyframes = other._imp->keyframes;
+        _imp->invalidateInterpolationCache();
     }
 
     return hasChanged;
@@ -316,6 +363,7 @@ StringAnimationManager::clone(const StringAnimationManager & other,
         k.value = it->value;
         _imp->keyframes.insert(k);
     }
+    _imp->invalidateInterpolationCache();
 }
 
 void
@@ -332,6 +380,7 @@ StringAnimationManager::load(const std::map<int, std::string> & keyframes)
         assert(ret.second);
         Q_UNUSED(ret);
     }
+    _imp->invalidateInterpolationCache();
 }
 
 void
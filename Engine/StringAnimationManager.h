@@ -59,6 +59,10 @@ public:
 
     void setCustomInterpolation(customParamInterpolationV1Entry_t func, void* ofxParamHandle);
 
+    /**
+     * @brief Returns the value interpolated at the given time by the plug-in. The result of the
+     * interpolation callback is cached per time until the keyframes change.
+     **/
     bool customInterpolation(double time, std::string* ret) const;
 
     void insertKeyFrame(double time, const std::string & v, double* index);
@@ -41,12 +41,25 @@
 
 NATRON_NAMESPACE_ENTER
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// 0 is never used so that an empty entry of the lookup cache never matches a holder
+boost::atomic<U64> nextHolderId(1);
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+TLSHolderBase::TLSHolderBase()
+    : _holderId( nextHolderId.fetch_add(1, boost::memory_order_relaxed) )
+{
+}
 
 AppTLS::AppTLS()
     : _objectMutex()
     , _object( new GLobalTLSObject() )
     , _spawnsMutex()
     , _spawns()
+    , _spawnsGeneration(0)
+    , _lookupCache()
 {
 }
 
@@ -115,6 +128,33 @@ AppTLS::softCopy(QThread* fromThread,
 
     QWriteLocker k(&_spawnsMutex);
     _spawns[toThread] = fromThread;
+    _spawnsGeneration.fetch_add(1, boost::memory_order_release);
+}
+
+boost::shared_ptr<void>
+AppTLS::getCachedTLSData(U64 holderId,
+                         U64 generation) const
+{
+    const LookupCacheEntry& entry = _lookupCache.localData().entries[holderId % NATRON_TLS_LOOKUP_CACHE_SIZE];
+
+    if ( (entry.holderId != holderId) || (entry.generation != generation) ) {
+        return boost::shared_ptr<void>();
+    }
+
+    // The weak pointer expires if the data was destroyed since it was cached
+    return entry.value.lock();
+}
+
+void
+AppTLS::setCachedTLSData(U64 holderId,
+                         U64 generation,
+                         const boost::shared_ptr<void>& value) const
+{
+    LookupCacheEntry& entry = _lookupCache.localData().entries[holderId % NATRON_TLS_LOOKUP_CACHE_SIZE];
+
+    entry.holderId = holderId;
+    entry.generation = generation;
+    entry.value = value;
 }
 
 void
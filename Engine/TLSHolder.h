@@ -59,11 +59,19 @@ public:
     // TODO: enable_shared_from_this
     // constructors should be privatized in any class that derives from boost::enable_shared_from_this<>
 
-    TLSHolderBase() {}
+    TLSHolderBase();
 
 public:
     virtual ~TLSHolderBase() {}
 
+    /**
+     * @brief Returns an identifier unique to this holder for the lifetime of the application
+     **/
+    U64 getHolderId() const
+    {
+        return _holderId;
+    }
+
 protected:
 
     /**
@@ -84,6 +92,10 @@ protected:
      * @brief Copy all the TLS from fromThread to toThread
      **/
     virtual void copyTLS(const QThread* fromThread, const QThread* toThread) const = 0;
+
+private:
+
+    U64 _holderId;
 };
 
 
@@ -106,6 +118,35 @@ class AppTLS
     //<spawned thread, spawner thread>
     typedef std::map<const QThread*, const QThread*> ThreadSpawnMap;
 
+    //This is the object in the ThreadStorage: each thread remembers the last TLS data it looked up on
+    //the holders, so that looking it up again does not take any lock
+    struct LookupCacheEntry
+    {
+        U64 holderId;
+        U64 generation;
+        boost::weak_ptr<void> value;
+
+        LookupCacheEntry()
+            : holderId(0)
+            , generation(0)
+            , value()
+        {
+        }
+    };
+
+    struct LookupCache
+    {
+        LookupCacheEntry entries[NATRON_TLS_LOOKUP_CACHE_SIZE];
+
+        //The value of _spawnsGeneration when this thread last found it was not in _spawns
+        U64 checkedSpawnsGeneration;
+
+        LookupCache()
+            : checkedSpawnsGeneration(0)
+        {
+        }
+    };
+
 public:
 
     AppTLS();
@@ -150,6 +191,18 @@ public:
      **/
     void cleanupTLSForThread();
 
+    /**
+     * @brief Returns the TLS data of the current thread for the given holder if it was cached with setCachedTLSData()
+     * with the same generation and it is still alive, or NULL otherwise. This does not take any lock.
+     **/
+    boost::shared_ptr<void> getCachedTLSData(U64 holderId, U64 generation) const;
+
+    /**
+     * @brief Remembers on the current thread the TLS data of the given holder. The generation must be bumped
+     * by the holder whenever the data of a thread is replaced or removed, so that the cached value is no longer returned.
+     **/
+    void setCachedTLSData(U64 holderId, U64 generation, const boost::shared_ptr<void>& value) const;
+
 private:
 
     template <typename T>
@@ -166,6 +219,11 @@ private:
     //of creating a new object and no longer mark it as spawned
     mutable QReadWriteLock _spawnsMutex;
     ThreadSpawnMap _spawns;
+
+    //Incremented after every insertion in _spawns, so that a thread that already checked it was not spawned
+    //does not look it up again under the lock until a new thread is spawned
+    boost::atomic<U64> _spawnsGeneration;
+    mutable ThreadStorage<LookupCache> _lookupCache;
 };
 
 
@@ -192,7 +250,10 @@ class TLSHolder
 public:
 
     TLSHolder()
-        : TLSHolderBase() {}
+        : TLSHolderBase()
+        , perThreadDataMutex()
+        , perThreadData()
+        , perThreadDataGeneration(0) {}
 
     virtual ~TLSHolder() {}
 
@@ -209,6 +270,9 @@ private:
     //Store a cache on the object to be faster than using the getOrCreate... function from AppTLS
     mutable QReadWriteLock perThreadDataMutex;
     mutable ThreadDataMap perThreadData;
+
+    //Incremented under the write lock when the data of a thread is replaced or removed to invalidate the lookup cache of AppTLS
+    mutable boost::atomic<U64> perThreadDataGeneration;
 };
 
 NATRON_NAMESPACE_EXIT
@@ -62,6 +62,8 @@ TLSHolder<EffectInstance::EffectTLSData>::copyAndReturnNewTLS(const QThread* fro
     //Copy constructor
     data.value = boost::make_shared<EffectInstance::EffectTLSData>( *(found->second.value) );
     perThreadData[toThread] = data;
+    //toThread may have cached the data it had before
+    perThreadDataGeneration.fetch_add(1, boost::memory_order_release);
 
     return data.value;
 }
@@ -122,6 +124,7 @@ TLSHolder<T>::cleanupPerThreadData(const QThread* curThread) const
     typename ThreadDataMap::iterator found = perThreadData.find(curThread);
     if ( found != perThreadData.end() ) {
         perThreadData.erase(found);
+        perThreadDataGeneration.fetch_add(1, boost::memory_order_release);
     }
 
     return perThreadData.empty();
@@ -140,6 +143,13 @@ TLSHolder<T>::getTLSData() const
         return ret;
     }
 
+    //Attempt to find the object cached on this thread by a previous look-up: this does not take any lock
+    AppTLS* appTLS = appPTR->getAppTLS();
+    U64 generation = perThreadDataGeneration.load(boost::memory_order_acquire);
+    ret = boost::static_pointer_cast<T>( appTLS->getCachedTLSData(getHolderId(), generation) );
+    if (ret) {
+        return ret;
+    }
 
     //Attempt to find an object in the map. It will be there if we already called getOrCreateTLSData() for this thread
     {
@@ -148,6 +158,8 @@ TLSHolder<T>::getTLSData() const
         typename ThreadDataMap::const_iterator found = perThreadDataCRef.find(curThread);
         if ( found != perThreadDataCRef.end() ) {
             ret = found->second.value;
+            //The generation cannot change while we hold the read lock
+            appTLS->setCachedTLSData( getHolderId(), perThreadDataGeneration.load(boost::memory_order_relaxed), ret );
         }
     }
 
@@ -167,14 +179,24 @@ TLSHolder<T>::getOrCreateTLSData() const
         return ret;
     }
 
+    //Attempt to find the object cached on this thread by a previous look-up: this does not take any lock
+    AppTLS* appTLS = appPTR->getAppTLS();
+    U64 generation = perThreadDataGeneration.load(boost::memory_order_acquire);
+    ret = boost::static_pointer_cast<T>( appTLS->getCachedTLSData(getHolderId(), generation) );
+    if (ret) {
+        return ret;
+    }
+
     //Attempt to find an object in the map. It will be there if we already called getOrCreateTLSData() for this thread
-    //Note that if present, this call is extremely fast as we do not block other threads
+    //Note that if present, this call is fast as we do not block other threads
     {
         QReadLocker k(&perThreadDataMutex);
         const ThreadDataMap& perThreadDataCRef = perThreadData; // take a const ref, since it's a read lock
         typename ThreadDataMap::const_iterator found = perThreadDataCRef.find(curThread);
         if ( found != perThreadDataCRef.end() ) {
             assert(found->second.value);
+            //The generation cannot change while we hold the read lock
+            appTLS->setCachedTLSData( getHolderId(), perThreadDataGeneration.load(boost::memory_order_relaxed), found->second.value );
 
             return found->second.value;
         }
@@ -183,11 +205,12 @@ TLSHolder<T>::getOrCreateTLSData() const
     //getOrCreateTLSData() has never been called on the thread, lookup the TLS
     ThreadData data;
     TLSHolderBaseConstPtr thisShared = shared_from_this();
-    appPTR->getAppTLS()->registerTLSHolder(thisShared);
+    appTLS->registerTLSHolder(thisShared);
     data.value = boost::make_shared<T>();
     {
         QWriteLocker k(&perThreadDataMutex);
         perThreadData.insert( std::make_pair(curThread, data) );
+        appTLS->setCachedTLSData( getHolderId(), perThreadDataGeneration.load(boost::memory_order_relaxed), data.value );
     }
     assert(data.value);
 
@@ -205,6 +228,14 @@ AppTLS::copyTLSFromSpawnerThread(const TLSHolderBase* holder,
     // 3) The spawner thread did not have TLS but was marked in the spawn map...
     // Either way: return a new object
 
+    assert( curThread == QThread::currentThread() );
+
+    // exit early without any lock if this thread already checked it was not spawned and no thread was spawned since
+    LookupCache& cache = _lookupCache.localData();
+    U64 spawnsGeneration = _spawnsGeneration.load(boost::memory_order_acquire);
+    if (cache.checkedSpawnsGeneration == spawnsGeneration) {
+        return boost::shared_ptr<T>();
+    }
 
     // first pass with a read lock to exit early without taking the write lock
     {
@@ -213,6 +244,8 @@ AppTLS::copyTLSFromSpawnerThread(const TLSHolderBase* holder,
         ThreadSpawnMap::const_iterator foundSpawned = spawnsCRef.find(curThread);
         if ( foundSpawned == spawnsCRef.end() ) {
             //This is not a spawned thread and it did not have TLS already
+            cache.checkedSpawnsGeneration = spawnsGeneration;
+
             return boost::shared_ptr<T>();
         }
     }
@@ -27,6 +27,12 @@
 
 #include <stdexcept>
 
+// ARB_half_float_pixel (core in OpenGL 3.0) is not part of the loader, but every implementation exposing
+// ARB_texture_float accepts it
+#ifndef GL_HALF_FLOAT_ARB
+#define GL_HALF_FLOAT_ARB 0x140B
+#endif
+
 NATRON_NAMESPACE_ENTER
 
 Texture::Texture(U32 target,
@@ -68,6 +74,14 @@ Texture::getRecommendedTexParametersForRGBAFloatTexture(int* format, int* intern
     *glType = GL_FLOAT;
 }
 
+void
+Texture::getRecommendedTexParametersForRGBAHalfTexture(int* format, int* internalFormat, int* glType)
+{
+    *format = GL_RGBA;
+    *internalFormat = GL_RGBA16F_ARB;
+    *glType = GL_HALF_FLOAT_ARB;
+}
+
 bool
 Texture::ensureTextureHasSize(const TextureRect& texRect,
                               const unsigned char* originalRAMBuffer)
@@ -76,6 +90,15 @@ Texture::ensureTextureHasSize(const TextureRect& texRect,
         return false;
     }
 
+    if ( (texRect.width() == w()) && (texRect.height() == h()) && !_textureRect.isNull() ) {
+        // The storage already has the right size: only the position of the texture in the image changed
+        // (e.g: the viewer was panned or a pooled texture is re-used). Do not re-specify the texture with
+        // glTexImage2D which makes the driver re-allocate it, the caller will upload with glTexSubImage2D.
+        _textureRect = texRect;
+
+        return false;
+    }
+
     GLProtectAttrib a(GL_ENABLE_BIT);
     glEnable(_target);
     glBindTexture (_target, _texID);
@@ -33,8 +33,11 @@
 #include <QtCore/QThread>
 #include <QtCore/QThreadPool>
 
+#include <boost/atomic.hpp>
+
 #include "Engine/AbortableRenderInfo.h"
 #include "Engine/Node.h"
+#include "Engine/NumaInfo.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -48,9 +51,22 @@ struct AbortableThreadPrivate
     AbortableRenderInfoWPtr abortInfo;
     EffectInstanceWPtr treeRoot;
     bool abortInfoValid;
+
+    // Incremented under abortInfoMutex whenever the abort info above changes
+    boost::atomic<U64> abortInfoGeneration;
+
+    // Copy of the abort info taken at abortInfoGeneration == cachedAbortInfoGeneration, only accessed by the thread itself
+    U64 cachedAbortInfoGeneration;
+    bool cachedAbortInfoValid;
+    bool cachedIsRenderResponseToUserInteraction;
+    AbortableRenderInfoPtr cachedAbortInfo;
+    EffectInstancePtr cachedTreeRoot;
     std::string currentActionName;
     NodeWPtr currentActionNode;
 
+    // True once the thread was bound to a NUMA node, only accessed by the thread itself
+    bool boundToNumaNode;
+
     AbortableThreadPrivate(QThread* thread)
         : thread(thread)
         , threadName()
@@ -59,8 +75,15 @@ struct AbortableThreadPrivate
         , abortInfo()
         , treeRoot()
         , abortInfoValid(false)
+        , abortInfoGeneration(0)
+        , cachedAbortInfoGeneration(0)
+        , cachedAbortInfoValid(false)
+        , cachedIsRenderResponseToUserInteraction(false)
+        , cachedAbortInfo()
+        , cachedTreeRoot()
         , currentActionName()
         , currentActionNode()
+        , boundToNumaNode(false)
     {
     }
 };
@@ -128,12 +151,21 @@ AbortableThread::setAbortInfo(bool isRenderResponseToUserInteraction,
                               const AbortableRenderInfoPtr& abortInfo,
                               const EffectInstancePtr& treeRoot)
 {
+    // Bind the thread to a NUMA node the first time it renders so that the images it allocates
+    // stay local to the CPUs processing them
+    if ( !_imp->boundToNumaNode && isNumaAwareRenderingEnabled() && (QThread::currentThread() == _imp->thread) ) {
+        _imp->boundToNumaNode = true;
+        if (getNumaNodesCount() > 1) {
+            bindCurrentThreadToNumaNode( getNextNumaNodeForThread() );
+        }
+    }
     {
         QMutexLocker k(&_imp->abortInfoMutex);
         _imp->isRenderResponseToUserInteraction = isRenderResponseToUserInteraction;
         _imp->abortInfo = abortInfo;
         _imp->treeRoot = treeRoot;
         _imp->abortInfoValid = true;
+        _imp->abortInfoGeneration.fetch_add(1, boost::memory_order_release);
     }
     if (abortInfo) {
         abortInfo->registerThreadForRender(this);
@@ -150,6 +182,14 @@ AbortableThread::clearAbortInfo()
         _imp->abortInfo.reset();
         _imp->treeRoot.reset();
         _imp->abortInfoValid = false;
+        _imp->abortInfoGeneration.fetch_add(1, boost::memory_order_release);
+    }
+
+    // Do not keep the render alive with the copy held by the thread
+    if (QThread::currentThread() == _imp->thread) {
+        _imp->cachedAbortInfoValid = false;
+        _imp->cachedAbortInfo.reset();
+        _imp->cachedTreeRoot.reset();
     }
 
     if (abortInfo) {
@@ -174,6 +214,55 @@ AbortableThread::getAbortInfo(bool* isRenderResponseToUserInteraction,
     return true;
 }
 
+bool
+AbortableThread::getAbortInfoForCurrentThread(bool* isRenderResponseToUserInteraction,
+                                              const AbortableRenderInfoPtr** abortInfo,
+                                              const EffectInstancePtr** treeRoot) const
+{
+    assert(QThread::currentThread() == _imp->thread);
+
+    U64 generation = _imp->abortInfoGeneration.load(boost::memory_order_acquire);
+    if (generation != _imp->cachedAbortInfoGeneration) {
+        // The abort info changed since the last call: take a new copy
+        QMutexLocker k(&_imp->abortInfoMutex);
+        _imp->cachedAbortInfoGeneration = _imp->abortInfoGeneration.load(boost::memory_order_relaxed);
+        _imp->cachedAbortInfoValid = _imp->abortInfoValid;
+        _imp->cachedIsRenderResponseToUserInteraction = _imp->isRenderResponseToUserInteraction;
+        _imp->cachedAbortInfo = _imp->abortInfo.lock();
+        _imp->cachedTreeRoot = _imp->treeRoot.lock();
+    }
+
+    if (!_imp->cachedAbortInfoValid) {
+        return false;
+    }
+    *isRenderResponseToUserInteraction = _imp->cachedIsRenderResponseToUserInteraction;
+    *abortInfo = &_imp->cachedAbortInfo;
+    *treeRoot = &_imp->cachedTreeRoot;
+
+    return true;
+}
+
+ThreadPoolWaitScope::ThreadPoolWaitScope(QThread* thread)
+    : _released(false)
+{
+#ifdef QT_CUSTOM_THREADPOOL
+    AbortableThread* isAbortable = dynamic_cast<AbortableThread*>(thread);
+    _released = isAbortable && isAbortable->isThreadPoolThread();
+#else
+    Q_UNUSED(thread);
+#endif
+    if (_released) {
+        QThreadPool::globalInstance()->releaseThread();
+    }
+}
+
+ThreadPoolWaitScope::~ThreadPoolWaitScope()
+{
+    if (_released) {
+        QThreadPool::globalInstance()->reserveThread();
+    }
+}
+
 // We patched Qt to be able to derive QThreadPool to control the threads that are spawned to improve performances
 // of the EffectInstance::aborted() function
 #ifdef QT_CUSTOM_THREADPOOL
@@ -73,6 +73,16 @@ public:
                       AbortableRenderInfoPtr* abortInfo,
                       EffectInstancePtr* treeRoot) const;
 
+    /**
+     * @brief Same as getAbortInfo() but must be called from this thread: the returned pointers reference a copy of the abort info
+     * held by the thread, which is only refreshed after setAbortInfo() or clearAbortInfo() were called, so that polling
+     * the abort state does not take any lock nor touch any reference count shared with the other render threads.
+     * The pointers are valid until the next call on this thread.
+     **/
+    bool getAbortInfoForCurrentThread(bool* isRenderResponseToUserInteraction,
+                                      const AbortableRenderInfoPtr** abortInfo,
+                                      const EffectInstancePtr** treeRoot) const;
+
     // For debug purposes, so that the debugger can display the thread name
     void setThreadName(const std::string& threadName);
 
@@ -115,6 +125,35 @@ private:
         } \
     } \
 
+/**
+ * @brief Priorities given to the runnables started on the global thread pool: queued runnables with a higher priority are dequeued first.
+ * Tasks started without a priority (e.g: QtConcurrent tiles) have eThreadPoolPriorityDefault.
+ **/
+enum ThreadPoolPriorityEnum
+{
+    eThreadPoolPriorityBackground = -1, //< Frames of a render on disk or of a cache pre-render
+    eThreadPoolPriorityDefault = 0, //< Viewer playback and anything queued with no explicit priority
+    eThreadPoolPriorityViewerCurrentFrame = 1 //< Current frame renders of the viewer, in response to user interaction
+};
+
+/**
+ * @brief To be created by a thread of the global thread pool before it blocks waiting for tasks it queued on that same pool:
+ * the thread is released from the pool while it waits so that another thread may run the tasks instead of leaving a core idle.
+ * This has no effect on threads that are not thread pool threads, which can only be told apart with QT_CUSTOM_THREADPOOL.
+ **/
+class ThreadPoolWaitScope
+{
+public:
+
+    ThreadPoolWaitScope(QThread* thread);
+
+    ~ThreadPoolWaitScope();
+
+private:
+
+    bool _released;
+};
+
 // We patched Qt to be able to derive QThreadPool to control the threads that are spawned to improve performances
 // of the EffectInstance::aborted() function. This is done by enabling QThreadPoolThread* to derive AbortableThread.
 #ifdef QT_CUSTOM_THREADPOOL
@@ -33,11 +33,15 @@
 
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
 
 #include "Global/GlobalDefines.h"
 
 #define NATRON_FPS_REFRESH_RATE_SECONDS 1.5
 
+// Time before a frame is due during which Timer::waitUntilNextFrameIsDue() yields instead of sleeping
+#define NATRON_TIMER_SPIN_SECONDS 0.002
+
 NATRON_NAMESPACE_ENTER
 
 #if defined(__NATRON_WIN32__) && !defined(__NATRON_MINGW__)
@@ -128,19 +132,46 @@ Timer::printAsTime(const double timeInSeconds,
 Timer::Timer ()
     : playState (ePlayStateRunning),
     _spf (1 / 24.0),
-    _timingError (0),
+    _clock(),
+    _nextFrameDeadline (0),
+    _lastFpsFrameTime (0),
     _framesSinceLastFpsFrame (0),
     _actualFrameRate (0),
+    _droppedFrames (0),
     _mutex()
 {
-    gettimeofday (&_lastFrameTime, 0);
-    _lastFpsFrameTime = _lastFrameTime;
+    _clock.start();
 }
 
 Timer::~Timer()
 {
 }
 
+static double
+elapsedSeconds(const QElapsedTimer& clock)
+{
+    return clock.nsecsElapsed() * 1e-9;
+}
+
+void
+Timer::restart ()
+{
+    _nextFrameDeadline = elapsedSeconds(_clock);
+    _lastFpsFrameTime = _nextFrameDeadline;
+    _framesSinceLastFpsFrame = 0;
+
+    QMutexLocker l(&_mutex);
+    _droppedFrames = 0;
+}
+
+int
+Timer::getDroppedFramesCount() const
+{
+    QMutexLocker l(&_mutex);
+
+    return _droppedFrames;
+}
+
 void
 Timer::waitUntilNextFrameIsDue ()
 {
@@ -150,10 +181,7 @@ Timer::waitUntilNextFrameIsDue ()
         // variables and return without waiting.
         //
 
-        gettimeofday (&_lastFrameTime, 0);
-        _timingError = 0;
-        _lastFpsFrameTime = _lastFrameTime;
-        _framesSinceLastFpsFrame = 0;
+        restart();
 
         return;
     }
@@ -164,19 +192,29 @@ Timer::waitUntilNextFrameIsDue ()
         QMutexLocker l(&_mutex);
         spf = _spf;
     }
+
+    double now = elapsedSeconds(_clock);
+
     //
-    // If less than _spf seconds have passed since the last frame
-    // was displayed, sleep until exactly _spf seconds have gone by.
+    // If we are more than a frame late, the frames that could not be
+    // displayed on time are dropped: restart the schedule from now rather
+    // than displaying the next frames in a burst to catch up.
     //
-    timeval now;
-    gettimeofday (&now, 0);
-
-    double timeSinceLastFrame =  now.tv_sec  - _lastFrameTime.tv_sec +
-                                (now.tv_usec - _lastFrameTime.tv_usec) * 1e-6f;
-    if (timeSinceLastFrame < 0) {
-        timeSinceLastFrame = 0;
+    if (now > _nextFrameDeadline + spf) {
+        int droppedFrames = (int)std::floor( (now - _nextFrameDeadline) / spf );
+        {
+            QMutexLocker l(&_mutex);
+            _droppedFrames += droppedFrames;
+        }
+        _nextFrameDeadline = now;
     }
-    double timeToSleep = spf - timeSinceLastFrame - _timingError;
+
+    //
+    // Sleep until shortly before the frame is due, then yield until it is
+    // exactly due: sleeping is only accurate to a few milliseconds (more on
+    // Windows), which makes frames alternately early and late (judder).
+    //
+    double timeToSleep = _nextFrameDeadline - now - NATRON_TIMER_SPIN_SECONDS;
 
     #ifdef _WIN32
 
@@ -189,43 +227,30 @@ Timer::waitUntilNextFrameIsDue ()
     if (timeToSleep > 0) {
         timespec ts;
         ts.tv_sec = (time_t) timeToSleep;
-        ts.tv_nsec = (long) ( (timeToSleep - ts.tv_sec) * 1e9f );
+        ts.tv_nsec = (long) ( (timeToSleep - ts.tv_sec) * 1e9 );
         nanosleep (&ts, 0);
     }
 
     #endif
 
-    //
-    // If we slept, it is possible that we woke up a little too early
-    // or a little too late.  Keep track of the difference between
-    // now and the exact time when we wanted to wake up; next time
-    // we'll try sleep that much longer or shorter.  This should
-    // keep our average frame rate close to one fame every _spf seconds.
-    //
-
-    gettimeofday (&now, 0);
-
-    timeSinceLastFrame =  now.tv_sec  - _lastFrameTime.tv_sec +
-                         (now.tv_usec - _lastFrameTime.tv_usec) * 1e-6f;
-
-    _timingError += timeSinceLastFrame - spf;
-
-    if (_timingError < -2 * spf) {
-        _timingError = -2 * spf;
+    now = elapsedSeconds(_clock);
+    while (now < _nextFrameDeadline) {
+        QThread::yieldCurrentThread();
+        now = elapsedSeconds(_clock);
     }
 
-    if (_timingError >  2 * spf) {
-        _timingError =  2 * spf;
-    }
-
-    _lastFrameTime = now;
+    //
+    // The deadlines are exactly spf apart, whatever the time at which we
+    // actually woke up: the average frame rate stays at one frame every
+    // spf seconds without having to track the timing error.
+    //
+    _nextFrameDeadline += spf;
 
     //
     // Calculate our actual frame rate, averaged over several frames.
     //
 
-    double t =  now.tv_sec  - _lastFpsFrameTime.tv_sec +
-               (now.tv_usec - _lastFpsFrameTime.tv_usec) * 1e-6f;
+    double t = now - _lastFpsFrameTime;
 
     if (t > NATRON_FPS_REFRESH_RATE_SECONDS) {
         double actualFrameRate = _framesSinceLastFpsFrame / t;
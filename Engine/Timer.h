@@ -44,6 +44,7 @@
 #include <QtCore/QString>
 #include <QtCore/QObject>
 #include <QtCore/QMutex>
+#include <QtCore/QElapsedTimer>
 
 #include "Engine/EngineFwd.h"
 
@@ -80,14 +81,24 @@ public:
     // waitUntilNextFrameIsDue() before displaying each frame.
     //
     // If playState == ePlayStateRunning, then waitUntilNextFrameIsDue()
-    // sleeps until the appropriate amount of time has elapsed
-    // since the last call to waitUntilNextFrameIsDue().
+    // waits until the next frame is due. Frames are due at regular
+    // intervals since the last call to restart(), so that the timing
+    // errors of each wait do not accumulate. If a frame is more than one
+    // frame late, the frames that could not be shown on time are counted
+    // as dropped and the schedule restarts from the current time.
     // If playState != ePlayStateRunning, then waitUntilNextFrameIsDue()
     // returns immediately.
     //--------------------------------------------------------
 
     void    waitUntilNextFrameIsDue ();
 
+    // Resets the schedule, the first frame is then due immediately, and
+    // the count of dropped frames. Call it when playback starts.
+    void    restart ();
+
+    // Number of frames dropped since the last call to restart()
+    int getDroppedFramesCount() const;
+
 
     //-------------------------------------------------
     // Set and get the frame rate, in frames per second
@@ -113,13 +124,13 @@ private:
 
     double _spf;                 // desired frame rate,
     // in seconds per frame
-    timeval _lastFrameTime;         // time when we displayed the
-    // last frame
-    double _timingError;             // cumulative timing error
-    timeval _lastFpsFrameTime;      // state to keep track of the
+    QElapsedTimer _clock;           // monotonic clock all the times below refer to
+    double _nextFrameDeadline;      // time at which the next frame is due
+    double _lastFpsFrameTime;       // state to keep track of the
     int _framesSinceLastFpsFrame;       // actual frame rate, averaged
     double _actualFrameRate;         // over several frames
-    mutable QMutex _mutex; //< protects _spf and _actualFrameRate
+    int _droppedFrames;             // frames dropped since restart()
+    mutable QMutex _mutex; //< protects _spf, _actualFrameRate and _droppedFrames
 };
 
 
@@ -33,6 +33,8 @@ CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QWaitCondition>
 #include <QtCore/QThread>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QAtomicInt>
+#include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
@@ -54,6 +56,14 @@ CLANG_DIAG_ON(uninitialized)
 
 #define NATRON_TRACKER_REPORT_PROGRESS_DELTA_MS 200
 
+// Search windows of different tracks are prefetched in a single render if their bounding box is at most
+// that many times larger than the sum of their areas
+#define NATRON_TRACKER_PREFETCH_MERGE_MAX_AREA_RATIO 2.
+
+// Search windows of different tracks are redrawn as a single area on the viewer if their bounding box is not
+// larger than the sum of their areas
+#define NATRON_TRACKER_REDRAW_MERGE_MAX_AREA_RATIO 1.
+
 NATRON_NAMESPACE_ENTER
 
 
@@ -843,6 +853,10 @@ TrackerContext::exportTrackDataFromExportOptions()
     thisNode->getSize(&thisNodeSize[0], &thisNodeSize[1]);
     createdNode->setPosition(thisNodePos[0] + thisNodeSize[0] * 2., thisNodePos[1]);
 
+    // Evaluate the exported node once when all its parameters are set rather than after each of them
+    EffectInstancePtr createdEffect = createdNode->getEffectInstance();
+    createdEffect->beginChanges();
+
     int timeForFromPoints = getTransformReferenceFrame();
 
 
@@ -980,6 +994,8 @@ TrackerContext::exportTrackDataFromExportOptions()
             }
         }
     }
+
+    createdEffect->endChanges();
 } // TrackerContext::exportTrackDataFromExportOptions
 
 void
@@ -1679,10 +1695,49 @@ TrackArgs::getEnabledChannels(bool* r,
     _imp->fa->getEnabledChannels(r, g, b);
 }
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// A group of search windows rendered together and the sum of their areas
+struct SearchAreaCluster
+{
+    RectD bbox;
+    double areasSum;
+};
+
+// Merges the clusters whose bounding box is at most maxAreaRatio times larger than the sum of their areas
+void
+mergeSearchAreaClusters(double maxAreaRatio,
+                        std::vector<SearchAreaCluster>* clusters)
+{
+    bool merged = true;
+
+    while (merged) {
+        merged = false;
+        for (std::size_t i = 0; i < clusters->size() && !merged; ++i) {
+            for (std::size_t j = i + 1; j < clusters->size(); ++j) {
+                RectD bbox = (*clusters)[i].bbox;
+                bbox.merge( (*clusters)[j].bbox );
+                double areasSum = (*clusters)[i].areasSum + (*clusters)[j].areasSum;
+                if (bbox.area() <= maxAreaRatio * areasSum) {
+                    (*clusters)[i].bbox = bbox;
+                    (*clusters)[i].areasSum = areasSum;
+                    clusters->erase(clusters->begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 void
 TrackArgs::getRedrawAreasNeeded(int time,
                                 std::list<RectD>* canonicalRects) const
 {
+    std::vector<SearchAreaCluster> clusters;
+
     for (std::vector<TrackMarkerAndOptionsPtr>::const_iterator it = _imp->tracks.begin(); it != _imp->tracks.end(); ++it) {
         if ( !(*it)->natronMarker->isEnabled(time) ) {
             continue;
@@ -1704,24 +1759,105 @@ TrackArgs::getRedrawAreasNeeded(int time,
         topRight.x = searchTopRight->getValueAtTime(time, 0) + center.x + offset.x;
         topRight.y = searchTopRight->getValueAtTime(time, 1) + center.y + offset.y;
 
-        RectD rect;
-        rect.x1 = btmLeft.x;
-        rect.y1 = btmLeft.y;
-        rect.x2 = topRight.x;
-        rect.y2 = topRight.y;
-        canonicalRects->push_back(rect);
+        SearchAreaCluster c;
+        c.bbox.x1 = btmLeft.x;
+        c.bbox.y1 = btmLeft.y;
+        c.bbox.x2 = topRight.x;
+        c.bbox.y2 = topRight.y;
+        c.areasSum = c.bbox.area();
+        clusters.push_back(c);
+    }
+
+    // Overlapping search windows are redrawn as a single area so that the overlap is not rendered several times
+    mergeSearchAreaClusters(NATRON_TRACKER_REDRAW_MERGE_MAX_AREA_RATIO, &clusters);
+    for (std::vector<SearchAreaCluster>::const_iterator it = clusters.begin(); it != clusters.end(); ++it) {
+        canonicalRects->push_back(it->bbox);
     }
 }
 
+const TrackerFrameAccessorPtr&
+TrackArgs::getFrameAccessor() const
+{
+    return _imp->fa;
+}
+
+bool
+TrackArgs::getSearchAreasToPrefetch(int time,
+                                    int nextTime,
+                                    std::vector<RectI>* rois) const
+{
+    std::vector<SearchAreaCluster> clusters;
+
+    for (std::vector<TrackMarkerAndOptionsPtr>::const_iterator it = _imp->tracks.begin(); it != _imp->tracks.end(); ++it) {
+        // TrackMarkerPM does not use the frame accessor
+        if ( dynamic_cast<TrackMarkerPM*>( (*it)->natronMarker.get() ) || !(*it)->natronMarker->isEnabled(nextTime) ) {
+            continue;
+        }
+        KnobDoublePtr searchBtmLeft = (*it)->natronMarker->getSearchWindowBottomLeftKnob();
+        KnobDoublePtr searchTopRight = (*it)->natronMarker->getSearchWindowTopRightKnob();
+        KnobDoublePtr centerKnob = (*it)->natronMarker->getCenterKnob();
+        KnobDoublePtr offsetKnob = (*it)->natronMarker->getOffsetKnob();
+        Point center;
+        center.x = centerKnob->getValueAtTime(time, 0) + offsetKnob->getValueAtTime(time, 0);
+        center.y = centerKnob->getValueAtTime(time, 1) + offsetKnob->getValueAtTime(time, 1);
+
+        RectD rect;
+        rect.x1 = searchBtmLeft->getValueAtTime(time, 0) + center.x;
+        rect.y1 = searchBtmLeft->getValueAtTime(time, 1) + center.y;
+        rect.x2 = searchTopRight->getValueAtTime(time, 0) + center.x;
+        rect.y2 = searchTopRight->getValueAtTime(time, 1) + center.y;
+
+        // The marker cannot move by more than half its search window between 2 steps
+        double padX = rect.width() / 2.;
+        double padY = rect.height() / 2.;
+        rect.x1 -= padX;
+        rect.y1 -= padY;
+        rect.x2 += padX;
+        rect.y2 += padY;
+
+        if ( rect.isNull() ) {
+            continue;
+        }
+        SearchAreaCluster c;
+        c.bbox = rect;
+        c.areasSum = rect.area();
+        clusters.push_back(c);
+    }
+    if ( clusters.empty() ) {
+        return false;
+    }
+
+    // Group the search windows whose bounding box is not much larger than themselves, so that close markers
+    // are rendered in a single request without rendering the empty space between distant ones
+    mergeSearchAreaClusters(NATRON_TRACKER_PREFETCH_MERGE_MAX_AREA_RATIO, &clusters);
+
+    for (std::vector<SearchAreaCluster>::const_iterator it = clusters.begin(); it != clusters.end(); ++it) {
+        // libmv regions are in canonical coordinates, rounded to the closest pixel
+        RectI roi;
+        it->bbox.toPixelEnclosing(0, 1., &roi);
+        roi.x1 -= 1;
+        roi.y1 -= 1;
+        roi.x2 += 1;
+        roi.y2 += 1;
+        rois->push_back(roi);
+    }
+
+    return true;
+} // TrackArgs::getSearchAreasToPrefetch
+
 struct TrackSchedulerPrivate
 {
     TrackerParamsProvider* paramsProvider;
     NodeWPtr node;
 
+    // Set while a viewer render requested by the tracking thread has not been processed by the main thread yet
+    QAtomicInt viewerRenderPending;
+
     TrackSchedulerPrivate(TrackerParamsProvider* paramsProvider,
                           const NodeWPtr& node)
         : paramsProvider(paramsProvider)
         , node(node)
+        , viewerRenderPending(0)
     {
     }
 
@@ -1883,7 +2019,29 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
         }
 
 
+        // Images prefetched in the frame accessor for the frame being tracked (it is likely the reference frame of the next step)
+        // and for the previous one
+        const TrackerFrameAccessorPtr& frameAccessor = args->getFrameAccessor();
+        std::vector<mv::FrameAccessor::Key> curPrefetchedImages;
+        std::vector<mv::FrameAccessor::Key> prevPrefetchedImages;
+
         while (cur != end) {
+            frameAccessor->setTrackedFrame(cur, frameStep);
+
+            // While the tracks are solved at cur, render the areas they will search in at the next frame
+            // so that libmv finds them in the frame accessor's cache at the next step.
+            const int next = cur + frameStep;
+            QFuture<mv::FrameAccessor::Key> prefetchFuture;
+            std::vector<RectI> prefetchRoIs;
+            const bool doPrefetch = (next != end) && args->getSearchAreasToPrefetch(cur, next, &prefetchRoIs);
+            if (doPrefetch) {
+                prefetchFuture = QtConcurrent::mapped( prefetchRoIs,
+                                                       boost::bind(&TrackerFrameAccessor::prefetchImage,
+                                                                   frameAccessor.get(),
+                                                                   next,
+                                                                   _1) );
+            }
+
             ///Launch parallel thread for each track using the global thread pool
             QFuture<bool> future = QtConcurrent::mapped( trackIndexes,
                                                          boost::bind(&TrackSchedulerPrivate::trackStepFunctor,
@@ -1892,6 +2050,20 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
                                                                      cur) );
             future.waitForFinished();
 
+            for (std::size_t i = 0; i < prevPrefetchedImages.size(); ++i) {
+                frameAccessor->ReleaseImage(prevPrefetchedImages[i]);
+            }
+            prevPrefetchedImages.swap(curPrefetchedImages);
+            curPrefetchedImages.clear();
+            if (doPrefetch) {
+                prefetchFuture.waitForFinished();
+                for (QFuture<mv::FrameAccessor::Key>::const_iterator it = prefetchFuture.begin(); it != prefetchFuture.end(); ++it) {
+                    if (*it) {
+                        curPrefetchedImages.push_back(*it);
+                    }
+                }
+            }
+
             allTrackFailed = true;
             for (QFuture<bool>::const_iterator it = future.begin(); it != future.end(); ++it) {
                 if ( (*it) ) {
@@ -1922,8 +2094,6 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
                 progress = (double)(start - cur) / framesCount;
             }
 
-            bool isUpdateViewerOnTrackingEnabled = _imp->paramsProvider->getUpdateViewer();
-            bool isCenterViewerEnabled = _imp->paramsProvider->getCenterOnTrack();
             bool enoughTimePassedToReportProgress;
             {
                 timeval now;
@@ -1938,17 +2108,20 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
             }
 
 
-            ///Ok all tracks are finished now for this frame, refresh viewer if needed
-            if (isUpdateViewerOnTrackingEnabled && viewer) {
+            ///Ok all tracks are finished now for this frame, refresh viewer if needed.
+            ///The GUI is only updated every NATRON_TRACKER_REPORT_PROGRESS_DELTA_MS so that it does not slow down
+            ///the tracking of fast shots: the timeline is seeked to the last valid frame once tracking is done.
+            if (enoughTimePassedToReportProgress && viewer && _imp->paramsProvider->getUpdateViewer()) {
                 //This will not refresh the viewer since when tracking, renderCurrentFrame()
                 //is not called on viewers, see Gui::onTimeChanged
                 timeline->seekFrame(cur, true, 0, eTimelineChangeReasonOtherSeek);
 
-                if (enoughTimePassedToReportProgress) {
+                // Do not queue another render while the main thread has not processed the previous one
+                if ( _imp->viewerRenderPending.testAndSetAcquire(0, 1) ) {
                     if (doPartialUpdates) {
                         std::list<RectD> updateRects;
                         args->getRedrawAreasNeeded(cur, &updateRects);
-                        viewer->setPartialUpdateParams(updateRects, isCenterViewerEnabled);
+                        viewer->setPartialUpdateParams( updateRects, _imp->paramsProvider->getCenterOnTrack() );
                     } else {
                         viewer->clearPartialUpdateParams();
                     }
@@ -1967,6 +2140,13 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
                 break;
             }
         } // while (cur != end) {
+
+        for (std::size_t i = 0; i < prevPrefetchedImages.size(); ++i) {
+            frameAccessor->ReleaseImage(prevPrefetchedImages[i]);
+        }
+        for (std::size_t i = 0; i < curPrefetchedImages.size(); ++i) {
+            frameAccessor->ReleaseImage(curPrefetchedImages[i]);
+        }
     } // IsTrackingFlagSetter_RAII
     TrackerContext* isContext = dynamic_cast<TrackerContext*>(_imp->paramsProvider);
     if (isContext) {
@@ -2010,6 +2190,7 @@ void
 TrackScheduler::doRenderCurrentFrameForViewer(ViewerInstance* viewer)
 {
     assert( QThread::currentThread() == qApp->thread() );
+    _imp->viewerRenderPending.fetchAndStoreRelease(0);
     viewer->renderCurrentFrame(true);
 }
 
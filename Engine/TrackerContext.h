@@ -481,6 +481,16 @@ public:
 
     void getRedrawAreasNeeded(int time, std::list<RectD>* canonicalRects) const;
 
+    const TrackerFrameAccessorPtr& getFrameAccessor() const;
+
+    /**
+     * @brief Returns in rois the pixel areas of nextTime enclosing the search windows of all the enabled libmv tracks,
+     * as they are known at time, padded by half a search window in each direction to cover the motion of one step.
+     * Close search windows are grouped in a single area so that they can be rendered in one request.
+     * Returns false if no track would fetch an image from the frame accessor.
+     **/
+    bool getSearchAreasToPrefetch(int time, int nextTime, std::vector<RectI>* rois) const;
+
 private:
 
     boost::scoped_ptr<TrackArgsPrivate> _imp;
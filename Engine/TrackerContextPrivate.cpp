@@ -35,6 +35,7 @@
 
 #include "Engine/AppInstance.h"
 #include "Engine/Curve.h"
+#include "Engine/Hash64.h"
 #include "Engine/Project.h"
 #include "Engine/TimeLine.h"
 #include "Engine/KnobTypes.h"
@@ -1172,7 +1173,8 @@ TrackerContext::trackMarkers(const std::list<TrackMarkerPtr>& markers,
 
     bool autoKeyingOnEnabledParamEnabled = _imp->autoKeyEnabled.lock()->getValue();
     
-    /// The accessor and its cache is local to a track operation, it is wiped once the whole sequence track is finished.
+    /// The accessor is local to a track operation. Its cache is shared with the other trackers tracking the same input at the same time
+    /// and is wiped once none of them is tracking anymore.
     TrackerFrameAccessorPtr accessor( new TrackerFrameAccessor(this, enabledChannels, formatHeight) );
     mv::AutoTrackPtr trackContext( new mv::AutoTrack( accessor.get() ) );
     std::vector<TrackMarkerAndOptionsPtr> trackAndOptions;
@@ -1858,6 +1860,42 @@ TrackerContextPrivate::extractSortedPointsFromMarkers(double refTime,
     }
 } // TrackerContext::extractSortedPointsFromMarkers
 
+/*
+ * @brief Hash of everything the transform or corner pin solved at a keyframe depends on, to find out whether
+ * the result of a previous solve can be reused as is.
+ */
+static U64
+getSolverInputsHash(double refTime,
+                    double time,
+                    bool robustModel,
+                    int w1,
+                    int h1,
+                    int w2,
+                    int h2,
+                    const std::vector<Point>& x1,
+                    const std::vector<Point>& x2)
+{
+    Hash64 hash;
+
+    hash.append(refTime);
+    hash.append(time);
+    hash.append(robustModel);
+    hash.append(w1);
+    hash.append(h1);
+    hash.append(w2);
+    hash.append(h2);
+    hash.append( (U64)x1.size() );
+    for (std::size_t i = 0; i < x1.size(); ++i) {
+        hash.append(x1[i].x);
+        hash.append(x1[i].y);
+        hash.append(x2[i].x);
+        hash.append(x2[i].y);
+    }
+    hash.computeHash();
+
+    return hash.value();
+}
+
 TrackerContextPrivate::TransformData
 TrackerContextPrivate::computeTransformParamsFromTracksAtTime(double refTime,
                                                               double time,
@@ -1902,6 +1940,16 @@ TrackerContextPrivate::computeTransformParamsFromTracksAtTime(double refTime,
         return data;
     }
 
+    // Nothing changed at this keyframe since the last solve: do not run the solver again
+    // (the jitter parameters only change the points, which are in the hash)
+    const U64 inputsHash = getSolverInputsHash(refTime, time, robustModel, w1, h1, w2, h2, x1, x2);
+    {
+        QMutexLocker k(&solverCacheMutex);
+        std::map<double, std::pair<U64, TransformData> >::const_iterator found = transformSolverCache.find(time);
+        if ( ( found != transformSolverCache.end() ) && (found->second.first == inputsHash) ) {
+            return found->second.second;
+        }
+    }
 
     const bool dataSetIsUserManual = true;
 
@@ -1917,6 +1965,11 @@ TrackerContextPrivate::computeTransformParamsFromTracksAtTime(double refTime,
         data.valid = false;
     }
 
+    {
+        QMutexLocker k(&solverCacheMutex);
+        transformSolverCache[time] = std::make_pair(inputsHash, data);
+    }
+
     return data;
 } // TrackerContextPrivate::computeTransformParamsFromTracksAtTime
 
@@ -1963,6 +2016,15 @@ TrackerContextPrivate::computeCornerPinParamsFromTracksAtTime(double refTime,
         return data;
     }
 
+    // Nothing changed at this keyframe since the last solve: do not run the solver again
+    const U64 inputsHash = getSolverInputsHash(refTime, time, robustModel, w1, h1, w2, h2, x1, x2);
+    {
+        QMutexLocker k(&solverCacheMutex);
+        std::map<double, std::pair<U64, CornerPinData> >::const_iterator found = cornerPinSolverCache.find(time);
+        if ( ( found != cornerPinSolverCache.end() ) && (found->second.first == inputsHash) ) {
+            return found->second.second;
+        }
+    }
 
     if (x1.size() == 1) {
         data.h.setTranslationFromOnePoint( euclideanToHomogenous(x1[0]), euclideanToHomogenous(x2[0]) );
@@ -1983,6 +2045,11 @@ TrackerContextPrivate::computeCornerPinParamsFromTracksAtTime(double refTime,
         }
     }
 
+    {
+        QMutexLocker k(&solverCacheMutex);
+        cornerPinSolverCache[time] = std::make_pair(inputsHash, data);
+    }
+
     return data;
 } // TrackerContextPrivate::computeCornerPinParamsFromTracksAtTime
 
@@ -2384,6 +2451,7 @@ TrackerContextPrivate::computeCornerParamsFromTracksEnd(double refTime,
 void
 TrackerContextPrivate::computeCornerParamsFromTracks()
 {
+    pruneSolverCache(&cornerPinSolverCache);
 #ifndef TRACKER_GENERATE_DATA_SEQUENTIALLY
     lastSolveRequest.tWatcher.reset();
     lastSolveRequest.cpWatcher.reset( new QFutureWatcher<TrackerContextPrivate::CornerPinData>() );
@@ -2586,6 +2654,7 @@ TrackerContextPrivate::computeTransformParamsFromTracksEnd(double refTime,
 void
 TrackerContextPrivate::computeTransformParamsFromTracks()
 {
+    pruneSolverCache(&transformSolverCache);
 #ifndef TRACKER_GENERATE_DATA_SEQUENTIALLY
     lastSolveRequest.cpWatcher.reset();
     lastSolveRequest.tWatcher.reset( new QFutureWatcher<TrackerContextPrivate::TransformData>() );
@@ -31,6 +31,7 @@
 #include "TrackerContext.h"
 
 #include <list>
+#include <map>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/utility.hpp>
@@ -498,6 +499,12 @@ public:
 
     SolveRequest lastSolveRequest;
 
+    // The result of the last solve at each keyframe along with the hash of its inputs, so that solving again
+    // only runs the solver on the keyframes whose points changed (e.g. a single marker was moved at one frame)
+    QMutex solverCacheMutex;
+    std::map<double, std::pair<U64, TransformData> > transformSolverCache;
+    std::map<double, std::pair<U64, CornerPinData> > cornerPinSolverCache;
+
 
     TrackerContextPrivate(TrackerContext* publicInterface,
                           const NodePtr &node);
@@ -665,6 +672,21 @@ public:
 
     void computeTransformParamsFromTracks();
 
+    // Forget the results of the keyframes that are not solved anymore
+    template <typename DATA>
+    void pruneSolverCache(std::map<double, std::pair<U64, DATA> >* cache)
+    {
+        QMutexLocker k(&solverCacheMutex);
+
+        for (typename std::map<double, std::pair<U64, DATA> >::iterator it = cache->begin(); it != cache->end();) {
+            if ( lastSolveRequest.keyframes.find(it->first) == lastSolveRequest.keyframes.end() ) {
+                cache->erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+
     void computeTransformParamsFromTracksEnd(double refTime,
                                              double maxFittingError,
                                              const QList<TransformData>& results);
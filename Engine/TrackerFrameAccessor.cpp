@@ -25,7 +25,17 @@
 
 #include "TrackerFrameAccessor.h"
 
+#include <algorithm> // sort
+#include <functional> // less
+#include <cstdlib> // abs
+#include <cstring> // memcpy
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
 #include <boost/utility.hpp>
+#include <boost/weak_ptr.hpp>
 
 GCC_DIAG_OFF(unused-function)
 GCC_DIAG_OFF(unused-parameter)
@@ -46,6 +56,19 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/Node.h"
 #include "Engine/TrackerContext.h"
 
+// Size in pixels of the cells of the grid indexing the regions cached for a frame
+#define NATRON_TRACKER_FRAME_ACCESSOR_CACHE_CELL_SIZE 128
+
+// Images no longer used by libmv are kept in the cache until it exceeds this size
+#define NATRON_TRACKER_FRAME_ACCESSOR_CACHE_MAX_BYTES (256 * 1024 * 1024)
+
+// Images no longer used by libmv are dropped right away when they are that many steps behind the tracked frame
+#define NATRON_TRACKER_FRAME_ACCESSOR_CACHE_STEPS_BEHIND 2
+
+// A region missing from the cache is rendered together with the cached regions it overlaps if their bounding box
+// is at most that many times larger than the sum of their areas
+#define NATRON_TRACKER_FRAME_ACCESSOR_MERGE_MAX_AREA_RATIO 2.
+
 NATRON_NAMESPACE_ENTER
 
 namespace  {
@@ -123,8 +146,58 @@ struct FrameAccessorCacheEntry
     unsigned int referenceCount;
 };
 
-typedef std::multimap<FrameAccessorCacheKey, FrameAccessorCacheEntry, CacheKey_compare_less > FrameAccessorCache;
+typedef boost::shared_ptr<FrameAccessorCacheEntry> FrameAccessorCacheEntryPtr;
+typedef std::list<FrameAccessorCacheEntryPtr> FrameAccessorCacheEntryList;
+
+// Coordinates of a cell of the grid indexing the regions cached for a frame
+typedef std::pair<int, int> FrameAccessorCacheCell;
+
+/*
+ * @brief All the regions cached for a frame. Each region is also referenced by every cell of a regular grid it overlaps:
+ * a region enclosing a request necessarily overlaps the cell of its bottom-left corner, so a look-up only visits
+ * the few regions registered in that cell.
+ */
+struct FrameAccessorFrameCache
+{
+    FrameAccessorCacheEntryList entries;
+    std::map<FrameAccessorCacheCell, FrameAccessorCacheEntryList> cells;
+};
+
+typedef std::map<FrameAccessorCacheKey, FrameAccessorFrameCache, CacheKey_compare_less > FrameAccessorCache;
+
+// Find the frame and entry of an image returned to libmv without visiting the whole cache
+typedef std::map<const MvFloatImage*, std::pair<FrameAccessorCacheKey, FrameAccessorCacheEntryPtr> > FrameAccessorImagesMap;
+
+static int
+getFrameAccessorCacheCellCoord(int v)
+{
+    // Round towards minus infinity so that negative coordinates get their own cells
+    return v >= 0 ? v / NATRON_TRACKER_FRAME_ACCESSOR_CACHE_CELL_SIZE : -( (-v + NATRON_TRACKER_FRAME_ACCESSOR_CACHE_CELL_SIZE - 1) / NATRON_TRACKER_FRAME_ACCESSOR_CACHE_CELL_SIZE );
+}
+
+// An image no longer used by libmv that may be evicted
+struct FrameAccessorUnusedEntry
+{
+    double stepsBehind;
+    FrameAccessorCacheKey key;
+    FrameAccessorCacheEntryPtr entry;
+};
+
+// Sorts the farthest behind the tracking first
+struct FrameAccessorUnusedEntry_compare_behind
+{
+    bool operator() (const FrameAccessorUnusedEntry & lhs,
+                     const FrameAccessorUnusedEntry & rhs) const
+    {
+        return lhs.stepsBehind > rhs.stepsBehind;
+    }
+};
 
+static std::size_t
+getFrameAccessorCacheEntrySize(const FrameAccessorCacheEntry& entry)
+{
+    return (std::size_t)entry.image->Height() * entry.image->Width() * sizeof(float);
+}
 
 template <bool doR, bool doG, bool doB>
 void
@@ -138,32 +211,71 @@ natronImageToLibMvFloatImageForChannels(const Image* source,
     unsigned int compsCount = source->getComponentsCount();
 
     assert(compsCount == 3);
-    unsigned int srcRowElements = source->getRowElements();
-
+    Q_UNUSED(compsCount);
     assert( source->getBounds().contains(roi) );
-    const float* src_pixels = (const float*)racc.pixelAt(roi.x1, roi.y1);
-    assert(src_pixels);
+    const Image::ConstPixelSpan span = racc.spanAt(roi);
+    assert( !span.isEmpty() );
+    const std::size_t srcRowElements = span.rowStride / sizeof(float);
+    const float* src_pixels = span.rowAt<const float>(roi.y1);
     float* dst_pixels = mvImg.Data();
     assert(dst_pixels);
     //LibMV images have their origin in the top left hand corner
 
     // It's important to rescale the resultappropriately so that e.g. if only
     // blue is selected, it's not zeroed out.
-    float scale = (doR ? 0.2126f : 0.0f) +
-                  (doG ? 0.7152f : 0.0f) +
-                  (doB ? 0.0722f : 0.0f);
-    int h = roi.height();
-    int w = roi.width();
-    for ( int y = 0; y < h; ++y,
-          src_pixels += (srcRowElements - compsCount * w) ) {
-        for (int x = 0; x < w; ++x,
-             src_pixels += compsCount,
-             ++dst_pixels) {
-            /// Apply luminance conversion while we copy the image
-            /// This code is taken from DisableChannelsTransform::run in libmv/autotrack/autotrack.cc
-            *dst_pixels = ( 0.2126f * (doR ? src_pixels[0] : 0.0f) +
-                            0.7152f * (doG ? src_pixels[1] : 0.0f) +
-                            0.0722f * (doB ? src_pixels[2] : 0.0f) ) / scale;
+    const float scale = (doR ? 0.2126f : 0.0f) +
+                        (doG ? 0.7152f : 0.0f) +
+                        (doB ? 0.0722f : 0.0f);
+    // Fold the rescale in the weights so that the inner loop has no division and no branch and can be vectorized
+    // by the compiler. Disabled channels are not read at all, as they may hold garbage (e.g: NaN).
+    const float wR = 0.2126f / scale;
+    const float wG = 0.7152f / scale;
+    const float wB = 0.0722f / scale;
+    const int h = roi.height();
+    const int w = roi.width();
+    for (int y = 0; y < h; ++y,
+         src_pixels += srcRowElements,
+         dst_pixels += w) {
+        /// Apply luminance conversion while we copy the image
+        /// This code is taken from DisableChannelsTransform::run in libmv/autotrack/autotrack.cc
+        const float* src = src_pixels;
+        for (int x = 0; x < w; ++x, src += 3) {
+            dst_pixels[x] = (doR ? wR * src[0] : 0.0f) +
+                            (doG ? wG * src[1] : 0.0f) +
+                            (doB ? wB * src[2] : 0.0f);
+        }
+    }
+}
+
+/*
+ * @brief When a single channel is enabled the luminance is that channel: read it directly through a channel span,
+ * which is a plain row copy if the source is planar.
+ */
+static void
+natronImageChannelToLibMvFloatImage(int channel,
+                                    const Image* source,
+                                    const RectI& roi,
+                                    MvFloatImage& mvImg)
+{
+    //mvImg is expected to have its bounds equal to roi
+
+    Image::ReadAccess racc(source);
+
+    assert( source->getBounds().contains(roi) );
+    const Image::ConstPixelSpan span = racc.channelSpanAt(channel, roi);
+    assert( !span.isEmpty() );
+    const std::size_t srcStep = span.pixelStride / sizeof(float);
+    float* dst_pixels = mvImg.Data();
+    assert(dst_pixels);
+    const int w = roi.width();
+    for (int y = roi.y1; y < roi.y2; ++y, dst_pixels += w) {
+        const float* src = span.rowAt<const float>(y);
+        if (srcStep == 1) {
+            std::memcpy( dst_pixels, src, w * sizeof(float) );
+        } else {
+            for (int x = 0; x < w; ++x, src += srcStep) {
+                dst_pixels[x] = *src;
+            }
         }
     }
 }
@@ -185,7 +297,7 @@ natronImageToLibMvFloatImage(bool enabledChannels[3],
             if (enabledChannels[2]) {
                 natronImageToLibMvFloatImageForChannels<true, false, true>(source, roi, mvImg);
             } else {
-                natronImageToLibMvFloatImageForChannels<true, false, false>(source, roi, mvImg);
+                natronImageChannelToLibMvFloatImage(0, source, roi, mvImg);
             }
         }
     } else {
@@ -193,26 +305,156 @@ natronImageToLibMvFloatImage(bool enabledChannels[3],
             if (enabledChannels[2]) {
                 natronImageToLibMvFloatImageForChannels<false, true, true>(source, roi, mvImg);
             } else {
-                natronImageToLibMvFloatImageForChannels<false, true, false>(source, roi, mvImg);
+                natronImageChannelToLibMvFloatImage(1, source, roi, mvImg);
             }
         } else {
             if (enabledChannels[2]) {
-                natronImageToLibMvFloatImageForChannels<false, false, true>(source, roi, mvImg);
+                natronImageChannelToLibMvFloatImage(2, source, roi, mvImg);
             } else {
                 natronImageToLibMvFloatImageForChannels<false, false, false>(source, roi, mvImg);
             }
         }
     }
 }
+
+/*
+ * @brief Copies the part of a cached image that libmv asked for: libmv expects the image it gets to start exactly
+ * at the origin of the requested region.
+ */
+static MvFloatImagePtr
+cropLibMvFloatImage(const MvFloatImage& source,
+                    const RectI& sourceBounds,
+                    const RectI& roi)
+{
+    assert( sourceBounds.contains(roi) );
+    MvFloatImagePtr ret = boost::make_shared<MvFloatImage>( roi.height(), roi.width() );
+    int w = roi.width();
+    int h = roi.height();
+    const float* src_pixels = source.Data() + (std::size_t)(roi.y1 - sourceBounds.y1) * sourceBounds.width() + (roi.x1 - sourceBounds.x1);
+    float* dst_pixels = ret->Data();
+    for (int y = 0; y < h; ++y, src_pixels += sourceBounds.width(), dst_pixels += w) {
+        std::memcpy( dst_pixels, src_pixels, w * sizeof(float) );
+    }
+
+    return ret;
+}
 } // anon namespace
 
 
+/*
+ * @brief The images rendered for the trackers tracking the same input, at the same input hash, with the same channels.
+ * Trackers running at the same time on the same plate (e.g: a stabilization and separate object tracks) share it
+ * so that each region of a frame is rendered once for all of them.
+ */
+struct TrackerFrameAccessorSharedCache
+{
+    mutable QMutex cacheMutex;
+    FrameAccessorCache cache;
+    FrameAccessorImagesMap images;
+    std::size_t cacheBytes;
+
+    // For each accessor using the cache, the frame being tracked and the tracking step, used to evict the images behind the tracking
+    std::map<const TrackerFrameAccessor*, std::pair<int, int> > trackedFrames;
+
+    TrackerFrameAccessorSharedCache()
+        : cacheMutex()
+        , cache()
+        , images()
+        , cacheBytes(0)
+        , trackedFrames()
+    {
+    }
+
+    /*
+     * The functions below must be called with cacheMutex locked
+     */
+
+    // Returns a cached region of the frame enclosing roi, if any
+    FrameAccessorCacheEntryPtr findEntry(const FrameAccessorCacheKey& key, const RectI& roi) const;
+
+    // Returns the region to render for roi: the bounding box of roi and the cached regions it overlaps if it is not much larger
+    RectI getRegionToRender(const FrameAccessorCacheKey& key, const RectI& roi) const;
+
+    void insertEntry(const FrameAccessorCacheKey& key, const FrameAccessorCacheEntryPtr& entry);
+
+    void removeEntry(const FrameAccessorCacheKey& key, const FrameAccessorCacheEntryPtr& entry);
+
+    // How far behind the tracked frames of all the accessors the given frame is, in steps. Negative if it is ahead of one of them.
+    double getStepsBehind(int frame) const;
+
+    // Whether all the accessors know their tracking direction, so that the images behind them can be dropped
+    bool canDropImagesBehind() const;
+
+    // Drop the unused images that are too far behind and then the farthest behind ones until the cache fits in its budget
+    void evictEntries();
+};
+
+typedef boost::shared_ptr<TrackerFrameAccessorSharedCache> TrackerFrameAccessorSharedCachePtr;
+typedef boost::weak_ptr<TrackerFrameAccessorSharedCache> TrackerFrameAccessorSharedCacheWPtr;
+
+namespace {
+struct SharedCacheKey
+{
+    const Node* input;
+    U64 inputHash;
+    int channels;
+};
+
+struct SharedCacheKey_compare_less
+{
+    bool operator() (const SharedCacheKey & lhs,
+                     const SharedCacheKey & rhs) const
+    {
+        if (lhs.input != rhs.input) {
+            return std::less<const Node*>()(lhs.input, rhs.input);
+        }
+        if (lhs.inputHash != rhs.inputHash) {
+            return lhs.inputHash < rhs.inputHash;
+        }
+
+        return lhs.channels < rhs.channels;
+    }
+};
+
+typedef std::map<SharedCacheKey, TrackerFrameAccessorSharedCacheWPtr, SharedCacheKey_compare_less> SharedCachesMap;
+
+// The caches of the accessors alive, a cache is destroyed with the last accessor using it
+QMutex sharedCachesMutex;
+SharedCachesMap sharedCaches;
+
+TrackerFrameAccessorSharedCachePtr
+getSharedCache(const SharedCacheKey& key)
+{
+    QMutexLocker k(&sharedCachesMutex);
+
+    // Forget the caches of the trackers that are done
+    for (SharedCachesMap::iterator it = sharedCaches.begin(); it != sharedCaches.end();) {
+        if ( it->second.expired() ) {
+            sharedCaches.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+
+    SharedCachesMap::iterator found = sharedCaches.find(key);
+    if ( found != sharedCaches.end() ) {
+        TrackerFrameAccessorSharedCachePtr ret = found->second.lock();
+        if (ret) {
+            return ret;
+        }
+    }
+    TrackerFrameAccessorSharedCachePtr ret = boost::make_shared<TrackerFrameAccessorSharedCache>();
+    sharedCaches[key] = ret;
+
+    return ret;
+}
+} // anon namespace
+
 struct TrackerFrameAccessorPrivate
 {
     const TrackerContext* context;
     NodePtr trackerInput;
-    mutable QMutex cacheMutex;
-    FrameAccessorCache cache;
+    TrackerFrameAccessorSharedCachePtr shared;
     bool enabledChannels[3];
     int formatHeight;
 
@@ -221,8 +463,7 @@ struct TrackerFrameAccessorPrivate
                                 int formatHeight)
         : context(context)
         , trackerInput()
-        , cacheMutex()
-        , cache()
+        , shared()
         , enabledChannels()
         , formatHeight(formatHeight)
     {
@@ -231,7 +472,20 @@ struct TrackerFrameAccessorPrivate
         for (int i = 0; i < 3; ++i) {
             this->enabledChannels[i] = enabledChannels[i];
         }
+
+        SharedCacheKey key;
+        key.input = trackerInput.get();
+        key.inputHash = trackerInput ? trackerInput->getHashValue() : 0;
+        key.channels = (enabledChannels[0] ? 1 : 0) | (enabledChannels[1] ? 2 : 0) | (enabledChannels[2] ? 4 : 0);
+        shared = getSharedCache(key);
     }
+
+    /**
+     * @brief Renders the tracker input at the given frame and converts it to a libmv image.
+     * If roi is NULL, the full region of definition is rendered.
+     * The resulting entry has a reference count of 1 and is not yet in the cache.
+     **/
+    bool renderImage(int frame, int downscale, const RectI* roi, FrameAccessorCacheEntry* entry);
 };
 
 TrackerFrameAccessor::TrackerFrameAccessor(const TrackerContext* context,
@@ -244,6 +498,11 @@ TrackerFrameAccessor::TrackerFrameAccessor(const TrackerContext* context,
 
 TrackerFrameAccessor::~TrackerFrameAccessor()
 {
+    // The other trackers sharing the cache no longer have to keep the images for this one
+    QMutexLocker k(&_imp->shared->cacheMutex);
+
+    _imp->shared->trackedFrames.erase(this);
+    _imp->shared->evictEntries();
 }
 
 void
@@ -302,49 +561,369 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
        Check if a frame exists in the cache with matching key and bounds enclosing the given region
      */
     RectI roi;
+    RectI renderRoI;
     if (region) {
         convertLibMVRegionToRectI(*region, _imp->formatHeight, &roi);
 
-        QMutexLocker k(&_imp->cacheMutex);
-        std::pair<FrameAccessorCache::iterator, FrameAccessorCache::iterator> range = _imp->cache.equal_range(key);
-        for (FrameAccessorCache::iterator it = range.first; it != range.second; ++it) {
-            if ( (roi.x1 >= it->second.bounds.x1) && (roi.x2 <= it->second.bounds.x2) &&
-                 ( roi.y1 >= it->second.bounds.y1) && ( roi.y2 <= it->second.bounds.y2) ) {
+        FrameAccessorCacheEntryPtr cached;
+        {
+            QMutexLocker k(&_imp->shared->cacheMutex);
+            cached = _imp->shared->findEntry(key, roi);
+            if (cached) {
 #ifdef TRACE_LIB_MV
                 qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Found cached image at frame" << frame << "with RoI x1="
                          << region->min(0) << "y1=" << region->max(1) << "x2=" << region->max(0) << "y2=" << region->min(1);
 #endif
-                // LibMV is kinda dumb on this we must necessarily copy the data either via CopyFrom or the
-                // assignment constructor:
-                // EDIT: fixed libmv
-                *destination = it->second.image.get();
-                //destination->CopyFrom<float>(*it->second.image);
-                ++it->second.referenceCount;
-
-                return (mv::FrameAccessor::Key)it->second.image.get();
+                if (cached->bounds == roi) {
+                    // LibMV is kinda dumb on this we must necessarily copy the data either via CopyFrom or the
+                    // assignment constructor:
+                    // EDIT: fixed libmv
+                    *destination = cached->image.get();
+                    //destination->CopyFrom<float>(*cached->image);
+                    ++cached->referenceCount;
+
+                    return (mv::FrameAccessor::Key)cached->image.get();
+                }
+            } else {
+                renderRoI = _imp->shared->getRegionToRender(key, roi);
+            }
+        }
+
+        if (cached) {
+            // The cached image is larger than the region (e.g: it was prefetched for all tracks), extract the region.
+            // We hold a reference to the cached image so it can be read without the lock.
+            FrameAccessorCacheEntryPtr entry = boost::make_shared<FrameAccessorCacheEntry>();
+            entry->image = cropLibMvFloatImage(*cached->image, cached->bounds, roi);
+            entry->bounds = roi;
+            entry->referenceCount = 1;
+            *destination = entry->image.get();
+
+            QMutexLocker k(&_imp->shared->cacheMutex);
+            _imp->shared->insertEntry(key, entry);
+
+            return (mv::FrameAccessor::Key)entry->image.get();
+        }
+    }
+
+    // Not in accessor cache, call renderRoI
+    FrameAccessorCacheEntryPtr entry = boost::make_shared<FrameAccessorCacheEntry>();
+    if ( !_imp->renderImage(frame, downscale, region ? &renderRoI : 0, entry.get()) ) {
+        return (mv::FrameAccessor::Key)0;
+    }
+
+    FrameAccessorCacheEntryPtr ret = entry;
+    if ( region && (entry->bounds != roi) && entry->bounds.contains(roi) ) {
+        // The region was rendered along with the cached regions around it: keep the whole image for the next requests
+        // and only give its part to libmv
+        entry->referenceCount = 0;
+        ret = boost::make_shared<FrameAccessorCacheEntry>();
+        ret->image = cropLibMvFloatImage(*entry->image, entry->bounds, roi);
+        ret->bounds = roi;
+        ret->referenceCount = 1;
+    }
+
+    *destination = ret->image.get();
+    //destination->CopyFrom<float>(*ret->image);
+
+    //insert into the cache
+    {
+        QMutexLocker k(&_imp->shared->cacheMutex);
+        if (ret != entry) {
+            _imp->shared->insertEntry(key, entry);
+        }
+        _imp->shared->insertEntry(key, ret);
+    }
+
+    return (mv::FrameAccessor::Key)ret->image.get();
+} // TrackerFrameAccessor::GetImage
+
+mv::FrameAccessor::Key
+TrackerFrameAccessor::prefetchImage(int frame,
+                                    const RectI& roi)
+{
+    FrameAccessorCacheKey key;
+
+    key.frame = frame;
+    key.mipMapLevel = 0;
+    key.mode = mv::FrameAccessor::MONO;
+
+    FrameAccessorCacheEntryPtr entry = boost::make_shared<FrameAccessorCacheEntry>();
+    if ( !_imp->renderImage(frame, 0, &roi, entry.get()) ) {
+        return (mv::FrameAccessor::Key)0;
+    }
+
+    QMutexLocker k(&_imp->shared->cacheMutex);
+    _imp->shared->insertEntry(key, entry);
+
+    return (mv::FrameAccessor::Key)entry->image.get();
+}
+
+void
+TrackerFrameAccessor::setTrackedFrame(int frame,
+                                      int step)
+{
+    QMutexLocker k(&_imp->shared->cacheMutex);
+
+    _imp->shared->trackedFrames[this] = std::make_pair(frame, step);
+    _imp->shared->evictEntries();
+}
+
+FrameAccessorCacheEntryPtr
+TrackerFrameAccessorSharedCache::findEntry(const FrameAccessorCacheKey& key,
+                                           const RectI& roi) const
+{
+    if ( roi.isNull() ) {
+        return FrameAccessorCacheEntryPtr();
+    }
+    FrameAccessorCache::const_iterator foundFrame = cache.find(key);
+    if ( foundFrame == cache.end() ) {
+        return FrameAccessorCacheEntryPtr();
+    }
+
+    // A region enclosing roi overlaps the cell of its bottom-left corner
+    FrameAccessorCacheCell cell( getFrameAccessorCacheCellCoord(roi.x1), getFrameAccessorCacheCellCoord(roi.y1) );
+    std::map<FrameAccessorCacheCell, FrameAccessorCacheEntryList>::const_iterator foundCell = foundFrame->second.cells.find(cell);
+    if ( foundCell == foundFrame->second.cells.end() ) {
+        return FrameAccessorCacheEntryPtr();
+    }
+    for (FrameAccessorCacheEntryList::const_iterator it = foundCell->second.begin(); it != foundCell->second.end(); ++it) {
+        if ( (*it)->bounds.contains(roi) ) {
+            return *it;
+        }
+    }
+
+    return FrameAccessorCacheEntryPtr();
+}
+
+RectI
+TrackerFrameAccessorSharedCache::getRegionToRender(const FrameAccessorCacheKey& key,
+                                                   const RectI& roi) const
+{
+    if ( roi.isNull() ) {
+        return roi;
+    }
+    FrameAccessorCache::const_iterator foundFrame = cache.find(key);
+    if ( foundFrame == cache.end() ) {
+        return roi;
+    }
+
+    RectI ret = roi;
+    double areasSum = (double)roi.area();
+    std::set<const FrameAccessorCacheEntry*> visited;
+    const int cx1 = getFrameAccessorCacheCellCoord(roi.x1);
+    const int cx2 = getFrameAccessorCacheCellCoord(roi.x2 - 1);
+    const int cy1 = getFrameAccessorCacheCellCoord(roi.y1);
+    const int cy2 = getFrameAccessorCacheCellCoord(roi.y2 - 1);
+    for (int cy = cy1; cy <= cy2; ++cy) {
+        for (int cx = cx1; cx <= cx2; ++cx) {
+            std::map<FrameAccessorCacheCell, FrameAccessorCacheEntryList>::const_iterator foundCell = foundFrame->second.cells.find( FrameAccessorCacheCell(cx, cy) );
+            if ( foundCell == foundFrame->second.cells.end() ) {
+                continue;
+            }
+            for (FrameAccessorCacheEntryList::const_iterator it = foundCell->second.begin(); it != foundCell->second.end(); ++it) {
+                if ( !visited.insert( it->get() ).second || !(*it)->bounds.intersects(roi) ) {
+                    continue;
+                }
+                ret.merge( (*it)->bounds );
+                areasSum += (double)(*it)->bounds.area();
+            }
+        }
+    }
+
+    if ( (double)ret.area() > NATRON_TRACKER_FRAME_ACCESSOR_MERGE_MAX_AREA_RATIO * areasSum ) {
+        return roi;
+    }
+
+    return ret;
+}
+
+void
+TrackerFrameAccessorSharedCache::insertEntry(const FrameAccessorCacheKey& key,
+                                             const FrameAccessorCacheEntryPtr& entry)
+{
+    // Drop the unused regions enclosed by the new one, the new one serves them
+    {
+        FrameAccessorCacheEntryList enclosed;
+        FrameAccessorCache::const_iterator foundFrame = cache.find(key);
+        if ( foundFrame != cache.end() ) {
+            for (FrameAccessorCacheEntryList::const_iterator it = foundFrame->second.entries.begin(); it != foundFrame->second.entries.end(); ++it) {
+                if ( !(*it)->referenceCount && entry->bounds.contains( (*it)->bounds ) ) {
+                    enclosed.push_back(*it);
+                }
+            }
+        }
+        for (FrameAccessorCacheEntryList::const_iterator it = enclosed.begin(); it != enclosed.end(); ++it) {
+            removeEntry(key, *it);
+        }
+    }
+
+    FrameAccessorFrameCache& frameCache = cache[key];
+    frameCache.entries.push_back(entry);
+    if ( !entry->bounds.isNull() ) {
+        const int cx1 = getFrameAccessorCacheCellCoord(entry->bounds.x1);
+        const int cx2 = getFrameAccessorCacheCellCoord(entry->bounds.x2 - 1);
+        const int cy1 = getFrameAccessorCacheCellCoord(entry->bounds.y1);
+        const int cy2 = getFrameAccessorCacheCellCoord(entry->bounds.y2 - 1);
+        for (int cy = cy1; cy <= cy2; ++cy) {
+            for (int cx = cx1; cx <= cx2; ++cx) {
+                frameCache.cells[FrameAccessorCacheCell(cx, cy)].push_back(entry);
             }
         }
     }
+    images[entry->image.get()] = std::make_pair(key, entry);
+    cacheBytes += getFrameAccessorCacheEntrySize(*entry);
+
+    if (cacheBytes > NATRON_TRACKER_FRAME_ACCESSOR_CACHE_MAX_BYTES) {
+        evictEntries();
+    }
+}
 
+void
+TrackerFrameAccessorSharedCache::removeEntry(const FrameAccessorCacheKey& key,
+                                             const FrameAccessorCacheEntryPtr& entry)
+{
+    // Hold the entry: the reference passed in may be one of the lists it is removed from
+    FrameAccessorCacheEntryPtr e = entry;
+    FrameAccessorCache::iterator foundFrame = cache.find(key);
+
+    assert( foundFrame != cache.end() );
+    if ( foundFrame == cache.end() ) {
+        return;
+    }
+    FrameAccessorFrameCache& frameCache = foundFrame->second;
+    frameCache.entries.remove(e);
+    if ( !e->bounds.isNull() ) {
+        const int cx1 = getFrameAccessorCacheCellCoord(e->bounds.x1);
+        const int cx2 = getFrameAccessorCacheCellCoord(e->bounds.x2 - 1);
+        const int cy1 = getFrameAccessorCacheCellCoord(e->bounds.y1);
+        const int cy2 = getFrameAccessorCacheCellCoord(e->bounds.y2 - 1);
+        for (int cy = cy1; cy <= cy2; ++cy) {
+            for (int cx = cx1; cx <= cx2; ++cx) {
+                std::map<FrameAccessorCacheCell, FrameAccessorCacheEntryList>::iterator foundCell = frameCache.cells.find( FrameAccessorCacheCell(cx, cy) );
+                if ( foundCell == frameCache.cells.end() ) {
+                    continue;
+                }
+                foundCell->second.remove(e);
+                if ( foundCell->second.empty() ) {
+                    frameCache.cells.erase(foundCell);
+                }
+            }
+        }
+    }
+    if ( frameCache.entries.empty() ) {
+        cache.erase(foundFrame);
+    }
+    images.erase( e->image.get() );
+    cacheBytes -= getFrameAccessorCacheEntrySize(*e);
+}
+
+double
+TrackerFrameAccessorSharedCache::getStepsBehind(int frame) const
+{
+    // An image is as far behind as it is from the accessor that is the least ahead of it
+    double ret = 0.;
+    bool first = true;
+
+    for (std::map<const TrackerFrameAccessor*, std::pair<int, int> >::const_iterator it = trackedFrames.begin(); it != trackedFrames.end(); ++it) {
+        const int trackedFrame = it->second.first;
+        const int trackingStep = it->second.second;
+        double stepsBehind;
+        if (trackingStep == 0) {
+            // We don't know the tracking direction, consider everything away from the tracked frame is behind
+            stepsBehind = std::abs(frame - trackedFrame);
+        } else {
+            stepsBehind = (double)(trackedFrame - frame) / trackingStep;
+        }
+        if ( first || (stepsBehind < ret) ) {
+            ret = stepsBehind;
+            first = false;
+        }
+    }
+
+    return ret;
+}
+
+bool
+TrackerFrameAccessorSharedCache::canDropImagesBehind() const
+{
+    if ( trackedFrames.empty() ) {
+        return false;
+    }
+    for (std::map<const TrackerFrameAccessor*, std::pair<int, int> >::const_iterator it = trackedFrames.begin(); it != trackedFrames.end(); ++it) {
+        if (it->second.second == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+TrackerFrameAccessorSharedCache::evictEntries()
+{
+    std::vector<FrameAccessorUnusedEntry> unused;
+    std::vector<FrameAccessorUnusedEntry> toRemove;
+    const bool dropBehind = canDropImagesBehind();
+
+    for (FrameAccessorImagesMap::const_iterator it = images.begin(); it != images.end(); ++it) {
+        if (it->second.second->referenceCount) {
+            continue;
+        }
+        FrameAccessorUnusedEntry e;
+        e.stepsBehind = getStepsBehind(it->second.first.frame);
+        e.key = it->second.first;
+        e.entry = it->second.second;
+        if ( dropBehind && (e.stepsBehind > NATRON_TRACKER_FRAME_ACCESSOR_CACHE_STEPS_BEHIND) ) {
+            toRemove.push_back(e);
+        } else {
+            unused.push_back(e);
+        }
+    }
+    for (std::vector<FrameAccessorUnusedEntry>::const_iterator it = toRemove.begin(); it != toRemove.end(); ++it) {
+        removeEntry(it->key, it->entry);
+    }
+
+    if (cacheBytes <= NATRON_TRACKER_FRAME_ACCESSOR_CACHE_MAX_BYTES) {
+        return;
+    }
+
+    // Images still used by libmv cannot be evicted, the cache may stay above its budget until they are released
+    std::sort( unused.begin(), unused.end(), FrameAccessorUnusedEntry_compare_behind() );
+    for (std::vector<FrameAccessorUnusedEntry>::const_iterator it = unused.begin(); it != unused.end(); ++it) {
+        if (cacheBytes <= NATRON_TRACKER_FRAME_ACCESSOR_CACHE_MAX_BYTES) {
+            break;
+        }
+        removeEntry(it->key, it->entry);
+    }
+}
+
+bool
+TrackerFrameAccessorPrivate::renderImage(int frame,
+                                         int downscale,
+                                         const RectI* inputRoI,
+                                         FrameAccessorCacheEntry* entry)
+{
     EffectInstancePtr effect;
-    if (_imp->trackerInput) {
-        effect = _imp->trackerInput->getEffectInstance();
+    if (trackerInput) {
+        effect = trackerInput->getEffectInstance();
     }
     if (!effect) {
-        return (mv::FrameAccessor::Key)0;
+        return false;
     }
 
-    // Not in accessor cache, call renderRoI
     RenderScale scale;
     scale.y = scale.x = Image::getScaleFromMipMapLevel( (unsigned int)downscale );
 
 
+    RectI roi;
     RectD precomputedRoD;
-    if (!region) {
+    if (inputRoI) {
+        roi = *inputRoI;
+    } else {
         bool isProjectFormat;
-        StatusEnum stat = effect->getRegionOfDefinition_public(_imp->trackerInput->getHashValue(), frame, scale, ViewIdx(0), &precomputedRoD, &isProjectFormat);
+        StatusEnum stat = effect->getRegionOfDefinition_public(trackerInput->getHashValue(), frame, scale, ViewIdx(0), &precomputedRoD, &isProjectFormat);
         if (stat == eStatusFailed) {
-            return (mv::FrameAccessor::Key)0;
+            return false;
         }
         double par = effect->getAspectRatio(-1);
         precomputedRoD.toPixelEnclosing( (unsigned int)downscale, par, &roi );
@@ -353,7 +932,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     std::list<ImagePlaneDesc> components;
     components.push_back( ImagePlaneDesc::getRGBComponents() );
 
-    NodePtr node = _imp->context->getNode();
+    NodePtr node = context->getNode();
     const bool isRenderUserInteraction = true;
     const bool isSequentialRender = false;
     AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(false, 0);
@@ -383,7 +962,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                                         components,
                                         eImageBitDepthFloat,
                                         true,
-                                        _imp->context->getNode()->getEffectInstance().get(),
+                                        node->getEffectInstance().get(),
                                         eStorageModeRAM /*returnOpenGLTex*/,
                                         frame);
     std::map<ImagePlaneDesc, ImagePtr> planes;
@@ -394,7 +973,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                  << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2;
 #endif
 
-        return (mv::FrameAccessor::Key)0;
+        return false;
     }
 
     assert( !planes.empty() );
@@ -407,7 +986,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                  << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2 << ")";
 #endif
 
-        return (mv::FrameAccessor::Key)0;
+        return false;
     }
 
 #ifdef TRACE_LIB_MV
@@ -418,48 +997,44 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     /*
        Copy the Natron image to the LivMV float image
      */
-    FrameAccessorCacheEntry entry;
-    entry.image = boost::make_shared<MvFloatImage>( intersectedRoI.height(), intersectedRoI.width() );
-    entry.bounds = intersectedRoI;
-    entry.referenceCount = 1;
-    natronImageToLibMvFloatImage(_imp->enabledChannels,
+    entry->image = boost::make_shared<MvFloatImage>( intersectedRoI.height(), intersectedRoI.width() );
+    entry->bounds = intersectedRoI;
+    entry->referenceCount = 1;
+    natronImageToLibMvFloatImage(enabledChannels,
                                  sourceImage.get(),
                                  intersectedRoI,
-                                 *entry.image);
+                                 *entry->image);
     // we ignore the transform parameter and do it in natronImageToLibMvFloatImage instead
 
-    *destination = entry.image.get();
-    //destination->CopyFrom<float>(*entry.image);
-
-    //insert into the cache
-    {
-        QMutexLocker k(&_imp->cacheMutex);
-        _imp->cache.insert( std::make_pair(key, entry) );
-    }
-#ifdef TRACE_LIB_MV
-    qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Rendered frame" << frame << "with RoI x1="
-             << intersectedRoI.x1 << "y1=" << intersectedRoI.y1 << "x2=" << intersectedRoI.x2 << "y2=" << intersectedRoI.y2;
-#endif
-
-    return (mv::FrameAccessor::Key)entry.image.get();
-} // TrackerFrameAccessor::GetImage
+    return true;
+} // TrackerFrameAccessorPrivate::renderImage
 
 
 void
 TrackerFrameAccessor::ReleaseImage(Key key)
 {
     MvFloatImage* imgKey = (MvFloatImage*)key;
-    QMutexLocker k(&_imp->cacheMutex);
+    QMutexLocker k(&_imp->shared->cacheMutex);
+    FrameAccessorImagesMap::iterator found = _imp->shared->images.find(imgKey);
 
-    for (FrameAccessorCache::iterator it = _imp->cache.begin(); it != _imp->cache.end(); ++it) {
-        if (it->second.image.get() == imgKey) {
-            --it->second.referenceCount;
-            if (!it->second.referenceCount) {
-                _imp->cache.erase(it);
+    if ( found == _imp->shared->images.end() ) {
+        return;
+    }
+    FrameAccessorCacheKey cacheKey = found->second.first;
+    FrameAccessorCacheEntryPtr entry = found->second.second;
+    assert(entry->referenceCount > 0);
+    if (entry->referenceCount > 0) {
+        --entry->referenceCount;
+    }
+    if (entry->referenceCount) {
+        return;
+    }
 
-                return;
-            }
-        }
+    // Keep the image for the next requests, unless the tracking has gone past it or the cache is full
+    if ( _imp->shared->canDropImagesBehind() && (_imp->shared->getStepsBehind(cacheKey.frame) > NATRON_TRACKER_FRAME_ACCESSOR_CACHE_STEPS_BEHIND) ) {
+        _imp->shared->removeEntry(cacheKey, entry);
+    } else if (_imp->shared->cacheBytes > NATRON_TRACKER_FRAME_ACCESSOR_CACHE_MAX_BYTES) {
+        _imp->shared->evictEntries();
     }
 }
 
@@ -74,6 +74,19 @@ public:
     // free the image immediately; others may hold onto the image.
     virtual void ReleaseImage(Key) OVERRIDE FINAL;
 
+    /**
+     * @brief Renders the given region (in pixel coordinates, at full scale) of the frame ahead of time so that the
+     * next GetImage calls on that frame for regions it encloses do not have to render.
+     * The image is not evicted from the cache until ReleaseImage is called with the returned key. Returns 0 on failure.
+     **/
+    mv::FrameAccessor::Key prefetchImage(int frame, const RectI& roi);
+
+    /**
+     * @brief Informs the accessor of the frame being tracked and of the tracking step. Images no longer used by libmv
+     * are kept in the cache within a memory budget, except those too far behind the tracked frame.
+     **/
+    void setTrackedFrame(int frame, int step);
+
     // Get mask image for the given track.
     //
     // Implementation of this method should sample mask associated with the track
@@ -37,6 +37,7 @@
 #include "Global/Enums.h"
 
 #include "Engine/BufferableObject.h"
+#include "Engine/ImageBufferPool.h"
 #include "Engine/RectD.h"
 #include "Engine/RectI.h"
 #include "Engine/TextureRect.h"
@@ -68,6 +69,7 @@ public:
 
     UpdateViewerParams()
         : mustFreeRamBuffer(false)
+        , ramBufferPoolSize(0)
         , textureIndex(0)
         , time(0)
         , view(0)
@@ -100,7 +102,11 @@ public:
     {
         if (mustFreeRamBuffer) {
             assert(tiles.size() == 1);
-            free(tiles.front().ramBuffer);
+            if (ramBufferPoolSize) {
+                ImageBufferPool::release(tiles.front().ramBuffer, ramBufferPoolSize);
+            } else {
+                free(tiles.front().ramBuffer);
+            }
         }
     }
 
@@ -116,6 +122,7 @@ public:
     }
 
     bool mustFreeRamBuffer; // set to true when !cachedFrame, in this case we have only 1 tile
+    std::size_t ramBufferPoolSize; // if not 0, the buffer to free was allocated by ImageBufferPool with this size, otherwise by malloc()
     int textureIndex; // The texture index (for input A or B)
     int time; // the frame
     ViewIdx view; // the view
@@ -28,9 +28,14 @@
 
 #include <algorithm> // min, max
 #include <stdexcept>
+#include <vector>
+#include <new> // std::bad_alloc
 #include <cassert>
 #include <cstring> // for std::memcpy
 #include <cfloat> // DBL_MAX
+#ifdef __F16C__
+#include <immintrin.h> // _mm_cvtps_ph
+#endif
 
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
@@ -43,6 +48,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QtGlobal>
 #include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+#include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
 #include <QtCore/QFutureWatcher>
 #include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
@@ -54,6 +60,7 @@ CLANG_DIAG_ON(deprecated)
 #include "Engine/AppManager.h"
 #include "Engine/Cache.h"
 #include "Engine/Image.h"
+#include "Engine/ImageBufferPool.h"
 #include "Engine/Log.h"
 #include "Engine/Lut.h"
 #include "Engine/MemoryFile.h"
@@ -115,6 +122,10 @@ static void scaleToTexture32bits(const RectI& roi,
                                  const RenderViewerArgs & args,
                                  const UpdateViewerParams::CachedTile& tile,
                                  float *output);
+static void scaleToTexture16bitsHalf(const RectI& roi,
+                                     const RenderViewerArgs & args,
+                                     const UpdateViewerParams::CachedTile& tile,
+                                     unsigned short *output);
 static MinMaxVal findAutoContrastVminVmax(const ImagePtr inputImage,
                                                          DisplayChannelsEnum channels,
                                                          const RectI & rect);
@@ -124,7 +135,71 @@ static void renderFunctor(const RectI& roi,
                           UpdateViewerParams::CachedTile tile);
 
 /**
- *@brief Actually converting to ARGB... but it is called BGRA by
+ * @brief Half and full floating-point textures hold linear values: gain, gamma, the Lut and the
+ * channels extracted from RGB are applied by the viewer shader. 8-bit textures are displayed as is.
+ **/
+static bool
+isTextureProcessedByShader(ImageBitDepthEnum textureDepth)
+{
+    return (textureDepth == eImageBitDepthFloat) || (textureDepth == eImageBitDepthHalf);
+}
+
+/**
+ * @brief The channels actually converted to the texture: with floating-point textures, the channels
+ * that the viewer shader extracts from RGB are never baked (see isDisplayChannelsAppliedByShader).
+ **/
+static DisplayChannelsEnum
+getTextureDisplayChannels(DisplayChannelsEnum channels,
+                          ImageBitDepthEnum textureDepth)
+{
+    if ( isTextureProcessedByShader(textureDepth) && ViewerInstance::isDisplayChannelsAppliedByShader(channels) ) {
+        return eDisplayChannelsRGB;
+    }
+
+    return channels;
+}
+
+/**
+ * @brief Returns the channels (R,G,B,A) of its input that the viewer needs to display the given texture channels.
+ * Only a single channel of the color plane can be requested, otherwise all channels are.
+ **/
+static std::bitset<4>
+getRequestedChannelsForDisplay(DisplayChannelsEnum textureChannels,
+                               const ImagePlaneDesc& layer,
+                               const ImagePlaneDesc& alphaLayer,
+                               int alphaChannelIndex)
+{
+    std::bitset<4> ret;
+
+    switch (textureChannels) {
+    case eDisplayChannelsR:
+    case eDisplayChannelsG:
+    case eDisplayChannelsB:
+        if ( layer.isColorPlane() && (layer.getNumComponents() >= 3) ) {
+            ret[(int)textureChannels - (int)eDisplayChannelsR] = true;
+
+            return ret;
+        }
+        break;
+    case eDisplayChannelsA:
+        // A single component color plane is alpha
+        if ( alphaLayer.isColorPlane() &&
+             ( ( (alphaLayer.getNumComponents() == 4) && (alphaChannelIndex == 3) ) ||
+               ( (alphaLayer.getNumComponents() == 1) && (alphaChannelIndex == 0) ) ) ) {
+            ret[3] = true;
+
+            return ret;
+        }
+        break;
+    default:
+        break;
+    }
+    ret.set();
+
+    return ret;
+}
+
+
    the texture format GL_UNSIGNED_INT_8_8_8_8_REV
  **/
 static unsigned int toBGRA(unsigned char r, unsigned char g, unsigned char b, unsigned char a) WARN_UNUSED_RETURN;
@@ -182,6 +257,7 @@ ViewerInstance::ViewerInstance(NodePtr node)
     QObject::connect( this, SIGNAL(disconnectTextureRequest(int,bool)), this, SLOT(executeDisconnectTextureRequestOnMainThread(int,bool)) );
     QObject::connect( _imp.get(), SIGNAL(mustRedrawViewer()), this, SLOT(redrawViewer()) );
     QObject::connect( this, SIGNAL(s_callRedrawOnMainThread()), this, SLOT(redrawViewer()) );
+    QObject::connect( this, SIGNAL(s_renderCurrentFrameOnMainThread()), this, SLOT(onRenderCurrentFrameOnMainThreadRequested()) );
 }
 
 ViewerInstance::~ViewerInstance()
@@ -635,74 +711,138 @@ ViewerInstance::renderViewer(ViewIdx view,
     ViewerInstance::ViewerRenderRetCode ret[2] = {
         eViewerRenderRetCodeRedraw, eViewerRenderRetCodeRedraw
     };
-    for (int i = 0; i < 2; ++i) {
-        if (args[i] && args[i]->params) {
-            if ( (i == 1) && (_imp->uiContext->getCompositingOperator() == eViewerCompositingOperatorNone) ) {
-                args[i]->params->tiles.clear();
-                break;
+
+    /*
+     * In a compare mode (wipe, over, difference...) the A and B inputs are independent trees: render B in another
+     * thread while A renders in this one, so that the comparison is displayed in the time of the slowest input
+     * instead of the sum of both. When rendering on the main thread, both inputs are rendered in turn.
+     */
+    const bool renderB = args[1] && args[1]->params && (_imp->uiContext->getCompositingOperator() != eViewerCompositingOperatorNone);
+    const bool renderBConcurrently = renderB && args[0] && args[0]->params && useTLS && !singleThreaded &&
+                                     QThreadPool::globalInstance()->activeThreadCount() < QThreadPool::globalInstance()->maxThreadCount();
+    QFuture<ViewerRenderRetCode> renderBFuture;
+    if (renderBConcurrently) {
+        renderBFuture = QtConcurrent::run( boost::bind(&ViewerInstance::renderViewerInputBConcurrently, this, view, isSequentialRender, viewerHash, canAbort, rotoPaintNode, request, &args[1]) );
+    }
+    if (args[0] && args[0]->params) {
+        try {
+            ret[0] = renderViewerInput(0, view, singleThreaded, isSequentialRender, viewerHash, canAbort, rotoPaintNode, useTLS, request, stats, args[0]);
+        } catch (...) {
+            // B still uses args[1]
+            if (renderBConcurrently) {
+                renderBFuture.waitForFinished();
             }
-            assert(args[i]->params->textureIndex == i);
+            throw;
+        }
+    }
+    if (renderBConcurrently) {
+        renderBFuture.waitForFinished();
+        ret[1] = renderBFuture.result();
+    } else if (renderB) {
+        ret[1] = renderViewerInput(1, view, singleThreaded, isSequentialRender, viewerHash, canAbort, rotoPaintNode, useTLS, request, RenderStatsPtr(), args[1]);
+    } else if (args[1] && args[1]->params) {
+        args[1]->params->tiles.clear();
+    }
 
-            ///We enable render stats just for the A input (i == 0) otherwise we would get crappy results
 
-            if (!isSequentialRender) {
-                if ( !_imp->addOngoingRender(args[i]->params->textureIndex, args[i]->params->abortInfo) ) {
-                    /*
-                       This may fail if another thread already pushed a more recent render in the render ages queue
-                     */
-                    ret[i] = eViewerRenderRetCodeRedraw;
-                    args[i].reset();
-                }
-            }
-            if (args[i]) {
-                ret[i] = renderViewer_internal(view, singleThreaded, isSequentialRender, viewerHash, canAbort, rotoPaintNode, useTLS, request,
-                                               i == 0 ? stats : RenderStatsPtr(),
-                                               *args[i]);
+    if ( (ret[0] == eViewerRenderRetCodeFail) || (ret[1] == eViewerRenderRetCodeFail) ) {
+        return eViewerRenderRetCodeFail;
+    }
 
-                // Reset the rednering flag
-                args[i]->isRenderingFlag.reset();
-            }
+    return eViewerRenderRetCodeRender;
+} // ViewerInstance::renderViewer
 
-            if (ret[i] != eViewerRenderRetCodeRender) {
-                /*
-                   Either failure, black or nothing, the texture is junk, remove it from the cache
-                 */
-                if (args[i] && args[i]->params) {
-                    for (std::list<UpdateViewerParams::CachedTile>::iterator it = args[i]->params->tiles.begin(); it != args[i]->params->tiles.end(); ++it) {
-                        if (it->cachedData) {
-                            //it->cachedData->setAborted(true);
-                            //appPTR->removeFromViewerCache(it->cachedData);
-                            it->cachedData.reset();
-                        }
-                    }
-                    args[i]->params->tiles.clear();
-                }
-            }
+ViewerInstance::ViewerRenderRetCode
+ViewerInstance::renderViewerInput(int i,
+                                  ViewIdx view,
+                                  bool singleThreaded,
+                                  bool isSequentialRender,
+                                  U64 viewerHash,
+                                  bool canAbort,
+                                  const NodePtr& rotoPaintNode,
+                                  bool useTLS,
+                                  const ViewerCurrentFrameRequestSchedulerStartArgsPtr& request,
+                                  const RenderStatsPtr& stats,
+                                  ViewerArgsPtr& args)
+{
+    assert(args && args->params);
+    ViewerRenderRetCode ret = eViewerRenderRetCodeRedraw;
+    assert(args->params->textureIndex == i);
+
+    ///We enable render stats just for the A input (i == 0) otherwise we would get crappy results
+
+    if (!isSequentialRender) {
+        if ( !_imp->addOngoingRender(args->params->textureIndex, args->params->abortInfo) ) {
+            /*
+               This may fail if another thread already pushed a more recent render in the render ages queue
+             */
+            ret = eViewerRenderRetCodeRedraw;
+            args.reset();
+        }
+    }
+    if (args) {
+        ret = renderViewer_internal(view, singleThreaded, isSequentialRender, viewerHash, canAbort, rotoPaintNode, useTLS, request,
+                                    i == 0 ? stats : RenderStatsPtr(),
+                                    *args);
 
-            if (!isSequentialRender && args[i] && args[i]->params) {
-                if ( (ret[i] == eViewerRenderRetCodeFail) || (ret[i] == eViewerRenderRetCodeBlack) ) {
-                    _imp->checkAndUpdateDisplayAge( args[i]->params->textureIndex, args[i]->params->abortInfo->getRenderAge() );
-                }
-                _imp->removeOngoingRender( args[i]->params->textureIndex, args[i]->params->abortInfo->getRenderAge() );
-            }
+        // Reset the rednering flag
+        args->isRenderingFlag.reset();
+    }
 
-            if (ret[i] == eViewerRenderRetCodeBlack) {
-                disconnectTexture(args[i]->params->textureIndex, false);
+    if (ret != eViewerRenderRetCodeRender) {
+        /*
+           Either failure, black or nothing, the texture is junk, remove it from the cache
+         */
+        if (args && args->params) {
+            for (std::list<UpdateViewerParams::CachedTile>::iterator it = args->params->tiles.begin(); it != args->params->tiles.end(); ++it) {
+                if (it->cachedData) {
+                    //it->cachedData->setAborted(true);
+                    //appPTR->removeFromViewerCache(it->cachedData);
+                    it->cachedData.reset();
+                }
             }
+            args->params->tiles.clear();
+        }
+    }
 
-            if (ret[i] == eViewerRenderRetCodeFail) {
-                args[i].reset();
-            }
+    if (!isSequentialRender && args && args->params) {
+        if ( (ret == eViewerRenderRetCodeFail) || (ret == eViewerRenderRetCodeBlack) ) {
+            _imp->checkAndUpdateDisplayAge( args->params->textureIndex, args->params->abortInfo->getRenderAge() );
         }
+        _imp->removeOngoingRender( args->params->textureIndex, args->params->abortInfo->getRenderAge() );
+    }
+
+    if (ret == eViewerRenderRetCodeBlack) {
+        disconnectTexture(args->params->textureIndex, false);
     }
 
+    if (ret == eViewerRenderRetCodeFail) {
+        args.reset();
+    }
+
+    return ret;
+} // ViewerInstance::renderViewerInput
+
+ViewerInstance::ViewerRenderRetCode
+ViewerInstance::renderViewerInputBConcurrently(ViewIdx view,
+                                               bool isSequentialRender,
+                                               U64 viewerHash,
+                                               bool canAbort,
+                                               const NodePtr& rotoPaintNode,
+                                               const ViewerCurrentFrameRequestSchedulerStartArgsPtr& request,
+                                               ViewerArgsPtr* args)
+{
+    try {
+        return renderViewerInput(1, view, false, isSequentialRender, viewerHash, canAbort, rotoPaintNode, true, request, RenderStatsPtr(), *args);
+    } catch (...) {
+        if (*args && (*args)->params) {
+            (*args)->params->tiles.clear();
+        }
+        args->reset();
 
-    if ( (ret[0] == eViewerRenderRetCodeFail) || (ret[1] == eViewerRenderRetCodeFail) ) {
         return eViewerRenderRetCodeFail;
     }
-
-    return eViewerRenderRetCodeRender;
-} // ViewerInstance::renderViewer
+}
 
 static bool
 checkTreeCanRender_internal(Node* node,
@@ -765,6 +905,22 @@ getTexPixel(int x,
     }
 }
 
+/**
+ * @brief Allocates the RAM buffer of a tile that is not cached from the ImageBufferPool. The previous frame most likely
+ * released a buffer of the same size class, so the conversion does not have to map and fault in a full frame of fresh memory.
+ **/
+static void
+allocateUncachedTileBuffer(UpdateViewerParams* params,
+                           UpdateViewerParams::CachedTile* tile)
+{
+    try {
+        tile->ramBuffer = (unsigned char*)ImageBufferPool::allocate(tile->bytesCount, &params->ramBufferPoolSize);
+    } catch (const std::bad_alloc&) {
+        tile->ramBuffer = 0;
+        params->ramBufferPoolSize = 0;
+    }
+}
+
 static bool
 copyAndSwap(const TextureRect& srcRect,
             const TextureRect& dstRect,
@@ -810,6 +966,56 @@ copyAndSwap(const TextureRect& srcRect,
     return true;
 }
 
+/**
+ * @brief Covers the tiles that are not cached with non-overlapping rectangles: tiles are first merged into runs along
+ * each row of tiles, then runs spanning the same columns on consecutive rows are merged. After a pan the tiles that
+ * came into view form strips along the edges of the viewport, whose bounding box would also contain the cached tiles.
+ **/
+static void
+getUncachedTilesRects(const std::list<UpdateViewerParams::CachedTile>& tiles,
+                      std::vector<RectI>* rects)
+{
+    std::vector<RectI> uncached;
+    for (std::list<UpdateViewerParams::CachedTile>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+        if (!it->ramBuffer) {
+            uncached.push_back(it->rectRounded);
+        }
+    }
+    // sort by row, then by column
+    std::vector<std::pair<std::pair<int, int>, std::size_t> > order( uncached.size() );
+    for (std::size_t i = 0; i < uncached.size(); ++i) {
+        order[i] = std::make_pair(std::make_pair(uncached[i].y1, uncached[i].x1), i);
+    }
+    std::sort( order.begin(), order.end() );
+
+    rects->clear();
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        const RectI& tile = uncached[order[i].second];
+        if ( !rects->empty() && (rects->back().y1 == tile.y1) && (rects->back().x2 == tile.x1) ) {
+            rects->back().x2 = tile.x2;
+        } else {
+            rects->push_back(tile);
+        }
+    }
+
+    // merge each run with a rectangle of the previous rows ending right above it with the same columns
+    std::vector<RectI> merged;
+    for (std::vector<RectI>::const_iterator it = rects->begin(); it != rects->end(); ++it) {
+        bool found = false;
+        for (std::vector<RectI>::iterator it2 = merged.begin(); it2 != merged.end(); ++it2) {
+            if ( (it2->y2 == it->y1) && (it2->x1 == it->x1) && (it2->x2 == it->x2) ) {
+                it2->y2 = it->y2;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            merged.push_back(*it);
+        }
+    }
+    rects->swap(merged);
+} // getUncachedTilesRects
+
 ViewerInstance::ViewerRenderRetCode
 ViewerInstance::getRenderViewerArgsAndCheckCache_public(SequenceTime time,
                                                         bool isSequential,
@@ -841,9 +1047,11 @@ ViewerInstance::setupMinimalUpdateViewerParams(const SequenceTime time,
 {
     assert(_imp->uiContext);
 
+    unsigned int playbackDraftLevel;
     {
         QMutexLocker l(&_imp->viewerParamsMutex);
         outArgs->mipmapLevelWithoutDraft = (unsigned int)_imp->viewerMipMapLevel;
+        playbackDraftLevel = isSequential ? _imp->playbackDraftMipMapLevel : 0;
     }
 
     assert(_imp->uiContext);
@@ -869,7 +1077,7 @@ ViewerInstance::setupMinimalUpdateViewerParams(const SequenceTime time,
     }
     outArgs->mipMapLevelWithDraft = outArgs->mipmapLevelWithoutDraft;
 
-    outArgs->draftModeEnabled = getApp()->isDraftRenderEnabled();
+    outArgs->draftModeEnabled = !outArgs->isDraftRefinement && getApp()->isDraftRenderEnabled();
 
     // If draft mode is enabled, compute the mipmap level according to the auto-proxy setting in the preferences
     if ( outArgs->draftModeEnabled && appPTR->getCurrentSettings()->isAutoProxyEnabled() ) {
@@ -886,6 +1094,13 @@ ViewerInstance::setupMinimalUpdateViewerParams(const SequenceTime time,
         outArgs->mipMapLevelWithDraft = (unsigned int)std::max( (int)outArgs->mipmapLevelWithoutDraft, (int)autoProxyLevel );
     }
 
+    // During playback the scheduler lowers the quality when rendering cannot keep up with the requested frame rate.
+    // The cache is still looked up at full quality first, @see getRoDAndLookupCache
+    if ( (playbackDraftLevel > 0) && !outArgs->isDraftRefinement ) {
+        outArgs->draftModeEnabled = true;
+        outArgs->mipMapLevelWithDraft = std::max(outArgs->mipMapLevelWithDraft, outArgs->mipmapLevelWithoutDraft + playbackDraftLevel);
+    }
+
 
     // The hash of the node to render, we store it and make sure we never call getHash() again for the render of this frame
     outArgs->activeInputHash = outArgs->activeInputToRender->getHash();
@@ -1017,9 +1232,7 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
                     tile.rect.par = outArgs->params->pixelAspectRatio;
                     tile.bytesCount = tile.rect.area() * 4;
                     assert(tile.bytesCount > 0);
-                    if (outArgs->params->depth == eImageBitDepthFloat) {
-                        tile.bytesCount *= sizeof(float);
-                    }
+                    tile.bytesCount *= getSizeOfForBitDepth(outArgs->params->depth);
                     outArgs->params->tiles.push_back(tile);
                 }
             }
@@ -1031,9 +1244,7 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
                 tile.rect.par = outArgs->params->pixelAspectRatio;
                 tile.bytesCount = tile.rect.area() * 4;
                 assert(tile.bytesCount > 0);
-                if (outArgs->params->depth == eImageBitDepthFloat) {
-                    tile.bytesCount *= sizeof(float);
-                }
+                tile.bytesCount *= getSizeOfForBitDepth(outArgs->params->depth);
                 outArgs->params->tiles.push_back(tile);
             }
         }
@@ -1053,11 +1264,9 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
             tile.rect.par = outArgs->params->pixelAspectRatio;
             tile.bytesCount = outArgs->params->tileSize * outArgs->params->tileSize * 4; // RGBA
             assert( outArgs->params->roi.contains(tile.rect) );
-            // If we are using floating point textures, multiply by size of float
+            // If we are using floating point textures, multiply by size of a component
             assert(tile.bytesCount > 0);
-            if (outArgs->params->depth == eImageBitDepthFloat) {
-                tile.bytesCount *= sizeof(float);
-            }
+            tile.bytesCount *= getSizeOfForBitDepth(outArgs->params->depth);
             outArgs->params->tiles.push_back(tile);
         }
     }
@@ -1077,8 +1286,41 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
     // Texture rect contains the pixel coordinates in the image to be rendered
 
     if (useCache) {
+        // When part of the viewer cache is on disk, bring the textures of the next frames back in RAM in the background,
+        // so that the playback or the scrubbing does not wait for the disk when it reaches them
+        int prefetchDirection = 0;
+        if ( !outArgs->forceRender && appPTR->hasViewerCacheEntriesOnDisk() ) {
+            if (outArgs->params->isSequential) {
+                prefetchDirection = getRenderEngine()->getSequentialRenderDirection() == eRenderDirectionBackward ? -1 : 1;
+            } else {
+                QMutexLocker k(&_imp->viewerParamsMutex);
+                prefetchDirection = outArgs->params->time < _imp->lastCurrentFrameLookupTime ? -1 : 1;
+                _imp->lastCurrentFrameLookupTime = outArgs->params->time;
+            }
+        }
+        std::vector<FrameKey> prefetchKeys;
+
         FrameEntryLocker entryLocker(_imp.get());
         for (std::list<UpdateViewerParams::CachedTile>::iterator it = outArgs->params->tiles.begin(); it != outArgs->params->tiles.end(); ++it) {
+            // The tiles of the next frames have the same key but for the time
+            for (int i = 1; prefetchDirection != 0 && i <= NATRON_VIEWER_CACHE_PREFETCH_FRAMES; ++i) {
+                prefetchKeys.push_back( FrameKey(getNode().get(),
+                                                 outArgs->params->time + i * prefetchDirection,
+                                                 viewerHash,
+                                                 outArgs->params->gain,
+                                                 outArgs->params->gamma,
+                                                 outArgs->params->lut,
+                                                 (int)outArgs->params->depth,
+                                                 getTextureDisplayChannels(outArgs->channels, outArgs->params->depth),
+                                                 outArgs->params->view,
+                                                 it->rect,
+                                                 mipmapLevel,
+                                                 inputToRenderName,
+                                                 outArgs->params->layer,
+                                                 outArgs->params->alphaLayer.getPlaneID() + outArgs->params->alphaChannelName,
+                                                 isTextureProcessedByShader(outArgs->params->depth),
+                                                 isDraftMode) );
+            }
             FrameKey key(getNode().get(),
                          outArgs->params->time,
                          viewerHash,
@@ -1086,14 +1328,14 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
                          outArgs->params->gamma,
                          outArgs->params->lut,
                          (int)outArgs->params->depth,
-                         outArgs->channels,
+                         getTextureDisplayChannels(outArgs->channels, outArgs->params->depth),
                          outArgs->params->view,
                          it->rect,
                          mipmapLevel,
                          inputToRenderName,
                          outArgs->params->layer,
                          outArgs->params->alphaLayer.getPlaneID() + outArgs->params->alphaChannelName,
-                         outArgs->params->depth == eImageBitDepthFloat,
+                         isTextureProcessedByShader(outArgs->params->depth),
                          isDraftMode);
             std::list<FrameEntryPtr> entries;
             bool hasTextureCached = appPTR->getTexture(key, &entries);
@@ -1149,6 +1391,9 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
                 ++outArgs->params->nbCachedTile;
             }
         }
+        if ( !prefetchKeys.empty() ) {
+            getRenderEngine()->prefetchViewerCache(prefetchKeys);
+        }
     }
 
 
@@ -1389,6 +1634,9 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
     const bool useTextureCache = !inArgs.forceRender && !inArgs.userRoIEnabled && !inArgs.autoContrast && rotoPaintNode.get() == 0 && !inArgs.isDoingPartialUpdates;
     RectI roi = inArgs.params->roi;
 
+    // The tiles left to render, when they are not a single rectangle
+    std::vector<RectI> uncachedTilesRects;
+
     // We might already have some tiles cached, get their bounding box to see if it is less than the actual RoI
     if (useTextureCache) {
         RectI tilesBbox;
@@ -1409,6 +1657,14 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
         }
         if ( roi.contains(tilesBbox) ) {
             roi = tilesBbox;
+
+            // When only some of the tiles are cached (e.g. after a pan), render only the strips of tiles that are missing
+            if (inArgs.params->nbCachedTile > 0) {
+                getUncachedTilesRects(inArgs.params->tiles, &uncachedTilesRects);
+                if (uncachedTilesRects.size() <= 1) {
+                    uncachedTilesRects.clear();
+                }
+            }
         }
     }
 
@@ -1485,12 +1741,23 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
         return eViewerRenderRetCodeBlack;
     }
 
+    {
+        // When a single channel is baked in the texture, the input node only needs to process that channel
+        ParallelRenderArgsPtr inputFrameArgs = inArgs.activeInputToRender->getParallelRenderArgsTLS();
+        if (inputFrameArgs) {
+            inputFrameArgs->requestedChannels = getRequestedChannelsForDisplay(getTextureDisplayChannels(inArgs.channels, inArgs.params->depth),
+                                                                               inArgs.params->layer, inArgs.params->alphaLayer, alphaChannelIndex);
+        }
+    }
+
     EffectInstance::NotifyInputNRenderingStarted_RAII inputNIsRendering_RAII(getNode().get(), inArgs.activeInputIndex);
     std::vector<RectI> splitRoi;
     if (inArgs.isDoingPartialUpdates) {
         for (std::list<UpdateViewerParams::CachedTile>::iterator it = inArgs.params->tiles.begin(); it != inArgs.params->tiles.end(); ++it) {
             splitRoi.push_back(it->rect);
         }
+    } else if ( !uncachedTilesRects.empty() ) {
+        splitRoi = uncachedTilesRects;
     } else {
         /*
            Just render 1 tile
@@ -1525,7 +1792,10 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
             channelsRendered[3] = true;
             break;
         }
-        stats->setGlobalRenderInfosForNode(getNode(), inArgs.params->rod, inArgs.params->srcPremult, channelsRendered, true, true, inArgs.params->mipMapLevel);
+        stats->setGlobalRenderInfosForNode(getNode(), inArgs.params->rod, inArgs.params->srcPremult, channelsRendered, true, true, inArgs.params->mipMapLevel, eRenderSafetyFullySafe);
+        if (inArgs.activeInputToRender) {
+            stats->addInputDependencyForNode( getNode(), inArgs.activeInputToRender->getNode() );
+        }
     }
 
 #pragma message WARN("Implement Viewer so it accepts OpenGL Textures in input")
@@ -1647,15 +1917,15 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
             UpdateViewerParams::CachedTile tile;
             tile.rect.set(viewerRenderRoI);
             tile.rectRounded = viewerRenderRoI;
-            std::size_t pixelSize = 4;
-            if (updateParams->depth == eImageBitDepthFloat) {
-                pixelSize *= sizeof(float);
-            }
+            std::size_t pixelSize = 4 * getSizeOfForBitDepth(updateParams->depth);
             std::size_t dstRowSize = tile.rect.width() * pixelSize;
             tile.bytesCount = tile.rect.height() * dstRowSize;
-            tile.ramBuffer =  (unsigned char*)malloc(tile.bytesCount);
+            allocateUncachedTileBuffer(updateParams.get(), &tile);
             updateParams->tiles.clear();
             updateParams->tiles.push_back(tile);
+            if (!tile.ramBuffer) {
+                return eViewerRenderRetCodeFail;
+            }
         }
 
         // Allocate the texture on the CPU to apply the render viewer process
@@ -1749,7 +2019,10 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                 assert(updateParams->tiles.size() == 1);
 
                 updateParams->mustFreeRamBuffer = true;
-                tile.ramBuffer =  (unsigned char*)malloc(tile.bytesCount);
+                allocateUncachedTileBuffer(updateParams.get(), &tile);
+                if (!tile.ramBuffer) {
+                    return eViewerRenderRetCodeFail;
+                }
                 unCachedTiles.push_back(tile);
             }
         } else { // useTextureCache
@@ -1774,6 +2047,10 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
             }
             std::string inputToRenderName = inArgs.activeInputToRender->getNode()->getScriptName_mt_safe();
             for (std::list<UpdateViewerParams::CachedTile>::iterator it = updateParams->tiles.begin(); it != updateParams->tiles.end(); ++it) {
+                if ( !it->isCached && (splitRoi.size() > 1) && !splitRoi[rectIndex].contains(it->rectRounded) ) {
+                    // This tile is rendered with another rectangle
+                    continue;
+                }
                 if (it->isCached) {
                     assert(it->ramBuffer);
                 } else {
@@ -1787,14 +2064,14 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                                  inArgs.params->gamma,
                                  inArgs.params->lut,
                                  (int)inArgs.params->depth,
-                                 inArgs.channels,
+                                 getTextureDisplayChannels(inArgs.channels, inArgs.params->depth),
                                  inArgs.params->view,
                                  it->rect,
                                  inArgs.params->mipMapLevel,
                                  inputToRenderName,
                                  inArgs.params->layer,
                                  inArgs.params->alphaLayer.getPlaneID() + inArgs.params->alphaChannelName,
-                                 inArgs.params->depth == eImageBitDepthFloat,
+                                 isTextureProcessedByShader(inArgs.params->depth),
                                  inArgs.draftModeEnabled);
 
 
@@ -1856,7 +2133,7 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
 
         std::size_t tileRowElements = inArgs.params->tileSize;
         // Internally the buffer is interpreted as U32 when 8bit, so we do not multiply it by 4 for RGBA
-        if (updateParams->depth == eImageBitDepthFloat) {
+        if ( isTextureProcessedByShader(updateParams->depth) ) {
             tileRowElements *= 4;
         }
 
@@ -1878,7 +2155,7 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
 
             const RenderViewerArgs args(colorImage,
                                         alphaImage,
-                                        inArgs.channels,
+                                        getTextureDisplayChannels(inArgs.channels, updateParams->depth),
                                         updateParams->srcPremult,
                                         updateParams->depth,
                                         updateParams->gain,
@@ -1946,7 +2223,7 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
 
             const RenderViewerArgs args(colorImage,
                                         alphaImage,
-                                        inArgs.channels,
+                                        getTextureDisplayChannels(inArgs.channels, updateParams->depth),
                                         updateParams->srcPremult,
                                         updateParams->depth,
                                         updateParams->gain,
@@ -2038,6 +2315,9 @@ renderFunctor(const RectI& roi,
     if ( (args.bitDepth == eImageBitDepthFloat) ) {
         // image is stored as linear, the OpenGL shader with do gamma/sRGB/Rec709 decompression, as well as gain and offset
         scaleToTexture32bits(roi, args, tile, (float*)tile.ramBuffer);
+    } else if (args.bitDepth == eImageBitDepthHalf) {
+        // same as above, with components stored as half-floats
+        scaleToTexture16bitsHalf(roi, args, tile, (unsigned short*)tile.ramBuffer);
     } else {
         // texture is stored as sRGB/Rec709 compressed 8-bit RGBA
         scaleToTexture8bits(roi, args, viewer, tile, (U32*)tile.ramBuffer);
@@ -2197,14 +2477,14 @@ scaleToTexture8bits_generic(const RectI& roi,
     const int x2 = args.renderOnlyRoI ? roi.x2 : tile.rect.x2;
     const PIX* src_pixels = (const PIX*)acc.pixelAt(x1, y1);
     const int srcRowElements = (int)args.inputImage->getRowElements();
-    Image::ReadAccessPtr matteAcc;
-    if (applyMatte) {
-        matteAcc = boost::make_shared<Image::ReadAccess>( args.matteImage.get() );
-    }
+    Image::ReadAccess matteAcc( applyMatte ? args.matteImage.get() : 0 );
+    const Image::ConstPixelSpan matteSpan = applyMatte ? matteAcc.channelSpanAt( args.alphaChannelIndex, RectI(x1, y1, x2, y2) ) : Image::ConstPixelSpan();
+    const int matteStep = (int)( matteSpan.pixelStride / sizeof(PIX) );
 
     for (int y = y1; y < y2;
          ++y,
          dst_pixels += dstRowElements) {
+        const PIX* matte_row = matteSpan.containsRow(y) ? matteSpan.rowAt<const PIX>(y) : 0;
         // coverity[dont_call]
         int start = (int)( rand() % (x2 - x1) );
 
@@ -2353,9 +2633,10 @@ scaleToTexture8bits_generic(const RectI& roi,
                             break;
                         }
                     } else {
-                        const PIX* src_pixels = (const PIX*)matteAcc->pixelAt(x1 + index, y);
-                        if (src_pixels) {
-                            alphaMatteValue = (double)src_pixels[args.alphaChannelIndex];
+                        const int matteX = x1 + index;
+                        const PIX* matte_pixels = ( matte_row && (matteX >= matteSpan.bounds.x1) && (matteX < matteSpan.bounds.x2) ) ? matte_row + (matteX - matteSpan.bounds.x1) * matteStep : 0;
+                        if (matte_pixels) {
+                            alphaMatteValue = (double)*matte_pixels;
                             switch (pixelSize) {
                             case sizeof(unsigned char):     //byte
                                 alphaMatteValue = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)r );
@@ -2593,11 +2874,7 @@ scaleToTexture32bitsGeneric(const RectI& roi,
     const bool luminance = (args.channels == eDisplayChannelsY);
     const int dstRowElements = args.renderOnlyRoI ? tile.rect.width() * 4 : args.tileRowElements;
     Image::ReadAccess acc = Image::ReadAccess( args.inputImage.get() );
-    Image::ReadAccessPtr matteAcc;
-
-    if (applyMatte) {
-        matteAcc = boost::make_shared<Image::ReadAccess>( args.matteImage.get() );
-    }
+    Image::ReadAccess matteAcc( applyMatte ? args.matteImage.get() : 0 );
 
     assert( (args.renderOnlyRoI && roi.x1 >= tile.rect.x1 && roi.x2 <= tile.rect.x2 && roi.y1 >= tile.rect.y1 && roi.y2 <= tile.rect.y2) || (!args.renderOnlyRoI && tile.rect.x1 >= roi.x1 && tile.rect.x2 <= roi.x2 && tile.rect.y1 >= roi.y1 && tile.rect.y2 <= roi.y2) );
     assert(tile.rect.x2 > tile.rect.x1);
@@ -2615,10 +2892,13 @@ scaleToTexture32bitsGeneric(const RectI& roi,
     const int x2 = args.renderOnlyRoI ? roi.x2 : tile.rect.x2;
     const float* src_pixels = (const float*)acc.pixelAt(x1, y1);
     const int srcRowElements = (const int)args.inputImage->getRowElements();
+    const Image::ConstPixelSpan matteSpan = applyMatte ? matteAcc.channelSpanAt( args.alphaChannelIndex, RectI(x1, y1, x2, y2) ) : Image::ConstPixelSpan();
+    const int matteStep = (int)( matteSpan.pixelStride / sizeof(PIX) );
 
     for (int y = y1; y < y2;
          ++y,
          dst_pixels += dstRowElements) {
+        const PIX* matte_row = matteSpan.containsRow(y) ? matteSpan.rowAt<const PIX>(y) : 0;
         for (int x = 0; x < (x2 - x1);
              ++x) {
             double r = 0.;
@@ -2721,9 +3001,10 @@ scaleToTexture32bitsGeneric(const RectI& roi,
                         break;
                     }
                 } else {
-                    const PIX* src_pixels = (const PIX*)matteAcc->pixelAt(x, y);
-                    if (src_pixels) {
-                        alphaMatteValue = (double)src_pixels[args.alphaChannelIndex];
+                    const int matteX = x1 + x;
+                    const PIX* matte_pixels = ( matte_row && (matteX >= matteSpan.bounds.x1) && (matteX < matteSpan.bounds.x2) ) ? matte_row + (matteX - matteSpan.bounds.x1) * matteStep : 0;
+                    if (matte_pixels) {
+                        alphaMatteValue = (double)*matte_pixels;
                         switch (pixelSize) {
                         case sizeof(unsigned char):     //byte
                             alphaMatteValue = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)r );
@@ -2904,6 +3185,95 @@ scaleToTexture32bits(const RectI& roi,
     }
 } // scaleToTexture32bits
 
+/**
+ * @brief Rounds a float to the nearest half-float (IEEE 754 binary16), ties to even. Overflows give
+ * infinity and NaNs stay NaNs, as with the F16C instructions.
+ **/
+static inline unsigned short
+floatToHalf(float f)
+{
+    union
+    {
+        float f;
+        U32 u;
+    } bits;
+
+    bits.f = f;
+    const U32 sign = (bits.u >> 16) & 0x8000;
+    const U32 absBits = bits.u & 0x7fffffff;
+
+    if (absBits >= 0x47800000) { // >= 65536: infinity or NaN
+        return (unsigned short)( sign | ( (absBits > 0x7f800000) ? 0x7e00 : 0x7c00 ) );
+    }
+    if (absBits < 0x38800000) { // < 2^-14: denormal or zero
+        if (absBits < 0x33000000) { // <= 2^-25 rounds to zero
+            return (unsigned short)sign;
+        }
+        const U32 mantissa = (absBits & 0x7fffff) | 0x800000;
+        const int shift = 126 - (int)(absBits >> 23);
+        U32 result = mantissa >> shift;
+        const U32 remainder = mantissa & ( (1u << shift) - 1 );
+        const U32 halfway = 1u << (shift - 1);
+        if ( (remainder > halfway) || ( (remainder == halfway) && (result & 1) ) ) {
+            ++result;
+        }
+
+        return (unsigned short)(sign | result);
+    }
+    // rebias the exponent from 127 to 15, rounding may carry into the exponent (up to infinity)
+    U32 result = (absBits - 0x38000000) >> 13;
+    const U32 remainder = absBits & 0x1fff;
+    if ( (remainder > 0x1000) || ( (remainder == 0x1000) && (result & 1) ) ) {
+        ++result;
+    }
+
+    return (unsigned short)(sign | result);
+}
+
+static void
+convertFloatToHalf(const float* src,
+                   unsigned short* dst,
+                   std::size_t count)
+{
+    std::size_t i = 0;
+
+#ifdef __F16C__
+    for (; i + 4 <= count; i += 4) {
+        _mm_storel_epi64( (__m128i*)(dst + i), _mm_cvtps_ph(_mm_loadu_ps(src + i), 0 /*round to nearest even*/) );
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = floatToHalf(src[i]);
+    }
+}
+
+void
+scaleToTexture16bitsHalf(const RectI& roi,
+                         const RenderViewerArgs & args,
+                         const UpdateViewerParams::CachedTile& tile,
+                         unsigned short *output)
+{
+    // The float conversion writes the same elements of a float buffer laid out like the tile:
+    // convert the rows it wrote to half-floats.
+    const std::size_t tileElements = tile.bytesCount / sizeof(unsigned short);
+    std::vector<float> floatBuffer(tileElements);
+    scaleToTexture32bits(roi, args, tile, &floatBuffer.front());
+
+    const int dstRowElements = args.renderOnlyRoI ? tile.rect.width() * 4 : args.tileRowElements;
+    std::size_t offset;
+    if (args.renderOnlyRoI) {
+        offset = (roi.y1 - tile.rect.y1) * dstRowElements + (roi.x1 - tile.rect.x1) * 4;
+    } else {
+        offset = (tile.rect.y1 - tile.rectRounded.y1) * dstRowElements + (tile.rect.x1 - tile.rectRounded.x1) * 4;
+    }
+    const int height = args.renderOnlyRoI ? roi.height() : tile.rect.height();
+    const int rowElements = ( args.renderOnlyRoI ? roi.width() : tile.rect.width() ) * 4;
+    for (int y = 0; y < height; ++y, offset += dstRowElements) {
+        assert(offset + rowElements <= tileElements);
+        convertFloatToHalf(&floatBuffer[offset], output + offset, rowElements);
+    }
+}
+
 void
 ViewerInstance::ViewerInstancePrivate::updateViewer(UpdateViewerParamsPtr params)
 {
@@ -3074,6 +3444,21 @@ ViewerInstance::getViewerMipMapLevel() const
     return _imp->viewerMipMapLevel;
 }
 
+void
+ViewerInstance::setPlaybackDraftMipMapLevel(unsigned int level)
+{
+    QMutexLocker l(&_imp->viewerParamsMutex);
+
+    _imp->playbackDraftMipMapLevel = level;
+}
+
+void
+ViewerInstance::onRenderCurrentFrameOnMainThreadRequested()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    renderCurrentFrame(true);
+}
+
 void
 ViewerInstance::onMipMapLevelChanged(int level)
 {
@@ -3146,26 +3531,27 @@ ViewerInstance::setDisplayChannels(DisplayChannelsEnum channels,
     assert( qApp && qApp->thread() == QThread::currentThread() );
 
     bool changed = false;
+    // Switching between channels that the shader extracts from the RGB texture only needs a redraw
+    bool mustRender = false;
     {
         QMutexLocker l(&_imp->viewerParamsMutex);
-        if (!bothInputs) {
-            if (_imp->viewerParamsChannels[0] != channels) {
-                _imp->viewerParamsChannels[0] = channels;
-                changed = true;
-            }
-        } else {
-            if (_imp->viewerParamsChannels[0] != channels) {
-                _imp->viewerParamsChannels[0] = channels;
-                changed = true;
-            }
-            if (_imp->viewerParamsChannels[1] != channels) {
-                _imp->viewerParamsChannels[1] = channels;
+        const bool shaderExtractsChannels = _imp->uiContext && isTextureProcessedByShader( _imp->uiContext->getBitDepth() ) && !_imp->viewerParamsAutoContrast;
+        for (int i = 0; i < (bothInputs ? 2 : 1); ++i) {
+            if (_imp->viewerParamsChannels[i] != channels) {
+                if ( !shaderExtractsChannels || !isDisplayChannelsAppliedByShader(_imp->viewerParamsChannels[i]) || !isDisplayChannelsAppliedByShader(channels) ) {
+                    mustRender = true;
+                }
+                _imp->viewerParamsChannels[i] = channels;
                 changed = true;
             }
         }
     }
     if ( changed && !getApp()->getProject()->isLoadingProject() ) {
-        renderCurrentFrame(true);
+        if (mustRender) {
+            renderCurrentFrame(true);
+        } else {
+            _imp->uiContext->redraw();
+        }
     }
 }
 
@@ -3289,6 +3675,26 @@ ViewerInstance::getChannels(int texIndex) const
     return _imp->viewerParamsChannels[texIndex];
 }
 
+bool
+ViewerInstance::isDisplayChannelsAppliedByShader(DisplayChannelsEnum channels)
+{
+    switch (channels) {
+    case eDisplayChannelsRGB:
+    case eDisplayChannelsR:
+    case eDisplayChannelsG:
+    case eDisplayChannelsB:
+    case eDisplayChannelsY:
+
+        return true;
+    case eDisplayChannelsA:
+    case eDisplayChannelsMatte:
+    default:
+        // These fetch the alpha layer
+
+        return false;
+    }
+}
+
 void
 ViewerInstance::setFullFrameProcessingEnabled(bool fullFrame)
 {
@@ -61,6 +61,7 @@ public:
     bool userRoIEnabled;
     bool mustComputeRoDAndLookupCache;
     bool isDoingPartialUpdates;
+    bool isDraftRefinement; // set by the caller: render at full quality even though the draft mode is enabled
 };
 
 class ViewerInstance
@@ -242,6 +243,12 @@ public:
 
     DisplayChannelsEnum getChannels(int texIndex) const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Returns true if, with floating-point textures, the viewer shader extracts these channels from the RGB texture.
+     * The texture and its cache entry then do not depend on them.
+     **/
+    static bool isDisplayChannelsAppliedByShader(DisplayChannelsEnum channels) WARN_UNUSED_RETURN;
+
     void setFullFrameProcessingEnabled(bool fullFrame);
     bool isFullFrameProcessingEnabled() const;
 
@@ -333,6 +340,17 @@ public:
 
     unsigned int getViewerMipMapLevel() const;
 
+    /**
+     * @brief Set by the playback scheduler: number of mipmap levels below the viewer mipmap level at which frames
+     * that are not cached are rendered during playback, in draft mode. 0 renders at full quality.
+     **/
+    void setPlaybackDraftMipMapLevel(unsigned int level);
+
+    /**
+     * @brief Can be called from any thread: re-renders the current frame on the main-thread.
+     **/
+    void renderCurrentFrameOnMainThread() { Q_EMIT s_renderCurrentFrameOnMainThread(); }
+
 public Q_SLOTS:
 
 
@@ -346,6 +364,8 @@ public Q_SLOTS:
 
     void redrawViewerNow();
 
+    void onRenderCurrentFrameOnMainThreadRequested();
+
 
     void executeDisconnectTextureRequestOnMainThread(int index, bool clearRoD);
 
@@ -356,6 +376,8 @@ Q_SIGNALS:
 
     void s_callRedrawOnMainThread();
 
+    void s_renderCurrentFrameOnMainThread();
+
     void viewerDisconnected();
 
     void clipPreferencesChanged();
@@ -421,6 +443,33 @@ private:
     /*******************************************/
 
 
+    /**
+     * @brief Renders the input i (A or B) of renderViewer(). args is reset if the render fails.
+     **/
+    ViewerRenderRetCode renderViewerInput(int i,
+                                          ViewIdx view,
+                                          bool singleThreaded,
+                                          bool isSequentialRender,
+                                          U64 viewerHash,
+                                          bool canAbort,
+                                          const NodePtr& rotoPaintNode,
+                                          bool useTLS,
+                                          const ViewerCurrentFrameRequestSchedulerStartArgsPtr& request,
+                                          const RenderStatsPtr& stats,
+                                          ViewerArgsPtr& args) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Renders the B input with renderViewerInput() from another thread than the A input. Exceptions are turned
+     * into eViewerRenderRetCodeFail since they cannot cross the thread boundary.
+     **/
+    ViewerRenderRetCode renderViewerInputBConcurrently(ViewIdx view,
+                                                       bool isSequentialRender,
+                                                       U64 viewerHash,
+                                                       bool canAbort,
+                                                       const NodePtr& rotoPaintNode,
+                                                       const ViewerCurrentFrameRequestSchedulerStartArgsPtr& request,
+                                                       ViewerArgsPtr* args);
+
     ViewerRenderRetCode renderViewer_internal(ViewIdx view,
                                               bool singleThreaded,
                                               bool isSequentialRender,
@@ -141,6 +141,8 @@ public:
         , viewerParamsAlphaLayer( ImagePlaneDesc::getRGBAComponents() )
         , viewerParamsAlphaChannelName("a")
         , viewerMipMapLevel(0)
+        , playbackDraftMipMapLevel(0)
+        , lastCurrentFrameLookupTime(0)
         , fullFrameProcessingEnabled(false)
         , activateInputChangedFromViewer(false)
         , gammaLookupMutex()
@@ -388,6 +390,8 @@ public:
     ImagePlaneDesc viewerParamsAlphaLayer;
     std::string viewerParamsAlphaChannelName;
     unsigned int viewerMipMapLevel; //< the mipmap level the viewer should render at (0 == no downscaling)
+    unsigned int playbackDraftMipMapLevel; //< extra mipmap levels for the frames rendered during playback, set by the ViewerDisplayScheduler
+    SequenceTime lastCurrentFrameLookupTime; //< the time of the last texture lookup outside of playback, to guess the direction of scrubbing
     bool fullFrameProcessingEnabled;
 
     ///Only accessed from MT
@@ -424,6 +424,12 @@ enum ImageFieldingOrderEnum
     eImageFieldingOrderUpper, // rows 1, 3 ...
 };
 
+enum ImagePixelLayoutEnum
+{
+    eImagePixelLayoutPacked = 0, // RGBARGBA...
+    eImagePixelLayoutPlanar, // RR...GG...BB...AA..., one plane per channel
+};
+
 enum ViewerCompositingOperatorEnum
 {
     eViewerCompositingOperatorNone,
@@ -254,6 +254,9 @@ NATRON_VERSION_STRINGIZE__(major, minor)
 
 #define NATRON_PLUGIN_PATH_ENV_VAR "NATRON_PLUGIN_PATH"
 #define NATRON_DISK_CACHE_PATH_ENV_VAR "NATRON_DISK_CACHE_PATH"
+#define NATRON_SHARED_DISK_CACHE_PATH_ENV_VAR "NATRON_SHARED_DISK_CACHE_PATH"
+#define NATRON_RENDER_TRACE_FILE_ENV_VAR "NATRON_RENDER_TRACE_FILE"
+#define NATRON_RENDER_REQUEST_LOG_FILE_ENV_VAR "NATRON_RENDER_REQUEST_LOG_FILE"
 #define NATRON_IMAGES_PATH ":/Resources/Images/"
 #define NATRON_APPLICATION_ICON_PATH NATRON_IMAGES_PATH "natronIcon256_linux.png"
 #define NATRON_PYPLUG_MAGIC "# Natron PyPlug"
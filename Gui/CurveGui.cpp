@@ -247,12 +247,38 @@ CurveGui::getInternalCurve() const
     return _internalCurve;
 }
 
+void
+CurveGui::evaluateMany(bool useExpr,
+                       const std::vector<double>& x,
+                       std::vector<double>* y) const
+{
+    y->resize( x.size() );
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        (*y)[i] = evaluate(useExpr, x[i]);
+    }
+}
+
+static void
+drawVertexArray(GLenum mode,
+                const std::vector<float>& vertices)
+{
+    if ( vertices.empty() ) {
+        return;
+    }
+    // Sent in a single call: with hundreds of animated curves, per-vertex immediate mode calls dominate the repaint
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, &vertices.front());
+    glDrawArrays(mode, 0, (GLsizei)(vertices.size() / 2));
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
 static void
 drawLineStrip(const std::vector<float>& vertices,
               const QPointF& btmLeft,
               const QPointF& topRight)
 {
-    glBegin(GL_LINE_STRIP);
+    std::vector<float> visibleVertices;
+    visibleVertices.reserve( vertices.size() );
 
     bool prevVisible = true;
     bool prevTooAbove = false;
@@ -276,15 +302,18 @@ drawLineStrip(const std::vector<float>& vertices,
             //At least draw the previous point otherwise this will draw a line between the last previous point and this point
             //Draw them 10000 units further so that we're sure we don't see half of a pixel of a line remaining
             if (previousWasTooAbove) {
-                glVertex2f(vertices[i - 2], vertices[i - 1] + 100000);
+                visibleVertices.push_back(vertices[i - 2]);
+                visibleVertices.push_back(vertices[i - 1] + 100000);
             } else if (previousWasTooBelow) {
-                glVertex2f(vertices[i - 2], vertices[i - 1] - 100000);
+                visibleVertices.push_back(vertices[i - 2]);
+                visibleVertices.push_back(vertices[i - 1] - 100000);
             }
         }
-        glVertex2f(vertices[i], vertices[i + 1]);
+        visibleVertices.push_back(vertices[i]);
+        visibleVertices.push_back(vertices[i + 1]);
     }
 
-    glEnd();
+    drawVertexArray(GL_LINE_STRIP, visibleVertices);
 }
 
 void
@@ -344,27 +373,33 @@ CurveGui::drawCurve(int curveIndex,
             KeyFrame x1Key;
             KeyFrameSet::const_iterator lastUpperIt = keyframes.end();
 
+            // The positions do not depend on the curve values: compute them first and evaluate the curve
+            // at all of them in a single pass
+            std::vector<double> xs, ys;
+            std::vector<std::pair<std::size_t, double> > keyValues; // (vertex index, value) of the vertices on a keyframe
             while ( x1 < (widgetWidth - 1) ) {
-                double x, y;
+                double x;
                 if (!isX1AKey) {
                     x = _curveWidget->toZoomCoordinates(x1, 0).x();
-                    y = evaluate(false, x);
                 } else {
                     x = x1Key.getTime();
-                    y = x1Key.getValue();
+                    keyValues.push_back( std::make_pair( xs.size(), x1Key.getValue() ) );
                 }
-
-                vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
+                xs.push_back(x);
                 nextPointForSegment(x, keyframes, isPeriodic, parametricRange.first, parametricRange.second,  &lastUpperIt, &x2, &x1Key, &isX1AKey);
                 x1 = x2;
             }
             //also add the last point
-            {
-                double x = _curveWidget->toZoomCoordinates(x1, 0).x();
-                double y = evaluate(false, x);
-                vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
+            xs.push_back( _curveWidget->toZoomCoordinates(x1, 0).x() );
+
+            evaluateMany(false, xs, &ys);
+            for (std::size_t i = 0; i < keyValues.size(); ++i) {
+                ys[keyValues[i].first] = keyValues[i].second;
+            }
+            vertices.reserve(xs.size() * 2);
+            for (std::size_t i = 0; i < xs.size(); ++i) {
+                vertices.push_back( (float)xs[i] );
+                vertices.push_back( (float)ys[i] );
             }
         } catch (...) {
         }
@@ -458,6 +493,9 @@ CurveGui::drawCurve(int curveIndex,
 
         //bool isCurveSelected = foundCurveSelected != selectedKeyFrames.end();
 
+        // Unselected keyframes are all drawn in a single call, selected ones are drawn afterwards with their tangents
+        std::vector<float> keyVertices;
+        std::vector<std::pair<KeyFrame, KeyPtr> > selectedKeys;
         for (KeyFrameSet::const_iterator k = keyframes.begin(); k != keyframes.end(); ++k) {
             const KeyFrame & key = (*k);
 
@@ -465,20 +503,34 @@ CurveGui::drawCurve(int curveIndex,
                 continue;
             }
 
-            glColor4f( _color.redF(), _color.greenF(), _color.blueF(), _color.alphaF() );
-
-            //if the key is selected change its color to white
             KeyPtr isSelected;
             if ( foundCurveSelected != selectedKeyFrames.end() ) {
                 for (std::list<KeyPtr>::const_iterator it2 = foundCurveSelected->second.begin();
                      it2 != foundCurveSelected->second.end(); ++it2) {
                     if ( ( (*it2)->key.getTime() == key.getTime() ) && ( (*it2)->curve.get() == this ) ) {
                         isSelected = *it2;
-                        glColor4f(1.f, 1.f, 1.f, 1.f);
                         break;
                     }
                 }
             }
+            if (isSelected) {
+                selectedKeys.push_back( std::make_pair(key, isSelected) );
+            } else {
+                keyVertices.push_back( key.getTime() );
+                keyVertices.push_back( key.getValue() );
+            }
+        }
+
+        glColor4f( _color.redF(), _color.greenF(), _color.blueF(), _color.alphaF() );
+        drawVertexArray(GL_POINTS, keyVertices);
+        glCheckErrorIgnoreOSXBug();
+
+        for (std::vector<std::pair<KeyFrame, KeyPtr> >::const_iterator k = selectedKeys.begin(); k != selectedKeys.end(); ++k) {
+            const KeyFrame & key = k->first;
+            const KeyPtr & isSelected = k->second;
+
+            //the key is selected: its color is white
+            glColor4f(1.f, 1.f, 1.f, 1.f);
 
             double x = key.getTime();
             double y = key.getValue();
@@ -542,7 +594,7 @@ CurveGui::drawCurve(int curveIndex,
                 glVertex2f( isSelected->rightTan.first, isSelected->rightTan.second );
                 glEnd();
             } // if ( !isBezier && ( isSelected != selectedKeyFrames.end() ) && (key.getInterpolation() != eKeyframeTypeConstant) ) {
-        } // for (KeyFrameSet::const_iterator k = keyframes.begin(); k != keyframes.end(); ++k) {
+        } // for (std::vector<std::pair<KeyFrame, KeyPtr> >::const_iterator k = selectedKeys.begin(); k != selectedKeys.end(); ++k) {
     } // GLProtectAttrib(GL_HINT_BIT | GL_ENABLE_BIT | GL_LINE_BIT | GL_COLOR_BUFFER_BIT | GL_POINT_BIT | GL_CURRENT_BIT);
 
     glCheckError();
@@ -676,6 +728,32 @@ KnobCurveGui::evaluate(bool useExpr,
     }
 }
 
+void
+KnobCurveGui::evaluateMany(bool useExpr,
+                           const std::vector<double>& x,
+                           std::vector<double>* y) const
+{
+    y->resize( x.size() );
+    if ( x.empty() ) {
+        return;
+    }
+
+    KnobIPtr knob = getInternalKnob();
+    KnobParametric* isParametric = dynamic_cast<KnobParametric*>( knob.get() );
+    CurvePtr curve;
+    if (isParametric) {
+        curve = isParametric->getParametricCurve(_dimension);
+    } else if (!useExpr) {
+        curve = _internalCurve;
+    }
+    if (!curve) {
+        CurveGui::evaluateMany(useExpr, x, y);
+
+        return;
+    }
+    curve->getValuesAt( &x.front(), &y->front(), (int)x.size(), false );
+}
+
 CurvePtr
 KnobCurveGui::getInternalCurve() const
 {
@@ -962,35 +962,41 @@ DSPasteKeysCommand::addOrRemoveKeyframe(bool add)
         if (!knobContext) {
             continue;
         }
-        for (std::size_t i = 0; i < _keys.size(); ++i) {
 
-            int dim = knobContext->getDimension();
-            KnobIPtr knob = knobContext->getInternalKnob();
-            knob->beginChanges();
+        int dim = knobContext->getDimension();
+        KnobIPtr knob = knobContext->getInternalKnob();
+        knob->beginChanges();
 
-            double keyTime = _keys[i].key.getTime();
-            double setTime = _pasteRelativeToRefTime ? keyTime - _keys[_refKeyindex].key.getTime() + _refTime : keyTime;
-
-            if (add) {
-
-                for (int j = 0; j < knob->getDimension(); ++j) {
-                    if ( (dim == -1) || (j == dim) ) {
-                        KeyFrame k = _keys[i].key;
-                        k.setTime(setTime);
-
-                        knob->setKeyFrame(k, ViewSpec::all(), j, eValueChangedReasonNatronGuiEdited);
-                    }
+        if (add) {
+            // Insert all the pasted keys of a dimension at once rather than notifying each of them
+            std::vector<KeyFrame> keys;
+            keys.reserve( _keys.size() );
+            for (std::size_t i = 0; i < _keys.size(); ++i) {
+                double keyTime = _keys[i].key.getTime();
+                double setTime = _pasteRelativeToRefTime ? keyTime - _keys[_refKeyindex].key.getTime() + _refTime : keyTime;
+                KeyFrame k = _keys[i].key;
+                k.setTime(setTime);
+                keys.push_back(k);
+            }
+            for (int j = 0; j < knob->getDimension(); ++j) {
+                if ( (dim == -1) || (j == dim) ) {
+                    knob->setKeyFrames(keys, ViewSpec::all(), j, eValueChangedReasonNatronGuiEdited);
                 }
-            } else {
+            }
+        } else {
+            for (std::size_t i = 0; i < _keys.size(); ++i) {
+                double keyTime = _keys[i].key.getTime();
+                double setTime = _pasteRelativeToRefTime ? keyTime - _keys[_refKeyindex].key.getTime() + _refTime : keyTime;
+
                 for (int j = 0; j < knob->getDimension(); ++j) {
                     if ( (dim == -1) || (j == dim) ) {
                         knob->deleteValueAtTime(eCurveChangeReasonDopeSheet, setTime, ViewSpec::all(), j, i == 0);
                     }
                 }
             }
-            
-            knob->endChanges();
         }
+
+        knob->endChanges();
     }
 
 
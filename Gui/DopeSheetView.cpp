@@ -27,7 +27,9 @@
 
 #include <algorithm> // min, max
 #include <limits>
+#include <map>
 #include <stdexcept>
+#include <vector>
 
 // Qt includes
 #include <QApplication>
@@ -217,11 +219,26 @@ public:
     void drawRange(const DSNodePtr &dsNode) const;
     void drawKeyframes(const DSNodePtr &dsNode) const;
 
-    void drawTexturedKeyframe(DopeSheetViewPrivate::KeyframeTexture textureType,
-                              bool drawTime,
-                              double time,
-                              const QColor& textColor,
-                              const RectD &rect) const;
+    // Keyframes quads sharing the same texture, drawn in a single call
+    struct TexturedKeyframesBatch
+    {
+        std::vector<float> vertices;
+        std::vector<float> texCoords;
+    };
+
+    typedef std::map<DopeSheetViewPrivate::KeyframeTexture, TexturedKeyframesBatch> TexturedKeyframesBatches;
+    typedef std::vector<std::pair<double, RectD> > KeyframeTimeLabels;
+
+    void appendTexturedKeyframe(DopeSheetViewPrivate::KeyframeTexture textureType,
+                                bool drawTime,
+                                double time,
+                                const RectD &rect,
+                                TexturedKeyframesBatches* batches,
+                                KeyframeTimeLabels* timeLabels) const;
+
+    void drawTexturedKeyframes(const TexturedKeyframesBatches& batches,
+                               const KeyframeTimeLabels& timeLabels,
+                               const QColor& textColor) const;
 
     void drawGroupOverlay(const DSNodePtr &dsNode, const DSNodePtr &group) const;
 
@@ -1272,6 +1289,8 @@ DopeSheetViewPrivate::drawKeyframes(const DSNodePtr &dsNode) const
         int hasSingleKfTimeSelected = model->getSelectionModel()->hasSingleKeyFrameTimeSelected(&kfTimeSelected);
         std::map<double, bool> nodeKeytimes;
         std::map<DSKnob *, std::map<double, bool> > knobsKeytimes;
+        TexturedKeyframesBatches batches;
+        KeyframeTimeLabels timeLabels;
 
         for (DSTreeItemKnobMap::const_iterator it = knobItems.begin();
              it != knobItems.end();
@@ -1292,6 +1311,11 @@ DopeSheetViewPrivate::drawKeyframes(const DSNodePtr &dsNode) const
 
             KeyFrameSet keyframes = dsKnob->getKnobGui()->getCurve(ViewIdx(0), dim)->getKeyFrames_mt_safe();
 
+            // These do not depend on the keyframe
+            double rowCenterYWidget = hierarchyView->visualItemRect( dsKnob->getTreeItem() ).center().y();
+            bool drawInDimRow = hierarchyView->itemIsVisibleFromOutside(knobTreeItem);
+            DSKnobPtr rootDSKnob = model->mapNameItemToDSKnob( knobTreeItem->parent() );
+
             for (KeyFrameSet::const_iterator kIt = keyframes.begin();
                  kIt != keyframes.end();
                  ++kIt) {
@@ -1303,26 +1327,22 @@ DopeSheetViewPrivate::drawKeyframes(const DSNodePtr &dsNode) const
                     continue;
                 }
 
-                double rowCenterYWidget = hierarchyView->visualItemRect( dsKnob->getTreeItem() ).center().y();
                 RectD zoomKfRect = getKeyFrameBoundingRectZoomCoords(keyTime, rowCenterYWidget);
                 bool kfSelected = model->getSelectionModel()->keyframeIsSelected(dsKnob, kf);
 
                 // Draw keyframe in the knob dim row only if it's visible
-                bool drawInDimRow = hierarchyView->itemIsVisibleFromOutside(knobTreeItem);
-
                 if (drawInDimRow) {
                     DopeSheetViewPrivate::KeyframeTexture texType = kfTextureFromKeyframeType( kf.getInterpolation(),
                                                                                                kfSelected || selectionRect.intersects(zoomKfRect) );
 
                     if (texType != DopeSheetViewPrivate::kfTextureNone) {
-                        drawTexturedKeyframe(texType, hasSingleKfTimeSelected && kfSelected,
-                                             kfTimeSelected, selectionColor, zoomKfRect);
+                        appendTexturedKeyframe(texType, hasSingleKfTimeSelected && kfSelected,
+                                               kfTimeSelected, zoomKfRect, &batches, &timeLabels);
                     }
                 }
 
                 // Fill the knob times map
                 {
-                    DSKnobPtr rootDSKnob = model->mapNameItemToDSKnob( knobTreeItem->parent() );
                     if (rootDSKnob) {
                         assert(rootDSKnob);
                         const std::map<double, bool>& map = knobsKeytimes[rootDSKnob.get()];
@@ -1360,83 +1380,115 @@ DopeSheetViewPrivate::drawKeyframes(const DSNodePtr &dsNode) const
              it != knobsKeytimes.end();
              ++it) {
             QTreeWidgetItem *knobRootItem = (*it).first->getTreeItem();
-            std::map<double, bool> knobTimes = (*it).second;
+            const std::map<double, bool>& knobTimes = (*it).second;
+            bool drawInKnobRootRow = hierarchyView->itemIsVisibleFromOutside(knobRootItem);
+            if (!drawInKnobRootRow) {
+                continue;
+            }
+            double newCenterY = hierarchyView->visualItemRect(knobRootItem).center().y();
 
             for (std::map<double, bool>::const_iterator mIt = knobTimes.begin();
                  mIt != knobTimes.end();
                  ++mIt) {
                 double time = (*mIt).first;
                 bool drawSelected = (*mIt).second;
-                bool drawInKnobRootRow = hierarchyView->itemIsVisibleFromOutside(knobRootItem);
-
-                if (drawInKnobRootRow) {
-                    double newCenterY = hierarchyView->visualItemRect(knobRootItem).center().y();
-                    RectD zoomKfRect = getKeyFrameBoundingRectZoomCoords(time, newCenterY);
-                    DopeSheetViewPrivate::KeyframeTexture textureType = (drawSelected)
-                                                                        ? DopeSheetViewPrivate::kfTextureMasterSelected
-                                                                        : DopeSheetViewPrivate::kfTextureMaster;
+                RectD zoomKfRect = getKeyFrameBoundingRectZoomCoords(time, newCenterY);
+                DopeSheetViewPrivate::KeyframeTexture textureType = (drawSelected)
+                                                                    ? DopeSheetViewPrivate::kfTextureMasterSelected
+                                                                    : DopeSheetViewPrivate::kfTextureMaster;
 
-                    drawTexturedKeyframe(textureType, hasSingleKfTimeSelected && drawSelected,
-                                         kfTimeSelected, selectionColor, zoomKfRect);
-                }
+                appendTexturedKeyframe(textureType, hasSingleKfTimeSelected && drawSelected,
+                                       kfTimeSelected, zoomKfRect, &batches, &timeLabels);
             }
         }
 
         // Draw master keys in node section
-        for (std::map<double, bool>::const_iterator it = nodeKeytimes.begin();
-             it != nodeKeytimes.end();
-             ++it) {
-            double time = (*it).first;
-            bool drawSelected = (*it).second;
-            QTreeWidgetItem *nodeItem = dsNode->getTreeItem();
-            bool drawInNodeRow = hierarchyView->itemIsVisibleFromOutside(nodeItem);
-
-            if (drawInNodeRow) {
-                double newCenterY = hierarchyView->visualItemRect(nodeItem).center().y();
+        QTreeWidgetItem *nodeItem = dsNode->getTreeItem();
+        if ( hierarchyView->itemIsVisibleFromOutside(nodeItem) ) {
+            double newCenterY = hierarchyView->visualItemRect(nodeItem).center().y();
+            for (std::map<double, bool>::const_iterator it = nodeKeytimes.begin();
+                 it != nodeKeytimes.end();
+                 ++it) {
+                double time = (*it).first;
+                bool drawSelected = (*it).second;
                 RectD zoomKfRect = getKeyFrameBoundingRectZoomCoords(time, newCenterY);
                 DopeSheetViewPrivate::KeyframeTexture textureType = (drawSelected)
                                                                     ? DopeSheetViewPrivate::kfTextureMasterSelected
                                                                     : DopeSheetViewPrivate::kfTextureMaster;
 
-                drawTexturedKeyframe(textureType, hasSingleKfTimeSelected && drawSelected,
-                                     kfTimeSelected, selectionColor, zoomKfRect);
+                appendTexturedKeyframe(textureType, hasSingleKfTimeSelected && drawSelected,
+                                       kfTimeSelected, zoomKfRect, &batches, &timeLabels);
             }
         }
+
+        drawTexturedKeyframes(batches, timeLabels, selectionColor);
     }
 } // DopeSheetViewPrivate::drawKeyframes
 
 void
-DopeSheetViewPrivate::drawTexturedKeyframe(DopeSheetViewPrivate::KeyframeTexture textureType,
-                                           bool drawTime,
-                                           double time,
-                                           const QColor& textColor,
-                                           const RectD &rect) const
+DopeSheetViewPrivate::appendTexturedKeyframe(DopeSheetViewPrivate::KeyframeTexture textureType,
+                                             bool drawTime,
+                                             double time,
+                                             const RectD &rect,
+                                             TexturedKeyframesBatches* batches,
+                                             KeyframeTimeLabels* timeLabels) const
 {
-    GLProtectAttrib a(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_TRANSFORM_BIT);
-    GLProtectMatrix pr(GL_MODELVIEW);
+    TexturedKeyframesBatch& batch = (*batches)[textureType];
+    const float vertices[8] = {
+        (float)rect.left(), (float)rect.top(),
+        (float)rect.left(), (float)rect.bottom(),
+        (float)rect.right(), (float)rect.bottom(),
+        (float)rect.right(), (float)rect.top()
+    };
+    const float texCoords[8] = {
+        0.f, 1.f,
+        0.f, 0.f,
+        1.f, 0.f,
+        1.f, 1.f
+    };
 
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, kfTexturesIDs[textureType]);
+    batch.vertices.insert(batch.vertices.end(), vertices, vertices + 8);
+    batch.texCoords.insert(batch.texCoords.end(), texCoords, texCoords + 8);
 
-    glBegin(GL_POLYGON);
-    glTexCoord2f(0.0f, 1.0f);
-    glVertex2f( rect.left(), rect.top() );
-    glTexCoord2f(0.0f, 0.0f);
-    glVertex2f( rect.left(), rect.bottom() );
-    glTexCoord2f(1.0f, 0.0f);
-    glVertex2f( rect.right(), rect.bottom() );
-    glTexCoord2f(1.0f, 1.0f);
-    glVertex2f( rect.right(), rect.top() );
-    glEnd();
+    if (drawTime) {
+        timeLabels->push_back( std::make_pair(time, rect) );
+    }
+}
 
-    glColor4f(1, 1, 1, 1);
-    glBindTexture(GL_TEXTURE_2D, 0);
+void
+DopeSheetViewPrivate::drawTexturedKeyframes(const TexturedKeyframesBatches& batches,
+                                            const KeyframeTimeLabels& timeLabels,
+                                            const QColor& textColor) const
+{
+    {
+        GLProtectAttrib a(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_TRANSFORM_BIT);
+        GLProtectMatrix pr(GL_MODELVIEW);
+
+        glEnable(GL_TEXTURE_2D);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        for (TexturedKeyframesBatches::const_iterator it = batches.begin(); it != batches.end(); ++it) {
+            const TexturedKeyframesBatch& batch = it->second;
+            if ( batch.vertices.empty() ) {
+                continue;
+            }
+            glBindTexture(GL_TEXTURE_2D, kfTexturesIDs[it->first]);
+            glVertexPointer(2, GL_FLOAT, 0, &batch.vertices.front());
+            glTexCoordPointer(2, GL_FLOAT, 0, &batch.texCoords.front());
+            glDrawArrays(GL_QUADS, 0, (GLsizei)(batch.vertices.size() / 2));
+        }
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
 
-    glDisable(GL_TEXTURE_2D);
+        glColor4f(1, 1, 1, 1);
+        glBindTexture(GL_TEXTURE_2D, 0);
 
-    if (drawTime) {
-        QString text = QString::number(time);
-        QPointF p = zoomContext.toWidgetCoordinates( rect.right(), rect.bottom() );
+        glDisable(GL_TEXTURE_2D);
+    }
+
+    for (KeyframeTimeLabels::const_iterator it = timeLabels.begin(); it != timeLabels.end(); ++it) {
+        QString text = QString::number(it->first);
+        QPointF p = zoomContext.toWidgetCoordinates( it->second.right(), it->second.bottom() );
         p.rx() += 3;
         p = zoomContext.toZoomCoordinates( p.x(), p.y() );
         renderText(p.x(), p.y(), text, textColor, *font);
@@ -33,6 +33,7 @@
 #include <QPainter>
 #include <QApplication>
 #include <QGraphicsScene>
+#include <QStyleOptionGraphicsItem>
 
 #include "Gui/NodeGui.h"
 #include "Gui/NodeGraph.h"
@@ -58,6 +59,7 @@
 #define ARROW_SIZE_CONNECTED 14
 #define ARROW_SIZE_DISCONNECTED 10
 #define ARROW_HEAD_ANGLE ( (2 * M_PI) / 15 ) // 24 degrees opening angle is a nice thin arrow
+#define EDGE_SIMPLIFIED_LEVEL_OF_DETAIL 0.3 // below this zoom factor, edges are drawn as plain lines
 
 // number of offset pixels from the arrow that determine if a click is contained in the arrow or not
 #define kGraphicalContainerOffset 10
@@ -746,12 +748,14 @@ Edge::isNearbyBendPoint(const QPointF & scenePoint)
 
 void
 Edge::paint(QPainter *painter,
-            const QStyleOptionGraphicsItem * /*options*/,
+            const QStyleOptionGraphicsItem *options,
             QWidget * /*parent*/)
 {
     bool antialias = appPTR->getCurrentSettings()->isNodeGraphAntiAliasingEnabled();
+    // When zoomed out, the arrow head and bend point are a few pixels wide: only draw the line, without antialiasing
+    bool simplified = options->levelOfDetailFromTransform( painter->worldTransform() ) < EDGE_SIMPLIFIED_LEVEL_OF_DETAIL;
 
-    if (!antialias) {
+    if (!antialias || simplified) {
         painter->setRenderHint(QPainter::Antialiasing, false);
     }
 
@@ -791,6 +795,10 @@ Edge::paint(QPainter *painter,
 
     painter->drawLine( line() );
 
+    if (simplified) {
+        return;
+    }
+
     myPen.setStyle(Qt::SolidLine);
     painter->setPen(myPen);
 
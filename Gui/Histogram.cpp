@@ -26,6 +26,7 @@
 #include "Histogram.h"
 
 #include <algorithm> // min, max
+#include <cmath>
 #include <stdexcept>
 
 #include <QHBoxLayout>
@@ -129,6 +130,10 @@ public:
         , binsCount(0)
         , mipMapLevel(0)
         , hasImage(false)
+        , producedMode(Histogram::eDisplayModeRGB)
+        , scopeWidth(0)
+        , scopeHeight(0)
+        , scopeTexture(0)
 #endif
         , sizeH()
         , showViewerPicker(false)
@@ -166,8 +171,15 @@ public:
 
 #else
     void drawHistogramCPU();
+
+    void drawScopeCPU();
 #endif
 
+    bool isScopeMode() const
+    {
+        return mode == Histogram::eDisplayModeWaveform || mode == Histogram::eDisplayModeParade || mode == Histogram::eDisplayModeVectorscope;
+    }
+
     //////////////////////////////////
     // data members
 
@@ -269,6 +281,9 @@ public:
     unsigned int binsCount;
     unsigned int mipMapLevel;
     bool hasImage;
+    Histogram::DisplayModeEnum producedMode; //< the mode the histograms above were computed for
+    unsigned int scopeWidth, scopeHeight; //< the size of the grids in the scope modes
+    GLuint scopeTexture; //< the scope grids converted to colors, for display
 #endif // !NATRON_HISTOGRAM_USING_OPENGL
 
     QSize sizeH;
@@ -373,6 +388,21 @@ Histogram::Histogram(Gui* gui,
     bAction->setText( QString::fromUtf8("B") );
     bAction->setData(5);
     _imp->modeActions->addAction(bAction);
+
+    QAction* waveformAction = new QAction(_imp->modeMenu);
+    waveformAction->setText( tr("Waveform") );
+    waveformAction->setData(6);
+    _imp->modeActions->addAction(waveformAction);
+
+    QAction* paradeAction = new QAction(_imp->modeMenu);
+    paradeAction->setText( tr("RGB Parade") );
+    paradeAction->setData(7);
+    _imp->modeActions->addAction(paradeAction);
+
+    QAction* vectorscopeAction = new QAction(_imp->modeMenu);
+    vectorscopeAction->setText( tr("Vectorscope") );
+    vectorscopeAction->setData(8);
+    _imp->modeActions->addAction(vectorscopeAction);
     QList<QAction*> actions = _imp->modeActions->actions();
     for (int i = 0; i < actions.size(); ++i) {
         _imp->modeMenu->addAction( actions.at(i) );
@@ -434,6 +464,10 @@ Histogram::~Histogram()
     glDeleteBuffers(1, &_imp->vboID);
     glDeleteBuffers(1, &_imp->vboHistogramRendering);
 
+#else
+    if (_imp->scopeTexture) {
+        glDeleteTextures(1, &_imp->scopeTexture);
+    }
 #endif
 }
 
@@ -1178,15 +1212,23 @@ Histogram::paintGL()
         glClear(GL_COLOR_BUFFER_BIT);
         glCheckErrorIgnoreOSXBug();
 
-        _imp->drawScale();
-        glCheckError();
+        // the scopes have their own graticule, and no value axis along x
+        bool isScope = _imp->isScopeMode();
+        if (!isScope) {
+            _imp->drawScale();
+            glCheckError();
+        }
 
         if (_imp->hasImage) {
 #ifndef NATRON_HISTOGRAM_USING_OPENGL
-            _imp->drawHistogramCPU();
+            if (isScope) {
+                _imp->drawScopeCPU();
+            } else {
+                _imp->drawHistogramCPU();
+            }
             glCheckError();
 #endif
-            if (_imp->drawCoordinates) {
+            if (_imp->drawCoordinates && !isScope) {
                 _imp->drawPicker();
                 glCheckError();
             }
@@ -1194,7 +1236,7 @@ Histogram::paintGL()
             _imp->drawWarnings();
             glCheckError();
 
-            if (_imp->showViewerPicker) {
+            if (_imp->showViewerPicker && !isScope) {
                 _imp->drawViewerPicker();
                 glCheckError();
             }
@@ -1533,9 +1575,10 @@ Histogram::onCPUHistogramComputed()
     assert( qApp && qApp->thread() == QThread::currentThread() );
 
     int mode;
-    bool success = _imp->histogramThread.getMostRecentlyProducedHistogram(&_imp->histogram1, &_imp->histogram2, &_imp->histogram3, &_imp->binsCount, &_imp->pixelsCount, &mode, &_imp->vmin, &_imp->vmax, &_imp->mipMapLevel);
+    bool success = _imp->histogramThread.getMostRecentlyProducedHistogram(&_imp->histogram1, &_imp->histogram2, &_imp->histogram3, &_imp->binsCount, &_imp->pixelsCount, &mode, &_imp->vmin, &_imp->vmax, &_imp->mipMapLevel, &_imp->scopeWidth, &_imp->scopeHeight);
     assert(success);
     if (success) {
+        _imp->producedMode = (Histogram::DisplayModeEnum)mode;
         _imp->hasImage = true;
         update();
     }
@@ -1905,6 +1948,13 @@ HistogramPrivate::drawHistogramCPU()
     assert( qApp && qApp->thread() == QThread::currentThread() );
     assert( QGLContext::currentContext() == widget->context() );
 
+    // the histograms may still be the scope grids of a previous mode
+    if ( (producedMode == Histogram::eDisplayModeWaveform) ||
+         (producedMode == Histogram::eDisplayModeParade) ||
+         (producedMode == Histogram::eDisplayModeVectorscope) ) {
+        return;
+    }
+
     glCheckError();
     {
         GLProtectAttrib a(GL_COLOR_BUFFER_BIT | GL_LINE_BIT | GL_CURRENT_BIT | GL_ENABLE_BIT);
@@ -1986,6 +2036,151 @@ HistogramPrivate::drawHistogramCPU()
     glCheckError();
 } // drawHistogramCPU
 
+void
+HistogramPrivate::drawScopeCPU()
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+    assert( QGLContext::currentContext() == widget->context() );
+
+    if ( (producedMode != mode) || (scopeWidth == 0) || (scopeHeight == 0) ) {
+        return;
+    }
+    bool isParade = (mode == Histogram::eDisplayModeParade);
+    std::size_t gridSize = scopeWidth * scopeHeight;
+    if ( (histogram1.size() != gridSize) ||
+         ( isParade && ( (histogram2.size() != gridSize) || (histogram3.size() != gridSize) ) ) ) {
+        return;
+    }
+
+    // the parade channels are laid side by side in the same texture
+    int nGrids = isParade ? 3 : 1;
+    const std::vector<float>* grids[3] = { &histogram1, &histogram2, &histogram3 };
+    // same equal-luminance colors as drawHistogramCPU, brightened since a scope cell is much dimmer than a bin
+    static const float paradeColors[3][3] = {
+        { 1., 0.231250, 0.231250 },
+        { 0., 0.768750, 0. },
+        { 0.405450, 0.405450, 1. }
+    };
+    static const float scopeColor[3] = { 0.6, 1., 0.6 };
+
+    // the density is displayed on a log scale, so that sparse traces remain visible next to dense ones
+    float maxCount = 0.f;
+    for (int g = 0; g < nGrids; ++g) {
+        maxCount = std::max( maxCount, *std::max_element( grids[g]->begin(), grids[g]->end() ) );
+    }
+    double logNorm = maxCount > 0.f ? 1. / std::log(1. + maxCount) : 0.;
+    int texWidth = scopeWidth * nGrids;
+    std::vector<float> texels(texWidth * scopeHeight * 3);
+    for (int g = 0; g < nGrids; ++g) {
+        const float* color = isParade ? paradeColors[g] : scopeColor;
+        const std::vector<float> & grid = *grids[g];
+        for (unsigned int y = 0; y < scopeHeight; ++y) {
+            float* dst = &texels[(y * texWidth + g * scopeWidth) * 3];
+            const float* src = &grid[y * scopeWidth];
+            for (unsigned int x = 0; x < scopeWidth; ++x, dst += 3) {
+                float intensity = src[x] > 0.f ? (float)( std::log(1. + src[x]) * logNorm ) : 0.f;
+                dst[0] = color[0] * intensity;
+                dst[1] = color[1] * intensity;
+                dst[2] = color[2] * intensity;
+            }
+        }
+    }
+
+    // the scope area, in zoom coordinates: the whole widget, or a centered square for the vectorscope
+    double w = widget->width();
+    double h = widget->height();
+    double x1 = 0, y1 = 0, x2 = w, y2 = h;
+    if (mode == Histogram::eDisplayModeVectorscope) {
+        double side = std::min(w, h);
+        x1 = (w - side) / 2.;
+        y1 = (h - side) / 2.;
+        x2 = x1 + side;
+        y2 = y1 + side;
+    }
+    QPointF topLeft = zoomCtx.toZoomCoordinates(x1, y1);
+    QPointF btmRight = zoomCtx.toZoomCoordinates(x2, y2);
+
+    glCheckError();
+    {
+        GLProtectAttrib a(GL_COLOR_BUFFER_BIT | GL_LINE_BIT | GL_CURRENT_BIT | GL_ENABLE_BIT | GL_TEXTURE_BIT);
+
+        if (!scopeTexture) {
+            glGenTextures(1, &scopeTexture);
+        }
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, scopeTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, texWidth, scopeHeight, 0, GL_RGB, GL_FLOAT, &texels[0]);
+
+        glColor4f(1., 1., 1., 1.);
+        glBegin(GL_QUADS);
+        glTexCoord2f(0., 0.);
+        glVertex2d( topLeft.x(), btmRight.y() );
+        glTexCoord2f(1., 0.);
+        glVertex2d( btmRight.x(), btmRight.y() );
+        glTexCoord2f(1., 1.);
+        glVertex2d( btmRight.x(), topLeft.y() );
+        glTexCoord2f(0., 1.);
+        glVertex2d( topLeft.x(), topLeft.y() );
+        glEnd();
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDisable(GL_TEXTURE_2D);
+        glCheckErrorIgnoreOSXBug();
+
+        // graticule
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glColor4f(_scaleColor.redF(), _scaleColor.greenF(), _scaleColor.blueF(), 0.6);
+        glLineWidth(1.);
+        double left = topLeft.x();
+        double right = btmRight.x();
+        double bottom = btmRight.y();
+        double top = topLeft.y();
+        glBegin(GL_LINES);
+        if (mode == Histogram::eDisplayModeVectorscope) {
+            double cx = (left + right) / 2.;
+            double cy = (bottom + top) / 2.;
+            glVertex2d(left, cy);
+            glVertex2d(right, cy);
+            glVertex2d(cx, bottom);
+            glVertex2d(cx, top);
+            // the circle of maximum chroma along each axis
+            const int nSegments = 64;
+            for (int i = 0; i < nSegments; ++i) {
+                double a0 = 2. * M_PI * i / nSegments;
+                double a1 = 2. * M_PI * (i + 1) / nSegments;
+                glVertex2d( cx + std::cos(a0) * (right - left) / 2., cy + std::sin(a0) * (top - bottom) / 2. );
+                glVertex2d( cx + std::cos(a1) * (right - left) / 2., cy + std::sin(a1) * (top - bottom) / 2. );
+            }
+        } else {
+            // a line every quarter of the [0,1] range, at the value of each row
+            for (int i = 0; i <= 4; ++i) {
+                double v = i / 4.;
+                if ( (v < vmin) || (v > vmax) ) {
+                    continue;
+                }
+                double y = bottom + (v - vmin) / (vmax - vmin) * (top - bottom);
+                glVertex2d(left, y);
+                glVertex2d(right, y);
+            }
+            if (isParade) {
+                for (int g = 1; g < 3; ++g) {
+                    double x = left + g * (right - left) / 3.;
+                    glVertex2d(x, bottom);
+                    glVertex2d(x, top);
+                }
+            }
+        }
+        glEnd(); // GL_LINES
+        glCheckErrorIgnoreOSXBug();
+    } // GLProtectAttrib a(GL_COLOR_BUFFER_BIT | GL_LINE_BIT | GL_CURRENT_BIT | GL_ENABLE_BIT | GL_TEXTURE_BIT);
+    glCheckError();
+} // drawScopeCPU
+
 #endif // ifndef NATRON_HISTOGRAM_USING_OPENGL
 
 void
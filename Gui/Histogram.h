@@ -68,7 +68,10 @@ public:
         eDisplayModeY,
         eDisplayModeR,
         eDisplayModeG,
-        eDisplayModeB
+        eDisplayModeB,
+        eDisplayModeWaveform,
+        eDisplayModeParade,
+        eDisplayModeVectorscope
     };
 
     Histogram(Gui* gui,
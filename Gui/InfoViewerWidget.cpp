@@ -37,6 +37,7 @@
 
 #include "Engine/ViewerInstance.h"
 #include "Engine/Lut.h"
+#include "Engine/OutputSchedulerThread.h"
 #include "Engine/Image.h"
 #include "Gui/GuiApplicationManager.h"
 #include "Gui/ViewerGL.h"
@@ -198,6 +199,11 @@ InfoViewerWidget::setFps(double actualFps,
                   .arg( font.pixelSize() );
 
     _fpsLabel->setText(str);
+
+    RenderEngine* engine = qobject_cast<RenderEngine*>( sender() );
+    if (engine) {
+        _fpsLabel->setToolTip( tr("%1 frame(s) dropped since playback started").arg( engine->getDroppedFramesCount() ) );
+    }
     if ( !_fpsLabel->isVisible() ) {
         _fpsLabel->show();
     }
@@ -73,10 +73,8 @@ NodeGraphTextItem::paint(QPainter *painter,
         if ( _graph->isDoingNavigatorRender() ) {
             isTooSmall = true;
         } else {
-            QFontMetrics fm( font() );
-            QPoint topLeft = _graph->mapFromScene( mapToScene( QPointF(0, 0) ) );
-            QPoint btmLeft = _graph->mapFromScene( mapToScene( QPointF( 0, fm.height() ) ) );
-            int height = std::abs( btmLeft.y() - topLeft.y() );
+            // The painter is set up with the view transform: this is much cheaper than mapping through the view
+            double height = QFontMetrics( font() ).height() * option->levelOfDetailFromTransform( painter->worldTransform() );
             isTooSmall = height < NODEGRAPH_TEXT_ITEM_MIN_HEIGHT_PX;
         }
     }
@@ -117,10 +115,7 @@ NodeGraphSimpleTextItem::paint(QPainter *painter,
         if ( _graph->isDoingNavigatorRender() ) {
             isTooSmall = true;
         } else {
-            QFontMetrics fm( font() );
-            QPoint topLeft = _graph->mapFromScene( mapToScene( QPointF(0, 0) ) );
-            QPoint btmLeft = _graph->mapFromScene( mapToScene( QPointF( 0, fm.height() ) ) );
-            int height = std::abs( btmLeft.y() - topLeft.y() );
+            double height = QFontMetrics( font() ).height() * option->levelOfDetailFromTransform( painter->worldTransform() );
             isTooSmall = height < NODEGRAPH_SIMPLE_TEXT_ITEM_MIN_HEIGHT_PX;
         }
     }
@@ -149,8 +144,7 @@ NodeGraphPixmapItem::paint(QPainter *painter,
     if ( _graph->isDoingNavigatorRender() ) {
         return;
     }
-    QRect br = _graph->mapFromScene( mapToScene( boundingRect() ).boundingRect() ).boundingRect();
-    int height = br.height();
+    double height = boundingRect().height() * option->levelOfDetailFromTransform( painter->worldTransform() );
     if (height < NODEGRAPH_PIXMAP_ITEM_MIN_HEIGHT_PX) {
         return;
     }
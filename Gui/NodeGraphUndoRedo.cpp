@@ -35,6 +35,7 @@ CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
 #include "Engine/CreateNodeArgs.h"
+#include "Engine/EffectInstance.h"
 #include "Engine/GroupInput.h"
 #include "Engine/GroupOutput.h"
 #include "Engine/Node.h"
@@ -275,36 +276,40 @@ RemoveMultipleNodesCommand::undo()
     if ( next != _nodes.end() ) {
         ++next;
     }
-    for (std::list<NodeToRemove>::iterator it = _nodes.begin();
-         it != _nodes.end();
-         ++it) {
-        NodeGuiPtr node = it->node.lock();
-        NodesList outputsToRestore;
-        for (NodesWList::const_iterator it2 = it->outputsToRestore.begin(); it2 != it->outputsToRestore.end(); ++it2) {
-            NodePtr output = it2->lock();
-            if (output) {
-                outputsToRestore.push_back(output);
+    {
+        // Refresh the metadata downstream once for all the edits below
+        MetadataRefreshBatch_RAII metadataBatch;
+        for (std::list<NodeToRemove>::iterator it = _nodes.begin();
+             it != _nodes.end();
+             ++it) {
+            NodeGuiPtr node = it->node.lock();
+            NodesList outputsToRestore;
+            for (NodesWList::const_iterator it2 = it->outputsToRestore.begin(); it2 != it->outputsToRestore.end(); ++it2) {
+                NodePtr output = it2->lock();
+                if (output) {
+                    outputsToRestore.push_back(output);
+                }
             }
-        }
 
-        node->getNode()->activate(outputsToRestore, false, false);
-        if ( node->isSettingsPanelVisible() ) {
-            node->getNode()->showKeyframesOnTimeline( next == _nodes.end() );
-        }
-        std::list<ViewerInstance* > viewers;
-        node->getNode()->hasViewersConnected(&viewers);
-        for (std::list<ViewerInstance* >::iterator it2 = viewers.begin(); it2 != viewers.end(); ++it2) {
-            std::list<ViewerInstance*>::iterator foundViewer = std::find(viewersToRefresh.begin(), viewersToRefresh.end(), *it2);
-            if ( foundViewer == viewersToRefresh.end() ) {
-                viewersToRefresh.push_back(*it2);
+            node->getNode()->activate(outputsToRestore, false, false);
+            if ( node->isSettingsPanelVisible() ) {
+                node->getNode()->showKeyframesOnTimeline( next == _nodes.end() );
+            }
+            std::list<ViewerInstance* > viewers;
+            node->getNode()->hasViewersConnected(&viewers);
+            for (std::list<ViewerInstance* >::iterator it2 = viewers.begin(); it2 != viewers.end(); ++it2) {
+                std::list<ViewerInstance*>::iterator foundViewer = std::find(viewersToRefresh.begin(), viewersToRefresh.end(), *it2);
+                if ( foundViewer == viewersToRefresh.end() ) {
+                    viewersToRefresh.push_back(*it2);
+                }
             }
-        }
 
-        // increment for next iteration
-        if ( next != _nodes.end() ) {
-            ++next;
-        }
-    } // for(it)
+            // increment for next iteration
+            if ( next != _nodes.end() ) {
+                ++next;
+            }
+        } // for(it)
+    }
     for (std::list<ViewerInstance* >::iterator it = viewersToRefresh.begin(); it != viewersToRefresh.end(); ++it) {
         (*it)->renderCurrentFrame(true);
     }
@@ -1528,33 +1533,37 @@ GroupFromSelectionCommand::undo()
 {
     std::list<NodeGuiPtr> nodesToSelect;
 
-    for (OutputLinksMap::iterator it = _outputLinks.begin(); it != _outputLinks.end(); ++it) {
-        NodePtr outputNode = it->first.lock();
-        if (!outputNode) {
-            continue;
-        }
-        NodePtr input = it->second.inputNode.lock();
-        if (!input) {
-            continue;
+    {
+        // Refresh the metadata downstream once for all the edits below
+        MetadataRefreshBatch_RAII metadataBatch;
+        for (OutputLinksMap::iterator it = _outputLinks.begin(); it != _outputLinks.end(); ++it) {
+            NodePtr outputNode = it->first.lock();
+            if (!outputNode) {
+                continue;
+            }
+            NodePtr input = it->second.inputNode.lock();
+            if (!input) {
+                continue;
+            }
+            outputNode->replaceInput(input, it->second.inputIdx);
         }
-        outputNode->replaceInput(input, it->second.inputIdx);
-    }
 
 
-    for (std::list<NodeGuiWPtr>::iterator it = _originalNodes.begin(); it != _originalNodes.end(); ++it) {
-        NodeGuiPtr node = it->lock();
-        if (node) {
-            node->getNode()->activate(NodesList(), true, false);
-            nodesToSelect.push_back(node);
+        for (std::list<NodeGuiWPtr>::iterator it = _originalNodes.begin(); it != _originalNodes.end(); ++it) {
+            NodeGuiPtr node = it->lock();
+            if (node) {
+                node->getNode()->activate(NodesList(), true, false);
+                nodesToSelect.push_back(node);
+            }
         }
+        _graph->setSelection(nodesToSelect);
+        _group.lock()->getNode()->deactivate(NodesList(),
+                                             true,
+                                             false,
+                                             true,
+                                             true,
+                                             false);
     }
-    _graph->setSelection(nodesToSelect);
-    _group.lock()->getNode()->deactivate(NodesList(),
-                                         true,
-                                         false,
-                                         true,
-                                         true,
-                                         false);
 
     _isRedone = false;
 }
@@ -2007,24 +2016,28 @@ InlineGroupCommand::undo()
     std::set<ViewerInstance*> viewers;
     std::list<NodeGuiPtr> nodesToSelect;
 
-    for (std::list<InlinedGroup>::iterator it = _groupNodes.begin(); it != _groupNodes.end(); ++it) {
-        NodeGuiPtr groupNode = it->group.lock();
-        if (groupNode) {
-            groupNode->getNode()->activate(NodesList(), true, false);
-            std::list<ViewerInstance*> connectedViewers;
-            groupNode->getNode()->hasViewersConnected(&connectedViewers);
-            for (std::list<ViewerInstance*>::iterator it2 = connectedViewers.begin(); it2 != connectedViewers.end(); ++it2) {
-                viewers.insert(*it2);
-            }
-            for (std::list<NodeGuiWPtr>::iterator it2 = it->inlinedNodes.begin();
-                 it2 != it->inlinedNodes.end(); ++it2) {
-                NodeGuiPtr node = (*it2).lock();
-                if (node) {
-                    node->getNode()->deactivate(NodesList(), false, false, true, false, false);
+    {
+        // Refresh the metadata downstream once for all the edits below
+        MetadataRefreshBatch_RAII metadataBatch;
+        for (std::list<InlinedGroup>::iterator it = _groupNodes.begin(); it != _groupNodes.end(); ++it) {
+            NodeGuiPtr groupNode = it->group.lock();
+            if (groupNode) {
+                groupNode->getNode()->activate(NodesList(), true, false);
+                std::list<ViewerInstance*> connectedViewers;
+                groupNode->getNode()->hasViewersConnected(&connectedViewers);
+                for (std::list<ViewerInstance*>::iterator it2 = connectedViewers.begin(); it2 != connectedViewers.end(); ++it2) {
+                    viewers.insert(*it2);
+                }
+                for (std::list<NodeGuiWPtr>::iterator it2 = it->inlinedNodes.begin();
+                     it2 != it->inlinedNodes.end(); ++it2) {
+                    NodeGuiPtr node = (*it2).lock();
+                    if (node) {
+                        node->getNode()->deactivate(NodesList(), false, false, true, false, false);
+                    }
                 }
             }
+            nodesToSelect.push_back(groupNode);
         }
-        nodesToSelect.push_back(groupNode);
     }
     _graph->setSelection(nodesToSelect);
     for (std::set<ViewerInstance*>::iterator it = viewers.begin(); it != viewers.end(); ++it) {
@@ -2040,37 +2053,41 @@ InlineGroupCommand::redo()
     std::set<ViewerInstance*> viewers;
     std::list<NodeGuiPtr> nodesToSelect;
 
-    for (std::list<InlinedGroup>::iterator it = _groupNodes.begin(); it != _groupNodes.end(); ++it) {
-        NodeGuiPtr groupNode = it->group.lock();
-        if (groupNode) {
-            std::list<ViewerInstance*> connectedViewers;
-            groupNode->getNode()->hasViewersConnected(&connectedViewers);
-            for (std::list<ViewerInstance*>::iterator it2 = connectedViewers.begin(); it2 != connectedViewers.end(); ++it2) {
-                viewers.insert(*it2);
-            }
-            groupNode->getNode()->deactivate(NodesList(), true, false, true, false, false);
-            for (std::list<NodeGuiWPtr>::iterator it2 = it->inlinedNodes.begin();
-                 it2 != it->inlinedNodes.end(); ++it2) {
-                NodeGuiPtr node = (*it2).lock();
-                if (node) {
-                    if  (_firstRedoCalled) {
-                        node->getNode()->activate(NodesList(), false, false);
+    {
+        // Refresh the metadata downstream once for all the edits below
+        MetadataRefreshBatch_RAII metadataBatch;
+        for (std::list<InlinedGroup>::iterator it = _groupNodes.begin(); it != _groupNodes.end(); ++it) {
+            NodeGuiPtr groupNode = it->group.lock();
+            if (groupNode) {
+                std::list<ViewerInstance*> connectedViewers;
+                groupNode->getNode()->hasViewersConnected(&connectedViewers);
+                for (std::list<ViewerInstance*>::iterator it2 = connectedViewers.begin(); it2 != connectedViewers.end(); ++it2) {
+                    viewers.insert(*it2);
+                }
+                groupNode->getNode()->deactivate(NodesList(), true, false, true, false, false);
+                for (std::list<NodeGuiWPtr>::iterator it2 = it->inlinedNodes.begin();
+                     it2 != it->inlinedNodes.end(); ++it2) {
+                    NodeGuiPtr node = (*it2).lock();
+                    if (node) {
+                        if  (_firstRedoCalled) {
+                            node->getNode()->activate(NodesList(), false, false);
+                        }
+                        nodesToSelect.push_back(node);
                     }
-                    nodesToSelect.push_back(node);
                 }
-            }
 
-            for (std::map<int, NodeToConnect>::iterator it2 = it->connections.begin(); it2 != it->connections.end(); ++it2) {
-                NodeGuiPtr input = it2->second.input.lock();
-                if (!input) {
-                    continue;
-                }
-                for (std::map<NodeGuiWPtr, int>::iterator it3 = it2->second.outputs.begin();
-                     it3 != it2->second.outputs.end(); ++it3) {
-                    NodeGuiPtr node = it3->first.lock();
-                    if (node) {
-                        node->getNode()->disconnectInput(it3->second);
-                        NodeCollection::connectNodes(it3->second, input->getNode(), node->getNode(), false);
+                for (std::map<int, NodeToConnect>::iterator it2 = it->connections.begin(); it2 != it->connections.end(); ++it2) {
+                    NodeGuiPtr input = it2->second.input.lock();
+                    if (!input) {
+                        continue;
+                    }
+                    for (std::map<NodeGuiWPtr, int>::iterator it3 = it2->second.outputs.begin();
+                         it3 != it2->second.outputs.end(); ++it3) {
+                        NodeGuiPtr node = it3->first.lock();
+                        if (node) {
+                            node->getNode()->disconnectInput(it3->second);
+                            NodeCollection::connectNodes(it3->second, input->getNode(), node->getNode(), false);
+                        }
                     }
                 }
             }
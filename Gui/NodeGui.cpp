@@ -170,6 +170,9 @@ NodeGui::NodeGui(QGraphicsItem *parent)
     , _previewData( NATRON_PREVIEW_HEIGHT * NATRON_PREVIEW_WIDTH * sizeof(unsigned int) )
     , _previewW(NATRON_PREVIEW_WIDTH)
     , _previewH(NATRON_PREVIEW_HEIGHT)
+    , _previewComputed(false)
+    , _previewHash(0)
+    , _previewTime(0)
     , _persistentMessage(NULL)
     , _stateIndicator(NULL)
     , _mergeHintActive(false)
@@ -221,6 +224,9 @@ NodeGui::initialize(NodeGraph* dag,
     assert(internalNode);
     _graph = dag;
 
+    ///the stack is still empty here, which QUndoStack requires to set a limit
+    _undoStack->setUndoLimit( appPTR->getCurrentSettings()->getMaximumUndoRedoNodes() );
+
     NodeGuiPtr thisAsShared = shared_from_this();
 
     internalNode->setNodeGuiPointer(thisAsShared);
@@ -1360,17 +1366,31 @@ NodeGui::onPreviewImageComputed()
 void
 NodeGui::copyPreviewImageBuffer(const std::vector<unsigned int>& data,
                                 int width,
-                                int height)
+                                int height,
+                                U64 nodeHash,
+                                double time)
 {
     {
         QMutexLocker k(&_previewDataMutex);
         _previewData = data;
         _previewW = width;
         _previewH = height;
+        _previewComputed = nodeHash != 0;
+        _previewHash = nodeHash;
+        _previewTime = time;
     }
     Q_EMIT previewImageComputed();
 }
 
+bool
+NodeGui::isPreviewUpToDate(U64 nodeHash,
+                           double time) const
+{
+    QMutexLocker k(&_previewDataMutex);
+
+    return _previewComputed && _previewHash == nodeHash && _previewTime == time;
+}
+
 bool
 NodeGui::getOverlayColor(double* r,
                          double* g,
@@ -399,7 +399,16 @@ public:
                                        unsigned int version) OVERRIDE FINAL;
     virtual void onIdentityStateChanged(int inputNb) OVERRIDE FINAL;
 
-    void copyPreviewImageBuffer(const std::vector<unsigned int>& data, int width, int height);
+    /**
+     * @brief Sets the preview image, computed for the given node hash and time. A hash of 0 means the
+     * preview could not be computed and is never up to date.
+     **/
+    void copyPreviewImageBuffer(const std::vector<unsigned int>& data, int width, int height, U64 nodeHash, double time);
+
+    /**
+     * @brief Returns true if the preview image displayed was computed for the given node hash and time.
+     **/
+    bool isPreviewUpToDate(U64 nodeHash, double time) const;
 
     void onKnobExpressionChanged(const KnobGui* knob);
 
@@ -612,6 +621,9 @@ private:
     mutable QMutex _previewDataMutex;
     std::vector<unsigned int> _previewData;
     int _previewW, _previewH;
+    bool _previewComputed;
+    U64 _previewHash;
+    double _previewTime;
     QGraphicsSimpleTextItem* _persistentMessage;
     NodeGraphRectItem* _stateIndicator;
     bool _mergeHintActive;
@@ -105,6 +105,11 @@ PreviewThread::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
 
 
     NodeGuiPtr node = args->node.lock();
+    NodePtr internalNode = node ? node->getNode() : NodePtr();
+    // Requests are queued on every change: skip those for which the displayed preview is still valid
+    if ( node && internalNode && node->isPreviewUpToDate(internalNode->getHashValue(), args->time) ) {
+        return eThreadStateActive;
+    }
     if (node) {
         ///Mark this thread as running
         appPTR->fetchAndAddNRunningThreads(1);
@@ -121,11 +126,12 @@ PreviewThread::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
             _imp->data[i] = qRgba(0, 0, 0, 255);
         }
 #endif
-        NodePtr internalNode = node->getNode();
         if (internalNode) {
+            // Take the hash before rendering: if it changes during the render, a new request is queued anyway
+            U64 nodeHash = internalNode->getHashValue();
             bool ok = internalNode->makePreviewImage( args->time, &w, &h, &_imp->data.front() );
-            Q_UNUSED(ok);
-            node->copyPreviewImageBuffer(_imp->data, w, h);
+            // A failed (or aborted) preview must be computed again by the next request
+            node->copyPreviewImageBuffer(_imp->data, w, h, ok ? nodeHash : 0, ok ? args->time : 0);
         }
 
         ///Unmark this thread as running
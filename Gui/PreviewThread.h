@@ -60,6 +60,14 @@ private:
         return eTaskQueueBehaviorProcessInOrder;
     }
 
+    /**
+     * @brief Previews must not take CPU time from the viewer and the renders the user is waiting for
+     **/
+    virtual QThread::Priority getThreadPriority() const OVERRIDE FINAL
+    {
+        return QThread::LowPriority;
+    }
+
     virtual ThreadStateEnum threadLoopOnce(const GenericThreadStartArgsPtr& inArgs) OVERRIDE FINAL WARN_UNUSED_RETURN;
     boost::scoped_ptr<PreviewThreadPrivate> _imp;
 };
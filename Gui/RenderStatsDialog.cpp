@@ -25,7 +25,10 @@
 
 #include "RenderStatsDialog.h"
 
+#include <algorithm> // max
 #include <bitset>
+#include <cassert>
+#include <list>
 #include <stdexcept>
 
 #include <QtCore/QCoreApplication>
@@ -36,7 +39,9 @@
 #include <QItemSelectionModel>
 #include <QtCore/QRegExp>
 
+#include "Engine/MemoryInfo.h" // printAsRAM
 #include "Engine/Node.h"
+#include "Engine/RenderStats.h"
 #include "Engine/Timer.h"
 #include "Engine/Utils.h" // convertFromPlainText
 #include "Engine/ViewIdx.h"
@@ -65,8 +70,10 @@
 #define COL_NB_CACHE_HIT 13
 #define COL_NB_CACHE_HIT_DOWNSCALED 14
 #define COL_NB_CACHE_MISS 15
+#define COL_IMAGES_MEMORY 16
+#define COL_PLUGIN_MEMORY_PEAK 17
 
-#define NUM_COLS 16
+#define NUM_COLS 18
 
 NATRON_NAMESPACE_ENTER
 
@@ -77,6 +84,9 @@ enum ItemsRoleEnum
     eItemsRoleIdentityTilesInfo = 102,
     eItemsRoleRenderedTilesNb = 103,
     eItemsRoleRenderedTilesInfo = 104,
+    eItemsRoleImagesMemory = 105,
+    eItemsRoleTemporaryImagesMemory = 106,
+    eItemsRolePluginMemoryPeak = 107,
 };
 
 struct RowInfo
@@ -111,6 +121,12 @@ struct StatRowsCompare
         case COL_TIME:
 
             return lhs.item->data( (int)eItemsRoleTime ).toDouble() < rhs.item->data( (int)eItemsRoleTime ).toDouble();
+        case COL_IMAGES_MEMORY:
+
+            return lhs.item->data( (int)eItemsRoleImagesMemory ).toULongLong() < rhs.item->data( (int)eItemsRoleImagesMemory ).toULongLong();
+        case COL_PLUGIN_MEMORY_PEAK:
+
+            return lhs.item->data( (int)eItemsRolePluginMemoryPeak ).toULongLong() < rhs.item->data( (int)eItemsRolePluginMemoryPeak ).toULongLong();
         default:
 
             return lhs.item->text() < rhs.item->text();
@@ -646,6 +662,62 @@ public:
                 }
             }
         }
+        {
+            TableItem* item = 0;
+            qulonglong totalBytes = 0, temporaryBytesSoFar = 0;
+            if (exists) {
+                item = view->item(row, COL_IMAGES_MEMORY);
+                totalBytes = item->data( (int)eItemsRoleImagesMemory ).toULongLong();
+                temporaryBytesSoFar = item->data( (int)eItemsRoleTemporaryImagesMemory ).toULongLong();
+            } else {
+                item = new TableItem;
+                QString tt = NATRON_NAMESPACE::convertFromPlainText(tr("The memory of the images allocated by the renders of this node, "
+                                                                       "and in parenthesis the part of it that was not kept in the cache once "
+                                                                       "the render was done (e.g: downscaled images)."), NATRON_NAMESPACE::WhiteSpaceNormal);
+                item->setToolTip(tt);
+                item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+            }
+            assert(item);
+            std::size_t cachedBytes, temporaryBytes;
+            stats.getImagesMemoryAllocated(&cachedBytes, &temporaryBytes);
+            totalBytes += cachedBytes + temporaryBytes;
+            temporaryBytesSoFar += temporaryBytes;
+            if (nodeUi) {
+                item->setTextColor(Qt::black);
+                item->setBackgroundColor(c);
+            }
+            item->setData( (int)eItemsRoleImagesMemory, totalBytes );
+            item->setData( (int)eItemsRoleTemporaryImagesMemory, temporaryBytesSoFar );
+            item->setText( tr("%1 (%2 temporary)").arg( printAsRAM(totalBytes) ).arg( printAsRAM(temporaryBytesSoFar) ) );
+            if (!exists) {
+                view->setItem(row, COL_IMAGES_MEMORY, item);
+            }
+        }
+        {
+            TableItem* item = 0;
+            qulonglong peak = 0;
+            if (exists) {
+                item = view->item(row, COL_PLUGIN_MEMORY_PEAK);
+                peak = item->data( (int)eItemsRolePluginMemoryPeak ).toULongLong();
+            } else {
+                item = new TableItem;
+                QString tt = NATRON_NAMESPACE::convertFromPlainText(tr("The highest amount of memory held by the plug-in "
+                                                                       "through the OpenFX memory suite while rendering."), NATRON_NAMESPACE::WhiteSpaceNormal);
+                item->setToolTip(tt);
+                item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+            }
+            assert(item);
+            peak = std::max( peak, (qulonglong)stats.getPluginMemoryHighWaterMark() );
+            if (nodeUi) {
+                item->setTextColor(Qt::black);
+                item->setBackgroundColor(c);
+            }
+            item->setData( (int)eItemsRolePluginMemoryPeak, peak );
+            item->setText( printAsRAM(peak) );
+            if (!exists) {
+                view->setItem(row, COL_PLUGIN_MEMORY_PEAK, item);
+            }
+        }
         if (!exists) {
             rows.push_back(node);
         }
@@ -705,6 +777,10 @@ struct RenderStatsDialogPrivate
     Label* totalTimeSpentValueLabel;
     double totalSpentTime;
     Button* resetButton;
+    QWidget* criticalPathContainer;
+    QHBoxLayout* criticalPathLayout;
+    Label* criticalPathDescLabel;
+    Label* criticalPathValueLabel;
     QWidget* filterContainer;
     QHBoxLayout* filterLayout;
     Label* filtersLabel;
@@ -731,6 +807,10 @@ struct RenderStatsDialogPrivate
         , totalTimeSpentValueLabel(0)
         , totalSpentTime(0)
         , resetButton(0)
+        , criticalPathContainer(0)
+        , criticalPathLayout(0)
+        , criticalPathDescLabel(0)
+        , criticalPathValueLabel(0)
         , filterContainer(0)
         , filterLayout(0)
         , filtersLabel(0)
@@ -820,6 +900,25 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
 
     _imp->mainLayout->addWidget(_imp->globalInfosContainer);
 
+    _imp->criticalPathContainer = new QWidget(this);
+    _imp->criticalPathLayout = new QHBoxLayout(_imp->criticalPathContainer);
+
+    QString criticalPathTt = NATRON_NAMESPACE::convertFromPlainText(tr("The chain of nodes which limited the time spent to render the last frame: "
+                                                                       "starting from the node that finished last, each node is preceded by its input that finished last.\n"
+                                                                       "Speeding up a node outside of this path does not make the frame render faster.\n"
+                                                                       "Nodes which cannot use all the threads to render (their render is not thread-safe, "
+                                                                       "or they do not support tiles or render scale) are flagged as serial bottlenecks."), NATRON_NAMESPACE::WhiteSpaceNormal);
+    _imp->criticalPathDescLabel = new Label(tr("Critical path:"), _imp->criticalPathContainer);
+    _imp->criticalPathDescLabel->setToolTip(criticalPathTt);
+    _imp->criticalPathValueLabel = new Label(_imp->criticalPathContainer);
+    _imp->criticalPathValueLabel->setToolTip(criticalPathTt);
+    _imp->criticalPathValueLabel->setWordWrap(true);
+
+    _imp->criticalPathLayout->addWidget(_imp->criticalPathDescLabel);
+    _imp->criticalPathLayout->addWidget(_imp->criticalPathValueLabel, 1);
+
+    _imp->mainLayout->addWidget(_imp->criticalPathContainer);
+
     _imp->filterContainer = new QWidget(this);
     _imp->filterLayout = new QHBoxLayout(_imp->filterContainer);
 
@@ -891,7 +990,9 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
         << tr("Rendered Planes")
         << tr("Cache Hits")
         << tr("Cache Hits Higher Scale")
-        << tr("Cache Misses");
+        << tr("Cache Misses")
+        << tr("Images Memory")
+        << tr("Plug-in Memory Peak");
 
     _imp->view->setColumnCount( dimensionNames.size() );
     _imp->view->setHorizontalHeaderLabels(dimensionNames);
@@ -973,6 +1074,7 @@ RenderStatsDialog::resetStats()
     _imp->model->clearRows();
     _imp->totalTimeSpentValueLabel->setText( QString::fromUtf8("0.0 sec") );
     _imp->totalSpentTime = 0;
+    _imp->criticalPathValueLabel->clear();
 }
 
 void
@@ -993,6 +1095,28 @@ RenderStatsDialog::addStats(int /*time*/,
         _imp->model->editNodeRow(it->first, it->second);
     }
 
+    // The critical path is that of the last frame: it cannot be accumulated since the renders overlap
+    std::list<NodePtr> criticalPath;
+    RenderStats::computeCriticalPath(stats, &criticalPath);
+    if ( !criticalPath.empty() ) {
+        QString pathText;
+        for (std::list<NodePtr>::const_iterator it = criticalPath.begin(); it != criticalPath.end(); ++it) {
+            std::map<NodePtr, NodeRenderStats >::const_iterator found = stats.find(*it);
+            assert( found != stats.end() );
+            if ( it != criticalPath.begin() ) {
+                pathText += QString::fromUtf8(" -> ");
+            }
+            pathText += QString::fromUtf8( (*it)->getLabel().c_str() );
+            pathText += QString::fromUtf8(" (") + Timer::printAsTime(found->second.getTotalTimeSpentRendering(), false);
+            std::string reasons;
+            if ( found->second.isSerialBottleneck(&reasons) ) {
+                pathText += QString::fromUtf8(", ") + tr("serial bottleneck: %1").arg( QString::fromUtf8( reasons.c_str() ) );
+            }
+            pathText += QLatin1Char(')');
+        }
+        _imp->criticalPathValueLabel->setText(pathText);
+    }
+
     updateVisibleRows();
     if ( !stats.empty() ) {
         _imp->view->header()->setSortIndicator(COL_TIME, Qt::DescendingOrder);
@@ -31,32 +31,34 @@ NATRON_NAMESPACE_ENTER
 
 const char* fragRGB =
     "uniform sampler2D Tex;\n"
+    "uniform sampler1D LutTex;\n" // the display Lut sampled over [0,1], see NATRON_VIEWER_DISPLAY_LUT_SIZE
     "uniform float gain;\n"
     "uniform float offset;\n"
-    "uniform int lut;\n"
+    "uniform int useLut;\n"
     "uniform float gamma;\n"
+    "uniform int channels;\n" // DisplayChannelsEnum: R, G, B and luminance are extracted here from the RGB texture
     "\n"
-    "float linear_to_srgb(float c) {\n"
-    "    return (c<=0.0031308) ? (12.92*c) : (((1.0+0.055)*pow(c,1.0/2.4))-0.055);\n"
-    "}\n"
-    "float linear_to_rec709(float c) {"
-    "    return (c<0.018) ? (4.500*c) : (1.099*pow(c,0.45) - 0.099);\n"
+    "float apply_lut(float c) {\n"
+    "    const float size = " STRINGIZE_CPP_NAME(NATRON_VIEWER_DISPLAY_LUT_SIZE) ".0;\n"
+    "    return texture1D(LutTex, (clamp(c, 0.0, 1.0) * (size - 1.0) + 0.5) / size).r;\n"
     "}\n"
     "void main(){\n"
     "    vec4 color_tmp = texture2D(Tex,gl_TexCoord[0].st);\n"
+    "    if (channels == 1) { // R\n"
+    "       color_tmp.rgb = vec3(color_tmp.r);\n"
+    "    } else if (channels == 2) { // G\n"
+    "       color_tmp.rgb = vec3(color_tmp.g);\n"
+    "    } else if (channels == 3) { // B\n"
+    "       color_tmp.rgb = vec3(color_tmp.b);\n"
+    "    } else if (channels == 5) { // Y\n"
+    "       color_tmp.rgb = vec3(0.299 * color_tmp.r + 0.587 * color_tmp.g + 0.114 * color_tmp.b);\n"
+    "    }\n"
     "    color_tmp.rgb = (color_tmp.rgb * gain) + offset;\n"
-    "    if(lut == 0){ // srgb\n"
-// << TO SRGB
-    "       color_tmp.r = linear_to_srgb(color_tmp.r);\n"
-    "       color_tmp.g = linear_to_srgb(color_tmp.g);\n"
-    "       color_tmp.b = linear_to_srgb(color_tmp.b);\n"
-// << END TO SRGB
+    "    if (useLut != 0) {\n"
+    "       color_tmp.r = apply_lut(color_tmp.r);\n"
+    "       color_tmp.g = apply_lut(color_tmp.g);\n"
+    "       color_tmp.b = apply_lut(color_tmp.b);\n"
     "   }\n"
-    "   else if (lut == 2){ // Rec 709\n" // << TO REC 709
-    "       color_tmp.r = linear_to_rec709(color_tmp.r);\n"
-    "       color_tmp.g = linear_to_rec709(color_tmp.g);\n"
-    "       color_tmp.b = linear_to_rec709(color_tmp.b);\n"
-    "   }\n" // << END TO REC 709
     "   if (gamma <= 0.) {\n"
     "       color_tmp.r = (color_tmp.r >= 1.) ? 1. : 0.;\n"
     "       color_tmp.g = (color_tmp.g >= 1.) ? 1. : 0.;\n"
@@ -28,6 +28,9 @@
 
 #include "Global/Macros.h"
 
+// Number of samples of the 1D texture holding the display Lut applied by fragRGB to floating-point textures
+#define NATRON_VIEWER_DISPLAY_LUT_SIZE 4096
+
 NATRON_NAMESPACE_ENTER
 
 extern const char* fragRGB;
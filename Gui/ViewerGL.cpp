@@ -51,12 +51,14 @@ GCC_DIAG_UNUSED_PRIVATE_FIELD_ON
 #include <QtOpenGL/QGLShaderProgram>
 #include <QTreeWidget>
 #include <QTabBar>
+#include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
 
 #include "Engine/Lut.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGuiI.h"
 #include "Engine/Project.h"
 #include "Engine/OfxOverlayInteract.h"
+#include "Engine/PerfCounters.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/Settings.h"
 #include "Engine/Timer.h" // for gettimeofday
@@ -111,6 +113,8 @@ GCC_DIAG_UNUSED_PRIVATE_FIELD_ON
 
 NATRON_NAMESPACE_ENTER
 
+static std::vector<ColorPickerRectResult> getColorsAtRectForArgs(const std::vector<ColorPickerRectArgs>& args);
+
 
 ViewerGL::ViewerGL(ViewerTab* parent,
                    const QGLWidget* shareWidget)
@@ -127,6 +131,7 @@ ViewerGL::ViewerGL(ViewerTab* parent,
     populateMenu();
 
     QObject::connect( appPTR, SIGNAL(checkerboardSettingsChanged()), this, SLOT(onCheckerboardSettingsChanged()) );
+    QObject::connect( _imp->rectanglePickerWatcher, SIGNAL(finished()), this, SLOT(onRectangleColorPickerFinished()) );
 }
 
 ViewerGL::~ViewerGL()
@@ -1217,6 +1222,7 @@ ViewerGL::getPboID(int index)
         GLuint handle;
         glGenBuffers(1, &handle);
         _imp->pboIds.push_back(handle);
+        _imp->pboSizes.push_back(0);
 
         return handle;
     } else {
@@ -1458,7 +1464,16 @@ ViewerGL::initShaderGLSL()
 void
 ViewerGL::clearPartialUpdateTextures()
 {
+    // Keep the textures for the next partial updates: while tracking they mostly have the same size
+    for (std::size_t i = 0; i < _imp->partialUpdateTextures.size(); ++i) {
+        if (_imp->partialUpdateTextures[i].texture) {
+            _imp->partialUpdateTexturesPool.push_front(_imp->partialUpdateTextures[i].texture);
+        }
+    }
     _imp->partialUpdateTextures.clear();
+    while (_imp->partialUpdateTexturesPool.size() > NATRON_VIEWER_PARTIAL_UPDATE_TEXTURES_POOL_SIZE) {
+        _imp->partialUpdateTexturesPool.pop_back();
+    }
 }
 
 bool
@@ -1583,16 +1598,18 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
         qDebug() << "(ViewerGL::allocateAndMapPBO): Another PBO is currently mapped, glMap failed.";
     }
 
-    // We use 2 PBOs to make use of asynchronous data uploading
-    GLuint pboId = getPboID(_imp->updateViewerPboIndex);
+    // We cycle through NATRON_VIEWER_PBO_RING_SIZE PBOs to make use of asynchronous data uploading
+    const int pboIndex = _imp->updateViewerPboIndex;
+    GLuint pboId = getPboID(pboIndex);
 
     // The bitdepth of the texture
     ImageBitDepthEnum bd = getBitDepth();
     Texture::DataTypeEnum dataType;
     if (bd == eImageBitDepthByte) {
         dataType = Texture::eDataTypeByte;
+    } else if (bd == eImageBitDepthHalf) {
+        dataType = Texture::eDataTypeHalf;
     } else {
-        //do 32bit fp textures either way, don't bother with half float. We might support it further on.
         dataType = Texture::eDataTypeFloat;
     }
     assert(textureIndex == 0 || textureIndex == 1);
@@ -1600,14 +1617,27 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
     GLTexturePtr tex;
     TextureRect textureRectangle;
     if (isPartialRect) {
-        // For small partial updates overlays, we make new textures
-        int format, internalFormat, glType;
-        if (dataType == Texture::eDataTypeFloat) {
-            Texture::getRecommendedTexParametersForRGBAFloatTexture(&format, &internalFormat, &glType);
-        } else {
-            Texture::getRecommendedTexParametersForRGBAByteTexture(&format, &internalFormat, &glType);
+        // For small partial updates overlays, re-use a released texture of the same size and type if possible:
+        // ensureTextureHasSize() then only moves it and the upload does not re-allocate the storage
+        for (std::list<GLTexturePtr>::iterator it = _imp->partialUpdateTexturesPool.begin(); it != _imp->partialUpdateTexturesPool.end(); ++it) {
+            if ( ( (*it)->type() == dataType ) && ( (*it)->w() == tileRect.width() ) && ( (*it)->h() == tileRect.height() ) ) {
+                tex = *it;
+                _imp->partialUpdateTexturesPool.erase(it);
+                break;
+            }
+        }
+        if (!tex) {
+            // Otherwise we make a new texture
+            int format, internalFormat, glType;
+            if (dataType == Texture::eDataTypeFloat) {
+                Texture::getRecommendedTexParametersForRGBAFloatTexture(&format, &internalFormat, &glType);
+            } else if (dataType == Texture::eDataTypeHalf) {
+                Texture::getRecommendedTexParametersForRGBAHalfTexture(&format, &internalFormat, &glType);
+            } else {
+                Texture::getRecommendedTexParametersForRGBAByteTexture(&format, &internalFormat, &glType);
+            }
+            tex.reset( new Texture(GL_TEXTURE_2D, GL_LINEAR, GL_NEAREST, GL_CLAMP_TO_EDGE, dataType, format, internalFormat, glType) );
         }
-        tex.reset( new Texture(GL_TEXTURE_2D, GL_LINEAR, GL_NEAREST, GL_CLAMP_TO_EDGE, dataType, format, internalFormat, glType) );
         textureRectangle = tileRect;
     } else {
         // re-use the existing texture if possible
@@ -1616,6 +1646,8 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
             int format, internalFormat, glType;
             if (dataType == Texture::eDataTypeFloat) {
                 Texture::getRecommendedTexParametersForRGBAFloatTexture(&format, &internalFormat, &glType);
+            } else if (dataType == Texture::eDataTypeHalf) {
+                Texture::getRecommendedTexParametersForRGBAHalfTexture(&format, &internalFormat, &glType);
             } else {
                 Texture::getRecommendedTexParametersForRGBAByteTexture(&format, &internalFormat, &glType);
             }
@@ -1642,7 +1674,14 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
     // If you do that, the previous data in PBO will be discarded and
     // glMapBufferARB() returns a new allocated pointer immediately
     // even if GPU is still working with the previous data.
-    glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, bytesCount, NULL, GL_DYNAMIC_DRAW_ARB);
+    // The PBO keeps the largest size it was asked for: orphaning with an unchanged size lets the driver
+    // recycle the storage it released instead of allocating a new one for every tile.
+    // The data is written once and read once by the GPU: this is a stream buffer.
+    std::size_t& pboSize = _imp->pboSizes[pboIndex];
+    if (bytesCount > pboSize) {
+        pboSize = bytesCount;
+    }
+    glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, pboSize, NULL, GL_STREAM_DRAW_ARB);
 
     // map the buffer object into client's memory
     GLvoid *ret = glMapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY_ARB);
@@ -1652,6 +1691,7 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
     if (ret && ramBuffer) {
         // update data directly on the mapped buffer
         std::memcpy(ret, (void*)ramBuffer, bytesCount);
+        PerfCounters::increment(ePerfCounterBytesUploadedToGPU, bytesCount);
         GLboolean result = glUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB); // release the mapped buffer
         assert(result == GL_TRUE);
         Q_UNUSED(result);
@@ -1670,7 +1710,7 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
 
     *texture = tex;
 
-    _imp->updateViewerPboIndex = (_imp->updateViewerPboIndex + 1) % 2;
+    _imp->updateViewerPboIndex = (_imp->updateViewerPboIndex + 1) % NATRON_VIEWER_PBO_RING_SIZE;
 } // ViewerGL::transferBufferFromRAMtoGPU
 
 void
@@ -3894,7 +3934,14 @@ ViewerGL::updateRectangleColorPicker()
 void
 ViewerGL::updateRectangleColorPickerInternal()
 {
-    float r, g, b, a;
+    // The average over a large rectangle may take a while: compute it on a worker thread so that dragging the
+    // rectangle does not stall the interface
+    if ( _imp->rectanglePickerWatcher->isRunning() ) {
+        _imp->rectanglePickerPending = true;
+
+        return;
+    }
+
     bool linear = appPTR->getCurrentSettings()->getColorPickerLinear();
     QPointF topLeft = _imp->pickerRect.topLeft();
     QPointF btmRight = _imp->pickerRect.bottomRight();
@@ -3904,10 +3951,32 @@ ViewerGL::updateRectangleColorPickerInternal()
     rect.set_right( std::max( topLeft.x(), btmRight.x() ) );
     rect.set_bottom( std::min( topLeft.y(), btmRight.y() ) );
     rect.set_top( std::max( topLeft.y(), btmRight.y() ) );
+    std::vector<ColorPickerRectArgs> args(2);
     for (int i = 0; i < 2; ++i) {
-        unsigned int mm;
-        bool picked = getColorAtRect(rect, linear, i, &r, &g, &b, &a, &mm);
-        if (picked) {
+        _imp->getColorPickerRectArgs(rect, linear, i, &args[i]);
+    }
+    _imp->rectanglePickerWatcher->setFuture( QtConcurrent::run(getColorsAtRectForArgs, args) );
+}
+
+void
+ViewerGL::onRectangleColorPickerFinished()
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+
+    std::vector<ColorPickerRectResult> results = _imp->rectanglePickerWatcher->result();
+    if (_imp->rectanglePickerPending) {
+        _imp->rectanglePickerPending = false;
+        updateRectangleColorPickerInternal();
+    }
+    if (_imp->pickerState != ePickerStateRectangle) {
+        return;
+    }
+    assert(results.size() == 2);
+    for (int i = 0; i < 2; ++i) {
+        const float r = results[i].r, g = results[i].g, b = results[i].b, a = results[i].a;
+        const unsigned int mm = results[i].mipMapLevel;
+        if (results[i].picked) {
             if (i == 0) {
                 _imp->viewerTab->getGui()->setColorPickersColor(r, g, b, a);
             }
@@ -4027,7 +4096,7 @@ ViewerGL::getTextureColorAt(int x,
         *b = (double)blue * (1. / 255);
         *a = (double)alpha * (1. / 255);
         glCheckError();
-    } else if (type == Texture::eDataTypeFloat) {
+    } else if ( (type == Texture::eDataTypeFloat) || (type == Texture::eDataTypeHalf) ) {
         GLfloat pixel[4];
         glReadPixels(pos.x(), height() - pos.y(), 1, 1, GL_RGBA, GL_FLOAT, pixel);
         *r = (double)pixel[0];
@@ -4213,6 +4282,60 @@ ViewerGL::getCurrentRenderScale() const
     return getMipMapLevelCombinedToZoomFactor();
 }
 
+template <typename PIX, int maxValue>
+static
+void
+getColorOfPixel(const PIX* pix,
+                int nComps,
+                bool forceLinear,
+                const Color::Lut* srcColorSpace,
+                const Color::Lut* dstColorSpace,
+                float* r,
+                float* g,
+                float* b,
+                float* a)
+{
+    if (nComps >= 4) {
+        *r = pix[0] * (1.f / maxValue);
+        *g = pix[1] * (1.f / maxValue);
+        *b = pix[2] * (1.f / maxValue);
+        *a = pix[3] * (1.f / maxValue);
+    } else if (nComps == 3) {
+        *r = pix[0] * (1.f / maxValue);
+        *g = pix[1] * (1.f / maxValue);
+        *b = pix[2] * (1.f / maxValue);
+        *a = 1.;
+    } else if (nComps == 2) {
+        *r = pix[0] * (1.f / maxValue);
+        *g = pix[1] * (1.f / maxValue);
+        *b = 1.;
+        *a = 1.;
+    } else {
+        *r = *g = *b = *a = pix[0] * (1.f / maxValue);
+    }
+
+
+    ///convert to linear
+    if (srcColorSpace) {
+        *r = srcColorSpace->fromColorSpaceFloatToLinearFloat(*r);
+        *g = srcColorSpace->fromColorSpaceFloatToLinearFloat(*g);
+        *b = srcColorSpace->fromColorSpaceFloatToLinearFloat(*b);
+    }
+
+    if (!forceLinear && dstColorSpace) {
+        ///convert to dst color space
+        float from[3];
+        from[0] = *r;
+        from[1] = *g;
+        from[2] = *b;
+        float to[3];
+        dstColorSpace->to_float_planar(to, from, 3);
+        *r = to[0];
+        *g = to[1];
+        *b = to[2];
+    }
+} // getColorOfPixel
+
 template <typename PIX, int maxValue>
 static
 bool
@@ -4235,53 +4358,95 @@ getColorAtInternal(const ImagePtr& image,
             return false;
         }
 
-        int nComps = image->getComponents().getNumComponents();
-        if (nComps >= 4) {
-            *r = pix[0] * (1.f / maxValue);
-            *g = pix[1] * (1.f / maxValue);
-            *b = pix[2] * (1.f / maxValue);
-            *a = pix[3] * (1.f / maxValue);
-        } else if (nComps == 3) {
-            *r = pix[0] * (1.f / maxValue);
-            *g = pix[1] * (1.f / maxValue);
-            *b = pix[2] * (1.f / maxValue);
-            *a = 1.;
-        } else if (nComps == 2) {
-            *r = pix[0] * (1.f / maxValue);
-            *g = pix[1] * (1.f / maxValue);
-            *b = 1.;
-            *a = 1.;
-        } else {
-            *r = *g = *b = *a = pix[0] * (1.f / maxValue);
-        }
+        getColorOfPixel<PIX, maxValue>(pix, image->getComponents().getNumComponents(), forceLinear, srcColorSpace, dstColorSpace, r, g, b, a);
 
+        return true;
+    }
 
-        ///convert to linear
-        if (srcColorSpace) {
-            *r = srcColorSpace->fromColorSpaceFloatToLinearFloat(*r);
-            *g = srcColorSpace->fromColorSpaceFloatToLinearFloat(*g);
-            *b = srcColorSpace->fromColorSpaceFloatToLinearFloat(*b);
-        }
 
-        if (!forceLinear && dstColorSpace) {
-            ///convert to dst color space
-            float from[3];
-            from[0] = *r;
-            from[1] = *g;
-            from[2] = *b;
-            float to[3];
-            dstColorSpace->to_float_planar(to, from, 3);
-            *r = to[0];
-            *g = to[1];
-            *b = to[2];
+    return false;
+} // getColorAtInternal
+
+/**
+ * @brief Averages the colors of args.image over args.rectPixel. The image is locked once and walked row by row.
+ * This does not depend on the viewer and may run on any thread.
+ **/
+template <typename PIX, int maxValue>
+static
+void
+getColorAtRectInternal(const ColorPickerRectArgs& args,
+                       ColorPickerRectResult* result)
+{
+    Image::ReadAccess racc( args.image.get() );
+    Image::ConstPixelSpan span = racc.spanAt(args.rectPixel);
+
+    if ( span.isEmpty() ) {
+        return;
+    }
+
+    const int nComps = args.image->getComponents().getNumComponents();
+    double rSum = 0.;
+    double gSum = 0.;
+    double bSum = 0.;
+    double aSum = 0.;
+    for (int y = span.bounds.y1; y < span.bounds.y2; ++y) {
+        const PIX* pix = span.rowAt<const PIX>(y);
+        for (int x = span.bounds.x1; x < span.bounds.x2; ++x, pix += nComps) {
+            float rPix, gPix, bPix, aPix;
+            getColorOfPixel<PIX, maxValue>(pix, nComps, args.forceLinear, args.srcColorSpace, args.dstColorSpace, &rPix, &gPix, &bPix, &aPix);
+            rSum += rPix;
+            gSum += gPix;
+            bSum += bPix;
+            aSum += aPix;
         }
+    }
 
-        return true;
+    const double area = (double)span.bounds.width() * span.bounds.height();
+    result->r = rSum / area;
+    result->g = gSum / area;
+    result->b = bSum / area;
+    result->a = aSum / area;
+    result->picked = true;
+} // getColorAtRectInternal
+
+static ColorPickerRectResult
+getColorAtRectForArgs(const ColorPickerRectArgs& args)
+{
+    ColorPickerRectResult result;
+
+    if (!args.image) {
+        return result;
+    }
+    result.mipMapLevel = args.image->getMipMapLevel();
+    switch ( args.image->getBitDepth() ) {
+    case eImageBitDepthByte:
+        getColorAtRectInternal<unsigned char, 255>(args, &result);
+        break;
+    case eImageBitDepthShort:
+        getColorAtRectInternal<unsigned short, 65535>(args, &result);
+        break;
+    case eImageBitDepthFloat:
+        getColorAtRectInternal<float, 1>(args, &result);
+        break;
+    case eImageBitDepthHalf:
+    case eImageBitDepthNone:
+        break;
     }
 
+    return result;
+}
+
+static std::vector<ColorPickerRectResult>
+getColorsAtRectForArgs(const std::vector<ColorPickerRectArgs>& args)
+{
+    std::vector<ColorPickerRectResult> results( args.size() );
 
-    return false;
-} // getColorAtInternal
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        results[i] = getColorAtRectForArgs(args[i]);
+    }
+
+    return results;
+}
 
 bool
 ViewerGL::getColorAt(double x,
@@ -4383,6 +4548,44 @@ ViewerGL::getColorAt(double x,
     return gotval;
 } // getColorAt
 
+void
+ViewerGL::Implementation::getColorPickerRectArgs(const RectD &rect, // rectangle in canonical coordinates
+                                                 bool forceLinear,
+                                                 int textureIndex,
+                                                 ColorPickerRectArgs* args)
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+    assert(textureIndex == 0 || textureIndex == 1);
+
+    unsigned int mipMapLevel = (unsigned int)_this->getMipMapLevelCombinedToZoomFactor();
+    args->image = _this->getLastRenderedImageByMipMapLevel(textureIndex, mipMapLevel);
+    if (!args->image) {
+        return;
+    }
+    mipMapLevel = args->image->getMipMapLevel();
+
+    ///Convert to pixel coords
+    args->rectPixel.x1 = int( std::floor( rect.left() ) ) >> mipMapLevel;
+    args->rectPixel.y1 = int( std::floor( rect.bottom() ) ) >> mipMapLevel;
+    args->rectPixel.x2 = int( std::floor( rect.right() ) ) >> mipMapLevel;
+    args->rectPixel.y2 = int( std::floor( rect.top() ) ) >> mipMapLevel;
+    assert( rect.bottom() <= rect.top() && rect.left() <= rect.right() );
+    assert( args->rectPixel.y1 <= args->rectPixel.y2 && args->rectPixel.x1 <= args->rectPixel.x2 );
+
+    ImageBitDepthEnum depth = args->image->getBitDepth();
+    ViewerColorSpaceEnum srcCS = viewerTab->getGui()->getApp()->getDefaultColorSpaceForBitDepth(depth);
+    args->forceLinear = forceLinear;
+    if ( (srcCS == displayingImageLut) && ( (displayingImageLut == eViewerColorSpaceLinear) || !forceLinear ) ) {
+        // identity transform
+        args->srcColorSpace = 0;
+        args->dstColorSpace = 0;
+    } else {
+        args->srcColorSpace = ViewerInstance::lutFromColorspace(srcCS);
+        args->dstColorSpace = ViewerInstance::lutFromColorspace(displayingImageLut);
+    }
+}
+
 bool
 ViewerGL::getColorAtRect(const RectD &rect, // rectangle in canonical coordinates
                          bool forceLinear,
@@ -4396,183 +4599,22 @@ ViewerGL::getColorAtRect(const RectD &rect, // rectangle in canonical coordinate
     // always running in the main thread
     assert( qApp && qApp->thread() == QThread::currentThread() );
     assert(r && g && b && a);
-    assert(textureIndex == 0 || textureIndex == 1);
-
-    unsigned int mipMapLevel = (unsigned int)getMipMapLevelCombinedToZoomFactor();
-    ImagePtr image = getLastRenderedImageByMipMapLevel(textureIndex, mipMapLevel);
 
-    if (image) {
-        mipMapLevel = image->getMipMapLevel();
-        *imgMm = mipMapLevel;
+    ColorPickerRectArgs args;
+    _imp->getColorPickerRectArgs(rect, forceLinear, textureIndex, &args);
+    if (args.image) {
+        *imgMm = args.image->getMipMapLevel();
     }
-
-    ///Convert to pixel coords
-    RectI rectPixel;
-    rectPixel.x1 = int( std::floor( rect.left() ) ) >> mipMapLevel;
-    rectPixel.y1 = int( std::floor( rect.bottom() ) ) >> mipMapLevel;
-    rectPixel.x2 = int( std::floor( rect.right() ) ) >> mipMapLevel;
-    rectPixel.y2 = int( std::floor( rect.top() ) ) >> mipMapLevel;
-    assert( rect.bottom() <= rect.top() && rect.left() <= rect.right() );
-    assert( rectPixel.y1 <= rectPixel.y2 && rectPixel.x1 <= rectPixel.x2 );
-    double rSum = 0.;
-    double gSum = 0.;
-    double bSum = 0.;
-    double aSum = 0.;
-    if (!image) {
+    ColorPickerRectResult result = getColorAtRectForArgs(args);
+    if (!result.picked) {
         return false;
-        //don't do this as this is 8 bit
-        /*
-           Texture::DataTypeEnum type;
-           if (_imp->displayTextures[0]) {
-            type = _imp->displayTextures[0]->type();
-           } else if (_imp->displayTextures[1]) {
-            type = _imp->displayTextures[1]->type();
-           } else {
-            return false;
-           }
-
-           if ( (type == Texture::eDataTypeByte) ) {
-            std::vector<U32> pixels(rectPixel.width() * rectPixel.height());
-            glReadBuffer(GL_FRONT);
-            glReadPixels(rectPixel.left(), rectPixel.right(), rectPixel.width(), rectPixel.height(),
-                         GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, &pixels.front());
-            double rF,gF,bF,aF;
-            for (U32 i = 0 ; i < pixels.size(); ++i) {
-                U8 red = 0, green = 0, blue = 0, alpha = 0;
-                blue |= pixels[i];
-                green |= (pixels[i] >> 8);
-                red |= (pixels[i] >> 16);
-                alpha |= (pixels[i] >> 24);
-                rF = (double)red * (1. / 255);
-                gF = (double)green * (1. / 255);
-                bF = (double)blue * (1. / 255);
-                aF = (double)alpha * (1. / 255);
-
-                aSum += aF;
-                if ( forceLinear && (_imp->displayingImageLut != eViewerColorSpaceLinear) ) {
-                    const Color::Lut* srcColorSpace = ViewerInstance::lutFromColorspace(_imp->displayingImageLut);
-
-                    rSum += srcColorSpace->fromColorSpaceFloatToLinearFloat(rF);
-                    gSum += srcColorSpace->fromColorSpaceFloatToLinearFloat(gF);
-                    bSum += srcColorSpace->fromColorSpaceFloatToLinearFloat(bF);
-                } else {
-                    rSum += rF;
-                    gSum += gF;
-                    bSum += bF;
-                }
-
-            }
-
-            glCheckError();
-           } else if ( (type == Texture::eDataTypeFloat)) {
-            std::vector<float> pixels(rectPixel.width() * rectPixel.height() * 4);
-            glReadPixels(rectPixel.left(), rectPixel.right(), rectPixel.width(), rectPixel.height(),
-                         GL_RGBA, GL_FLOAT, &pixels.front());
-
-            int rowSize = rectPixel.width() * 4;
-            for (int y = 0; y < rectPixel.height(); ++y) {
-                for (int x = 0; x < rectPixel.width(); ++x) {
-                    double rF = pixels[y * rowSize + (4 * x)];
-                    double gF = pixels[y * rowSize + (4 * x) + 1];
-                    double bF = pixels[y * rowSize + (4 * x) + 2];
-                    double aF = pixels[y * rowSize + (4 * x) + 3];
-
-                    aSum += aF;
-                    if ( forceLinear && (_imp->displayingImageLut != eViewerColorSpaceLinear) ) {
-                        const Color::Lut* srcColorSpace = ViewerInstance::lutFromColorspace(_imp->displayingImageLut);
-
-                        rSum += srcColorSpace->fromColorSpaceFloatToLinearFloat(rF);
-                        gSum += srcColorSpace->fromColorSpaceFloatToLinearFloat(gF);
-                        bSum += srcColorSpace->fromColorSpaceFloatToLinearFloat(bF);
-                    } else {
-                        rSum += rF;
-                        gSum += gF;
-                        bSum += bF;
-                    }
-                }
-            }
-
-
-            glCheckError();
-           }
-
-         * r = rSum / rectPixel.area();
-         * g = gSum / rectPixel.area();
-         * b = bSum / rectPixel.area();
-         * a = aSum / rectPixel.area();
-
-           return true;*/
     }
+    *r = result.r;
+    *g = result.g;
+    *b = result.b;
+    *a = result.a;
 
-
-    ImageBitDepthEnum depth = image->getBitDepth();
-    ViewerColorSpaceEnum srcCS = _imp->viewerTab->getGui()->getApp()->getDefaultColorSpaceForBitDepth(depth);
-    const Color::Lut* dstColorSpace;
-    const Color::Lut* srcColorSpace;
-    if ( (srcCS == _imp->displayingImageLut) && ( (_imp->displayingImageLut == eViewerColorSpaceLinear) || !forceLinear ) ) {
-        // identity transform
-        srcColorSpace = 0;
-        dstColorSpace = 0;
-    } else {
-        srcColorSpace = ViewerInstance::lutFromColorspace(srcCS);
-        dstColorSpace = ViewerInstance::lutFromColorspace(_imp->displayingImageLut);
-    }
-
-    unsigned long area = 0;
-    for (int yPixel = rectPixel.bottom(); yPixel < rectPixel.top(); ++yPixel) {
-        for (int xPixel = rectPixel.x1; xPixel < rectPixel.x2; ++xPixel) {
-            float rPix, gPix, bPix, aPix;
-            bool gotval = false;
-            switch (depth) {
-            case eImageBitDepthByte:
-                gotval = getColorAtInternal<unsigned char, 255>(image,
-                                                                xPixel, yPixel,
-                                                                forceLinear,
-                                                                srcColorSpace,
-                                                                dstColorSpace,
-                                                                &rPix, &gPix, &bPix, &aPix);
-                break;
-            case eImageBitDepthShort:
-                gotval = getColorAtInternal<unsigned short, 65535>(image,
-                                                                   xPixel, yPixel,
-                                                                   forceLinear,
-                                                                   srcColorSpace,
-                                                                   dstColorSpace,
-                                                                   &rPix, &gPix, &bPix, &aPix);
-                break;
-            case eImageBitDepthHalf:
-                break;
-            case eImageBitDepthFloat:
-                gotval = getColorAtInternal<float, 1>(image,
-                                                      xPixel, yPixel,
-                                                      forceLinear,
-                                                      srcColorSpace,
-                                                      dstColorSpace,
-                                                      &rPix, &gPix, &bPix, &aPix);
-                break;
-            case eImageBitDepthNone:
-                break;
-            }
-            if (gotval) {
-                rSum += rPix;
-                gSum += gPix;
-                bSum += bPix;
-                aSum += aPix;
-                ++area;
-            }
-        }
-    }
-
-    if (area > 0) {
-        *r = rSum / area;
-        *g = gSum / area;
-        *b = bSum / area;
-        *a = aSum / area;
-
-        return true;
-    }
-
-    return false;
+    return true;
 } // getColorAtRect
 
 int
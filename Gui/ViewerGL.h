@@ -261,6 +261,11 @@ public Q_SLOTS:
 
     void onCheckerboardSettingsChanged();
 
+    /**
+     * @brief Displays the colors averaged by the rectangle color picker on a worker thread.
+     **/
+    void onRectangleColorPickerFinished();
+
 
     /**
      * @brief Reset the wipe position so it is in the center of the B input.
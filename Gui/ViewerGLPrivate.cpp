@@ -38,10 +38,12 @@
 #include "Engine/Lut.h" // Color
 #include "Engine/Settings.h"
 #include "Engine/Texture.h"
+#include "Engine/ViewerInstance.h"
 
 #include "Gui/Gui.h"
 #include "Gui/GuiApplicationManager.h" // appFont
 #include "Gui/Menu.h"
+#include "Gui/Shaders.h" // NATRON_VIEWER_DISPLAY_LUT_SIZE
 #include "Gui/ViewerTab.h"
 
 #ifndef M_PI
@@ -64,11 +66,13 @@ ViewerGL::Implementation::Implementation(ViewerGL* this_,
                                          ViewerTab* parent)
     : _this(this_)
     , pboIds()
+    , pboSizes()
     , vboVerticesId(0)
     , vboTexturesId(0)
     , iboTriangleStripId(0)
     , displayTextures()
     , partialUpdateTextures()
+    , partialUpdateTexturesPool()
     , shaderRGB()
     , shaderBlack()
     , shaderLoaded(false)
@@ -99,6 +103,9 @@ ViewerGL::Implementation::Implementation(ViewerGL* this_,
     , currentViewerInfo_resolutionOverlay()
     , pickerState(ePickerStateInactive)
     , lastPickerPos()
+    , pickerRect()
+    , rectanglePickerWatcher( new QFutureWatcher<std::vector<ColorPickerRectResult> >(_this) )
+    , rectanglePickerPending(false)
     , userRoIEnabled(false)   // protected by mutex
     , userRoI()   // protected by mutex
     , buildUserRoIOnNextPress(false)
@@ -112,6 +119,8 @@ ViewerGL::Implementation::Implementation(ViewerGL* this_,
     , wipeInitialized(false)
     , selectionRectangle()
     , checkerboardTextureID(0)
+    , displayLutTextureID(0)
+    , displayLutTextureColorspace(eViewerColorSpaceLinear)
     , checkerboardTileSize(0)
     , savedTexture(0)
     , prevBoundTexture(0)
@@ -156,18 +165,24 @@ ViewerGL::Implementation::~Implementation()
         displayTextures[i].texture.reset();
     }
     partialUpdateTextures.clear();
+    partialUpdateTexturesPool.clear();
 
     if ( appPTR && appPTR->isOpenGLLoaded() ) {
         glCheckError();
         for (U32 i = 0; i < this->pboIds.size(); ++i) {
             glDeleteBuffers(1, &this->pboIds[i]);
         }
+        this->pboIds.clear();
+        this->pboSizes.clear();
         glCheckError();
         glDeleteBuffers(1, &this->vboVerticesId);
         glDeleteBuffers(1, &this->vboTexturesId);
         glDeleteBuffers(1, &this->iboTriangleStripId);
         glCheckError();
         glDeleteTextures(1, &this->checkerboardTextureID);
+        if (this->displayLutTextureID) {
+            glDeleteTextures(1, &this->displayLutTextureID);
+        }
     }
 }
 
@@ -689,6 +704,9 @@ ViewerGL::Implementation::unbindTextureAndReleaseShader(bool useShader)
 {
     if (useShader) {
         shaderRGB->release();
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_1D, 0);
+        glActiveTexture(GL_TEXTURE0);
     }
     glCheckError();
     glBindTexture(GL_TEXTURE_2D, prevBoundTexture);
@@ -873,12 +891,65 @@ ViewerGL::Implementation::activateShaderRGB(int texIndex)
         qDebug() << "Error when binding shader" << qPrintable( shaderRGB->log() );
     }
 
+    // the display transform is sampled from a 1D texture on unit 1, Tex stays on unit 0
+    const bool useLutTexture = ViewerInstance::lutFromColorspace(displayingImageLut) != 0;
+    if (useLutTexture) {
+        updateDisplayLutTexture(displayingImageLut);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_1D, displayLutTextureID);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
     shaderRGB->setUniformValue("Tex", 0);
+    shaderRGB->setUniformValue("LutTex", 1);
     shaderRGB->setUniformValue("gain", (float)displayTextures[texIndex].gain);
     shaderRGB->setUniformValue("offset", (float)displayTextures[texIndex].offset);
-    shaderRGB->setUniformValue("lut", (GLint)displayingImageLut);
+    shaderRGB->setUniformValue("useLut", (GLint)useLutTexture);
     float gamma = displayTextures[texIndex].gamma;
     shaderRGB->setUniformValue("gamma", gamma);
+    // Floating-point textures hold RGB for all channels that the shader can extract (see ViewerInstance::isDisplayChannelsAppliedByShader)
+    DisplayChannelsEnum channels = viewerTab->getInternalNode()->getChannels(texIndex);
+    if ( !ViewerInstance::isDisplayChannelsAppliedByShader(channels) ) {
+        channels = eDisplayChannelsRGB;
+    }
+    shaderRGB->setUniformValue("channels", (GLint)channels);
+}
+
+void
+ViewerGL::Implementation::updateDisplayLutTexture(ViewerColorSpaceEnum colorspace)
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+
+    if ( displayLutTextureID && (displayLutTextureColorspace == colorspace) ) {
+        return;
+    }
+    const Color::Lut* lut = ViewerInstance::lutFromColorspace(colorspace);
+    assert(lut);
+    if (!lut) {
+        return;
+    }
+
+    // sample [0,1] so that the first and last texels are exactly 0 and 1: the shader clamps its input to this range,
+    // which does not change what is displayed since the transforms are monotonic and the framebuffer is clamped.
+    std::vector<float> samples(NATRON_VIEWER_DISPLAY_LUT_SIZE);
+    for (int i = 0; i < NATRON_VIEWER_DISPLAY_LUT_SIZE; ++i) {
+        samples[i] = lut->toColorSpaceFloatFromLinearFloat( (float)i / (NATRON_VIEWER_DISPLAY_LUT_SIZE - 1) );
+    }
+
+    if (!displayLutTextureID) {
+        glGenTextures(1, &displayLutTextureID);
+    }
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, displayLutTextureID);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_LUMINANCE32F_ARB, NATRON_VIEWER_DISPLAY_LUT_SIZE, 0, GL_LUMINANCE, GL_FLOAT, &samples.front());
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glCheckError();
+    displayLutTextureColorspace = colorspace;
 }
 
 bool
@@ -28,10 +28,14 @@
 
 #include "Global/Macros.h"
 
+#include <list>
+#include <vector>
+
 CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QMutex>
 #include <QtCore/QSize>
+#include <QtCore/QFutureWatcher>
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
@@ -49,6 +53,12 @@ CLANG_DIAG_ON(uninitialized)
 
 #define MAX_MIP_MAP_LEVELS 20
 
+// Number of PBOs the texture uploads cycle through, so that a PBO is never written while the GPU may still read it
+#define NATRON_VIEWER_PBO_RING_SIZE 3
+
+// Maximum number of released partial update textures kept around to be re-used by the next partial updates
+#define NATRON_VIEWER_PARTIAL_UPDATE_TEXTURES_POOL_SIZE 32
+
 NATRON_NAMESPACE_ENTER
 
 /*This class is the the core of the viewer : what displays images, overlays, etc...
@@ -141,6 +151,46 @@ struct TextureInfo
     bool isVisible;
 };
 
+/**
+ * @brief What the rectangle color picker needs to average the colors of one input. It is gathered on the main thread,
+ * the average itself can then be computed on any thread.
+ **/
+struct ColorPickerRectArgs
+{
+    ColorPickerRectArgs()
+        : image()
+        , rectPixel()
+        , forceLinear(false)
+        , srcColorSpace(0)
+        , dstColorSpace(0)
+    {
+    }
+
+    // The last rendered image, NULL if there is none
+    ImagePtr image;
+    RectI rectPixel;
+    bool forceLinear;
+    const Color::Lut* srcColorSpace;
+    const Color::Lut* dstColorSpace;
+};
+
+struct ColorPickerRectResult
+{
+    ColorPickerRectResult()
+        : picked(false)
+        , r(0.f)
+        , g(0.f)
+        , b(0.f)
+        , a(0.f)
+        , mipMapLevel(0)
+    {
+    }
+
+    bool picked;
+    float r, g, b, a;
+    unsigned int mipMapLevel;
+};
+
 struct ViewerGL::Implementation
 {
     Implementation(ViewerGL* this_,
@@ -153,12 +203,14 @@ struct ViewerGL::Implementation
     /////////////////////////////////////////////////////////
     // The following are only accessed from the main thread:
     std::vector<GLuint> pboIds; //!< PBO's id's used by the OpenGL context
+    std::vector<std::size_t> pboSizes; //!< bytes allocated for each of the pboIds
     //   GLuint vaoId; //!< VAO holding the rendering VBOs for texture mapping.
     GLuint vboVerticesId; //!< VBO holding the vertices for the texture mapping.
     GLuint vboTexturesId; //!< VBO holding texture coordinates.
     GLuint iboTriangleStripId; /*!< IBOs holding vertices indexes for triangle strip sets*/
     TextureInfo displayTextures[2]; /*!< A pointer to the textures that would be used if A and B are displayed*/
     std::vector<TextureInfo> partialUpdateTextures; /*!< Pointer to the partial rectangle textures overlayed onto the displayed texture when tracking*/
+    std::list<GLTexturePtr> partialUpdateTexturesPool; /*!< Released partial update textures, re-used instead of allocating new ones, most recent first*/
     boost::scoped_ptr<QGLShaderProgram> shaderRGB; /*!< The shader program used to render RGB data*/
     boost::scoped_ptr<QGLShaderProgram> shaderBlack; /*!< The shader program used when the viewer is disconnected.*/
     bool shaderLoaded; /*!< Flag to check whether the shaders have already been loaded.*/
@@ -194,6 +246,10 @@ struct ViewerGL::Implementation
     PickerStateEnum pickerState;
     QPointF lastPickerPos;
     QRectF pickerRect;
+    // The rectangle picker averages the A and B inputs on a worker thread. If the rectangle changes while it is being
+    // computed, it is computed again once the current computation is done.
+    QFutureWatcher<std::vector<ColorPickerRectResult> >* rectanglePickerWatcher;
+    bool rectanglePickerPending;
 
     // projection info, only used by the main thread
     QPointF glShadow; //!< pixel size in projection coordinates - used to create shadow
@@ -216,6 +272,8 @@ struct ViewerGL::Implementation
     bool wipeInitialized;
     QRectF selectionRectangle;
     GLuint checkerboardTextureID;
+    GLuint displayLutTextureID; //!< 1D texture sampling the to-display transform of displayLutTextureColorspace, bound on texture unit 1
+    ViewerColorSpaceEnum displayLutTextureColorspace;
     int checkerboardTileSize; // to avoid a call to getValue() of the settings at each draw
     GLuint savedTexture; // @see saveOpenGLContext/restoreOpenGLContext
     GLuint prevBoundTexture; // @see bindTextureAndActivateShader/unbindTextureAndReleaseShader
@@ -238,6 +296,11 @@ public:
 
     void initializeGL();
 
+    /**
+     * @brief Fills args for the rectangle color picker over rect (in canonical coordinates) on the given input.
+     **/
+    void getColorPickerRectArgs(const RectD& rect, bool forceLinear, int textureIndex, ColorPickerRectArgs* args);
+
     bool isNearbyWipeCenter(const QPointF & pos, double zoomScreenPixelWidth, double zoomScreenPixelHeight ) const;
     bool isNearbyWipeRotateBar(const QPointF & pos, double zoomScreenPixelWidth, double zoomScreenPixelHeight) const;
     bool isNearbyWipeMixHandle(const QPointF & pos, double zoomScreenPixelWidth, double zoomScreenPixelHeight) const;
@@ -254,6 +317,12 @@ public:
      **/
     void activateShaderRGB(int texIndex);
 
+    /**
+     *@brief Bakes the Lut of the given colorspace into displayLutTextureID, if it does not hold it already.
+     * The shader then applies exactly the same transform as the CPU conversion of 8-bit textures.
+     **/
+    void updateDisplayLutTexture(ViewerColorSpaceEnum colorspace);
+
     enum WipePolygonEnum
     {
         eWipePolygonEmpty = 0,  // don't draw anything
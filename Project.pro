@@ -37,6 +37,7 @@ SUBDIRS += \
     Renderer \
     Gui \
     Tests \
+    Benchmarks \
     PythonBin \
     App
 
@@ -59,6 +60,7 @@ Engine.depends = libmv openMVG HostSupport libtess ceres
 Renderer.depends = Engine
 Gui.depends = Engine qhttpserver
 Tests.depends = Gui Engine
+Benchmarks.depends = Engine
 App.depends = Gui Engine
 
 OTHER_FILES += \
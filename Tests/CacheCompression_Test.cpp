@@ -0,0 +1,78 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdlib>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Engine/CacheCompression.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(CacheCompression,
+     RoundTrip)
+{
+    // A smooth float ramp with a repeated constant portion, like image data
+    std::vector<float> pixels(64 * 1024);
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = i < pixels.size() / 2 ? (i % 256) / 255.f : 1.f;
+    }
+    const unsigned char* data = (const unsigned char*)&pixels[0];
+    std::size_t size = pixels.size() * sizeof(float);
+    std::vector<unsigned char> compressed;
+
+    ASSERT_TRUE( CacheCompression::compress(data, size, sizeof(float), 0.75, &compressed) );
+    EXPECT_LT( compressed.size(), size * 3 / 4 );
+
+    std::vector<float> decompressed( pixels.size() );
+    ASSERT_TRUE( CacheCompression::decompress(compressed, sizeof(float), (unsigned char*)&decompressed[0], size) );
+    EXPECT_TRUE(decompressed == pixels);
+
+    // Corrupted data must be detected instead of overflowing the output buffer
+    compressed.resize(compressed.size() / 2);
+    EXPECT_FALSE( CacheCompression::decompress(compressed, sizeof(float), (unsigned char*)&decompressed[0], size) );
+}
+
+TEST(CacheCompression,
+     IncompressibleData)
+{
+    std::vector<unsigned char> noise(32 * 1024 + 3);
+    srand(1);
+    for (std::size_t i = 0; i < noise.size(); ++i) {
+        noise[i] = (unsigned char)(rand() & 0xFF);
+    }
+    std::vector<unsigned char> compressed;
+
+    EXPECT_FALSE( CacheCompression::compress(&noise[0], noise.size(), 2, 0.75, &compressed) );
+    EXPECT_TRUE( compressed.empty() );
+
+    // Still round-trips when the ratio allows it, odd sizes included
+    ASSERT_TRUE( CacheCompression::compress(&noise[0], noise.size(), 2, 2., &compressed) );
+    std::vector<unsigned char> decompressed( noise.size() );
+    ASSERT_TRUE( CacheCompression::decompress(compressed, 2, &decompressed[0], decompressed.size()) );
+    EXPECT_TRUE(decompressed == noise);
+}
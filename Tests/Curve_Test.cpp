@@ -25,6 +25,8 @@
 
 #include "Global/Macros.h"
 
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <QtCore/QString>
@@ -124,4 +126,107 @@ TEST(Curve, Basic)
     KeyFrame k2(1., 20.);
 }
 
+TEST(Curve, DenseSequentialAccess)
+{
+    Curve c;
+
+    // one key per frame, v = 2 * t
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_TRUE( c.addKeyFrame( KeyFrame(i, 2. * i, 0., 0., eKeyframeTypeLinear) ) );
+    }
+
+    // playback order, then backwards and random jumps
+    for (int i = 0; i < 999; ++i) {
+        EXPECT_DOUBLE_EQ( 2. * i + 1., c.getValueAt(i + 0.5) );
+    }
+    for (int i = 998; i >= 0; --i) {
+        EXPECT_DOUBLE_EQ( 2. * i, c.getValueAt(i) );
+    }
+    EXPECT_DOUBLE_EQ( 100., c.getValueAt(50.) );
+    EXPECT_DOUBLE_EQ( 1500., c.getValueAt(750.) );
+    EXPECT_DOUBLE_EQ( 3., c.getValueAt(1.5) );
+
+    // modifying the keyframes is seen by the next evaluation
+    EXPECT_DOUBLE_EQ( 100., c.getValueAt(50.) );
+    EXPECT_FALSE( c.addKeyFrame( KeyFrame(50., 0., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_DOUBLE_EQ( 0., c.getValueAt(50.) );
+    c.removeKeyFrameWithTime(50.);
+    EXPECT_DOUBLE_EQ( 100., c.getValueAt(50.) );
+}
 
+TEST(Curve, Integrate)
+{
+    Curve c;
+
+    // speed curve going linearly from 1 to 3 over [0,10], then constant
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(0., 1., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(10., 3., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_DOUBLE_EQ( 20., c.getIntegrateFromTo(0., 10.) );
+    EXPECT_DOUBLE_EQ( 5.625, c.getIntegrateFromTo(2.5, 7.5) - c.getIntegrateFromTo(2.5, 5.) );
+    EXPECT_DOUBLE_EQ( 26., c.getIntegrateFromTo(0., 12.) );
+    EXPECT_DOUBLE_EQ( -26., c.getIntegrateFromTo(12., 0.) );
+
+    // inverse
+    EXPECT_NEAR( 10., c.getTimeAtIntegralFrom(0., 20.), 1e-9 );
+    EXPECT_NEAR( 12., c.getTimeAtIntegralFrom(0., 26.), 1e-9 );
+    EXPECT_NEAR( -2., c.getTimeAtIntegralFrom(0., -2.), 1e-9 );
+    EXPECT_NEAR( 7.5, c.getTimeAtIntegralFrom(5., c.getIntegrateFromTo(5., 7.5) ), 1e-9 );
+
+    // many smooth keyframes: the integral over a range is the sum of the integrals over its parts, and edits are seen
+    for (int i = 0; i < 100; ++i) {
+        c.addKeyFrame( KeyFrame(i, 2. + (i * 7) % 5, 0., 0., eKeyframeTypeSmooth) );
+    }
+    for (double t = -3.; t < 103.; t += 7.3) {
+        EXPECT_NEAR( c.getIntegrateFromTo(-3., t + 4.1), c.getIntegrateFromTo(-3., t) + c.getIntegrateFromTo(t, t + 4.1), 1e-9 );
+        EXPECT_NEAR( t, c.getTimeAtIntegralFrom( -3., c.getIntegrateFromTo(-3., t) ), 1e-6 );
+    }
+    double before = c.getIntegrateFromTo(0., 99.);
+    EXPECT_FALSE( c.addKeyFrame( KeyFrame(50., 10., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_LT( before, c.getIntegrateFromTo(0., 99.) );
+}
+
+TEST(Curve, GetValuesAt)
+{
+    Curve c;
+
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(0., 0., 0., 0., eKeyframeTypeSmooth) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(10., 5., 0., 0., eKeyframeTypeSmooth) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(20., -3., 0., 0., eKeyframeTypeSmooth) ) );
+
+    std::vector<double> times;
+    for (double t = -5.; t <= 25.; t += 0.25) {
+        times.push_back(t);
+    }
+    std::vector<double> values( times.size() );
+    c.getValuesAt( &times[0], &values[0], (int)times.size() );
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        EXPECT_EQ( c.getValueAt(times[i]), values[i] );
+    }
+}
+
+TEST(Curve, SmoothCurves)
+{
+    std::vector<CurvePtr> curves;
+    std::vector<CurvePtr> references;
+
+    for (int c = 0; c < 16; ++c) {
+        CurvePtr curve(new Curve);
+        CurvePtr reference(new Curve);
+        for (int i = 0; i < 100; ++i) {
+            KeyFrame k( i, ( (i * 7 + c * 13) % 11 ) - 5., 0., 0., eKeyframeTypeLinear );
+            curve->addKeyFrame(k);
+            reference->addKeyFrame(k);
+        }
+        curves.push_back(curve);
+        references.push_back(reference);
+    }
+
+    Curve::smoothCurves(curves, 0);
+    for (std::size_t c = 0; c < curves.size(); ++c) {
+        references[c]->smooth(0);
+        ASSERT_EQ( references[c]->getKeyFramesCount(), curves[c]->getKeyFramesCount() );
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_EQ( references[c]->getValueAt(i), curves[c]->getValueAt(i) );
+        }
+    }
+}
@@ -91,3 +91,30 @@ TEST(Hash64,
     EXPECT_NE(hash1, hash2);
 } // TEST
 
+
+TEST(Hash64,
+     OrderAndLength)
+{
+    Hash64 a;
+    Hash64 b;
+
+    a.append<int>(1);
+    a.append<int>(2);
+    a.computeHash();
+    b.append<int>(2);
+    b.append<int>(1);
+    b.computeHash();
+    EXPECT_NE(a, b) << "The order of appended values is part of the hash.";
+
+    b.reset();
+    b.append<int>(1);
+    b.append<int>(2);
+    b.append<int>(0);
+    b.computeHash();
+    EXPECT_NE(a, b) << "Appending a zero value changes the hash.";
+
+    // computeHash() can be called again after further appends
+    a.append<int>(0);
+    a.computeHash();
+    EXPECT_EQ(a, b);
+} // TEST
@@ -0,0 +1,74 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstring>
+#include <gtest/gtest.h>
+
+#include "Engine/ImageBufferPool.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(ImageBufferPool,
+     ReusesReleasedBuffers)
+{
+    ImageBufferPool::setMaximumFreeSize(64 * 1024 * 1024);
+
+    std::size_t size = 3 * 1000 * 1000;
+    std::size_t allocated;
+    void* buffer = ImageBufferPool::allocate(size, &allocated);
+    ASSERT_TRUE(buffer != 0);
+    // The waste of a size class is at most 25%
+    EXPECT_GE(allocated, size);
+    EXPECT_LE(allocated, size + size / 4);
+    std::memset(buffer, 1, size);
+    ImageBufferPool::release(buffer, allocated);
+
+    ImageBufferPool::Stats before;
+    ImageBufferPool::getStats(&before);
+    EXPECT_GE(before.freeBytes, allocated);
+
+    // A slightly smaller buffer falls in the same class
+    std::size_t reallocated;
+    void* reused = ImageBufferPool::allocate(size - 1000, &reallocated);
+    EXPECT_EQ(buffer, reused);
+    EXPECT_EQ(allocated, reallocated);
+
+    ImageBufferPool::Stats after;
+    ImageBufferPool::getStats(&after);
+    EXPECT_EQ(before.hits + 1, after.hits);
+    EXPECT_EQ(before.freeBytes - allocated, after.freeBytes);
+    ImageBufferPool::release(reused, reallocated);
+
+    // Nothing is kept beyond the maximum
+    ImageBufferPool::setMaximumFreeSize(0);
+    ImageBufferPool::getStats(&after);
+    EXPECT_EQ( (std::size_t)0, after.freeBytes );
+    buffer = ImageBufferPool::allocate(size, &allocated);
+    ImageBufferPool::release(buffer, allocated);
+    ImageBufferPool::getStats(&after);
+    EXPECT_EQ( (std::size_t)0, after.freeBytes );
+}
@@ -117,6 +117,38 @@ TEST(BitmapTest,
     EXPECT_TRUE(nonRenderedRects.size() == 3);
 } // TEST
 
+TEST(BitmapTest,
+     LargeRect)
+{
+    // Large enough to span several summary tiles, with bounds not aligned on them
+    RectI rod(-35, 13, 1000, 700);
+    Bitmap bm(rod);
+
+    bm.markForRendered(rod);
+    ASSERT_TRUE( bm.minimalNonMarkedBbox(rod).isNull() );
+
+    ///clear a rectangle straddling several tiles and check it is found back exactly
+    RectI hole(100, 150, 333, 421);
+    bm.clear(hole);
+    ASSERT_TRUE(bm.minimalNonMarkedBbox(rod) == hole);
+    ASSERT_TRUE( bm.isNonMarked(hole) );
+    ASSERT_FALSE( bm.isNonMarked(rod) );
+
+    ///a single pixel being rendered elsewhere in a rendered area must be reported in trimap mode only
+    bm.markForRendered(hole);
+    RectI pixel(500, 600, 501, 601);
+    bm.markForRendering(pixel);
+    bool beingRenderedElseWhere = false;
+    ASSERT_TRUE( bm.minimalNonMarkedBbox_trimap(rod, &beingRenderedElseWhere).isNull() );
+    ASSERT_TRUE(beingRenderedElseWhere == true);
+    ASSERT_TRUE(bm.minimalNonMarkedBbox(rod) == pixel);
+
+    ///writing directly to the map must be taken into account
+    bm.markForRendered(rod);
+    *bm.getBitmapAt(10, 20) = 0;
+    ASSERT_TRUE( bm.minimalNonMarkedBbox(rod) == RectI(10, 20, 11, 21) );
+} // TEST
+
 TEST(ImageKeyTest, Equality) {
     srand(2000);
     // coverity[dont_call]
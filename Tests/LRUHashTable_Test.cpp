@@ -0,0 +1,179 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdlib>
+#include <map>
+#include <gtest/gtest.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include "Engine/LRUHashTable.h"
+
+#ifdef NATRON_CACHE_USE_INTRUSIVE
+
+typedef boost::shared_ptr<int> IntPtr;
+typedef IntrusiveLRUHashTable<boost::uint64_t, IntPtr> IntTable;
+
+TEST(LRUHashTable,
+     EvictionOrder)
+{
+    IntTable table;
+
+    for (int i = 0; i < 1000; ++i) {
+        table.insert( i, IntPtr( new int(i) ) );
+    }
+    ASSERT_EQ( (unsigned int)1000, table.size() );
+
+    // Touch the even keys: the odd ones must be evicted first
+    for (int i = 0; i < 1000; i += 2) {
+        IntTable::iterator it = table(i);
+        ASSERT_TRUE( it != table.end() );
+        ASSERT_EQ( (std::size_t)1, it->second.size() );
+        ASSERT_EQ( i, *it->second.front() );
+    }
+    for (int i = 1; i < 1000; i += 2) {
+        std::pair<boost::uint64_t, IntPtr> evicted = table.evict();
+        ASSERT_TRUE(evicted.second);
+        ASSERT_EQ( (boost::uint64_t)i, evicted.first );
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        ASSERT_EQ( (boost::uint64_t)i, table.evict().first );
+    }
+    ASSERT_EQ( (unsigned int)0, table.size() );
+    ASSERT_FALSE( table.evict().second );
+}
+
+TEST(LRUHashTable,
+     ReferencedEntriesAreNotEvicted)
+{
+    IntTable table;
+    IntPtr held( new int(0) );
+
+    table.insert(0, held);
+    table.insert( 0, IntPtr( new int(1) ) );
+    table.insert( 1, IntPtr( new int(2) ) );
+
+    std::pair<boost::uint64_t, IntPtr> evicted = table.evict();
+    ASSERT_EQ( (boost::uint64_t)0, evicted.first );
+    ASSERT_EQ( 1, *evicted.second );
+    ASSERT_EQ( 2, *table.evict().second );
+    // Only the externally referenced value is left
+    ASSERT_FALSE( table.evict().second );
+    ASSERT_EQ( (unsigned int)1, table.size() );
+}
+
+TEST(LRUHashTable,
+     ScanResistance)
+{
+    IntrusiveLRUHashTable<boost::uint64_t, IntPtr, ScanResistantEvictionPolicy<IntPtr> > table;
+
+    // Frequently used records
+    for (int i = 0; i < 10; ++i) {
+        table.insert( i, IntPtr( new int(i) ) );
+        table(i);
+    }
+    // A scan of records used only once
+    for (int i = 10; i < 100; ++i) {
+        table.insert( i, IntPtr( new int(i) ) );
+    }
+    for (int i = 10; i < 100; ++i) {
+        ASSERT_EQ( (boost::uint64_t)i, table.evict().first );
+    }
+    ASSERT_EQ( (unsigned int)10, table.size() );
+}
+
+// Pins the negative values
+class NegativePinnedEvictionPolicy
+    : public LRUEvictionPolicy<IntPtr>
+{
+public:
+
+    static bool isPinned(const IntPtr & value)
+    {
+        return *value < 0;
+    }
+};
+
+TEST(LRUHashTable,
+     PinnedEntriesAreKept)
+{
+    IntrusiveLRUHashTable<boost::uint64_t, IntPtr, NegativePinnedEvictionPolicy> table;
+
+    table.insert( 0, IntPtr( new int(-1) ) );
+    table.insert( 0, IntPtr( new int(1) ) );
+    table.insert( 1, IntPtr( new int(-2) ) );
+    table.insert( 2, IntPtr( new int(2) ) );
+
+    ASSERT_EQ( 1, *table.evict(true).second );
+    ASSERT_EQ( 2, *table.evict(true).second );
+    ASSERT_FALSE( table.evict(true).second );
+    ASSERT_EQ( (unsigned int)2, table.size() );
+
+    // Pinned values are evicted when not asked to keep them
+    ASSERT_EQ( -1, *table.evict().second );
+    ASSERT_EQ( -2, *table.evict().second );
+    ASSERT_EQ( (unsigned int)0, table.size() );
+}
+
+TEST(LRUHashTable,
+     RandomOperations)
+{
+    IntTable table;
+    std::map<boost::uint64_t, int> reference;
+
+    srand(2000);
+    for (int i = 0; i < 20000; ++i) {
+        // Keys sharing their low bits to exercise the probing
+        // coverity[dont_call]
+        boost::uint64_t key = (boost::uint64_t)(rand() % 500) << 20;
+        // coverity[dont_call]
+        int op = rand() % 3;
+        if (op == 0) {
+            table.insert( key, IntPtr( new int(0) ) );
+            ++reference[key];
+        } else {
+            IntTable::iterator it = table(key);
+            std::map<boost::uint64_t, int>::iterator found = reference.find(key);
+            ASSERT_EQ( found != reference.end(), it != table.end() );
+            if ( (op == 2) && ( found != reference.end() ) ) {
+                ASSERT_EQ( (std::size_t)found->second, it->second.size() );
+                table.erase(it);
+                reference.erase(found);
+            }
+        }
+        ASSERT_EQ( reference.size(), (std::size_t)table.size() );
+    }
+
+    std::size_t count = 0;
+    for (IntTable::iterator it = table.begin(); it != table.end(); ++it) {
+        ASSERT_TRUE( reference.find(it->first) != reference.end() );
+        ++count;
+    }
+    ASSERT_EQ(reference.size(), count);
+}
+
+#endif // NATRON_CACHE_USE_INTRUSIVE
@@ -26,6 +26,7 @@
 #include "Global/Macros.h"
 
 #include <cstdlib>
+#include <vector>
 #include <gtest/gtest.h>
 #include "Engine/Lut.h"
 
@@ -52,3 +53,26 @@ TEST(Lut, IntConversions) {
         EXPECT_EQ( i, uint8xxToChar( charToUint8xx(i) ) );
     }
 }
+
+TEST(Lut, Uint16RoundTrip) {
+    const Lut* lut = LutManager::sRGBLut();
+    std::vector<unsigned short> from(0x10000);
+    std::vector<float> linear(0x10000);
+    std::vector<unsigned short> to(0x10000);
+
+    for (int i = 0; i < 0x10000; ++i) {
+        from[i] = (unsigned short)i;
+    }
+    lut->from_short_planar(&linear[0], &from[0], 0x10000);
+    lut->to_short_planar(&to[0], &linear[0], 0x10000);
+    for (int i = 0; i < 0x10000; ++i) {
+        EXPECT_EQ(from[i], to[i]);
+    }
+
+    // out of range values must be clamped
+    float outOfRange[2] = { -1.f, 2.f };
+    unsigned short clamped[2];
+    lut->to_short_planar(clamped, outOfRange, 2);
+    EXPECT_EQ(0, clamped[0]);
+    EXPECT_EQ(0xffff, clamped[1]);
+}
@@ -0,0 +1,122 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <gtest/gtest.h>
+
+#include "Engine/NumericExpression.h"
+
+NATRON_NAMESPACE_USING
+
+static bool
+evaluate(const char* expr,
+         double frame,
+         double* ret,
+         bool* isInt)
+{
+    NumericExpression e;
+
+    if ( !e.compile(expr) ) {
+        return false;
+    }
+
+    return e.evaluate(frame, 0, 1, ret, isInt);
+}
+
+TEST(NumericExpression, Compile)
+{
+    NumericExpression e;
+
+    EXPECT_TRUE( e.compile("frame*2+sin(frame)") );
+    EXPECT_TRUE( e.compile("-(frame - 10) ** 2 / 3.5e1 % max(1, dimension, view)") );
+    EXPECT_TRUE( e.compile("pi * radians(frame)") );
+
+    // anything that needs Python
+    EXPECT_FALSE( e.compile("thisNode.size.get()[0]") );
+    EXPECT_FALSE( e.compile("random()") );
+    EXPECT_FALSE( e.compile("frame if frame > 1 else 0") );
+    EXPECT_FALSE( e.compile("unknownFunction(frame)") );
+    EXPECT_FALSE( e.compile("sin(frame, 2)") );
+    EXPECT_FALSE( e.compile("\"1\"") );
+    EXPECT_FALSE( e.compile("a = 1\nret = a") );
+    EXPECT_FALSE( e.compile("0x10") );
+    EXPECT_FALSE( e.compile("(frame") );
+    EXPECT_FALSE( e.compile("") );
+}
+
+TEST(NumericExpression, PythonSemantics)
+{
+    double v;
+    bool isInt;
+
+    ASSERT_TRUE( evaluate("frame*2+1", 3., &v, &isInt) );
+    EXPECT_EQ(7., v);
+    EXPECT_TRUE(isInt) << "An integral frame is passed as an int";
+
+    ASSERT_TRUE( evaluate("frame*2", 3.5, &v, &isInt) );
+    EXPECT_EQ(7., v);
+    EXPECT_FALSE(isInt);
+
+    ASSERT_TRUE( evaluate("-2**2", 0., &v, &isInt) );
+    EXPECT_EQ(-4., v);
+    ASSERT_TRUE( evaluate("2**3**2", 0., &v, &isInt) );
+    EXPECT_EQ(512., v);
+    ASSERT_TRUE( evaluate("2**-1", 0., &v, &isInt) );
+    EXPECT_EQ(0.5, v);
+    EXPECT_FALSE(isInt);
+
+    ASSERT_TRUE( evaluate("-7 % 3", 0., &v, &isInt) );
+    EXPECT_EQ(2., v);
+    ASSERT_TRUE( evaluate("7 // -2", 0., &v, &isInt) );
+    EXPECT_EQ(-4., v);
+    ASSERT_TRUE( evaluate("7. / 2", 0., &v, &isInt) );
+    EXPECT_EQ(3.5, v);
+#if PY_MAJOR_VERSION >= 3
+    ASSERT_TRUE( evaluate("7 / 2", 0., &v, &isInt) );
+    EXPECT_EQ(3.5, v);
+#else
+    ASSERT_TRUE( evaluate("7 / 2", 0., &v, &isInt) );
+    EXPECT_EQ(3., v) << "Python 2 divides integers with a floor division";
+#endif
+
+    ASSERT_TRUE( evaluate("min(3, 3.0)", 0., &v, &isInt) );
+    EXPECT_TRUE(isInt) << "min keeps the first of equal values";
+    ASSERT_TRUE( evaluate("int(-2.7)", 0., &v, &isInt) );
+    EXPECT_EQ(-2., v);
+    ASSERT_TRUE( evaluate("log(8, 2)", 0., &v, &isInt) );
+    EXPECT_DOUBLE_EQ(3., v);
+    ASSERT_TRUE( evaluate("dimension", 0., &v, &isInt) );
+    EXPECT_EQ(1., v);
+
+    // errors are left to Python to report
+    EXPECT_FALSE( evaluate("1 / 0", 0., &v, &isInt) );
+    EXPECT_FALSE( evaluate("frame % 0", 0., &v, &isInt) );
+    EXPECT_FALSE( evaluate("sqrt(-1)", 0., &v, &isInt) );
+    EXPECT_FALSE( evaluate("log(0)", 0., &v, &isInt) );
+    EXPECT_FALSE( evaluate("exp(1000)", 0., &v, &isInt) );
+    EXPECT_FALSE( evaluate("(-8) ** 0.5", 0., &v, &isInt) );
+}
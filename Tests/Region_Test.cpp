@@ -0,0 +1,176 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+#include <algorithm> // min, max
+
+#include <gtest/gtest.h>
+
+#include "Engine/Region.h"
+
+NATRON_NAMESPACE_USING
+
+// Brute-force coverage count of a pixel by the rectangles of a region
+static int
+coverage(const RegionI & region,
+         int x,
+         int y)
+{
+    const std::vector<RectI>& rects = region.getRects();
+    int ret = 0;
+
+    for (std::size_t i = 0; i < rects.size(); ++i) {
+        if ( rects[i].contains(x, y) ) {
+            ++ret;
+        }
+    }
+
+    return ret;
+}
+
+TEST(Region, Basic)
+{
+    RegionI r;
+
+    EXPECT_TRUE( r.isEmpty() );
+    EXPECT_TRUE( r.getBoundingBox().isNull() );
+
+    // null rectangles are ignored
+    r.unite( RectI(10, 10, 10, 20) );
+    EXPECT_TRUE( r.isEmpty() );
+
+    r.unite( RectI(0, 0, 10, 10) );
+    EXPECT_EQ( 1u, r.getRectsCount() );
+    EXPECT_TRUE( r.contains( RectI(2, 2, 8, 8) ) );
+    EXPECT_FALSE( r.contains( RectI(2, 2, 12, 8) ) );
+
+    // a disjoint rectangle stays disjoint
+    r.unite( RectI(100, 100, 110, 110) );
+    EXPECT_EQ( 2u, r.getRectsCount() );
+    EXPECT_EQ( RectI(0, 0, 110, 110), r.getBoundingBox() );
+    EXPECT_FALSE( r.contains( RectI(20, 20, 30, 30) ) );
+    EXPECT_FALSE( r.intersects( RectI(20, 20, 30, 30) ) );
+    EXPECT_TRUE( r.intersects( RectI(105, 0, 200, 105) ) );
+
+    // adjacent rectangles are coalesced
+    RegionI s( RectI(0, 0, 10, 10) );
+    s.unite( RectI(10, 0, 20, 10) );
+    s.unite( RectI(0, 10, 20, 20) );
+    EXPECT_EQ( 1u, s.getRectsCount() );
+    EXPECT_EQ( RegionI( RectI(0, 0, 20, 20) ), s );
+    EXPECT_TRUE( s.contains( RectI(0, 0, 20, 20) ) );
+
+    s.clear();
+    EXPECT_TRUE( s.isEmpty() );
+}
+
+TEST(Region, IntersectSubtract)
+{
+    RegionI r( RectI(0, 0, 10, 10) );
+
+    r.unite( RectI(20, 0, 30, 10) );
+
+    RegionI i = r;
+    i.intersect( RectI(5, 5, 25, 15) );
+    EXPECT_EQ( 2u, i.getRectsCount() );
+    EXPECT_EQ( RectI(5, 5, 25, 10), i.getBoundingBox() );
+
+    RegionI d = r;
+    d.subtract( RectI(5, -5, 25, 5) );
+    EXPECT_FALSE( d.intersects( RectI(5, 0, 25, 5) ) );
+    EXPECT_TRUE( d.contains( RectI(0, 5, 10, 10) ) );
+    EXPECT_TRUE( d.contains( RectI(0, 0, 5, 10) ) );
+
+    // subtracting everything leaves nothing
+    d.subtract( RectI(-100, -100, 100, 100) );
+    EXPECT_TRUE( d.isEmpty() );
+
+    // intersecting disjoint regions gives nothing
+    RegionI e( RectI(0, 0, 10, 10) );
+    e.intersect( RectI(10, 10, 20, 20) );
+    EXPECT_TRUE( e.isEmpty() );
+}
+
+TEST(Region, RandomAgainstPixels)
+{
+    const int size = 24;
+    unsigned int seed = 1;
+
+    for (int iter = 0; iter < 200; ++iter) {
+        RegionI regions[2];
+        std::vector<bool> pixels[2];
+        for (int k = 0; k < 2; ++k) {
+            pixels[k].assign(size * size, false);
+            for (int n = 0; n < 4; ++n) {
+                int v[4];
+                for (int j = 0; j < 4; ++j) {
+                    seed = seed * 1103515245u + 12345u;
+                    v[j] = (seed >> 16) % size;
+                }
+                RectI rect( std::min(v[0], v[2]), std::min(v[1], v[3]), std::max(v[0], v[2]), std::max(v[1], v[3]) );
+                regions[k].unite(rect);
+                for (int y = rect.y1; y < rect.y2; ++y) {
+                    for (int x = rect.x1; x < rect.x2; ++x) {
+                        pixels[k][y * size + x] = true;
+                    }
+                }
+            }
+        }
+
+        RegionI united = regions[0];
+        united.unite(regions[1]);
+        RegionI intersected = regions[0];
+        intersected.intersect(regions[1]);
+        RegionI subtracted = regions[0];
+        subtracted.subtract(regions[1]);
+
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                bool a = pixels[0][y * size + x];
+                bool b = pixels[1][y * size + x];
+                // every pixel is covered at most once
+                EXPECT_EQ( (a || b) ? 1 : 0, coverage(united, x, y) );
+                EXPECT_EQ( (a && b) ? 1 : 0, coverage(intersected, x, y) );
+                EXPECT_EQ( (a && !b) ? 1 : 0, coverage(subtracted, x, y) );
+            }
+        }
+    }
+}
+
+TEST(Region, Double)
+{
+    RegionD r( RectD(0., 0., 1.5, 1.5) );
+
+    r.unite( RectD(10., 10., 12.5, 12.5) );
+    EXPECT_EQ( 2u, r.getRectsCount() );
+    EXPECT_TRUE( r.contains( RectD(0.5, 0.5, 1., 1.) ) );
+    EXPECT_FALSE( r.contains( RectD(0.5, 0.5, 11., 11.) ) );
+
+    r.intersect( RectD(1., 1., 11., 11.) );
+    EXPECT_EQ( RectD(1., 1., 11., 11.), r.getBoundingBox() );
+    EXPECT_EQ( 2u, r.getRectsCount() );
+}
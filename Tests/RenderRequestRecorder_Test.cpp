@@ -0,0 +1,96 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include "Engine/RenderRequestRecorder.h"
+#include "Engine/StandardPaths.h"
+#include "Engine/ViewIdx.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(RenderRequestRecorder, WriteRead)
+{
+    QString tempPath = StandardPaths::writableLocation(StandardPaths::eStandardLocationTemp);
+    QDir().mkpath(tempPath);
+    std::string filePath = QDir(tempPath).absoluteFilePath( QString::fromUtf8("NatronUnitTest") + QString::number( qrand() ) + QString::fromUtf8(".log") ).toStdString();
+
+    RenderRequestRecorder::setEnabled(true);
+    RenderRequestRecorder::setProjectFile(std::string());
+
+    std::vector<ViewIdx> views;
+    views.push_back( ViewIdx(0) );
+    views.push_back( ViewIdx(1) );
+    RenderRequestRecorder::recordRenderCurrentFrame(0, 12., true);
+    RenderRequestRecorder::recordRenderFrameRange(0, 1, 100, 2, views, false);
+    RenderRequestRecorder::recordRenderFromCurrentFrame(0, 0.5, views, true);
+    RenderRequestRecorder::recordAbort(0, true);
+    RenderRequestRecorder::setEnabled(false);
+
+    // Not recorded
+    RenderRequestRecorder::recordAbort(0, false);
+
+    ASSERT_TRUE( RenderRequestRecorder::write(filePath) );
+
+    std::string projectFilePath;
+    std::vector<RenderRequestEvent> events;
+    ASSERT_TRUE( RenderRequestRecorder::read(filePath, &projectFilePath, &events) );
+    QFile::remove( QString::fromUtf8( filePath.c_str() ) );
+    QFile::remove( QString::fromUtf8( projectFilePath.c_str() ) );
+
+    EXPECT_EQ(filePath + ".ntp", projectFilePath);
+    ASSERT_EQ(4, (int)events.size());
+
+    EXPECT_EQ(RenderRequestEvent::eTypeRenderCurrentFrame, events[0].type);
+    EXPECT_EQ(12., events[0].time);
+    EXPECT_TRUE(events[0].flag);
+
+    EXPECT_EQ(RenderRequestEvent::eTypeRenderFrameRange, events[1].type);
+    EXPECT_EQ(1, events[1].firstFrame);
+    EXPECT_EQ(100, events[1].lastFrame);
+    EXPECT_EQ(2, events[1].frameStep);
+    ASSERT_EQ(2, (int)events[1].views.size());
+    EXPECT_EQ(1, events[1].views[1]);
+    EXPECT_FALSE(events[1].forward);
+
+    EXPECT_EQ(RenderRequestEvent::eTypeRenderFromCurrentFrame, events[2].type);
+    EXPECT_EQ(0.5, events[2].time);
+    EXPECT_TRUE(events[2].forward);
+
+    EXPECT_EQ(RenderRequestEvent::eTypeAbort, events[3].type);
+    EXPECT_TRUE(events[3].flag);
+
+    for (std::size_t i = 1; i < events.size(); ++i) {
+        EXPECT_LE(events[i - 1].timestamp, events[i].timestamp);
+    }
+}
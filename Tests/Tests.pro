@@ -45,11 +45,17 @@ SOURCES += \
     google-mock/src/gmock-all.cc \
     BaseTest.cpp \
     Hash64_Test.cpp \
+    LRUHashTable_Test.cpp \
+    CacheCompression_Test.cpp \
+    ImageBufferPool_Test.cpp \
     Image_Test.cpp \
     Lut_Test.cpp \
     KnobFile_Test.cpp \
     Curve_Test.cpp \
+    Region_Test.cpp \
+    NumericExpression_Test.cpp \
     Tracker_Test.cpp \
+    RenderRequestRecorder_Test.cpp \
     wmain.cpp
 
 HEADERS += \